@@ -0,0 +1,545 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshgenerators.h
+// ============
+// constexpr generators of the vertices and triangles of the basic 3D shapes,
+// so fixed tessellations are built by the compiler and other tessellations
+// by the same code at runtime
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+/***********************************************************
+ *  MESH_DATA
+ *
+ *  Interleaved vertices - position, normal and texture
+ *  coordinate - and a triangle list, sized at compile time
+ *  so a generated mesh can be a static constexpr array that
+ *  goes to glBufferData as it is.
+ ***********************************************************/
+template <size_t VERTEX_COUNT, size_t INDEX_COUNT>
+struct MESH_DATA
+{
+	static const size_t FLOATS_PER_VERTEX = 8;
+
+	std::array<float, VERTEX_COUNT * FLOATS_PER_VERTEX> vertices;
+	std::array<unsigned int, INDEX_COUNT> indices;
+
+	static constexpr size_t GetVertexCount() { return VERTEX_COUNT; }
+	static constexpr size_t GetIndexCount() { return INDEX_COUNT; }
+};
+
+namespace MeshGenerators
+{
+	/***********************************************************
+	 *  VECTOR3
+	 *
+	 *  glm has no constexpr math, so the generators use this.
+	 ***********************************************************/
+	struct VECTOR3
+	{
+		double x;
+		double y;
+		double z;
+	};
+
+	constexpr double PI = 3.14159265358979323846;
+
+	constexpr VECTOR3 Subtract(VECTOR3 a, VECTOR3 b) { return VECTOR3{ a.x - b.x, a.y - b.y, a.z - b.z }; }
+	constexpr VECTOR3 Scale(VECTOR3 a, double s) { return VECTOR3{ a.x * s, a.y * s, a.z * s }; }
+	constexpr double Dot(VECTOR3 a, VECTOR3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	constexpr VECTOR3 Cross(VECTOR3 a, VECTOR3 b)
+	{
+		return VECTOR3{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+
+	// sine by its Taylor series, after bringing the angle
+	// into -pi to pi where the series converges quickly
+	constexpr double Sine(double angle)
+	{
+		while (angle > PI)
+		{
+			angle -= 2.0 * PI;
+		}
+		while (angle < -PI)
+		{
+			angle += 2.0 * PI;
+		}
+		double term = angle;
+		double sum = angle;
+		for (int n = 1; n < 14; n++)
+		{
+			term *= -angle * angle / ((2.0 * n) * (2.0 * n + 1.0));
+			sum += term;
+		}
+		return sum;
+	}
+
+	constexpr double Cosine(double angle)
+	{
+		return Sine(angle + PI / 2.0);
+	}
+
+	// square root by Newton's method
+	constexpr double SquareRoot(double value)
+	{
+		if (value <= 0.0)
+		{
+			return 0.0;
+		}
+		double root = (value > 1.0) ? value : 1.0;
+		for (int i = 0; i < 64; i++)
+		{
+			double next = 0.5 * (root + value / root);
+			if (next == root)
+			{
+				break;
+			}
+			root = next;
+		}
+		return root;
+	}
+
+	constexpr VECTOR3 Normalize(VECTOR3 a)
+	{
+		double length = SquareRoot(Dot(a, a));
+		return (length > 0.0) ? Scale(a, 1.0 / length) : a;
+	}
+
+	// unit normal of a triangle, facing the side its corners
+	// are counterclockwise from
+	constexpr VECTOR3 CalculateTriangleNormal(VECTOR3 p0, VECTOR3 p1, VECTOR3 p2)
+	{
+		return Normalize(Cross(Subtract(p1, p0), Subtract(p2, p0)));
+	}
+
+	/***********************************************************
+	 *  MESH_BUILDER
+	 *
+	 *  Appends vertices and triangles to a mesh in order.
+	 ***********************************************************/
+	template <typename MESH>
+	struct MESH_BUILDER
+	{
+		MESH& mesh;
+		size_t vertexCount;
+		size_t indexCount;
+
+		constexpr MESH_BUILDER(MESH& target) : mesh(target), vertexCount(0), indexCount(0) {}
+
+		constexpr unsigned int AddVertex(VECTOR3 position, VECTOR3 normal, double u, double v)
+		{
+			size_t first = vertexCount * MESH::FLOATS_PER_VERTEX;
+			mesh.vertices[first] = (float)position.x;
+			mesh.vertices[first + 1] = (float)position.y;
+			mesh.vertices[first + 2] = (float)position.z;
+			mesh.vertices[first + 3] = (float)normal.x;
+			mesh.vertices[first + 4] = (float)normal.y;
+			mesh.vertices[first + 5] = (float)normal.z;
+			mesh.vertices[first + 6] = (float)u;
+			mesh.vertices[first + 7] = (float)v;
+			return (unsigned int)vertexCount++;
+		}
+
+		constexpr void AddTriangle(unsigned int a, unsigned int b, unsigned int c)
+		{
+			mesh.indices[indexCount++] = a;
+			mesh.indices[indexCount++] = b;
+			mesh.indices[indexCount++] = c;
+		}
+
+		// add a flat polygon of 3 or 4 corners, whose normal is
+		// turned to face away from a point inside of the shape
+		constexpr void AddFlatFace(const VECTOR3* corners, const double (*uvs)[2], int cornerCount, VECTOR3 inside)
+		{
+			VECTOR3 normal = CalculateTriangleNormal(corners[0], corners[1], corners[2]);
+			bool bFlip = (Dot(normal, Subtract(corners[0], inside)) < 0.0);
+			if (bFlip)
+			{
+				normal = Scale(normal, -1.0);
+			}
+			unsigned int first = (unsigned int)vertexCount;
+			for (int i = 0; i < cornerCount; i++)
+			{
+				AddVertex(corners[i], normal, uvs[i][0], uvs[i][1]);
+			}
+			for (int i = 1; i + 1 < cornerCount; i++)
+			{
+				if (bFlip)
+				{
+					AddTriangle(first, first + i + 1, first + i);
+				}
+				else
+				{
+					AddTriangle(first, first + i, first + i + 1);
+				}
+			}
+		}
+
+		// add a disc of the given radius at a height, facing up
+		// or down, with the texture laid over it from above
+		constexpr void AddCap(int segments, double height, double radius, bool bFacingUp)
+		{
+			VECTOR3 normal{ 0.0, bFacingUp ? 1.0 : -1.0, 0.0 };
+			unsigned int center = AddVertex(VECTOR3{ 0.0, height, 0.0 }, normal, 0.5, 0.5);
+			for (int i = 0; i < segments; i++)
+			{
+				double angle = 2.0 * PI * i / segments;
+				double x = Cosine(angle);
+				double z = -Sine(angle);
+				AddVertex(VECTOR3{ radius * x, height, radius * z }, normal, 0.5 + 0.5 * x, 0.5 - 0.5 * z);
+			}
+			for (int i = 0; i < segments; i++)
+			{
+				unsigned int current = center + 1 + i;
+				unsigned int next = center + 1 + ((i + 1) % segments);
+				if (bFacingUp)
+				{
+					AddTriangle(center, current, next);
+				}
+				else
+				{
+					AddTriangle(center, next, current);
+				}
+			}
+		}
+
+		// add the side of a cylinder from height 0 to 1, whose
+		// radius goes linearly from the bottom to the top.  The
+		// seam is doubled so the texture wraps around once
+		constexpr void AddSide(int segments, double bottomRadius, double topRadius)
+		{
+			unsigned int first = (unsigned int)vertexCount;
+			for (int i = 0; i <= segments; i++)
+			{
+				double angle = 2.0 * PI * i / segments;
+				double x = Cosine(angle);
+				double z = -Sine(angle);
+				VECTOR3 normal = Normalize(VECTOR3{ x, bottomRadius - topRadius, z });
+				double u = (double)i / segments;
+				AddVertex(VECTOR3{ bottomRadius * x, 0.0, bottomRadius * z }, normal, u, 0.0);
+				AddVertex(VECTOR3{ topRadius * x, 1.0, topRadius * z }, normal, u, 1.0);
+			}
+			for (int i = 0; i < segments; i++)
+			{
+				unsigned int bottom = first + 2 * i;
+				AddTriangle(bottom, bottom + 2, bottom + 3);
+				// the top of a cone is a point, where the second
+				// triangle has no area
+				if (topRadius > 0.0)
+				{
+					AddTriangle(bottom, bottom + 3, bottom + 1);
+				}
+			}
+		}
+	};
+
+	/***********************************************************
+	 *  Sizes of the generated meshes
+	 ***********************************************************/
+	constexpr size_t CapVertexCount(int segments) { return (size_t)segments + 1; }
+	constexpr size_t CapIndexCount(int segments) { return 3 * (size_t)segments; }
+	constexpr size_t SideVertexCount(int segments) { return 2 * ((size_t)segments + 1); }
+	constexpr size_t SideIndexCount(int segments, bool bPointedTop) { return (bPointedTop ? 3 : 6) * (size_t)segments; }
+
+	typedef MESH_DATA<24, 36> BOX_MESH;
+	typedef MESH_DATA<4, 6> PLANE_MESH;
+	typedef MESH_DATA<18, 24> PRISM_MESH;
+	typedef MESH_DATA<12, 12> PYRAMID3_MESH;
+	typedef MESH_DATA<16, 18> PYRAMID4_MESH;
+
+	template <int SEGMENTS>
+	using CONE_MESH = MESH_DATA<CapVertexCount(SEGMENTS) + SideVertexCount(SEGMENTS), CapIndexCount(SEGMENTS) + SideIndexCount(SEGMENTS, true)>;
+	template <int SEGMENTS>
+	using CYLINDER_MESH = MESH_DATA<2 * CapVertexCount(SEGMENTS) + SideVertexCount(SEGMENTS), 2 * CapIndexCount(SEGMENTS) + SideIndexCount(SEGMENTS, false)>;
+	template <int RINGS, int SEGMENTS>
+	using SPHERE_MESH = MESH_DATA<((size_t)RINGS + 1) * ((size_t)SEGMENTS + 1), 6 * (size_t)SEGMENTS * ((size_t)RINGS - 1)>;
+	template <int MAIN_SEGMENTS, int TUBE_SEGMENTS>
+	using TORUS_MESH = MESH_DATA<((size_t)MAIN_SEGMENTS + 1) * ((size_t)TUBE_SEGMENTS + 1), 6 * (size_t)MAIN_SEGMENTS * (size_t)TUBE_SEGMENTS>;
+
+	/***********************************************************
+	 *  GenerateBox()
+	 *
+	 *  A unit cube around the origin, each face textured from
+	 *  0 to 1 as seen from outside of it.
+	 ***********************************************************/
+	constexpr BOX_MESH GenerateBox()
+	{
+		BOX_MESH mesh{};
+		MESH_BUILDER<BOX_MESH> builder(mesh);
+
+		// the center of each face and the directions the
+		// texture coordinates grow in, as seen from outside
+		const VECTOR3 faces[6][3] = {
+			{ { 0.0, 0.0, -0.5 }, { -1.0, 0.0, 0.0 }, { 0.0, 1.0, 0.0 } },	// back
+			{ { 0.0, -0.5, 0.0 }, { 1.0, 0.0, 0.0 }, { 0.0, 0.0, 1.0 } },	// bottom
+			{ { -0.5, 0.0, 0.0 }, { 0.0, 0.0, 1.0 }, { 0.0, 1.0, 0.0 } },	// left
+			{ { 0.5, 0.0, 0.0 }, { 0.0, 0.0, -1.0 }, { 0.0, 1.0, 0.0 } },	// right
+			{ { 0.0, 0.5, 0.0 }, { 1.0, 0.0, 0.0 }, { 0.0, 0.0, -1.0 } },	// top
+			{ { 0.0, 0.0, 0.5 }, { 1.0, 0.0, 0.0 }, { 0.0, 1.0, 0.0 } } };	// front
+		const double uvs[4][2] = { { 0.0, 0.0 }, { 1.0, 0.0 }, { 1.0, 1.0 }, { 0.0, 1.0 } };
+		for (const auto& face : faces)
+		{
+			VECTOR3 corners[4] = {};
+			for (int i = 0; i < 4; i++)
+			{
+				VECTOR3 u = Scale(face[1], uvs[i][0] - 0.5);
+				VECTOR3 v = Scale(face[2], uvs[i][1] - 0.5);
+				corners[i] = VECTOR3{ face[0].x + u.x + v.x, face[0].y + u.y + v.y, face[0].z + u.z + v.z };
+			}
+			builder.AddFlatFace(corners, uvs, 4, VECTOR3{ 0.0, 0.0, 0.0 });
+		}
+		return mesh;
+	}
+
+	/***********************************************************
+	 *  GeneratePlane()
+	 *
+	 *  A 2 by 2 square in the XZ plane, facing up.
+	 ***********************************************************/
+	constexpr PLANE_MESH GeneratePlane()
+	{
+		PLANE_MESH mesh{};
+		MESH_BUILDER<PLANE_MESH> builder(mesh);
+
+		const VECTOR3 corners[4] = { { -1.0, 0.0, 1.0 }, { 1.0, 0.0, 1.0 }, { 1.0, 0.0, -1.0 }, { -1.0, 0.0, -1.0 } };
+		const double uvs[4][2] = { { 0.0, 0.0 }, { 1.0, 0.0 }, { 1.0, 1.0 }, { 0.0, 1.0 } };
+		builder.AddFlatFace(corners, uvs, 4, VECTOR3{ 0.0, -1.0, 0.0 });
+		return mesh;
+	}
+
+	/***********************************************************
+	 *  GeneratePrism()
+	 *
+	 *  A triangular prism of unit height around the origin,
+	 *  with its point towards positive Z.
+	 ***********************************************************/
+	constexpr PRISM_MESH GeneratePrism()
+	{
+		PRISM_MESH mesh{};
+		MESH_BUILDER<PRISM_MESH> builder(mesh);
+
+		const VECTOR3 inside{ 0.0, 0.0, -0.1 };
+		const double quadUVs[4][2] = { { 0.0, 0.0 }, { 1.0, 0.0 }, { 1.0, 1.0 }, { 0.0, 1.0 } };
+		const double triangleUVs[3][2] = { { 0.0, 0.0 }, { 1.0, 0.0 }, { 0.5, 1.0 } };
+
+		const VECTOR3 back[4] = { { 0.5, -0.5, -0.5 }, { -0.5, -0.5, -0.5 }, { -0.5, 0.5, -0.5 }, { 0.5, 0.5, -0.5 } };
+		const VECTOR3 left[4] = { { -0.5, -0.5, -0.5 }, { 0.0, -0.5, 0.5 }, { 0.0, 0.5, 0.5 }, { -0.5, 0.5, -0.5 } };
+		const VECTOR3 right[4] = { { 0.0, -0.5, 0.5 }, { 0.5, -0.5, -0.5 }, { 0.5, 0.5, -0.5 }, { 0.0, 0.5, 0.5 } };
+		const VECTOR3 bottom[3] = { { 0.5, -0.5, -0.5 }, { -0.5, -0.5, -0.5 }, { 0.0, -0.5, 0.5 } };
+		const VECTOR3 top[3] = { { 0.5, 0.5, -0.5 }, { -0.5, 0.5, -0.5 }, { 0.0, 0.5, 0.5 } };
+		builder.AddFlatFace(back, quadUVs, 4, inside);
+		builder.AddFlatFace(bottom, triangleUVs, 3, inside);
+		builder.AddFlatFace(left, quadUVs, 4, inside);
+		builder.AddFlatFace(right, quadUVs, 4, inside);
+		builder.AddFlatFace(top, triangleUVs, 3, inside);
+		return mesh;
+	}
+
+	/***********************************************************
+	 *  GeneratePyramid3()
+	 *
+	 *  A pyramid of unit height around the origin on a
+	 *  triangle, with its point towards negative Z.
+	 ***********************************************************/
+	constexpr PYRAMID3_MESH GeneratePyramid3()
+	{
+		PYRAMID3_MESH mesh{};
+		MESH_BUILDER<PYRAMID3_MESH> builder(mesh);
+
+		const VECTOR3 inside{ 0.0, -0.25, 0.1 };
+		const VECTOR3 top{ 0.0, 0.5, 0.0 };
+		const VECTOR3 backCenter{ 0.0, -0.5, -0.5 };
+		const VECTOR3 frontLeft{ -0.5, -0.5, 0.5 };
+		const VECTOR3 frontRight{ 0.5, -0.5, 0.5 };
+		const double sideUVs[3][2] = { { 0.0, 0.0 }, { 1.0, 0.0 }, { 0.5, 1.0 } };
+		const double bottomUVs[3][2] = { { 0.0, 1.0 }, { 1.0, 1.0 }, { 0.5, 0.0 } };
+
+		const VECTOR3 left[3] = { backCenter, frontLeft, top };
+		const VECTOR3 right[3] = { frontRight, backCenter, top };
+		const VECTOR3 front[3] = { frontLeft, frontRight, top };
+		const VECTOR3 bottom[3] = { frontLeft, frontRight, backCenter };
+		builder.AddFlatFace(left, sideUVs, 3, inside);
+		builder.AddFlatFace(right, sideUVs, 3, inside);
+		builder.AddFlatFace(front, sideUVs, 3, inside);
+		builder.AddFlatFace(bottom, bottomUVs, 3, inside);
+		return mesh;
+	}
+
+	/***********************************************************
+	 *  GeneratePyramid4()
+	 *
+	 *  A pyramid of unit height around the origin on a unit
+	 *  square.
+	 ***********************************************************/
+	constexpr PYRAMID4_MESH GeneratePyramid4()
+	{
+		PYRAMID4_MESH mesh{};
+		MESH_BUILDER<PYRAMID4_MESH> builder(mesh);
+
+		const VECTOR3 inside{ 0.0, -0.25, 0.0 };
+		const VECTOR3 top{ 0.0, 0.5, 0.0 };
+		const VECTOR3 backLeft{ -0.5, -0.5, -0.5 };
+		const VECTOR3 backRight{ 0.5, -0.5, -0.5 };
+		const VECTOR3 frontLeft{ -0.5, -0.5, 0.5 };
+		const VECTOR3 frontRight{ 0.5, -0.5, 0.5 };
+		const double sideUVs[3][2] = { { 0.0, 0.0 }, { 1.0, 0.0 }, { 0.5, 1.0 } };
+		const double bottomUVs[4][2] = { { 0.0, 1.0 }, { 0.0, 0.0 }, { 1.0, 0.0 }, { 1.0, 1.0 } };
+
+		const VECTOR3 bottom[4] = { frontLeft, backLeft, backRight, frontRight };
+		const VECTOR3 back[3] = { backRight, backLeft, top };
+		const VECTOR3 left[3] = { backLeft, frontLeft, top };
+		const VECTOR3 right[3] = { frontRight, backRight, top };
+		const VECTOR3 front[3] = { frontLeft, frontRight, top };
+		builder.AddFlatFace(bottom, bottomUVs, 4, inside);
+		builder.AddFlatFace(back, sideUVs, 3, inside);
+		builder.AddFlatFace(left, sideUVs, 3, inside);
+		builder.AddFlatFace(right, sideUVs, 3, inside);
+		builder.AddFlatFace(front, sideUVs, 3, inside);
+		return mesh;
+	}
+
+	/***********************************************************
+	 *  GenerateCone()
+	 *
+	 *  A cone of unit radius and height standing on the
+	 *  origin.  The bottom comes first in the indices,
+	 *  followed by the side.
+	 ***********************************************************/
+	template <int SEGMENTS>
+	constexpr CONE_MESH<SEGMENTS> GenerateCone()
+	{
+		CONE_MESH<SEGMENTS> mesh{};
+		MESH_BUILDER<CONE_MESH<SEGMENTS>> builder(mesh);
+
+		builder.AddCap(SEGMENTS, 0.0, 1.0, false);
+		builder.AddSide(SEGMENTS, 1.0, 0.0);
+		return mesh;
+	}
+
+	/***********************************************************
+	 *  GenerateCylinder()
+	 *
+	 *  A cylinder of unit height standing on the origin, with
+	 *  a bottom radius of 1.  The indices hold the bottom, the
+	 *  top and the side, in that order.
+	 ***********************************************************/
+	template <int SEGMENTS>
+	constexpr CYLINDER_MESH<SEGMENTS> GenerateCylinder(double topRadius = 1.0)
+	{
+		CYLINDER_MESH<SEGMENTS> mesh{};
+		MESH_BUILDER<CYLINDER_MESH<SEGMENTS>> builder(mesh);
+
+		builder.AddCap(SEGMENTS, 0.0, 1.0, false);
+		builder.AddCap(SEGMENTS, 1.0, topRadius, true);
+		builder.AddSide(SEGMENTS, 1.0, topRadius);
+		return mesh;
+	}
+
+	/***********************************************************
+	 *  GenerateSphere()
+	 *
+	 *  A unit sphere around the origin, in rings from the top
+	 *  down, so that the first half of the indices is the top
+	 *  half when the rings are even.
+	 ***********************************************************/
+	template <int RINGS, int SEGMENTS>
+	constexpr SPHERE_MESH<RINGS, SEGMENTS> GenerateSphere()
+	{
+		static_assert(RINGS >= 2, "a sphere needs at least two rings");
+		SPHERE_MESH<RINGS, SEGMENTS> mesh{};
+		MESH_BUILDER<SPHERE_MESH<RINGS, SEGMENTS>> builder(mesh);
+
+		double segmentCosines[SEGMENTS + 1] = {};
+		double segmentSines[SEGMENTS + 1] = {};
+		for (int j = 0; j <= SEGMENTS; j++)
+		{
+			segmentCosines[j] = Cosine(2.0 * PI * j / SEGMENTS);
+			segmentSines[j] = Sine(2.0 * PI * j / SEGMENTS);
+		}
+		for (int i = 0; i <= RINGS; i++)
+		{
+			double y = Cosine(PI * i / RINGS);
+			double radius = Sine(PI * i / RINGS);
+			for (int j = 0; j <= SEGMENTS; j++)
+			{
+				VECTOR3 position{ radius * segmentCosines[j], y, -radius * segmentSines[j] };
+				builder.AddVertex(position, position, (double)j / SEGMENTS, 1.0 - (double)i / RINGS);
+			}
+		}
+
+		const unsigned int ringVertices = SEGMENTS + 1;
+		for (int i = 0; i < RINGS; i++)
+		{
+			for (int j = 0; j < SEGMENTS; j++)
+			{
+				unsigned int upper = i * ringVertices + j;
+				unsigned int lower = upper + ringVertices;
+				// the rings next to the poles have one triangle per
+				// segment, as their other triangle has no area
+				if (i > 0)
+				{
+					builder.AddTriangle(upper, lower, upper + 1);
+				}
+				if (i + 1 < RINGS)
+				{
+					builder.AddTriangle(upper + 1, lower, lower + 1);
+				}
+			}
+		}
+		return mesh;
+	}
+
+	/***********************************************************
+	 *  GenerateTorus()
+	 *
+	 *  A torus of main radius 1 around the Z axis, in segments
+	 *  around the main circle, so that the first half of the
+	 *  indices is the half above the X axis when the main
+	 *  segments are even.
+	 ***********************************************************/
+	template <int MAIN_SEGMENTS, int TUBE_SEGMENTS>
+	constexpr TORUS_MESH<MAIN_SEGMENTS, TUBE_SEGMENTS> GenerateTorus(double tubeRadius)
+	{
+		TORUS_MESH<MAIN_SEGMENTS, TUBE_SEGMENTS> mesh{};
+		MESH_BUILDER<TORUS_MESH<MAIN_SEGMENTS, TUBE_SEGMENTS>> builder(mesh);
+
+		double tubeCosines[TUBE_SEGMENTS + 1] = {};
+		double tubeSines[TUBE_SEGMENTS + 1] = {};
+		for (int j = 0; j <= TUBE_SEGMENTS; j++)
+		{
+			tubeCosines[j] = Cosine(2.0 * PI * j / TUBE_SEGMENTS);
+			tubeSines[j] = Sine(2.0 * PI * j / TUBE_SEGMENTS);
+		}
+		for (int i = 0; i <= MAIN_SEGMENTS; i++)
+		{
+			double mainCosine = Cosine(2.0 * PI * i / MAIN_SEGMENTS);
+			double mainSine = Sine(2.0 * PI * i / MAIN_SEGMENTS);
+			for (int j = 0; j <= TUBE_SEGMENTS; j++)
+			{
+				VECTOR3 normal{ tubeCosines[j] * mainCosine, tubeCosines[j] * mainSine, tubeSines[j] };
+				double ringRadius = 1.0 + tubeRadius * tubeCosines[j];
+				VECTOR3 position{ ringRadius * mainCosine, ringRadius * mainSine, tubeRadius * tubeSines[j] };
+				builder.AddVertex(position, normal, (double)i / MAIN_SEGMENTS, (double)j / TUBE_SEGMENTS);
+			}
+		}
+
+		const unsigned int ringVertices = TUBE_SEGMENTS + 1;
+		for (int i = 0; i < MAIN_SEGMENTS; i++)
+		{
+			for (int j = 0; j < TUBE_SEGMENTS; j++)
+			{
+				unsigned int current = i * ringVertices + j;
+				unsigned int next = current + ringVertices;
+				builder.AddTriangle(current, next, next + 1);
+				builder.AddTriangle(current, next + 1, current + 1);
+			}
+		}
+		return mesh;
+	}
+}
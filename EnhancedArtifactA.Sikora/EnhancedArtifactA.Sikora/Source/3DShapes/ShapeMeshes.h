@@ -14,6 +14,10 @@
 
 #include <glm/glm.hpp>
 
+#include "GLResources.h"
+
+#include <vector>
+
 /***********************************************************
  *  ShapeMeshes
  *
@@ -23,8 +27,36 @@
 class ShapeMeshes
 {
 public:
-	// constructor
-	ShapeMeshes();
+	// constructor - without GL buffers only the CPU copy of
+	// the meshes is kept, which needs no OpenGL context
+	ShapeMeshes(bool bCreateGLBuffers = true);
+
+	// identifies one of the drawable shapes, so draws can be
+	// recorded ahead of time and issued later
+	enum MESH_TYPE
+	{
+		MESH_BOX,
+		MESH_CONE,
+		MESH_CYLINDER,
+		MESH_PLANE,
+		MESH_PRISM,
+		MESH_PYRAMID3,
+		MESH_PYRAMID4,
+		MESH_SPHERE,
+		MESH_HALF_SPHERE,
+		MESH_TAPERED_CYLINDER,
+		MESH_TORUS,
+		MESH_HALF_TORUS,
+		MESH_TYPE_COUNT
+	};
+
+	// every mesh vertex is a position, a normal and a
+	// texture coordinate
+	static const GLuint FLOATS_PER_MESH_VERTEX = 8;
+	// the attributes of a mesh vertex as the shaders read them,
+	// for vertex arrays over merged copies of the meshes
+	static const int MESH_ATTRIBUTE_COUNT = 3;
+	static const VERTEX_ATTRIBUTE MESH_ATTRIBUTES[MESH_ATTRIBUTE_COUNT];
 
 private:
 
@@ -49,7 +81,21 @@ private:
 	GLMesh m_TaperedCylinderMesh;
 	GLMesh m_TorusMesh;
 
-	bool m_bMemoryLayoutDone;
+	bool m_bCreateGLBuffers;
+
+	// CPU copy of a loaded mesh as a triangle list
+	struct MESH_GEOMETRY
+	{
+		std::vector<GLfloat> vertices;	// interleaved vertex data
+		std::vector<GLuint> indices;	// three per triangle
+	};
+	MESH_GEOMETRY m_Geometry[MESH_TYPE_COUNT];
+
+	// method for keeping the CPU copy of a mesh
+	void StoreIndexedGeometry(MESH_TYPE mesh, const GLfloat* vertices, GLuint nVertices, const GLuint* indices, GLuint nIndices);
+	// keep the CPU copy of a generated mesh and create its
+	// GL buffers
+	void UploadMesh(GLMesh& glMesh, MESH_TYPE mesh, const GLfloat* vertices, GLuint nVertices, const GLuint* indices, GLuint nIndices);
 
 public:
 	// methods for loading the shape mesh data 
@@ -87,15 +133,14 @@ public:
 	void DrawTorusMesh();
 	void DrawHalfTorusMesh();
 
+	// draw the passed in shape with its default options
+	void DrawMesh(MESH_TYPE mesh);
 
-private:
-
-	// called to calculate the normal for 
-	// the passed in coordinates
-	glm::vec3 CalculateTriangleNormal(
-		glm::vec3 px, glm::vec3 py, glm::vec3 pz);
+	// get the triangles of a loaded shape, for example for
+	// merging it into a static batch
+	bool GetMeshGeometry(
+		MESH_TYPE mesh,
+		std::vector<GLfloat>& vertices,
+		std::vector<GLuint>& indices) const;
 
-	// called to set the memory layout 
-	// template for shader data
-	void SetShaderMemoryLayout();
 };
\ No newline at end of file
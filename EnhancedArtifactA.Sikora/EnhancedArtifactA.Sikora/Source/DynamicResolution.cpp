@@ -0,0 +1,310 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicresolution.cpp
+// ============
+// render the 3D scene into an offscreen target whose resolution follows
+// the measured GPU frame time, then upscale it to the display window
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DynamicResolution.h"
+#include "GLDebug.h"
+#include "GLResources.h"
+#include "GpuMemory.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// default GPU time budget - a little under one 60Hz frame
+	const float DEFAULT_FRAME_BUDGET = 14.0f;
+	// default limits for the resolution scale
+	const float DEFAULT_MIN_SCALE = 0.5f;
+	const float DEFAULT_MAX_SCALE = 1.0f;
+	// the scale is only changed when the frame time leaves this
+	// band around the budget, to keep it from oscillating
+	const float SCALE_HYSTERESIS = 0.05f;
+	// fraction of each correction applied per frame
+	const float SCALE_SMOOTHING = 0.25f;
+}
+
+/***********************************************************
+ *  DynamicResolution()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DynamicResolution::DynamicResolution()
+{
+	m_framebuffer = 0;
+	m_colorTexture = 0;
+	m_depthRenderbuffer = 0;
+	m_framebufferWidth = 0;
+	m_framebufferHeight = 0;
+	m_renderWidth = 0;
+	m_renderHeight = 0;
+	m_frameIndex = 0;
+	m_resolutionScale = DEFAULT_MAX_SCALE;
+	m_minScale = DEFAULT_MIN_SCALE;
+	m_maxScale = DEFAULT_MAX_SCALE;
+	m_frameBudget = DEFAULT_FRAME_BUDGET;
+	m_gpuFrameTime = 0.0f;
+
+	for (int i = 0; i < TIMER_QUERY_COUNT; i++)
+	{
+		m_timerQueries[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  ~DynamicResolution()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DynamicResolution::~DynamicResolution()
+{
+	DestroyRenderTarget();
+
+	if (m_timerQueries[0] != 0)
+	{
+		glDeleteQueries(TIMER_QUERY_COUNT, m_timerQueries);
+	}
+}
+
+/***********************************************************
+ *  CreateRenderTarget()
+ *
+ *  This method is used for creating the offscreen color
+ *  and depth target at the full framebuffer size.
+ ***********************************************************/
+bool DynamicResolution::CreateRenderTarget(int framebufferWidth, int framebufferHeight)
+{
+	DestroyRenderTarget();
+
+	m_framebufferWidth = framebufferWidth;
+	m_framebufferHeight = framebufferHeight;
+
+	// a minimized window has no framebuffer to render into
+	if ((framebufferWidth <= 0) || (framebufferHeight <= 0))
+	{
+		return false;
+	}
+
+	// the timer queries only need to be created once
+	if (m_timerQueries[0] == 0)
+	{
+		glGenQueries(TIMER_QUERY_COUNT, m_timerQueries);
+	}
+
+	// color attachment - sampled with linear filtering when upscaling
+	m_colorTexture = GLResources::CreateTexture2D(
+		framebufferWidth, framebufferHeight, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, NULL,
+		GL_CLAMP_TO_EDGE, GL_LINEAR, GL_LINEAR, false, TEXTURE_IMMUTABLE, "scaled target color");
+
+	// depth attachment - never sampled, so a renderbuffer is enough
+	glGenRenderbuffers(1, &m_depthRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, framebufferWidth, framebufferHeight);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthRenderbuffer);
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	GLDebug::LabelObject(GL_RENDERBUFFER, m_depthRenderbuffer, "scaled target depth");
+	GLDebug::LabelObject(GL_FRAMEBUFFER, m_framebuffer, "scaled target");
+	GpuMemory::TrackObject(GL_TEXTURE, m_colorTexture, GPU_MEMORY_RENDER_TARGETS, "scaled target",
+		GpuMemory::GetTextureBytes(framebufferWidth, framebufferHeight, GL_RGBA8, 1));
+	GpuMemory::TrackObject(GL_RENDERBUFFER, m_depthRenderbuffer, GPU_MEMORY_RENDER_TARGETS, "scaled target",
+		GpuMemory::GetTextureBytes(framebufferWidth, framebufferHeight, GL_DEPTH_COMPONENT24, 1));
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Offscreen render target is incomplete, status:" << status << std::endl;
+		DestroyRenderTarget();
+		return false;
+	}
+
+	return true;
+}
+
+/***********************************************************
+ *  ResizeRenderTarget()
+ *
+ *  This method is used for recreating the offscreen target
+ *  whenever the display framebuffer changes size.
+ ***********************************************************/
+void DynamicResolution::ResizeRenderTarget(int framebufferWidth, int framebufferHeight)
+{
+	if ((framebufferWidth == m_framebufferWidth) &&
+		(framebufferHeight == m_framebufferHeight) &&
+		(m_framebuffer != 0))
+	{
+		return;
+	}
+
+	CreateRenderTarget(framebufferWidth, framebufferHeight);
+}
+
+/***********************************************************
+ *  DestroyRenderTarget()
+ *
+ *  This method is used for freeing the offscreen target.
+ ***********************************************************/
+void DynamicResolution::DestroyRenderTarget()
+{
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	if (m_colorTexture != 0)
+	{
+		GpuMemory::ReleaseObject(GL_TEXTURE, m_colorTexture);
+		glDeleteTextures(1, &m_colorTexture);
+		m_colorTexture = 0;
+	}
+	if (m_depthRenderbuffer != 0)
+	{
+		GpuMemory::ReleaseObject(GL_RENDERBUFFER, m_depthRenderbuffer);
+		glDeleteRenderbuffers(1, &m_depthRenderbuffer);
+		m_depthRenderbuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  SetFrameBudget()
+ *
+ *  This method is used for setting the GPU time the scene
+ *  is allowed to take each frame.
+ ***********************************************************/
+void DynamicResolution::SetFrameBudget(float budgetMilliseconds)
+{
+	if (budgetMilliseconds > 0.0f)
+	{
+		m_frameBudget = budgetMilliseconds;
+	}
+}
+
+/***********************************************************
+ *  SetScaleLimits()
+ *
+ *  This method is used for setting the lowest and highest
+ *  resolution scale the controller may choose.
+ ***********************************************************/
+void DynamicResolution::SetScaleLimits(float minScale, float maxScale)
+{
+	if ((minScale > 0.0f) && (minScale <= maxScale) && (maxScale <= 1.0f))
+	{
+		m_minScale = minScale;
+		m_maxScale = maxScale;
+		m_resolutionScale = std::min(std::max(m_resolutionScale, m_minScale), m_maxScale);
+	}
+}
+
+/***********************************************************
+ *  UpdateResolutionScale()
+ *
+ *  This method is used for reading back the oldest timer
+ *  query and moving the resolution scale toward the value
+ *  that fits the frame time inside the budget.  The GPU
+ *  cost of the scene is roughly proportional to the number
+ *  of pixels, so the correction uses the square root of the
+ *  budget ratio for each axis.
+ ***********************************************************/
+void DynamicResolution::UpdateResolutionScale()
+{
+	// the query that is about to be reused was issued
+	// TIMER_QUERY_COUNT frames ago
+	if (m_frameIndex < TIMER_QUERY_COUNT)
+	{
+		return;
+	}
+
+	GLuint query = m_timerQueries[m_frameIndex % TIMER_QUERY_COUNT];
+	GLint available = 0;
+	glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available == 0)
+	{
+		return;
+	}
+
+	GLuint64 elapsedNanoseconds = 0;
+	glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsedNanoseconds);
+	m_gpuFrameTime = (float)(elapsedNanoseconds / 1000000.0);
+
+	if (m_gpuFrameTime <= 0.0f)
+	{
+		return;
+	}
+
+	float ratio = m_frameBudget / m_gpuFrameTime;
+	if ((ratio > 1.0f - SCALE_HYSTERESIS) && (ratio < 1.0f + SCALE_HYSTERESIS))
+	{
+		return;
+	}
+
+	float targetScale = m_resolutionScale * std::sqrt(ratio);
+	m_resolutionScale += (targetScale - m_resolutionScale) * SCALE_SMOOTHING;
+	m_resolutionScale = std::min(std::max(m_resolutionScale, m_minScale), m_maxScale);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for binding the offscreen target,
+ *  setting the viewport to the scaled render region and
+ *  starting the GPU timer for the frame.
+ ***********************************************************/
+void DynamicResolution::BeginFrame()
+{
+	if (m_framebuffer == 0)
+	{
+		return;
+	}
+
+	UpdateResolutionScale();
+
+	m_renderWidth = std::max(1, (int)(m_framebufferWidth * m_resolutionScale));
+	m_renderHeight = std::max(1, (int)(m_framebufferHeight * m_resolutionScale));
+
+	glBeginQuery(GL_TIME_ELAPSED, m_timerQueries[m_frameIndex % TIMER_QUERY_COUNT]);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, m_renderWidth, m_renderHeight);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for stopping the GPU timer and
+ *  upscaling the rendered region to the whole default
+ *  framebuffer with linear filtering.
+ ***********************************************************/
+void DynamicResolution::EndFrame()
+{
+	if (m_framebuffer == 0)
+	{
+		return;
+	}
+
+	glEndQuery(GL_TIME_ELAPSED);
+	m_frameIndex++;
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(
+		0, 0, m_renderWidth, m_renderHeight,
+		0, 0, m_framebufferWidth, m_framebufferHeight,
+		GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, m_framebufferWidth, m_framebufferHeight);
+}
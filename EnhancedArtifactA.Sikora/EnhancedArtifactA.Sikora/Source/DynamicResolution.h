@@ -0,0 +1,83 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicresolution.h
+// ============
+// render the 3D scene into an offscreen target whose resolution follows
+// the measured GPU frame time, then upscale it to the display window
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  DynamicResolution
+ *
+ *  This class owns the offscreen color and depth target
+ *  the scene is drawn into.  The target is allocated at the
+ *  full framebuffer size and only a scaled region of it is
+ *  rendered, so changing the scale never reallocates memory.
+ ***********************************************************/
+class DynamicResolution
+{
+public:
+	// constructor
+	DynamicResolution();
+	// destructor
+	~DynamicResolution();
+
+	// create the offscreen target for the passed in framebuffer size
+	bool CreateRenderTarget(int framebufferWidth, int framebufferHeight);
+	// recreate the offscreen target when the framebuffer size changes
+	void ResizeRenderTarget(int framebufferWidth, int framebufferHeight);
+
+	// bind the offscreen target at the current scale
+	void BeginFrame();
+	// upscale the rendered region into the default framebuffer
+	void EndFrame();
+
+	// set the GPU time budget for one frame, in milliseconds
+	void SetFrameBudget(float budgetMilliseconds);
+	// set the range the resolution scale is allowed to move in
+	void SetScaleLimits(float minScale, float maxScale);
+
+	// current resolution scale applied to both axes
+	float GetResolutionScale() const { return m_resolutionScale; }
+	// most recent measured GPU frame time, in milliseconds
+	float GetGPUFrameTime() const { return m_gpuFrameTime; }
+
+private:
+	// number of timer queries in flight, so results are read
+	// back a few frames late instead of stalling the pipeline
+	static const int TIMER_QUERY_COUNT = 4;
+
+	// offscreen framebuffer and its attachments
+	GLuint m_framebuffer;
+	GLuint m_colorTexture;
+	GLuint m_depthRenderbuffer;
+
+	// full size of the display framebuffer
+	int m_framebufferWidth;
+	int m_framebufferHeight;
+	// size of the region rendered in the current frame
+	int m_renderWidth;
+	int m_renderHeight;
+
+	// GPU timer queries used to measure the frame time
+	GLuint m_timerQueries[TIMER_QUERY_COUNT];
+	int m_frameIndex;
+
+	// resolution scale controller state
+	float m_resolutionScale;
+	float m_minScale;
+	float m_maxScale;
+	float m_frameBudget;
+	float m_gpuFrameTime;
+
+	// free the offscreen target
+	void DestroyRenderTarget();
+	// read back finished timer queries and adjust the scale
+	void UpdateResolutionScale();
+};
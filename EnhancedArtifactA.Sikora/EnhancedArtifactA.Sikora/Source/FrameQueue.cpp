@@ -0,0 +1,179 @@
+///////////////////////////////////////////////////////////////////////////////
+// framequeue.cpp
+// ============
+// hand recorded frame descriptions from the main thread to the render
+// thread through a double-buffered queue
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameQueue.h"
+
+/***********************************************************
+ *  FRAME_DATA()
+ *
+ *  The constructor for the frame data - the lists take
+ *  their memory from the frame's arena.
+ ***********************************************************/
+FRAME_DATA::FRAME_DATA()
+	: view(1.0f),
+	projection(1.0f),
+	viewPosition(0.0f),
+	framebufferWidth(0),
+	framebufferHeight(0),
+	frameSeconds(0.0f),
+	m_lastPacketCount(0)
+{
+	drawPackets.Reset(&arena, 0);
+	sortKeys.Reset(&arena, 0);
+	staticBatchVisibility.Reset(&arena, 0);
+	vegetationInstances.Reset(&arena, 0);
+	vegetationRanges.Reset(&arena, 0);
+	vegetationImpostors.Reset(&arena, 0);
+	terrainNodes.Reset(&arena, 0);
+	textureLevels.Reset(&arena, 0);
+}
+
+/***********************************************************
+ *  ResetTransientData()
+ *
+ *  This method is used for dropping the lists of the
+ *  previous frame and resetting the arena.  The lists are
+ *  sized for the largest frame so far, so recording does
+ *  not have to grow them.
+ ***********************************************************/
+void FRAME_DATA::ResetTransientData()
+{
+	if (drawPackets.size() > m_lastPacketCount)
+	{
+		m_lastPacketCount = drawPackets.size();
+	}
+
+	arena.Reset();
+	drawPackets.Reset(&arena, m_lastPacketCount);
+	sortKeys.Reset(&arena, m_lastPacketCount);
+	staticBatchVisibility.Reset(&arena, 0);
+	vegetationInstances.Reset(&arena, 0);
+	vegetationRanges.Reset(&arena, 0);
+	vegetationImpostors.Reset(&arena, 0);
+	terrainNodes.Reset(&arena, 0);
+	textureLevels.Reset(&arena, 0);
+}
+
+/***********************************************************
+ *  FrameQueue()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameQueue::FrameQueue()
+{
+	m_writeIndex = 0;
+	m_readIndex = 0;
+	m_readyCount = 0;
+	m_bReading = false;
+	m_bShutdown = false;
+}
+
+/***********************************************************
+ *  BeginWrite()
+ *
+ *  This method is used for getting the buffer the next
+ *  frame is recorded into.  It waits while every buffer is
+ *  either waiting to be read or being read.
+ ***********************************************************/
+FRAME_DATA* FrameQueue::BeginWrite()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	m_frameFree.wait(lock, [this]
+		{
+			int busyCount = m_readyCount + (m_bReading ? 1 : 0);
+			return (m_bShutdown || (busyCount < FRAME_BUFFER_COUNT));
+		});
+
+	if (m_bShutdown)
+	{
+		return NULL;
+	}
+
+	FRAME_DATA* frame = &m_frames[m_writeIndex];
+	frame->ResetTransientData();
+
+	return frame;
+}
+
+/***********************************************************
+ *  EndWrite()
+ *
+ *  This method is used for publishing the recorded frame.
+ ***********************************************************/
+void FrameQueue::EndWrite()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_writeIndex = (m_writeIndex + 1) % FRAME_BUFFER_COUNT;
+		m_readyCount++;
+	}
+	m_frameReady.notify_one();
+}
+
+/***********************************************************
+ *  BeginRead()
+ *
+ *  This method is used for waiting on the next recorded
+ *  frame.  Frames that are still queued when the queue is
+ *  shut down are not returned.
+ ***********************************************************/
+const FRAME_DATA* FrameQueue::BeginRead()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	m_frameReady.wait(lock, [this]
+		{
+			return (m_bShutdown || (m_readyCount > 0));
+		});
+
+	if (m_bShutdown)
+	{
+		return NULL;
+	}
+
+	// the frame leaves the ready count while it is read, so
+	// it is only counted once by BeginWrite()
+	m_readyCount--;
+	m_bReading = true;
+	return &m_frames[m_readIndex];
+}
+
+/***********************************************************
+ *  EndRead()
+ *
+ *  This method is used for handing the submitted frame
+ *  buffer back to the main thread.
+ ***********************************************************/
+void FrameQueue::EndRead()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_readIndex = (m_readIndex + 1) % FRAME_BUFFER_COUNT;
+		m_bReading = false;
+	}
+	m_frameFree.notify_one();
+}
+
+/***********************************************************
+ *  Shutdown()
+ *
+ *  This method is used for releasing both threads when the
+ *  application is closing.
+ ***********************************************************/
+void FrameQueue::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bShutdown = true;
+	}
+	m_frameReady.notify_all();
+	m_frameFree.notify_all();
+}
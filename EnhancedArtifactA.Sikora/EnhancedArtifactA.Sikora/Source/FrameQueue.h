@@ -0,0 +1,146 @@
+///////////////////////////////////////////////////////////////////////////////
+// framequeue.h
+// ============
+// hand recorded frame descriptions from the main thread to the render
+// thread through a double-buffered queue
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShapeMeshes.h"
+#include "FrameArena.h"
+#include "VegetationSystem.h"
+#include "TerrainSystem.h"
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <mutex>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  DRAW_PACKET
+ *
+ *  Everything the render thread needs to issue one draw
+ *  call, recorded on the main thread.
+ ***********************************************************/
+struct DRAW_PACKET
+{
+	glm::mat4 modelMatrix;
+	ShapeMeshes::MESH_TYPE mesh;
+	// texture slot to sample, or -1 to use the solid color
+	int textureSlot;
+	// index of the object material, or -1 when no material
+	// has been set yet
+	int materialIndex;
+	glm::vec4 color;
+	glm::vec2 UVscale;
+};
+
+/***********************************************************
+ *  FRAME_DATA
+ *
+ *  The complete description of one frame: the camera, the
+ *  recorded draw packets and the order to submit them in.
+ *  The packet and sort key lists live in the frame's own
+ *  arena, which is reset when the buffer is reused.
+ ***********************************************************/
+struct FRAME_DATA
+{
+	FRAME_DATA();
+
+	// release the transient data of the previous use of this
+	// buffer and prepare the lists for a new frame
+	void ResetTransientData();
+
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec3 viewPosition;
+	// size of the window framebuffer the frame is meant for
+	int framebufferWidth;
+	int framebufferHeight;
+	// time since the previous recorded frame, in seconds, for
+	// the effects that advance on the render thread
+	float frameSeconds;
+
+	// backing memory for the lists below - declared first so
+	// it is constructed before them and destroyed after them
+	FrameArena arena;
+	// draw packets in the order they were recorded
+	ArenaArray<DRAW_PACKET> drawPackets;
+	// one key per packet - the render state in the high bits
+	// and the packet index in the low 32 bits, sorted so that
+	// packets sharing a texture and material are submitted
+	// together
+	ArenaArray<uint64_t> sortKeys;
+	// one entry per static batch, zero when the batch is
+	// hidden by the occluders
+	ArenaArray<uint8_t> staticBatchVisibility;
+	// plants drawn with their geometry, kept together by
+	// species with one range per species, and the plants
+	// drawn as impostors
+	ArenaArray<VEGETATION_INSTANCE> vegetationInstances;
+	ArenaArray<VEGETATION_RANGE> vegetationRanges;
+	ArenaArray<VEGETATION_IMPOSTOR> vegetationImpostors;
+	// terrain chunks drawn with the shared grid
+	ArenaArray<TERRAIN_NODE> terrainNodes;
+	// finest mipmap level each streamed texture needs
+	ArenaArray<uint8_t> textureLevels;
+
+private:
+	// number of packets in the previous frame, used to size
+	// the lists up front so they do not grow while recording
+	size_t m_lastPacketCount;
+};
+
+/***********************************************************
+ *  FrameQueue
+ *
+ *  Two FRAME_DATA buffers shared by the main thread, which
+ *  records frame N+1, and the render thread, which submits
+ *  frame N.  The writer blocks while both buffers are in
+ *  use, so the main thread never runs more than one frame
+ *  ahead of the GPU submission.
+ ***********************************************************/
+class FrameQueue
+{
+public:
+	// constructor
+	FrameQueue();
+
+	// get a free buffer to record the next frame into, or
+	// NULL when the queue has been shut down
+	FRAME_DATA* BeginWrite();
+	// publish the recorded frame to the render thread
+	void EndWrite();
+
+	// wait for the next recorded frame, or NULL when the
+	// queue has been shut down and no frame is left
+	const FRAME_DATA* BeginRead();
+	// release the submitted frame so it can be recorded again
+	void EndRead();
+
+	// wake up both threads and stop handing out buffers
+	void Shutdown();
+
+private:
+	static const int FRAME_BUFFER_COUNT = 2;
+
+	FRAME_DATA m_frames[FRAME_BUFFER_COUNT];
+	// index of the next buffer to write and to read
+	int m_writeIndex;
+	int m_readIndex;
+	// number of recorded frames waiting to be read
+	int m_readyCount;
+	// true while the render thread holds a buffer
+	bool m_bReading;
+	bool m_bShutdown;
+
+	std::mutex m_mutex;
+	std::condition_variable m_frameReady;
+	std::condition_variable m_frameFree;
+};
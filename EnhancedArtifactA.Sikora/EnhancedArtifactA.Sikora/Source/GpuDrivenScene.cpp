@@ -0,0 +1,462 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpudrivenscene.cpp
+// ============
+// keep the static scene objects in GPU buffers and let a compute shader
+// cull them and write the draw commands that are issued indirectly
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuDrivenScene.h"
+#include "MeshProcessing.h"
+#include "GLResources.h"
+#include "GpuMemory.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// debug labels of the buffers, in the order of GPU_BUFFER
+	const char* const g_BufferLabels[] =
+	{
+		"gpu scene vertices", "gpu scene indices", "gpu scene models", "gpu scene textures", "gpu scene cull objects",
+		"gpu scene cull meshes", "gpu scene group offsets", "gpu scene draw counts", "gpu scene draw commands"
+	};
+
+	// how the buffers are written, in the order of GPU_BUFFER -
+	// the culling shader writes the counts and the commands
+	const BUFFER_USAGE g_BufferUsages[] =
+	{
+		BUFFER_STATIC, BUFFER_STATIC, BUFFER_STATIC, BUFFER_STATIC, BUFFER_STATIC,
+		BUFFER_STATIC, BUFFER_STATIC, BUFFER_GPU_WRITTEN, BUFFER_GPU_WRITTEN
+	};
+
+	// the model matrix takes four attribute locations, one per
+	// column, and advances once per instance
+	const VERTEX_ATTRIBUTE g_ModelAttributes[] =
+	{
+		{ 3, 4, 0 },
+		{ 4, 4, sizeof(glm::vec4) },
+		{ 5, 4, sizeof(glm::vec4) * 2 },
+		{ 6, 4, sizeof(glm::vec4) * 3 }
+	};
+
+	// the texture region and scale of every object, also one
+	// per instance, after the fade and terrain attributes
+	const VERTEX_ATTRIBUTE g_TextureAttributes[] =
+	{
+		{ 9, 4, 0 },
+		{ 10, 2, sizeof(glm::vec4) }
+	};
+}
+
+/***********************************************************
+ *  GROUP_KEY::operator<()
+ *
+ *  Orders group keys for the group lookup table.
+ ***********************************************************/
+bool GpuDrivenScene::GROUP_KEY::operator<(const GROUP_KEY& other) const
+{
+	if (textureUnit != other.textureUnit) return (textureUnit < other.textureUnit);
+	if (materialIndex != other.materialIndex) return (materialIndex < other.materialIndex);
+	for (int i = 0; i < 4; i++)
+	{
+		if (color[i] != other.color[i]) return (color[i] < other.color[i]);
+	}
+	return false;
+}
+
+/***********************************************************
+ *  GpuDrivenScene()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GpuDrivenScene::GpuDrivenScene(const ShapeMeshes* pMeshes, GLuint cullingProgram)
+	: m_meshSources(pMeshes)
+{
+	m_cullingProgram = cullingProgram;
+	m_frustumPlanesLocation = glGetUniformLocation(cullingProgram, "frustumPlanes");
+	m_viewPositionLocation = glGetUniformLocation(cullingProgram, "viewPosition");
+	m_objectCountLocation = glGetUniformLocation(cullingProgram, "objectCount");
+	m_vao = 0;
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		m_buffers[i] = 0;
+	}
+	m_bUploaded = false;
+
+	for (int i = 0; i < ShapeMeshes::MESH_TYPE_COUNT; i++)
+	{
+		m_lodMesh[i] = (ShapeMeshes::MESH_TYPE)i;
+		m_lodDistance[i] = 0.0f;
+		m_bHasLod[i] = false;
+	}
+}
+
+/***********************************************************
+ *  ~GpuDrivenScene()
+ *
+ *  The destructor for the class.  Clear() must have been
+ *  called while the OpenGL context was still current.
+ ***********************************************************/
+GpuDrivenScene::~GpuDrivenScene()
+{
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the context
+ *  has everything the GPU driven path needs.  Compute
+ *  shaders and shader storage buffers are core since 4.3,
+ *  multi-draws with a draw count buffer since 4.6.
+ ***********************************************************/
+bool GpuDrivenScene::IsSupported()
+{
+	return (GLEW_VERSION_4_6 != 0);
+}
+
+/***********************************************************
+ *  SetMeshLod()
+ *
+ *  This method is used for setting the coarser mesh that is
+ *  drawn instead of a mesh from the passed in distance to
+ *  the camera on.  Coarser meshes can have their own.
+ ***********************************************************/
+bool GpuDrivenScene::SetMeshLod(ShapeMeshes::MESH_TYPE mesh, ShapeMeshes::MESH_TYPE coarserMesh, float distance)
+{
+	if ((m_bUploaded == true) || (mesh == coarserMesh) || (nullptr == m_meshSources.GetMeshSource(coarserMesh)))
+	{
+		return(false);
+	}
+
+	m_lodMesh[mesh] = coarserMesh;
+	m_lodDistance[mesh] = distance;
+	m_bHasLod[mesh] = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  AddObject()
+ *
+ *  This method is used for adding an object to the draw
+ *  group of its shader state.  The object is drawn once
+ *  the scene has been uploaded.  Objects are grouped by the
+ *  texture unit, not the slot, since the region of the
+ *  texture and its scale are set per instance.
+ ***********************************************************/
+int GpuDrivenScene::AddObject(
+	ShapeMeshes::MESH_TYPE mesh,
+	const glm::mat4& modelMatrix,
+	int textureSlot,
+	int textureUnit,
+	const glm::vec4& textureRegion,
+	int materialIndex,
+	const glm::vec4& color,
+	const glm::vec2& UVscale,
+	float drawDistance)
+{
+	if ((m_bUploaded == true) || (nullptr == m_meshSources.GetMeshSource(mesh)))
+	{
+		return(-1);
+	}
+
+	GROUP_KEY key;
+	key.textureUnit = (textureSlot >= 0) ? textureUnit : -1;
+	key.materialIndex = materialIndex;
+	// the color is only used by untextured objects
+	key.color = (textureSlot >= 0) ? glm::vec4(1.0f) : color;
+
+	int groupIndex = 0;
+	std::map<GROUP_KEY, int>::iterator existing = m_groupLookup.find(key);
+	if (existing != m_groupLookup.end())
+	{
+		groupIndex = existing->second;
+	}
+	else
+	{
+		GPU_DRAW_GROUP group;
+		group.textureSlot = textureSlot;
+		group.materialIndex = key.materialIndex;
+		group.color = key.color;
+		group.firstCommand = 0;
+		group.objectCount = 0;
+
+		groupIndex = (int)m_groups.size();
+		m_groups.push_back(group);
+		m_groupLookup[key] = groupIndex;
+	}
+	m_groups[groupIndex].objectCount++;
+
+	SCENE_OBJECT_ENTRY object;
+	object.mesh = mesh;
+	object.modelMatrix = modelMatrix;
+	object.texture.region = textureRegion;
+	object.texture.UVscale = UVscale;
+	object.group = groupIndex;
+	object.drawDistance = drawDistance;
+
+	m_objects.push_back(object);
+
+	return((int)m_objects.size() - 1);
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used for building the GPU buffers: the
+ *  shared mesh buffers, the model matrices, the culling
+ *  data of the objects and meshes, and the draw command
+ *  ranges of the groups.
+ ***********************************************************/
+bool GpuDrivenScene::Upload()
+{
+	if ((m_bUploaded == true) || (m_objects.empty()))
+	{
+		return(false);
+	}
+
+	// pack every loaded mesh into the shared buffers
+	std::vector<GLfloat> vertices;
+	std::vector<GLuint> indices;
+	std::vector<CULL_MESH> meshes(ShapeMeshes::MESH_TYPE_COUNT);
+	std::vector<glm::vec4> meshSpheres(ShapeMeshes::MESH_TYPE_COUNT, glm::vec4(0.0f));
+	MeshProcessor meshProcessor;
+	MESH_STREAMS streams;
+
+	for (int mesh = 0; mesh < ShapeMeshes::MESH_TYPE_COUNT; mesh++)
+	{
+		CULL_MESH& cullMesh = meshes[mesh];
+		cullMesh.indexCount = 0;
+		cullMesh.firstIndex = 0;
+		cullMesh.baseVertex = 0;
+		cullMesh.lodMesh = NO_LOD_MESH;
+		cullMesh.lodDistance = 0.0f;
+		cullMesh.padding[0] = cullMesh.padding[1] = cullMesh.padding[2] = 0;
+
+		const MESH_SOURCE* source = m_meshSources.GetMeshSource((ShapeMeshes::MESH_TYPE)mesh);
+		if (nullptr == source)
+		{
+			continue;
+		}
+
+		cullMesh.indexCount = (GLuint)source->indices.size();
+		cullMesh.firstIndex = (GLuint)indices.size();
+		cullMesh.baseVertex = (GLint)(vertices.size() / ShapeMeshes::FLOATS_PER_MESH_VERTEX);
+		if (m_bHasLod[mesh])
+		{
+			cullMesh.lodMesh = (GLuint)m_lodMesh[mesh];
+			cullMesh.lodDistance = m_lodDistance[mesh];
+		}
+
+		vertices.insert(vertices.end(), source->vertices.begin(), source->vertices.end());
+		indices.insert(indices.end(), source->indices.begin(), source->indices.end());
+
+		// bounding sphere around the center of the mesh bounds,
+		// just large enough to hold every vertex
+		MeshProcessor::ReadInterleaved(
+			source->vertices.data(),
+			source->vertices.size() / ShapeMeshes::FLOATS_PER_MESH_VERTEX,
+			ShapeMeshes::FLOATS_PER_MESH_VERTEX,
+			source->indices.data(),
+			source->indices.size(),
+			streams);
+		MESH_BOUNDS bounds = meshProcessor.CalculateBounds(streams);
+		meshSpheres[mesh] = glm::vec4(bounds.sphereCenter, bounds.sphereRadius);
+	}
+
+	// reserve one command per object in the range of its group
+	GLuint commandCount = 0;
+	std::vector<GLuint> groupOffsets(m_groups.size());
+	for (size_t i = 0; i < m_groups.size(); i++)
+	{
+		m_groups[i].firstCommand = commandCount;
+		groupOffsets[i] = commandCount;
+		commandCount += (GLuint)m_groups[i].objectCount;
+	}
+
+	std::vector<glm::mat4> models(m_objects.size());
+	std::vector<OBJECT_TEXTURE> textures(m_objects.size());
+	std::vector<CULL_OBJECT> objects(m_objects.size());
+	for (size_t i = 0; i < m_objects.size(); i++)
+	{
+		const SCENE_OBJECT_ENTRY& entry = m_objects[i];
+		const glm::vec4& sphere = meshSpheres[entry.mesh];
+
+		// a coarser mesh may be larger, so the sphere of the
+		// object covers every mesh of its chain
+		glm::vec4 lodSphere = sphere;
+		int mesh = entry.mesh;
+		for (int step = 0; (step < ShapeMeshes::MESH_TYPE_COUNT) && m_bHasLod[mesh]; step++)
+		{
+			mesh = m_lodMesh[mesh];
+			float reach = glm::length(glm::vec3(meshSpheres[mesh]) - glm::vec3(sphere)) + meshSpheres[mesh].w;
+			lodSphere.w = std::max(lodSphere.w, reach);
+		}
+
+		float largestScale = std::max(
+			glm::length(glm::vec3(entry.modelMatrix[0])),
+			std::max(glm::length(glm::vec3(entry.modelMatrix[1])), glm::length(glm::vec3(entry.modelMatrix[2]))));
+
+		models[i] = entry.modelMatrix;
+		textures[i] = entry.texture;
+		objects[i].boundingSphere = glm::vec4(
+			glm::vec3(entry.modelMatrix * glm::vec4(glm::vec3(lodSphere), 1.0f)),
+			lodSphere.w * largestScale);
+		objects[i].mesh = (GLuint)entry.mesh;
+		objects[i].drawGroup = (GLuint)entry.group;
+		objects[i].drawDistance = entry.drawDistance;
+		objects[i].padding = 0;
+	}
+
+	// storage and contents of the buffers, in the order of
+	// GPU_BUFFER - the counts and commands start out undefined
+	const uint64_t bufferBytes[BUFFER_COUNT] =
+	{
+		sizeof(GLfloat) * vertices.size(), sizeof(GLuint) * indices.size(), sizeof(glm::mat4) * models.size(),
+		sizeof(OBJECT_TEXTURE) * textures.size(), sizeof(CULL_OBJECT) * objects.size(), sizeof(CULL_MESH) * meshes.size(), sizeof(GLuint) * groupOffsets.size(),
+		sizeof(GLuint) * m_groups.size(), sizeof(DRAW_COMMAND) * commandCount
+	};
+	const void* bufferData[BUFFER_COUNT] =
+	{
+		vertices.data(), indices.data(), models.data(), textures.data(), objects.data(), meshes.data(), groupOffsets.data(),
+		nullptr, nullptr
+	};
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		m_buffers[i] = GLResources::CreateBuffer((GLsizeiptr)bufferBytes[i], bufferData[i], g_BufferUsages[i], g_BufferLabels[i]);
+		GpuMemory::TrackObject(GL_BUFFER, m_buffers[i], GPU_MEMORY_BUFFERS, "gpu scene", bufferBytes[i]);
+	}
+
+	// same memory layout as the basic shape meshes, with the
+	// models and textures of the objects read per instance
+	m_vao = GLResources::CreateVertexArray(m_buffers[BUFFER_INDICES], "gpu scene");
+	GLResources::SetVertexBuffer(
+		m_vao, 0, m_buffers[BUFFER_VERTICES], 0, sizeof(GLfloat) * ShapeMeshes::FLOATS_PER_MESH_VERTEX, 0,
+		ShapeMeshes::MESH_ATTRIBUTES, ShapeMeshes::MESH_ATTRIBUTE_COUNT);
+	GLResources::SetVertexBuffer(
+		m_vao, 1, m_buffers[BUFFER_MODELS], 0, sizeof(glm::mat4), 1,
+		g_ModelAttributes, (int)(sizeof(g_ModelAttributes) / sizeof(g_ModelAttributes[0])));
+	GLResources::SetVertexBuffer(
+		m_vao, 2, m_buffers[BUFFER_TEXTURES], 0, sizeof(OBJECT_TEXTURE), 1,
+		g_TextureAttributes, (int)(sizeof(g_TextureAttributes) / sizeof(g_TextureAttributes[0])));
+
+	m_bUploaded = true;
+
+	// the CPU copies are not needed any more
+	m_meshSources.ReleaseGeometry();
+
+	return(true);
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for running the culling shader for
+ *  the passed in camera.  The draw counts are cleared, one
+ *  invocation per object appends the surviving draws, and
+ *  a barrier makes the commands visible to the draws.
+ ***********************************************************/
+void GpuDrivenScene::Cull(const glm::mat4& viewProjection, const glm::vec3& viewPosition)
+{
+	if (m_bUploaded == false)
+	{
+		return;
+	}
+
+	// normalized so that sphere radii can be compared
+	glm::vec4 planes[6];
+	ExtractFrustumPlanes(viewProjection, true, planes);
+
+	glUseProgram(m_cullingProgram);
+	glUniform4fv(m_frustumPlanesLocation, 6, &planes[0][0]);
+	glUniform3fv(m_viewPositionLocation, 1, &viewPosition[0]);
+	glUniform1ui(m_objectCountLocation, (GLuint)m_objects.size());
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_buffers[BUFFER_OBJECTS]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_buffers[BUFFER_MESHES]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_buffers[BUFFER_GROUP_OFFSETS]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_buffers[BUFFER_DRAW_COUNTS]);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_buffers[BUFFER_COMMANDS]);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_buffers[BUFFER_DRAW_COUNTS]);
+	glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	GLuint groupCount = ((GLuint)m_objects.size() + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE;
+	glDispatchCompute(groupCount, 1, 1);
+
+	// the draws read the commands and the counts written above
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+
+	glUseProgram(0);
+}
+
+/***********************************************************
+ *  DrawGroup()
+ *
+ *  This method is used for issuing the draw commands the
+ *  culling shader wrote for a group, with the number of
+ *  draws read from the draw count of the group.
+ ***********************************************************/
+void GpuDrivenScene::DrawGroup(int groupIndex) const
+{
+	if (m_bUploaded == false)
+	{
+		return;
+	}
+
+	const GPU_DRAW_GROUP& group = m_groups[groupIndex];
+
+	glBindVertexArray(m_vao);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_buffers[BUFFER_COMMANDS]);
+	glBindBuffer(GL_PARAMETER_BUFFER, m_buffers[BUFFER_DRAW_COUNTS]);
+
+	glMultiDrawElementsIndirectCount(
+		GL_TRIANGLES,
+		GL_UNSIGNED_INT,
+		(const void*)(uintptr_t)(sizeof(DRAW_COMMAND) * group.firstCommand),
+		(GLintptr)(sizeof(GLuint) * groupIndex),
+		group.objectCount,
+		sizeof(DRAW_COMMAND));
+
+	glBindBuffer(GL_PARAMETER_BUFFER, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing every object and
+ *  freeing the buffers and the culling program.
+ ***********************************************************/
+void GpuDrivenScene::Clear()
+{
+	if (m_vao != 0)
+	{
+		GpuMemory::ReleaseObjects(GL_BUFFER, m_buffers, BUFFER_COUNT);
+		glDeleteBuffers(BUFFER_COUNT, m_buffers);
+		glDeleteVertexArrays(1, &m_vao);
+		m_vao = 0;
+		for (int i = 0; i < BUFFER_COUNT; i++)
+		{
+			m_buffers[i] = 0;
+		}
+	}
+	if (m_cullingProgram != 0)
+	{
+		glDeleteProgram(m_cullingProgram);
+		m_cullingProgram = 0;
+	}
+
+	m_objects.clear();
+	m_groups.clear();
+	m_groupLookup.clear();
+	m_bUploaded = false;
+}
@@ -0,0 +1,207 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpudrivenscene.h
+// ============
+// keep the static scene objects in GPU buffers and let a compute shader
+// cull them and write the draw commands that are issued indirectly
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShapeMeshes.h"
+#include "SceneUtilities.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <map>
+#include <vector>
+
+/***********************************************************
+ *  GPU_DRAW_GROUP
+ *
+ *  Objects that share their shader state.  Each group owns
+ *  a range of the draw command buffer and one draw count,
+ *  which the culling shader fills in every frame.  The
+ *  objects of a group can use different textures of one
+ *  atlas, so the texture slot is only the slot of its first
+ *  object, which binds the unit they share.
+ ***********************************************************/
+struct GPU_DRAW_GROUP
+{
+	int textureSlot;		// -1 when the color is used
+	int materialIndex;		// -1 when no material is set
+	glm::vec4 color;
+
+	// first command of the group and the number of objects,
+	// which is the most commands the group can receive
+	GLuint firstCommand;
+	GLsizei objectCount;
+};
+
+/***********************************************************
+ *  GpuDrivenScene
+ *
+ *  Objects are added once, uploaded with Upload(), and from
+ *  then on live in shader storage buffers.  Every frame
+ *  Cull() runs the culling compute shader, which tests each
+ *  object against the view frustum, picks its level of
+ *  detail and appends a draw command for it, and DrawGroup()
+ *  issues the commands of a group with one multi-draw whose
+ *  count is read from the GPU.  The CPU cost of a frame
+ *  depends on the number of draw groups, not on the number
+ *  of objects.
+ *
+ *  All of the meshes share one vertex and one index buffer.
+ *  The model matrices are a per-instance vertex attribute,
+ *  selected by the base instance of each draw command, and
+ *  so are the texture region and scale of every object,
+ *  which lets the objects of one texture atlas share their
+ *  draw group.
+ *
+ *  All methods that touch the buffers must run on the
+ *  thread that owns the OpenGL context.
+ ***********************************************************/
+class GpuDrivenScene
+{
+public:
+	// constructor - takes ownership of the culling program
+	GpuDrivenScene(const ShapeMeshes* pMeshes, GLuint cullingProgram);
+	// destructor
+	~GpuDrivenScene();
+
+	// true when the context supports compute shaders and
+	// multi-draws with a GPU written draw count
+	static bool IsSupported();
+
+	// draw a coarser mesh instead of a mesh from the passed
+	// in camera distance on - must be called before Upload()
+	bool SetMeshLod(ShapeMeshes::MESH_TYPE mesh, ShapeMeshes::MESH_TYPE coarserMesh, float distance);
+
+	// add an object, returns its ID or -1 when the mesh is
+	// not loaded - objects are only drawn after Upload()
+	int AddObject(
+		ShapeMeshes::MESH_TYPE mesh,
+		const glm::mat4& modelMatrix,
+		int textureSlot,
+		int textureUnit,
+		const glm::vec4& textureRegion,
+		int materialIndex,
+		const glm::vec4& color,
+		const glm::vec2& UVscale,
+		float drawDistance = 0.0f);
+
+	// build the GPU buffers from the added objects
+	bool Upload();
+	// free all objects, buffers and the culling program
+	void Clear();
+
+	// cull the objects for the passed in camera and write
+	// the draw commands - leaves no program in use
+	void Cull(const glm::mat4& viewProjection, const glm::vec3& viewPosition);
+
+	int GetGroupCount() const { return (int)m_groups.size(); }
+	const GPU_DRAW_GROUP& GetGroup(int groupIndex) const { return m_groups[groupIndex]; }
+	int GetObjectCount() const { return (int)m_objects.size(); }
+
+	// issue the draw commands the last Cull() wrote for a group
+	void DrawGroup(int groupIndex) const;
+
+private:
+	// GPU side layouts, matching the culling shader
+	struct CULL_OBJECT
+	{
+		glm::vec4 boundingSphere;
+		GLuint mesh;
+		GLuint drawGroup;
+		GLfloat drawDistance;
+		GLuint padding;
+	};
+
+	struct CULL_MESH
+	{
+		GLuint indexCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint lodMesh;
+		GLfloat lodDistance;
+		GLuint padding[3];
+	};
+
+	struct DRAW_COMMAND
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// per-instance texture values, matching the vertex shader
+	struct OBJECT_TEXTURE
+	{
+		glm::vec4 region;
+		glm::vec2 UVscale;
+	};
+
+	// the values that decide which group an object joins
+	struct GROUP_KEY
+	{
+		int textureUnit;
+		int materialIndex;
+		glm::vec4 color;
+
+		bool operator<(const GROUP_KEY& other) const;
+	};
+
+	// object as added, before the upload
+	struct SCENE_OBJECT_ENTRY
+	{
+		ShapeMeshes::MESH_TYPE mesh;
+		glm::mat4 modelMatrix;
+		OBJECT_TEXTURE texture;
+		int group;
+		float drawDistance;
+	};
+
+	enum GPU_BUFFER
+	{
+		BUFFER_VERTICES = 0,
+		BUFFER_INDICES,
+		BUFFER_MODELS,
+		BUFFER_TEXTURES,
+		BUFFER_OBJECTS,
+		BUFFER_MESHES,
+		BUFFER_GROUP_OFFSETS,
+		BUFFER_DRAW_COUNTS,
+		BUFFER_COMMANDS,
+		BUFFER_COUNT
+	};
+
+	static const GLuint NO_LOD_MESH = 0xFFFFFFFFu;
+	static const GLuint CULL_GROUP_SIZE = 64;
+
+	// CPU copies of the basic meshes, fetched once per mesh type
+	MeshSourceCache m_meshSources;
+	std::vector<SCENE_OBJECT_ENTRY> m_objects;
+	std::vector<GPU_DRAW_GROUP> m_groups;
+	std::map<GROUP_KEY, int> m_groupLookup;
+	// coarser mesh and switch distance of every mesh type
+	ShapeMeshes::MESH_TYPE m_lodMesh[ShapeMeshes::MESH_TYPE_COUNT];
+	float m_lodDistance[ShapeMeshes::MESH_TYPE_COUNT];
+	bool m_bHasLod[ShapeMeshes::MESH_TYPE_COUNT];
+
+	GLuint m_cullingProgram;
+	GLint m_frustumPlanesLocation;
+	GLint m_viewPositionLocation;
+	GLint m_objectCountLocation;
+	GLuint m_vao;
+	GLuint m_buffers[BUFFER_COUNT];
+	bool m_bUploaded;
+
+	// scenes own GL objects and must not be copied
+	GpuDrivenScene(const GpuDrivenScene&) = delete;
+	GpuDrivenScene& operator=(const GpuDrivenScene&) = delete;
+};
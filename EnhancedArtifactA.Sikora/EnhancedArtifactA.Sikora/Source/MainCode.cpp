@@ -9,7 +9,12 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include <iostream>         // error handling and output
+#include <cstdio>           // window title text
 #include <cstdlib>          // EXIT_FAILURE
+#include <future>           // render thread start-up result
+#include <thread>           // render thread
+#include <string>           // command line arguments
+#include <vector>           // benchmark file list
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -23,6 +28,16 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "DynamicResolution.h"
+#include "FrameQueue.h"
+#include "JobSystem.h"
+#include "AllocationCounter.h"
+#include "PathTracer.h"
+#include "SoftwareRasterizer.h"
+#include "GLDebug.h"
+#include "GpuMemory.h"
+#include "BmpBenchmark.h"
+#include "SceneBenchmark.h"
 
 // Namespace for declaring global variables
 namespace
@@ -30,6 +45,12 @@ namespace
 	// Macro for window title
 	const char* const WINDOW_TITLE = "7-1 FinalProject and Milestones"; 
 
+	// fixed time step used for the simulation update, in seconds
+	const double SIMULATION_TIME_STEP = 1.0 / 30.0;
+	// longest frame time accepted by the simulation, so that a long
+	// stall does not trigger a burst of catch-up simulation steps
+	const double MAX_FRAME_TIME = 0.25;
+
 	// Main GLFW window
 	GLFWwindow* g_Window = nullptr;
 
@@ -39,24 +60,108 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+	// offscreen target whose resolution follows the GPU frame time
+	DynamicResolution* g_DynamicResolution = nullptr;
+	// recorded frames handed from the main thread to the render thread
+	FrameQueue* g_FrameQueue = nullptr;
+	// work-stealing scheduler for the per-frame CPU work
+	JobSystem* g_JobSystem = nullptr;
+
+	// how often the job system statistics are reported, in seconds
+	const double JOB_STATS_INTERVAL = 5.0;
+
+	// whether a debug context was requested with --gldebug, which
+	// makes the driver report more, at a cost in speed
+	bool g_bDebugContext = false;
+
+	// GPU memory the scene may hold before textures are reduced,
+	// in megabytes - changed with --gpubudget
+	const int GPU_MEMORY_BUDGET_MB = 512;
+
+	// frames recorded before the per-frame heap allocation check
+	// starts, giving the frame lists time to reach their full size
+	const int ALLOCATION_CHECK_WARMUP_FRAMES = 120;
+
+	// farthest object a mouse pick can find
+	const float PICK_DISTANCE = 100.0f;
+
+	// defaults of the images rendered without a window - the
+	// window size, the camera the window opens with and the
+	// clip planes of the view manager
+	const int OFFLINE_WIDTH = 1000;
+	const int OFFLINE_HEIGHT = 800;
+	const glm::vec3 OFFLINE_CAMERA_POSITION = glm::vec3(0.0f, 5.0f, 12.0f);
+	const glm::vec3 OFFLINE_CAMERA_FRONT = glm::vec3(0.0f, -0.5f, -2.0f);
+	const float OFFLINE_FIELD_OF_VIEW = 80.0f;
+	const float OFFLINE_NEAR_PLANE = 0.1f;
+	const float OFFLINE_FAR_PLANE = 100.0f;
+	const int PATH_TRACE_SAMPLES = 64;
+	const int PATH_TRACE_BOUNCES = 4;
+	// seconds between the images written while path tracing
+	const float PATH_TRACE_CHECKPOINT_SECONDS = 30.0f;
+	// times every file is read by the BMP benchmark
+	const int BMP_BENCHMARK_REPETITIONS = 20;
+	// objects added to the scene by the scene benchmark, and
+	// times the scene file is loaded
+	const int SCENE_BENCHMARK_OBJECTS = 100000;
+	const int SCENE_BENCHMARK_REPETITIONS = 20;
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
-bool InitializeGLFW();
+bool InitializeGLFW(bool bDebugContext);
 bool InitializeGLEW();
+void RenderThreadMain(std::promise<bool> initResult);
+int OfflineRenderMain(int argc, char* argv[]);
+int BmpBenchmarkMain(int argc, char* argv[]);
+int SceneBenchmarkMain(int argc, char* argv[]);
 
 
 /***********************************************************
  *  main(int, char*)
  *
  *  This function gets called after the application has been
- *  launched.
+ *  launched.  The main thread owns the window events, the
+ *  simulation and the recording of each frame, while a
+ *  dedicated render thread owns the OpenGL context and
+ *  submits the recorded frames.
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// render an image with the path tracer or the software
+	// rasterizer instead of opening the window, which needs
+	// no GPU
+	if ((argc > 1) && ((std::string(argv[1]) == "--pathtrace") || (std::string(argv[1]) == "--rasterize")))
+	{
+		return OfflineRenderMain(argc, argv);
+	}
+	// time the mapped BMP reads against stb_image, without a GPU
+	if ((argc > 1) && (std::string(argv[1]) == "--bmpbenchmark"))
+	{
+		return BmpBenchmarkMain(argc, argv);
+	}
+	// time loading a scene file with many objects
+	if ((argc > 1) && (std::string(argv[1]) == "--scenebenchmark"))
+	{
+		return SceneBenchmarkMain(argc, argv);
+	}
+
+	int gpuBudgetMegabytes = GPU_MEMORY_BUDGET_MB;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) == "--gldebug")
+		{
+			g_bDebugContext = true;
+		}
+		else if ((std::string(argv[i]) == "--gpubudget") && (i + 1 < argc))
+		{
+			gpuBudgetMegabytes = std::atoi(argv[++i]);
+		}
+	}
+	GpuMemory::SetBudget((gpuBudgetMegabytes > 0) ? (uint64_t)gpuBudgetMegabytes * 1024 * 1024 : 0);
+
 	// if GLFW fails initialization, then terminate the application
-	if (InitializeGLFW() == false)
+	if (InitializeGLFW(g_bDebugContext) == false)
 	{
 		return(EXIT_FAILURE);
 	}
@@ -69,49 +174,201 @@ int main(int argc, char* argv[])
 
 	// try to create the main display window
 	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
-
-	// if GLEW fails initialization, then terminate the application
-	if (InitializeGLEW() == false)
+	if (g_Window == NULL)
 	{
 		return(EXIT_FAILURE);
 	}
 
-	// load the shader code from the external GLSL files
-	g_ShaderManager->LoadShaders(
-		"shaders/vertexShader.glsl",
-		"shaders/fragmentShader.glsl");
-	g_ShaderManager->use();
-
-	// try to create a new scene manager object and prepare the 3D scene
+	// try to create a new scene manager object - the 3D scene is
+	// prepared on the render thread, which owns the OpenGL context
 	g_SceneManager = new SceneManager(g_ShaderManager);
-	g_SceneManager->PrepareScene();
+	g_FrameQueue = new FrameQueue();
+
+	// spread the per-frame CPU work over all of the cores - the
+	// main thread takes part whenever it waits on the job system
+	g_JobSystem = new JobSystem();
+	g_SceneManager->SetJobSystem(g_JobSystem);
+
+	// hand the OpenGL context over to the render thread and wait
+	// until it has finished loading the shaders and the scene
+	glfwMakeContextCurrent(NULL);
+	std::promise<bool> renderInitPromise;
+	std::future<bool> renderInitResult = renderInitPromise.get_future();
+	std::thread renderThread(RenderThreadMain, std::move(renderInitPromise));
+
+	bool bRenderReady = renderInitResult.get();
+
+	// timing values for the fixed time step simulation
+	double previousTime = glfwGetTime();
+	double simulationAccumulator = 0.0;
+	double lastStatsTime = previousTime;
+	int recordedFrames = 0;
 
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
-	while (!glfwWindowShouldClose(g_Window))
+	while ((bRenderReady == true) && !glfwWindowShouldClose(g_Window))
 	{
-		// Enable z-depth
-		glEnable(GL_DEPTH_TEST);
+		// query the latest GLFW events
+		glfwPollEvents();
 
-		// Clear the frame and z buffers
-		glClearColor(0.0f, 0.0f, 255.0f, 0.8f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		// measure the time that has passed since the last frame
+		double currentTime = glfwGetTime();
+		double frameTime = currentTime - previousTime;
+		previousTime = currentTime;
+		if (frameTime > MAX_FRAME_TIME)
+		{
+			frameTime = MAX_FRAME_TIME;
+		}
+		simulationAccumulator += frameTime;
+
+		// run as many fixed simulation steps as needed to catch
+		// up with the elapsed time
+		while (simulationAccumulator >= SIMULATION_TIME_STEP)
+		{
+			g_ViewManager->UpdateScene((float)SIMULATION_TIME_STEP);
+			simulationAccumulator -= SIMULATION_TIME_STEP;
+		}
+
+		// report the object in the middle of the view when clicked
+		glm::vec3 pickOrigin;
+		glm::vec3 pickDirection;
+		if (g_ViewManager->ConsumePickRequest(pickOrigin, pickDirection))
+		{
+			float pickDistance = 0.0f;
+			int pickedObject = g_SceneManager->PickObject(pickOrigin, pickDirection, PICK_DISTANCE, pickDistance);
+			if (pickedObject >= 0)
+			{
+				std::cout << "INFO: Picked scene object " << pickedObject << " at " << pickDistance << " units" << std::endl;
+			}
+			else
+			{
+				std::cout << "INFO: Nothing picked" << std::endl;
+			}
+		}
+
+		// fraction of a simulation step left over, used to
+		// interpolate between the last two simulation states
+		float interpolationAlpha = (float)(simulationAccumulator / SIMULATION_TIME_STEP);
+
+		// skip recording frames entirely while the window is minimized
+		int framebufferWidth = 0;
+		int framebufferHeight = 0;
+		g_ViewManager->GetFramebufferSize(framebufferWidth, framebufferHeight);
+		if ((framebufferWidth <= 0) || (framebufferHeight <= 0))
+		{
+			glfwWaitEvents();
+			continue;
+		}
+
+		// heap allocations made while recording, by this thread and
+		// by the jobs it hands to the workers - in a steady state
+		// the frame data lives in the frame arena
+		uint64_t allocationsBefore = AllocationCounter::GetThreadAllocations() + g_JobSystem->GetWorkerAllocations();
+
+		// wait for a free frame buffer - this overlaps recording of
+		// frame N+1 with the submission of frame N
+		FRAME_DATA* frame = g_FrameQueue->BeginWrite();
+		if (frame == NULL)
+		{
+			break;
+		}
 
 		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
+		g_ViewManager->PrepareSceneView(interpolationAlpha, *frame);
+		frame->frameSeconds = (float)frameTime;
 
-		// refresh the 3D scene
-		g_SceneManager->RenderScene();
+		// record the 3D scene
+		g_SceneManager->BuildFrame(*frame);
 
+		// hand the frame to the render thread
+		g_FrameQueue->EndWrite();
 
-		// Flips the the back buffer with the front buffer every frame.
-		glfwSwapBuffers(g_Window);
+		recordedFrames++;
+		uint64_t frameAllocations = AllocationCounter::GetThreadAllocations() + g_JobSystem->GetWorkerAllocations() - allocationsBefore;
+		if ((recordedFrames > ALLOCATION_CHECK_WARMUP_FRAMES) && (frameAllocations > 0))
+		{
+			std::cout << "WARNING: Frame recording made " << frameAllocations
+				<< " heap allocations on the main thread and the job workers" << std::endl;
+		}
 
-		// query the latest GLFW events
-		glfwPollEvents();
+		// report how well the per-frame work spreads over the cores
+		if (currentTime - lastStatsTime >= JOB_STATS_INTERVAL)
+		{
+			JOB_SYSTEM_STATS stats = g_JobSystem->GetStats();
+			// only the worker threads record idle time, the main
+			// thread is busy with the simulation between frames
+			double workerThreadSeconds = (currentTime - lastStatsTime) * (stats.workerCount - 1);
+			std::cout << "INFO: Job system - workers:" << stats.workerCount
+				<< ", jobs:" << stats.jobsExecuted
+				<< ", steals:" << stats.jobsStolen
+				<< ", failed steals:" << stats.failedSteals
+				<< ", idle:" << (100.0 * stats.idleSeconds / workerThreadSeconds) << "%"
+				<< std::endl;
+			g_JobSystem->ResetStats();
+			int particleCount = g_SceneManager->GetParticleCount();
+			if (particleCount >= 0)
+			{
+				std::cout << "INFO: Particles - alive:" << particleCount << std::endl;
+			}
+			TEXTURE_STREAMING_STATS streamingStats = g_SceneManager->GetTextureStreamingStats();
+			std::cout << "INFO: Texture streaming - resident:" << (streamingStats.residentBytes / (1024.0 * 1024.0))
+				<< " of " << (streamingStats.fullBytes / (1024.0 * 1024.0)) << " MB"
+				<< ", loading:" << streamingStats.pendingLoads
+				<< ", levels loaded:" << streamingStats.levelsLoaded
+				<< ", dropped:" << streamingStats.levelsDropped << std::endl;
+			if (GLDebug::IsInstalled())
+			{
+				GL_DEBUG_STATS debugStats = GLDebug::GetStats();
+				std::cout << "INFO: OpenGL debug - errors:" << debugStats.errors
+					<< ", performance:" << debugStats.performanceWarnings
+					<< ", shader recompiles:" << debugStats.shaderRecompiles
+					<< ", buffer stalls:" << debugStats.bufferStalls
+					<< ", other:" << debugStats.otherWarnings
+					<< std::endl;
+				for (int i = 0; i < debugStats.passCount; i++)
+				{
+					if (debugStats.passWarnings[i] > 0)
+					{
+						std::cout << "INFO: OpenGL debug - " << debugStats.passNames[i]
+							<< " performance:" << debugStats.passWarnings[i] << std::endl;
+					}
+				}
+				GLDebug::ResetStats();
+			}
+
+			// the memory is also shown in the window title, which
+			// is the only overlay the window has
+			GPU_MEMORY_STATS memoryStats = GpuMemory::GetStats();
+			double megabyte = 1024.0 * 1024.0;
+			std::cout << "INFO: GPU memory - total:" << (memoryStats.totalBytes / megabyte) << " MB"
+				<< ", peak:" << (memoryStats.peakBytes / megabyte) << " MB"
+				<< ", uploads:" << (memoryStats.frameUploadBytes / 1024.0) << " KB/frame"
+				<< ", peak uploads:" << (memoryStats.peakFrameUploadBytes / 1024.0) << " KB/frame"
+				<< std::endl;
+			char windowTitle[256];
+			snprintf(windowTitle, sizeof(windowTitle), "%s - GPU %.1f/%.0f MB, uploads %.1f KB/frame",
+				WINDOW_TITLE, memoryStats.totalBytes / megabyte, memoryStats.budgetBytes / megabyte,
+				memoryStats.frameUploadBytes / 1024.0);
+			glfwSetWindowTitle(g_Window, windowTitle);
+			lastStatsTime = currentTime;
+		}
 	}
 
+	// stop the render thread and wait for it to release the context
+	g_FrameQueue->Shutdown();
+	renderThread.join();
+
 	// clear the allocated manager objects from memory
+	if (NULL != g_JobSystem)
+	{
+		delete g_JobSystem;
+		g_JobSystem = NULL;
+	}
+	if (NULL != g_FrameQueue)
+	{
+		delete g_FrameQueue;
+		g_FrameQueue = NULL;
+	}
 	if (NULL != g_SceneManager)
 	{
 		delete g_SceneManager;
@@ -128,16 +385,263 @@ int main(int argc, char* argv[])
 		g_ShaderManager = NULL;
 	}
 
+	if (bRenderReady == false)
+	{
+		return(EXIT_FAILURE);
+	}
+
 	// Terminates the program successfully
 	exit(EXIT_SUCCESS); 
 }
 
+/***********************************************************
+ *	RenderThreadMain()
+ *
+ *  This function runs on the render thread.  It makes the
+ *  OpenGL context current, loads the shaders and the scene,
+ *  reports the result back to the main thread and then
+ *  submits every recorded frame until the queue shuts down.
+ ***********************************************************/
+void RenderThreadMain(std::promise<bool> initResult)
+{
+	glfwMakeContextCurrent(g_Window);
+
+	// if GLEW fails initialization, then terminate the application
+	if (InitializeGLEW() == false)
+	{
+		glfwMakeContextCurrent(NULL);
+		initResult.set_value(false);
+		return;
+	}
+
+	// report errors and performance warnings, and label the
+	// objects created from here on
+	GLDebug::Install(g_bDebugContext);
+
+	// prepare the 3D scene, which loads the shaders once the
+	// lights of the scene file are known
+	GLDebug::PushGroup("load scene");
+	bool bSceneReady = g_SceneManager->PrepareScene();
+	GLDebug::PopGroup();
+	if (bSceneReady == false)
+	{
+		// free what was loaded while the context is still current
+		g_SceneManager->ReleaseScene();
+		glfwMakeContextCurrent(NULL);
+		initResult.set_value(false);
+		return;
+	}
+	GpuMemory::PrintReport();
+
+	// the offscreen target is created with the size of the first frame
+	g_DynamicResolution = new DynamicResolution();
+
+	initResult.set_value(true);
+
+	int submittedFrames = 0;
+
+	const FRAME_DATA* frame = g_FrameQueue->BeginRead();
+	while (frame != NULL)
+	{
+		// follow any change in the window framebuffer size
+		g_DynamicResolution->ResizeRenderTarget(frame->framebufferWidth, frame->framebufferHeight);
+
+		// render into the scaled offscreen target
+		g_DynamicResolution->BeginFrame();
+
+		// Enable z-depth
+		glEnable(GL_DEPTH_TEST);
+
+		// Clear the frame and z buffers
+		glClearColor(0.0f, 0.0f, 255.0f, 0.8f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		// set the recorded camera into the shader
+		g_ViewManager->ApplySceneView(*frame);
+
+		// upload the texture mipmaps loaded in the background and
+		// queue the ones the frame needs, which allocates, so it
+		// is kept out of the submission
+		g_SceneManager->UpdateTextureStreaming(*frame);
+
+		// submit the recorded draw packets - after the warm-up
+		// this is expected to run without any heap allocation, and
+		// it runs no jobs, so the counter of this thread holds all
+		// of its allocations
+		uint64_t allocationsBefore = AllocationCounter::GetThreadAllocations();
+		g_SceneManager->SubmitFrame(*frame);
+		uint64_t frameAllocations = AllocationCounter::GetThreadAllocations() - allocationsBefore;
+
+		submittedFrames++;
+		if ((submittedFrames > ALLOCATION_CHECK_WARMUP_FRAMES) && (frameAllocations > 0))
+		{
+			std::cout << "WARNING: Frame submission made " << frameAllocations
+				<< " heap allocations on the render thread" << std::endl;
+		}
+
+		// upscale the offscreen target into the window framebuffer
+		GLDebug::PushGroup("upscale");
+		g_DynamicResolution->EndFrame();
+		GLDebug::PopGroup();
+
+		// the frame has been submitted, so the main thread can
+		// start recording into its buffer again
+		g_FrameQueue->EndRead();
+
+		// Flips the the back buffer with the front buffer every frame.
+		glfwSwapBuffers(g_Window);
+
+		// count the uploads of the frame, and drop streamed texture
+		// levels while the GPU memory is over its budget
+		GpuMemory::EndFrame();
+
+		frame = g_FrameQueue->BeginRead();
+	}
+
+	// free the OpenGL resources while the context is still current
+	g_SceneManager->ReleaseScene();
+	if (NULL != g_DynamicResolution)
+	{
+		delete g_DynamicResolution;
+		g_DynamicResolution = NULL;
+	}
+
+	glfwMakeContextCurrent(NULL);
+}
+
+/***********************************************************
+ *	OfflineRenderMain()
+ *
+ *  This function renders the scene file into an image file
+ *  without a window, from the camera the window opens with.
+ *  --pathtrace takes the image file and, optionally, the
+ *  width, the height, the samples per pixel and the
+ *  bounces.  --rasterize takes the image file and,
+ *  optionally, the width and the height.
+ ***********************************************************/
+int OfflineRenderMain(int argc, char* argv[])
+{
+	bool bPathTrace = (std::string(argv[1]) == "--pathtrace");
+	if (argc < 3)
+	{
+		if (bPathTrace)
+		{
+			std::cout << "ERROR: Usage: --pathtrace <image.png|image.exr> [width height [samples [bounces]]]" << std::endl;
+		}
+		else
+		{
+			std::cout << "ERROR: Usage: --rasterize <image.png|image.exr> [width height]" << std::endl;
+		}
+		return(EXIT_FAILURE);
+	}
+
+	RENDER_VIEW view;
+	view.width = (argc > 4) ? std::atoi(argv[3]) : OFFLINE_WIDTH;
+	view.height = (argc > 4) ? std::atoi(argv[4]) : OFFLINE_HEIGHT;
+	view.cameraPosition = OFFLINE_CAMERA_POSITION;
+	view.cameraFront = OFFLINE_CAMERA_FRONT;
+	view.cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
+	view.fieldOfView = OFFLINE_FIELD_OF_VIEW;
+	view.nearPlane = OFFLINE_NEAR_PLANE;
+	view.farPlane = OFFLINE_FAR_PLANE;
+
+	SceneFile sceneFile;
+	if (SceneManager::LoadSceneFile(sceneFile) == false)
+	{
+		return(EXIT_FAILURE);
+	}
+
+	g_JobSystem = new JobSystem();
+	RenderBackend* pBackend = NULL;
+	if (bPathTrace)
+	{
+		PATH_TRACER_SETTINGS settings;
+		settings.samplesPerPixel = (argc > 5) ? std::atoi(argv[5]) : PATH_TRACE_SAMPLES;
+		settings.maxBounces = (argc > 6) ? std::atoi(argv[6]) : PATH_TRACE_BOUNCES;
+		settings.checkpointSeconds = PATH_TRACE_CHECKPOINT_SECONDS;
+		pBackend = new PathTracer(g_JobSystem, settings);
+	}
+	else
+	{
+		pBackend = new SoftwareRasterizer(g_JobSystem);
+	}
+
+	std::cout << "INFO: Rendering " << argv[2] << " with the " << pBackend->GetName() << std::endl;
+	bool bRendered = pBackend->BuildScene(sceneFile) && pBackend->RenderImage(view, argv[2]);
+
+	delete pBackend;
+	pBackend = NULL;
+	delete g_JobSystem;
+	g_JobSystem = NULL;
+
+	return(bRendered ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/***********************************************************
+ *	BmpBenchmarkMain()
+ *
+ *  This function times reading BMP files from a memory
+ *  mapping against decoding them with stb_image, on the
+ *  CPU only without the upload, and checks that both give
+ *  the same pixels.  --bmpbenchmark
+ *  takes the files to read, or reads the textures of the
+ *  scene file when none are passed in.
+ ***********************************************************/
+int BmpBenchmarkMain(int argc, char* argv[])
+{
+	std::vector<const char*> filenames;
+	for (int i = 2; i < argc; i++)
+	{
+		filenames.push_back(argv[i]);
+	}
+
+	// the file names point into the scene file, which stays
+	// loaded until the benchmark is done
+	SceneFile sceneFile;
+	if (filenames.empty())
+	{
+		if (SceneManager::LoadSceneFile(sceneFile) == false)
+		{
+			return(EXIT_FAILURE);
+		}
+		for (uint32_t i = 0; i < sceneFile.GetTextureCount(); i++)
+		{
+			filenames.push_back(sceneFile.GetString(sceneFile.GetTextures()[i].fileString));
+		}
+	}
+
+	bool bPassed = BmpBenchmark::Run(filenames.data(), (int)filenames.size(), BMP_BENCHMARK_REPETITIONS);
+	return(bPassed ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/***********************************************************
+ *	SceneBenchmarkMain()
+ *
+ *  This function times loading the binary scene file with
+ *  a large number of objects added to the scene.
+ *  --scenebenchmark optionally takes the number of objects
+ *  to add.
+ ***********************************************************/
+int SceneBenchmarkMain(int argc, char* argv[])
+{
+	int objectCount = (argc > 2) ? std::atoi(argv[2]) : SCENE_BENCHMARK_OBJECTS;
+	if (objectCount < 0)
+	{
+		std::cout << "ERROR: Usage: --scenebenchmark [objects]" << std::endl;
+		return(EXIT_FAILURE);
+	}
+
+	bool bLoaded = SceneBenchmark::Run(SceneManager::GetSceneTextFile(), objectCount, SCENE_BENCHMARK_REPETITIONS);
+	return(bLoaded ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
 /***********************************************************
  *	InitializeGLFW()
  * 
  *  This function is used to initialize the GLFW library.   
+ *  A debug context is requested when bDebugContext is set.
  ***********************************************************/
-bool InitializeGLFW()
+bool InitializeGLFW(bool bDebugContext)
 {
 	// GLFW: initialize and configure library
 	// --------------------------------------
@@ -154,6 +658,10 @@ bool InitializeGLFW()
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #endif
+	if (bDebugContext)
+	{
+		glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+	}
 	// GLFW: end -------------------------------
 
 	return(true);
@@ -0,0 +1,802 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshprocessing.cpp
+// ============
+// normals, tangents and bounds of whole meshes, computed four triangles at a
+// time with SSE over a structure of arrays and spread over the job system
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshProcessing.h"
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// squared length under which a vector is taken as zero
+	const float g_TinyLengthSquared = 1.0e-24f;
+	// floats of the position, normal and texture coordinate
+	const int g_FloatsPerVertex = 8;
+	// floats of the tangent written after them
+	const int g_FloatsPerTangent = 4;
+
+	// inputs and results of the triangle pass, as raw
+	// pointers so that the jobs can share them
+	struct TRIANGLE_PASS
+	{
+		const float* positionX;
+		const float* positionY;
+		const float* positionZ;
+		const float* textureU;
+		const float* textureV;
+		const uint32_t* indices;
+		float* faceNormalX;
+		float* faceNormalY;
+		float* faceNormalZ;
+		float* faceTangentX;
+		float* faceTangentY;
+		float* faceTangentZ;
+		float* faceBitangentX;
+		float* faceBitangentY;
+		float* faceBitangentZ;
+		float* cornerAngles;
+		bool bTangents;
+
+		void operator()(int first, int last) const;
+	};
+
+	// dot product of four vectors at once
+	inline __m128 Dot4(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz)
+	{
+		return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+	}
+
+	// scale four vectors to unit length, leaving the ones
+	// too short to have a direction at zero
+	inline void Normalize4(__m128& x, __m128& y, __m128& z)
+	{
+		__m128 lengthSquared = Dot4(x, y, z, x, y, z);
+		__m128 valid = _mm_cmpgt_ps(lengthSquared, _mm_set1_ps(g_TinyLengthSquared));
+		__m128 scale = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(lengthSquared, _mm_set1_ps(g_TinyLengthSquared))));
+		scale = _mm_and_ps(scale, valid);
+		x = _mm_mul_ps(x, scale);
+		y = _mm_mul_ps(y, scale);
+		z = _mm_mul_ps(z, scale);
+	}
+
+	// cosine of the angles between four pairs of vectors,
+	// clamped to the range of acos
+	inline __m128 CosineBetween4(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz)
+	{
+		__m128 lengths = _mm_sqrt_ps(_mm_mul_ps(Dot4(ax, ay, az, ax, ay, az), Dot4(bx, by, bz, bx, by, bz)));
+		__m128 cosine = _mm_div_ps(Dot4(ax, ay, az, bx, by, bz), _mm_max_ps(lengths, _mm_set1_ps(FLT_MIN)));
+		return _mm_min_ps(_mm_max_ps(cosine, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+	}
+
+	/***********************************************************
+	 *  TRIANGLE_PASS::operator()
+	 *
+	 *  This method is used for finding the face normal, the
+	 *  corner angles and the tangent frame of a range of
+	 *  triangles, four at a time.  The last group repeats the
+	 *  last triangle of the range to fill its lanes, and only
+	 *  the real lanes are stored.
+	 ***********************************************************/
+	void TRIANGLE_PASS::operator()(int first, int last) const
+	{
+		alignas(16) float results[12][4];
+
+		for (int groupStart = first; groupStart < last; groupStart += 4)
+		{
+			uint32_t corners[3][4];
+			for (int lane = 0; lane < 4; lane++)
+			{
+				int triangle = std::min(groupStart + lane, last - 1);
+				corners[0][lane] = indices[triangle * 3 + 0];
+				corners[1][lane] = indices[triangle * 3 + 1];
+				corners[2][lane] = indices[triangle * 3 + 2];
+			}
+
+			__m128 px[3], py[3], pz[3];
+			for (int corner = 0; corner < 3; corner++)
+			{
+				const uint32_t* c = corners[corner];
+				px[corner] = _mm_setr_ps(positionX[c[0]], positionX[c[1]], positionX[c[2]], positionX[c[3]]);
+				py[corner] = _mm_setr_ps(positionY[c[0]], positionY[c[1]], positionY[c[2]], positionY[c[3]]);
+				pz[corner] = _mm_setr_ps(positionZ[c[0]], positionZ[c[1]], positionZ[c[2]], positionZ[c[3]]);
+			}
+
+			// edges leaving every corner
+			__m128 e1x = _mm_sub_ps(px[1], px[0]);
+			__m128 e1y = _mm_sub_ps(py[1], py[0]);
+			__m128 e1z = _mm_sub_ps(pz[1], pz[0]);
+			__m128 e2x = _mm_sub_ps(px[2], px[0]);
+			__m128 e2y = _mm_sub_ps(py[2], py[0]);
+			__m128 e2z = _mm_sub_ps(pz[2], pz[0]);
+			__m128 e3x = _mm_sub_ps(px[2], px[1]);
+			__m128 e3y = _mm_sub_ps(py[2], py[1]);
+			__m128 e3z = _mm_sub_ps(pz[2], pz[1]);
+
+			// face normal from the counterclockwise winding
+			__m128 nx = _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y));
+			__m128 ny = _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z));
+			__m128 nz = _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x));
+			Normalize4(nx, ny, nz);
+			_mm_store_ps(results[0], nx);
+			_mm_store_ps(results[1], ny);
+			_mm_store_ps(results[2], nz);
+
+			// cosines of the corner angles, the edges of the second
+			// and third corners pointing away from them
+			__m128 zero = _mm_setzero_ps();
+			_mm_store_ps(results[3], CosineBetween4(e1x, e1y, e1z, e2x, e2y, e2z));
+			_mm_store_ps(results[4], CosineBetween4(
+				_mm_sub_ps(zero, e1x), _mm_sub_ps(zero, e1y), _mm_sub_ps(zero, e1z), e3x, e3y, e3z));
+			_mm_store_ps(results[5], CosineBetween4(e2x, e2y, e2z, e3x, e3y, e3z));
+
+			if (bTangents)
+			{
+				__m128 tu[3], tv[3];
+				for (int corner = 0; corner < 3; corner++)
+				{
+					const uint32_t* c = corners[corner];
+					tu[corner] = _mm_setr_ps(textureU[c[0]], textureU[c[1]], textureU[c[2]], textureU[c[3]]);
+					tv[corner] = _mm_setr_ps(textureV[c[0]], textureV[c[1]], textureV[c[2]], textureV[c[3]]);
+				}
+				__m128 du1 = _mm_sub_ps(tu[1], tu[0]);
+				__m128 dv1 = _mm_sub_ps(tv[1], tv[0]);
+				__m128 du2 = _mm_sub_ps(tu[2], tu[0]);
+				__m128 dv2 = _mm_sub_ps(tv[2], tv[0]);
+
+				// as in MikkTSpace, only the sign of the UV area is
+				// kept, since the vectors are normalized anyway, and
+				// triangles without UV area get no tangent
+				__m128 area = _mm_sub_ps(_mm_mul_ps(du1, dv2), _mm_mul_ps(du2, dv1));
+				__m128 signBit = _mm_and_ps(area, _mm_set1_ps(-0.0f));
+				__m128 valid = _mm_cmpneq_ps(area, zero);
+				__m128 sign = _mm_and_ps(_mm_or_ps(_mm_set1_ps(1.0f), signBit), valid);
+
+				__m128 tx = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e1x, dv2), _mm_mul_ps(e2x, dv1)), sign);
+				__m128 ty = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e1y, dv2), _mm_mul_ps(e2y, dv1)), sign);
+				__m128 tz = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e1z, dv2), _mm_mul_ps(e2z, dv1)), sign);
+				__m128 bx = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e2x, du1), _mm_mul_ps(e1x, du2)), sign);
+				__m128 by = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e2y, du1), _mm_mul_ps(e1y, du2)), sign);
+				__m128 bz = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e2z, du1), _mm_mul_ps(e1z, du2)), sign);
+				Normalize4(tx, ty, tz);
+				Normalize4(bx, by, bz);
+				_mm_store_ps(results[6], tx);
+				_mm_store_ps(results[7], ty);
+				_mm_store_ps(results[8], tz);
+				_mm_store_ps(results[9], bx);
+				_mm_store_ps(results[10], by);
+				_mm_store_ps(results[11], bz);
+			}
+
+			int laneCount = std::min(4, last - groupStart);
+			for (int lane = 0; lane < laneCount; lane++)
+			{
+				int triangle = groupStart + lane;
+				faceNormalX[triangle] = results[0][lane];
+				faceNormalY[triangle] = results[1][lane];
+				faceNormalZ[triangle] = results[2][lane];
+				cornerAngles[triangle * 3 + 0] = std::acos(results[3][lane]);
+				cornerAngles[triangle * 3 + 1] = std::acos(results[4][lane]);
+				cornerAngles[triangle * 3 + 2] = std::acos(results[5][lane]);
+				if (bTangents)
+				{
+					faceTangentX[triangle] = results[6][lane];
+					faceTangentY[triangle] = results[7][lane];
+					faceTangentZ[triangle] = results[8][lane];
+					faceBitangentX[triangle] = results[9][lane];
+					faceBitangentY[triangle] = results[10][lane];
+					faceBitangentZ[triangle] = results[11][lane];
+				}
+			}
+		}
+	}
+
+	// vertex pass of the smooth normals
+	struct SMOOTH_NORMAL_PASS
+	{
+		const float* faceNormalX;
+		const float* faceNormalY;
+		const float* faceNormalZ;
+		const float* cornerAngles;
+		const uint32_t* cornerStart;
+		const uint32_t* vertexCorners;
+		float* normalX;
+		float* normalY;
+		float* normalZ;
+
+		void operator()(int first, int last) const
+		{
+			for (int vertex = first; vertex < last; vertex++)
+			{
+				glm::vec3 sum(0.0f);
+				glm::vec3 unweighted(0.0f);
+				for (uint32_t i = cornerStart[vertex]; i < cornerStart[vertex + 1]; i++)
+				{
+					uint32_t corner = vertexCorners[i];
+					uint32_t triangle = corner / 3;
+					glm::vec3 faceNormal(faceNormalX[triangle], faceNormalY[triangle], faceNormalZ[triangle]);
+					sum += faceNormal * cornerAngles[corner];
+					unweighted += faceNormal;
+				}
+
+				// corners of no angle, as in degenerate triangles,
+				// fall back to the plain sum, and unused vertices
+				// to straight up
+				if (glm::dot(sum, sum) <= g_TinyLengthSquared)
+				{
+					sum = unweighted;
+				}
+				glm::vec3 normal = (glm::dot(sum, sum) > g_TinyLengthSquared) ? glm::normalize(sum) : glm::vec3(0.0f, 1.0f, 0.0f);
+				normalX[vertex] = normal.x;
+				normalY[vertex] = normal.y;
+				normalZ[vertex] = normal.z;
+			}
+		}
+	};
+
+	// vertex pass of the tangents
+	struct TANGENT_PASS
+	{
+		const float* normalX;
+		const float* normalY;
+		const float* normalZ;
+		const float* faceTangentX;
+		const float* faceTangentY;
+		const float* faceTangentZ;
+		const float* faceBitangentX;
+		const float* faceBitangentY;
+		const float* faceBitangentZ;
+		const float* cornerAngles;
+		const uint32_t* cornerStart;
+		const uint32_t* vertexCorners;
+		float* tangentX;
+		float* tangentY;
+		float* tangentZ;
+		float* tangentW;
+
+		void operator()(int first, int last) const
+		{
+			for (int vertex = first; vertex < last; vertex++)
+			{
+				glm::vec3 normal(normalX[vertex], normalY[vertex], normalZ[vertex]);
+				glm::vec3 tangentSum(0.0f);
+				glm::vec3 bitangentSum(0.0f);
+				for (uint32_t i = cornerStart[vertex]; i < cornerStart[vertex + 1]; i++)
+				{
+					uint32_t corner = vertexCorners[i];
+					uint32_t triangle = corner / 3;
+					float weight = cornerAngles[corner];
+
+					// the face vectors are projected into the plane of
+					// the vertex normal before they are summed
+					glm::vec3 tangent(faceTangentX[triangle], faceTangentY[triangle], faceTangentZ[triangle]);
+					tangent -= normal * glm::dot(normal, tangent);
+					if (glm::dot(tangent, tangent) > g_TinyLengthSquared)
+					{
+						tangentSum += glm::normalize(tangent) * weight;
+					}
+					glm::vec3 bitangent(faceBitangentX[triangle], faceBitangentY[triangle], faceBitangentZ[triangle]);
+					bitangent -= normal * glm::dot(normal, bitangent);
+					if (glm::dot(bitangent, bitangent) > g_TinyLengthSquared)
+					{
+						bitangentSum += glm::normalize(bitangent) * weight;
+					}
+				}
+
+				// vertices without a texture direction get any
+				// vector in the plane of the normal
+				glm::vec3 tangent;
+				if (glm::dot(tangentSum, tangentSum) > g_TinyLengthSquared)
+				{
+					tangent = glm::normalize(tangentSum - normal * glm::dot(normal, tangentSum));
+				}
+				else
+				{
+					glm::vec3 axis = (std::fabs(normal.x) < 0.9f) ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+					tangent = glm::normalize(glm::cross(axis, normal));
+				}
+				float handedness = (glm::dot(glm::cross(normal, tangent), bitangentSum) < 0.0f) ? -1.0f : 1.0f;
+
+				tangentX[vertex] = tangent.x;
+				tangentY[vertex] = tangent.y;
+				tangentZ[vertex] = tangent.z;
+				tangentW[vertex] = handedness;
+			}
+		}
+	};
+
+	// copy of the corners of every triangle into vertices of
+	// their own, for the flat normals
+	struct UNWELD_PASS
+	{
+		const MESH_STREAMS* pSource;
+		MESH_STREAMS* pTarget;
+
+		void operator()(int first, int last) const
+		{
+			for (int corner = first * 3; corner < last * 3; corner++)
+			{
+				uint32_t vertex = pSource->indices[corner];
+				pTarget->positionX[corner] = pSource->positionX[vertex];
+				pTarget->positionY[corner] = pSource->positionY[vertex];
+				pTarget->positionZ[corner] = pSource->positionZ[vertex];
+				pTarget->textureU[corner] = pSource->textureU[vertex];
+				pTarget->textureV[corner] = pSource->textureV[vertex];
+				pTarget->indices[corner] = (uint32_t)corner;
+			}
+		}
+	};
+
+	// bounds of a range of vertices
+	struct BOUNDS_RESULT
+	{
+		float boundsMin[3];
+		float boundsMax[3];
+		float radiusSquared;
+	};
+
+	// box of every job of the vertices, found four vertices
+	// at a time
+	struct BOX_PASS
+	{
+		const float* position[3];
+		BOUNDS_RESULT* results;
+		int verticesPerJob;
+
+		void operator()(int first, int last) const
+		{
+			BOUNDS_RESULT& result = results[first / verticesPerJob];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				const float* values = position[axis];
+				__m128 minimum = _mm_set1_ps(values[first]);
+				__m128 maximum = minimum;
+				int vertex = first;
+				for (; vertex + 4 <= last; vertex += 4)
+				{
+					__m128 value = _mm_loadu_ps(values + vertex);
+					minimum = _mm_min_ps(minimum, value);
+					maximum = _mm_max_ps(maximum, value);
+				}
+				alignas(16) float minimums[4];
+				alignas(16) float maximums[4];
+				_mm_store_ps(minimums, minimum);
+				_mm_store_ps(maximums, maximum);
+				float lowest = std::min(std::min(minimums[0], minimums[1]), std::min(minimums[2], minimums[3]));
+				float highest = std::max(std::max(maximums[0], maximums[1]), std::max(maximums[2], maximums[3]));
+				for (; vertex < last; vertex++)
+				{
+					lowest = std::min(lowest, values[vertex]);
+					highest = std::max(highest, values[vertex]);
+				}
+				result.boundsMin[axis] = lowest;
+				result.boundsMax[axis] = highest;
+			}
+		}
+	};
+
+	// farthest squared distance from the sphere center of
+	// every job of the vertices, found four vertices at a time
+	struct RADIUS_PASS
+	{
+		const float* position[3];
+		float center[3];
+		BOUNDS_RESULT* results;
+		int verticesPerJob;
+
+		void operator()(int first, int last) const
+		{
+			__m128 centerX = _mm_set1_ps(center[0]);
+			__m128 centerY = _mm_set1_ps(center[1]);
+			__m128 centerZ = _mm_set1_ps(center[2]);
+			__m128 farthest = _mm_setzero_ps();
+			int vertex = first;
+			for (; vertex + 4 <= last; vertex += 4)
+			{
+				__m128 dx = _mm_sub_ps(_mm_loadu_ps(position[0] + vertex), centerX);
+				__m128 dy = _mm_sub_ps(_mm_loadu_ps(position[1] + vertex), centerY);
+				__m128 dz = _mm_sub_ps(_mm_loadu_ps(position[2] + vertex), centerZ);
+				farthest = _mm_max_ps(farthest, Dot4(dx, dy, dz, dx, dy, dz));
+			}
+			alignas(16) float distances[4];
+			_mm_store_ps(distances, farthest);
+			float radiusSquared = std::max(std::max(distances[0], distances[1]), std::max(distances[2], distances[3]));
+			for (; vertex < last; vertex++)
+			{
+				float dx = position[0][vertex] - center[0];
+				float dy = position[1][vertex] - center[1];
+				float dz = position[2][vertex] - center[2];
+				radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+			}
+			results[first / verticesPerJob].radiusSquared = radiusSquared;
+		}
+	};
+}
+
+/***********************************************************
+ *  MeshProcessor()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MeshProcessor::MeshProcessor(JobSystem* pJobSystem)
+{
+	m_pJobSystem = pJobSystem;
+}
+
+/***********************************************************
+ *  RunJobs()
+ *
+ *  This method is used for running a range body over all of
+ *  the items, spread over the job system when there is one
+ *  and more than one job of work, and in the same ranges
+ *  on the calling thread otherwise.
+ ***********************************************************/
+template<typename Body>
+void MeshProcessor::RunJobs(int count, int grainSize, Body& body)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+	if ((NULL == m_pJobSystem) || (count <= grainSize))
+	{
+		// the same ranges as the jobs, so that the bodies that
+		// keep a result per job see the same first items
+		for (int rangeStart = 0; rangeStart < count; rangeStart += grainSize)
+		{
+			body(rangeStart, std::min(rangeStart + grainSize, count));
+		}
+		return;
+	}
+	m_pJobSystem->ParallelFor(0, count, grainSize, body);
+}
+
+/***********************************************************
+ *  ReadInterleaved()
+ *
+ *  This method is used for splitting interleaved vertices
+ *  into streams.  Without indices, every three vertices are
+ *  taken as a triangle.
+ ***********************************************************/
+void MeshProcessor::ReadInterleaved(
+	const float* vertices,
+	size_t vertexCount,
+	int floatsPerVertex,
+	const uint32_t* indices,
+	size_t indexCount,
+	MESH_STREAMS& streams)
+{
+	streams.positionX.resize(vertexCount);
+	streams.positionY.resize(vertexCount);
+	streams.positionZ.resize(vertexCount);
+	streams.normalX.resize(vertexCount);
+	streams.normalY.resize(vertexCount);
+	streams.normalZ.resize(vertexCount);
+	streams.textureU.resize(vertexCount);
+	streams.textureV.resize(vertexCount);
+	streams.tangentX.clear();
+	streams.tangentY.clear();
+	streams.tangentZ.clear();
+	streams.tangentW.clear();
+
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		const float* source = vertices + vertex * floatsPerVertex;
+		streams.positionX[vertex] = source[0];
+		streams.positionY[vertex] = source[1];
+		streams.positionZ[vertex] = source[2];
+		streams.normalX[vertex] = source[3];
+		streams.normalY[vertex] = source[4];
+		streams.normalZ[vertex] = source[5];
+		streams.textureU[vertex] = source[6];
+		streams.textureV[vertex] = source[7];
+	}
+
+	if (NULL != indices)
+	{
+		streams.indices.assign(indices, indices + indexCount);
+	}
+	else
+	{
+		streams.indices.resize(vertexCount - (vertexCount % 3));
+		for (size_t i = 0; i < streams.indices.size(); i++)
+		{
+			streams.indices[i] = (uint32_t)i;
+		}
+	}
+}
+
+/***********************************************************
+ *  WriteInterleaved()
+ *
+ *  This method is used for writing the streams as the
+ *  interleaved vertices of the shape meshes, with the
+ *  tangent added after the texture coordinate when asked.
+ ***********************************************************/
+void MeshProcessor::WriteInterleaved(const MESH_STREAMS& streams, bool bTangents, std::vector<float>& vertices)
+{
+	bTangents = bTangents && (streams.tangentX.size() == streams.GetVertexCount());
+	int floatsPerVertex = g_FloatsPerVertex + (bTangents ? g_FloatsPerTangent : 0);
+
+	size_t vertexCount = streams.GetVertexCount();
+	vertices.resize(vertexCount * floatsPerVertex);
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		float* target = &vertices[vertex * floatsPerVertex];
+		target[0] = streams.positionX[vertex];
+		target[1] = streams.positionY[vertex];
+		target[2] = streams.positionZ[vertex];
+		target[3] = streams.normalX[vertex];
+		target[4] = streams.normalY[vertex];
+		target[5] = streams.normalZ[vertex];
+		target[6] = streams.textureU[vertex];
+		target[7] = streams.textureV[vertex];
+		if (bTangents)
+		{
+			target[8] = streams.tangentX[vertex];
+			target[9] = streams.tangentY[vertex];
+			target[10] = streams.tangentZ[vertex];
+			target[11] = streams.tangentW[vertex];
+		}
+	}
+}
+
+/***********************************************************
+ *  RunTrianglePass()
+ *
+ *  This method is used for finding the face normals and
+ *  corner angles of all of the triangles, and their
+ *  tangent frames when asked.
+ ***********************************************************/
+void MeshProcessor::RunTrianglePass(const MESH_STREAMS& streams, bool bTangents)
+{
+	size_t triangleCount = streams.GetTriangleCount();
+	m_faceNormalX.resize(triangleCount);
+	m_faceNormalY.resize(triangleCount);
+	m_faceNormalZ.resize(triangleCount);
+	m_cornerAngles.resize(triangleCount * 3);
+	if (bTangents)
+	{
+		m_faceTangentX.resize(triangleCount);
+		m_faceTangentY.resize(triangleCount);
+		m_faceTangentZ.resize(triangleCount);
+		m_faceBitangentX.resize(triangleCount);
+		m_faceBitangentY.resize(triangleCount);
+		m_faceBitangentZ.resize(triangleCount);
+	}
+
+	TRIANGLE_PASS body;
+	body.positionX = streams.positionX.data();
+	body.positionY = streams.positionY.data();
+	body.positionZ = streams.positionZ.data();
+	body.textureU = streams.textureU.data();
+	body.textureV = streams.textureV.data();
+	body.indices = streams.indices.data();
+	body.faceNormalX = m_faceNormalX.data();
+	body.faceNormalY = m_faceNormalY.data();
+	body.faceNormalZ = m_faceNormalZ.data();
+	body.faceTangentX = m_faceTangentX.data();
+	body.faceTangentY = m_faceTangentY.data();
+	body.faceTangentZ = m_faceTangentZ.data();
+	body.faceBitangentX = m_faceBitangentX.data();
+	body.faceBitangentY = m_faceBitangentY.data();
+	body.faceBitangentZ = m_faceBitangentZ.data();
+	body.cornerAngles = m_cornerAngles.data();
+	body.bTangents = bTangents;
+	RunJobs((int)triangleCount, TRIANGLES_PER_JOB, body);
+}
+
+/***********************************************************
+ *  BuildCornerTable()
+ *
+ *  This method is used for listing the triangle corners of
+ *  every vertex with a counting sort, which keeps the
+ *  corners of a vertex in triangle order.
+ ***********************************************************/
+void MeshProcessor::BuildCornerTable(const MESH_STREAMS& streams)
+{
+	size_t vertexCount = streams.GetVertexCount();
+	size_t cornerCount = streams.GetTriangleCount() * 3;
+
+	m_cornerStart.assign(vertexCount + 1, 0);
+	for (size_t corner = 0; corner < cornerCount; corner++)
+	{
+		m_cornerStart[streams.indices[corner] + 1]++;
+	}
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		m_cornerStart[vertex + 1] += m_cornerStart[vertex];
+	}
+
+	m_vertexCorners.resize(cornerCount);
+	std::vector<uint32_t> nextCorner(m_cornerStart.begin(), m_cornerStart.end() - 1);
+	for (size_t corner = 0; corner < cornerCount; corner++)
+	{
+		m_vertexCorners[nextCorner[streams.indices[corner]]++] = (uint32_t)corner;
+	}
+}
+
+/***********************************************************
+ *  CalculateFlatNormals()
+ *
+ *  This method is used for giving every triangle corners of
+ *  its own with the normal of the face, as for hard edged
+ *  shapes.  Any tangents are dropped, since the vertices
+ *  they belonged to are gone.
+ ***********************************************************/
+void MeshProcessor::CalculateFlatNormals(MESH_STREAMS& streams)
+{
+	size_t triangleCount = streams.GetTriangleCount();
+	size_t cornerCount = triangleCount * 3;
+
+	MESH_STREAMS flat;
+	flat.positionX.resize(cornerCount);
+	flat.positionY.resize(cornerCount);
+	flat.positionZ.resize(cornerCount);
+	flat.textureU.resize(cornerCount);
+	flat.textureV.resize(cornerCount);
+	flat.indices.resize(cornerCount);
+
+	UNWELD_PASS unweldBody;
+	unweldBody.pSource = &streams;
+	unweldBody.pTarget = &flat;
+	RunJobs((int)triangleCount, TRIANGLES_PER_JOB, unweldBody);
+
+	RunTrianglePass(flat, false);
+
+	flat.normalX.resize(cornerCount);
+	flat.normalY.resize(cornerCount);
+	flat.normalZ.resize(cornerCount);
+	for (size_t corner = 0; corner < cornerCount; corner++)
+	{
+		size_t triangle = corner / 3;
+		flat.normalX[corner] = m_faceNormalX[triangle];
+		flat.normalY[corner] = m_faceNormalY[triangle];
+		flat.normalZ[corner] = m_faceNormalZ[triangle];
+	}
+
+	streams = std::move(flat);
+}
+
+/***********************************************************
+ *  CalculateSmoothNormals()
+ *
+ *  This method is used for giving every vertex the normal
+ *  of the triangles around it, each weighted by its angle
+ *  at the vertex, so that finely cut areas do not pull the
+ *  normal toward themselves.
+ ***********************************************************/
+void MeshProcessor::CalculateSmoothNormals(MESH_STREAMS& streams)
+{
+	size_t vertexCount = streams.GetVertexCount();
+	streams.normalX.resize(vertexCount);
+	streams.normalY.resize(vertexCount);
+	streams.normalZ.resize(vertexCount);
+
+	RunTrianglePass(streams, false);
+	BuildCornerTable(streams);
+
+	SMOOTH_NORMAL_PASS body;
+	body.faceNormalX = m_faceNormalX.data();
+	body.faceNormalY = m_faceNormalY.data();
+	body.faceNormalZ = m_faceNormalZ.data();
+	body.cornerAngles = m_cornerAngles.data();
+	body.cornerStart = m_cornerStart.data();
+	body.vertexCorners = m_vertexCorners.data();
+	body.normalX = streams.normalX.data();
+	body.normalY = streams.normalY.data();
+	body.normalZ = streams.normalZ.data();
+	RunJobs((int)vertexCount, VERTICES_PER_JOB, body);
+}
+
+/***********************************************************
+ *  CalculateTangents()
+ *
+ *  This method is used for giving every vertex a tangent
+ *  along the U direction of the texture, kept at right
+ *  angles to its normal, and the handedness of the
+ *  texture in w.
+ ***********************************************************/
+void MeshProcessor::CalculateTangents(MESH_STREAMS& streams)
+{
+	size_t vertexCount = streams.GetVertexCount();
+	streams.tangentX.resize(vertexCount);
+	streams.tangentY.resize(vertexCount);
+	streams.tangentZ.resize(vertexCount);
+	streams.tangentW.resize(vertexCount);
+
+	RunTrianglePass(streams, true);
+	BuildCornerTable(streams);
+
+	TANGENT_PASS body;
+	body.normalX = streams.normalX.data();
+	body.normalY = streams.normalY.data();
+	body.normalZ = streams.normalZ.data();
+	body.faceTangentX = m_faceTangentX.data();
+	body.faceTangentY = m_faceTangentY.data();
+	body.faceTangentZ = m_faceTangentZ.data();
+	body.faceBitangentX = m_faceBitangentX.data();
+	body.faceBitangentY = m_faceBitangentY.data();
+	body.faceBitangentZ = m_faceBitangentZ.data();
+	body.cornerAngles = m_cornerAngles.data();
+	body.cornerStart = m_cornerStart.data();
+	body.vertexCorners = m_vertexCorners.data();
+	body.tangentX = streams.tangentX.data();
+	body.tangentY = streams.tangentY.data();
+	body.tangentZ = streams.tangentZ.data();
+	body.tangentW = streams.tangentW.data();
+	RunJobs((int)vertexCount, VERTICES_PER_JOB, body);
+}
+
+/***********************************************************
+ *  CalculateBounds()
+ *
+ *  This method is used for finding the box around the
+ *  vertices, and the radius of the sphere around its
+ *  center that holds them all, which is tighter than half
+ *  of the box diagonal for rounded shapes.
+ ***********************************************************/
+MESH_BOUNDS MeshProcessor::CalculateBounds(const MESH_STREAMS& streams)
+{
+	MESH_BOUNDS bounds;
+	bounds.boundsMin = glm::vec3(0.0f);
+	bounds.boundsMax = glm::vec3(0.0f);
+	bounds.sphereCenter = glm::vec3(0.0f);
+	bounds.sphereRadius = 0.0f;
+
+	int vertexCount = (int)streams.GetVertexCount();
+	if (vertexCount == 0)
+	{
+		return(bounds);
+	}
+
+	int jobCount = (vertexCount + VERTICES_PER_JOB - 1) / VERTICES_PER_JOB;
+	std::vector<BOUNDS_RESULT> results(jobCount);
+
+	BOX_PASS boxBody;
+	boxBody.position[0] = streams.positionX.data();
+	boxBody.position[1] = streams.positionY.data();
+	boxBody.position[2] = streams.positionZ.data();
+	boxBody.results = results.data();
+	boxBody.verticesPerJob = VERTICES_PER_JOB;
+	RunJobs(vertexCount, VERTICES_PER_JOB, boxBody);
+
+	bounds.boundsMin = glm::vec3(results[0].boundsMin[0], results[0].boundsMin[1], results[0].boundsMin[2]);
+	bounds.boundsMax = glm::vec3(results[0].boundsMax[0], results[0].boundsMax[1], results[0].boundsMax[2]);
+	for (int job = 1; job < jobCount; job++)
+	{
+		bounds.boundsMin = glm::min(bounds.boundsMin, glm::vec3(results[job].boundsMin[0], results[job].boundsMin[1], results[job].boundsMin[2]));
+		bounds.boundsMax = glm::max(bounds.boundsMax, glm::vec3(results[job].boundsMax[0], results[job].boundsMax[1], results[job].boundsMax[2]));
+	}
+	bounds.sphereCenter = (bounds.boundsMin + bounds.boundsMax) * 0.5f;
+
+	RADIUS_PASS radiusBody;
+	radiusBody.position[0] = streams.positionX.data();
+	radiusBody.position[1] = streams.positionY.data();
+	radiusBody.position[2] = streams.positionZ.data();
+	radiusBody.center[0] = bounds.sphereCenter.x;
+	radiusBody.center[1] = bounds.sphereCenter.y;
+	radiusBody.center[2] = bounds.sphereCenter.z;
+	radiusBody.results = results.data();
+	radiusBody.verticesPerJob = VERTICES_PER_JOB;
+	RunJobs(vertexCount, VERTICES_PER_JOB, radiusBody);
+
+	float radiusSquared = 0.0f;
+	for (int job = 0; job < jobCount; job++)
+	{
+		radiusSquared = std::max(radiusSquared, results[job].radiusSquared);
+	}
+	bounds.sphereRadius = std::sqrt(radiusSquared);
+
+	return(bounds);
+}
@@ -0,0 +1,152 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshprocessing.h
+// ============
+// normals, tangents and bounds of whole meshes, computed four triangles at a
+// time with SSE over a structure of arrays and spread over the job system
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  MESH_STREAMS
+ *
+ *  A mesh as one array per vertex component, so the same
+ *  component of four vertices loads as one SSE register,
+ *  and a triangle list.  The tangent is a unit vector in
+ *  the plane of the normal, with the sign of the bitangent
+ *  in w, so a shader rebuilds the bitangent as
+ *  w * cross(normal, tangent), as with MikkTSpace.
+ ***********************************************************/
+struct MESH_STREAMS
+{
+	std::vector<float> positionX;
+	std::vector<float> positionY;
+	std::vector<float> positionZ;
+	std::vector<float> normalX;
+	std::vector<float> normalY;
+	std::vector<float> normalZ;
+	std::vector<float> textureU;
+	std::vector<float> textureV;
+	std::vector<float> tangentX;
+	std::vector<float> tangentY;
+	std::vector<float> tangentZ;
+	std::vector<float> tangentW;
+	std::vector<uint32_t> indices;
+
+	size_t GetVertexCount() const { return positionX.size(); }
+	size_t GetTriangleCount() const { return indices.size() / 3; }
+};
+
+/***********************************************************
+ *  MESH_BOUNDS
+ *
+ *  Axis aligned box of a mesh, and the sphere around the
+ *  center of the box that holds every vertex.
+ ***********************************************************/
+struct MESH_BOUNDS
+{
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	glm::vec3 sphereCenter;
+	float sphereRadius;
+};
+
+/***********************************************************
+ *  MeshProcessor
+ *
+ *  Works in two passes.  The triangle pass finds the face
+ *  normal, the corner angles and the UV tangent frame of
+ *  four triangles at once.  The vertex pass then gathers,
+ *  for every vertex, the angle weighted values of the
+ *  triangles around it, found through a vertex to corner
+ *  table, so no two jobs ever write the same vertex.
+ *
+ *  Normals are smoothed over the triangles that share a
+ *  vertex index, so vertices split at a seam keep their
+ *  own normals.  Tangents follow MikkTSpace - the face
+ *  tangents are projected into the plane of the vertex
+ *  normal and weighted by the corner angle - but vertices
+ *  whose triangles mirror the texture are not split, they
+ *  take the handedness of the sum.
+ *
+ *  Without a job system, or for small meshes, everything
+ *  runs on the calling thread.
+ ***********************************************************/
+class MeshProcessor
+{
+public:
+	// constructor
+	MeshProcessor(JobSystem* pJobSystem = nullptr);
+
+	// split interleaved vertices, which start with a position,
+	// a normal and a texture coordinate, into streams
+	static void ReadInterleaved(
+		const float* vertices,
+		size_t vertexCount,
+		int floatsPerVertex,
+		const uint32_t* indices,
+		size_t indexCount,
+		MESH_STREAMS& streams);
+	// write the streams as interleaved position, normal and
+	// texture coordinate, followed by the tangent when asked
+	static void WriteInterleaved(const MESH_STREAMS& streams, bool bTangents, std::vector<float>& vertices);
+
+	// give every triangle its own corners and face normal
+	void CalculateFlatNormals(MESH_STREAMS& streams);
+	// give every vertex the angle weighted normal of the
+	// triangles around it
+	void CalculateSmoothNormals(MESH_STREAMS& streams);
+	// give every vertex a tangent from the texture coordinates,
+	// which needs the normals to be set
+	void CalculateTangents(MESH_STREAMS& streams);
+	// find the bounding box and sphere of the vertices
+	MESH_BOUNDS CalculateBounds(const MESH_STREAMS& streams);
+
+private:
+	// triangles handled by one job of the triangle pass
+	static const int TRIANGLES_PER_JOB = 16384;
+	// vertices handled by one job of the vertex passes
+	static const int VERTICES_PER_JOB = 16384;
+
+	JobSystem* m_pJobSystem;
+
+	// results of the triangle pass, one entry per triangle
+	std::vector<float> m_faceNormalX;
+	std::vector<float> m_faceNormalY;
+	std::vector<float> m_faceNormalZ;
+	std::vector<float> m_faceTangentX;
+	std::vector<float> m_faceTangentY;
+	std::vector<float> m_faceTangentZ;
+	std::vector<float> m_faceBitangentX;
+	std::vector<float> m_faceBitangentY;
+	std::vector<float> m_faceBitangentZ;
+	// angle of every triangle corner
+	std::vector<float> m_cornerAngles;
+
+	// corners of every vertex, the ones of vertex v being
+	// m_vertexCorners[m_cornerStart[v]] up to the next start
+	std::vector<uint32_t> m_cornerStart;
+	std::vector<uint32_t> m_vertexCorners;
+
+	// run the triangle pass, with the tangent frames when asked
+	void RunTrianglePass(const MESH_STREAMS& streams, bool bTangents);
+	// build the vertex to corner table
+	void BuildCornerTable(const MESH_STREAMS& streams);
+	// run a range body over count items in jobs of grainSize
+	template<typename Body>
+	void RunJobs(int count, int grainSize, Body& body);
+
+	// the processor keeps scratch buffers that must not be copied
+	MeshProcessor(const MeshProcessor&) = delete;
+	MeshProcessor& operator=(const MeshProcessor&) = delete;
+};
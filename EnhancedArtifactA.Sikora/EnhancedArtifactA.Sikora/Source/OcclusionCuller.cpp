@@ -0,0 +1,340 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionculler.cpp
+// ============
+// rasterize large occluders into a small CPU depth pyramid and test
+// object bounds against it, so hidden objects are not submitted
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+/***********************************************************
+ *  OcclusionCuller()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+OcclusionCuller::OcclusionCuller()
+{
+	int width = DEPTH_WIDTH;
+	int height = DEPTH_HEIGHT;
+
+	for (int level = 0; level < LEVEL_COUNT; level++)
+	{
+		m_levelWidth[level] = width;
+		m_levelHeight[level] = height;
+		m_levels[level].assign((size_t)width * height, 1.0f);
+
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+
+	m_viewProjection = glm::mat4(1.0f);
+	m_bHasDepth = false;
+}
+
+/***********************************************************
+ *  ClearOccluders()
+ *
+ *  This method is used for removing every occluder.
+ ***********************************************************/
+void OcclusionCuller::ClearOccluders()
+{
+	m_occluderVertices.clear();
+	m_bHasDepth = false;
+}
+
+/***********************************************************
+ *  AddOccluder()
+ *
+ *  This method is used for adding the triangles of a mesh,
+ *  moved into world space by the passed in model matrix,
+ *  to the occluders.
+ ***********************************************************/
+void OcclusionCuller::AddOccluder(
+	const std::vector<GLfloat>& vertices,
+	const std::vector<GLuint>& indices,
+	GLuint floatsPerVertex,
+	const glm::mat4& modelMatrix)
+{
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		for (int corner = 0; corner < 3; corner++)
+		{
+			size_t vertex = (size_t)indices[i + corner] * floatsPerVertex;
+			glm::vec4 position = modelMatrix * glm::vec4(vertices[vertex], vertices[vertex + 1], vertices[vertex + 2], 1.0f);
+			m_occluderVertices.push_back(glm::vec3(position));
+		}
+	}
+}
+
+/***********************************************************
+ *  RenderOccluders()
+ *
+ *  This method is used for rasterizing the occluders into
+ *  the finest depth level and building the pyramid from
+ *  it.  Triangles crossing the near plane are clipped
+ *  against it first.
+ ***********************************************************/
+void OcclusionCuller::RenderOccluders(const glm::mat4& viewProjection)
+{
+	m_viewProjection = viewProjection;
+	std::fill(m_levels[0].begin(), m_levels[0].end(), 1.0f);
+
+	for (size_t i = 0; i + 2 < m_occluderVertices.size(); i += 3)
+	{
+		glm::vec4 input[3];
+		for (int corner = 0; corner < 3; corner++)
+		{
+			input[corner] = viewProjection * glm::vec4(m_occluderVertices[i + corner], 1.0f);
+		}
+
+		// clip against the near plane, z >= -w, which leaves
+		// at most four corners
+		glm::vec4 clipped[4];
+		int clippedCount = 0;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			const glm::vec4& current = input[corner];
+			const glm::vec4& next = input[(corner + 1) % 3];
+			float currentDistance = current.z + current.w;
+			float nextDistance = next.z + next.w;
+
+			if (currentDistance >= 0.0f)
+			{
+				clipped[clippedCount++] = current;
+			}
+			if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+			{
+				float t = currentDistance / (currentDistance - nextDistance);
+				clipped[clippedCount++] = current + (next - current) * t;
+			}
+		}
+
+		for (int corner = 1; corner + 1 < clippedCount; corner++)
+		{
+			RasterizeTriangle(clipped[0], clipped[corner], clipped[corner + 1]);
+		}
+	}
+
+	BuildPyramid();
+	m_bHasDepth = true;
+}
+
+/***********************************************************
+ *  RasterizeTriangle()
+ *
+ *  This method is used for writing the depth of one clip
+ *  space triangle into the finest depth level.  Texel
+ *  centers inside the triangle keep the nearest depth.
+ ***********************************************************/
+void OcclusionCuller::RasterizeTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+{
+	const int width = m_levelWidth[0];
+	const int height = m_levelHeight[0];
+
+	// corners in texel coordinates with a depth of 0 to 1
+	glm::vec3 corners[3];
+	const glm::vec4* clip[3] = { &a, &b, &c };
+	for (int i = 0; i < 3; i++)
+	{
+		float inverseW = 1.0f / clip[i]->w;
+		corners[i] = glm::vec3(
+			(clip[i]->x * inverseW * 0.5f + 0.5f) * width,
+			(clip[i]->y * inverseW * 0.5f + 0.5f) * height,
+			clip[i]->z * inverseW * 0.5f + 0.5f);
+	}
+
+	float area = (corners[1].x - corners[0].x) * (corners[2].y - corners[0].y) -
+		(corners[1].y - corners[0].y) * (corners[2].x - corners[0].x);
+	if (area == 0.0f)
+	{
+		return;
+	}
+	// occluders are drawn from both sides
+	if (area < 0.0f)
+	{
+		std::swap(corners[1], corners[2]);
+		area = -area;
+	}
+
+	int minX = std::max(0, (int)std::floor(std::min(corners[0].x, std::min(corners[1].x, corners[2].x))));
+	int maxX = std::min(width - 1, (int)std::ceil(std::max(corners[0].x, std::max(corners[1].x, corners[2].x))));
+	int minY = std::max(0, (int)std::floor(std::min(corners[0].y, std::min(corners[1].y, corners[2].y))));
+	int maxY = std::min(height - 1, (int)std::ceil(std::max(corners[0].y, std::max(corners[1].y, corners[2].y))));
+
+	// the edge functions are evaluated in double precision -
+	// clipped occluders reach far outside the screen, and in
+	// single precision texel centers on the edge shared by
+	// two triangles can fall outside both of them
+	const double x0 = corners[0].x, y0 = corners[0].y;
+	const double x1 = corners[1].x, y1 = corners[1].y;
+	const double x2 = corners[2].x, y2 = corners[2].y;
+	const double inverseArea = 1.0 / ((x1 - x0) * (y2 - y0) - (y1 - y0) * (x2 - x0));
+	std::vector<float>& depth = m_levels[0];
+
+	for (int y = minY; y <= maxY; y++)
+	{
+		double sampleY = y + 0.5;
+		for (int x = minX; x <= maxX; x++)
+		{
+			double sampleX = x + 0.5;
+
+			// edge functions, each weighting the opposite corner
+			double weight0 = (x2 - x1) * (sampleY - y1) - (y2 - y1) * (sampleX - x1);
+			double weight1 = (x0 - x2) * (sampleY - y2) - (y0 - y2) * (sampleX - x2);
+			double weight2 = (x1 - x0) * (sampleY - y0) - (y1 - y0) * (sampleX - x0);
+			if ((weight0 < 0.0) || (weight1 < 0.0) || (weight2 < 0.0))
+			{
+				continue;
+			}
+
+			// depth divided by w is linear in screen space
+			float sampleDepth = (float)((weight0 * corners[0].z + weight1 * corners[1].z + weight2 * corners[2].z) * inverseArea);
+			float& texel = depth[(size_t)y * width + x];
+			if (sampleDepth < texel)
+			{
+				texel = sampleDepth;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  BuildPyramid()
+ *
+ *  This method is used for building every coarser level
+ *  from the one below it, keeping the farthest depth of
+ *  each 2x2 block of texels.
+ ***********************************************************/
+void OcclusionCuller::BuildPyramid()
+{
+	for (int level = 1; level < LEVEL_COUNT; level++)
+	{
+		const std::vector<float>& source = m_levels[level - 1];
+		std::vector<float>& target = m_levels[level];
+		int sourceWidth = m_levelWidth[level - 1];
+		int sourceHeight = m_levelHeight[level - 1];
+
+		for (int y = 0; y < m_levelHeight[level]; y++)
+		{
+			int y0 = y * 2;
+			int y1 = std::min(y0 + 1, sourceHeight - 1);
+			for (int x = 0; x < m_levelWidth[level]; x++)
+			{
+				int x0 = x * 2;
+				int x1 = std::min(x0 + 1, sourceWidth - 1);
+
+				float farthest = std::max(
+					std::max(source[(size_t)y0 * sourceWidth + x0], source[(size_t)y0 * sourceWidth + x1]),
+					std::max(source[(size_t)y1 * sourceWidth + x0], source[(size_t)y1 * sourceWidth + x1]));
+				target[(size_t)y * m_levelWidth[level] + x] = farthest;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  IsVisible()
+ *
+ *  This method is used for testing a bounding box against
+ *  the depth pyramid.  Boxes outside the view are hidden,
+ *  boxes crossing the near plane are always visible, and
+ *  all others are hidden when their nearest depth is
+ *  behind the farthest occluder depth over their screen
+ *  rectangle.
+ ***********************************************************/
+bool OcclusionCuller::IsVisible(const glm::mat4& modelMatrix, const OCCLUSION_BOUNDS& bounds) const
+{
+	if (m_bHasDepth == false)
+	{
+		return(true);
+	}
+
+	glm::mat4 modelViewProjection = m_viewProjection * modelMatrix;
+
+	glm::vec3 ndcMin(1.0e30f);
+	glm::vec3 ndcMax(-1.0e30f);
+	int behindNearCount = 0;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		glm::vec4 position(
+			(corner & 1) ? bounds.boundsMax.x : bounds.boundsMin.x,
+			(corner & 2) ? bounds.boundsMax.y : bounds.boundsMin.y,
+			(corner & 4) ? bounds.boundsMax.z : bounds.boundsMin.z,
+			1.0f);
+		glm::vec4 clip = modelViewProjection * position;
+
+		if (clip.z < -clip.w)
+		{
+			behindNearCount++;
+			continue;
+		}
+
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		ndcMin = glm::min(ndcMin, ndc);
+		ndcMax = glm::max(ndcMax, ndc);
+	}
+
+	// a box behind the camera is hidden, and one crossing the
+	// near plane cannot be projected and counts as visible
+	if (behindNearCount == 8)
+	{
+		return(false);
+	}
+	if (behindNearCount > 0)
+	{
+		return(true);
+	}
+
+	if ((ndcMax.x < -1.0f) || (ndcMin.x > 1.0f) || (ndcMax.y < -1.0f) || (ndcMin.y > 1.0f) || (ndcMin.z > 1.0f))
+	{
+		return(false);
+	}
+
+	float nearestDepth = ndcMin.z * 0.5f + 0.5f;
+
+	// screen rectangle of the box in finest level texels,
+	// grown by one texel on every side - the occluders cover
+	// a texel when they cover its center, so the part of a
+	// texel outside an occluder edge shows in a neighboring
+	// texel that the occluder leaves uncovered
+	const int width = m_levelWidth[0];
+	const int height = m_levelHeight[0];
+	int minX = std::max(0, (int)std::floor((ndcMin.x * 0.5f + 0.5f) * width) - 1);
+	int maxX = std::min(width - 1, (int)std::floor((ndcMax.x * 0.5f + 0.5f) * width) + 1);
+	int minY = std::max(0, (int)std::floor((ndcMin.y * 0.5f + 0.5f) * height) - 1);
+	int maxY = std::min(height - 1, (int)std::floor((ndcMax.y * 0.5f + 0.5f) * height) + 1);
+
+	// pick the level at which the rectangle spans at most
+	// four texels in each direction
+	int level = 0;
+	int extent = std::max(maxX - minX, maxY - minY) + 1;
+	while ((extent > 4) && (level < LEVEL_COUNT - 1))
+	{
+		extent = (extent + 1) / 2;
+		level++;
+	}
+
+	const std::vector<float>& depth = m_levels[level];
+	int levelWidth = m_levelWidth[level];
+	int levelMaxX = std::min(levelWidth - 1, maxX >> level);
+	int levelMaxY = std::min(m_levelHeight[level] - 1, maxY >> level);
+
+	for (int y = minY >> level; y <= levelMaxY; y++)
+	{
+		for (int x = minX >> level; x <= levelMaxX; x++)
+		{
+			if (nearestDepth <= depth[(size_t)y * levelWidth + x])
+			{
+				return(true);
+			}
+		}
+	}
+
+	return(false);
+}
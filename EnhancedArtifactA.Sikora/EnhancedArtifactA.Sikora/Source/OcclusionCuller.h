@@ -0,0 +1,96 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionculler.h
+// ============
+// rasterize large occluders into a small CPU depth pyramid and test
+// object bounds against it, so hidden objects are not submitted
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  OCCLUSION_BOUNDS
+ *
+ *  Axis aligned bounding box tested against the depth
+ *  pyramid, in the space of the model matrix it is tested
+ *  with.
+ ***********************************************************/
+struct OCCLUSION_BOUNDS
+{
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+};
+
+/***********************************************************
+ *  OcclusionCuller
+ *
+ *  Occluders are added once as world space triangles.
+ *  Every frame RenderOccluders() rasterizes them into a
+ *  low resolution depth buffer and reduces it into a
+ *  pyramid where every texel holds the farthest depth of
+ *  the texels it covers.  IsVisible() projects a bounding
+ *  box and compares its nearest depth with the farthest
+ *  occluder depth over the box, using the pyramid level at
+ *  which the box covers only a few texels.
+ *
+ *  Depth is rasterized at texel centers, so a texel an
+ *  occluder edge crosses can be covered while part of it
+ *  is visible at full resolution.  The screen rectangle of
+ *  a tested box is grown by one texel to stay conservative
+ *  across such edges.  Only objects that need no blending
+ *  should be culled against it, and large solid objects
+ *  make the best occluders.
+ ***********************************************************/
+class OcclusionCuller
+{
+public:
+	// constructor
+	OcclusionCuller();
+
+	// size of the finest level of the depth pyramid
+	static const int DEPTH_WIDTH = 256;
+	static const int DEPTH_HEIGHT = 128;
+	static const int LEVEL_COUNT = 8;
+
+	// remove every occluder
+	void ClearOccluders();
+	// add the triangles of a mesh, given as interleaved
+	// vertices with the position first, as an occluder
+	void AddOccluder(
+		const std::vector<GLfloat>& vertices,
+		const std::vector<GLuint>& indices,
+		GLuint floatsPerVertex,
+		const glm::mat4& modelMatrix);
+	int GetOccluderTriangleCount() const { return (int)(m_occluderVertices.size() / 3); }
+
+	// rasterize the occluders for the passed in camera and
+	// build the depth pyramid
+	void RenderOccluders(const glm::mat4& viewProjection);
+	// test a bounding box against the depth pyramid of the
+	// last RenderOccluders(), false when it is hidden
+	bool IsVisible(const glm::mat4& modelMatrix, const OCCLUSION_BOUNDS& bounds) const;
+
+private:
+	// world space occluder triangles, three vertices each
+	std::vector<glm::vec3> m_occluderVertices;
+	// farthest depth per texel, level 0 is the finest
+	std::vector<float> m_levels[LEVEL_COUNT];
+	int m_levelWidth[LEVEL_COUNT];
+	int m_levelHeight[LEVEL_COUNT];
+	glm::mat4 m_viewProjection;
+	// false until occluders were rasterized, in which case
+	// every object is visible
+	bool m_bHasDepth;
+
+	// rasterize one triangle given in clip space
+	void RasterizeTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+	// reduce level 0 into the coarser levels
+	void BuildPyramid();
+};
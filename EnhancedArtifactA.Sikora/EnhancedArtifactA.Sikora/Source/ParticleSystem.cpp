@@ -0,0 +1,488 @@
+///////////////////////////////////////////////////////////////////////////////
+// particlesystem.cpp
+// ============
+// particle effects, like falling leaves, that are emitted, simulated and
+// compacted by a compute shader and drawn as instanced billboards, with no
+// per-particle work on the CPU
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ParticleSystem.h"
+#include "GLResources.h"
+#include "GpuMemory.h"
+
+#include <algorithm>
+#include <cstddef>
+
+// declaration of global variables
+namespace
+{
+	// longest time step simulated at once, so that a stall
+	// does not throw the particles through the ground
+	const float g_MaxTimeStep = 0.1f;
+
+	// corners of the billboard quad, drawn as a triangle strip
+	const GLfloat g_QuadCorners[] =
+	{
+		-0.5f, -0.5f,
+		 0.5f, -0.5f,
+		-0.5f,  0.5f,
+		 0.5f,  0.5f
+	};
+
+	// debug labels of the buffers of an effect, in the order
+	// of PARTICLE_BUFFER
+	const char* const g_EffectBufferLabels[] =
+	{
+		"particles", "particle dead list", "particle alive lists", "particle state", "particle emitters"
+	};
+
+	// how the buffers of an effect are written, in the order
+	// of PARTICLE_BUFFER - all but the emitters are updated by
+	// the simulation shader
+	const BUFFER_USAGE g_EffectBufferUsages[] =
+	{
+		BUFFER_GPU_WRITTEN, BUFFER_GPU_WRITTEN, BUFFER_GPU_WRITTEN, BUFFER_GPU_WRITTEN, BUFFER_STATIC
+	};
+
+	// the corner of the quad
+	const VERTEX_ATTRIBUTE g_QuadAttributes[] = { { 0, 2, 0 } };
+}
+
+/***********************************************************
+ *  ParticleSystem()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ParticleSystem::ParticleSystem(GLuint simulationProgram, GLuint drawProgram)
+	: m_aliveCount(0)
+{
+	m_simulationProgram = simulationProgram;
+	m_drawProgram = drawProgram;
+
+	m_simulationUniforms.stage = glGetUniformLocation(simulationProgram, "particleStage");
+	m_simulationUniforms.currentList = glGetUniformLocation(simulationProgram, "currentList");
+	m_simulationUniforms.capacity = glGetUniformLocation(simulationProgram, "capacity");
+	m_simulationUniforms.requestedEmit = glGetUniformLocation(simulationProgram, "requestedEmit");
+	m_simulationUniforms.emitterCount = glGetUniformLocation(simulationProgram, "emitterCount");
+	m_simulationUniforms.seconds = glGetUniformLocation(simulationProgram, "seconds");
+	m_simulationUniforms.time = glGetUniformLocation(simulationProgram, "time");
+	m_simulationUniforms.randomSeed = glGetUniformLocation(simulationProgram, "randomSeed");
+	m_simulationUniforms.lifetime = glGetUniformLocation(simulationProgram, "lifetime");
+	m_simulationUniforms.sizeRange = glGetUniformLocation(simulationProgram, "sizeRange");
+	m_simulationUniforms.gravity = glGetUniformLocation(simulationProgram, "gravity");
+	m_simulationUniforms.drag = glGetUniformLocation(simulationProgram, "drag");
+	m_simulationUniforms.wind = glGetUniformLocation(simulationProgram, "wind");
+	m_simulationUniforms.gust = glGetUniformLocation(simulationProgram, "gust");
+	m_simulationUniforms.useTerrain = glGetUniformLocation(simulationProgram, "bUseTerrain");
+	m_simulationUniforms.terrainHeights = glGetUniformLocation(simulationProgram, "terrainHeights");
+	m_simulationUniforms.terrainArea = glGetUniformLocation(simulationProgram, "terrainArea");
+
+	m_drawUniforms.view = glGetUniformLocation(drawProgram, "view");
+	m_drawUniforms.projection = glGetUniformLocation(drawProgram, "projection");
+	m_drawUniforms.aliveListOffset = glGetUniformLocation(drawProgram, "aliveListOffset");
+	m_drawUniforms.useTexture = glGetUniformLocation(drawProgram, "bUseTexture");
+	m_drawUniforms.texture = glGetUniformLocation(drawProgram, "particleTexture");
+	m_drawUniforms.color = glGetUniformLocation(drawProgram, "particleColor");
+
+	m_quadBuffer = GLResources::CreateBuffer(sizeof(g_QuadCorners), g_QuadCorners, BUFFER_STATIC, "particle quad vertices");
+	m_quadVao = GLResources::CreateVertexArray(m_quadBuffer, sizeof(GLfloat) * 2, g_QuadAttributes, 1, 0, "particle quad");
+	GpuMemory::TrackObject(GL_BUFFER, m_quadBuffer, GPU_MEMORY_BUFFERS, "particles", sizeof(g_QuadCorners));
+
+	// one count per effect is copied into each readback buffer
+	for (int i = 0; i < READBACK_FRAMES; i++)
+	{
+		m_readbackBuffers[i] = GLResources::CreateBuffer(sizeof(GLuint) * MAX_EFFECTS, nullptr, BUFFER_READBACK, "particle count readback");
+		GpuMemory::TrackObject(GL_BUFFER, m_readbackBuffers[i], GPU_MEMORY_BUFFERS, "particles", sizeof(GLuint) * MAX_EFFECTS);
+		m_readbackFences[i] = 0;
+	}
+	m_readbackIndex = 0;
+
+	m_groundTexture = 0;
+	m_groundTextureUnit = 0;
+	m_groundArea = glm::vec4(0.0f);
+	m_time = 0.0f;
+	m_updateCount = 0;
+}
+
+/***********************************************************
+ *  ~ParticleSystem()
+ *
+ *  The destructor for the class.  Clear() must have been
+ *  called while the OpenGL context was still current.
+ ***********************************************************/
+ParticleSystem::~ParticleSystem()
+{
+	m_effects.clear();
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the context
+ *  has compute shaders, shader storage buffers and
+ *  indirect dispatches, which are core since 4.3.
+ ***********************************************************/
+bool ParticleSystem::IsSupported()
+{
+	return (GLEW_VERSION_4_3 != 0);
+}
+
+/***********************************************************
+ *  AddEffect()
+ *
+ *  This method is used for creating the buffers of an
+ *  effect.  Every particle starts out free, so the free
+ *  list holds all of them and both alive lists are empty.
+ ***********************************************************/
+int ParticleSystem::AddEffect(
+	const PARTICLE_EFFECT_DESC& desc,
+	const std::vector<glm::vec4>& emitterSpheres,
+	const glm::vec3& areaMin,
+	const glm::vec3& areaMax)
+{
+	if (((int)m_effects.size() >= MAX_EFFECTS) || (desc.capacity <= 0))
+	{
+		return -1;
+	}
+
+	std::vector<GPU_EMITTER> emitters;
+	for (size_t i = 0; i < emitterSpheres.size(); i++)
+	{
+		GPU_EMITTER emitter;
+		emitter.centerRadius = emitterSpheres[i];
+		emitter.halfExtentType = glm::vec4(0.0f);
+		emitters.push_back(emitter);
+	}
+	if (emitters.empty())
+	{
+		GPU_EMITTER emitter;
+		emitter.centerRadius = glm::vec4((areaMin + areaMax) * 0.5f, 0.0f);
+		emitter.halfExtentType = glm::vec4((areaMax - areaMin) * 0.5f, 1.0f);
+		emitters.push_back(emitter);
+	}
+
+	std::vector<GLuint> deadList(desc.capacity);
+	for (int i = 0; i < desc.capacity; i++)
+	{
+		deadList[i] = (GLuint)i;
+	}
+
+	GPU_STATE state = {};
+	state.deadCount = (GLuint)desc.capacity;
+	// four corners of the quad per instance
+	state.drawArgs[0] = 4;
+
+	EFFECT effect;
+	effect.desc = desc;
+	effect.emitterCount = (GLuint)emitters.size();
+	effect.currentList = 0;
+	effect.emitRemainder = 0.0f;
+
+	// storage and contents of the buffers, in the order of
+	// PARTICLE_BUFFER
+	const uint64_t bufferBytes[BUFFER_COUNT] =
+	{
+		sizeof(GPU_PARTICLE) * desc.capacity, sizeof(GLuint) * deadList.size(), sizeof(GLuint) * 2 * desc.capacity,
+		sizeof(GPU_STATE), sizeof(GPU_EMITTER) * emitters.size()
+	};
+	const void* bufferData[BUFFER_COUNT] =
+	{
+		nullptr, deadList.data(), nullptr, &state, emitters.data()
+	};
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		effect.buffers[i] = GLResources::CreateBuffer((GLsizeiptr)bufferBytes[i], bufferData[i], g_EffectBufferUsages[i], g_EffectBufferLabels[i]);
+		GpuMemory::TrackObject(GL_BUFFER, effect.buffers[i], GPU_MEMORY_BUFFERS, "particles", bufferBytes[i]);
+	}
+
+	m_effects.push_back(effect);
+	return (int)m_effects.size() - 1;
+}
+
+/***********************************************************
+ *  SetGround()
+ *
+ *  This method is used for letting the particles land on
+ *  the terrain heights instead of the y = 0 plane.
+ ***********************************************************/
+void ParticleSystem::SetGround(GLuint heightTexture, GLint textureUnit, const glm::vec4& terrainArea)
+{
+	m_groundTexture = heightTexture;
+	m_groundTextureUnit = textureUnit;
+	m_groundArea = terrainArea;
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for freeing the buffers of every
+ *  effect, the shared objects and both programs.
+ ***********************************************************/
+void ParticleSystem::Clear()
+{
+	for (size_t i = 0; i < m_effects.size(); i++)
+	{
+		GpuMemory::ReleaseObjects(GL_BUFFER, m_effects[i].buffers, BUFFER_COUNT);
+		glDeleteBuffers(BUFFER_COUNT, m_effects[i].buffers);
+	}
+	m_effects.clear();
+
+	for (int i = 0; i < READBACK_FRAMES; i++)
+	{
+		if (m_readbackFences[i] != 0)
+		{
+			glDeleteSync(m_readbackFences[i]);
+			m_readbackFences[i] = 0;
+		}
+	}
+	if (m_readbackBuffers[0] != 0)
+	{
+		GpuMemory::ReleaseObjects(GL_BUFFER, m_readbackBuffers, READBACK_FRAMES);
+		glDeleteBuffers(READBACK_FRAMES, m_readbackBuffers);
+		for (int i = 0; i < READBACK_FRAMES; i++)
+		{
+			m_readbackBuffers[i] = 0;
+		}
+	}
+	if (m_quadVao != 0)
+	{
+		GpuMemory::ReleaseObject(GL_BUFFER, m_quadBuffer);
+		glDeleteBuffers(1, &m_quadBuffer);
+		glDeleteVertexArrays(1, &m_quadVao);
+		m_quadBuffer = 0;
+		m_quadVao = 0;
+	}
+	if (m_simulationProgram != 0)
+	{
+		glDeleteProgram(m_simulationProgram);
+		m_simulationProgram = 0;
+	}
+	if (m_drawProgram != 0)
+	{
+		glDeleteProgram(m_drawProgram);
+		m_drawProgram = 0;
+	}
+
+	m_groundTexture = 0;
+	m_aliveCount.store(0, std::memory_order_relaxed);
+}
+
+/***********************************************************
+ *  DispatchStage()
+ *
+ *  This method is used for running one stage of the
+ *  compute shader over the bound effect.  The emit and
+ *  simulate stages take their size from the arguments the
+ *  first stage wrote, the others run a single group.  Each
+ *  stage reads the counters and lists the one before wrote.
+ ***********************************************************/
+void ParticleSystem::DispatchStage(PARTICLE_STAGE stage) const
+{
+	glUniform1ui(m_simulationUniforms.stage, (GLuint)stage);
+
+	if (STAGE_EMIT == stage)
+	{
+		glDispatchComputeIndirect((GLintptr)offsetof(GPU_STATE, emitDispatch));
+	}
+	else if (STAGE_SIMULATE == stage)
+	{
+		glDispatchComputeIndirect((GLintptr)offsetof(GPU_STATE, simulateDispatch));
+	}
+	else
+	{
+		glDispatchCompute(1, 1, 1);
+	}
+
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+/***********************************************************
+ *  ReadAliveCounts()
+ *
+ *  This method is used for summing the alive counts of the
+ *  oldest copy in the ring, when the GPU has finished it.
+ *  The copy is about to be overwritten, so an unfinished
+ *  one is dropped and the previous sum is kept.
+ ***********************************************************/
+void ParticleSystem::ReadAliveCounts()
+{
+	GLsync fence = m_readbackFences[m_readbackIndex];
+	if (0 == fence)
+	{
+		return;
+	}
+
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	if ((GL_ALREADY_SIGNALED == result) || (GL_CONDITION_SATISFIED == result))
+	{
+		GLuint counts[MAX_EFFECTS];
+		glBindBuffer(GL_COPY_READ_BUFFER, m_readbackBuffers[m_readbackIndex]);
+		glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(GLuint) * m_effects.size(), counts);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+		int aliveCount = 0;
+		for (size_t i = 0; i < m_effects.size(); i++)
+		{
+			aliveCount += (int)counts[i];
+		}
+		m_aliveCount.store(aliveCount, std::memory_order_relaxed);
+	}
+
+	glDeleteSync(fence);
+	m_readbackFences[m_readbackIndex] = 0;
+}
+
+/***********************************************************
+ *  CopyAliveCounts()
+ *
+ *  This method is used for copying the alive count each
+ *  effect ended the update with into the next readback
+ *  buffer of the ring, behind a fence.
+ ***********************************************************/
+void ParticleSystem::CopyAliveCounts()
+{
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_readbackBuffers[m_readbackIndex]);
+	for (size_t i = 0; i < m_effects.size(); i++)
+	{
+		const EFFECT& effect = m_effects[i];
+		glBindBuffer(GL_COPY_READ_BUFFER, effect.buffers[BUFFER_STATE]);
+		glCopyBufferSubData(
+			GL_COPY_READ_BUFFER,
+			GL_COPY_WRITE_BUFFER,
+			(GLintptr)(offsetof(GPU_STATE, aliveCount) + sizeof(GLuint) * effect.currentList),
+			(GLintptr)(sizeof(GLuint) * i),
+			sizeof(GLuint));
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	m_readbackFences[m_readbackIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_readbackIndex = (m_readbackIndex + 1) % READBACK_FRAMES;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for emitting and simulating every
+ *  effect.  The CPU only decides how many particles each
+ *  effect asks for - the GPU clamps that to the free ones,
+ *  and every list and count stays on the GPU.
+ ***********************************************************/
+void ParticleSystem::Update(float seconds)
+{
+	if (m_effects.empty())
+	{
+		return;
+	}
+
+	ReadAliveCounts();
+
+	seconds = std::min(std::max(seconds, 0.0f), g_MaxTimeStep);
+	m_time += seconds;
+	m_updateCount++;
+
+	glUseProgram(m_simulationProgram);
+	glUniform1f(m_simulationUniforms.seconds, seconds);
+	glUniform1f(m_simulationUniforms.time, m_time);
+	glUniform1i(m_simulationUniforms.useTerrain, (m_groundTexture != 0) ? 1 : 0);
+	if (m_groundTexture != 0)
+	{
+		glActiveTexture(GL_TEXTURE0 + m_groundTextureUnit);
+		glBindTexture(GL_TEXTURE_2D, m_groundTexture);
+		glActiveTexture(GL_TEXTURE0);
+		glUniform1i(m_simulationUniforms.terrainHeights, m_groundTextureUnit);
+		glUniform4fv(m_simulationUniforms.terrainArea, 1, &m_groundArea[0]);
+	}
+
+	for (size_t i = 0; i < m_effects.size(); i++)
+	{
+		EFFECT& effect = m_effects[i];
+		const PARTICLE_EFFECT_DESC& desc = effect.desc;
+
+		float emit = desc.rate * seconds + effect.emitRemainder;
+		GLuint requestedEmit = (GLuint)std::min(emit, (float)desc.capacity);
+		effect.emitRemainder = emit - (float)requestedEmit;
+
+		glUniform1ui(m_simulationUniforms.currentList, effect.currentList);
+		glUniform1ui(m_simulationUniforms.capacity, (GLuint)desc.capacity);
+		glUniform1ui(m_simulationUniforms.requestedEmit, requestedEmit);
+		glUniform1ui(m_simulationUniforms.emitterCount, effect.emitterCount);
+		glUniform1ui(m_simulationUniforms.randomSeed, m_updateCount * 9781u + (GLuint)i * 6271u);
+		glUniform1f(m_simulationUniforms.lifetime, desc.lifetime);
+		glUniform2f(m_simulationUniforms.sizeRange, desc.sizeMin, desc.sizeMax);
+		glUniform1f(m_simulationUniforms.gravity, desc.gravity);
+		glUniform1f(m_simulationUniforms.drag, desc.drag);
+		glUniform2fv(m_simulationUniforms.wind, 1, &desc.wind[0]);
+		glUniform1f(m_simulationUniforms.gust, desc.gust);
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, effect.buffers[BUFFER_PARTICLES]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, effect.buffers[BUFFER_DEAD_LIST]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, effect.buffers[BUFFER_ALIVE_LISTS]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, effect.buffers[BUFFER_STATE]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, effect.buffers[BUFFER_EMITTERS]);
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, effect.buffers[BUFFER_STATE]);
+
+		DispatchStage(STAGE_BEGIN);
+		DispatchStage(STAGE_EMIT);
+		DispatchStage(STAGE_SIMULATE);
+		DispatchStage(STAGE_END);
+
+		// the list just written is drawn and read by the next update
+		effect.currentList = 1 - effect.currentList;
+	}
+
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+	glUseProgram(0);
+
+	// the draws and the copy read the lists and counts
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+	CopyAliveCounts();
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method is used for drawing the alive particles of
+ *  every effect, with one indirect draw of the quad whose
+ *  instance count the last update wrote.  The vertex
+ *  shader fetches the particle of each instance from the
+ *  alive list.
+ ***********************************************************/
+void ParticleSystem::Draw(const glm::mat4& view, const glm::mat4& projection) const
+{
+	if (m_effects.empty())
+	{
+		return;
+	}
+
+	glUseProgram(m_drawProgram);
+	glUniformMatrix4fv(m_drawUniforms.view, 1, GL_FALSE, &view[0][0]);
+	glUniformMatrix4fv(m_drawUniforms.projection, 1, GL_FALSE, &projection[0][0]);
+	glBindVertexArray(m_quadVao);
+
+	for (size_t i = 0; i < m_effects.size(); i++)
+	{
+		const EFFECT& effect = m_effects[i];
+		const PARTICLE_EFFECT_DESC& desc = effect.desc;
+
+		glUniform1ui(m_drawUniforms.aliveListOffset, effect.currentList * (GLuint)desc.capacity);
+		glUniform1i(m_drawUniforms.useTexture, (desc.textureUnit >= 0) ? 1 : 0);
+		if (desc.textureUnit >= 0)
+		{
+			glUniform1i(m_drawUniforms.texture, desc.textureUnit);
+		}
+		glUniform4fv(m_drawUniforms.color, 1, &desc.color[0]);
+
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, effect.buffers[BUFFER_PARTICLES]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, effect.buffers[BUFFER_ALIVE_LISTS]);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, effect.buffers[BUFFER_STATE]);
+		glDrawArraysIndirect(GL_TRIANGLE_STRIP, (const void*)offsetof(GPU_STATE, drawArgs));
+	}
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+	glUseProgram(0);
+}
@@ -0,0 +1,262 @@
+///////////////////////////////////////////////////////////////////////////////
+// particlesystem.h
+// ============
+// particle effects, like falling leaves, that are emitted, simulated and
+// compacted by a compute shader and drawn as instanced billboards, with no
+// per-particle work on the CPU
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  PARTICLE_EFFECT_DESC
+ *
+ *  The values an effect is created with.  The velocity of
+ *  a particle eases towards the wind at the rate of the
+ *  drag while the gravity pulls it down, so a particle
+ *  falls at gravity / drag once it has settled.
+ ***********************************************************/
+struct PARTICLE_EFFECT_DESC
+{
+	// most particles alive at once
+	int capacity;
+	// particles emitted per second and how long each lives
+	float rate;
+	float lifetime;
+	// range of the random size of a particle
+	float sizeMin;
+	float sizeMax;
+	float gravity;
+	float drag;
+	// steady wind in x z, and the strength of the gusts
+	glm::vec2 wind;
+	float gust;
+	// texture unit of the scene texture the particles are cut
+	// from, or -1 when the color is used
+	int textureUnit;
+	glm::vec4 color;
+};
+
+/***********************************************************
+ *  ParticleSystem
+ *
+ *  Every effect owns a pool of particles in a shader
+ *  storage buffer, with a list of the free particles and
+ *  two lists of the alive ones.  Every frame Update() runs
+ *  the particle compute shader over each effect in four
+ *  stages.  The first sizes the dispatches of the others
+ *  from the counters on the GPU, the emit stage takes free
+ *  particles and places them in a random emitter volume,
+ *  and the simulate stage moves every alive particle,
+ *  frees the expired ones and appends the others to the
+ *  second alive list, which compacts the pool.  The last
+ *  stage writes the instance count of the draw, so Draw()
+ *  issues one indirect draw per effect whatever the number
+ *  of particles.
+ *
+ *  The wind is a steady breeze with gusts from a noise
+ *  field that drifts over time.  Particles that reach the
+ *  ground, the terrain heights when SetGround() was called
+ *  and the y = 0 plane otherwise, come to rest there until
+ *  their lifetime runs out.
+ *
+ *  The number of alive particles is copied into a readback
+ *  buffer behind a fence and read a few frames later, only
+ *  to be reported, so the CPU never waits for the GPU.
+ *
+ *  All methods except GetAliveCount() must run on the
+ *  thread that owns the OpenGL context.
+ ***********************************************************/
+class ParticleSystem
+{
+public:
+	// constructor - takes ownership of the simulation and the
+	// draw program
+	ParticleSystem(GLuint simulationProgram, GLuint drawProgram);
+	// destructor
+	~ParticleSystem();
+
+	// true when the context supports compute shaders
+	static bool IsSupported();
+
+	// add an effect emitting from the passed in spheres, as
+	// center and radius, or from the box when no spheres are
+	// passed - particles start in the upper half of a sphere,
+	// like the crown of a tree, or anywhere in the box -
+	// returns its index, or -1 when it has no room
+	int AddEffect(
+		const PARTICLE_EFFECT_DESC& desc,
+		const std::vector<glm::vec4>& emitterSpheres,
+		const glm::vec3& areaMin,
+		const glm::vec3& areaMax);
+
+	// let the particles land on the terrain - the area is x z
+	// of the lowest corner, side length and samples per side
+	void SetGround(GLuint heightTexture, GLint textureUnit, const glm::vec4& terrainArea);
+
+	// free every effect and both programs
+	void Clear();
+
+	int GetEffectCount() const { return (int)m_effects.size(); }
+	// particles alive a few frames ago, summed over every
+	// effect - safe to call from any thread
+	int GetAliveCount() const { return m_aliveCount.load(std::memory_order_relaxed); }
+
+	// emit and simulate every effect for the passed in time
+	// step - leaves no program in use
+	void Update(float seconds);
+	// draw the alive particles of every effect - leaves no
+	// program in use
+	void Draw(const glm::mat4& view, const glm::mat4& projection) const;
+
+private:
+	// GPU side layouts, matching the particle shaders
+	struct GPU_PARTICLE
+	{
+		// position and size
+		glm::vec4 positionSize;
+		// velocity and age
+		glm::vec4 velocityAge;
+		// angle, spin speed, lifetime, and 1 once landed
+		glm::vec4 spin;
+	};
+
+	// sphere center and radius, and the half extent of a box
+	// with 1 in w, or 0 in w for a sphere
+	struct GPU_EMITTER
+	{
+		glm::vec4 centerRadius;
+		glm::vec4 halfExtentType;
+	};
+
+	// counters and indirect arguments of one effect, written
+	// by the compute stages
+	struct GPU_STATE
+	{
+		GLuint deadCount;
+		GLuint aliveCount[2];
+		GLuint emitCount;
+		GLuint emitDispatch[4];
+		GLuint simulateDispatch[4];
+		// count, instance count, first and base instance
+		GLuint drawArgs[4];
+	};
+
+	enum PARTICLE_BUFFER
+	{
+		BUFFER_PARTICLES = 0,
+		BUFFER_DEAD_LIST,
+		BUFFER_ALIVE_LISTS,
+		BUFFER_STATE,
+		BUFFER_EMITTERS,
+		BUFFER_COUNT
+	};
+
+	enum PARTICLE_STAGE
+	{
+		STAGE_BEGIN = 0,
+		STAGE_EMIT,
+		STAGE_SIMULATE,
+		STAGE_END
+	};
+
+	struct EFFECT
+	{
+		PARTICLE_EFFECT_DESC desc;
+		GLuint buffers[BUFFER_COUNT];
+		GLuint emitterCount;
+		// alive list the next update reads, the other one is
+		// written, and the last draw reads the one written
+		GLuint currentList;
+		// fraction of a particle carried over to the next
+		// update, so that low rates still emit
+		float emitRemainder;
+	};
+
+	struct SIMULATION_UNIFORMS
+	{
+		GLint stage;
+		GLint currentList;
+		GLint capacity;
+		GLint requestedEmit;
+		GLint emitterCount;
+		GLint seconds;
+		GLint time;
+		GLint randomSeed;
+		GLint lifetime;
+		GLint sizeRange;
+		GLint gravity;
+		GLint drag;
+		GLint wind;
+		GLint gust;
+		GLint useTerrain;
+		GLint terrainHeights;
+		GLint terrainArea;
+	};
+
+	struct DRAW_UNIFORMS
+	{
+		GLint view;
+		GLint projection;
+		GLint aliveListOffset;
+		GLint useTexture;
+		GLint texture;
+		GLint color;
+	};
+
+	// frames the alive count is read back behind
+	static const int READBACK_FRAMES = 3;
+	// effects the readback buffers have room for
+	static const int MAX_EFFECTS = 16;
+	// invocations of one compute work group
+	static const GLuint PARTICLE_GROUP_SIZE = 64;
+
+	std::vector<EFFECT> m_effects;
+
+	GLuint m_simulationProgram;
+	GLuint m_drawProgram;
+	SIMULATION_UNIFORMS m_simulationUniforms;
+	DRAW_UNIFORMS m_drawUniforms;
+
+	// billboard quad shared by every effect
+	GLuint m_quadVao;
+	GLuint m_quadBuffer;
+
+	// ground the particles land on
+	GLuint m_groundTexture;
+	GLint m_groundTextureUnit;
+	glm::vec4 m_groundArea;
+
+	// time since the first update and number of updates,
+	// which drift the wind and seed the random numbers
+	float m_time;
+	uint32_t m_updateCount;
+
+	// ring of buffers the alive counts are copied into, with
+	// the fence of the copy in each
+	GLuint m_readbackBuffers[READBACK_FRAMES];
+	GLsync m_readbackFences[READBACK_FRAMES];
+	int m_readbackIndex;
+	std::atomic<int> m_aliveCount;
+
+	// run one stage of the compute shader
+	void DispatchStage(PARTICLE_STAGE stage) const;
+	// sum the alive counts of a finished copy, and copy the
+	// counts of this update into the next buffer of the ring
+	void ReadAliveCounts();
+	void CopyAliveCounts();
+
+	// systems own GL objects and must not be copied
+	ParticleSystem(const ParticleSystem&) = delete;
+	ParticleSystem& operator=(const ParticleSystem&) = delete;
+};
@@ -0,0 +1,1142 @@
+///////////////////////////////////////////////////////////////////////////////
+// pathtracer.cpp
+// ============
+// offline path tracer of the scene file, spread over all of the cores by the
+// job system, for reference images and stills on machines without a GPU
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PathTracer.h"
+#include "ShapeMeshes.h"
+#include "ImageWriter.h"
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	const float g_Pi = 3.14159265358979f;
+
+	// bins the triangle centers are sorted into when looking
+	// for the cheapest split of a node
+	const int g_SahBinCount = 16;
+	// depth after which nodes are split at the median, which
+	// bounds the depth of the hierarchy for any triangles
+	const int g_MedianSplitDepth = 32;
+
+	// color of the camera rays that leave the scene, the clear
+	// color of the raster scene
+	const glm::vec3 g_BackgroundColor(0.0f, 0.0f, 1.0f);
+	// bounce from which paths are ended at random when they
+	// carry little light, and the highest survival chance
+	const int g_RussianRouletteBounce = 2;
+	const float g_MaxSurvival = 0.95f;
+
+	// hit points are moved this far off the surface, relative
+	// to their distance from the origin, so the rays leaving
+	// them do not hit the surface again
+	const float g_RayOffset = 1.0e-4f;
+
+	// seconds between the progress reports
+	const double g_ReportSeconds = 2.0;
+
+	// advance a PCG random number generator and return a
+	// number from 0 up to but not including 1
+	float NextRandom(uint64_t& state)
+	{
+		state = state * 6364136223846793005ull + 1442695040888963407ull;
+		uint32_t shifted = (uint32_t)(((state >> 18u) ^ state) >> 27u);
+		uint32_t rotation = (uint32_t)(state >> 59u);
+		uint32_t value = (shifted >> rotation) | (shifted << ((32u - rotation) & 31u));
+		return (float)(value >> 8) * (1.0f / 16777216.0f);
+	}
+
+	// start value of the generator of one pixel in one pass
+	uint64_t SeedRandom(uint32_t pixel, uint32_t pass)
+	{
+		uint64_t value = ((uint64_t)pass << 32) | pixel;
+		value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+		value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+		return value ^ (value >> 31);
+	}
+
+	float Luminance(const glm::vec3& color)
+	{
+		return glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+	}
+
+	// two directions at right angles to a unit vector
+	void BuildBasis(const glm::vec3& normal, glm::vec3& tangent, glm::vec3& bitangent)
+	{
+		float sign = (normal.z >= 0.0f) ? 1.0f : -1.0f;
+		float a = -1.0f / (sign + normal.z);
+		float b = normal.x * normal.y * a;
+		tangent = glm::vec3(1.0f + sign * normal.x * normal.x * a, sign * b, -sign * normal.x);
+		bitangent = glm::vec3(b, sign + normal.y * normal.y * a, -normal.y);
+	}
+
+	// direction around an axis whose angle has the passed in
+	// cosine and a random turn
+	glm::vec3 DirectionAround(const glm::vec3& axis, float cosine, float turn)
+	{
+		glm::vec3 tangent;
+		glm::vec3 bitangent;
+		BuildBasis(axis, tangent, bitangent);
+		float sine = std::sqrt(std::max(0.0f, 1.0f - cosine * cosine));
+		float angle = 2.0f * g_Pi * turn;
+		return glm::normalize(tangent * (std::cos(angle) * sine) + bitangent * (std::sin(angle) * sine) + axis * cosine);
+	}
+
+	float SurfaceArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(0.0f));
+		return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+	}
+
+	// inverse of a direction, with the zero components made
+	// tiny instead so the box tests never divide by zero
+	glm::vec3 SafeInverse(const glm::vec3& direction)
+	{
+		glm::vec3 inverse;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float value = direction[axis];
+			if (std::fabs(value) < 1.0e-20f)
+			{
+				value = (value < 0.0f) ? -1.0e-20f : 1.0e-20f;
+			}
+			inverse[axis] = 1.0f / value;
+		}
+		return inverse;
+	}
+
+	bool HasExtension(const char* filename, const char* extension)
+	{
+		std::string name(filename);
+		std::string suffix(extension);
+		if (name.size() < suffix.size())
+		{
+			return false;
+		}
+		std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+		return (name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0);
+	}
+}
+
+/***********************************************************
+ *  PathTracer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+PathTracer::PathTracer(JobSystem* pJobSystem, const PATH_TRACER_SETTINGS& settings)
+	: m_rayCount(0)
+{
+	m_pJobSystem = pJobSystem;
+	m_settings = settings;
+	m_skyColor = glm::vec3(0.0f);
+	std::memset(&m_view, 0, sizeof(m_view));
+	m_pass = 0;
+	m_tilesPerRow = 0;
+	m_cameraRight = glm::vec3(1.0f, 0.0f, 0.0f);
+	m_cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
+	m_cameraForward = glm::vec3(0.0f, 0.0f, -1.0f);
+}
+
+/***********************************************************
+ *  ~PathTracer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+PathTracer::~PathTracer()
+{
+}
+
+/***********************************************************
+ *  BuildScene()
+ *
+ *  This method is used for turning the instances of the
+ *  scene geometry into world space triangles and the
+ *  surfaces into reflectances.  Surfaces without a material
+ *  get a white diffuse lobe, so that they still reflect the
+ *  color of the object.
+ ***********************************************************/
+bool PathTracer::BuildScene(const SceneFile& sceneFile)
+{
+	m_triangles.clear();
+	m_surfaces.clear();
+	m_lights.clear();
+	m_nodes.clear();
+	m_leaves.clear();
+	m_skyColor = glm::vec3(0.0f);
+
+	if (m_geometry.Build(sceneFile) == false)
+	{
+		return false;
+	}
+
+	const std::vector<GEOMETRY_MATERIAL>& materials = m_geometry.GetMaterials();
+	for (const GEOMETRY_SURFACE& geometrySurface : m_geometry.GetSurfaces())
+	{
+		SURFACE surface;
+		surface.texture = geometrySurface.texture;
+		surface.color = glm::vec3(geometrySurface.color);
+		surface.UVscale = geometrySurface.UVscale;
+		surface.diffuse = glm::vec3(1.0f);
+		surface.specular = glm::vec3(0.0f);
+		surface.shininess = 1.0f;
+		if (geometrySurface.material >= 0)
+		{
+			const GEOMETRY_MATERIAL& material = materials[geometrySurface.material];
+			surface.diffuse = material.diffuseColor;
+			surface.specular = material.specularColor;
+			surface.shininess = std::max(material.shininess, 0.0f);
+		}
+		m_surfaces.push_back(surface);
+	}
+
+	m_triangles.reserve(m_geometry.GetTriangleCount());
+	for (const GEOMETRY_INSTANCE& instance : m_geometry.GetInstances())
+	{
+		AddMesh(m_geometry.GetMeshes()[instance.mesh], instance.modelMatrix, instance.surface);
+	}
+
+	for (const GEOMETRY_LIGHT& geometryLight : m_geometry.GetLights())
+	{
+		LIGHT light;
+		light.bDirectional = geometryLight.bDirectional;
+		light.vector = geometryLight.bDirectional ? -glm::normalize(geometryLight.vector) : geometryLight.vector;
+		light.diffuse = geometryLight.diffuse;
+		light.specular = geometryLight.specular;
+		m_lights.push_back(light);
+
+		m_skyColor += geometryLight.ambient;
+	}
+
+	std::chrono::steady_clock::time_point buildStart = std::chrono::steady_clock::now();
+	BuildHierarchy();
+	std::chrono::duration<double, std::milli> buildTime = std::chrono::steady_clock::now() - buildStart;
+
+	std::cout << "INFO: Path tracer scene - " << m_triangles.size() << " triangles, " << m_nodes.size()
+		<< " nodes and " << m_leaves.size() << " leaves built in " << buildTime.count() << " ms" << std::endl;
+
+	return true;
+}
+
+/***********************************************************
+ *  AddMesh()
+ *
+ *  This method is used for adding the triangles of a mesh,
+ *  moved into the world by a model matrix.  The normals
+ *  are moved by the inverse transpose, so they stay at
+ *  right angles to scaled surfaces.
+ ***********************************************************/
+void PathTracer::AddMesh(const GEOMETRY_MESH& mesh, const glm::mat4& modelMatrix, int surface)
+{
+	glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(modelMatrix)));
+
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+	{
+		TRIANGLE triangle;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			const float* vertex = &mesh.vertices[mesh.indices[i + corner] * ShapeMeshes::FLOATS_PER_MESH_VERTEX];
+			triangle.positions[corner] = glm::vec3(modelMatrix * glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f));
+			triangle.normals[corner] = normalMatrix * glm::vec3(vertex[3], vertex[4], vertex[5]);
+			triangle.textureCoordinates[corner] = glm::vec2(vertex[6], vertex[7]);
+		}
+		triangle.surface = surface;
+		m_triangles.push_back(triangle);
+	}
+}
+
+/***********************************************************
+ *  BuildHierarchy()
+ *
+ *  This method is used for building a binary hierarchy
+ *  over the triangles with the surface area heuristic and
+ *  collapsing it into the four wide hierarchy the rays are
+ *  traced through.
+ ***********************************************************/
+void PathTracer::BuildHierarchy()
+{
+	size_t triangleCount = m_triangles.size();
+	std::vector<glm::vec3> centers(triangleCount);
+	std::vector<glm::vec3> boundsMin(triangleCount);
+	std::vector<glm::vec3> boundsMax(triangleCount);
+	std::vector<int> order(triangleCount);
+	for (size_t i = 0; i < triangleCount; i++)
+	{
+		const TRIANGLE& triangle = m_triangles[i];
+		boundsMin[i] = glm::min(triangle.positions[0], glm::min(triangle.positions[1], triangle.positions[2]));
+		boundsMax[i] = glm::max(triangle.positions[0], glm::max(triangle.positions[1], triangle.positions[2]));
+		centers[i] = (boundsMin[i] + boundsMax[i]) * 0.5f;
+		order[i] = (int)i;
+	}
+
+	std::vector<BUILD_NODE> nodes;
+	nodes.reserve(triangleCount / 2 + 1);
+	int root = BuildNode(nodes, order, centers, boundsMin, boundsMax, 0, (int)triangleCount, 0);
+
+	m_nodes.clear();
+	m_leaves.clear();
+	m_nodes.reserve(nodes.size() / 3 + 1);
+	m_leaves.reserve(nodes.size() / 2 + 1);
+	CollapseNode(nodes, order, root);
+}
+
+/***********************************************************
+ *  BuildNode()
+ *
+ *  This method is used for building the binary node over a
+ *  range of the triangle order.  The range is split where
+ *  the surface area heuristic, evaluated at the borders of
+ *  a number of bins along the longest axis of the triangle
+ *  centers, finds it cheapest.  Leaves hold at most one SSE
+ *  lane of triangles each.
+ ***********************************************************/
+int PathTracer::BuildNode(std::vector<BUILD_NODE>& nodes, std::vector<int>& order, const std::vector<glm::vec3>& centers,
+	const std::vector<glm::vec3>& boundsMin, const std::vector<glm::vec3>& boundsMax, int first, int count, int depth)
+{
+	BUILD_NODE node;
+	node.boundsMin = glm::vec3(FLT_MAX);
+	node.boundsMax = glm::vec3(-FLT_MAX);
+	glm::vec3 centerMin(FLT_MAX);
+	glm::vec3 centerMax(-FLT_MAX);
+	for (int i = first; i < first + count; i++)
+	{
+		node.boundsMin = glm::min(node.boundsMin, boundsMin[order[i]]);
+		node.boundsMax = glm::max(node.boundsMax, boundsMax[order[i]]);
+		centerMin = glm::min(centerMin, centers[order[i]]);
+		centerMax = glm::max(centerMax, centers[order[i]]);
+	}
+	node.children[0] = -1;
+	node.children[1] = -1;
+	node.first = first;
+	node.count = count;
+
+	int nodeIndex = (int)nodes.size();
+	nodes.push_back(node);
+	if (count <= LEAF_TRIANGLES)
+	{
+		return nodeIndex;
+	}
+
+	glm::vec3 centerExtent = centerMax - centerMin;
+	int axis = 0;
+	if (centerExtent.y > centerExtent[axis])
+	{
+		axis = 1;
+	}
+	if (centerExtent.z > centerExtent[axis])
+	{
+		axis = 2;
+	}
+
+	int middle = first + count / 2;
+	if ((centerExtent[axis] > 0.0f) && (depth < g_MedianSplitDepth))
+	{
+		struct BIN
+		{
+			glm::vec3 boundsMin;
+			glm::vec3 boundsMax;
+			int count;
+		};
+		BIN bins[g_SahBinCount];
+		for (BIN& bin : bins)
+		{
+			bin.boundsMin = glm::vec3(FLT_MAX);
+			bin.boundsMax = glm::vec3(-FLT_MAX);
+			bin.count = 0;
+		}
+
+		float binScale = (float)g_SahBinCount / centerExtent[axis];
+		auto binOf = [&](int triangle)
+		{
+			int bin = (int)((centers[triangle][axis] - centerMin[axis]) * binScale);
+			return std::min(bin, g_SahBinCount - 1);
+		};
+		for (int i = first; i < first + count; i++)
+		{
+			BIN& bin = bins[binOf(order[i])];
+			bin.boundsMin = glm::min(bin.boundsMin, boundsMin[order[i]]);
+			bin.boundsMax = glm::max(bin.boundsMax, boundsMax[order[i]]);
+			bin.count++;
+		}
+
+		// cost of every split from the areas on both sides
+		float rightCost[g_SahBinCount];
+		glm::vec3 sideMin(FLT_MAX);
+		glm::vec3 sideMax(-FLT_MAX);
+		int sideCount = 0;
+		for (int i = g_SahBinCount - 1; i > 0; i--)
+		{
+			sideMin = glm::min(sideMin, bins[i].boundsMin);
+			sideMax = glm::max(sideMax, bins[i].boundsMax);
+			sideCount += bins[i].count;
+			rightCost[i] = (sideCount > 0) ? SurfaceArea(sideMin, sideMax) * (float)sideCount : 0.0f;
+		}
+
+		float bestCost = FLT_MAX;
+		int bestSplit = -1;
+		sideMin = glm::vec3(FLT_MAX);
+		sideMax = glm::vec3(-FLT_MAX);
+		sideCount = 0;
+		for (int i = 1; i < g_SahBinCount; i++)
+		{
+			sideMin = glm::min(sideMin, bins[i - 1].boundsMin);
+			sideMax = glm::max(sideMax, bins[i - 1].boundsMax);
+			sideCount += bins[i - 1].count;
+			if ((sideCount == 0) || (sideCount == count))
+			{
+				continue;
+			}
+			float cost = SurfaceArea(sideMin, sideMax) * (float)sideCount + rightCost[i];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestSplit = i;
+			}
+		}
+
+		if (bestSplit > 0)
+		{
+			int* splitPoint = std::partition(&order[first], &order[first] + count,
+				[&](int triangle) { return binOf(triangle) < bestSplit; });
+			middle = (int)(splitPoint - &order[0]);
+		}
+		else
+		{
+			std::nth_element(&order[first], &order[middle], &order[first] + count,
+				[&](int a, int b) { return centers[a][axis] < centers[b][axis]; });
+		}
+	}
+	else
+	{
+		std::nth_element(&order[first], &order[middle], &order[first] + count,
+			[&](int a, int b) { return centers[a][axis] < centers[b][axis]; });
+	}
+
+	int leftChild = BuildNode(nodes, order, centers, boundsMin, boundsMax, first, middle - first, depth + 1);
+	int rightChild = BuildNode(nodes, order, centers, boundsMin, boundsMax, middle, first + count - middle, depth + 1);
+	nodes[nodeIndex].children[0] = leftChild;
+	nodes[nodeIndex].children[1] = rightChild;
+	return nodeIndex;
+}
+
+/***********************************************************
+ *  CollapseNode()
+ *
+ *  This method is used for turning a binary node into a
+ *  four wide node.  The inner child with the largest
+ *  surface area is replaced by its two children until the
+ *  node has four children or only leaves are left, which
+ *  keeps the boxes most rays enter close to the root.
+ ***********************************************************/
+int PathTracer::CollapseNode(const std::vector<BUILD_NODE>& nodes, const std::vector<int>& order, int buildNode)
+{
+	int children[4] = { buildNode, -1, -1, -1 };
+	int childCount = 1;
+	if (nodes[buildNode].children[0] >= 0)
+	{
+		children[0] = nodes[buildNode].children[0];
+		children[1] = nodes[buildNode].children[1];
+		childCount = 2;
+	}
+	while (childCount < 4)
+	{
+		int largest = -1;
+		float largestArea = -1.0f;
+		for (int i = 0; i < childCount; i++)
+		{
+			const BUILD_NODE& child = nodes[children[i]];
+			float area = SurfaceArea(child.boundsMin, child.boundsMax);
+			if ((child.children[0] >= 0) && (area > largestArea))
+			{
+				largest = i;
+				largestArea = area;
+			}
+		}
+		if (largest < 0)
+		{
+			break;
+		}
+		const BUILD_NODE& expanded = nodes[children[largest]];
+		children[childCount++] = expanded.children[1];
+		children[largest] = expanded.children[0];
+	}
+
+	int nodeIndex = (int)m_nodes.size();
+	m_nodes.push_back(BVH4_NODE());
+	for (int i = 0; i < 4; i++)
+	{
+		// unused lanes get boxes no ray can enter
+		glm::vec3 boundsMin(FLT_MAX);
+		glm::vec3 boundsMax(-FLT_MAX);
+		int32_t link = 0;
+		if (i < childCount)
+		{
+			const BUILD_NODE& child = nodes[children[i]];
+			boundsMin = child.boundsMin;
+			boundsMax = child.boundsMax;
+			if (child.children[0] >= 0)
+			{
+				link = CollapseNode(nodes, order, children[i]);
+			}
+			else
+			{
+				BVH4_LEAF leaf;
+				std::memset(&leaf, 0, sizeof(leaf));
+				for (int lane = 0; lane < LEAF_TRIANGLES; lane++)
+				{
+					leaf.triangleIDs[lane] = -1;
+					if (lane >= child.count)
+					{
+						continue;
+					}
+					int triangleID = order[child.first + lane];
+					const TRIANGLE& triangle = m_triangles[triangleID];
+					glm::vec3 edge1 = triangle.positions[1] - triangle.positions[0];
+					glm::vec3 edge2 = triangle.positions[2] - triangle.positions[0];
+					leaf.cornerX[lane] = triangle.positions[0].x;
+					leaf.cornerY[lane] = triangle.positions[0].y;
+					leaf.cornerZ[lane] = triangle.positions[0].z;
+					leaf.edge1X[lane] = edge1.x;
+					leaf.edge1Y[lane] = edge1.y;
+					leaf.edge1Z[lane] = edge1.z;
+					leaf.edge2X[lane] = edge2.x;
+					leaf.edge2Y[lane] = edge2.y;
+					leaf.edge2Z[lane] = edge2.z;
+					leaf.triangleIDs[lane] = triangleID;
+				}
+				link = ~(int32_t)m_leaves.size();
+				m_leaves.push_back(leaf);
+			}
+		}
+
+		BVH4_NODE& node = m_nodes[nodeIndex];
+		node.boundsMinX[i] = boundsMin.x;
+		node.boundsMinY[i] = boundsMin.y;
+		node.boundsMinZ[i] = boundsMin.z;
+		node.boundsMaxX[i] = boundsMax.x;
+		node.boundsMaxY[i] = boundsMax.y;
+		node.boundsMaxZ[i] = boundsMax.z;
+		node.children[i] = link;
+	}
+	return nodeIndex;
+}
+
+/***********************************************************
+ *  Intersect()
+ *
+ *  This method is used for finding the nearest triangle a
+ *  ray hits.  Each node tests the ray against its four
+ *  boxes at once, taking the near and far planes by the
+ *  signs of the direction so that the empty lanes are
+ *  never entered, and the children are visited nearest
+ *  first.  Each leaf tests four triangles at once with the
+ *  Moller-Trumbore test, from both sides.
+ ***********************************************************/
+bool PathTracer::Intersect(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RAY_HIT& hit) const
+{
+	hit.distance = maxDistance;
+	hit.triangle = -1;
+	if (m_nodes.empty())
+	{
+		return false;
+	}
+
+	glm::vec3 inverse = SafeInverse(direction);
+	__m128 originX = _mm_set1_ps(origin.x);
+	__m128 originY = _mm_set1_ps(origin.y);
+	__m128 originZ = _mm_set1_ps(origin.z);
+	__m128 inverseX = _mm_set1_ps(inverse.x);
+	__m128 inverseY = _mm_set1_ps(inverse.y);
+	__m128 inverseZ = _mm_set1_ps(inverse.z);
+	__m128 directionX = _mm_set1_ps(direction.x);
+	__m128 directionY = _mm_set1_ps(direction.y);
+	__m128 directionZ = _mm_set1_ps(direction.z);
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 epsilon = _mm_set1_ps(1.0e-12f);
+	__m128 absoluteMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+	// rows of the node boxes holding the near planes, the far
+	// planes being three rows further or back
+	int nearRowX = (inverse.x >= 0.0f) ? 0 : 3;
+	int nearRowY = (inverse.y >= 0.0f) ? 1 : 4;
+	int nearRowZ = (inverse.z >= 0.0f) ? 2 : 5;
+
+	struct STACK_ENTRY
+	{
+		int32_t link;
+		float distance;
+	};
+	STACK_ENTRY stack[3 * MAX_DEPTH + 4];
+	int stackSize = 0;
+	stack[stackSize++] = { 0, 0.0f };
+
+	while (stackSize > 0)
+	{
+		STACK_ENTRY entry = stack[--stackSize];
+		if (entry.distance > hit.distance)
+		{
+			continue;
+		}
+
+		if (entry.link < 0)
+		{
+			const BVH4_LEAF& leaf = m_leaves[~entry.link];
+			__m128 edge1X = _mm_loadu_ps(leaf.edge1X);
+			__m128 edge1Y = _mm_loadu_ps(leaf.edge1Y);
+			__m128 edge1Z = _mm_loadu_ps(leaf.edge1Z);
+			__m128 edge2X = _mm_loadu_ps(leaf.edge2X);
+			__m128 edge2Y = _mm_loadu_ps(leaf.edge2Y);
+			__m128 edge2Z = _mm_loadu_ps(leaf.edge2Z);
+
+			__m128 pX = _mm_sub_ps(_mm_mul_ps(directionY, edge2Z), _mm_mul_ps(directionZ, edge2Y));
+			__m128 pY = _mm_sub_ps(_mm_mul_ps(directionZ, edge2X), _mm_mul_ps(directionX, edge2Z));
+			__m128 pZ = _mm_sub_ps(_mm_mul_ps(directionX, edge2Y), _mm_mul_ps(directionY, edge2X));
+			__m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edge1X, pX), _mm_mul_ps(edge1Y, pY)), _mm_mul_ps(edge1Z, pZ));
+			__m128 inverseDeterminant = _mm_div_ps(one, determinant);
+
+			__m128 tX = _mm_sub_ps(originX, _mm_loadu_ps(leaf.cornerX));
+			__m128 tY = _mm_sub_ps(originY, _mm_loadu_ps(leaf.cornerY));
+			__m128 tZ = _mm_sub_ps(originZ, _mm_loadu_ps(leaf.cornerZ));
+			__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tX, pX), _mm_mul_ps(tY, pY)), _mm_mul_ps(tZ, pZ)), inverseDeterminant);
+
+			__m128 qX = _mm_sub_ps(_mm_mul_ps(tY, edge1Z), _mm_mul_ps(tZ, edge1Y));
+			__m128 qY = _mm_sub_ps(_mm_mul_ps(tZ, edge1X), _mm_mul_ps(tX, edge1Z));
+			__m128 qZ = _mm_sub_ps(_mm_mul_ps(tX, edge1Y), _mm_mul_ps(tY, edge1X));
+			__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(directionX, qX), _mm_mul_ps(directionY, qY)), _mm_mul_ps(directionZ, qZ)), inverseDeterminant);
+			__m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(edge2X, qX), _mm_mul_ps(edge2Y, qY)), _mm_mul_ps(edge2Z, qZ)), inverseDeterminant);
+
+			__m128 mask = _mm_cmpgt_ps(_mm_and_ps(determinant, absoluteMask), epsilon);
+			mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+			mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+			mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), one));
+			mask = _mm_and_ps(mask, _mm_cmpgt_ps(t, zero));
+			mask = _mm_and_ps(mask, _mm_cmplt_ps(t, _mm_set1_ps(hit.distance)));
+
+			int hits = _mm_movemask_ps(mask);
+			if (hits != 0)
+			{
+				float distances[4];
+				float us[4];
+				float vs[4];
+				_mm_storeu_ps(distances, t);
+				_mm_storeu_ps(us, u);
+				_mm_storeu_ps(vs, v);
+				for (int lane = 0; lane < 4; lane++)
+				{
+					if (((hits >> lane) & 1) && (distances[lane] < hit.distance))
+					{
+						hit.distance = distances[lane];
+						hit.triangle = leaf.triangleIDs[lane];
+						hit.u = us[lane];
+						hit.v = vs[lane];
+					}
+				}
+			}
+			continue;
+		}
+
+		const BVH4_NODE& node = m_nodes[entry.link];
+		const float* rows = node.boundsMinX;
+		__m128 nearX = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(rows + nearRowX * 4), originX), inverseX);
+		__m128 nearY = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(rows + nearRowY * 4), originY), inverseY);
+		__m128 nearZ = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(rows + nearRowZ * 4), originZ), inverseZ);
+		__m128 farX = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(rows + ((nearRowX + 3) % 6) * 4), originX), inverseX);
+		__m128 farY = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(rows + ((nearRowY + 3) % 6) * 4), originY), inverseY);
+		__m128 farZ = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(rows + ((nearRowZ + 3) % 6) * 4), originZ), inverseZ);
+		__m128 entryDistance = _mm_max_ps(_mm_max_ps(nearX, nearY), _mm_max_ps(nearZ, zero));
+		__m128 exitDistance = _mm_min_ps(_mm_min_ps(farX, farY), _mm_min_ps(farZ, _mm_set1_ps(hit.distance)));
+		int entered = _mm_movemask_ps(_mm_cmple_ps(entryDistance, exitDistance));
+		if (entered == 0)
+		{
+			continue;
+		}
+
+		// push the entered children farthest first, so the
+		// nearest is taken off the stack next
+		float distances[4];
+		_mm_storeu_ps(distances, entryDistance);
+		STACK_ENTRY children[4];
+		int childCount = 0;
+		for (int lane = 0; lane < 4; lane++)
+		{
+			if ((entered >> lane) & 1)
+			{
+				STACK_ENTRY child = { node.children[lane], distances[lane] };
+				int position = childCount++;
+				while ((position > 0) && (children[position - 1].distance < child.distance))
+				{
+					children[position] = children[position - 1];
+					position--;
+				}
+				children[position] = child;
+			}
+		}
+		for (int i = 0; i < childCount; i++)
+		{
+			stack[stackSize++] = children[i];
+		}
+	}
+
+	return (hit.triangle >= 0);
+}
+
+/***********************************************************
+ *  IsOccluded()
+ *
+ *  This method is used for testing a shadow ray, which can
+ *  stop at the first triangle it hits in any order.
+ ***********************************************************/
+bool PathTracer::IsOccluded(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const
+{
+	if (m_nodes.empty())
+	{
+		return false;
+	}
+
+	glm::vec3 inverse = SafeInverse(direction);
+	__m128 originX = _mm_set1_ps(origin.x);
+	__m128 originY = _mm_set1_ps(origin.y);
+	__m128 originZ = _mm_set1_ps(origin.z);
+	__m128 inverseX = _mm_set1_ps(inverse.x);
+	__m128 inverseY = _mm_set1_ps(inverse.y);
+	__m128 inverseZ = _mm_set1_ps(inverse.z);
+	__m128 directionX = _mm_set1_ps(direction.x);
+	__m128 directionY = _mm_set1_ps(direction.y);
+	__m128 directionZ = _mm_set1_ps(direction.z);
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 epsilon = _mm_set1_ps(1.0e-12f);
+	__m128 absoluteMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	__m128 distanceLimit = _mm_set1_ps(maxDistance);
+
+	int nearRowX = (inverse.x >= 0.0f) ? 0 : 3;
+	int nearRowY = (inverse.y >= 0.0f) ? 1 : 4;
+	int nearRowZ = (inverse.z >= 0.0f) ? 2 : 5;
+
+	int32_t stack[3 * MAX_DEPTH + 4];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		int32_t link = stack[--stackSize];
+
+		if (link < 0)
+		{
+			const BVH4_LEAF& leaf = m_leaves[~link];
+			__m128 edge1X = _mm_loadu_ps(leaf.edge1X);
+			__m128 edge1Y = _mm_loadu_ps(leaf.edge1Y);
+			__m128 edge1Z = _mm_loadu_ps(leaf.edge1Z);
+			__m128 edge2X = _mm_loadu_ps(leaf.edge2X);
+			__m128 edge2Y = _mm_loadu_ps(leaf.edge2Y);
+			__m128 edge2Z = _mm_loadu_ps(leaf.edge2Z);
+
+			__m128 pX = _mm_sub_ps(_mm_mul_ps(directionY, edge2Z), _mm_mul_ps(directionZ, edge2Y));
+			__m128 pY = _mm_sub_ps(_mm_mul_ps(directionZ, edge2X), _mm_mul_ps(directionX, edge2Z));
+			__m128 pZ = _mm_sub_ps(_mm_mul_ps(directionX, edge2Y), _mm_mul_ps(directionY, edge2X));
+			__m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edge1X, pX), _mm_mul_ps(edge1Y, pY)), _mm_mul_ps(edge1Z, pZ));
+			__m128 inverseDeterminant = _mm_div_ps(one, determinant);
+
+			__m128 tX = _mm_sub_ps(originX, _mm_loadu_ps(leaf.cornerX));
+			__m128 tY = _mm_sub_ps(originY, _mm_loadu_ps(leaf.cornerY));
+			__m128 tZ = _mm_sub_ps(originZ, _mm_loadu_ps(leaf.cornerZ));
+			__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tX, pX), _mm_mul_ps(tY, pY)), _mm_mul_ps(tZ, pZ)), inverseDeterminant);
+
+			__m128 qX = _mm_sub_ps(_mm_mul_ps(tY, edge1Z), _mm_mul_ps(tZ, edge1Y));
+			__m128 qY = _mm_sub_ps(_mm_mul_ps(tZ, edge1X), _mm_mul_ps(tX, edge1Z));
+			__m128 qZ = _mm_sub_ps(_mm_mul_ps(tX, edge1Y), _mm_mul_ps(tY, edge1X));
+			__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(directionX, qX), _mm_mul_ps(directionY, qY)), _mm_mul_ps(directionZ, qZ)), inverseDeterminant);
+			__m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(edge2X, qX), _mm_mul_ps(edge2Y, qY)), _mm_mul_ps(edge2Z, qZ)), inverseDeterminant);
+
+			__m128 mask = _mm_cmpgt_ps(_mm_and_ps(determinant, absoluteMask), epsilon);
+			mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+			mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+			mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), one));
+			mask = _mm_and_ps(mask, _mm_cmpgt_ps(t, zero));
+			mask = _mm_and_ps(mask, _mm_cmplt_ps(t, distanceLimit));
+			if (_mm_movemask_ps(mask) != 0)
+			{
+				return true;
+			}
+			continue;
+		}
+
+		const BVH4_NODE& node = m_nodes[link];
+		const float* rows = node.boundsMinX;
+		__m128 nearX = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(rows + nearRowX * 4), originX), inverseX);
+		__m128 nearY = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(rows + nearRowY * 4), originY), inverseY);
+		__m128 nearZ = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(rows + nearRowZ * 4), originZ), inverseZ);
+		__m128 farX = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(rows + ((nearRowX + 3) % 6) * 4), originX), inverseX);
+		__m128 farY = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(rows + ((nearRowY + 3) % 6) * 4), originY), inverseY);
+		__m128 farZ = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(rows + ((nearRowZ + 3) % 6) * 4), originZ), inverseZ);
+		__m128 entryDistance = _mm_max_ps(_mm_max_ps(nearX, nearY), _mm_max_ps(nearZ, zero));
+		__m128 exitDistance = _mm_min_ps(_mm_min_ps(farX, farY), _mm_min_ps(farZ, distanceLimit));
+		int entered = _mm_movemask_ps(_mm_cmple_ps(entryDistance, exitDistance));
+		for (int lane = 0; lane < 4; lane++)
+		{
+			if ((entered >> lane) & 1)
+			{
+				stack[stackSize++] = node.children[lane];
+			}
+		}
+	}
+
+	return false;
+}
+
+/***********************************************************
+ *  RenderImage()
+ *
+ *  This method is used for rendering the scene one pass of
+ *  one sample per pixel at a time, with the tiles of every
+ *  pass spread over the job system.  Progress and the rays
+ *  traced per second are reported as the passes finish,
+ *  and the image is written at every checkpoint and once
+ *  all of the samples are taken.
+ ***********************************************************/
+bool PathTracer::RenderImage(const RENDER_VIEW& view, const char* filename)
+{
+	const PATH_TRACER_SETTINGS& settings = m_settings;
+	if ((view.width <= 0) || (view.height <= 0) || (settings.samplesPerPixel <= 0) || (settings.maxBounces <= 0))
+	{
+		std::cout << "ERROR: The path tracer needs a size, samples and bounces above 0" << std::endl;
+		return false;
+	}
+	if (m_nodes.empty())
+	{
+		std::cout << "ERROR: The path tracer has no scene to render" << std::endl;
+		return false;
+	}
+
+	m_view = view;
+	m_cameraForward = glm::normalize(view.cameraFront);
+	m_cameraRight = glm::normalize(glm::cross(m_cameraForward, view.cameraUp));
+	m_cameraUp = glm::cross(m_cameraRight, m_cameraForward);
+	m_accumulation.assign((size_t)view.width * view.height, glm::vec3(0.0f));
+	m_tilesPerRow = (view.width + TILE_SIZE - 1) / TILE_SIZE;
+	int tileCount = m_tilesPerRow * ((view.height + TILE_SIZE - 1) / TILE_SIZE);
+	m_rayCount = 0;
+
+	TILE_RANGE tileBody;
+	tileBody.pTracer = this;
+
+	std::chrono::steady_clock::time_point renderStart = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point lastReport = renderStart;
+	std::chrono::steady_clock::time_point lastCheckpoint = renderStart;
+	for (m_pass = 0; m_pass < settings.samplesPerPixel; m_pass++)
+	{
+		m_pJobSystem->ParallelFor(0, tileCount, 1, tileBody);
+
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (std::chrono::duration<double>(now - lastReport).count() >= g_ReportSeconds)
+		{
+			double seconds = std::chrono::duration<double>(now - renderStart).count();
+			std::cout << "INFO: Path tracer - pass " << (m_pass + 1) << " of " << settings.samplesPerPixel << ", "
+				<< (double)m_rayCount.load() / seconds / 1.0e6 << " million rays per second" << std::endl;
+			lastReport = now;
+		}
+		if ((settings.checkpointSeconds > 0.0f) && (m_pass + 1 < settings.samplesPerPixel) &&
+			(std::chrono::duration<double>(now - lastCheckpoint).count() >= settings.checkpointSeconds))
+		{
+			// the image so far, with the passes finished
+			m_pass++;
+			WriteImage(filename);
+			m_pass--;
+			lastCheckpoint = now;
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - renderStart).count();
+	std::cout << "INFO: Path traced " << view.width << "x" << view.height << " with "
+		<< settings.samplesPerPixel << " samples per pixel in " << seconds << " s - " << m_rayCount.load()
+		<< " rays, " << (double)m_rayCount.load() / seconds / 1.0e6 << " million rays per second" << std::endl;
+
+	return WriteImage(filename);
+}
+
+/***********************************************************
+ *  RenderTile()
+ *
+ *  This method is used for adding one sample to every
+ *  pixel of a tile.  The paths of the tile are traced as a
+ *  stream - every bounce traces all of the paths still
+ *  alive before any of them is shaded, and the rays after
+ *  the camera rays are grouped by the octant of their
+ *  direction, so rays through the same nodes run together.
+ ***********************************************************/
+void PathTracer::RenderTile(int tile)
+{
+	int tileX = (tile % m_tilesPerRow) * TILE_SIZE;
+	int tileY = (tile / m_tilesPerRow) * TILE_SIZE;
+	int tileWidth = std::min(TILE_SIZE, m_view.width - tileX);
+	int tileHeight = std::min(TILE_SIZE, m_view.height - tileY);
+
+	float tanHalfField = std::tan(glm::radians(m_view.fieldOfView) * 0.5f);
+	float aspectRatio = (float)m_view.width / (float)m_view.height;
+
+	std::vector<PATH> paths((size_t)tileWidth * tileHeight);
+	std::vector<PATH> sortedPaths(paths.size());
+	std::vector<RAY_HIT> hits(paths.size());
+	std::vector<glm::vec3> radiance(paths.size(), glm::vec3(0.0f));
+	for (int y = 0; y < tileHeight; y++)
+	{
+		for (int x = 0; x < tileWidth; x++)
+		{
+			int local = y * tileWidth + x;
+			int pixelX = tileX + x;
+			int pixelY = tileY + y;
+
+			PATH& path = paths[local];
+			path.pixel = local;
+			path.random = SeedRandom((uint32_t)(pixelY * m_view.width + pixelX), (uint32_t)m_pass);
+			path.throughput = glm::vec3(1.0f);
+			path.origin = m_view.cameraPosition;
+
+			// a random point inside the pixel, the top row first
+			float screenX = ((pixelX + NextRandom(path.random)) / m_view.width * 2.0f - 1.0f) * tanHalfField * aspectRatio;
+			float screenY = (1.0f - (pixelY + NextRandom(path.random)) / m_view.height * 2.0f) * tanHalfField;
+			path.direction = glm::normalize(m_cameraForward + m_cameraRight * screenX + m_cameraUp * screenY);
+		}
+	}
+
+	uint64_t rayCount = 0;
+	for (int bounce = 0; !paths.empty(); bounce++)
+	{
+		if (bounce > 0)
+		{
+			int octantStarts[9] = { 0 };
+			for (const PATH& path : paths)
+			{
+				int octant = (path.direction.x < 0.0f ? 1 : 0) | (path.direction.y < 0.0f ? 2 : 0) | (path.direction.z < 0.0f ? 4 : 0);
+				octantStarts[octant + 1]++;
+			}
+			for (int i = 1; i < 9; i++)
+			{
+				octantStarts[i] += octantStarts[i - 1];
+			}
+			sortedPaths.resize(paths.size());
+			for (const PATH& path : paths)
+			{
+				int octant = (path.direction.x < 0.0f ? 1 : 0) | (path.direction.y < 0.0f ? 2 : 0) | (path.direction.z < 0.0f ? 4 : 0);
+				sortedPaths[octantStarts[octant]++] = path;
+			}
+			paths.swap(sortedPaths);
+		}
+
+		for (size_t i = 0; i < paths.size(); i++)
+		{
+			Intersect(paths[i].origin, paths[i].direction, FLT_MAX, hits[i]);
+		}
+		rayCount += paths.size();
+
+		size_t alive = 0;
+		for (size_t i = 0; i < paths.size(); i++)
+		{
+			PATH& path = paths[i];
+			if (hits[i].triangle < 0)
+			{
+				radiance[path.pixel] += path.throughput * ((bounce == 0) ? g_BackgroundColor : m_skyColor);
+				continue;
+			}
+			if (ShadePath(path, hits[i], bounce, radiance[path.pixel], rayCount))
+			{
+				paths[alive++] = path;
+			}
+		}
+		paths.resize(alive);
+	}
+
+	// every pixel belongs to one tile, so no other job writes it
+	for (int y = 0; y < tileHeight; y++)
+	{
+		for (int x = 0; x < tileWidth; x++)
+		{
+			m_accumulation[(size_t)(tileY + y) * m_view.width + tileX + x] += radiance[y * tileWidth + x];
+		}
+	}
+	m_rayCount.fetch_add(rayCount, std::memory_order_relaxed);
+}
+
+/***********************************************************
+ *  ShadePath()
+ *
+ *  This method is used for adding the light the lights
+ *  send along a path to the surface it hit, and for
+ *  sampling the next direction of the path.  The surface
+ *  reflects with a Lambert lobe of its color and a
+ *  normalized Phong lobe of its specular color.  The light
+ *  values are what a white surface facing the light
+ *  reflects, as in the scene shader.
+ ***********************************************************/
+bool PathTracer::ShadePath(PATH& path, const RAY_HIT& hit, int bounce, glm::vec3& radiance, uint64_t& rayCount) const
+{
+	const TRIANGLE& triangle = m_triangles[hit.triangle];
+	const SURFACE& surface = m_surfaces[triangle.surface];
+	float w = 1.0f - hit.u - hit.v;
+
+	glm::vec3 position = triangle.positions[0] * w + triangle.positions[1] * hit.u + triangle.positions[2] * hit.v;
+	glm::vec3 geometricNormal = glm::cross(triangle.positions[1] - triangle.positions[0], triangle.positions[2] - triangle.positions[0]);
+	geometricNormal = glm::normalize(geometricNormal);
+	if (glm::dot(geometricNormal, path.direction) > 0.0f)
+	{
+		geometricNormal = -geometricNormal;
+	}
+	glm::vec3 normal = triangle.normals[0] * w + triangle.normals[1] * hit.u + triangle.normals[2] * hit.v;
+	float normalLength = glm::length(normal);
+	normal = (normalLength > 0.0f) ? (normal / normalLength) : geometricNormal;
+	if (glm::dot(normal, geometricNormal) < 0.0f)
+	{
+		normal = -normal;
+	}
+
+	glm::vec3 color = surface.color;
+	if (surface.texture >= 0)
+	{
+		glm::vec2 textureCoordinate = triangle.textureCoordinates[0] * w + triangle.textureCoordinates[1] * hit.u + triangle.textureCoordinates[2] * hit.v;
+		color = glm::vec3(m_geometry.SampleTexture(surface.texture, textureCoordinate * surface.UVscale));
+	}
+	glm::vec3 diffuse = color * surface.diffuse;
+	glm::vec3 specular = surface.specular;
+	float shininess = surface.shininess;
+	glm::vec3 toViewer = -path.direction;
+	glm::vec3 origin = position + geometricNormal * (g_RayOffset * (1.0f + glm::length(position)));
+
+	// light from every light the surface can see
+	for (const LIGHT& light : m_lights)
+	{
+		glm::vec3 toLight = light.vector;
+		float distance = FLT_MAX;
+		if (light.bDirectional == false)
+		{
+			toLight = light.vector - origin;
+			distance = glm::length(toLight);
+			if (distance <= 0.0f)
+			{
+				continue;
+			}
+			toLight /= distance;
+		}
+
+		float cosine = glm::dot(normal, toLight);
+		if ((cosine <= 0.0f) || (glm::dot(geometricNormal, toLight) <= 0.0f))
+		{
+			continue;
+		}
+		rayCount++;
+		if (IsOccluded(origin, toLight, distance))
+		{
+			continue;
+		}
+
+		float reflection = std::max(glm::dot(glm::reflect(-toLight, normal), toViewer), 0.0f);
+		glm::vec3 glossy = specular * ((shininess + 2.0f) * 0.5f * std::pow(reflection, shininess));
+		radiance += path.throughput * (diffuse * light.diffuse + glossy * light.specular) * cosine;
+	}
+
+	if (bounce + 1 >= m_settings.maxBounces)
+	{
+		return false;
+	}
+
+	// pick one of the two lobes by how much each reflects
+	float diffuseWeight = Luminance(diffuse);
+	float specularWeight = Luminance(specular);
+	if (diffuseWeight + specularWeight <= 0.0f)
+	{
+		return false;
+	}
+	float diffuseChance = diffuseWeight / (diffuseWeight + specularWeight);
+
+	glm::vec3 direction;
+	if (NextRandom(path.random) < diffuseChance)
+	{
+		// cosine weighted, which leaves the color as the weight
+		direction = DirectionAround(normal, std::sqrt(NextRandom(path.random)), NextRandom(path.random));
+		path.throughput *= diffuse / diffuseChance;
+	}
+	else
+	{
+		// around the mirror direction by the Phong lobe
+		glm::vec3 mirror = glm::reflect(path.direction, normal);
+		direction = DirectionAround(mirror, std::pow(NextRandom(path.random), 1.0f / (shininess + 1.0f)), NextRandom(path.random));
+		float cosine = glm::dot(normal, direction);
+		if (cosine <= 0.0f)
+		{
+			return false;
+		}
+		path.throughput *= specular * ((shininess + 2.0f) / (shininess + 1.0f) * cosine / (1.0f - diffuseChance));
+	}
+	if (glm::dot(geometricNormal, direction) <= 0.0f)
+	{
+		return false;
+	}
+
+	// end the paths that carry little light at random, and
+	// brighten the survivors by the same chance
+	if (bounce >= g_RussianRouletteBounce)
+	{
+		float survival = std::min(std::max(path.throughput.x, std::max(path.throughput.y, path.throughput.z)), g_MaxSurvival);
+		if (NextRandom(path.random) >= survival)
+		{
+			return false;
+		}
+		path.throughput /= survival;
+	}
+
+	path.origin = origin;
+	path.direction = direction;
+	return true;
+}
+
+/***********************************************************
+ *  WriteImage()
+ *
+ *  This method is used for writing the average of the
+ *  passes finished so far.  EXR files keep the radiance as
+ *  it is, PNG files clamp it to 0 to 1 without a gamma
+ *  curve, like the raster scene shows it.
+ ***********************************************************/
+bool PathTracer::WriteImage(const char* filename) const
+{
+	float scale = 1.0f / (float)std::max(m_pass, 1);
+	size_t pixelCount = m_accumulation.size();
+
+	if (HasExtension(filename, ".exr"))
+	{
+		std::vector<float> pixels(pixelCount * 3);
+		for (size_t i = 0; i < pixelCount; i++)
+		{
+			for (int channel = 0; channel < 3; channel++)
+			{
+				pixels[i * 3 + channel] = m_accumulation[i][channel] * scale;
+			}
+		}
+		return ImageWriter::WriteExr(filename, m_view.width, m_view.height, pixels.data());
+	}
+
+	std::vector<unsigned char> pixels(pixelCount * 3);
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		for (int channel = 0; channel < 3; channel++)
+		{
+			float value = glm::clamp(m_accumulation[i][channel] * scale, 0.0f, 1.0f);
+			pixels[i * 3 + channel] = (unsigned char)(value * 255.0f + 0.5f);
+		}
+	}
+	return ImageWriter::WritePng(filename, m_view.width, m_view.height, pixels.data());
+}
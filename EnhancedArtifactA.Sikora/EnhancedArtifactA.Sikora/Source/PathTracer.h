@@ -0,0 +1,238 @@
+///////////////////////////////////////////////////////////////////////////////
+// pathtracer.h
+// ============
+// offline path tracer of the scene file, spread over all of the cores by the
+// job system, for reference images and stills on machines without a GPU
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+#include "RenderBackend.h"
+#include "SceneGeometry.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  PATH_TRACER_SETTINGS
+ *
+ *  Quality of the rendered images.
+ ***********************************************************/
+struct PATH_TRACER_SETTINGS
+{
+	// samples per pixel, one progressive pass each
+	int samplesPerPixel;
+	// surfaces a path bounces off before it is ended
+	int maxBounces;
+	// seconds between the images written while rendering,
+	// or 0 to write only the finished image
+	float checkpointSeconds;
+};
+
+/***********************************************************
+ *  PathTracer
+ *
+ *  The instances of the scene geometry are turned into
+ *  world space triangles, with the textures, materials and
+ *  lights the raster scene is drawn with.
+ *  A path is lit by shadow rays to every light at every
+ *  bounce and by the sky it escapes to, the sky being the
+ *  sum of the ambient colors of the lights, so the ambient
+ *  term of the scene shader becomes real bounced light.
+ *  The lights do not fall off with distance, as in the
+ *  scene shader, so the two images can be compared.
+ *
+ *  The triangles are held in a four wide bounding volume
+ *  hierarchy whose nodes and leaves are laid out so that
+ *  one ray is tested against four boxes or four triangles
+ *  with each SSE instruction.  The image is cut into tiles
+ *  that the job system spreads over the cores, and every
+ *  tile traces its paths as a stream, one bounce at a
+ *  time, with the rays of a bounce grouped by direction so
+ *  that rays running through the same nodes follow each
+ *  other.  Every pass adds one sample per pixel to the
+ *  accumulated image, which can be written at any point.
+ ***********************************************************/
+class PathTracer : public RenderBackend
+{
+public:
+	// constructor
+	PathTracer(JobSystem* pJobSystem, const PATH_TRACER_SETTINGS& settings);
+	// destructor
+	~PathTracer();
+
+	const char* GetName() const override { return "path tracer"; }
+	// build the triangles, surfaces and lights of a loaded
+	// scene file
+	bool BuildScene(const SceneFile& sceneFile) override;
+	// render the scene progressively and write the image
+	bool RenderImage(const RENDER_VIEW& view, const char* filename) override;
+
+	int GetTriangleCount() const { return (int)m_triangles.size(); }
+	int GetNodeCount() const { return (int)m_nodes.size(); }
+
+private:
+	// size of the square tiles the image is rendered in
+	static constexpr int TILE_SIZE = 32;
+	// triangles per leaf, one SSE lane each
+	static constexpr int LEAF_TRIANGLES = 4;
+	// deepest binary hierarchy the build goes to
+	static constexpr int MAX_DEPTH = 64;
+
+	// four child boxes in structure of arrays form, a child
+	// below zero being the bitwise not of a leaf index
+	struct BVH4_NODE
+	{
+		float boundsMinX[4];
+		float boundsMinY[4];
+		float boundsMinZ[4];
+		float boundsMaxX[4];
+		float boundsMaxY[4];
+		float boundsMaxZ[4];
+		int32_t children[4];
+	};
+
+	// the corner and the two edges of four triangles, with
+	// -1 as the ID of the lanes that hold no triangle
+	struct BVH4_LEAF
+	{
+		float cornerX[4];
+		float cornerY[4];
+		float cornerZ[4];
+		float edge1X[4];
+		float edge1Y[4];
+		float edge1Z[4];
+		float edge2X[4];
+		float edge2Y[4];
+		float edge2Z[4];
+		int32_t triangleIDs[4];
+	};
+
+	// values of a triangle only needed once it is hit
+	struct TRIANGLE
+	{
+		glm::vec3 positions[3];
+		glm::vec3 normals[3];
+		glm::vec2 textureCoordinates[3];
+		int surface;
+	};
+
+	// reflectance of a surface of the scene geometry, with a
+	// white diffuse lobe where no material is set
+	struct SURFACE
+	{
+		int texture;
+		glm::vec3 color;
+		glm::vec2 UVscale;
+		glm::vec3 diffuse;
+		glm::vec3 specular;
+		float shininess;
+	};
+
+	struct LIGHT
+	{
+		bool bDirectional;
+		// direction towards the light, or its position
+		glm::vec3 vector;
+		glm::vec3 diffuse;
+		glm::vec3 specular;
+	};
+
+	// node of the binary hierarchy the wide one is built from
+	struct BUILD_NODE
+	{
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		int children[2];
+		int first;
+		int count;
+	};
+
+	struct RAY_HIT
+	{
+		float distance;
+		int triangle;
+		float u;
+		float v;
+	};
+
+	// one path of a tile stream
+	struct PATH
+	{
+		glm::vec3 origin;
+		glm::vec3 direction;
+		glm::vec3 throughput;
+		int pixel;
+		uint64_t random;
+	};
+
+	// range body handed to the job system for rendering tiles
+	struct TILE_RANGE
+	{
+		PathTracer* pTracer;
+		void operator()(int first, int last) const
+		{
+			for (int tile = first; tile < last; tile++)
+			{
+				pTracer->RenderTile(tile);
+			}
+		}
+	};
+
+	JobSystem* m_pJobSystem;
+	PATH_TRACER_SETTINGS m_settings;
+
+	SceneGeometry m_geometry;
+	std::vector<TRIANGLE> m_triangles;
+	std::vector<SURFACE> m_surfaces;
+	std::vector<LIGHT> m_lights;
+	glm::vec3 m_skyColor;
+
+	std::vector<BVH4_NODE> m_nodes;
+	std::vector<BVH4_LEAF> m_leaves;
+
+	// state of the render in progress
+	RENDER_VIEW m_view;
+	int m_pass;
+	int m_tilesPerRow;
+	glm::vec3 m_cameraRight;
+	glm::vec3 m_cameraUp;
+	glm::vec3 m_cameraForward;
+	std::vector<glm::vec3> m_accumulation;
+	std::atomic<uint64_t> m_rayCount;
+
+	// add the triangles of one mesh moved by a model matrix
+	void AddMesh(const GEOMETRY_MESH& mesh, const glm::mat4& modelMatrix, int surface);
+
+	// build the binary hierarchy over the triangles and
+	// collapse it into the four wide one
+	void BuildHierarchy();
+	int BuildNode(std::vector<BUILD_NODE>& nodes, std::vector<int>& order, const std::vector<glm::vec3>& centers,
+		const std::vector<glm::vec3>& boundsMin, const std::vector<glm::vec3>& boundsMax, int first, int count, int depth);
+	int CollapseNode(const std::vector<BUILD_NODE>& nodes, const std::vector<int>& order, int buildNode);
+
+	// nearest triangle a ray hits before the passed in distance
+	bool Intersect(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RAY_HIT& hit) const;
+	// true when anything lies on a ray before the distance
+	bool IsOccluded(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const;
+
+	// render one sample of every pixel of a tile
+	void RenderTile(int tile);
+	// light arriving along a path at the surface it hit, and
+	// the next direction of the path, false when it ends
+	bool ShadePath(PATH& path, const RAY_HIT& hit, int bounce, glm::vec3& radiance, uint64_t& rayCount) const;
+
+	// write the accumulated image
+	bool WriteImage(const char* filename) const;
+
+	// the tracer holds large buffers that must not be copied
+	PathTracer(const PathTracer&) = delete;
+	PathTracer& operator=(const PathTracer&) = delete;
+};
@@ -0,0 +1,59 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderbackend.h
+// ============
+// interface of the renderers that draw a scene file into an image without
+// an OpenGL context
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneFile.h"
+
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  RENDER_VIEW
+ *
+ *  Image size and camera of one rendered image.  The camera
+ *  values have the meaning they have in the Camera class,
+ *  the field of view being vertical, in degrees, and the
+ *  clip planes those of the perspective projection of the
+ *  view manager.
+ ***********************************************************/
+struct RENDER_VIEW
+{
+	int width;
+	int height;
+	glm::vec3 cameraPosition;
+	glm::vec3 cameraFront;
+	glm::vec3 cameraUp;
+	float fieldOfView;
+	float nearPlane;
+	float farPlane;
+};
+
+/***********************************************************
+ *  RenderBackend
+ *
+ *  A renderer that needs no GPU.  The scene file is turned
+ *  into the data of the backend once, after which any
+ *  number of images can be rendered from it, each written
+ *  to an EXR file when its name ends in .exr and to a PNG
+ *  file otherwise.  The interactive window keeps drawing
+ *  with OpenGL through the scene manager.
+ ***********************************************************/
+class RenderBackend
+{
+public:
+	virtual ~RenderBackend() {}
+
+	// name of the backend for the console output
+	virtual const char* GetName() const = 0;
+	// build the data of the backend from a loaded scene file
+	virtual bool BuildScene(const SceneFile& sceneFile) = 0;
+	// render the scene from a view and write the image
+	virtual bool RenderImage(const RENDER_VIEW& view, const char* filename) = 0;
+};
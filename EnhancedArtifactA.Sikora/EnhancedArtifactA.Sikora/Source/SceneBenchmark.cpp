@@ -0,0 +1,112 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebenchmark.cpp
+// ============
+// time compiling and loading a binary scene file with a large number of
+// generated objects
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneBenchmark.h"
+#include "SceneFile.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	typedef std::chrono::duration<double, std::milli> MILLISECONDS;
+
+	// files written by the benchmark, next to the scenes
+	const char* g_BenchmarkTextFile = "scenes/benchmark.scene";
+	const char* g_BenchmarkBinaryFile = "scenes/benchmark.bin";
+	// distance between the generated objects
+	const float g_ObjectSpacing = 2.0f;
+
+	/***********************************************************
+	 *  WriteScene()
+	 *
+	 *  Writes the base scene followed by the generated
+	 *  objects, on a square grid around the origin.
+	 ***********************************************************/
+	bool WriteScene(const char* baseSceneFilename, int objectCount)
+	{
+		std::ifstream baseScene(baseSceneFilename);
+		std::ofstream scene(g_BenchmarkTextFile);
+		if (!baseScene.is_open() || !scene.is_open())
+		{
+			return false;
+		}
+
+		std::string line;
+		while (std::getline(baseScene, line))
+		{
+			scene << line << "\n";
+		}
+
+		int side = (int)std::ceil(std::sqrt((double)objectCount));
+		for (int i = 0; i < objectCount; i++)
+		{
+			float x = (float)(i % side - side / 2) * g_ObjectSpacing;
+			float z = (float)(i / side - side / 2) * g_ObjectSpacing;
+			scene << "object sphere scale 0.5 0.5 0.5 position " << x << " 0.5 " << z
+				<< " color 0.4 0.6 0.3 1\n";
+		}
+
+		return scene.good();
+	}
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for timing the compile and the
+ *  loads of a scene with the generated objects.
+ ***********************************************************/
+bool SceneBenchmark::Run(const char* baseSceneFilename, int objectCount, int repetitions)
+{
+	if (!WriteScene(baseSceneFilename, objectCount))
+	{
+		std::cout << "ERROR: The benchmark scene could not be written from " << baseSceneFilename << std::endl;
+		std::remove(g_BenchmarkTextFile);
+		return false;
+	}
+
+	std::chrono::steady_clock::time_point compileStart = std::chrono::steady_clock::now();
+	bool bCompiled = SceneFile::CompileText(g_BenchmarkTextFile, g_BenchmarkBinaryFile);
+	std::chrono::steady_clock::time_point compileEnd = std::chrono::steady_clock::now();
+
+	bool bLoaded = bCompiled;
+	uint32_t loadedObjects = 0;
+	double loadTime = 0.0;
+	for (int i = 0; (i < repetitions) && bLoaded; i++)
+	{
+		SceneFile sceneFile;
+		std::chrono::steady_clock::time_point loadStart = std::chrono::steady_clock::now();
+		bLoaded = sceneFile.Load(g_BenchmarkBinaryFile);
+		std::chrono::steady_clock::time_point loadEnd = std::chrono::steady_clock::now();
+		loadTime += MILLISECONDS(loadEnd - loadStart).count();
+		loadedObjects = sceneFile.GetObjectCount();
+	}
+
+	std::remove(g_BenchmarkTextFile);
+	std::remove(g_BenchmarkBinaryFile);
+
+	if (bLoaded == false)
+	{
+		std::cout << "ERROR: The benchmark scene could not be compiled and loaded" << std::endl;
+		return false;
+	}
+
+	std::cout << "INFO: Scene of " << loadedObjects << " objects - compiled in "
+		<< MILLISECONDS(compileEnd - compileStart).count() << " ms, loaded in "
+		<< loadTime / repetitions << " ms on average over " << repetitions << " loads" << std::endl;
+
+	return true;
+}
@@ -0,0 +1,29 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebenchmark.h
+// ============
+// time compiling and loading a binary scene file with a large number of
+// generated objects
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/***********************************************************
+ *  SceneBenchmark
+ *
+ *  A text scene is written with every line of a base scene
+ *  and a number of generated objects spread over a square,
+ *  and compiled into a binary scene once.  Loading the
+ *  binary scene is then timed over a number of
+ *  repetitions, and the average is reported.  Both files
+ *  are deleted afterwards.
+ ***********************************************************/
+namespace SceneBenchmark
+{
+	// time loading the base scene with objectCount objects
+	// added, returns false when the scene cannot be written,
+	// compiled or loaded
+	bool Run(const char* baseSceneFilename, int objectCount, int repetitions);
+}
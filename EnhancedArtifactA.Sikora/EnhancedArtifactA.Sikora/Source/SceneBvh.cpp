@@ -0,0 +1,764 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebvh.cpp
+// ============
+// bounding volume hierarchy over the bounds of the scene objects, for ray
+// casts, frustum queries and nearest object queries that do not scan
+// every object
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneBvh.h"
+#include "SceneUtilities.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <utility>
+
+// declaration of global variables
+namespace
+{
+	// cost of visiting a node, relative to testing an object,
+	// used by the surface area heuristic
+	const float g_TraversalCost = 1.0f;
+
+	// stand-in for the inverse of a zero ray direction, large
+	// enough to push the slab out of reach without making a
+	// product with zero undefined
+	const float g_LargeInverse = 1.0e30f;
+
+	float SurfaceArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		glm::vec3 size = glm::max(boundsMax - boundsMin, glm::vec3(0.0f));
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	// distance along the ray at which it enters the bounds, or
+	// false when it misses them before the passed in distance
+	bool IntersectRayBounds(
+		const glm::vec3& boundsMin,
+		const glm::vec3& boundsMax,
+		const glm::vec3& origin,
+		const glm::vec3& inverseDirection,
+		float maxDistance,
+		float& entry)
+	{
+		glm::vec3 slabNear = (boundsMin - origin) * inverseDirection;
+		glm::vec3 slabFar = (boundsMax - origin) * inverseDirection;
+		glm::vec3 enter = glm::min(slabNear, slabFar);
+		glm::vec3 leave = glm::max(slabNear, slabFar);
+
+		entry = std::max(std::max(enter.x, enter.y), std::max(enter.z, 0.0f));
+		float exit = std::min(std::min(leave.x, leave.y), std::min(leave.z, maxDistance));
+		return (entry <= exit);
+	}
+
+	float DistanceSquaredToBounds(const glm::vec3& point, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		glm::vec3 outside = glm::max(glm::max(boundsMin - point, point - boundsMax), glm::vec3(0.0f));
+		return glm::dot(outside, outside);
+	}
+
+	// classify bounds against the frustum planes left in the
+	// mask - returns false when they are outside one plane, and
+	// clears the bits of the planes they are fully inside
+	bool TestFrustumPlanes(const glm::vec4* planes, const glm::vec3& boundsMin, const glm::vec3& boundsMax, uint32_t& planeMask)
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			if ((planeMask & (1u << i)) == 0)
+			{
+				continue;
+			}
+
+			glm::vec3 normal(planes[i]);
+			glm::vec3 farCorner(
+				(normal.x >= 0.0f) ? boundsMax.x : boundsMin.x,
+				(normal.y >= 0.0f) ? boundsMax.y : boundsMin.y,
+				(normal.z >= 0.0f) ? boundsMax.z : boundsMin.z);
+			if (glm::dot(normal, farCorner) + planes[i].w < 0.0f)
+			{
+				return false;
+			}
+
+			glm::vec3 nearCorner(
+				(normal.x >= 0.0f) ? boundsMin.x : boundsMax.x,
+				(normal.y >= 0.0f) ? boundsMin.y : boundsMax.y,
+				(normal.z >= 0.0f) ? boundsMin.z : boundsMax.z);
+			if (glm::dot(normal, nearCorner) + planes[i].w >= 0.0f)
+			{
+				planeMask &= ~(1u << i);
+			}
+		}
+		return true;
+	}
+}
+
+/***********************************************************
+ *  SceneBvh()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneBvh::SceneBvh()
+{
+	m_depth = 0;
+	m_builtRootArea = 0.0f;
+	m_builtCost = 0.0f;
+}
+
+/***********************************************************
+ *  ~SceneBvh()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneBvh::~SceneBvh()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  AddObject()
+ *
+ *  This method is used for adding an object by its world
+ *  space bounds.  The ID is the order the objects were
+ *  added in.
+ ***********************************************************/
+int SceneBvh::AddObject(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	OBJECT_BOUNDS object;
+	object.boundsMin = boundsMin;
+	object.boundsMax = boundsMax;
+	m_objects.push_back(object);
+
+	return (int)m_objects.size() - 1;
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing every object and node.
+ ***********************************************************/
+void SceneBvh::Clear()
+{
+	m_objects.clear();
+	m_objectOrder.clear();
+	m_objectLeaves.clear();
+	m_nodes.clear();
+	m_parents.clear();
+	m_dirtyNodes.clear();
+	m_nodeDirty.clear();
+	m_depth = 0;
+	m_builtRootArea = 0.0f;
+	m_builtCost = 0.0f;
+}
+
+/***********************************************************
+ *  GetRangeBounds()
+ *
+ *  This method is used for getting the bounds around the
+ *  objects of a range of the object order.
+ ***********************************************************/
+void SceneBvh::GetRangeBounds(uint32_t first, uint32_t count, glm::vec3& boundsMin, glm::vec3& boundsMax) const
+{
+	boundsMin = glm::vec3(FLT_MAX);
+	boundsMax = glm::vec3(-FLT_MAX);
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		const OBJECT_BOUNDS& object = m_objects[m_objectOrder[i]];
+		boundsMin = glm::min(boundsMin, object.boundsMin);
+		boundsMax = glm::max(boundsMax, object.boundsMax);
+	}
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the hierarchy over the
+ *  added objects from scratch.
+ ***********************************************************/
+void SceneBvh::Build()
+{
+	m_nodes.clear();
+	m_parents.clear();
+	m_dirtyNodes.clear();
+	m_depth = 0;
+	m_builtRootArea = 0.0f;
+	m_builtCost = 0.0f;
+
+	uint32_t objectCount = (uint32_t)m_objects.size();
+	m_objectOrder.resize(objectCount);
+	m_objectLeaves.assign(objectCount, 0);
+	if (objectCount == 0)
+	{
+		m_nodeDirty.clear();
+		return;
+	}
+
+	std::vector<glm::vec3> centers(objectCount);
+	for (uint32_t i = 0; i < objectCount; i++)
+	{
+		m_objectOrder[i] = i;
+		centers[i] = (m_objects[i].boundsMin + m_objects[i].boundsMax) * 0.5f;
+	}
+
+	// a binary tree with one object per leaf has 2n - 1 nodes
+	m_nodes.reserve(2 * objectCount);
+	m_parents.reserve(2 * objectCount);
+	BuildNode(0, objectCount, 0, 1, centers);
+
+	m_nodeDirty.assign(m_nodes.size(), 0);
+	m_builtRootArea = SurfaceArea(m_nodes[0].boundsMin, m_nodes[0].boundsMax);
+	m_builtCost = ComputeCost(m_builtRootArea);
+}
+
+/***********************************************************
+ *  BuildNode()
+ *
+ *  This method is used for building the node of a range of
+ *  the object order and, when splitting it is cheaper than
+ *  testing its objects, the nodes of its two halves.  The
+ *  objects are sorted into bins by their centers along the
+ *  axis the centers spread the most over, and the split is
+ *  placed between the two bins where the surface area
+ *  heuristic - the area of each half times its objects -
+ *  is lowest.  Objects whose centers all coincide cannot be
+ *  split by position and are halved instead.
+ ***********************************************************/
+uint32_t SceneBvh::BuildNode(uint32_t first, uint32_t count, uint32_t parent, int depth, std::vector<glm::vec3>& centers)
+{
+	uint32_t nodeIndex = (uint32_t)m_nodes.size();
+	BVH_NODE node;
+	GetRangeBounds(first, count, node.boundsMin, node.boundsMax);
+	node.offset = first;
+	node.count = count;
+	m_nodes.push_back(node);
+	m_parents.push_back(parent);
+	m_depth = std::max(m_depth, depth);
+
+	uint32_t splitCount = 0;
+	if ((count > (uint32_t)MAX_LEAF_OBJECTS) && (depth < MAX_DEPTH))
+	{
+		glm::vec3 centerMin(FLT_MAX);
+		glm::vec3 centerMax(-FLT_MAX);
+		for (uint32_t i = first; i < first + count; i++)
+		{
+			centerMin = glm::min(centerMin, centers[m_objectOrder[i]]);
+			centerMax = glm::max(centerMax, centers[m_objectOrder[i]]);
+		}
+		glm::vec3 spread = centerMax - centerMin;
+		int axis = 0;
+		if (spread.y > spread[axis]) axis = 1;
+		if (spread.z > spread[axis]) axis = 2;
+
+		if (spread[axis] > 0.0f)
+		{
+			struct BIN
+			{
+				glm::vec3 boundsMin;
+				glm::vec3 boundsMax;
+				uint32_t count;
+			};
+			BIN bins[SAH_BIN_COUNT];
+			for (int b = 0; b < SAH_BIN_COUNT; b++)
+			{
+				bins[b].boundsMin = glm::vec3(FLT_MAX);
+				bins[b].boundsMax = glm::vec3(-FLT_MAX);
+				bins[b].count = 0;
+			}
+
+			float binScale = (float)SAH_BIN_COUNT / spread[axis];
+			for (uint32_t i = first; i < first + count; i++)
+			{
+				uint32_t objectID = m_objectOrder[i];
+				int b = std::min((int)((centers[objectID][axis] - centerMin[axis]) * binScale), SAH_BIN_COUNT - 1);
+				bins[b].boundsMin = glm::min(bins[b].boundsMin, m_objects[objectID].boundsMin);
+				bins[b].boundsMax = glm::max(bins[b].boundsMax, m_objects[objectID].boundsMax);
+				bins[b].count++;
+			}
+
+			// area and count of everything right of each bin boundary
+			float rightCosts[SAH_BIN_COUNT];
+			glm::vec3 sweepMin(FLT_MAX);
+			glm::vec3 sweepMax(-FLT_MAX);
+			uint32_t sweepCount = 0;
+			for (int b = SAH_BIN_COUNT - 1; b > 0; b--)
+			{
+				sweepMin = glm::min(sweepMin, bins[b].boundsMin);
+				sweepMax = glm::max(sweepMax, bins[b].boundsMax);
+				sweepCount += bins[b].count;
+				rightCosts[b] = (sweepCount > 0) ? SurfaceArea(sweepMin, sweepMax) * (float)sweepCount : -1.0f;
+			}
+
+			float bestCost = FLT_MAX;
+			int bestBin = -1;
+			sweepMin = glm::vec3(FLT_MAX);
+			sweepMax = glm::vec3(-FLT_MAX);
+			sweepCount = 0;
+			for (int b = 0; b < SAH_BIN_COUNT - 1; b++)
+			{
+				sweepMin = glm::min(sweepMin, bins[b].boundsMin);
+				sweepMax = glm::max(sweepMax, bins[b].boundsMax);
+				sweepCount += bins[b].count;
+				if ((sweepCount == 0) || (rightCosts[b + 1] < 0.0f))
+				{
+					continue;
+				}
+				float cost = SurfaceArea(sweepMin, sweepMax) * (float)sweepCount + rightCosts[b + 1];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestBin = b;
+				}
+			}
+
+			float nodeArea = SurfaceArea(node.boundsMin, node.boundsMax);
+			float leafCost = nodeArea * (float)count;
+			if ((bestBin >= 0) && (g_TraversalCost * nodeArea + bestCost < leafCost))
+			{
+				uint32_t* pFirst = m_objectOrder.data() + first;
+				uint32_t* pMiddle = std::partition(pFirst, pFirst + count,
+					[&](uint32_t objectID)
+					{
+						int b = std::min((int)((centers[objectID][axis] - centerMin[axis]) * binScale), SAH_BIN_COUNT - 1);
+						return (b <= bestBin);
+					});
+				splitCount = (uint32_t)(pMiddle - pFirst);
+			}
+		}
+		else
+		{
+			splitCount = count / 2;
+		}
+	}
+
+	if ((splitCount == 0) || (splitCount == count))
+	{
+		for (uint32_t i = first; i < first + count; i++)
+		{
+			m_objectLeaves[m_objectOrder[i]] = nodeIndex;
+		}
+		return nodeIndex;
+	}
+
+	// the first child is built right after its parent
+	BuildNode(first, splitCount, nodeIndex, depth + 1, centers);
+	uint32_t secondChild = BuildNode(first + splitCount, count - splitCount, nodeIndex, depth + 1, centers);
+	m_nodes[nodeIndex].offset = secondChild;
+	m_nodes[nodeIndex].count = 0;
+
+	return nodeIndex;
+}
+
+/***********************************************************
+ *  UpdateObject()
+ *
+ *  This method is used for setting the new bounds of an
+ *  object and marking the nodes above it for the next
+ *  Refit().  The walk up stops at the first node that is
+ *  already marked, as the nodes above it are too.
+ ***********************************************************/
+void SceneBvh::UpdateObject(int objectID, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	if ((objectID < 0) || (objectID >= (int)m_objects.size()))
+	{
+		return;
+	}
+
+	m_objects[objectID].boundsMin = boundsMin;
+	m_objects[objectID].boundsMax = boundsMax;
+
+	if (m_nodes.empty() || ((size_t)objectID >= m_objectLeaves.size()))
+	{
+		return;
+	}
+
+	uint32_t nodeIndex = m_objectLeaves[objectID];
+	while (m_nodeDirty[nodeIndex] == 0)
+	{
+		m_nodeDirty[nodeIndex] = 1;
+		m_dirtyNodes.push_back(nodeIndex);
+		if (nodeIndex == 0)
+		{
+			break;
+		}
+		nodeIndex = m_parents[nodeIndex];
+	}
+}
+
+/***********************************************************
+ *  Refit()
+ *
+ *  This method is used for fitting the marked nodes to the
+ *  bounds below them.  Children are always stored after
+ *  their parent, so fitting the marked nodes from the
+ *  highest index down fits every child before its parent.
+ ***********************************************************/
+void SceneBvh::Refit()
+{
+	std::sort(m_dirtyNodes.begin(), m_dirtyNodes.end(), std::greater<uint32_t>());
+
+	for (uint32_t nodeIndex : m_dirtyNodes)
+	{
+		BVH_NODE& node = m_nodes[nodeIndex];
+		if (node.count > 0)
+		{
+			GetRangeBounds(node.offset, node.count, node.boundsMin, node.boundsMax);
+		}
+		else
+		{
+			const BVH_NODE& firstChild = m_nodes[nodeIndex + 1];
+			const BVH_NODE& secondChild = m_nodes[node.offset];
+			node.boundsMin = glm::min(firstChild.boundsMin, secondChild.boundsMin);
+			node.boundsMax = glm::max(firstChild.boundsMax, secondChild.boundsMax);
+		}
+		m_nodeDirty[nodeIndex] = 0;
+	}
+
+	m_dirtyNodes.clear();
+}
+
+/***********************************************************
+ *  ComputeCost()
+ *
+ *  This method is used for getting the surface area
+ *  heuristic cost of the hierarchy - the expected cost of
+ *  a random ray, from the chance of it entering each node,
+ *  which is the area of the node over the passed in root
+ *  area.
+ ***********************************************************/
+float SceneBvh::ComputeCost(float rootArea) const
+{
+	if ((m_nodes.empty()) || (rootArea <= 0.0f))
+	{
+		return 0.0f;
+	}
+
+	float cost = 0.0f;
+	for (const BVH_NODE& node : m_nodes)
+	{
+		float chance = SurfaceArea(node.boundsMin, node.boundsMax) / rootArea;
+		cost += chance * ((node.count > 0) ? (float)node.count : g_TraversalCost);
+	}
+	return cost;
+}
+
+/***********************************************************
+ *  GetCostRatio()
+ *
+ *  This method is used for getting how much the refits
+ *  have loosened the hierarchy since it was built.  Both
+ *  costs use the root area of the build, since dividing by
+ *  the current root would hide the growth of the root and
+ *  of every node with it.
+ ***********************************************************/
+float SceneBvh::GetCostRatio() const
+{
+	if (m_builtCost <= 0.0f)
+	{
+		return 1.0f;
+	}
+	return ComputeCost(m_builtRootArea) / m_builtCost;
+}
+
+/***********************************************************
+ *  GetSubtreeRange()
+ *
+ *  This method is used for getting the range of the object
+ *  order a node covers.  Every node covers a contiguous
+ *  range, from the first object of its leftmost leaf to the
+ *  last object of its rightmost leaf.
+ ***********************************************************/
+void SceneBvh::GetSubtreeRange(uint32_t nodeIndex, uint32_t& first, uint32_t& count) const
+{
+	uint32_t leftmost = nodeIndex;
+	while (m_nodes[leftmost].count == 0)
+	{
+		leftmost = leftmost + 1;
+	}
+	uint32_t rightmost = nodeIndex;
+	while (m_nodes[rightmost].count == 0)
+	{
+		rightmost = m_nodes[rightmost].offset;
+	}
+
+	first = m_nodes[leftmost].offset;
+	count = m_nodes[rightmost].offset + m_nodes[rightmost].count - first;
+}
+
+/***********************************************************
+ *  RayCast()
+ *
+ *  This method is used for finding the nearest object hit
+ *  by a ray.  The nearer child of every node is visited
+ *  first and the other one is kept on a stack with the
+ *  distance at which the ray enters it, so nodes beyond the
+ *  nearest hit found so far are skipped without a test.
+ ***********************************************************/
+bool SceneBvh::RayCast(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float maxDistance,
+	BVH_INTERSECT_FUNCTION intersect,
+	void* intersectData,
+	BVH_RAY_HIT& hit) const
+{
+	hit.objectID = -1;
+	hit.distance = maxDistance;
+
+	if (m_nodes.empty())
+	{
+		return false;
+	}
+
+	glm::vec3 inverseDirection;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		inverseDirection[axis] = (std::fabs(direction[axis]) > 1.0e-20f) ?
+			(1.0f / direction[axis]) : std::copysign(g_LargeInverse, direction[axis]);
+	}
+
+	float entry = 0.0f;
+	if (!IntersectRayBounds(m_nodes[0].boundsMin, m_nodes[0].boundsMax, origin, inverseDirection, hit.distance, entry))
+	{
+		return false;
+	}
+
+	uint32_t stackNodes[MAX_DEPTH];
+	float stackEntries[MAX_DEPTH];
+	int stackSize = 0;
+	uint32_t nodeIndex = 0;
+
+	while (true)
+	{
+		const BVH_NODE& node = m_nodes[nodeIndex];
+		bool bDescend = false;
+
+		if (node.count > 0)
+		{
+			for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+			{
+				uint32_t objectID = m_objectOrder[i];
+				const OBJECT_BOUNDS& object = m_objects[objectID];
+
+				float distance = 0.0f;
+				if (!IntersectRayBounds(object.boundsMin, object.boundsMax, origin, inverseDirection, hit.distance, distance))
+				{
+					continue;
+				}
+				if ((nullptr != intersect) && !intersect(intersectData, (int)objectID, origin, direction, distance))
+				{
+					continue;
+				}
+				if (distance < hit.distance)
+				{
+					hit.distance = distance;
+					hit.objectID = (int)objectID;
+				}
+			}
+		}
+		else
+		{
+			uint32_t firstChild = nodeIndex + 1;
+			uint32_t secondChild = node.offset;
+			float firstEntry = 0.0f;
+			float secondEntry = 0.0f;
+			bool bFirstHit = IntersectRayBounds(m_nodes[firstChild].boundsMin, m_nodes[firstChild].boundsMax, origin, inverseDirection, hit.distance, firstEntry);
+			bool bSecondHit = IntersectRayBounds(m_nodes[secondChild].boundsMin, m_nodes[secondChild].boundsMax, origin, inverseDirection, hit.distance, secondEntry);
+
+			if (bFirstHit && bSecondHit)
+			{
+				if (secondEntry < firstEntry)
+				{
+					std::swap(firstChild, secondChild);
+					std::swap(firstEntry, secondEntry);
+				}
+				stackNodes[stackSize] = secondChild;
+				stackEntries[stackSize] = secondEntry;
+				stackSize++;
+				nodeIndex = firstChild;
+				bDescend = true;
+			}
+			else if (bFirstHit || bSecondHit)
+			{
+				nodeIndex = bFirstHit ? firstChild : secondChild;
+				bDescend = true;
+			}
+		}
+
+		if (bDescend)
+		{
+			continue;
+		}
+
+		// the next node left on the stack that the ray enters
+		// before the nearest hit
+		while ((stackSize > 0) && (stackEntries[stackSize - 1] > hit.distance))
+		{
+			stackSize--;
+		}
+		if (stackSize == 0)
+		{
+			break;
+		}
+		stackSize--;
+		nodeIndex = stackNodes[stackSize];
+	}
+
+	return (hit.objectID >= 0);
+}
+
+/***********************************************************
+ *  QueryFrustum()
+ *
+ *  This method is used for collecting the objects inside
+ *  the frustum of a view projection matrix.  Planes a node
+ *  is fully inside are not tested again below it, and the
+ *  objects of a node fully inside every plane are taken
+ *  without testing them at all.
+ ***********************************************************/
+void SceneBvh::QueryFrustum(const glm::mat4& viewProjection, std::vector<int>& objectIDs) const
+{
+	objectIDs.clear();
+	if (m_nodes.empty())
+	{
+		return;
+	}
+
+	// planes pointing inwards, only the side of the bounds is
+	// tested against them
+	glm::vec4 planes[6];
+	ExtractFrustumPlanes(viewProjection, false, planes);
+
+	// both children are pushed, so one more than the depth
+	uint32_t stackNodes[MAX_DEPTH + 1];
+	uint32_t stackMasks[MAX_DEPTH + 1];
+	int stackSize = 0;
+	stackNodes[stackSize] = 0;
+	stackMasks[stackSize] = 0x3F;
+	stackSize++;
+
+	while (stackSize > 0)
+	{
+		stackSize--;
+		uint32_t nodeIndex = stackNodes[stackSize];
+		uint32_t planeMask = stackMasks[stackSize];
+		const BVH_NODE& node = m_nodes[nodeIndex];
+
+		if (!TestFrustumPlanes(planes, node.boundsMin, node.boundsMax, planeMask))
+		{
+			continue;
+		}
+
+		if (planeMask == 0)
+		{
+			uint32_t first = 0;
+			uint32_t count = 0;
+			GetSubtreeRange(nodeIndex, first, count);
+			for (uint32_t i = first; i < first + count; i++)
+			{
+				objectIDs.push_back((int)m_objectOrder[i]);
+			}
+		}
+		else if (node.count > 0)
+		{
+			for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+			{
+				const OBJECT_BOUNDS& object = m_objects[m_objectOrder[i]];
+				uint32_t objectMask = planeMask;
+				if (TestFrustumPlanes(planes, object.boundsMin, object.boundsMax, objectMask))
+				{
+					objectIDs.push_back((int)m_objectOrder[i]);
+				}
+			}
+		}
+		else
+		{
+			stackNodes[stackSize] = node.offset;
+			stackMasks[stackSize] = planeMask;
+			stackSize++;
+			stackNodes[stackSize] = nodeIndex + 1;
+			stackMasks[stackSize] = planeMask;
+			stackSize++;
+		}
+	}
+}
+
+/***********************************************************
+ *  QueryNearest()
+ *
+ *  This method is used for collecting the objects nearest
+ *  to a point.  The nodes are visited nearest first, and
+ *  once the passed in number of objects is found, a node
+ *  farther away than the farthest of them ends the search.
+ ***********************************************************/
+void SceneBvh::QueryNearest(const glm::vec3& point, int count, std::vector<int>& objectIDs) const
+{
+	objectIDs.clear();
+	if (m_nodes.empty() || (count <= 0))
+	{
+		return;
+	}
+
+	typedef std::pair<float, uint32_t> DISTANCE_ENTRY;
+
+	// nodes to visit, nearest on top
+	std::vector<DISTANCE_ENTRY> nodeStorage;
+	nodeStorage.reserve(MAX_DEPTH * 2);
+	std::priority_queue<DISTANCE_ENTRY, std::vector<DISTANCE_ENTRY>, std::greater<DISTANCE_ENTRY> > nodes(
+		std::greater<DISTANCE_ENTRY>(), std::move(nodeStorage));
+	// objects found so far, farthest on top
+	std::vector<DISTANCE_ENTRY> foundStorage;
+	foundStorage.reserve(count + 1);
+	std::priority_queue<DISTANCE_ENTRY> found(std::less<DISTANCE_ENTRY>(), std::move(foundStorage));
+
+	nodes.push(DISTANCE_ENTRY(DistanceSquaredToBounds(point, m_nodes[0].boundsMin, m_nodes[0].boundsMax), 0));
+	while (!nodes.empty())
+	{
+		DISTANCE_ENTRY entry = nodes.top();
+		nodes.pop();
+		if (((int)found.size() == count) && (entry.first > found.top().first))
+		{
+			break;
+		}
+
+		const BVH_NODE& node = m_nodes[entry.second];
+		if (node.count > 0)
+		{
+			for (uint32_t i = node.offset; i < node.offset + node.count; i++)
+			{
+				const OBJECT_BOUNDS& object = m_objects[m_objectOrder[i]];
+				float distance = DistanceSquaredToBounds(point, object.boundsMin, object.boundsMax);
+				if ((int)found.size() < count)
+				{
+					found.push(DISTANCE_ENTRY(distance, m_objectOrder[i]));
+				}
+				else if (distance < found.top().first)
+				{
+					found.pop();
+					found.push(DISTANCE_ENTRY(distance, m_objectOrder[i]));
+				}
+			}
+		}
+		else
+		{
+			uint32_t children[2] = { entry.second + 1, node.offset };
+			for (int c = 0; c < 2; c++)
+			{
+				const BVH_NODE& child = m_nodes[children[c]];
+				nodes.push(DISTANCE_ENTRY(DistanceSquaredToBounds(point, child.boundsMin, child.boundsMax), children[c]));
+			}
+		}
+	}
+
+	// the heap gives the farthest first
+	objectIDs.resize(found.size());
+	for (size_t i = objectIDs.size(); i > 0; i--)
+	{
+		objectIDs[i - 1] = (int)found.top().second;
+		found.pop();
+	}
+}
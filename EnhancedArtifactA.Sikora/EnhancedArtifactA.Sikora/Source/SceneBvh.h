@@ -0,0 +1,177 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebvh.h
+// ============
+// bounding volume hierarchy over the bounds of the scene objects, for ray
+// casts, frustum queries and nearest object queries that do not scan
+// every object
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  BVH_NODE
+ *
+ *  One node of the flattened hierarchy, 32 bytes so that
+ *  two fit in a cache line.  The nodes are stored depth
+ *  first, so the first child of an inner node is the node
+ *  right after it and only the second child is linked.
+ ***********************************************************/
+struct BVH_NODE
+{
+	glm::vec3 boundsMin;
+	// inner node - index of the second child
+	// leaf - first entry of its objects in the object order
+	uint32_t offset;
+	glm::vec3 boundsMax;
+	// number of objects of a leaf, 0 for an inner node
+	uint32_t count;
+};
+
+/***********************************************************
+ *  BVH_RAY_HIT
+ *
+ *  The nearest object a ray cast hit.
+ ***********************************************************/
+struct BVH_RAY_HIT
+{
+	int objectID;
+	float distance;
+};
+
+// exact test of a ray against one object, called for the
+// objects whose bounds the ray enters - returns true and
+// the distance along the ray when the object is hit
+typedef bool (*BVH_INTERSECT_FUNCTION)(
+	void* data,
+	int objectID,
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float& distance);
+
+/***********************************************************
+ *  SceneBvh
+ *
+ *  Objects are added by their world space bounds and the
+ *  hierarchy is built over them with Build(), which splits
+ *  every node where the surface area heuristic finds the
+ *  cheapest split among a number of bins along the longest
+ *  axis of the object centers.  Queries visit only the
+ *  nodes whose bounds can hold an answer, so their cost
+ *  grows with the log of the number of objects.
+ *
+ *  Moving objects report their new bounds with
+ *  UpdateObject(), and Refit() then grows or shrinks only
+ *  the nodes above them, without changing the hierarchy.
+ *  A refitted tree gets looser as objects move away from
+ *  where it was built - GetCostRatio() tells how much, so
+ *  the owner can rebuild when it gets too slow.
+ *
+ *  Queries only read the hierarchy, so any number of them
+ *  can run at once, but not together with Build(),
+ *  UpdateObject() or Refit().
+ ***********************************************************/
+class SceneBvh
+{
+public:
+	// constructor
+	SceneBvh();
+	// destructor
+	~SceneBvh();
+
+	// add an object, returns its ID - objects are only found
+	// by queries after Build()
+	int AddObject(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+	// free every object and node
+	void Clear();
+
+	// build the hierarchy over the added objects
+	void Build();
+	// set the new bounds of an object that moved
+	void UpdateObject(int objectID, const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+	// fit the nodes above the moved objects to their bounds
+	void Refit();
+
+	int GetObjectCount() const { return (int)m_objects.size(); }
+	int GetNodeCount() const { return (int)m_nodes.size(); }
+	int GetDepth() const { return m_depth; }
+	// surface area heuristic cost of the hierarchy now, over
+	// its cost when it was built
+	float GetCostRatio() const;
+
+	// find the nearest object the ray hits before the passed in
+	// distance - the direction must be normalized, and without
+	// an intersect function the object bounds count as hits
+	bool RayCast(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float maxDistance,
+		BVH_INTERSECT_FUNCTION intersect,
+		void* intersectData,
+		BVH_RAY_HIT& hit) const;
+	// collect the objects whose bounds are at least partly
+	// inside the frustum of the passed in matrix
+	void QueryFrustum(const glm::mat4& viewProjection, std::vector<int>& objectIDs) const;
+	// collect the passed in number of objects nearest to a
+	// point, measured to their bounds, nearest first
+	void QueryNearest(const glm::vec3& point, int count, std::vector<int>& objectIDs) const;
+
+private:
+	// bins the object centers are sorted into along the split
+	// axis when looking for the cheapest split
+	static const int SAH_BIN_COUNT = 16;
+	// leaves are not split below this number of objects
+	static const int MAX_LEAF_OBJECTS = 4;
+	// deepest hierarchy the queries have stack room for
+	static const int MAX_DEPTH = 64;
+
+	struct OBJECT_BOUNDS
+	{
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+	};
+
+	// bounds of every object, by object ID
+	std::vector<OBJECT_BOUNDS> m_objects;
+	// object IDs in leaf order, each leaf owning a range
+	std::vector<uint32_t> m_objectOrder;
+	// leaf of every object, by object ID
+	std::vector<uint32_t> m_objectLeaves;
+
+	std::vector<BVH_NODE> m_nodes;
+	std::vector<uint32_t> m_parents;
+	int m_depth;
+	// area of the root and cost when the hierarchy was built -
+	// later costs are measured against the same root area, so
+	// that a root grown by the refits shows up in the ratio
+	float m_builtRootArea;
+	float m_builtCost;
+
+	// nodes whose bounds changed since the last refit, and a
+	// mark per node so each is listed once
+	std::vector<uint32_t> m_dirtyNodes;
+	std::vector<uint8_t> m_nodeDirty;
+
+	// split the objects of a range of the object order into a
+	// node and its children, returns the node index
+	uint32_t BuildNode(uint32_t first, uint32_t count, uint32_t parent, int depth, std::vector<glm::vec3>& centers);
+	// bounds of the objects of a range of the object order
+	void GetRangeBounds(uint32_t first, uint32_t count, glm::vec3& boundsMin, glm::vec3& boundsMax) const;
+	// range of the object order covered by a node
+	void GetSubtreeRange(uint32_t nodeIndex, uint32_t& first, uint32_t& count) const;
+	// surface area heuristic cost of the current nodes, with
+	// the chance of entering a node taken against the passed
+	// in root area
+	float ComputeCost(float rootArea) const;
+
+	// the hierarchy holds indices into its own arrays
+	SceneBvh(const SceneBvh&) = delete;
+	SceneBvh& operator=(const SceneBvh&) = delete;
+};
@@ -0,0 +1,1443 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.cpp
+// ============
+// compile text scene descriptions into a binary scene blob and load the
+// blob back with a single read
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneFile.h"
+#include "ResourceHandle.h"
+#include "ShapeMeshes.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// mesh names that can be used in a text scene
+	struct MESH_NAME
+	{
+		const char* name;
+		ShapeMeshes::MESH_TYPE type;
+	};
+
+	const MESH_NAME g_MeshNames[] =
+	{
+		{ "box", ShapeMeshes::MESH_BOX },
+		{ "cone", ShapeMeshes::MESH_CONE },
+		{ "cylinder", ShapeMeshes::MESH_CYLINDER },
+		{ "plane", ShapeMeshes::MESH_PLANE },
+		{ "prism", ShapeMeshes::MESH_PRISM },
+		{ "pyramid3", ShapeMeshes::MESH_PYRAMID3 },
+		{ "pyramid4", ShapeMeshes::MESH_PYRAMID4 },
+		{ "sphere", ShapeMeshes::MESH_SPHERE },
+		{ "halfsphere", ShapeMeshes::MESH_HALF_SPHERE },
+		{ "taperedcylinder", ShapeMeshes::MESH_TAPERED_CYLINDER },
+		{ "torus", ShapeMeshes::MESH_TORUS },
+		{ "halftorus", ShapeMeshes::MESH_HALF_TORUS }
+	};
+
+	/***********************************************************
+	 *  SCENE_BUILDER
+	 *
+	 *  Collects the parsed scene while the text is compiled.
+	 ***********************************************************/
+	struct SCENE_BUILDER
+	{
+		std::vector<SCENE_TEXTURE> textures;
+		std::vector<SCENE_MATERIAL> materials;
+		std::vector<SCENE_MESH> meshes;
+		std::vector<SCENE_OBJECT> objects;
+		std::vector<SCENE_TRANSFORM> transforms;
+		std::string strings;
+		// offsets of the strings already in the table, so that
+		// tags used by many objects are stored only once
+		std::map<std::string, uint32_t> stringOffsets;
+		// tags already used, by hash, for detecting duplicate
+		// and colliding tags of one kind
+		std::map<uint32_t, std::string> textureTags;
+		std::map<uint32_t, std::string> materialTags;
+		std::map<uint32_t, std::string> meshTags;
+		std::map<uint32_t, std::string> speciesTags;
+		// vegetation, with the species of every part and the
+		// line of every reference for the checks at the end
+		std::vector<SCENE_SPECIES> species;
+		std::vector<SCENE_SPECIES_PART> parts;
+		std::vector<uint32_t> partSpecies;
+		std::vector<int> partLines;
+		std::vector<SCENE_SCATTER> scatters;
+		std::vector<int> scatterLines;
+		std::vector<SCENE_TERRAIN> terrains;
+		int terrainLine;
+		std::map<uint32_t, std::string> particlesTags;
+		std::vector<SCENE_PARTICLES> particles;
+		std::vector<int> particlesLines;
+		std::vector<SCENE_LIGHT> lights;
+		int directionalLights;
+		int pointLights;
+
+		// add a string to the string table
+		uint32_t AddString(const std::string& value)
+		{
+			std::map<std::string, uint32_t>::iterator existing = stringOffsets.find(value);
+			if (existing != stringOffsets.end())
+			{
+				return existing->second;
+			}
+
+			uint32_t offset = (uint32_t)strings.size();
+			strings += value;
+			strings += '\0';
+			stringOffsets[value] = offset;
+			return offset;
+		}
+
+		// list a mesh once, so that only the meshes the scene
+		// needs get loaded, and return its string
+		uint32_t AddMesh(uint32_t meshHash, const std::string& meshName, ShapeMeshes::MESH_TYPE meshType)
+		{
+			if (meshTags.find(meshHash) == meshTags.end())
+			{
+				meshTags[meshHash] = meshName;
+
+				SCENE_MESH mesh;
+				mesh.tagHash = meshHash;
+				mesh.tagString = AddString(meshName);
+				mesh.meshType = (uint32_t)meshType;
+				meshes.push_back(mesh);
+			}
+			return AddString(meshName);
+		}
+	};
+
+	// find a mesh by its name in the text scene, or -1
+	int FindMeshName(const std::string& meshName)
+	{
+		for (int i = 0; i < (int)(sizeof(g_MeshNames) / sizeof(g_MeshNames[0])); i++)
+		{
+			if (meshName == g_MeshNames[i].name)
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	// read the passed in number of floats, reporting an error
+	// for the line when they are missing
+	bool ReadFloats(std::istringstream& line, float* values, int count, int lineNumber, const std::string& key)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			if (!(line >> values[i]))
+			{
+				std::cout << "ERROR: Scene line " << lineNumber << ": \"" << key << "\" needs "
+					<< count << " numbers" << std::endl;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// start an object and its transform with the default values
+	void InitDrawValues(SCENE_OBJECT& object, SCENE_TRANSFORM& transform)
+	{
+		std::memset(&object, 0, sizeof(object));
+		object.color[0] = object.color[1] = object.color[2] = object.color[3] = 1.0f;
+		object.UVscale[0] = object.UVscale[1] = 1.0f;
+
+		transform.scaleXYZ[0] = transform.scaleXYZ[1] = transform.scaleXYZ[2] = 1.0f;
+		transform.rotationDegrees[0] = transform.rotationDegrees[1] = transform.rotationDegrees[2] = 0.0f;
+		transform.positionXYZ[0] = transform.positionXYZ[1] = transform.positionXYZ[2] = 0.0f;
+	}
+
+	// read one of the values shared by objects and species
+	// parts - returns false when the key is none of them,
+	// and clears bValuesRead when the value is malformed
+	bool ReadDrawValue(
+		const std::string& key,
+		std::istringstream& line,
+		int lineNumber,
+		SCENE_BUILDER& builder,
+		SCENE_OBJECT& object,
+		SCENE_TRANSFORM& transform,
+		bool& bValuesRead)
+	{
+		if (key == "scale")
+			bValuesRead = ReadFloats(line, transform.scaleXYZ, 3, lineNumber, key);
+		else if (key == "rotate")
+			bValuesRead = ReadFloats(line, transform.rotationDegrees, 3, lineNumber, key);
+		else if (key == "position")
+			bValuesRead = ReadFloats(line, transform.positionXYZ, 3, lineNumber, key);
+		else if (key == "color")
+		{
+			bValuesRead = ReadFloats(line, object.color, 4, lineNumber, key);
+			object.flags &= ~SCENE_OBJECT_TEXTURED;
+		}
+		else if (key == "uv")
+			bValuesRead = ReadFloats(line, object.UVscale, 2, lineNumber, key);
+		else if ((key == "texture") || (key == "material"))
+		{
+			std::string tag;
+			if (!(line >> tag))
+			{
+				std::cout << "ERROR: Scene line " << lineNumber << ": \"" << key << "\" needs a tag" << std::endl;
+				bValuesRead = false;
+			}
+			else if (key == "texture")
+			{
+				object.textureHash = HashTag(tag.c_str());
+				object.textureString = builder.AddString(tag);
+				object.flags |= SCENE_OBJECT_TEXTURED;
+			}
+			else
+			{
+				object.materialHash = HashTag(tag.c_str());
+				object.materialString = builder.AddString(tag);
+				object.flags |= SCENE_OBJECT_MATERIAL;
+			}
+		}
+		else
+		{
+			return false;
+		}
+		return true;
+	}
+
+	// report an undefined texture or material used by an
+	// object or a species part
+	bool CheckDrawReferences(const SCENE_BUILDER& builder, const SCENE_OBJECT& object, int lineNumber)
+	{
+		bool bDefined = true;
+		if (((object.flags & SCENE_OBJECT_TEXTURED) != 0) &&
+			(builder.textureTags.find(object.textureHash) == builder.textureTags.end()))
+		{
+			std::cout << "ERROR: Scene line " << lineNumber << ": undefined texture \""
+				<< &builder.strings[object.textureString] << "\"" << std::endl;
+			bDefined = false;
+		}
+		if (((object.flags & SCENE_OBJECT_MATERIAL) != 0) &&
+			(builder.materialTags.find(object.materialHash) == builder.materialTags.end()))
+		{
+			std::cout << "ERROR: Scene line " << lineNumber << ": undefined material \""
+				<< &builder.strings[object.materialString] << "\"" << std::endl;
+			bDefined = false;
+		}
+		return bDefined;
+	}
+
+	// add a tag to the used tags of one kind, reporting an
+	// error when it is already used or collides with another
+	bool AddTag(std::map<uint32_t, std::string>& tags, const std::string& tag, const char* kind, int lineNumber)
+	{
+		uint32_t hash = HashTag(tag.c_str());
+		std::map<uint32_t, std::string>::iterator existing = tags.find(hash);
+		if (existing != tags.end())
+		{
+			if (existing->second == tag)
+			{
+				std::cout << "ERROR: Scene line " << lineNumber << ": the " << kind << " \""
+					<< tag << "\" is defined twice" << std::endl;
+			}
+			else
+			{
+				std::cout << "ERROR: Scene line " << lineNumber << ": the " << kind << " \""
+					<< tag << "\" has the same hash as \"" << existing->second << "\"" << std::endl;
+			}
+			return false;
+		}
+		tags[hash] = tag;
+		return true;
+	}
+
+	// append an array to the blob, keeping it 4-byte aligned
+	template<typename T>
+	SCENE_ARRAY AppendArray(std::vector<unsigned char>& blob, const T* data, size_t count)
+	{
+		while ((blob.size() % 4) != 0)
+		{
+			blob.push_back(0);
+		}
+
+		SCENE_ARRAY array;
+		array.offset = (uint32_t)blob.size();
+		array.count = (uint32_t)count;
+
+		const unsigned char* bytes = (const unsigned char*)data;
+		blob.insert(blob.end(), bytes, bytes + count * sizeof(T));
+
+		return array;
+	}
+
+	// true when the array lies inside the blob and is aligned
+	bool IsArrayValid(const SCENE_ARRAY& array, size_t elementSize, size_t blobSize)
+	{
+		if ((array.offset % 4) != 0)
+		{
+			return false;
+		}
+		if (array.offset > blobSize)
+		{
+			return false;
+		}
+		return ((uint64_t)array.count * elementSize <= blobSize - array.offset);
+	}
+
+	// true when the offset is inside the string table, which
+	// ends in a terminator, or an optional string is not set
+	bool IsStringValid(uint32_t offset, const SCENE_HEADER& header, bool bOptional = false)
+	{
+		if (bOptional && (offset == SCENE_NO_STRING))
+		{
+			return true;
+		}
+		return (offset < header.strings.count);
+	}
+
+	// true when the texture and material strings a set of
+	// draw flags uses are inside the string table
+	bool AreDrawStringsValid(uint32_t flags, uint32_t textureString, uint32_t materialString, const SCENE_HEADER& header)
+	{
+		return ((((flags & SCENE_OBJECT_TEXTURED) == 0) || IsStringValid(textureString, header)) &&
+			(((flags & SCENE_OBJECT_MATERIAL) == 0) || IsStringValid(materialString, header)));
+	}
+
+	// true when every string offset, mesh type and light of a
+	// scene blob, whose arrays were checked already, can be used
+	bool AreReferencesValid(const unsigned char* blob, const SCENE_HEADER& header)
+	{
+		const SCENE_TEXTURE* textures = (const SCENE_TEXTURE*)(blob + header.textures.offset);
+		for (uint32_t i = 0; i < header.textures.count; i++)
+		{
+			if (!IsStringValid(textures[i].tagString, header) || !IsStringValid(textures[i].fileString, header))
+			{
+				return false;
+			}
+		}
+
+		const SCENE_MATERIAL* materials = (const SCENE_MATERIAL*)(blob + header.materials.offset);
+		for (uint32_t i = 0; i < header.materials.count; i++)
+		{
+			if (!IsStringValid(materials[i].tagString, header))
+			{
+				return false;
+			}
+		}
+
+		// the mesh type is used as a bit and an array index
+		const SCENE_MESH* meshes = (const SCENE_MESH*)(blob + header.meshes.offset);
+		for (uint32_t i = 0; i < header.meshes.count; i++)
+		{
+			if (!IsStringValid(meshes[i].tagString, header) || (meshes[i].meshType >= (uint32_t)ShapeMeshes::MESH_TYPE_COUNT))
+			{
+				return false;
+			}
+		}
+
+		const SCENE_OBJECT* objects = (const SCENE_OBJECT*)(blob + header.objects.offset);
+		for (uint32_t i = 0; i < header.objects.count; i++)
+		{
+			if (!IsStringValid(objects[i].meshString, header) ||
+				!AreDrawStringsValid(objects[i].flags, objects[i].textureString, objects[i].materialString, header))
+			{
+				return false;
+			}
+		}
+
+		// the parts of every species must lie inside the parts
+		const SCENE_SPECIES* species = (const SCENE_SPECIES*)(blob + header.species.offset);
+		for (uint32_t i = 0; i < header.species.count; i++)
+		{
+			if (!IsStringValid(species[i].tagString, header) ||
+				((uint64_t)species[i].firstPart + species[i].partCount > header.parts.count))
+			{
+				return false;
+			}
+		}
+
+		const SCENE_SPECIES_PART* parts = (const SCENE_SPECIES_PART*)(blob + header.parts.offset);
+		for (uint32_t i = 0; i < header.parts.count; i++)
+		{
+			if (!IsStringValid(parts[i].meshString, header) ||
+				!AreDrawStringsValid(parts[i].flags, parts[i].textureString, parts[i].materialString, header))
+			{
+				return false;
+			}
+		}
+
+		const SCENE_SCATTER* scatters = (const SCENE_SCATTER*)(blob + header.scatters.offset);
+		for (uint32_t i = 0; i < header.scatters.count; i++)
+		{
+			if (!IsStringValid(scatters[i].speciesString, header) || !IsStringValid(scatters[i].densityString, header, true))
+			{
+				return false;
+			}
+		}
+
+		const SCENE_TERRAIN* terrains = (const SCENE_TERRAIN*)(blob + header.terrains.offset);
+		for (uint32_t i = 0; i < header.terrains.count; i++)
+		{
+			if (!AreDrawStringsValid(terrains[i].flags, terrains[i].textureString, terrains[i].materialString, header) ||
+				!IsStringValid(terrains[i].heightmapString, header, true))
+			{
+				return false;
+			}
+		}
+
+		const SCENE_PARTICLES* particles = (const SCENE_PARTICLES*)(blob + header.particles.offset);
+		for (uint32_t i = 0; i < header.particles.count; i++)
+		{
+			if (!IsStringValid(particles[i].tagString, header) ||
+				!AreDrawStringsValid(particles[i].flags & SCENE_OBJECT_TEXTURED, particles[i].textureString, 0, header) ||
+				!IsStringValid(particles[i].speciesString, header, true))
+			{
+				return false;
+			}
+		}
+
+		// the point light count sizes the light loop of the
+		// scene shader, which has uniforms for a few of them
+		const SCENE_LIGHT* lights = (const SCENE_LIGHT*)(blob + header.lights.offset);
+		uint32_t directionalLights = 0;
+		uint32_t pointLights = 0;
+		for (uint32_t i = 0; i < header.lights.count; i++)
+		{
+			if (lights[i].type == SCENE_LIGHT_DIRECTIONAL)
+			{
+				directionalLights++;
+			}
+			else if (lights[i].type == SCENE_LIGHT_POINT)
+			{
+				pointLights++;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		if ((directionalLights > 1) || (pointLights > SCENE_MAX_POINT_LIGHTS))
+		{
+			return false;
+		}
+
+		return true;
+	}
+}
+
+/***********************************************************
+ *  SceneFile()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneFile::SceneFile()
+{
+	m_pBlob = nullptr;
+	m_pHeader = nullptr;
+	m_pTextures = nullptr;
+	m_pMaterials = nullptr;
+	m_pMeshes = nullptr;
+	m_pObjects = nullptr;
+	m_pTransforms = nullptr;
+	m_pSpecies = nullptr;
+	m_pParts = nullptr;
+	m_pScatters = nullptr;
+	m_pTerrains = nullptr;
+	m_pParticles = nullptr;
+	m_pLights = nullptr;
+	m_pStrings = nullptr;
+}
+
+/***********************************************************
+ *  ~SceneFile()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneFile::~SceneFile()
+{
+	Unload();
+}
+
+/***********************************************************
+ *  IsOutOfDate()
+ *
+ *  This method is used for checking whether the binary
+ *  scene file has to be compiled again.
+ ***********************************************************/
+bool SceneFile::IsOutOfDate(const char* textFilename, const char* binaryFilename)
+{
+	struct stat textInfo;
+	struct stat binaryInfo;
+
+	if (stat(binaryFilename, &binaryInfo) != 0)
+	{
+		return true;
+	}
+	if (stat(textFilename, &textInfo) != 0)
+	{
+		// without the text there is nothing to compile from
+		return false;
+	}
+
+	if (textInfo.st_mtime > binaryInfo.st_mtime)
+	{
+		return true;
+	}
+
+	// a binary written by an older version of the compiler
+	// would not load, so it is compiled again as well
+	SCENE_HEADER header;
+	bool bCurrent = false;
+	FILE* binaryFile = std::fopen(binaryFilename, "rb");
+	if (binaryFile != nullptr)
+	{
+		bCurrent = (std::fread(&header, sizeof(header), 1, binaryFile) == 1) &&
+			(header.magic == SCENE_FILE_MAGIC) &&
+			(header.version == SCENE_FILE_VERSION);
+		std::fclose(binaryFile);
+	}
+
+	return (bCurrent == false);
+}
+
+/***********************************************************
+ *  CompileText()
+ *
+ *  This method is used for parsing a text scene and writing
+ *  it out as a binary scene file.  Every line holds one
+ *  definition, and everything after a '#' is a comment:
+ *
+ *    texture <tag> <image file>
+ *    material <tag> ambient r g b strength s
+ *             diffuse r g b specular r g b shininess s
+ *    object <mesh> scale x y z rotate x y z position x y z
+ *           texture <tag> | color r g b a
+ *           uv u v material <tag> static occluder
+ *    species <tag> fade <start> <end> distance d
+ *    part <species> <mesh> - with the values of an object
+ *           except static and occluder
+ *    scatter <species> count n seed s area x0 z0 x1 z1
+ *            scale min max density <image file>
+ *    terrain size s resolution n height h feature f seed s
+ *            flat x0 z0 x1 z1 blend d heightmap <image file>
+ *            texture <tag> | color r g b a uv u v
+ *            material <tag>
+ *    particles <tag> capacity n rate r life l size min max
+ *              gravity g drag d wind x z gust s
+ *              texture <tag> | color r g b a
+ *              species <species> | area x0 y0 z0 x1 y1 z1
+ *
+ *  The values of a definition may be given in any order,
+ *  and any that are left out keep their default.
+ *  Unknown keywords, meshes, textures and materials are
+ *  reported with their line number and nothing is written.
+ ***********************************************************/
+bool SceneFile::CompileText(const char* textFilename, const char* binaryFilename)
+{
+	std::ifstream textFile(textFilename);
+	if (!textFile.is_open())
+	{
+		std::cout << "ERROR: Could not open scene file:" << textFilename << std::endl;
+		return false;
+	}
+
+	SCENE_BUILDER builder;
+	builder.terrainLine = 0;
+	builder.directionalLights = 0;
+	builder.pointLights = 0;
+	// line numbers of the object references, checked once the
+	// whole file has been read so that the order of the
+	// definitions does not matter
+	std::vector<int> objectLines;
+	bool bSuccess = true;
+	std::string text;
+	int lineNumber = 0;
+
+	while (std::getline(textFile, text))
+	{
+		lineNumber++;
+
+		size_t comment = text.find('#');
+		if (comment != std::string::npos)
+		{
+			text.erase(comment);
+		}
+
+		std::istringstream line(text);
+		std::string keyword;
+		if (!(line >> keyword))
+		{
+			continue;
+		}
+
+		if (keyword == "texture")
+		{
+			std::string tag;
+			std::string filename;
+			if (!(line >> tag >> filename))
+			{
+				std::cout << "ERROR: Scene line " << lineNumber << ": a texture needs a tag and a file" << std::endl;
+				bSuccess = false;
+				continue;
+			}
+			if (!AddTag(builder.textureTags, tag, "texture", lineNumber))
+			{
+				bSuccess = false;
+				continue;
+			}
+
+			SCENE_TEXTURE texture;
+			texture.tagHash = HashTag(tag.c_str());
+			texture.tagString = builder.AddString(tag);
+			texture.fileString = builder.AddString(filename);
+			builder.textures.push_back(texture);
+		}
+		else if (keyword == "material")
+		{
+			std::string tag;
+			if (!(line >> tag))
+			{
+				std::cout << "ERROR: Scene line " << lineNumber << ": a material needs a tag" << std::endl;
+				bSuccess = false;
+				continue;
+			}
+			if (!AddTag(builder.materialTags, tag, "material", lineNumber))
+			{
+				bSuccess = false;
+				continue;
+			}
+
+			SCENE_MATERIAL material;
+			std::memset(&material, 0, sizeof(material));
+			material.tagHash = HashTag(tag.c_str());
+			material.tagString = builder.AddString(tag);
+			material.ambientStrength = 1.0f;
+			material.shininess = 1.0f;
+
+			std::string key;
+			bool bValuesRead = true;
+			while (bValuesRead && (line >> key))
+			{
+				if (key == "ambient")
+					bValuesRead = ReadFloats(line, material.ambientColor, 3, lineNumber, key);
+				else if (key == "strength")
+					bValuesRead = ReadFloats(line, &material.ambientStrength, 1, lineNumber, key);
+				else if (key == "diffuse")
+					bValuesRead = ReadFloats(line, material.diffuseColor, 3, lineNumber, key);
+				else if (key == "specular")
+					bValuesRead = ReadFloats(line, material.specularColor, 3, lineNumber, key);
+				else if (key == "shininess")
+					bValuesRead = ReadFloats(line, &material.shininess, 1, lineNumber, key);
+				else
+				{
+					std::cout << "ERROR: Scene line " << lineNumber << ": unknown material value \"" << key << "\"" << std::endl;
+					bValuesRead = false;
+				}
+			}
+			if (bValuesRead == false)
+			{
+				bSuccess = false;
+			}
+			builder.materials.push_back(material);
+		}
+		else if ((keyword == "object") || (keyword == "part"))
+		{
+			// a part names the species it belongs to before its mesh
+			std::string speciesTag;
+			if ((keyword == "part") && !(line >> speciesTag))
+			{
+				std::cout << "ERROR: Scene line " << lineNumber << ": a part needs a species" << std::endl;
+				bSuccess = false;
+				continue;
+			}
+
+			std::string meshName;
+			if (!(line >> meshName))
+			{
+				std::cout << "ERROR: Scene line " << lineNumber << ": an " << keyword << " needs a mesh" << std::endl;
+				bSuccess = false;
+				continue;
+			}
+
+			int meshIndex = FindMeshName(meshName);
+			if (meshIndex < 0)
+			{
+				std::cout << "ERROR: Scene line " << lineNumber << ": unknown mesh \"" << meshName << "\"" << std::endl;
+				bSuccess = false;
+				continue;
+			}
+
+			SCENE_OBJECT object;
+			SCENE_TRANSFORM transform;
+			InitDrawValues(object, transform);
+			object.meshHash = HashTag(meshName.c_str());
+			object.meshString = builder.AddMesh(object.meshHash, meshName, g_MeshNames[meshIndex].type);
+
+			std::string key;
+			bool bValuesRead = true;
+			while (bValuesRead && (line >> key))
+			{
+				if (ReadDrawValue(key, line, lineNumber, builder, object, transform, bValuesRead))
+					continue;
+				else if ((key == "static") && (keyword == "object"))
+					object.flags |= SCENE_OBJECT_STATIC;
+				else if ((key == "occluder") && (keyword == "object"))
+					object.flags |= SCENE_OBJECT_OCCLUDER;
+				else
+				{
+					std::cout << "ERROR: Scene line " << lineNumber << ": unknown " << keyword << " value \"" << key << "\"" << std::endl;
+					bValuesRead = false;
+				}
+			}
+
+			if (bValuesRead == false)
+			{
+				bSuccess = false;
+			}
+
+			if (keyword == "object")
+			{
+				builder.objects.push_back(object);
+				builder.transforms.push_back(transform);
+				objectLines.push_back(lineNumber);
+				continue;
+			}
+
+			SCENE_SPECIES_PART part;
+			part.meshHash = object.meshHash;
+			part.meshString = object.meshString;
+			part.textureHash = object.textureHash;
+			part.textureString = object.textureString;
+			part.materialHash = object.materialHash;
+			part.materialString = object.materialString;
+			part.flags = object.flags;
+			std::memcpy(part.color, object.color, sizeof(part.color));
+			std::memcpy(part.UVscale, object.UVscale, sizeof(part.UVscale));
+			part.transform = transform;
+
+			builder.parts.push_back(part);
+			builder.partSpecies.push_back(HashTag(speciesTag.c_str()));
+			builder.partLines.push_back(lineNumber);
+			// the species tag is kept for the error message of
+			// a part whose species is never defined
+			builder.AddString(speciesTag);
+		}
+		else if (keyword == "species")
+		{
+			std::string tag;
+			if (!(line >> tag))
+			{
+				std::cout << "ERROR: Scene line " << lineNumber << ": a species needs a tag" << std::endl;
+				bSuccess = false;
+				continue;
+			}
+			if (!AddTag(builder.speciesTags, tag, "species", lineNumber))
+			{
+				bSuccess = false;
+				continue;
+			}
+
+			SCENE_SPECIES species;
+			std::memset(&species, 0, sizeof(species));
+			species.tagHash = HashTag(tag.c_str());
+			species.tagString = builder.AddString(tag);
+			species.fadeStart = 20.0f;
+			species.fadeEnd = 25.0f;
+			species.drawDistance = 100.0f;
+
+			std::string key;
+			bool bValuesRead = true;
+			while (bValuesRead && (line >> key))
+			{
+				if (key == "fade")
+				{
+					float fade[2];
+					bValuesRead = ReadFloats(line, fade, 2, lineNumber, key);
+					species.fadeStart = fade[0];
+					species.fadeEnd = fade[1];
+				}
+				else if (key == "distance")
+					bValuesRead = ReadFloats(line, &species.drawDistance, 1, lineNumber, key);
+				else
+				{
+					std::cout << "ERROR: Scene line " << lineNumber << ": unknown species value \"" << key << "\"" << std::endl;
+					bValuesRead = false;
+				}
+			}
+			if (bValuesRead && !((species.fadeStart <= species.fadeEnd) && (species.fadeEnd <= species.drawDistance)))
+			{
+				std::cout << "ERROR: Scene line " << lineNumber << ": a species needs fade start <= fade end <= distance" << std::endl;
+				bValuesRead = false;
+			}
+			if (bValuesRead == false)
+			{
+				bSuccess = false;
+			}
+			builder.species.push_back(species);
+		}
+		else if (keyword == "scatter")
+		{
+			std::string speciesTag;
+			if (!(line >> speciesTag))
+			{
+				std::cout << "ERROR: Scene line " << lineNumber << ": a scatter needs a species" << std::endl;
+				bSuccess = false;
+				continue;
+			}
+
+			SCENE_SCATTER scatter;
+			std::memset(&scatter, 0, sizeof(scatter));
+			scatter.speciesHash = HashTag(speciesTag.c_str());
+			scatter.speciesString = builder.AddString(speciesTag);
+			scatter.scaleMin = 1.0f;
+			scatter.scaleMax = 1.0f;
+			scatter.densityString = SCENE_NO_STRING;
+
+			std::string key;
+			bool bValuesRead = true;
+			bool bHasArea = false;
+			while (bValuesRead && (line >> key))
+			{
+				if ((key == "count") || (key == "seed"))
+				{
+					long value = -1;
+					if (!(line >> value) || (value < 0))
+					{
+						std::cout << "ERROR: Scene line " << lineNumber << ": \"" << key << "\" needs a whole number" << std::endl;
+						bValuesRead = false;
+					}
+					else if (key == "count")
+						scatter.count = (uint32_t)value;
+					else
+						scatter.seed = (uint32_t)value;
+				}
+				else if (key == "area")
+				{
+					float area[4];
+					bValuesRead = ReadFloats(line, area, 4, lineNumber, key);
+					scatter.areaMin[0] = std::min(area[0], area[2]);
+					scatter.areaMin[1] = std::min(area[1], area[3]);
+					scatter.areaMax[0] = std::max(area[0], area[2]);
+					scatter.areaMax[1] = std::max(area[1], area[3]);
+					bHasArea = true;
+				}
+				else if (key == "scale")
+				{
+					float scale[2];
+					bValuesRead = ReadFloats(line, scale, 2, lineNumber, key);
+					scatter.scaleMin = scale[0];
+					scatter.scaleMax = scale[1];
+				}
+				else if (key == "density")
+				{
+					std::string filename;
+					if (!(line >> filename))
+					{
+						std::cout << "ERROR: Scene line " << lineNumber << ": \"density\" needs an image file" << std::endl;
+						bValuesRead = false;
+					}
+					else
+					{
+						scatter.densityString = builder.AddString(filename);
+					}
+				}
+				else
+				{
+					std::cout << "ERROR: Scene line " << lineNumber << ": unknown scatter value \"" << key << "\"" << std::endl;
+					bValuesRead = false;
+				}
+			}
+			if (bValuesRead && (bHasArea == false))
+			{
+				std::cout << "ERROR: Scene line " << lineNumber << ": a scatter needs an area" << std::endl;
+				bValuesRead = false;
+			}
+			if (bValuesRead == false)
+			{
+				bSuccess = false;
+			}
+			builder.scatters.push_back(scatter);
+			builder.scatterLines.push_back(lineNumber);
+		}
+		else if (keyword == "terrain")
+		{
+			if (!builder.terrains.empty())
+			{
+				std::cout << "ERROR: Scene line " << lineNumber << ": a scene has only one terrain" << std::endl;
+				bSuccess = false;
+				continue;
+			}
+
+			// the draw values are read into an object, of which
+			// the transform is not used
+			SCENE_OBJECT object;
+			SCENE_TRANSFORM transform;
+			InitDrawValues(object, transform);
+
+			SCENE_TERRAIN terrain;
+			std::memset(&terrain, 0, sizeof(terrain));
+			terrain.size = 256.0f;
+			terrain.resolution = 257;
+			terrain.heightScale = 10.0f;
+			terrain.featureSize = 50.0f;
+			terrain.flatBlend = -1.0f;
+			terrain.heightmapString = SCENE_NO_STRING;
+
+			std::string key;
+			bool bValuesRead = true;
+			while (bValuesRead && (line >> key))
+			{
+				if ((key == "texture") || (key == "material") || (key == "color") || (key == "uv"))
+					ReadDrawValue(key, line, lineNumber, builder, object, transform, bValuesRead);
+				else if (key == "size")
+					bValuesRead = ReadFloats(line, &terrain.size, 1, lineNumber, key);
+				else if (key == "height")
+					bValuesRead = ReadFloats(line, &terrain.heightScale, 1, lineNumber, key);
+				else if (key == "feature")
+					bValuesRead = ReadFloats(line, &terrain.featureSize, 1, lineNumber, key);
+				else if (key == "blend")
+					bValuesRead = ReadFloats(line, &terrain.flatBlend, 1, lineNumber, key);
+				else if ((key == "resolution") || (key == "seed"))
+				{
+					long value = -1;
+					if (!(line >> value) || (value < 0))
+					{
+						std::cout << "ERROR: Scene line " << lineNumber << ": \"" << key << "\" needs a whole number" << std::endl;
+						bValuesRead = false;
+					}
+					else if (key == "resolution")
+						terrain.resolution = (uint32_t)value;
+					else
+						terrain.seed = (uint32_t)value;
+				}
+				else if (key == "flat")
+				{
+					float area[4];
+					bValuesRead = ReadFloats(line, area, 4, lineNumber, key);
+					terrain.flatMin[0] = std::min(area[0], area[2]);
+					terrain.flatMin[1] = std::min(area[1], area[3]);
+					terrain.flatMax[0] = std::max(area[0], area[2]);
+					terrain.flatMax[1] = std::max(area[1], area[3]);
+					if (terrain.flatBlend < 0.0f)
+					{
+						terrain.flatBlend = 0.0f;
+					}
+				}
+				else if (key == "heightmap")
+				{
+					std::string filename;
+					if (!(line >> filename))
+					{
+						std::cout << "ERROR: Scene line " << lineNumber << ": \"heightmap\" needs an image file" << std::endl;
+						bValuesRead = false;
+					}
+					else
+					{
+						terrain.heightmapString = builder.AddString(filename);
+					}
+				}
+				else
+				{
+					std::cout << "ERROR: Scene line " << lineNumber << ": unknown terrain value \"" << key << "\"" << std::endl;
+					bValuesRead = false;
+				}
+			}
+			if (bValuesRead && ((terrain.size <= 0.0f) || (terrain.resolution < 2) || (terrain.featureSize <= 0.0f)))
+			{
+				std::cout << "ERROR: Scene line " << lineNumber << ": a terrain needs a size, a resolution of at least 2 and a feature size" << std::endl;
+				bValuesRead = false;
+			}
+			if (bValuesRead == false)
+			{
+				bSuccess = false;
+			}
+
+			terrain.textureHash = object.textureHash;
+			terrain.textureString = object.textureString;
+			terrain.materialHash = object.materialHash;
+			terrain.materialString = object.materialString;
+			terrain.flags = object.flags;
+			std::memcpy(terrain.color, object.color, sizeof(terrain.color));
+			std::memcpy(terrain.UVscale, object.UVscale, sizeof(terrain.UVscale));
+
+			builder.terrains.push_back(terrain);
+			builder.terrainLine = lineNumber;
+		}
+		else if (keyword == "particles")
+		{
+			std::string tag;
+			if (!(line >> tag))
+			{
+				std::cout << "ERROR: Scene line " << lineNumber << ": particles need a tag" << std::endl;
+				bSuccess = false;
+				continue;
+			}
+			if (!AddTag(builder.particlesTags, tag, "particles", lineNumber))
+			{
+				bSuccess = false;
+				continue;
+			}
+
+			// the draw values are read into an object, of which
+			// only the texture and the color are used
+			SCENE_OBJECT object;
+			SCENE_TRANSFORM transform;
+			InitDrawValues(object, transform);
+
+			SCENE_PARTICLES particles;
+			std::memset(&particles, 0, sizeof(particles));
+			particles.tagHash = HashTag(tag.c_str());
+			particles.tagString = builder.AddString(tag);
+			particles.capacity = 65536;
+			particles.rate = 1000.0f;
+			particles.lifetime = 10.0f;
+			particles.sizeMin = 0.1f;
+			particles.sizeMax = 0.1f;
+			particles.gravity = 9.8f;
+			particles.drag = 5.0f;
+			particles.speciesString = SCENE_NO_STRING;
+
+			std::string key;
+			bool bValuesRead = true;
+			bool bHasSource = false;
+			while (bValuesRead && (line >> key))
+			{
+				if ((key == "texture") || (key == "color"))
+					ReadDrawValue(key, line, lineNumber, builder, object, transform, bValuesRead);
+				else if (key == "capacity")
+				{
+					long value = -1;
+					if (!(line >> value) || (value <= 0))
+					{
+						std::cout << "ERROR: Scene line " << lineNumber << ": \"capacity\" needs a whole number above 0" << std::endl;
+						bValuesRead = false;
+					}
+					else
+					{
+						particles.capacity = (uint32_t)value;
+					}
+				}
+				else if (key == "rate")
+					bValuesRead = ReadFloats(line, &particles.rate, 1, lineNumber, key);
+				else if (key == "life")
+					bValuesRead = ReadFloats(line, &particles.lifetime, 1, lineNumber, key);
+				else if (key == "size")
+				{
+					float size[2];
+					bValuesRead = ReadFloats(line, size, 2, lineNumber, key);
+					particles.sizeMin = size[0];
+					particles.sizeMax = size[1];
+				}
+				else if (key == "gravity")
+					bValuesRead = ReadFloats(line, &particles.gravity, 1, lineNumber, key);
+				else if (key == "drag")
+					bValuesRead = ReadFloats(line, &particles.drag, 1, lineNumber, key);
+				else if (key == "wind")
+					bValuesRead = ReadFloats(line, particles.wind, 2, lineNumber, key);
+				else if (key == "gust")
+					bValuesRead = ReadFloats(line, &particles.gust, 1, lineNumber, key);
+				else if (key == "species")
+				{
+					std::string speciesTag;
+					if (!(line >> speciesTag))
+					{
+						std::cout << "ERROR: Scene line " << lineNumber << ": \"species\" needs a tag" << std::endl;
+						bValuesRead = false;
+					}
+					else
+					{
+						particles.speciesHash = HashTag(speciesTag.c_str());
+						particles.speciesString = builder.AddString(speciesTag);
+						bHasSource = true;
+					}
+				}
+				else if (key == "area")
+				{
+					float area[6];
+					bValuesRead = ReadFloats(line, area, 6, lineNumber, key);
+					for (int axis = 0; axis < 3; axis++)
+					{
+						particles.areaMin[axis] = std::min(area[axis], area[axis + 3]);
+						particles.areaMax[axis] = std::max(area[axis], area[axis + 3]);
+					}
+					bHasSource = true;
+				}
+				else
+				{
+					std::cout << "ERROR: Scene line " << lineNumber << ": unknown particles value \"" << key << "\"" << std::endl;
+					bValuesRead = false;
+				}
+			}
+			if (bValuesRead && (bHasSource == false))
+			{
+				std::cout << "ERROR: Scene line " << lineNumber << ": particles need a species or an area" << std::endl;
+				bValuesRead = false;
+			}
+			if (bValuesRead && ((particles.rate < 0.0f) || (particles.lifetime <= 0.0f) || (particles.drag < 0.0f)))
+			{
+				std::cout << "ERROR: Scene line " << lineNumber << ": particles need a rate and drag of at least 0 and a life above 0" << std::endl;
+				bValuesRead = false;
+			}
+			if (bValuesRead == false)
+			{
+				bSuccess = false;
+			}
+
+			particles.textureHash = object.textureHash;
+			particles.textureString = object.textureString;
+			particles.flags = object.flags;
+			std::memcpy(particles.color, object.color, sizeof(particles.color));
+
+			builder.particles.push_back(particles);
+			builder.particlesLines.push_back(lineNumber);
+		}
+		else if (keyword == "light")
+		{
+			std::string type;
+			if (!(line >> type) || ((type != "directional") && (type != "point")))
+			{
+				std::cout << "ERROR: Scene line " << lineNumber << ": a light needs a type, directional or point" << std::endl;
+				bSuccess = false;
+				continue;
+			}
+
+			SCENE_LIGHT light;
+			std::memset(&light, 0, sizeof(light));
+			light.type = (type == "directional") ? SCENE_LIGHT_DIRECTIONAL : SCENE_LIGHT_POINT;
+			light.diffuse[0] = light.diffuse[1] = light.diffuse[2] = 1.0f;
+			light.specular[0] = light.specular[1] = light.specular[2] = 1.0f;
+
+			// a directional light shines in a direction, a point
+			// light sits at a position
+			const char* placementKey = (light.type == SCENE_LIGHT_DIRECTIONAL) ? "direction" : "position";
+			std::string key;
+			bool bValuesRead = true;
+			bool bPlaced = false;
+			while (bValuesRead && (line >> key))
+			{
+				if (key == placementKey)
+				{
+					bValuesRead = ReadFloats(line, light.vector, 3, lineNumber, key);
+					bPlaced = true;
+				}
+				else if (key == "ambient")
+					bValuesRead = ReadFloats(line, light.ambient, 3, lineNumber, key);
+				else if (key == "diffuse")
+					bValuesRead = ReadFloats(line, light.diffuse, 3, lineNumber, key);
+				else if (key == "specular")
+					bValuesRead = ReadFloats(line, light.specular, 3, lineNumber, key);
+				else
+				{
+					std::cout << "ERROR: Scene line " << lineNumber << ": unknown " << type << " light value \"" << key << "\"" << std::endl;
+					bValuesRead = false;
+				}
+			}
+			if (bValuesRead && (bPlaced == false))
+			{
+				std::cout << "ERROR: Scene line " << lineNumber << ": a " << type << " light needs a " << placementKey << std::endl;
+				bValuesRead = false;
+			}
+			if (bValuesRead && (light.type == SCENE_LIGHT_DIRECTIONAL) &&
+				(light.vector[0] == 0.0f) && (light.vector[1] == 0.0f) && (light.vector[2] == 0.0f))
+			{
+				std::cout << "ERROR: Scene line " << lineNumber << ": the light direction must not be zero" << std::endl;
+				bValuesRead = false;
+			}
+			if (light.type == SCENE_LIGHT_DIRECTIONAL)
+			{
+				if (++builder.directionalLights > 1)
+				{
+					std::cout << "ERROR: Scene line " << lineNumber << ": a scene has at most one directional light" << std::endl;
+					bValuesRead = false;
+				}
+			}
+			else if (++builder.pointLights > (int)SCENE_MAX_POINT_LIGHTS)
+			{
+				std::cout << "ERROR: Scene line " << lineNumber << ": a scene has at most " << SCENE_MAX_POINT_LIGHTS << " point lights" << std::endl;
+				bValuesRead = false;
+			}
+			if (bValuesRead == false)
+			{
+				bSuccess = false;
+			}
+
+			builder.lights.push_back(light);
+		}
+		else
+		{
+			std::cout << "ERROR: Scene line " << lineNumber << ": unknown keyword \"" << keyword << "\"" << std::endl;
+			bSuccess = false;
+		}
+	}
+
+	// every texture and material an object uses must be defined
+	for (size_t i = 0; i < builder.objects.size(); i++)
+	{
+		if (!CheckDrawReferences(builder, builder.objects[i], objectLines[i]))
+		{
+			bSuccess = false;
+		}
+	}
+
+	// the same goes for the parts, which must also belong to
+	// a defined species
+	for (size_t i = 0; i < builder.parts.size(); i++)
+	{
+		SCENE_OBJECT object;
+		std::memset(&object, 0, sizeof(object));
+		object.textureHash = builder.parts[i].textureHash;
+		object.textureString = builder.parts[i].textureString;
+		object.materialHash = builder.parts[i].materialHash;
+		object.materialString = builder.parts[i].materialString;
+		object.flags = builder.parts[i].flags;
+		if (!CheckDrawReferences(builder, object, builder.partLines[i]))
+		{
+			bSuccess = false;
+		}
+		if (builder.speciesTags.find(builder.partSpecies[i]) == builder.speciesTags.end())
+		{
+			std::cout << "ERROR: Scene line " << builder.partLines[i] << ": the part belongs to an undefined species" << std::endl;
+			bSuccess = false;
+		}
+	}
+	for (size_t i = 0; i < builder.scatters.size(); i++)
+	{
+		if (builder.speciesTags.find(builder.scatters[i].speciesHash) == builder.speciesTags.end())
+		{
+			std::cout << "ERROR: Scene line " << builder.scatterLines[i] << ": undefined species \""
+				<< &builder.strings[builder.scatters[i].speciesString] << "\"" << std::endl;
+			bSuccess = false;
+		}
+	}
+
+	for (size_t i = 0; i < builder.terrains.size(); i++)
+	{
+		SCENE_OBJECT object;
+		std::memset(&object, 0, sizeof(object));
+		object.textureHash = builder.terrains[i].textureHash;
+		object.textureString = builder.terrains[i].textureString;
+		object.materialHash = builder.terrains[i].materialHash;
+		object.materialString = builder.terrains[i].materialString;
+		object.flags = builder.terrains[i].flags;
+		if (!CheckDrawReferences(builder, object, builder.terrainLine))
+		{
+			bSuccess = false;
+		}
+	}
+
+	for (size_t i = 0; i < builder.particles.size(); i++)
+	{
+		SCENE_OBJECT object;
+		std::memset(&object, 0, sizeof(object));
+		object.textureHash = builder.particles[i].textureHash;
+		object.textureString = builder.particles[i].textureString;
+		object.flags = builder.particles[i].flags;
+		if (!CheckDrawReferences(builder, object, builder.particlesLines[i]))
+		{
+			bSuccess = false;
+		}
+		if ((builder.particles[i].speciesString != SCENE_NO_STRING) &&
+			(builder.speciesTags.find(builder.particles[i].speciesHash) == builder.speciesTags.end()))
+		{
+			std::cout << "ERROR: Scene line " << builder.particlesLines[i] << ": undefined species \""
+				<< &builder.strings[builder.particles[i].speciesString] << "\"" << std::endl;
+			bSuccess = false;
+		}
+	}
+
+	// the parts are stored grouped by species, in the order
+	// they were defined in
+	std::vector<SCENE_SPECIES_PART> groupedParts;
+	for (SCENE_SPECIES& species : builder.species)
+	{
+		species.firstPart = (uint32_t)groupedParts.size();
+		for (size_t i = 0; i < builder.parts.size(); i++)
+		{
+			if (builder.partSpecies[i] == species.tagHash)
+			{
+				groupedParts.push_back(builder.parts[i]);
+			}
+		}
+		species.partCount = (uint32_t)groupedParts.size() - species.firstPart;
+		if (species.partCount == 0)
+		{
+			std::cout << "ERROR: Scene species \"" << &builder.strings[species.tagString] << "\" has no parts" << std::endl;
+			bSuccess = false;
+		}
+	}
+
+	if (bSuccess == false)
+	{
+		std::cout << "ERROR: Scene file " << textFilename << " was not compiled" << std::endl;
+		return false;
+	}
+
+	// lay out the blob - the header is filled in last, once
+	// the offsets of all the arrays are known
+	std::vector<unsigned char> blob(sizeof(SCENE_HEADER), 0);
+	SCENE_HEADER header;
+	header.magic = SCENE_FILE_MAGIC;
+	header.version = SCENE_FILE_VERSION;
+	header.textures = AppendArray(blob, builder.textures.data(), builder.textures.size());
+	header.materials = AppendArray(blob, builder.materials.data(), builder.materials.size());
+	header.meshes = AppendArray(blob, builder.meshes.data(), builder.meshes.size());
+	header.objects = AppendArray(blob, builder.objects.data(), builder.objects.size());
+	header.transforms = AppendArray(blob, builder.transforms.data(), builder.transforms.size());
+	header.species = AppendArray(blob, builder.species.data(), builder.species.size());
+	header.parts = AppendArray(blob, groupedParts.data(), groupedParts.size());
+	header.scatters = AppendArray(blob, builder.scatters.data(), builder.scatters.size());
+	header.terrains = AppendArray(blob, builder.terrains.data(), builder.terrains.size());
+	header.particles = AppendArray(blob, builder.particles.data(), builder.particles.size());
+	header.lights = AppendArray(blob, builder.lights.data(), builder.lights.size());
+	header.strings = AppendArray(blob, builder.strings.data(), builder.strings.size());
+	header.fileSize = (uint32_t)blob.size();
+	std::memcpy(blob.data(), &header, sizeof(header));
+
+	FILE* binaryFile = std::fopen(binaryFilename, "wb");
+	if (binaryFile == nullptr)
+	{
+		std::cout << "ERROR: Could not write scene file:" << binaryFilename << std::endl;
+		return false;
+	}
+	size_t written = std::fwrite(blob.data(), 1, blob.size(), binaryFile);
+	std::fclose(binaryFile);
+
+	if (written != blob.size())
+	{
+		std::cout << "ERROR: Could not write scene file:" << binaryFilename << std::endl;
+		std::remove(binaryFilename);
+		return false;
+	}
+
+	std::cout << "INFO: Compiled scene " << textFilename << " - " << builder.objects.size()
+		<< " objects, " << builder.species.size() << " species, " << blob.size() << " bytes" << std::endl;
+
+	return true;
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for reading a binary scene file
+ *  into one buffer with a single read.  The header, the
+ *  string offsets and the mesh types are checked, and the
+ *  arrays are used in place.
+ ***********************************************************/
+bool SceneFile::Load(const char* binaryFilename)
+{
+	Unload();
+
+	FILE* binaryFile = std::fopen(binaryFilename, "rb");
+	if (binaryFile == nullptr)
+	{
+		std::cout << "ERROR: Could not open scene file:" << binaryFilename << std::endl;
+		return false;
+	}
+
+	std::fseek(binaryFile, 0, SEEK_END);
+	long fileSize = std::ftell(binaryFile);
+	std::fseek(binaryFile, 0, SEEK_SET);
+
+	if (fileSize < (long)sizeof(SCENE_HEADER))
+	{
+		std::cout << "ERROR: Scene file is too small:" << binaryFilename << std::endl;
+		std::fclose(binaryFile);
+		return false;
+	}
+
+	m_pBlob = (unsigned char*)std::malloc((size_t)fileSize);
+	size_t bytesRead = 0;
+	if (m_pBlob != nullptr)
+	{
+		bytesRead = std::fread(m_pBlob, 1, (size_t)fileSize, binaryFile);
+	}
+	std::fclose(binaryFile);
+
+	const SCENE_HEADER* header = (const SCENE_HEADER*)m_pBlob;
+	size_t blobSize = (size_t)fileSize;
+	bool bValid = (m_pBlob != nullptr) && (bytesRead == blobSize) &&
+		(header->magic == SCENE_FILE_MAGIC) &&
+		(header->version == SCENE_FILE_VERSION) &&
+		(header->fileSize == blobSize) &&
+		IsArrayValid(header->textures, sizeof(SCENE_TEXTURE), blobSize) &&
+		IsArrayValid(header->materials, sizeof(SCENE_MATERIAL), blobSize) &&
+		IsArrayValid(header->meshes, sizeof(SCENE_MESH), blobSize) &&
+		IsArrayValid(header->objects, sizeof(SCENE_OBJECT), blobSize) &&
+		IsArrayValid(header->transforms, sizeof(SCENE_TRANSFORM), blobSize) &&
+		IsArrayValid(header->species, sizeof(SCENE_SPECIES), blobSize) &&
+		IsArrayValid(header->parts, sizeof(SCENE_SPECIES_PART), blobSize) &&
+		IsArrayValid(header->scatters, sizeof(SCENE_SCATTER), blobSize) &&
+		IsArrayValid(header->terrains, sizeof(SCENE_TERRAIN), blobSize) &&
+		(header->terrains.count <= 1) &&
+		IsArrayValid(header->particles, sizeof(SCENE_PARTICLES), blobSize) &&
+		IsArrayValid(header->lights, sizeof(SCENE_LIGHT), blobSize) &&
+		IsArrayValid(header->strings, sizeof(char), blobSize) &&
+		(header->transforms.count == header->objects.count) &&
+		((header->strings.count == 0) || (m_pBlob[header->strings.offset + header->strings.count - 1] == '\0'));
+
+	// every offset into the string table, every mesh type and
+	// the lights are checked once here, so the scene can use
+	// them freely
+	bValid = bValid && AreReferencesValid(m_pBlob, *header);
+
+	if (bValid == false)
+	{
+		std::cout << "ERROR: Scene file is damaged or has an old version:" << binaryFilename << std::endl;
+		Unload();
+		return false;
+	}
+
+	m_pHeader = header;
+	m_pTextures = (const SCENE_TEXTURE*)(m_pBlob + header->textures.offset);
+	m_pMaterials = (const SCENE_MATERIAL*)(m_pBlob + header->materials.offset);
+	m_pMeshes = (const SCENE_MESH*)(m_pBlob + header->meshes.offset);
+	m_pObjects = (const SCENE_OBJECT*)(m_pBlob + header->objects.offset);
+	m_pTransforms = (const SCENE_TRANSFORM*)(m_pBlob + header->transforms.offset);
+	m_pSpecies = (const SCENE_SPECIES*)(m_pBlob + header->species.offset);
+	m_pParts = (const SCENE_SPECIES_PART*)(m_pBlob + header->parts.offset);
+	m_pScatters = (const SCENE_SCATTER*)(m_pBlob + header->scatters.offset);
+	m_pTerrains = (const SCENE_TERRAIN*)(m_pBlob + header->terrains.offset);
+	m_pParticles = (const SCENE_PARTICLES*)(m_pBlob + header->particles.offset);
+	m_pLights = (const SCENE_LIGHT*)(m_pBlob + header->lights.offset);
+	m_pStrings = (const char*)(m_pBlob + header->strings.offset);
+
+	return true;
+}
+
+/***********************************************************
+ *  Unload()
+ *
+ *  This method is used for freeing the loaded scene.
+ ***********************************************************/
+void SceneFile::Unload()
+{
+	std::free(m_pBlob);
+	m_pBlob = nullptr;
+	m_pHeader = nullptr;
+	m_pTextures = nullptr;
+	m_pMaterials = nullptr;
+	m_pMeshes = nullptr;
+	m_pObjects = nullptr;
+	m_pTransforms = nullptr;
+	m_pSpecies = nullptr;
+	m_pParts = nullptr;
+	m_pScatters = nullptr;
+	m_pTerrains = nullptr;
+	m_pParticles = nullptr;
+	m_pLights = nullptr;
+	m_pStrings = nullptr;
+}
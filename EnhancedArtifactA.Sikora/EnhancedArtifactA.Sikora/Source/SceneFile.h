@@ -0,0 +1,347 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.h
+// ============
+// compile text scene descriptions into a binary scene blob and load the
+// blob back with a single read
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+/***********************************************************
+ *  Binary scene layout
+ *
+ *  The blob starts with a SCENE_HEADER, followed by the
+ *  arrays it points at and a table of zero terminated
+ *  strings.  All offsets are in bytes from the start of the
+ *  blob and every array is 4-byte aligned, so the loaded
+ *  blob is used in place - either read into one buffer or
+ *  mapped straight from the file.  Tags are stored as both
+ *  their HashTag() value and a string for error messages.
+ ***********************************************************/
+const uint32_t SCENE_FILE_MAGIC = 0x4E435353;	// "SSCN"
+const uint32_t SCENE_FILE_VERSION = 5;
+// string offset of an optional string that is not set
+const uint32_t SCENE_NO_STRING = 0xFFFFFFFFu;
+
+struct SCENE_ARRAY
+{
+	uint32_t offset;
+	uint32_t count;
+};
+
+struct SCENE_HEADER
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t fileSize;
+	SCENE_ARRAY textures;		// SCENE_TEXTURE
+	SCENE_ARRAY materials;		// SCENE_MATERIAL
+	SCENE_ARRAY meshes;			// SCENE_MESH
+	SCENE_ARRAY objects;		// SCENE_OBJECT
+	SCENE_ARRAY transforms;		// SCENE_TRANSFORM, one per object
+	SCENE_ARRAY species;		// SCENE_SPECIES
+	SCENE_ARRAY parts;			// SCENE_SPECIES_PART, grouped by species
+	SCENE_ARRAY scatters;		// SCENE_SCATTER
+	SCENE_ARRAY terrains;		// SCENE_TERRAIN, at most one
+	SCENE_ARRAY particles;		// SCENE_PARTICLES
+	SCENE_ARRAY lights;			// SCENE_LIGHT
+	SCENE_ARRAY strings;		// characters of the string table
+};
+
+struct SCENE_TEXTURE
+{
+	uint32_t tagHash;
+	uint32_t tagString;
+	uint32_t fileString;
+};
+
+struct SCENE_MATERIAL
+{
+	uint32_t tagHash;
+	uint32_t tagString;
+	float ambientColor[3];
+	float ambientStrength;
+	float diffuseColor[3];
+	float specularColor[3];
+	float shininess;
+};
+
+struct SCENE_MESH
+{
+	uint32_t tagHash;
+	uint32_t tagString;
+	// ShapeMeshes::MESH_TYPE of the mesh
+	uint32_t meshType;
+};
+
+// flags of a scene object
+const uint32_t SCENE_OBJECT_TEXTURED = 0x1;
+const uint32_t SCENE_OBJECT_MATERIAL = 0x2;
+// the object never moves and is merged into a static batch
+const uint32_t SCENE_OBJECT_STATIC = 0x4;
+// the object is large and solid and hides what is behind it
+const uint32_t SCENE_OBJECT_OCCLUDER = 0x8;
+
+struct SCENE_OBJECT
+{
+	uint32_t meshHash;
+	uint32_t meshString;
+	// texture tag when SCENE_OBJECT_TEXTURED is set
+	uint32_t textureHash;
+	uint32_t textureString;
+	// material tag when SCENE_OBJECT_MATERIAL is set, an
+	// object without one keeps the material of the previous
+	uint32_t materialHash;
+	uint32_t materialString;
+	uint32_t flags;
+	// color used when the object is not textured
+	float color[4];
+	float UVscale[2];
+};
+
+struct SCENE_TRANSFORM
+{
+	float scaleXYZ[3];
+	float rotationDegrees[3];
+	float positionXYZ[3];
+};
+
+/***********************************************************
+ *  Vegetation
+ *
+ *  A species is a composite of basic meshes, its parts,
+ *  that is scattered over the ground in many instances.
+ *  Instances closer than fadeStart are drawn with their
+ *  full geometry, instances farther than fadeEnd as an
+ *  impostor billboard, and the two are crossfaded between.
+ ***********************************************************/
+struct SCENE_SPECIES
+{
+	uint32_t tagHash;
+	uint32_t tagString;
+	float fadeStart;
+	float fadeEnd;
+	// camera distance the species is not drawn from
+	float drawDistance;
+	uint32_t firstPart;
+	uint32_t partCount;
+};
+
+struct SCENE_SPECIES_PART
+{
+	uint32_t meshHash;
+	uint32_t meshString;
+	// same meaning as the values of a scene object, only
+	// SCENE_OBJECT_TEXTURED and SCENE_OBJECT_MATERIAL are used
+	uint32_t textureHash;
+	uint32_t textureString;
+	uint32_t materialHash;
+	uint32_t materialString;
+	uint32_t flags;
+	float color[4];
+	float UVscale[2];
+	// placement of the part in the space of the species
+	SCENE_TRANSFORM transform;
+};
+
+struct SCENE_SCATTER
+{
+	uint32_t speciesHash;
+	uint32_t speciesString;
+	// number of instances to place and the seed of the
+	// random placement, so the layout is the same every run
+	uint32_t count;
+	uint32_t seed;
+	// ground rectangle the instances are placed in, in x z
+	float areaMin[2];
+	float areaMax[2];
+	// range of the random uniform scale of an instance
+	float scaleMin;
+	float scaleMax;
+	// greyscale image spread over the area that gives the
+	// chance of an instance at each point, or SCENE_NO_STRING
+	uint32_t densityString;
+};
+
+/***********************************************************
+ *  Terrain
+ *
+ *  A square of heights centered on the origin, generated
+ *  from noise or read from a heightmap, with a rectangle
+ *  kept flat at height zero for the scene objects.
+ ***********************************************************/
+struct SCENE_TERRAIN
+{
+	// same meaning as the values of a scene object, only
+	// SCENE_OBJECT_TEXTURED and SCENE_OBJECT_MATERIAL are used,
+	// and the UV scale is the texture repeats per unit
+	uint32_t textureHash;
+	uint32_t textureString;
+	uint32_t materialHash;
+	uint32_t materialString;
+	uint32_t flags;
+	float color[4];
+	float UVscale[2];
+	// side length and height samples per side
+	float size;
+	uint32_t resolution;
+	// height of the highest hills, and the size of the hills
+	// and the seed of the noise they are generated from
+	float heightScale;
+	float featureSize;
+	uint32_t seed;
+	// x z rectangle kept flat, and the distance the hills
+	// rise back over around it - no flat area when the blend
+	// distance is negative
+	float flatMin[2];
+	float flatMax[2];
+	float flatBlend;
+	// greyscale image used instead of the noise, or
+	// SCENE_NO_STRING
+	uint32_t heightmapString;
+};
+
+/***********************************************************
+ *  Particles
+ *
+ *  An effect of many small billboards, like falling leaves,
+ *  emitted from the crowns of a species or from a box, and
+ *  blown around by the wind until they settle on the ground
+ *  and their lifetime runs out.
+ ***********************************************************/
+struct SCENE_PARTICLES
+{
+	uint32_t tagHash;
+	uint32_t tagString;
+	// same meaning as the values of a scene object, only
+	// SCENE_OBJECT_TEXTURED is used
+	uint32_t textureHash;
+	uint32_t textureString;
+	uint32_t flags;
+	float color[4];
+	// most particles alive at once, and particles emitted per
+	// second and how long each lives
+	uint32_t capacity;
+	float rate;
+	float lifetime;
+	// range of the random size of a particle
+	float sizeMin;
+	float sizeMax;
+	// downward pull, and how quickly a particle takes on the
+	// speed of the wind
+	float gravity;
+	float drag;
+	// steady wind in x z, and the strength of the gusts
+	float wind[2];
+	float gust;
+	// species whose instances emit the particles, or
+	// SCENE_NO_STRING when they are emitted from the box
+	uint32_t speciesHash;
+	uint32_t speciesString;
+	float areaMin[3];
+	float areaMax[3];
+};
+
+/***********************************************************
+ *  Lights
+ *
+ *  At most one sun like directional light and a few point
+ *  lights, with the colors the scene shader lights with.
+ ***********************************************************/
+const uint32_t SCENE_LIGHT_DIRECTIONAL = 0;
+const uint32_t SCENE_LIGHT_POINT = 1;
+// most point lights the scene shader has uniforms for
+const uint32_t SCENE_MAX_POINT_LIGHTS = 5;
+
+struct SCENE_LIGHT
+{
+	uint32_t type;
+	// direction the light shines in for the directional
+	// light, position for a point light
+	float vector[3];
+	float ambient[3];
+	float diffuse[3];
+	float specular[3];
+};
+
+/***********************************************************
+ *  SceneFile
+ *
+ *  Holds one loaded scene blob.  The text form of a scene
+ *  is compiled into the blob by CompileText(), which is
+ *  where all of the parsing and validation happens; Load()
+ *  checks the header, the array bounds, the string offsets,
+ *  the mesh types and the lights, so a damaged file is
+ *  rejected.
+ ***********************************************************/
+class SceneFile
+{
+public:
+	// constructor
+	SceneFile();
+	// destructor
+	~SceneFile();
+
+	// compile a text scene into a binary scene file
+	static bool CompileText(const char* textFilename, const char* binaryFilename);
+	// true when the binary scene file is missing, older than
+	// the text scene it was compiled from, or of an older
+	// version
+	static bool IsOutOfDate(const char* textFilename, const char* binaryFilename);
+
+	// load a binary scene file, replacing any loaded scene
+	bool Load(const char* binaryFilename);
+	// free the loaded scene
+	void Unload();
+
+	uint32_t GetTextureCount() const { return m_pHeader ? m_pHeader->textures.count : 0; }
+	uint32_t GetMaterialCount() const { return m_pHeader ? m_pHeader->materials.count : 0; }
+	uint32_t GetMeshCount() const { return m_pHeader ? m_pHeader->meshes.count : 0; }
+	uint32_t GetObjectCount() const { return m_pHeader ? m_pHeader->objects.count : 0; }
+	uint32_t GetSpeciesCount() const { return m_pHeader ? m_pHeader->species.count : 0; }
+	uint32_t GetScatterCount() const { return m_pHeader ? m_pHeader->scatters.count : 0; }
+	uint32_t GetParticlesCount() const { return m_pHeader ? m_pHeader->particles.count : 0; }
+	uint32_t GetLightCount() const { return m_pHeader ? m_pHeader->lights.count : 0; }
+
+	const SCENE_TEXTURE* GetTextures() const { return m_pTextures; }
+	const SCENE_MATERIAL* GetMaterials() const { return m_pMaterials; }
+	const SCENE_MESH* GetMeshes() const { return m_pMeshes; }
+	const SCENE_OBJECT* GetObjects() const { return m_pObjects; }
+	const SCENE_TRANSFORM* GetTransforms() const { return m_pTransforms; }
+	const SCENE_SPECIES* GetSpecies() const { return m_pSpecies; }
+	const SCENE_SPECIES_PART* GetParts() const { return m_pParts; }
+	const SCENE_SCATTER* GetScatters() const { return m_pScatters; }
+	const SCENE_PARTICLES* GetParticles() const { return m_pParticles; }
+	const SCENE_LIGHT* GetLights() const { return m_pLights; }
+	// the terrain, or null when the scene has none
+	const SCENE_TERRAIN* GetTerrain() const { return (m_pHeader && (m_pHeader->terrains.count > 0)) ? m_pTerrains : nullptr; }
+
+	// string from the string table of the loaded scene
+	const char* GetString(uint32_t offset) const { return m_pStrings + offset; }
+
+private:
+	// the whole blob as read from the file
+	unsigned char* m_pBlob;
+	const SCENE_HEADER* m_pHeader;
+	const SCENE_TEXTURE* m_pTextures;
+	const SCENE_MATERIAL* m_pMaterials;
+	const SCENE_MESH* m_pMeshes;
+	const SCENE_OBJECT* m_pObjects;
+	const SCENE_TRANSFORM* m_pTransforms;
+	const SCENE_SPECIES* m_pSpecies;
+	const SCENE_SPECIES_PART* m_pParts;
+	const SCENE_SCATTER* m_pScatters;
+	const SCENE_TERRAIN* m_pTerrains;
+	const SCENE_PARTICLES* m_pParticles;
+	const SCENE_LIGHT* m_pLights;
+	const char* m_pStrings;
+
+	// scene blobs own their memory and must not be copied
+	SceneFile(const SceneFile&) = delete;
+	SceneFile& operator=(const SceneFile&) = delete;
+};
@@ -0,0 +1,431 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegeometry.cpp
+// ============
+// the meshes, surfaces, textures and lights of a scene file in CPU memory,
+// resolved the way the scene manager resolves them, for the renderers that
+// draw without an OpenGL context
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneGeometry.h"
+#include "ShapeMeshes.h"
+#include "TerrainSystem.h"
+
+#include "stb_image.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <cmath>
+#include <iostream>
+
+/***********************************************************
+ *  SceneGeometry()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneGeometry::SceneGeometry()
+{
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for resolving the scene file into
+ *  meshes, instances, surfaces and lights.  Every object
+ *  gets the model matrix, texture, color and material the
+ *  scene manager draws it with, including the material it
+ *  keeps from the object before it.
+ ***********************************************************/
+bool SceneGeometry::Build(const SceneFile& sceneFile)
+{
+	Clear();
+
+	// one mesh per mesh of the scene file, generated from the
+	// full meshes the half meshes are cut from
+	ShapeMeshes meshes(false);
+	uint32_t loadedMeshMask = 0;
+	const SCENE_MESH* sceneMeshes = sceneFile.GetMeshes();
+	m_meshes.resize(sceneFile.GetMeshCount());
+	for (uint32_t i = 0; i < sceneFile.GetMeshCount(); i++)
+	{
+		ShapeMeshes::MESH_TYPE mesh = (ShapeMeshes::MESH_TYPE)sceneMeshes[i].meshType;
+		if (mesh == ShapeMeshes::MESH_HALF_SPHERE)
+		{
+			mesh = ShapeMeshes::MESH_SPHERE;
+		}
+		else if (mesh == ShapeMeshes::MESH_HALF_TORUS)
+		{
+			mesh = ShapeMeshes::MESH_TORUS;
+		}
+		if ((loadedMeshMask & (1u << mesh)) == 0)
+		{
+			loadedMeshMask |= 1u << mesh;
+			switch (mesh)
+			{
+			case ShapeMeshes::MESH_BOX: meshes.LoadBoxMesh(); break;
+			case ShapeMeshes::MESH_CONE: meshes.LoadConeMesh(); break;
+			case ShapeMeshes::MESH_CYLINDER: meshes.LoadCylinderMesh(); break;
+			case ShapeMeshes::MESH_PLANE: meshes.LoadPlaneMesh(); break;
+			case ShapeMeshes::MESH_PRISM: meshes.LoadPrismMesh(); break;
+			case ShapeMeshes::MESH_PYRAMID3: meshes.LoadPyramid3Mesh(); break;
+			case ShapeMeshes::MESH_PYRAMID4: meshes.LoadPyramid4Mesh(); break;
+			case ShapeMeshes::MESH_SPHERE: meshes.LoadSphereMesh(); break;
+			case ShapeMeshes::MESH_TAPERED_CYLINDER: meshes.LoadTaperedCylinderMesh(); break;
+			case ShapeMeshes::MESH_TORUS: meshes.LoadTorusMesh(); break;
+			default: break;
+			}
+		}
+		meshes.GetMeshGeometry((ShapeMeshes::MESH_TYPE)sceneMeshes[i].meshType, m_meshes[i].vertices, m_meshes[i].indices);
+	}
+
+	const SCENE_TEXTURE* sceneTextures = sceneFile.GetTextures();
+	std::vector<int> textureIndices;
+	for (uint32_t i = 0; i < sceneFile.GetTextureCount(); i++)
+	{
+		textureIndices.push_back(LoadTexture(sceneFile.GetString(sceneTextures[i].fileString)));
+	}
+	// the scene texture with the tag, or -1 when none has it
+	auto findTexture = [&](uint32_t textureHash)
+	{
+		for (uint32_t i = 0; i < sceneFile.GetTextureCount(); i++)
+		{
+			if (sceneTextures[i].tagHash == textureHash)
+			{
+				return (int)i;
+			}
+		}
+		return -1;
+	};
+
+	const SCENE_MATERIAL* sceneMaterials = sceneFile.GetMaterials();
+	for (uint32_t i = 0; i < sceneFile.GetMaterialCount(); i++)
+	{
+		GEOMETRY_MATERIAL material;
+		material.diffuseColor = glm::vec3(sceneMaterials[i].diffuseColor[0], sceneMaterials[i].diffuseColor[1], sceneMaterials[i].diffuseColor[2]);
+		material.specularColor = glm::vec3(sceneMaterials[i].specularColor[0], sceneMaterials[i].specularColor[1], sceneMaterials[i].specularColor[2]);
+		material.shininess = sceneMaterials[i].shininess;
+		m_materials.push_back(material);
+	}
+	auto findMaterial = [&](uint32_t materialHash)
+	{
+		for (uint32_t i = 0; i < sceneFile.GetMaterialCount(); i++)
+		{
+			if (sceneMaterials[i].tagHash == materialHash)
+			{
+				return (int)i;
+			}
+		}
+		return -1;
+	};
+
+	const SCENE_OBJECT* objects = sceneFile.GetObjects();
+	const SCENE_TRANSFORM* transforms = sceneFile.GetTransforms();
+	int material = -1;
+	int invalidCount = 0;
+	for (uint32_t i = 0; i < sceneFile.GetObjectCount(); i++)
+	{
+		const SCENE_OBJECT& object = objects[i];
+
+		GEOMETRY_INSTANCE instance;
+		instance.mesh = -1;
+		for (uint32_t mesh = 0; mesh < sceneFile.GetMeshCount(); mesh++)
+		{
+			if (sceneMeshes[mesh].tagHash == object.meshHash)
+			{
+				instance.mesh = (int)mesh;
+			}
+		}
+		int sceneTexture = ((object.flags & SCENE_OBJECT_TEXTURED) != 0) ? findTexture(object.textureHash) : -1;
+		int objectMaterial = ((object.flags & SCENE_OBJECT_MATERIAL) != 0) ? findMaterial(object.materialHash) : -1;
+
+		// objects using a tag that is not in the scene file are
+		// left out, with the material they name, like the scene
+		// manager leaves them out
+		if ((instance.mesh < 0) ||
+			(((object.flags & SCENE_OBJECT_TEXTURED) != 0) && (sceneTexture < 0)) ||
+			(((object.flags & SCENE_OBJECT_MATERIAL) != 0) && (objectMaterial < 0)))
+		{
+			invalidCount++;
+			continue;
+		}
+		if (objectMaterial >= 0)
+		{
+			material = objectMaterial;
+		}
+		if (m_meshes[instance.mesh].indices.empty())
+		{
+			continue;
+		}
+
+		const SCENE_TRANSFORM& transform = transforms[i];
+		instance.modelMatrix =
+			glm::translate(glm::vec3(transform.positionXYZ[0], transform.positionXYZ[1], transform.positionXYZ[2])) *
+			glm::rotate(glm::radians(transform.rotationDegrees[2]), glm::vec3(0.0f, 0.0f, 1.0f)) *
+			glm::rotate(glm::radians(transform.rotationDegrees[1]), glm::vec3(0.0f, 1.0f, 0.0f)) *
+			glm::rotate(glm::radians(transform.rotationDegrees[0]), glm::vec3(1.0f, 0.0f, 0.0f)) *
+			glm::scale(glm::vec3(transform.scaleXYZ[0], transform.scaleXYZ[1], transform.scaleXYZ[2]));
+
+		int texture = (sceneTexture >= 0) ? textureIndices[sceneTexture] : -1;
+		instance.surface = AddSurface(object.flags, texture, object.color, object.UVscale, material);
+		m_instances.push_back(instance);
+	}
+	if (invalidCount > 0)
+	{
+		std::cout << "ERROR: " << invalidCount << " of the " << sceneFile.GetObjectCount()
+			<< " scene objects use unknown tags and are left out" << std::endl;
+	}
+
+	// the terrain is drawn after the objects, so without a
+	// material of its own it keeps the last one they set
+	const SCENE_TERRAIN* terrain = sceneFile.GetTerrain();
+	if (nullptr != terrain)
+	{
+		if ((terrain->flags & SCENE_OBJECT_MATERIAL) != 0)
+		{
+			int terrainMaterial = findMaterial(terrain->materialHash);
+			if (terrainMaterial >= 0)
+			{
+				material = terrainMaterial;
+			}
+		}
+		const char* heightmapFilename = nullptr;
+		if (terrain->heightmapString != SCENE_NO_STRING)
+		{
+			heightmapFilename = sceneFile.GetString(terrain->heightmapString);
+		}
+		int sceneTexture = ((terrain->flags & SCENE_OBJECT_TEXTURED) != 0) ? findTexture(terrain->textureHash) : -1;
+		int texture = (sceneTexture >= 0) ? textureIndices[sceneTexture] : -1;
+		AddTerrain(*terrain, heightmapFilename, AddSurface(terrain->flags, texture, terrain->color, terrain->UVscale, material));
+	}
+
+	const SCENE_LIGHT* lights = sceneFile.GetLights();
+	for (uint32_t i = 0; i < sceneFile.GetLightCount(); i++)
+	{
+		GEOMETRY_LIGHT light;
+		light.bDirectional = (lights[i].type == SCENE_LIGHT_DIRECTIONAL);
+		light.vector = glm::vec3(lights[i].vector[0], lights[i].vector[1], lights[i].vector[2]);
+		light.ambient = glm::vec3(lights[i].ambient[0], lights[i].ambient[1], lights[i].ambient[2]);
+		light.diffuse = glm::vec3(lights[i].diffuse[0], lights[i].diffuse[1], lights[i].diffuse[2]);
+		light.specular = glm::vec3(lights[i].specular[0], lights[i].specular[1], lights[i].specular[2]);
+		m_lights.push_back(light);
+	}
+
+	if (m_instances.empty())
+	{
+		std::cout << "ERROR: The scene has no geometry to render" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for freeing the built data.
+ ***********************************************************/
+void SceneGeometry::Clear()
+{
+	m_meshes.clear();
+	m_surfaces.clear();
+	m_materials.clear();
+	m_textures.clear();
+	m_instances.clear();
+	m_lights.clear();
+}
+
+/***********************************************************
+ *  GetTriangleCount()
+ *
+ *  This method is used for counting the triangles of all of
+ *  the instances.
+ ***********************************************************/
+size_t SceneGeometry::GetTriangleCount() const
+{
+	size_t triangleCount = 0;
+	for (const GEOMETRY_INSTANCE& instance : m_instances)
+	{
+		triangleCount += m_meshes[instance.mesh].indices.size() / 3;
+	}
+	return triangleCount;
+}
+
+/***********************************************************
+ *  AddSurface()
+ *
+ *  This method is used for adding the surface of an object
+ *  or of the terrain.  Textured surfaces are white where
+ *  the scene shader would use the color.
+ ***********************************************************/
+int SceneGeometry::AddSurface(uint32_t flags, int texture, const float* color, const float* UVscale, int material)
+{
+	GEOMETRY_SURFACE surface;
+	surface.texture = texture;
+	surface.color = glm::vec4(color[0], color[1], color[2], color[3]);
+	if ((flags & SCENE_OBJECT_TEXTURED) != 0)
+	{
+		surface.color = glm::vec4(1.0f);
+	}
+	surface.UVscale = glm::vec2(UVscale[0], UVscale[1]);
+	surface.material = material;
+	surface.bOpaque = (texture >= 0) ? m_textures[texture].bOpaque : (surface.color.a >= 1.0f);
+
+	m_surfaces.push_back(surface);
+	return (int)m_surfaces.size() - 1;
+}
+
+/***********************************************************
+ *  AddTerrain()
+ *
+ *  This method is used for adding the terrain as a world
+ *  space mesh of two triangles per square of its height
+ *  samples, from the heightmap when there is one and from
+ *  noise otherwise.  The normals and texture coordinates
+ *  follow the terrain shader, so the texture repeats are
+ *  in the coordinates and the surface does not scale them.
+ ***********************************************************/
+void SceneGeometry::AddTerrain(const SCENE_TERRAIN& terrain, const char* heightmapFilename, int surface)
+{
+	TerrainSystem heights;
+	bool bHasHeights = false;
+	if (nullptr != heightmapFilename)
+	{
+		bHasHeights = heights.LoadHeightmap(heightmapFilename, terrain.size, terrain.heightScale);
+	}
+	if (bHasHeights == false)
+	{
+		bHasHeights = heights.GenerateHeights(terrain.size, (int)terrain.resolution, terrain.heightScale, terrain.featureSize, terrain.seed);
+	}
+	if (bHasHeights == false)
+	{
+		return;
+	}
+	if (terrain.flatBlend >= 0.0f)
+	{
+		heights.FlattenArea(
+			glm::vec2(terrain.flatMin[0], terrain.flatMin[1]),
+			glm::vec2(terrain.flatMax[0], terrain.flatMax[1]),
+			terrain.flatBlend);
+	}
+
+	glm::vec4 area = heights.GetArea();
+	int resolution = (int)area.w;
+	float spacing = area.z / (float)(resolution - 1);
+	glm::vec2 UVscale(terrain.UVscale[0], terrain.UVscale[1]);
+
+	GEOMETRY_MESH mesh;
+	mesh.vertices.reserve((size_t)resolution * resolution * 8);
+	for (int z = 0; z < resolution; z++)
+	{
+		for (int x = 0; x < resolution; x++)
+		{
+			float worldX = area.x + (float)x * spacing;
+			float worldZ = area.y + (float)z * spacing;
+			float left = heights.GetHeight(worldX - spacing, worldZ);
+			float right = heights.GetHeight(worldX + spacing, worldZ);
+			float back = heights.GetHeight(worldX, worldZ - spacing);
+			float front = heights.GetHeight(worldX, worldZ + spacing);
+			glm::vec3 normal = glm::normalize(glm::vec3(left - right, 2.0f * spacing, back - front));
+			glm::vec2 textureCoordinate = glm::vec2(worldX, worldZ) * UVscale;
+
+			float vertex[8] = {
+				worldX, heights.GetHeight(worldX, worldZ), worldZ,
+				normal.x, normal.y, normal.z,
+				textureCoordinate.x, textureCoordinate.y };
+			mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + 8);
+		}
+	}
+
+	mesh.indices.reserve((size_t)(resolution - 1) * (resolution - 1) * 6);
+	for (int z = 0; z + 1 < resolution; z++)
+	{
+		for (int x = 0; x + 1 < resolution; x++)
+		{
+			unsigned int corner = (unsigned int)(z * resolution + x);
+			unsigned int quad[6] = {
+				corner, corner + resolution, corner + resolution + 1,
+				corner, corner + resolution + 1, corner + 1 };
+			mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+		}
+	}
+
+	m_meshes.push_back(mesh);
+	m_surfaces[surface].UVscale = glm::vec2(1.0f);
+
+	GEOMETRY_INSTANCE instance;
+	instance.mesh = (int)m_meshes.size() - 1;
+	instance.modelMatrix = glm::mat4(1.0f);
+	instance.surface = surface;
+	m_instances.push_back(instance);
+}
+
+/***********************************************************
+ *  LoadTexture()
+ *
+ *  This method is used for loading a texture image as RGBA
+ *  colors from 0 to 1.
+ ***********************************************************/
+int SceneGeometry::LoadTexture(const char* filename)
+{
+	int width = 0;
+	int height = 0;
+	int colorChannels = 0;
+	stbi_set_flip_vertically_on_load(true);
+	unsigned char* image = stbi_load(filename, &width, &height, &colorChannels, 4);
+	if (nullptr == image)
+	{
+		std::cout << "ERROR: Could not load image:" << filename << std::endl;
+		return -1;
+	}
+
+	GEOMETRY_TEXTURE texture;
+	texture.width = width;
+	texture.height = height;
+	texture.bOpaque = true;
+	texture.texels.resize((size_t)width * height);
+	for (size_t i = 0; i < texture.texels.size(); i++)
+	{
+		texture.texels[i] = glm::vec4(image[i * 4], image[i * 4 + 1], image[i * 4 + 2], image[i * 4 + 3]) / 255.0f;
+		if (image[i * 4 + 3] != 255)
+		{
+			texture.bOpaque = false;
+		}
+	}
+	stbi_image_free(image);
+
+	m_textures.push_back(texture);
+	return (int)m_textures.size() - 1;
+}
+
+/***********************************************************
+ *  SampleTexture()
+ *
+ *  This method is used for reading a texture with bilinear
+ *  filtering, repeating it outside of 0 to 1.
+ ***********************************************************/
+glm::vec4 SceneGeometry::SampleTexture(int texture, glm::vec2 textureCoordinate) const
+{
+	const GEOMETRY_TEXTURE& image = m_textures[texture];
+
+	float x = textureCoordinate.x * image.width - 0.5f;
+	float y = textureCoordinate.y * image.height - 0.5f;
+	float floorX = std::floor(x);
+	float floorY = std::floor(y);
+	float fractionX = x - floorX;
+	float fractionY = y - floorY;
+
+	auto wrap = [](int value, int size)
+	{
+		value %= size;
+		return (value < 0) ? (value + size) : value;
+	};
+	int x0 = wrap((int)floorX, image.width);
+	int y0 = wrap((int)floorY, image.height);
+	int x1 = wrap(x0 + 1, image.width);
+	int y1 = wrap(y0 + 1, image.height);
+
+	glm::vec4 lower = glm::mix(image.texels[(size_t)y0 * image.width + x0], image.texels[(size_t)y0 * image.width + x1], fractionX);
+	glm::vec4 upper = glm::mix(image.texels[(size_t)y1 * image.width + x0], image.texels[(size_t)y1 * image.width + x1], fractionX);
+	return glm::mix(lower, upper, fractionY);
+}
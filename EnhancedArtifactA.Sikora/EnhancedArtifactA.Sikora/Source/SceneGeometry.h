@@ -0,0 +1,145 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegeometry.h
+// ============
+// the meshes, surfaces, textures and lights of a scene file in CPU memory,
+// resolved the way the scene manager resolves them, for the renderers that
+// draw without an OpenGL context
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneFile.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  GEOMETRY_MESH
+ *
+ *  Interleaved vertices of ShapeMeshes::FLOATS_PER_MESH_VERTEX
+ *  floats - position, normal and texture coordinate - and
+ *  a triangle list.
+ ***********************************************************/
+struct GEOMETRY_MESH
+{
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+};
+
+/***********************************************************
+ *  GEOMETRY_SURFACE
+ *
+ *  Look of one drawn object.  The material is the one the
+ *  scene shader holds when the object is drawn, which is
+ *  the material of the last object before it that set one,
+ *  or -1 when no object has set one yet.
+ ***********************************************************/
+struct GEOMETRY_SURFACE
+{
+	// texture to sample, or -1 to use the color
+	int texture;
+	glm::vec4 color;
+	glm::vec2 UVscale;
+	int material;
+	// true when nothing behind the surface shows through it
+	bool bOpaque;
+};
+
+struct GEOMETRY_MATERIAL
+{
+	glm::vec3 diffuseColor;
+	glm::vec3 specularColor;
+	float shininess;
+};
+
+/***********************************************************
+ *  GEOMETRY_TEXTURE
+ *
+ *  RGBA texels from 0 to 1, flipped like the OpenGL
+ *  textures so the texture coordinates of the meshes match.
+ ***********************************************************/
+struct GEOMETRY_TEXTURE
+{
+	int width;
+	int height;
+	std::vector<glm::vec4> texels;
+	// true when every texel has an alpha of 1
+	bool bOpaque;
+};
+
+struct GEOMETRY_INSTANCE
+{
+	int mesh;
+	glm::mat4 modelMatrix;
+	int surface;
+};
+
+struct GEOMETRY_LIGHT
+{
+	bool bDirectional;
+	// direction the light shines in, or its position
+	glm::vec3 vector;
+	glm::vec3 ambient;
+	glm::vec3 diffuse;
+	glm::vec3 specular;
+};
+
+/***********************************************************
+ *  SceneGeometry
+ *
+ *  One mesh per mesh of the scene file, generated without
+ *  GL buffers, and one instance per scene object with its
+ *  model matrix and surface.  The terrain becomes one more
+ *  mesh, already in world space, with the heights, normals
+ *  and texture repeats the terrain shader gives it at its
+ *  finest level of detail.  Vegetation and particles are
+ *  left out.
+ ***********************************************************/
+class SceneGeometry
+{
+public:
+	// constructor
+	SceneGeometry();
+
+	// resolve the objects, terrain and lights of a loaded
+	// scene file, returns false when nothing can be drawn
+	bool Build(const SceneFile& sceneFile);
+	// free the built data
+	void Clear();
+
+	// read a texture with bilinear filtering, repeating it
+	// outside of 0 to 1, as the OpenGL textures are read
+	glm::vec4 SampleTexture(int texture, glm::vec2 textureCoordinate) const;
+
+	const std::vector<GEOMETRY_MESH>& GetMeshes() const { return m_meshes; }
+	const std::vector<GEOMETRY_SURFACE>& GetSurfaces() const { return m_surfaces; }
+	const std::vector<GEOMETRY_MATERIAL>& GetMaterials() const { return m_materials; }
+	const std::vector<GEOMETRY_TEXTURE>& GetTextures() const { return m_textures; }
+	const std::vector<GEOMETRY_INSTANCE>& GetInstances() const { return m_instances; }
+	const std::vector<GEOMETRY_LIGHT>& GetLights() const { return m_lights; }
+	// triangles of all of the instances together
+	size_t GetTriangleCount() const;
+
+private:
+	std::vector<GEOMETRY_MESH> m_meshes;
+	std::vector<GEOMETRY_SURFACE> m_surfaces;
+	std::vector<GEOMETRY_MATERIAL> m_materials;
+	std::vector<GEOMETRY_TEXTURE> m_textures;
+	std::vector<GEOMETRY_INSTANCE> m_instances;
+	std::vector<GEOMETRY_LIGHT> m_lights;
+
+	// load the image of a texture, returns its index or -1
+	int LoadTexture(const char* filename);
+	// add the surface of an object or of the terrain
+	int AddSurface(uint32_t flags, int texture, const float* color, const float* UVscale, int material);
+	// add the terrain of the scene file as a world space mesh
+	void AddTerrain(const SCENE_TERRAIN& terrain, const char* heightmapFilename, int surface);
+
+	// the geometry holds large buffers that must not be copied
+	SceneGeometry(const SceneGeometry&) = delete;
+	SceneGeometry& operator=(const SceneGeometry&) = delete;
+};
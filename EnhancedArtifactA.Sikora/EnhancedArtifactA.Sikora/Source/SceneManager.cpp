@@ -9,14 +9,24 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "MeshProcessing.h"
+#include "GLResources.h"
+#include "GLDebug.h"
+#include "GpuMemory.h"
+#include "TextureAtlas.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #endif
 
+#include <glm/gtx/intersect.hpp>
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
 // declaration of global variables
 namespace
 {
@@ -25,6 +35,76 @@ namespace
 	const char* g_TextureValueName = "objectTexture";
 	const char* g_UseTextureName = "bUseTexture";
 	const char* g_UseLightingName = "bUseLighting";
+	const char* g_UseObjectModelName = "bUseObjectModel";
+	const char* g_UseObjectTextureName = "bUseObjectTexture";
+
+	// number of draw packets composed by one job
+	const int g_ComposeGrainSize = 256;
+
+	// layout of a draw packet sort key - translucent packets
+	// are kept last and in recorded order, opaque packets are
+	// grouped by texture, then material, then mesh - the
+	// texture is the streamed texture and the slot within it
+	const int g_SortTranslucentShift = 63;
+	const int g_SortTextureShift = 52;
+	const int g_SortSlotBits = 4;
+	const int g_SortMaterialShift = 40;
+	const int g_SortMeshShift = 32;
+	const uint64_t g_SortIndexMask = 0xFFFFFFFFull;
+	// sort key of a packet hidden by the occluders, which is
+	// removed before the frame is submitted
+	const uint64_t g_CulledSortKey = 0xFFFFFFFFFFFFFFFFull;
+
+	// number of sort keys tested against the depth pyramid by one job
+	const int g_CullGrainSize = 256;
+
+
+	// text scene and the binary scene it is compiled into
+	const char* g_SceneTextFile = "scenes/garden.scene";
+	const char* g_SceneBinaryFile = "scenes/garden.bin";
+
+	// shaders of the scene, and the SPIR-V they are compiled to
+	// by the pre-build step of the project
+	const char* g_VertexShaderFile = "shaders/vertexShader.glsl";
+	const char* g_FragmentShaderFile = "shaders/fragmentShader.glsl";
+	const char* g_VertexSpirvFile = "shaders/spirv/vertexShader.spv";
+	const char* g_FragmentSpirvFile = "shaders/spirv/fragmentShader.spv";
+	// specialization constants of the scene fragment shader
+	const GLuint g_PointLightCountConstant = 0;
+	const GLuint g_SpotLightEnabledConstant = 1;
+
+	// compute shader that culls the objects of the GPU driven scene
+	const char* g_CullingShaderFile = "shaders/cullingCompute.glsl";
+
+	// shaders that draw the vegetation impostor billboards
+	const char* g_ImpostorVertexShaderFile = "shaders/impostorVertex.glsl";
+	const char* g_ImpostorFragmentShaderFile = "shaders/impostorFragment.glsl";
+	const char* g_ImpostorVertexSpirvFile = "shaders/spirv/impostorVertex.spv";
+	const char* g_ImpostorFragmentSpirvFile = "shaders/spirv/impostorFragment.spv";
+
+	// shaders that simulate and draw the particle effects
+	const char* g_ParticleComputeShaderFile = "shaders/particleCompute.glsl";
+	const char* g_ParticleVertexShaderFile = "shaders/particleVertex.glsl";
+	const char* g_ParticleFragmentShaderFile = "shaders/particleFragment.glsl";
+
+	// finest level asked of the texture streamer for a texture
+	// no object needs this frame, which the streamer clamps to
+	// the levels that are always resident
+	const uint8_t g_UnneededTextureLevel = 255;
+	// nearest distance an object is taken to be from the camera
+	// when its level is worked out, so that the camera inside
+	// its bounds asks for the top level without dividing by 0
+	const float g_MinFootprintDistance = 0.1f;
+
+	// scene textures up to this many texels across share
+	// atlases, which grow up to the largest size
+	const int g_MaxAtlasImageSize = 1024;
+	const int g_MaxAtlasSize = 2048;
+	// texels kept around every image of an atlas, which is one
+	// texel at the coarsest of its five mipmap levels
+	const int g_AtlasGutter = 16;
+	// region of a texture that does not share an atlas
+	const glm::vec4 g_WholeTextureRegion(0.0f, 0.0f, 1.0f, 1.0f);
 }
 
 /***********************************************************
@@ -38,6 +118,51 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
 	{  
        m_pShaderManager = pShaderManager;  
        m_basicMeshes = new ShapeMeshes();  
+       m_pCurrentFrame = nullptr;
+       m_pendingPacket.modelMatrix = glm::mat4(1.0f);
+       m_pendingPacket.mesh = ShapeMeshes::MESH_BOX;
+       m_pendingPacket.textureSlot = -1;
+       m_pendingPacket.materialIndex = -1;
+       m_pendingPacket.color = glm::vec4(1.0f);
+       m_pendingPacket.UVscale = glm::vec2(1.0f, 1.0f);
+       m_loadedMeshMask = 0;
+       m_pStaticBatcher = new StaticBatcher(m_basicMeshes);
+       m_pGpuScene = nullptr;
+       m_pVegetation = nullptr;
+       m_impostorTextureUnit = 0;
+       m_pTerrain = nullptr;
+       m_terrainTextureUnit = 0;
+       m_terrainTextureSlot = -1;
+       m_terrainMaterialIndex = -1;
+       m_terrainColor = glm::vec4(1.0f);
+       m_pParticles = nullptr;
+       m_pTextureStreamer = nullptr;
+       m_reservedTextureUnits = 0;
+       m_pendingTransform.scaleXYZ = glm::vec3(1.0f);
+       m_pendingTransform.rotationDegrees = glm::vec3(0.0f);
+       m_pendingTransform.positionXYZ = glm::vec3(0.0f);
+       m_pJobSystem = nullptr;
+       m_pComposeDone = nullptr;
+       m_composeBody.pScene = this;
+       m_cullBody.pScene = this;
+       for (int i = 0; i < ShapeMeshes::MESH_TYPE_COUNT; i++)
+       {
+           m_meshBounds[i].boundsMin = glm::vec3(0.0f);
+           m_meshBounds[i].boundsMax = glm::vec3(0.0f);
+       }
+       m_uniforms.model = -1;
+       m_uniforms.useObjectModel = -1;
+       m_uniforms.useTexture = -1;
+       m_uniforms.texture = -1;
+       m_uniforms.color = -1;
+       m_uniforms.UVscale = -1;
+       m_uniforms.textureRegion = -1;
+       m_uniforms.useObjectTexture = -1;
+       m_uniforms.materialAmbientColor = -1;
+       m_uniforms.materialAmbientStrength = -1;
+       m_uniforms.materialDiffuseColor = -1;
+       m_uniforms.materialSpecularColor = -1;
+       m_uniforms.materialShininess = -1;
     }
 
 /***********************************************************
@@ -47,6 +172,18 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
  ***********************************************************/
 SceneManager::~SceneManager()
 {
+	delete m_pStaticBatcher;
+	m_pStaticBatcher = nullptr;
+	delete m_pGpuScene;
+	m_pGpuScene = nullptr;
+	delete m_pVegetation;
+	m_pVegetation = nullptr;
+	delete m_pTerrain;
+	m_pTerrain = nullptr;
+	delete m_pParticles;
+	m_pParticles = nullptr;
+	delete m_pTextureStreamer;
+	m_pTextureStreamer = nullptr;
 	delete m_basicMeshes; // Free the memory allocated for basic meshes	
 	m_pShaderManager = nullptr;
 	m_basicMeshes = nullptr;
@@ -55,81 +192,63 @@ SceneManager::~SceneManager()
 /***********************************************************
  *  CreateGLTexture()
  *
- *  This method is used for loading textures from image files,
- *  configuring the texture mapping parameters in OpenGL,
- *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
- ***********************************************************/
-bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
-{
-	int width = 0;
-	int height = 0;
-	int colorChannels = 0;
-	GLuint textureID = 0;
-
-	// indicate to always flip images vertically when loaded
-	stbi_set_flip_vertically_on_load(true);
-
-	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
-		filename,
-		&width,
-		&height,
-		&colorChannels,
-		0);
-
-	// if the image was successfully read from the image file
-	if (image)
-	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
-
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
-		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			return false;
-		}
-
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
+ *  This method is used for loading textures from image files
+ *  into the texture streamer, which keeps their small mipmaps
+ *  and loads the larger ones when they are needed, and
+ *  loading the read texture into the next available texture
+ *  slot in memory.
+ ***********************************************************/
+bool SceneManager::CreateGLTexture(const char* filename, TextureHandle handle)
+{
+	if (m_loadedTextures >= 16)
+	{
+		std::cout << "Maximum number of textures loaded. Cannot load more." << std::endl;
+		return false; // Prevent loading more than 16 textures
+	}
 
-		// free the image data from local memory
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+	int streamIndex = m_pTextureStreamer->AddTexture(filename, filename);
+	if (streamIndex < 0)
+	{
+		// Error loading the image
+		return false;
+	}
 
-		if (m_loadedTextures >= 16)
-		{
-			std::cout << "Maximum number of textures loaded. Cannot load more." << std::endl;
-			return false; // Prevent loading more than 16 textures
-		}
+	return(RegisterTexture(handle, streamIndex, g_WholeTextureRegion, m_pTextureStreamer->GetTextureSize(streamIndex)));
+}
 
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
+/***********************************************************
+ *  RegisterTexture()
+ *
+ *  This method is used for giving a streamed texture, or
+ *  the region of an atlas one image takes, the next texture
+ *  slot and associating it with its handle.
+ ***********************************************************/
+bool SceneManager::RegisterTexture(TextureHandle handle, int streamIndex, const glm::vec4& region, int size)
+{
+	if (m_loadedTextures >= 16)
+	{
+		std::cout << "Maximum number of textures loaded. Cannot load more." << std::endl;
+		return false;
+	}
 
-		return true;
+	// register the handle - a duplicate or colliding tag is an
+	// error, and the texture is left with only its small levels,
+	// which no object asks the streamer for
+	if (!CheckRegistration(m_textureSlots.Register(handle, m_loadedTextures), "texture", handle.tag))
+	{
+		return false;
 	}
 
-	std::cout << "Could not load image:" << filename << std::endl;
+	// register the loaded texture and associate it with the handle
+	TEXTURE_INFO& texture = m_textureIDs[m_loadedTextures];
+	texture.ID = m_pTextureStreamer->GetTextureID(streamIndex);
+	texture.handle = handle;
+	texture.streamIndex = streamIndex;
+	texture.region = region;
+	texture.size = size;
+	m_loadedTextures++;
 
-	// Error loading the image
-	return false;
+	return true;
 }
 
 /***********************************************************
@@ -137,14 +256,16 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
  *
  *  This method is used for binding the loaded textures to
  *  OpenGL texture memory slots.  There are up to 16 slots.
+ *  Every streamed texture is bound to the unit of its
+ *  index, so the textures sharing an atlas share a unit.
  ***********************************************************/
 void SceneManager::BindGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	for (int i = 0; i < m_pTextureStreamer->GetTextureCount(); i++)
 	{
 		// bind textures on corresponding texture units
 		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
+		glBindTexture(GL_TEXTURE_2D, m_pTextureStreamer->GetTextureID(i));
 	}
 }
 
@@ -156,97 +277,293 @@ void SceneManager::BindGLTextures()
  ***********************************************************/
 void SceneManager::DestroyGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	if (nullptr != m_pTextureStreamer)
 	{
-		glDeleteTextures(1, &m_textureIDs[i].ID);
+		m_pTextureStreamer->Clear();
 	}
 	m_loadedTextures = 0; // Reset the count of loaded textures
+	m_textureSlots.Clear();
+	m_textureFootprints.clear();
+	m_fullResolutionTextures.clear();
 }
 
 /***********************************************************
- *  FindTextureID()
+ *  KeepFullResolution()
  *
- *  This method is used for getting an ID for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for asking the texture streamer for
+ *  every level of the texture in a slot, every frame, for
+ *  the textures that are not drawn on scene objects.
  ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
+void SceneManager::KeepFullResolution(int textureSlot)
 {
-	int textureID = -1;
-	int index = 0;
-	bool bFound = false;
+	if (textureSlot < 0)
+	{
+		return;
+	}
 
-	while ((index < m_loadedTextures) && (bFound == false))
+	int streamIndex = m_textureIDs[textureSlot].streamIndex;
+	if (std::find(m_fullResolutionTextures.begin(), m_fullResolutionTextures.end(), streamIndex) == m_fullResolutionTextures.end())
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
-		{
-			textureID = m_textureIDs[index].ID;
-			bFound = true;
-		}
-		else
-			index++;
+		m_fullResolutionTextures.push_back(streamIndex);
+	}
+}
+
+/***********************************************************
+ *  CheckRegistration()
+ *
+ *  This method is used for reporting a failed resource
+ *  registration.  It returns true when the resource was
+ *  registered.
+ ***********************************************************/
+bool SceneManager::CheckRegistration(RESOURCE_REGISTER_RESULT result, const char* kind, const char* tag)
+{
+	switch (result)
+	{
+	case REGISTER_OK:
+		return(true);
+	case REGISTER_DUPLICATE:
+		std::cout << "ERROR: The " << kind << " tag \"" << tag << "\" is already registered" << std::endl;
+		break;
+	case REGISTER_COLLISION:
+		std::cout << "ERROR: The " << kind << " tag \"" << tag << "\" has the same hash as another tag" << std::endl;
+		break;
+	default:
+		std::cout << "ERROR: No room left to register the " << kind << " tag \"" << tag << "\"" << std::endl;
+		break;
 	}
 
-	return(textureID);
+	return(false);
 }
 
 /***********************************************************
- *  FindTextureSlot()
+ *  ReportUnknownHandle()
  *
- *  This method is used for getting a slot index for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for reporting a handle that is used
+ *  by the scene but was never registered.  Every handle is
+ *  reported once, by its kind and hash, however many
+ *  objects use it.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+void SceneManager::ReportUnknownHandle(const char* kind, uint32_t hash, const char* tag)
 {
-	int textureSlot = -1;
-	int index = 0;
-	bool bFound = false;
+	if (m_reportedUnknownHandles.insert(std::make_pair(std::string(kind), hash)).second)
+	{
+		std::cout << "ERROR: The scene uses the unregistered " << kind << " tag \"" << tag << "\"" << std::endl;
+	}
+}
 
-	while ((index < m_loadedTextures) && (bFound == false))
+/***********************************************************
+ *  ResolveTexture()
+ *
+ *  This method is used for getting the slot of a texture
+ *  named in the scene file, or -1 after reporting it when
+ *  no texture was registered with its tag.
+ ***********************************************************/
+int SceneManager::ResolveTexture(uint32_t hash, uint32_t tagString)
+{
+	const char* tag = m_sceneFile.GetString(tagString);
+	int textureSlot = FindTextureSlot(TextureHandle(hash, tag));
+	if (textureSlot < 0)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
-		{
-			textureSlot = index;
-			bFound = true;
-		}
-		else
-			index++;
+		ReportUnknownHandle("texture", hash, tag);
 	}
 
 	return(textureSlot);
 }
 
 /***********************************************************
- *  FindMaterial()
+ *  ResolveMaterial()
  *
- *  This method is used for getting a material from the previously
- *  defined materials list that is associated with the passed in tag.
+ *  This method is used for getting the index of a material
+ *  named in the scene file, or -1 after reporting it when
+ *  no material was registered with its tag.
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+int SceneManager::ResolveMaterial(uint32_t hash, uint32_t tagString)
 {
-	if (m_objectMaterials.size() == 0)
+	const char* tag = m_sceneFile.GetString(tagString);
+	int materialIndex = FindMaterialIndex(MaterialHandle(hash, tag));
+	if (materialIndex < 0)
 	{
+		ReportUnknownHandle("material", hash, tag);
+	}
+
+	return(materialIndex);
+}
+
+/***********************************************************
+ *  ResolveMesh()
+ *
+ *  This method is used for getting the basic mesh named in
+ *  the scene file.  It returns false after reporting the
+ *  mesh when no mesh was registered with its tag.
+ ***********************************************************/
+bool SceneManager::ResolveMesh(uint32_t hash, uint32_t tagString, ShapeMeshes::MESH_TYPE& mesh)
+{
+	const char* tag = m_sceneFile.GetString(tagString);
+	const ShapeMeshes::MESH_TYPE* meshType = m_meshTypes.Find(MeshHandle(hash, tag));
+	if (nullptr == meshType)
+	{
+		ReportUnknownHandle("mesh", hash, tag);
 		return(false);
 	}
 
-	int index = 0;
-	bool bFound = false;
-	while ((index < m_objectMaterials.size()) && (bFound == false))
+	mesh = *meshType;
+	return(true);
+}
+
+/***********************************************************
+ *  ResolveSceneObjects()
+ *
+ *  This method is used for resolving the texture, material
+ *  and mesh handles of every scene object once, after the
+ *  resources are registered, so that recording a frame
+ *  needs no lookups.  An object using a handle that is not
+ *  registered would draw with the wrong texture or material
+ *  or without a mesh, so it is left out of the scene, and
+ *  the material it names is not passed on either.
+ ***********************************************************/
+bool SceneManager::ResolveSceneObjects()
+{
+	const SCENE_OBJECT* objects = m_sceneFile.GetObjects();
+
+	m_objectResources.resize(m_sceneFile.GetObjectCount());
+	int invalidCount = 0;
+	for (uint32_t i = 0; i < m_sceneFile.GetObjectCount(); i++)
 	{
-		if (m_objectMaterials[index].tag.compare(tag) == 0)
+		const SCENE_OBJECT& object = objects[i];
+		OBJECT_RESOURCES& resources = m_objectResources[i];
+
+		resources.textureSlot = -1;
+		resources.materialIndex = -1;
+		resources.mesh = ShapeMeshes::MESH_BOX;
+		resources.bValid = ResolveMesh(object.meshHash, object.meshString, resources.mesh);
+		if ((object.flags & SCENE_OBJECT_TEXTURED) != 0)
 		{
-			bFound = true;
-			material.ambientColor = m_objectMaterials[index].ambientColor;
-			material.ambientStrength = m_objectMaterials[index].ambientStrength;
-			material.diffuseColor = m_objectMaterials[index].diffuseColor;
-			material.specularColor = m_objectMaterials[index].specularColor;
-			material.shininess = m_objectMaterials[index].shininess;
+			resources.textureSlot = ResolveTexture(object.textureHash, object.textureString);
+			resources.bValid = resources.bValid && (resources.textureSlot >= 0);
 		}
-		else
+		if ((object.flags & SCENE_OBJECT_MATERIAL) != 0)
+		{
+			resources.materialIndex = ResolveMaterial(object.materialHash, object.materialString);
+			resources.bValid = resources.bValid && (resources.materialIndex >= 0);
+		}
+
+		if (!resources.bValid)
 		{
-			index++;
+			invalidCount++;
 		}
 	}
 
+	if (invalidCount > 0)
+	{
+		std::cout << "ERROR: " << invalidCount << " of the " << m_sceneFile.GetObjectCount()
+			<< " scene objects use unregistered resources and are left out of the scene" << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  FindTextureSlot()
+ *
+ *  This method is used for getting a slot index for the previously
+ *  loaded texture bitmap associated with the passed in handle.
+ ***********************************************************/
+int SceneManager::FindTextureSlot(TextureHandle handle)
+{
+	const int* textureSlot = m_textureSlots.Find(handle);
+	if (nullptr == textureSlot)
+	{
+		return(-1);
+	}
+
+	return(*textureSlot);
+}
+
+/***********************************************************
+ *  FindMaterialIndex()
+ *
+ *  This method is used for getting the index of a material
+ *  in the previously defined materials list that is
+ *  associated with the passed in handle.
+ ***********************************************************/
+int SceneManager::FindMaterialIndex(MaterialHandle handle)
+{
+	const int* materialIndex = m_materialIndices.Find(handle);
+	if (nullptr == materialIndex)
+	{
+		return(-1);
+	}
+
+	return(*materialIndex);
+}
+
+/***********************************************************
+ *  RegisterMaterial()
+ *
+ *  This method is used for adding a material to the defined
+ *  materials and making it available by its handle.
+ ***********************************************************/
+bool SceneManager::RegisterMaterial(const OBJECT_MATERIAL& material)
+{
+	int materialIndex = (int)m_objectMaterials.size();
+	if (!CheckRegistration(m_materialIndices.Register(material.handle, materialIndex), "material", material.handle.tag))
+	{
+		return(false);
+	}
+
+	m_objectMaterials.push_back(material);
+
+	return(true);
+}
+
+/***********************************************************
+ *  RegisterMesh()
+ *
+ *  This method is used for loading one of the basic meshes
+ *  and making it available by the passed in handle.
+ ***********************************************************/
+bool SceneManager::RegisterMesh(MeshHandle handle, ShapeMeshes::MESH_TYPE mesh)
+{
+	if (!CheckRegistration(m_meshTypes.Register(handle, mesh), "mesh", handle.tag))
+	{
+		return(false);
+	}
+
+	// the half shapes are drawn from the data of the full
+	// shapes, so several handles can share one loaded mesh
+	ShapeMeshes::MESH_TYPE loadedMesh = mesh;
+	if (mesh == ShapeMeshes::MESH_HALF_SPHERE)
+	{
+		loadedMesh = ShapeMeshes::MESH_SPHERE;
+	}
+	else if (mesh == ShapeMeshes::MESH_HALF_TORUS)
+	{
+		loadedMesh = ShapeMeshes::MESH_TORUS;
+	}
+
+	uint32_t meshBit = 1u << loadedMesh;
+	if ((m_loadedMeshMask & meshBit) != 0)
+	{
+		return(true);
+	}
+	m_loadedMeshMask |= meshBit;
+
+	switch (loadedMesh)
+	{
+	case ShapeMeshes::MESH_BOX: m_basicMeshes->LoadBoxMesh(); break;
+	case ShapeMeshes::MESH_CONE: m_basicMeshes->LoadConeMesh(); break;
+	case ShapeMeshes::MESH_CYLINDER: m_basicMeshes->LoadCylinderMesh(); break;
+	case ShapeMeshes::MESH_PLANE: m_basicMeshes->LoadPlaneMesh(); break;
+	case ShapeMeshes::MESH_PRISM: m_basicMeshes->LoadPrismMesh(); break;
+	case ShapeMeshes::MESH_PYRAMID3: m_basicMeshes->LoadPyramid3Mesh(); break;
+	case ShapeMeshes::MESH_PYRAMID4: m_basicMeshes->LoadPyramid4Mesh(); break;
+	case ShapeMeshes::MESH_SPHERE: m_basicMeshes->LoadSphereMesh(); break;
+	case ShapeMeshes::MESH_TAPERED_CYLINDER: m_basicMeshes->LoadTaperedCylinderMesh(); break;
+	case ShapeMeshes::MESH_TORUS: m_basicMeshes->LoadTorusMesh(); break;
+	default: break;
+	}
+
 	return(true);
 }
 
@@ -254,7 +571,10 @@ bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
  *  SetTransformations()
  *
  *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  using the passed in transformation values.  The values
+ *  are recorded with the next draw packet, and the matrix
+ *  itself is composed later for all packets at once by
+ *  ComposeTransformations().
  ***********************************************************/
 void SceneManager::SetTransformations(
 	glm::vec3 scaleXYZ,
@@ -262,9 +582,21 @@ void SceneManager::SetTransformations(
 	float YrotationDegrees,
 	float ZrotationDegrees,
 	glm::vec3 positionXYZ)
+{
+	m_pendingTransform.scaleXYZ = scaleXYZ;
+	m_pendingTransform.rotationDegrees = glm::vec3(XrotationDegrees, YrotationDegrees, ZrotationDegrees);
+	m_pendingTransform.positionXYZ = positionXYZ;
+}
+
+/***********************************************************
+ *  ComposeModelMatrix()
+ *
+ *  This method is used for building a model matrix from
+ *  recorded transformation values.
+ ***********************************************************/
+glm::mat4 SceneManager::ComposeModelMatrix(const TRANSFORM_INPUT& transform)
 {
 	// variables for this method
-	glm::mat4 modelView;
 	glm::mat4 scale;
 	glm::mat4 rotationX;
 	glm::mat4 rotationY;
@@ -272,19 +604,29 @@ void SceneManager::SetTransformations(
 	glm::mat4 translation;
 
 	// set the scale value in the transform buffer
-	scale = glm::scale(scaleXYZ);
+	scale = glm::scale(transform.scaleXYZ);
 	// set the rotation values in the transform buffer
-	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
+	rotationX = glm::rotate(glm::radians(transform.rotationDegrees.x), glm::vec3(1.0f, 0.0f, 0.0f));
+	rotationY = glm::rotate(glm::radians(transform.rotationDegrees.y), glm::vec3(0.0f, 1.0f, 0.0f));
+	rotationZ = glm::rotate(glm::radians(transform.rotationDegrees.z), glm::vec3(0.0f, 0.0f, 1.0f));
 	// set the translation value in the transform buffer
-	translation = glm::translate(positionXYZ);
+	translation = glm::translate(transform.positionXYZ);
 
-	modelView = translation * rotationZ * rotationY * rotationX * scale;
+	return(translation * rotationZ * rotationY * rotationX * scale);
+}
 
-	if (NULL != m_pShaderManager)
+/***********************************************************
+ *  ComposeTransformations()
+ *
+ *  This method is used for building the model matrix of
+ *  the draw packets in the passed in index range from the
+ *  recorded transformation values.
+ ***********************************************************/
+void SceneManager::ComposeTransformations(int firstPacket, int lastPacket)
+{
+	for (int i = firstPacket; i < lastPacket; i++)
 	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
+		m_pCurrentFrame->drawPackets[i].modelMatrix = ComposeModelMatrix(m_transformInputs[i]);
 	}
 }
 
@@ -308,30 +650,20 @@ void SceneManager::SetShaderColor(
 	currentColor.b = blueColorValue;
 	currentColor.a = alphaValue;
 
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
-	}
+	m_pendingPacket.textureSlot = -1;
+	m_pendingPacket.color = currentColor;
 }
 
 /***********************************************************
  *  SetShaderTexture()
  *
- *  This method is used for setting the texture data
- *  associated with the passed in ID into the shader.
+ *  This method is used for setting the texture in the
+ *  passed in slot into the shader.
  ***********************************************************/
 void SceneManager::SetShaderTexture(
-	std::string textureTag)
+	int textureSlot)
 {
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
-
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
-	}
+	m_pendingPacket.textureSlot = textureSlot;
 }
 
 /***********************************************************
@@ -342,10 +674,7 @@ void SceneManager::SetShaderTexture(
  ***********************************************************/
 void SceneManager::SetTextureUVScale(float u, float v)
 {
-	if (nullptr != m_pShaderManager)
-	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
-	}
+	m_pendingPacket.UVscale = glm::vec2(u, v);
 }
 
 /***********************************************************
@@ -355,422 +684,1870 @@ void SceneManager::SetTextureUVScale(float u, float v)
  *  into the shader.
  ***********************************************************/
 void SceneManager::SetShaderMaterial(
-	std::string materialTag)
+	int materialIndex)
+{
+	m_pendingPacket.materialIndex = materialIndex;
+}
+
+/***********************************************************
+ *  CacheUniformLocations()
+ *
+ *  This method is used for looking up the locations of the
+ *  per-draw uniforms once the shaders have been loaded.
+ ***********************************************************/
+void SceneManager::CacheUniformLocations()
+{
+	m_uniforms.model = m_pShaderManager->getUniformLocation(g_ModelName);
+	m_uniforms.useObjectModel = m_pShaderManager->getUniformLocation(g_UseObjectModelName);
+	m_uniforms.useTexture = m_pShaderManager->getUniformLocation(g_UseTextureName);
+	m_uniforms.texture = m_pShaderManager->getUniformLocation(g_TextureValueName);
+	m_uniforms.color = m_pShaderManager->getUniformLocation(g_ColorValueName);
+	m_uniforms.UVscale = m_pShaderManager->getUniformLocation("UVscale");
+	m_uniforms.textureRegion = m_pShaderManager->getUniformLocation("textureRegion");
+	m_uniforms.useObjectTexture = m_pShaderManager->getUniformLocation(g_UseObjectTextureName);
+	m_uniforms.materialAmbientColor = m_pShaderManager->getUniformLocation("material.ambientColor");
+	m_uniforms.materialAmbientStrength = m_pShaderManager->getUniformLocation("material.ambientStrength");
+	m_uniforms.materialDiffuseColor = m_pShaderManager->getUniformLocation("material.diffuseColor");
+	m_uniforms.materialSpecularColor = m_pShaderManager->getUniformLocation("material.specularColor");
+	m_uniforms.materialShininess = m_pShaderManager->getUniformLocation("material.shininess");
+}
+
+/***********************************************************
+ *  SortDrawPackets()
+ *
+ *  This method is used for building one sort key per draw
+ *  packet and sorting the keys, so that SubmitFrame() can
+ *  skip the shader settings shared with the previous draw.
+ *  The keys live in the frame arena and are sorted in
+ *  place, so this does not touch the heap.
+ ***********************************************************/
+void SceneManager::SortDrawPackets()
 {
-	if (m_objectMaterials.size() > 0)
+	FRAME_DATA& frame = *m_pCurrentFrame;
+
+	frame.sortKeys.resize(frame.drawPackets.size());
+	for (size_t i = 0; i < frame.drawPackets.size(); i++)
 	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
+		const DRAW_PACKET& packet = frame.drawPackets[i];
+		uint64_t key = (uint64_t)i;
 
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
+		// untextured packets with some transparency are
+		// blended, so they keep their recorded order
+		if ((packet.textureSlot < 0) && (packet.color.a < 1.0f))
+		{
+			key |= (uint64_t)1 << g_SortTranslucentShift;
+		}
+		else
 		{
-			m_pShaderManager->setVec3Value("material.ambientColor", material.ambientColor);
-			m_pShaderManager->setFloatValue("material.ambientStrength", material.ambientStrength);
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
+			// the slots of an atlas are kept next to each other,
+			// since they are all drawn from the same texture unit
+			if (packet.textureSlot >= 0)
+			{
+				uint64_t textureKey = (uint64_t)(m_textureIDs[packet.textureSlot].streamIndex + 1) << g_SortSlotBits;
+				key |= (textureKey | (uint64_t)packet.textureSlot) << g_SortTextureShift;
+			}
+			key |= (uint64_t)(packet.materialIndex + 1) << g_SortMaterialShift;
+			key |= (uint64_t)packet.mesh << g_SortMeshShift;
 		}
+
+		frame.sortKeys[i] = key;
+	}
+
+	std::sort(frame.sortKeys.begin(), frame.sortKeys.end());
+}
+
+/***********************************************************
+ *  AddDrawPacket()
+ *
+ *  This method is used for recording a draw of the passed
+ *  in mesh into the frame being built.  The packet takes
+ *  the values from the most recent Set* calls, so unchanged
+ *  settings carry over from the previous draw just like
+ *  shader uniforms do.
+ ***********************************************************/
+void SceneManager::AddDrawPacket(
+	ShapeMeshes::MESH_TYPE mesh)
+{
+	if (nullptr != m_pCurrentFrame)
+	{
+		m_pendingPacket.mesh = mesh;
+		m_pCurrentFrame->drawPackets.push_back(m_pendingPacket);
+		m_transformInputs.push_back(m_pendingTransform);
 	}
 }
 
 /**************************************************************/
 /*** Methods BELOW will prepare and render 3D scenes.       ***/
 /**************************************************************/
-//LoadSceneTextures()
-void SceneManager::LoadSceneTextures()
+/***********************************************************
+ *  LoadSceneFile()
+ *
+ *  This method is used for loading the binary scene.  The
+ *  text scene is compiled first when it has changed since
+ *  the binary was written, so layouts can be edited without
+ *  rebuilding the application.  It needs no OpenGL context,
+ *  so the offline renderer loads the scene with it too.
+ ***********************************************************/
+bool SceneManager::LoadSceneFile(SceneFile& sceneFile)
 {
-	bool bReturn = false;
+	if (SceneFile::IsOutOfDate(g_SceneTextFile, g_SceneBinaryFile))
+	{
+		// a failed compile leaves any older binary in place
+		SceneFile::CompileText(g_SceneTextFile, g_SceneBinaryFile);
+	}
+
+	std::chrono::steady_clock::time_point loadStart = std::chrono::steady_clock::now();
+	if (!sceneFile.Load(g_SceneBinaryFile))
+	{
+		return(false);
+	}
+	std::chrono::duration<double, std::milli> loadTime = std::chrono::steady_clock::now() - loadStart;
+
+	std::cout << "INFO: Loaded scene " << g_SceneBinaryFile << " - " << sceneFile.GetObjectCount()
+		<< " objects in " << loadTime.count() << " ms" << std::endl;
+
+	return(true);
+}
 
-	bReturn = CreateGLTexture(
-		"textures/TreeBark.bmp",
-		"bark");
-	
-	bReturn = CreateGLTexture(
-		"textures/AutumnLeaves.bmp",
-		"autumn");
+/***********************************************************
+ *  GetSceneTextFile()
+ *
+ *  This method is used for getting the name of the text
+ *  scene, which the scene benchmark builds on.
+ ***********************************************************/
+const char* SceneManager::GetSceneTextFile()
+{
+	return(g_SceneTextFile);
+}
 
-	bReturn = CreateGLTexture(
-		"textures/Tree.bmp",
-		"tree");
+/***********************************************************
+ *  LoadSceneTextures()
+ *
+ *  This method is used for loading every texture listed in
+ *  the scene file.
+ ***********************************************************/
+void SceneManager::LoadSceneTextures()
+{
+	const SCENE_TEXTURE* textures = m_sceneFile.GetTextures();
 
-	bReturn = CreateGLTexture(
-		"textures/PalaceTexture.bmp",
-		"palace");
+	if (nullptr == m_pTextureStreamer)
+	{
+		m_pTextureStreamer = new TextureStreamer();
+	}
 
-	bReturn = CreateGLTexture(
-		"textures/BushTexture.bmp",
-		"bush"); 
+	std::vector<bool> loadedTextures(m_sceneFile.GetTextureCount(), false);
+	LoadTextureAtlases(loadedTextures);
 
-	bReturn = CreateGLTexture(
-		"textures/GrassTexture.bmp",
-		"fresh");
+	for (uint32_t i = 0; i < m_sceneFile.GetTextureCount(); i++)
+	{
+		if (loadedTextures[i])
+		{
+			continue;
+		}
+		CreateGLTexture(
+			m_sceneFile.GetString(textures[i].fileString),
+			TextureHandle(textures[i].tagHash, m_sceneFile.GetString(textures[i].tagString)));
+	}
 
-	bReturn = CreateGLTexture(
-		"textures/LavenderBush.bmp",
-		"lavender");
-	
 	BindGLTextures();
+
+	// the streamed levels are dropped when the GPU memory is
+	// over budget
+	GpuMemory::SetEvictFunction(&TextureStreamer::EvictLevels, m_pTextureStreamer);
 }
+
 /***********************************************************
- *  DefineObjectMaterials()
+ *  LoadTextureAtlases()
  *
- *  This method is used for defining the materials used
- *  in the 3D scene.
+ *  This method is used for packing the small scene textures
+ *  into shared atlases, one per number of channels, so that
+ *  objects with different textures can be drawn together.
+ *  The particles sample their texture with a shader of
+ *  their own, which does not wrap into a region, so their
+ *  textures are left to be loaded on their own, and so are
+ *  the textures that do not fit the largest atlas.
  ***********************************************************/
-void SceneManager::DefineObjectMaterials()
+void SceneManager::LoadTextureAtlases(std::vector<bool>& loadedTextures)
 {
-	OBJECT_MATERIAL woodMaterial;
-	woodMaterial.ambientColor = glm::vec3(0.4f, 0.3f, 0.1f);
-	woodMaterial.ambientStrength = 0.2f;
-	woodMaterial.diffuseColor = glm::vec3(0.3f, 0.2f, 0.1f);
-	woodMaterial.specularColor = glm::vec3(0.1f, 0.1f, 0.1f);
-	woodMaterial.shininess = 0.3;
-	woodMaterial.tag = "wood";
+	const SCENE_TEXTURE* textures = m_sceneFile.GetTextures();
+	const SCENE_PARTICLES* particles = m_sceneFile.GetParticles();
+
+	// candidates with 3 and with 4 channels, and their sizes
+	std::vector<uint32_t> candidates[2];
+	std::vector<ATLAS_RECT> rects[2];
+	for (uint32_t i = 0; i < m_sceneFile.GetTextureCount(); i++)
+	{
+		bool bParticleTexture = false;
+		for (uint32_t effect = 0; effect < m_sceneFile.GetParticlesCount(); effect++)
+		{
+			if (((particles[effect].flags & SCENE_OBJECT_TEXTURED) != 0) && (particles[effect].textureHash == textures[i].tagHash))
+			{
+				bParticleTexture = true;
+			}
+		}
 
-	m_objectMaterials.push_back(woodMaterial);
+		// a file that cannot be read is reported when it is
+		// loaded on its own
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+		if (bParticleTexture ||
+			!stbi_info(m_sceneFile.GetString(textures[i].fileString), &width, &height, &channels) ||
+			(std::max(width, height) > g_MaxAtlasImageSize) ||
+			((channels != 3) && (channels != 4)))
+		{
+			continue;
+		}
 
-	OBJECT_MATERIAL treeMaterial;
-	treeMaterial.ambientColor = glm::vec3(0.2f, 0.2f, 0.3f);
-	treeMaterial.ambientStrength = 0.3f;
-	treeMaterial.diffuseColor = glm::vec3(0.4f, 0.4f, 0.5f);
-	treeMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.4f);
-	treeMaterial.shininess = 0.5;
-	treeMaterial.tag = "tree";
+		candidates[channels - 3].push_back(i);
+		rects[channels - 3].push_back({ width, height, 0, 0, false });
+	}
 
-	m_objectMaterials.push_back(treeMaterial);
+	GLint maxTextureSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
 
-	OBJECT_MATERIAL grassMaterial;
-	grassMaterial.ambientColor = glm::vec3(0.2f, 0.2f, 0.2f);
-	grassMaterial.ambientStrength = 0.2f;
-	grassMaterial.diffuseColor = glm::vec3(0.5f, 0.5f, 0.5f);
-	grassMaterial.specularColor = glm::vec3(0.4f, 0.4f, 0.4f);
-	grassMaterial.shininess = 0.5;
-	grassMaterial.tag = "grass";
+	for (int group = 0; group < 2; group++)
+	{
+		// an atlas of one image would only add the gutter
+		TextureAtlas atlas(g_AtlasGutter);
+		if ((candidates[group].size() < 2) || (atlas.Pack(rects[group], std::min(g_MaxAtlasSize, (int)maxTextureSize)) < 2))
+		{
+			continue;
+		}
 
-	m_objectMaterials.push_back(grassMaterial);
-}
+		std::vector<TEXTURE_ATLAS_IMAGE> images;
+		std::vector<uint32_t> packedTextures;
+		for (size_t k = 0; k < candidates[group].size(); k++)
+		{
+			const ATLAS_RECT& rect = rects[group][k];
+			if (rect.bPacked)
+			{
+				images.push_back({ m_sceneFile.GetString(textures[candidates[group][k]].fileString), rect.x, rect.y, rect.width, rect.height });
+				packedTextures.push_back(candidates[group][k]);
+			}
+		}
 
-void SceneManager::SetupSceneLights()
-{
-	m_pShaderManager->setBoolValue(g_UseLightingName, true);
+		int streamIndex = m_pTextureStreamer->AddAtlas(
+			images.data(),
+			(int)images.size(),
+			atlas.GetWidth(),
+			atlas.GetHeight(),
+			atlas.GetGutter(),
+			"scene texture atlas");
+		if (streamIndex < 0)
+		{
+			// the textures are loaded on their own instead
+			continue;
+		}
 
+		glm::vec2 atlasSize((float)atlas.GetWidth(), (float)atlas.GetHeight());
+		for (size_t k = 0; k < images.size(); k++)
+		{
+			const SCENE_TEXTURE& texture = textures[packedTextures[k]];
+			glm::vec4 region(
+				(float)images[k].x / atlasSize.x,
+				(float)images[k].y / atlasSize.y,
+				(float)images[k].width / atlasSize.x,
+				(float)images[k].height / atlasSize.y);
+			RegisterTexture(
+				TextureHandle(texture.tagHash, m_sceneFile.GetString(texture.tagString)),
+				streamIndex,
+				region,
+				std::max(images[k].width, images[k].height));
+			loadedTextures[packedTextures[k]] = true;
+		}
+
+		std::cout << "INFO: Packed " << images.size() << " textures into a " << atlas.GetWidth() << "x"
+			<< atlas.GetHeight() << " atlas" << std::endl;
+	}
+}
 
-	// Improved directional light to emulate sunlight with a more natural direction and color
-	m_pShaderManager->setVec3Value("directionalLight.direction", -0.3f, -1.0f, -0.5f);
-	m_pShaderManager->setVec3Value("directionalLight.ambient", 0.4f, 0.4f, 0.45f);
-	m_pShaderManager->setVec3Value("directionalLight.diffuse", 0.7f, 0.7f, 0.8f);
-	m_pShaderManager->setVec3Value("directionalLight.specular", 1.0f, 1.0f, 0.9f);
-	m_pShaderManager->setFloatValue("directionalLight.focal", 64.0f);
-	m_pShaderManager->setFloatValue("directionalLight.specularIntensity", 2.8f);
-	m_pShaderManager->setBoolValue("directionalLight.bActive", true);
+/***********************************************************
+ *  DefineObjectMaterials()
+ *
+ *  This method is used for defining the materials listed
+ *  in the scene file.
+ ***********************************************************/
+void SceneManager::DefineObjectMaterials()
+{
+	const SCENE_MATERIAL* materials = m_sceneFile.GetMaterials();
 
-	// Enhanced point light 1 - warm light
-	m_pShaderManager->setVec3Value("pointLights[0].position", 3.0f, 7.0f, 3.0f);
-	m_pShaderManager->setVec3Value("pointLights[0].ambient", 0.15f, 0.13f, 0.10f);
-	m_pShaderManager->setVec3Value("pointLights[0].diffuse", 0.8f, 0.7f, 0.5f);
-	m_pShaderManager->setVec3Value("pointLights[0].specular", 0.9f, 0.8f, 0.7f);
-	m_pShaderManager->setFloatValue("pointLights[0].focal", 18.0f);
-	m_pShaderManager->setFloatValue("pointLights[0].specularIntensity", 3.0f);
-	m_pShaderManager->setBoolValue("pointLights[0].bActive", true);
+	for (uint32_t i = 0; i < m_sceneFile.GetMaterialCount(); i++)
+	{
+		const SCENE_MATERIAL& sceneMaterial = materials[i];
 
-	// Enhanced point light 2 - subtle back light
-	m_pShaderManager->setVec3Value("pointLights[2].position", 10.0f, -7.0f, -8.0f);
-	m_pShaderManager->setVec3Value("pointLights[2].ambient", 0.10f, 0.10f, 0.12f);
-	m_pShaderManager->setVec3Value("pointLights[2].diffuse", 0.3f, 0.3f, 0.4f);
-	m_pShaderManager->setVec3Value("pointLights[2].specular", 0.4f, 0.4f, 0.6f);
-	m_pShaderManager->setFloatValue("pointLights[2].focal", 14.0f);
-	m_pShaderManager->setFloatValue("pointLights[2].specularIntensity", 1.5f);
-	m_pShaderManager->setBoolValue("pointLights[2].bActive", true);
+		OBJECT_MATERIAL material;
+		material.ambientColor = glm::vec3(sceneMaterial.ambientColor[0], sceneMaterial.ambientColor[1], sceneMaterial.ambientColor[2]);
+		material.ambientStrength = sceneMaterial.ambientStrength;
+		material.diffuseColor = glm::vec3(sceneMaterial.diffuseColor[0], sceneMaterial.diffuseColor[1], sceneMaterial.diffuseColor[2]);
+		material.specularColor = glm::vec3(sceneMaterial.specularColor[0], sceneMaterial.specularColor[1], sceneMaterial.specularColor[2]);
+		material.shininess = sceneMaterial.shininess;
+		material.handle = MaterialHandle(sceneMaterial.tagHash, m_sceneFile.GetString(sceneMaterial.tagString));
+
+		RegisterMaterial(material);
+	}
 }
 
 /***********************************************************
- *  PrepareScene()
+ *  LoadSceneMeshes()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene 
- *  rendering
+ *  This method is used for loading the basic meshes used
+ *  by the objects in the scene file.
  ***********************************************************/
-void SceneManager::PrepareScene()
+void SceneManager::LoadSceneMeshes()
 {
-	//load the texture image files for the textures applied
-	// to objects in the 3D scene
-	LoadSceneTextures();
-	// only one instance of a particular mesh needs to be
-	// loaded in memory no matter how many times it is drawn
-	// in the rendered 3D scene
-	DefineObjectMaterials();
-	SetupSceneLights();
+	const SCENE_MESH* meshes = m_sceneFile.GetMeshes();
 
-	m_basicMeshes->LoadPlaneMesh();
-	m_basicMeshes->LoadCylinderMesh();
-	m_basicMeshes->LoadSphereMesh();
-	m_basicMeshes->LoadBoxMesh();
-	m_basicMeshes->LoadConeMesh();
+	for (uint32_t i = 0; i < m_sceneFile.GetMeshCount(); i++)
+	{
+		RegisterMesh(
+			MeshHandle(meshes[i].tagHash, m_sceneFile.GetString(meshes[i].tagString)),
+			(ShapeMeshes::MESH_TYPE)meshes[i].meshType);
+	}
 }
 
 /***********************************************************
- *  RenderScene()
+ *  BuildStaticObjects()
  *
- *  This method is used for rendering the 3D scene by 
- *  transforming and drawing the basic 3D shapes
+ *  This method is used for handing the objects of the scene
+ *  file that are marked static to the GPU driven scene when
+ *  the context supports it, and for merging them into
+ *  static batches otherwise.  The texture, material and
+ *  color of each object are resolved the same way
+ *  RenderScene() resolves them, including the material an
+ *  object keeps from the object before it.  Translucent
+ *  objects stay draw packets so that they are still drawn
+ *  last and in order.
  ***********************************************************/
-void SceneManager::RenderScene()
+void SceneManager::BuildStaticObjects()
 {
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.						***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(20.0f, 1.0f, 10.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 0.0f, 0.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	//SetShaderColor(1, 1, 1, 1);
-	SetShaderTexture("fresh");
-	SetTextureUVScale(8.0, 5.0);
-	SetShaderMaterial("grass");
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawPlaneMesh();
-	/****************************************************************/
-	//Cylinder - trunk of the tree
-    // set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(0.1f, 2.0f, 0.1f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-6.0f, 0.0f, 5.5f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	//SetShaderColor(0.2f, 0.3f, 0.3f, 1.0f);
-	SetShaderTexture("tree");
-	SetTextureUVScale(2.0, 2.0);
-	SetShaderMaterial("wood");
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawCylinderMesh();
-
-	//Sphere - crown of the tree
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(0.8f, 0.8f, 0.8f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-6.0f, 2.5f, 5.5f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	//SetShaderColor(0, 1, 0, 1);
-	SetShaderTexture("autumn");
-	SetTextureUVScale(3.0, 2.0);
-	SetShaderMaterial("tree");
-
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawSphereMesh();
-
-	//Box - building on the left
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(17.0f, 12.0f, 4.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-9.0f, 6.0f, -8.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	//SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
-	SetShaderTexture("palace");
-	SetTextureUVScale(1.0, 1.0);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawBoxMesh();
-
-	//Box - building on the right
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(17.0f, 12.0f, 2.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(8.0f, 6.0f, -9.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	//SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
-	SetShaderTexture("palace");
-	SetTextureUVScale(1.0, 1.0);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawBoxMesh();
-
-	//Cone - bush
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(1.0f, 5.0f, 1.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-2.5f, 0.0f, 3.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	//SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
-	SetShaderTexture("bush");
-	SetTextureUVScale(2.0, 2.0);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawConeMesh();
-
-	//Cone - bush
-		// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(1.0f, 5.0f, 1.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(3.5f, 0.0f, -1.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	//SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
-	SetShaderTexture("bush");
-	SetTextureUVScale(2.0, 2.0);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawConeMesh();
-
-	//Sphere - bush
-			// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(1.5f, 1.5f, 1.5f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.25f, 0.0f, 0.25f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	//SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
-	SetShaderTexture("lavender");
-	SetTextureUVScale(5.0, 5.0);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawSphereMesh();
-
-	//Sphere - bush
-				// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(1.2f, 1.2f, 1.2f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-4.75f, 0.0f, 4.25f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	//SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
-	SetShaderTexture("lavender");
-	SetTextureUVScale(2.0, 2.0);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawSphereMesh();
+	const SCENE_OBJECT* objects = m_sceneFile.GetObjects();
+	const SCENE_TRANSFORM* transforms = m_sceneFile.GetTransforms();
+
+	m_pStaticBatcher->Clear();
+	m_staticObjectIDs.assign(m_sceneFile.GetObjectCount(), -1);
+
+	int materialIndex = -1;
+	for (uint32_t i = 0; i < m_sceneFile.GetObjectCount(); i++)
+	{
+		const SCENE_OBJECT& object = objects[i];
+		const OBJECT_RESOURCES& resources = m_objectResources[i];
+		if (!resources.bValid)
+		{
+			continue;
+		}
+
+		if (resources.materialIndex >= 0)
+		{
+			materialIndex = resources.materialIndex;
+		}
+
+		if ((object.flags & SCENE_OBJECT_STATIC) == 0)
+		{
+			continue;
+		}
+
+		int textureSlot = resources.textureSlot;
+		glm::vec4 color(object.color[0], object.color[1], object.color[2], object.color[3]);
+		if (textureSlot >= 0)
+		{
+			color = glm::vec4(1.0f);
+		}
+		else if (color.a < 1.0f)
+		{
+			continue;
+		}
+
+		TRANSFORM_INPUT transform;
+		transform.scaleXYZ = glm::vec3(transforms[i].scaleXYZ[0], transforms[i].scaleXYZ[1], transforms[i].scaleXYZ[2]);
+		transform.rotationDegrees = glm::vec3(transforms[i].rotationDegrees[0], transforms[i].rotationDegrees[1], transforms[i].rotationDegrees[2]);
+		transform.positionXYZ = glm::vec3(transforms[i].positionXYZ[0], transforms[i].positionXYZ[1], transforms[i].positionXYZ[2]);
+
+		if (nullptr != m_pGpuScene)
+		{
+			int textureUnit = (textureSlot >= 0) ? m_textureIDs[textureSlot].streamIndex : -1;
+			glm::vec4 textureRegion = (textureSlot >= 0) ? m_textureIDs[textureSlot].region : g_WholeTextureRegion;
+			m_staticObjectIDs[i] = m_pGpuScene->AddObject(
+				resources.mesh,
+				ComposeModelMatrix(transform),
+				textureSlot,
+				textureUnit,
+				textureRegion,
+				materialIndex,
+				color,
+				glm::vec2(object.UVscale[0], object.UVscale[1]));
+		}
+		else
+		{
+			m_staticObjectIDs[i] = m_pStaticBatcher->AddObject(
+				resources.mesh,
+				ComposeModelMatrix(transform),
+				textureSlot,
+				materialIndex,
+				color,
+				glm::vec2(object.UVscale[0], object.UVscale[1]));
+		}
+	}
+
+	if (nullptr != m_pGpuScene)
+	{
+		m_pGpuScene->Upload();
+
+		std::cout << "INFO: GPU driven culling - " << m_pGpuScene->GetObjectCount() << " objects in "
+			<< m_pGpuScene->GetGroupCount() << " draw groups" << std::endl;
+		return;
+	}
+
+	m_pStaticBatcher->Update();
+
+	m_staticBatchBounds.resize(m_pStaticBatcher->GetBatchCount());
+	for (int i = 0; i < m_pStaticBatcher->GetBatchCount(); i++)
+	{
+		m_staticBatchBounds[i].boundsMin = m_pStaticBatcher->GetBatch(i).boundsMin;
+		m_staticBatchBounds[i].boundsMax = m_pStaticBatcher->GetBatch(i).boundsMax;
+	}
+
+	std::cout << "INFO: Static batching - " << m_pStaticBatcher->GetObjectCount() << " objects in "
+		<< m_pStaticBatcher->GetBatchCount() << " batches" << std::endl;
+}
+
+/***********************************************************
+ *  BuildOcclusionData()
+ *
+ *  This method is used for adding the scene objects marked
+ *  as occluders to the occlusion culler, and for finding
+ *  the bounds of every loaded mesh, which draw packets are
+ *  tested with.
+ ***********************************************************/
+void SceneManager::BuildOcclusionData()
+{
+	std::vector<GLfloat> vertices;
+	std::vector<GLuint> indices;
+	MeshProcessor meshProcessor(m_pJobSystem);
+	MESH_STREAMS streams;
+
+	for (int mesh = 0; mesh < ShapeMeshes::MESH_TYPE_COUNT; mesh++)
+	{
+		if (!m_basicMeshes->GetMeshGeometry((ShapeMeshes::MESH_TYPE)mesh, vertices, indices))
+		{
+			continue;
+		}
+
+		MeshProcessor::ReadInterleaved(
+			vertices.data(),
+			vertices.size() / ShapeMeshes::FLOATS_PER_MESH_VERTEX,
+			ShapeMeshes::FLOATS_PER_MESH_VERTEX,
+			indices.data(),
+			indices.size(),
+			streams);
+		MESH_BOUNDS bounds = meshProcessor.CalculateBounds(streams);
+		m_meshBounds[mesh].boundsMin = bounds.boundsMin;
+		m_meshBounds[mesh].boundsMax = bounds.boundsMax;
+	}
+
+	const SCENE_OBJECT* objects = m_sceneFile.GetObjects();
+	const SCENE_TRANSFORM* transforms = m_sceneFile.GetTransforms();
+
+	m_occlusionCuller.ClearOccluders();
+	for (uint32_t i = 0; i < m_sceneFile.GetObjectCount(); i++)
+	{
+		const SCENE_OBJECT& object = objects[i];
+		if (((object.flags & SCENE_OBJECT_OCCLUDER) == 0) || !m_objectResources[i].bValid)
+		{
+			continue;
+		}
+
+		if (!m_basicMeshes->GetMeshGeometry(m_objectResources[i].mesh, vertices, indices))
+		{
+			continue;
+		}
+
+		TRANSFORM_INPUT transform;
+		transform.scaleXYZ = glm::vec3(transforms[i].scaleXYZ[0], transforms[i].scaleXYZ[1], transforms[i].scaleXYZ[2]);
+		transform.rotationDegrees = glm::vec3(transforms[i].rotationDegrees[0], transforms[i].rotationDegrees[1], transforms[i].rotationDegrees[2]);
+		transform.positionXYZ = glm::vec3(transforms[i].positionXYZ[0], transforms[i].positionXYZ[1], transforms[i].positionXYZ[2]);
+
+		m_occlusionCuller.AddOccluder(vertices, indices, ShapeMeshes::FLOATS_PER_MESH_VERTEX, ComposeModelMatrix(transform));
+	}
+
+	std::cout << "INFO: Occlusion culling - " << m_occlusionCuller.GetOccluderTriangleCount()
+		<< " occluder triangles" << std::endl;
+}
+
+/***********************************************************
+ *  BuildSceneBvh()
+ *
+ *  This method is used for building the hierarchy of the
+ *  scene objects from their world space bounds, which are
+ *  the mesh bounds of BuildOcclusionData() moved by their
+ *  model matrix.  The triangles of the meshes are kept for
+ *  the exact ray tests.
+ ***********************************************************/
+void SceneManager::BuildSceneBvh()
+{
+	m_sceneBvh.Clear();
+	m_pickObjects.clear();
+	m_textureFootprints.clear();
+
+	std::vector<GLfloat> vertices;
+	std::vector<GLuint> indices;
+	for (int mesh = 0; mesh < ShapeMeshes::MESH_TYPE_COUNT; mesh++)
+	{
+		m_meshTriangles[mesh].clear();
+		if (!m_basicMeshes->GetMeshGeometry((ShapeMeshes::MESH_TYPE)mesh, vertices, indices))
+		{
+			continue;
+		}
+		m_meshTriangles[mesh].reserve(indices.size());
+		for (GLuint index : indices)
+		{
+			const GLfloat* position = &vertices[index * ShapeMeshes::FLOATS_PER_MESH_VERTEX];
+			m_meshTriangles[mesh].push_back(glm::vec3(position[0], position[1], position[2]));
+		}
+	}
+
+	const SCENE_OBJECT* objects = m_sceneFile.GetObjects();
+	const SCENE_TRANSFORM* transforms = m_sceneFile.GetTransforms();
+	for (uint32_t i = 0; i < m_sceneFile.GetObjectCount(); i++)
+	{
+		const OBJECT_RESOURCES& resources = m_objectResources[i];
+		if (!resources.bValid || m_meshTriangles[resources.mesh].empty())
+		{
+			continue;
+		}
+
+		TRANSFORM_INPUT transform;
+		transform.scaleXYZ = glm::vec3(transforms[i].scaleXYZ[0], transforms[i].scaleXYZ[1], transforms[i].scaleXYZ[2]);
+		transform.rotationDegrees = glm::vec3(transforms[i].rotationDegrees[0], transforms[i].rotationDegrees[1], transforms[i].rotationDegrees[2]);
+		transform.positionXYZ = glm::vec3(transforms[i].positionXYZ[0], transforms[i].positionXYZ[1], transforms[i].positionXYZ[2]);
+		glm::mat4 modelMatrix = ComposeModelMatrix(transform);
+
+		// world bounds around the eight corners of the mesh bounds
+		const OCCLUSION_BOUNDS& meshBounds = m_meshBounds[resources.mesh];
+		glm::vec3 boundsMin(1.0e30f);
+		glm::vec3 boundsMax(-1.0e30f);
+		for (int corner = 0; corner < 8; corner++)
+		{
+			glm::vec3 position(
+				(corner & 1) ? meshBounds.boundsMax.x : meshBounds.boundsMin.x,
+				(corner & 2) ? meshBounds.boundsMax.y : meshBounds.boundsMin.y,
+				(corner & 4) ? meshBounds.boundsMax.z : meshBounds.boundsMin.z);
+			glm::vec3 world(modelMatrix * glm::vec4(position, 1.0f));
+			boundsMin = glm::min(boundsMin, world);
+			boundsMax = glm::max(boundsMax, world);
+		}
+
+		PICK_OBJECT pickObject;
+		pickObject.sceneObject = (int)i;
+		pickObject.mesh = resources.mesh;
+		pickObject.inverseModel = glm::inverse(modelMatrix);
+		m_pickObjects.push_back(pickObject);
+		m_sceneBvh.AddObject(boundsMin, boundsMax);
+
+		// the same bounds size the texture of the object on screen
+		int textureSlot = resources.textureSlot;
+		if (textureSlot >= 0)
+		{
+			TEXTURE_FOOTPRINT footprint;
+			footprint.center = (boundsMin + boundsMax) * 0.5f;
+			footprint.radius = glm::length(boundsMax - boundsMin) * 0.5f;
+			footprint.streamIndex = m_textureIDs[textureSlot].streamIndex;
+			footprint.texels = m_textureIDs[textureSlot].size *
+				std::max(objects[i].UVscale[0], objects[i].UVscale[1]);
+			m_textureFootprints.push_back(footprint);
+		}
+	}
+
+	m_sceneBvh.Build();
+
+	std::cout << "INFO: Scene hierarchy - " << m_sceneBvh.GetObjectCount() << " objects in "
+		<< m_sceneBvh.GetNodeCount() << " nodes, " << m_sceneBvh.GetDepth() << " levels deep" << std::endl;
+}
+
+/***********************************************************
+ *  IntersectPickObject()
+ *
+ *  This method is used for testing a ray against the shape
+ *  of one object, in the space of its mesh, so that the
+ *  distance along the unnormalized object space direction
+ *  is the world space distance.  Spheres are tested as the
+ *  sphere they are, every other mesh by its triangles.
+ ***********************************************************/
+bool SceneManager::IntersectPickObject(
+	void* data,
+	int objectID,
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float& distance)
+{
+	const SceneManager* pScene = (const SceneManager*)data;
+	const PICK_OBJECT& object = pScene->m_pickObjects[objectID];
+
+	glm::vec3 localOrigin(object.inverseModel * glm::vec4(origin, 1.0f));
+	glm::vec3 localDirection(object.inverseModel * glm::vec4(direction, 0.0f));
+
+	if (ShapeMeshes::MESH_SPHERE == object.mesh)
+	{
+		const OCCLUSION_BOUNDS& bounds = pScene->m_meshBounds[object.mesh];
+		glm::vec3 center = (bounds.boundsMin + bounds.boundsMax) * 0.5f;
+		float radius = (bounds.boundsMax.x - bounds.boundsMin.x) * 0.5f;
+		float scale = glm::length(localDirection);
+
+		float localDistance = 0.0f;
+		if (!glm::intersectRaySphere(localOrigin, localDirection / scale, center, radius * radius, localDistance))
+		{
+			return false;
+		}
+		distance = localDistance / scale;
+		return true;
+	}
+
+	const std::vector<glm::vec3>& triangles = pScene->m_meshTriangles[object.mesh];
+	bool bHit = false;
+	for (size_t i = 0; i + 2 < triangles.size(); i += 3)
+	{
+		glm::vec2 barycentric;
+		float triangleDistance = 0.0f;
+		if (glm::intersectRayTriangle(localOrigin, localDirection, triangles[i], triangles[i + 1], triangles[i + 2], barycentric, triangleDistance) &&
+			(triangleDistance >= 0.0f) &&
+			(!bHit || (triangleDistance < distance)))
+		{
+			distance = triangleDistance;
+			bHit = true;
+		}
+	}
+	return bHit;
+}
+
+/***********************************************************
+ *  PickObject()
+ *
+ *  This method is used for finding the scene object a ray
+ *  hits first, like the one in the middle of the view.
+ ***********************************************************/
+int SceneManager::PickObject(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance)
+{
+	BVH_RAY_HIT hit;
+	if (!m_sceneBvh.RayCast(origin, glm::normalize(direction), maxDistance, &SceneManager::IntersectPickObject, this, hit))
+	{
+		return -1;
+	}
+
+	distance = hit.distance;
+	return m_pickObjects[hit.objectID].sceneObject;
+}
+
+/***********************************************************
+ *  RenderOcclusionDepth()
+ *
+ *  This method is used for building the depth pyramid of
+ *  the occluders for the camera of the frame being built,
+ *  and for testing every static batch against it.
+ ***********************************************************/
+void SceneManager::RenderOcclusionDepth()
+{
+	FRAME_DATA& frame = *m_pCurrentFrame;
+
+	m_occlusionCuller.RenderOccluders(frame.projection * frame.view);
+
+	const glm::mat4 identity(1.0f);
+	for (size_t i = 0; i < frame.staticBatchVisibility.size(); i++)
+	{
+		frame.staticBatchVisibility[i] = m_occlusionCuller.IsVisible(identity, m_staticBatchBounds[i]) ? 1 : 0;
+	}
+}
+
+/***********************************************************
+ *  CullDrawPackets()
+ *
+ *  This method is used for testing the packets of the sort
+ *  keys in the passed in range against the depth pyramid.
+ *  The keys of hidden packets are replaced by a marker
+ *  that RemoveCulledSortKeys() drops.
+ ***********************************************************/
+void SceneManager::CullDrawPackets(int firstKey, int lastKey)
+{
+	FRAME_DATA& frame = *m_pCurrentFrame;
+
+	for (int i = firstKey; i < lastKey; i++)
+	{
+		const DRAW_PACKET& packet = frame.drawPackets[(size_t)(frame.sortKeys[i] & g_SortIndexMask)];
+		if (!m_occlusionCuller.IsVisible(packet.modelMatrix, m_meshBounds[packet.mesh]))
+		{
+			frame.sortKeys[i] = g_CulledSortKey;
+		}
+	}
+}
+
+/***********************************************************
+ *  RemoveCulledSortKeys()
+ *
+ *  This method is used for removing the keys marked by
+ *  CullDrawPackets() in place.
+ ***********************************************************/
+void SceneManager::RemoveCulledSortKeys()
+{
+	FRAME_DATA& frame = *m_pCurrentFrame;
+
+	uint64_t* keptEnd = std::remove(frame.sortKeys.begin(), frame.sortKeys.end(), g_CulledSortKey);
+	frame.sortKeys.resize((size_t)(keptEnd - frame.sortKeys.begin()));
+}
+
+/***********************************************************
+ *  ReserveTextureUnit()
+ *
+ *  This method is used for taking a texture unit for a
+ *  system that binds its own texture.  The units follow the
+ *  scene textures, so they are only reserved once all of
+ *  the scene textures are loaded.
+ ***********************************************************/
+GLint SceneManager::ReserveTextureUnit()
+{
+	int textureCount = (nullptr != m_pTextureStreamer) ? m_pTextureStreamer->GetTextureCount() : 0;
+	int textureUnit = textureCount + m_reservedTextureUnits;
+	if (textureUnit >= 16)
+	{
+		return(-1);
+	}
+
+	m_reservedTextureUnits++;
+
+	return(textureUnit);
+}
+
+/***********************************************************
+ *  BuildTerrain()
+ *
+ *  This method is used for creating the terrain of the
+ *  scene file, from its heightmap or from noise, keeping
+ *  its flat area level with the scene objects.  The
+ *  texture and material are resolved the same way as for
+ *  an object.
+ ***********************************************************/
+void SceneManager::BuildTerrain()
+{
+	const SCENE_TERRAIN* terrain = m_sceneFile.GetTerrain();
+	if (nullptr == terrain)
+	{
+		return;
+	}
+
+	// the heights are bound next to the scene textures
+	GLint textureUnit = ReserveTextureUnit();
+	if (textureUnit < 0)
+	{
+		std::cout << "WARNING: No texture unit is left for the terrain heights" << std::endl;
+		return;
+	}
+
+	m_pTerrain = new TerrainSystem();
+
+	bool bHasHeights = false;
+	if (terrain->heightmapString != SCENE_NO_STRING)
+	{
+		bHasHeights = m_pTerrain->LoadHeightmap(m_sceneFile.GetString(terrain->heightmapString), terrain->size, terrain->heightScale);
+	}
+	if (bHasHeights == false)
+	{
+		bHasHeights = m_pTerrain->GenerateHeights(
+			terrain->size,
+			(int)terrain->resolution,
+			terrain->heightScale,
+			terrain->featureSize,
+			terrain->seed);
+	}
+	if (terrain->flatBlend >= 0.0f)
+	{
+		m_pTerrain->FlattenArea(
+			glm::vec2(terrain->flatMin[0], terrain->flatMin[1]),
+			glm::vec2(terrain->flatMax[0], terrain->flatMax[1]),
+			terrain->flatBlend);
+	}
+
+	if (!bHasHeights ||
+		!m_pTerrain->Upload(m_pShaderManager, glm::vec2(terrain->UVscale[0], terrain->UVscale[1])))
+	{
+		std::cout << "ERROR: The terrain could not be built" << std::endl;
+		m_pTerrain->Clear();
+		delete m_pTerrain;
+		m_pTerrain = nullptr;
+		return;
+	}
+
+	m_terrainTextureUnit = textureUnit;
+	m_terrainTextureSlot = -1;
+	m_terrainColor = glm::vec4(terrain->color[0], terrain->color[1], terrain->color[2], terrain->color[3]);
+	if ((terrain->flags & SCENE_OBJECT_TEXTURED) != 0)
+	{
+		m_terrainTextureSlot = ResolveTexture(terrain->textureHash, terrain->textureString);
+		KeepFullResolution(m_terrainTextureSlot);
+		m_terrainColor = glm::vec4(1.0f);
+	}
+	m_terrainMaterialIndex = -1;
+	if ((terrain->flags & SCENE_OBJECT_MATERIAL) != 0)
+	{
+		m_terrainMaterialIndex = ResolveMaterial(terrain->materialHash, terrain->materialString);
+	}
+
+	std::cout << "INFO: Terrain - " << m_pTerrain->GetLevelCount() << " levels of detail, at most "
+		<< m_pTerrain->GetMaxNodeCount() * m_pTerrain->GetTrianglesPerNode() << " triangles" << std::endl;
+}
+
+/***********************************************************
+ *  BuildTerrainNodes()
+ *
+ *  This method is used for picking the terrain chunks of
+ *  the frame being built.
+ ***********************************************************/
+void SceneManager::BuildTerrainNodes()
+{
+	FRAME_DATA& frame = *m_pCurrentFrame;
+
+	if (nullptr == m_pTerrain)
+	{
+		return;
+	}
+
+	m_pTerrain->SelectNodes(frame.projection * frame.view, frame.viewPosition, frame.terrainNodes);
+}
+
+/***********************************************************
+ *  BuildTextureLevels()
+ *
+ *  This method is used for working out the finest mipmap
+ *  level every streamed texture needs for the camera of
+ *  the frame being built.  Every textured object covers
+ *  about its bounding sphere on screen, and a texture
+ *  needs the level at which the texels stretched across
+ *  the object are no more than the pixels it covers.  The
+ *  objects outside the view are counted too, so turning
+ *  the camera does not make textures load again.
+ ***********************************************************/
+void SceneManager::BuildTextureLevels()
+{
+	FRAME_DATA& frame = *m_pCurrentFrame;
+
+	int textureCount = (nullptr != m_pTextureStreamer) ? m_pTextureStreamer->GetTextureCount() : 0;
+	frame.textureLevels.resize(textureCount);
+	for (int i = 0; i < textureCount; i++)
+	{
+		frame.textureLevels[i] = g_UnneededTextureLevel;
+	}
+
+	// pixels covered by one unit of size at a distance of one
+	float pixelsPerUnit = frame.projection[1][1] * 0.5f * (float)frame.framebufferHeight;
+
+	for (const TEXTURE_FOOTPRINT& footprint : m_textureFootprints)
+	{
+		float distance = glm::length(footprint.center - frame.viewPosition) - footprint.radius;
+		float pixels = footprint.radius * 2.0f * pixelsPerUnit / std::max(distance, g_MinFootprintDistance);
+
+		int level = 0;
+		if (footprint.texels > pixels)
+		{
+			level = std::min((int)std::log2(footprint.texels / pixels), (int)g_UnneededTextureLevel);
+		}
+		uint8_t& neededLevel = frame.textureLevels[footprint.streamIndex];
+		neededLevel = std::min(neededLevel, (uint8_t)level);
+	}
+
+	for (int streamIndex : m_fullResolutionTextures)
+	{
+		frame.textureLevels[streamIndex] = 0;
+	}
+}
+
+/***********************************************************
+ *  BuildVegetation()
+ *
+ *  This method is used for creating the species of the
+ *  scene file from their parts, scattering their instances
+ *  and baking their impostors.  The texture and material
+ *  of a part are resolved the same way as for an object,
+ *  except that a part without a material keeps the one of
+ *  the part drawn before it.
+ ***********************************************************/
+void SceneManager::BuildVegetation()
+{
+	if (m_sceneFile.GetSpeciesCount() == 0)
+	{
+		return;
+	}
+
+	// the atlas is bound next to the scene textures
+	GLint textureUnit = ReserveTextureUnit();
+	if (textureUnit < 0)
+	{
+		std::cout << "WARNING: No texture unit is left for the vegetation impostors" << std::endl;
+		return;
+	}
+
+	ShaderManager impostorShader;
+	impostorShader.LoadShaderProgram(
+		g_ImpostorVertexShaderFile,
+		g_ImpostorFragmentShaderFile,
+		g_ImpostorVertexSpirvFile,
+		g_ImpostorFragmentSpirvFile,
+		std::vector<SHADER_SPECIALIZATION>());
+	m_pVegetation = new VegetationSystem(m_basicMeshes, impostorShader);
+	m_impostorTextureUnit = textureUnit;
+
+	const SCENE_SPECIES* species = m_sceneFile.GetSpecies();
+	const SCENE_SPECIES_PART* parts = m_sceneFile.GetParts();
+
+	for (uint32_t i = 0; i < m_sceneFile.GetSpeciesCount(); i++)
+	{
+		int speciesIndex = m_pVegetation->AddSpecies(species[i].fadeStart, species[i].fadeEnd, species[i].drawDistance);
+
+		for (uint32_t p = species[i].firstPart; p < species[i].firstPart + species[i].partCount; p++)
+		{
+			const SCENE_SPECIES_PART& part = parts[p];
+
+			// a part using a handle that is not registered is left
+			// out, like a scene object
+			ShapeMeshes::MESH_TYPE meshType = ShapeMeshes::MESH_BOX;
+			bool bValid = ResolveMesh(part.meshHash, part.meshString, meshType);
+
+			int textureSlot = -1;
+			glm::vec4 color(part.color[0], part.color[1], part.color[2], part.color[3]);
+			if ((part.flags & SCENE_OBJECT_TEXTURED) != 0)
+			{
+				textureSlot = ResolveTexture(part.textureHash, part.textureString);
+				bValid = bValid && (textureSlot >= 0);
+				color = glm::vec4(1.0f);
+			}
+
+			int materialIndex = -1;
+			if ((part.flags & SCENE_OBJECT_MATERIAL) != 0)
+			{
+				materialIndex = ResolveMaterial(part.materialHash, part.materialString);
+				bValid = bValid && (materialIndex >= 0);
+			}
+
+			if (!bValid)
+			{
+				continue;
+			}
+			KeepFullResolution(textureSlot);
+
+			TRANSFORM_INPUT transform;
+			transform.scaleXYZ = glm::vec3(part.transform.scaleXYZ[0], part.transform.scaleXYZ[1], part.transform.scaleXYZ[2]);
+			transform.rotationDegrees = glm::vec3(part.transform.rotationDegrees[0], part.transform.rotationDegrees[1], part.transform.rotationDegrees[2]);
+			transform.positionXYZ = glm::vec3(part.transform.positionXYZ[0], part.transform.positionXYZ[1], part.transform.positionXYZ[2]);
+
+			m_pVegetation->AddPart(
+				speciesIndex,
+				meshType,
+				ComposeModelMatrix(transform),
+				textureSlot,
+				materialIndex,
+				color,
+				glm::vec2(part.UVscale[0], part.UVscale[1]));
+		}
+	}
+
+	const SCENE_SCATTER* scatters = m_sceneFile.GetScatters();
+	for (uint32_t i = 0; i < m_sceneFile.GetScatterCount(); i++)
+	{
+		const SCENE_SCATTER& scatter = scatters[i];
+
+		int speciesIndex = -1;
+		for (uint32_t s = 0; s < m_sceneFile.GetSpeciesCount(); s++)
+		{
+			if (species[s].tagHash == scatter.speciesHash)
+			{
+				speciesIndex = (int)s;
+			}
+		}
+
+		VegetationSystem::DENSITY_MAP densityMap;
+		bool bHasDensity = (scatter.densityString != SCENE_NO_STRING) &&
+			VegetationSystem::LoadDensityMap(m_sceneFile.GetString(scatter.densityString), densityMap);
+
+		m_pVegetation->Scatter(
+			speciesIndex,
+			(int)scatter.count,
+			scatter.seed,
+			glm::vec2(scatter.areaMin[0], scatter.areaMin[1]),
+			glm::vec2(scatter.areaMax[0], scatter.areaMax[1]),
+			scatter.scaleMin,
+			scatter.scaleMax,
+			bHasDensity ? &densityMap : nullptr,
+			m_pTerrain);
+	}
+
+	m_pVegetation->Upload();
+	BakeImpostors();
+
+	std::cout << "INFO: Vegetation - " << m_pVegetation->GetInstanceCount() << " plants of "
+		<< m_pVegetation->GetSpeciesCount() << " species" << std::endl;
+}
+
+/***********************************************************
+ *  BuildParticles()
+ *
+ *  This method is used for creating the particle effects
+ *  of the scene file.  An effect tied to a species emits
+ *  from the bounding sphere of every instance of it, the
+ *  others from their box.  The particles land on the
+ *  terrain when the scene has one.
+ ***********************************************************/
+void SceneManager::BuildParticles()
+{
+	if (m_sceneFile.GetParticlesCount() == 0)
+	{
+		return;
+	}
+
+	if (!ParticleSystem::IsSupported())
+	{
+		std::cout << "WARNING: The context has no compute shaders, the particle effects are skipped" << std::endl;
+		return;
+	}
+
+	GLuint simulationProgram = m_pShaderManager->LoadComputeShader(g_ParticleComputeShaderFile);
+	if (simulationProgram == 0)
+	{
+		std::cout << "ERROR: The particle shader could not be loaded" << std::endl;
+		return;
+	}
+	ShaderManager particleShader;
+	GLuint drawProgram = particleShader.LoadShaders(g_ParticleVertexShaderFile, g_ParticleFragmentShaderFile);
+	if (drawProgram == 0)
+	{
+		std::cout << "ERROR: The particle shader could not be loaded" << std::endl;
+		glDeleteProgram(simulationProgram);
+		return;
+	}
+	m_pParticles = new ParticleSystem(simulationProgram, drawProgram);
+
+	if (nullptr != m_pTerrain)
+	{
+		m_pParticles->SetGround(m_pTerrain->GetHeightTexture(), m_terrainTextureUnit, m_pTerrain->GetArea());
+	}
+
+	const SCENE_PARTICLES* particles = m_sceneFile.GetParticles();
+	const SCENE_SPECIES* species = m_sceneFile.GetSpecies();
+	int capacity = 0;
+	for (uint32_t i = 0; i < m_sceneFile.GetParticlesCount(); i++)
+	{
+		const SCENE_PARTICLES& effect = particles[i];
+
+		std::vector<glm::vec4> emitterSpheres;
+		if (effect.speciesString != SCENE_NO_STRING)
+		{
+			int speciesIndex = -1;
+			for (uint32_t s = 0; s < m_sceneFile.GetSpeciesCount(); s++)
+			{
+				if (species[s].tagHash == effect.speciesHash)
+				{
+					speciesIndex = (int)s;
+				}
+			}
+			if ((nullptr != m_pVegetation) && (speciesIndex >= 0) && (speciesIndex < m_pVegetation->GetSpeciesCount()))
+			{
+				for (int instance = 0; instance < m_pVegetation->GetSpeciesInstanceCount(speciesIndex); instance++)
+				{
+					emitterSpheres.push_back(m_pVegetation->GetInstanceSphere(speciesIndex, instance));
+				}
+			}
+			if (emitterSpheres.empty())
+			{
+				std::cout << "WARNING: The particles \"" << m_sceneFile.GetString(effect.tagString)
+					<< "\" have no plants to fall from" << std::endl;
+				continue;
+			}
+		}
+
+		PARTICLE_EFFECT_DESC desc;
+		desc.capacity = (int)effect.capacity;
+		desc.rate = effect.rate;
+		desc.lifetime = effect.lifetime;
+		desc.sizeMin = effect.sizeMin;
+		desc.sizeMax = effect.sizeMax;
+		desc.gravity = effect.gravity;
+		desc.drag = effect.drag;
+		desc.wind = glm::vec2(effect.wind[0], effect.wind[1]);
+		desc.gust = effect.gust;
+		desc.textureUnit = -1;
+		desc.color = glm::vec4(effect.color[0], effect.color[1], effect.color[2], effect.color[3]);
+		if ((effect.flags & SCENE_OBJECT_TEXTURED) != 0)
+		{
+			// the particle textures are kept out of the atlases, so
+			// the whole texture on the unit is theirs
+			int textureSlot = ResolveTexture(effect.textureHash, effect.textureString);
+			if (textureSlot < 0)
+			{
+				continue;
+			}
+			desc.textureUnit = m_textureIDs[textureSlot].streamIndex;
+			KeepFullResolution(textureSlot);
+		}
+
+		if (m_pParticles->AddEffect(
+			desc,
+			emitterSpheres,
+			glm::vec3(effect.areaMin[0], effect.areaMin[1], effect.areaMin[2]),
+			glm::vec3(effect.areaMax[0], effect.areaMax[1], effect.areaMax[2])) < 0)
+		{
+			std::cout << "WARNING: The particles \"" << m_sceneFile.GetString(effect.tagString)
+				<< "\" could not be added" << std::endl;
+			continue;
+		}
+		capacity += desc.capacity;
+	}
+
+	std::cout << "INFO: Particles - " << m_pParticles->GetEffectCount() << " effects, room for "
+		<< capacity << " particles" << std::endl;
+}
+
+/***********************************************************
+ *  GetParticleCount()
+ *
+ *  This method is used for getting the number of particles
+ *  the last finished readback found alive.
+ ***********************************************************/
+int SceneManager::GetParticleCount() const
+{
+	if (nullptr == m_pParticles)
+	{
+		return -1;
+	}
+	return m_pParticles->GetAliveCount();
+}
+
+/***********************************************************
+ *  BakeImpostors()
+ *
+ *  This method is used for drawing every species from the
+ *  side into its cell of the impostor atlas.  The plants
+ *  are drawn unlit and at their unscaled texture mapping,
+ *  as the lit shader draws them, since the light would
+ *  not follow a billboard anyway.
+ ***********************************************************/
+void SceneManager::BakeImpostors()
+{
+	if (!m_pVegetation->BeginImpostorBake())
+	{
+		return;
+	}
+
+	m_pShaderManager->setBoolValue(g_UseLightingName, false);
+
+	SUBMIT_STATE state;
+	state.bFirstDraw = true;
+	state.textureSlot = -1;
+	state.materialIndex = -1;
+	state.color = glm::vec4(0.0f);
+	state.UVscale = glm::vec2(0.0f);
+
+	for (int species = 0; species < m_pVegetation->GetSpeciesCount(); species++)
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		m_pVegetation->BeginImpostor(species, view, projection);
+		m_pShaderManager->setMat4Value("view", view);
+		m_pShaderManager->setMat4Value("projection", projection);
+
+		for (int part = 0; part < m_pVegetation->GetPartCount(species); part++)
+		{
+			const VEGETATION_PART& drawnPart = m_pVegetation->GetPart(species, part);
+			ApplyDrawState(state, drawnPart.textureSlot, drawnPart.materialIndex, drawnPart.color, glm::vec2(1.0f));
+			m_pShaderManager->setMat4Value(m_uniforms.model, drawnPart.localMatrix);
+			m_basicMeshes->DrawMesh(drawnPart.mesh);
+		}
+	}
+
+	m_pVegetation->EndImpostorBake();
+	m_pShaderManager->setBoolValue(g_UseLightingName, true);
+}
+
+/***********************************************************
+ *  BuildVegetationInstances()
+ *
+ *  This method is used for sorting the plants into the
+ *  instance lists of the frame being built.
+ ***********************************************************/
+void SceneManager::BuildVegetationInstances()
+{
+	FRAME_DATA& frame = *m_pCurrentFrame;
+
+	if (nullptr == m_pVegetation)
+	{
+		return;
+	}
+
+	m_pVegetation->BuildInstances(
+		frame.projection * frame.view,
+		frame.viewPosition,
+		frame.vegetationInstances,
+		frame.vegetationImpostors,
+		frame.vegetationRanges);
+}
+
+/***********************************************************
+ *  LoadSceneShaders()
+ *
+ *  This method is used for loading the scene shaders, with
+ *  the SPIR-V build specialized for the lights of the scene
+ *  file, so it has to be loaded first.  Returns false when
+ *  the shader program could not be loaded.
+ ***********************************************************/
+bool SceneManager::LoadSceneShaders()
+{
+	GLuint pointLightCount = 0;
+	const SCENE_LIGHT* lights = m_sceneFile.GetLights();
+	for (uint32_t i = 0; i < m_sceneFile.GetLightCount(); i++)
+	{
+		if (lights[i].type == SCENE_LIGHT_POINT)
+		{
+			pointLightCount++;
+		}
+	}
+
+	// the scene file has no spot lights
+	std::vector<SHADER_SPECIALIZATION> specializations;
+	specializations.push_back({ GL_FRAGMENT_SHADER, g_PointLightCountConstant, pointLightCount });
+	specializations.push_back({ GL_FRAGMENT_SHADER, g_SpotLightEnabledConstant, GL_FALSE });
+
+	GLuint program = m_pShaderManager->LoadShaderProgram(
+		g_VertexShaderFile,
+		g_FragmentShaderFile,
+		g_VertexSpirvFile,
+		g_FragmentSpirvFile,
+		specializations);
+	if (program == 0)
+	{
+		std::cout << "ERROR: The scene shader could not be loaded" << std::endl;
+		return(false);
+	}
+	m_pShaderManager->use();
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetupSceneLights()
+ *
+ *  This method is used for setting the lights listed in
+ *  the scene file into the shader.
+ ***********************************************************/
+void SceneManager::SetupSceneLights()
+{
+	m_pShaderManager->setBoolValue(g_UseLightingName, true);
+
+	const SCENE_LIGHT* lights = m_sceneFile.GetLights();
+	int pointLightCount = 0;
+	for (uint32_t i = 0; i < m_sceneFile.GetLightCount(); i++)
+	{
+		const SCENE_LIGHT& light = lights[i];
+
+		// the point lights fill the shader array in scene order
+		std::string prefix = "directionalLight.";
+		if (light.type == SCENE_LIGHT_POINT)
+		{
+			prefix = "pointLights[" + std::to_string(pointLightCount++) + "].";
+		}
+
+		const char* vectorName = (light.type == SCENE_LIGHT_POINT) ? "position" : "direction";
+		m_pShaderManager->setVec3Value((prefix + vectorName).c_str(), light.vector[0], light.vector[1], light.vector[2]);
+		m_pShaderManager->setVec3Value((prefix + "ambient").c_str(), light.ambient[0], light.ambient[1], light.ambient[2]);
+		m_pShaderManager->setVec3Value((prefix + "diffuse").c_str(), light.diffuse[0], light.diffuse[1], light.diffuse[2]);
+		m_pShaderManager->setVec3Value((prefix + "specular").c_str(), light.specular[0], light.specular[1], light.specular[2]);
+		m_pShaderManager->setBoolValue((prefix + "bActive").c_str(), true);
+	}
+}
+
+/***********************************************************
+ *  PrepareScene()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene 
+ *  rendering.  Returns false when the scene file or the
+ *  scene shaders could not be loaded.
+ ***********************************************************/
+bool SceneManager::PrepareScene()
+{
+	// the scene file lists the textures, materials, meshes and
+	// objects of the 3D scene
+	if (!LoadSceneFile(m_sceneFile))
+	{
+		std::cout << "ERROR: The 3D scene could not be loaded" << std::endl;
+		return(false);
+	}
+
+	// the shaders are specialized for the lights of the scene file
+	if (!LoadSceneShaders())
+	{
+		return(false);
+	}
+
+	//load the texture image files for the textures applied
+	// to objects in the 3D scene
+	LoadSceneTextures();
+	DefineObjectMaterials();
+	SetupSceneLights();
+	CacheUniformLocations();
+
+	// only one instance of a particular mesh needs to be
+	// loaded in memory no matter how many times it is drawn
+	// in the rendered 3D scene
+	LoadSceneMeshes();
+
+	// every handle of the scene objects is resolved once, so a
+	// handle without a resource is found here and not while
+	// the frames are recorded
+	ResolveSceneObjects();
+
+	// objects that never move are culled and drawn by the GPU
+	// when the context supports it, or merged into a few
+	// buffers, instead of being recorded as draw packets
+	if (GpuDrivenScene::IsSupported())
+	{
+		GLuint cullingProgram = m_pShaderManager->LoadComputeShader(g_CullingShaderFile);
+		if (cullingProgram != 0)
+		{
+			m_pGpuScene = new GpuDrivenScene(m_basicMeshes, cullingProgram);
+		}
+	}
+	BuildStaticObjects();
+
+	// the large solid objects hide whatever is behind them
+	BuildOcclusionData();
+
+	// every object can be found by a ray, for picking
+	BuildSceneBvh();
+
+	// the ground, which the plants are placed on
+	BuildTerrain();
+
+	// plants scattered in their thousands, drawn instanced
+	BuildVegetation();
+
+	// leaves falling from the plants, which need the plants
+	// to be scattered first
+	BuildParticles();
+
+	return(true);
+}
+
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene by
+ *  transforming and drawing every object of the scene file.
+ *  The draws are recorded as packets into the frame being
+ *  built.
+ ***********************************************************/
+void SceneManager::RenderScene()
+{
+	const SCENE_OBJECT* objects = m_sceneFile.GetObjects();
+	const SCENE_TRANSFORM* transforms = m_sceneFile.GetTransforms();
+
+	for (uint32_t i = 0; i < m_sceneFile.GetObjectCount(); i++)
+	{
+		const SCENE_OBJECT& object = objects[i];
+		const SCENE_TRANSFORM& transform = transforms[i];
+		const OBJECT_RESOURCES& resources = m_objectResources[i];
+		if (!resources.bValid)
+		{
+			continue;
+		}
+
+		if ((i < m_staticObjectIDs.size()) && (m_staticObjectIDs[i] >= 0))
+		{
+			// batched objects are drawn from their static batch,
+			// only the material they pass on is still recorded
+			if (resources.materialIndex >= 0)
+			{
+				SetShaderMaterial(resources.materialIndex);
+			}
+			continue;
+		}
+
+		// set the transformations into memory to be used on the drawn meshes
+		SetTransformations(
+			glm::vec3(transform.scaleXYZ[0], transform.scaleXYZ[1], transform.scaleXYZ[2]),
+			transform.rotationDegrees[0],
+			transform.rotationDegrees[1],
+			transform.rotationDegrees[2],
+			glm::vec3(transform.positionXYZ[0], transform.positionXYZ[1], transform.positionXYZ[2]));
+
+		if (resources.textureSlot >= 0)
+		{
+			SetShaderTexture(resources.textureSlot);
+		}
+		else
+		{
+			SetShaderColor(object.color[0], object.color[1], object.color[2], object.color[3]);
+		}
+		SetTextureUVScale(object.UVscale[0], object.UVscale[1]);
+
+		if (resources.materialIndex >= 0)
+		{
+			SetShaderMaterial(resources.materialIndex);
+		}
+
+		// draw the mesh with transformation values
+		AddDrawPacket(resources.mesh);
+	}
+}
+
+/***********************************************************
+ *  BuildFrame()
+ *
+ *  This method is used for recording the draw packets of
+ *  the 3D scene into the passed in frame.  It only touches
+ *  CPU data, so it runs on the main thread while the render
+ *  thread is still submitting the previous frame.
+ *
+ *  The work is expressed as a small task graph:
+ *
+ *    record packets --> compose transformations (parallel) --> cull (parallel)
+ *                   \-> sort submission order --------------/
+ *    occluder depth --------------------------------------/
+ *    vegetation instances
+ *    terrain chunks
+ *
+ *  The later stages are parked on the counter of the first.
+ *  The transformations are split into contiguous ranges,
+ *  while the sort runs alongside them as a single job.  The
+ *  occluder depth, the vegetation instances and the terrain
+ *  chunks only need the camera, so they are built alongside
+ *  the recording.  Once all of them are done the
+ *  sorted packets are tested against the depth in parallel
+ *  ranges, and the hidden ones are dropped.
+ ***********************************************************/
+void SceneManager::BuildFrame(FRAME_DATA& frame)
+{
+	m_pCurrentFrame = &frame;
+	m_transformInputs.clear();
+
+	// sized here because the arena must not be used by two
+	// jobs at once
+	frame.staticBatchVisibility.resize(m_staticBatchBounds.size());
+	if (nullptr != m_pVegetation)
+	{
+		frame.vegetationInstances.resize(m_pVegetation->GetInstanceCount());
+		frame.vegetationImpostors.resize(m_pVegetation->GetInstanceCount());
+		frame.vegetationRanges.resize(m_pVegetation->GetSpeciesCount());
+	}
+	if (nullptr != m_pTerrain)
+	{
+		frame.terrainNodes.resize(m_pTerrain->GetMaxNodeCount());
+	}
+
+	// only a loop over the textured objects, so it is not
+	// worth a job of its own
+	BuildTextureLevels();
+
+	if (nullptr == m_pJobSystem)
+	{
+		RenderOcclusionDepth();
+		BuildVegetationInstances();
+		BuildTerrainNodes();
+		RenderScene();
+		ComposeTransformations(0, (int)frame.drawPackets.size());
+		SortDrawPackets();
+		CullDrawPackets(0, (int)frame.sortKeys.size());
+		RemoveCulledSortKeys();
+		m_pCurrentFrame = nullptr;
+		return;
+	}
+
+	JobCounter recordDone;
+	JobCounter composeDone;
+	JobCounter sortDone;
+	JobCounter occlusionDone;
+	JobCounter vegetationDone;
+	JobCounter terrainDone;
+	m_pComposeDone = &composeDone;
+
+	m_pJobSystem->Run(&OcclusionStageJob, this, 0, 0, &occlusionDone);
+	m_pJobSystem->Run(&VegetationStageJob, this, 0, 0, &vegetationDone);
+	m_pJobSystem->Run(&TerrainStageJob, this, 0, 0, &terrainDone);
+	m_pJobSystem->Run(&RecordStageJob, this, 0, 0, &recordDone);
+	m_pJobSystem->Run(&ComposeStageJob, this, 0, 0, &composeDone, &recordDone);
+	m_pJobSystem->Run(&SortStageJob, this, 0, 0, &sortDone, &recordDone);
+	m_pJobSystem->Wait(composeDone);
+	m_pJobSystem->Wait(sortDone);
+	m_pJobSystem->Wait(occlusionDone);
+	m_pJobSystem->Wait(vegetationDone);
+	m_pJobSystem->Wait(terrainDone);
+
+	m_pJobSystem->ParallelFor(0, (int)frame.sortKeys.size(), g_CullGrainSize, m_cullBody);
+	RemoveCulledSortKeys();
+
+	m_pComposeDone = nullptr;
+	m_pCurrentFrame = nullptr;
+}
+
+/***********************************************************
+ *  RecordStageJob()
+ *
+ *  Job entry point for the recording stage of BuildFrame().
+ ***********************************************************/
+void SceneManager::RecordStageJob(void* data, int first, int last)
+{
+	SceneManager* pScene = (SceneManager*)data;
+	pScene->RenderScene();
+}
+
+/***********************************************************
+ *  ComposeStageJob()
+ *
+ *  Job entry point for the transformation stage of
+ *  BuildFrame().  The ranges it spawns are counted on the
+ *  same counter as the stage itself, so the counter only
+ *  reaches zero once every range has been composed.
+ ***********************************************************/
+void SceneManager::ComposeStageJob(void* data, int first, int last)
+{
+	SceneManager* pScene = (SceneManager*)data;
+	pScene->m_pJobSystem->ParallelFor(
+		0,
+		(int)pScene->m_pCurrentFrame->drawPackets.size(),
+		g_ComposeGrainSize,
+		pScene->m_composeBody,
+		*pScene->m_pComposeDone);
+}
+
+/***********************************************************
+ *  SortStageJob()
+ *
+ *  Job entry point for the sorting stage of BuildFrame().
+ *  It only reads the recorded state of the packets, so it
+ *  can run while their model matrices are being composed.
+ ***********************************************************/
+void SceneManager::SortStageJob(void* data, int first, int last)
+{
+	SceneManager* pScene = (SceneManager*)data;
+	pScene->SortDrawPackets();
+}
+
+/***********************************************************
+ *  ApplyDrawState()
+ *
+ *  This method is used for setting the texture, color, UV
+ *  scale and material of one draw into the shader.  Values
+ *  that match the previous draw are not set again.
+ ***********************************************************/
+void SceneManager::ApplyDrawState(
+	SUBMIT_STATE& state,
+	int textureSlot,
+	int materialIndex,
+	const glm::vec4& color,
+	const glm::vec2& UVscale)
+{
+	if (textureSlot >= 0)
+	{
+		if (state.bFirstDraw || (state.textureSlot != textureSlot))
+		{
+			// the unit of the streamed texture, and the region of
+			// it the slot takes when it shares an atlas
+			const TEXTURE_INFO& texture = m_textureIDs[textureSlot];
+			m_pShaderManager->setIntValue(m_uniforms.useTexture, true);
+			m_pShaderManager->setIntValue(m_uniforms.texture, texture.streamIndex);
+			m_pShaderManager->setVec4Value(m_uniforms.textureRegion, texture.region);
+		}
+	}
+	else
+	{
+		if (state.bFirstDraw || (state.textureSlot >= 0))
+		{
+			m_pShaderManager->setIntValue(m_uniforms.useTexture, false);
+		}
+		if (state.bFirstDraw || (state.textureSlot >= 0) || (state.color != color))
+		{
+			m_pShaderManager->setVec4Value(m_uniforms.color, color);
+			state.color = color;
+		}
+	}
+	state.textureSlot = textureSlot;
+
+	if (state.bFirstDraw || (state.UVscale != UVscale))
+	{
+		m_pShaderManager->setVec2Value(m_uniforms.UVscale, UVscale);
+		state.UVscale = UVscale;
+	}
+
+	// draws without a material keep whatever material the
+	// previous draw left in the shader
+	if ((materialIndex >= 0) &&
+		(state.bFirstDraw || (state.materialIndex != materialIndex)))
+	{
+		const OBJECT_MATERIAL& material = m_objectMaterials[materialIndex];
+		m_pShaderManager->setVec3Value(m_uniforms.materialAmbientColor, material.ambientColor);
+		m_pShaderManager->setFloatValue(m_uniforms.materialAmbientStrength, material.ambientStrength);
+		m_pShaderManager->setVec3Value(m_uniforms.materialDiffuseColor, material.diffuseColor);
+		m_pShaderManager->setVec3Value(m_uniforms.materialSpecularColor, material.specularColor);
+		m_pShaderManager->setFloatValue(m_uniforms.materialShininess, material.shininess);
+		state.materialIndex = materialIndex;
+	}
+
+	state.bFirstDraw = false;
+}
+
+/***********************************************************
+ *  OcclusionStageJob()
+ *
+ *  Job entry point for the occluder depth stage of
+ *  BuildFrame().
+ ***********************************************************/
+void SceneManager::OcclusionStageJob(void* data, int first, int last)
+{
+	SceneManager* pScene = (SceneManager*)data;
+	pScene->RenderOcclusionDepth();
+}
+
+/***********************************************************
+ *  VegetationStageJob()
+ *
+ *  Job entry point for the vegetation stage of BuildFrame().
+ ***********************************************************/
+void SceneManager::VegetationStageJob(void* data, int first, int last)
+{
+	SceneManager* pScene = (SceneManager*)data;
+	pScene->BuildVegetationInstances();
+}
+
+/***********************************************************
+ *  TerrainStageJob()
+ *
+ *  Job entry point for the terrain stage of BuildFrame().
+ ***********************************************************/
+void SceneManager::TerrainStageJob(void* data, int first, int last)
+{
+	SceneManager* pScene = (SceneManager*)data;
+	pScene->BuildTerrainNodes();
+}
+
+/***********************************************************
+ *  SubmitFrame()
+ *
+ *  This method is used for drawing the static objects -
+ *  GPU driven or batched - then the terrain and the
+ *  vegetation, and then every recorded draw packet, in
+ *  sorted order.  The static objects, the terrain and the
+ *  plants are opaque, so drawing them first keeps the
+ *  translucent packets last.  It must run on the thread that owns the OpenGL
+ *  context.
+ ***********************************************************/
+void SceneManager::SubmitFrame(const FRAME_DATA& frame)
+{
+	if (NULL == m_pShaderManager)
+	{
+		return;
+	}
+
+	// the first draw of the frame always sets everything
+	SUBMIT_STATE state;
+	state.bFirstDraw = true;
+	state.textureSlot = -1;
+	state.materialIndex = -1;
+	state.color = glm::vec4(0.0f);
+	state.UVscale = glm::vec2(0.0f);
+
+	// the GPU driven objects are culled on the GPU and drawn
+	// one multi-draw per group, with the model matrices, the
+	// texture regions and the texture scales taken from their
+	// per-instance attributes
+	if ((nullptr != m_pGpuScene) && (m_pGpuScene->GetGroupCount() > 0))
+	{
+		GLDebug::PushGroup("gpu driven objects");
+		m_pGpuScene->Cull(frame.projection * frame.view, frame.viewPosition);
+		m_pShaderManager->use();
+
+		// the instance matrix is applied on top of the model
+		// uniform, which is left out here
+		m_pShaderManager->setMat4Value(m_uniforms.model, glm::mat4(1.0f));
+		m_pShaderManager->setIntValue(m_uniforms.useObjectModel, true);
+		m_pShaderManager->setIntValue(m_uniforms.useObjectTexture, true);
+		for (int i = 0; i < m_pGpuScene->GetGroupCount(); i++)
+		{
+			const GPU_DRAW_GROUP& group = m_pGpuScene->GetGroup(i);
+			ApplyDrawState(state, group.textureSlot, group.materialIndex, group.color, glm::vec2(1.0f));
+			m_pGpuScene->DrawGroup(i);
+		}
+		m_pShaderManager->setIntValue(m_uniforms.useObjectModel, false);
+		m_pShaderManager->setIntValue(m_uniforms.useObjectTexture, false);
+		GLDebug::PopGroup();
+	}
+
+	// batches changed since the last frame are rebuilt first,
+	// which does nothing while the static objects are unchanged
+	GLDebug::PushGroup("static batches");
+	m_pStaticBatcher->Update();
+
+	// static batch vertices are already in world space
+	if (m_pStaticBatcher->GetBatchCount() > 0)
+	{
+		m_pShaderManager->setMat4Value(m_uniforms.model, glm::mat4(1.0f));
+	}
+	for (int i = 0; i < m_pStaticBatcher->GetBatchCount(); i++)
+	{
+		const STATIC_BATCH& batch = m_pStaticBatcher->GetBatch(i);
+		if (batch.indexCount == 0)
+		{
+			continue;
+		}
+		// batches hidden by the occluders were marked when the
+		// frame was built
+		if (((size_t)i < frame.staticBatchVisibility.size()) && (frame.staticBatchVisibility[i] == 0))
+		{
+			continue;
+		}
+
+		ApplyDrawState(state, batch.textureSlot, batch.materialIndex, batch.color, batch.UVscale);
+		m_pStaticBatcher->DrawBatch(i);
+	}
+	GLDebug::PopGroup();
+
+	// the terrain chunks are one instanced draw of the shared
+	// grid, placed by the vertex shader
+	if ((nullptr != m_pTerrain) && !frame.terrainNodes.empty())
+	{
+		GLDebug::PushGroup("terrain");
+		m_pTerrain->UploadNodes(frame.terrainNodes);
+		ApplyDrawState(state, m_terrainTextureSlot, m_terrainMaterialIndex, m_terrainColor, glm::vec2(1.0f));
+		m_pTerrain->Draw(m_terrainTextureUnit);
+		GLDebug::PopGroup();
+	}
+
+	// plants near the camera are drawn with their geometry,
+	// one instanced draw per part of a species, with the model
+	// uniform holding the placement of the part in the plant,
+	// and the far plants as impostors with one draw for all
+	if ((nullptr != m_pVegetation) && (!frame.vegetationInstances.empty() || !frame.vegetationImpostors.empty()))
+	{
+		GLDebug::PushGroup("vegetation");
+		m_pVegetation->UploadInstances(frame.vegetationInstances, frame.vegetationImpostors);
+
+		m_pShaderManager->setIntValue(m_uniforms.useObjectModel, true);
+		for (size_t species = 0; species < frame.vegetationRanges.size(); species++)
+		{
+			const VEGETATION_RANGE& range = frame.vegetationRanges[species];
+			if (range.instanceCount == 0)
+			{
+				continue;
+			}
+
+			m_pVegetation->BindInstances(range.firstInstance);
+			for (int part = 0; part < m_pVegetation->GetPartCount((int)species); part++)
+			{
+				const VEGETATION_PART& drawnPart = m_pVegetation->GetPart((int)species, part);
+				ApplyDrawState(state, drawnPart.textureSlot, drawnPart.materialIndex, drawnPart.color, drawnPart.UVscale);
+				m_pShaderManager->setMat4Value(m_uniforms.model, drawnPart.localMatrix);
+				m_pVegetation->DrawPart((int)species, part, (GLsizei)range.instanceCount);
+			}
+		}
+		m_pShaderManager->setIntValue(m_uniforms.useObjectModel, false);
+
+		m_pVegetation->DrawImpostors(frame.view, frame.projection, m_impostorTextureUnit);
+		m_pShaderManager->use();
+		GLDebug::PopGroup();
+	}
+
+	// the particles are advanced by the time of the frame and
+	// drawn with their own programs, all on the GPU
+	if (nullptr != m_pParticles)
+	{
+		GLDebug::PushGroup("particles");
+		m_pParticles->Update(frame.frameSeconds);
+		m_pParticles->Draw(frame.view, frame.projection);
+		m_pShaderManager->use();
+		GLDebug::PopGroup();
+	}
+
+	GLDebug::PushGroup("draw packets");
+
+	for (uint64_t key : frame.sortKeys)
+	{
+		const DRAW_PACKET& packet = frame.drawPackets[(size_t)(key & g_SortIndexMask)];
+
+		m_pShaderManager->setMat4Value(m_uniforms.model, packet.modelMatrix);
+		ApplyDrawState(state, packet.textureSlot, packet.materialIndex, packet.color, packet.UVscale);
+
+		m_basicMeshes->DrawMesh(packet.mesh);
+	}
+	GLDebug::PopGroup();
+}
+
+/***********************************************************
+ *  UpdateTextureStreaming()
+ *
+ *  This method is used for handing the levels the frame
+ *  needs to the texture streamer, which uploads the levels
+ *  it has loaded and queues the ones still missing.  It
+ *  runs outside of SubmitFrame(), which must not allocate.
+ ***********************************************************/
+void SceneManager::UpdateTextureStreaming(const FRAME_DATA& frame)
+{
+	if (nullptr == m_pTextureStreamer)
+	{
+		return;
+	}
+
+	GLDebug::PushGroup("texture streaming");
+	m_pTextureStreamer->Update(frame.textureLevels.begin(), (int)frame.textureLevels.size());
+	GLDebug::PopGroup();
+}
+
+/***********************************************************
+ *  GetTextureStreamingStats()
+ *
+ *  This method is used for getting the residency of the
+ *  streamed scene textures.
+ ***********************************************************/
+TEXTURE_STREAMING_STATS SceneManager::GetTextureStreamingStats()
+{
+	if (nullptr == m_pTextureStreamer)
+	{
+		return(TEXTURE_STREAMING_STATS());
+	}
+	return(m_pTextureStreamer->GetStats());
+}
+
+/***********************************************************
+ *  ReleaseScene()
+ *
+ *  This method is used for freeing the OpenGL resources of
+ *  the scene while the context is still current.
+ ***********************************************************/
+void SceneManager::ReleaseScene()
+{
+	GpuMemory::SetEvictFunction(nullptr, nullptr);
+	m_pStaticBatcher->Clear();
+	if (nullptr != m_pGpuScene)
+	{
+		m_pGpuScene->Clear();
+		delete m_pGpuScene;
+		m_pGpuScene = nullptr;
+	}
+	if (nullptr != m_pVegetation)
+	{
+		m_pVegetation->Clear();
+		delete m_pVegetation;
+		m_pVegetation = nullptr;
+	}
+	if (nullptr != m_pTerrain)
+	{
+		m_pTerrain->Clear();
+		delete m_pTerrain;
+		m_pTerrain = nullptr;
+	}
+	if (nullptr != m_pParticles)
+	{
+		m_pParticles->Clear();
+		delete m_pParticles;
+		m_pParticles = nullptr;
+	}
+	m_reservedTextureUnits = 0;
+	m_staticObjectIDs.clear();
+	m_objectResources.clear();
+	m_sceneBvh.Clear();
+	m_pickObjects.clear();
+	DestroyGLTextures();
+	delete m_pTextureStreamer;
+	m_pTextureStreamer = nullptr;
 }
@@ -11,8 +11,22 @@
 
 #include "ShaderManager.h"
 #include "ShapeMeshes.h"
+#include "FrameQueue.h"
+#include "JobSystem.h"
+#include "ResourceHandle.h"
+#include "SceneFile.h"
+#include "StaticBatcher.h"
+#include "OcclusionCuller.h"
+#include "GpuDrivenScene.h"
+#include "VegetationSystem.h"
+#include "TerrainSystem.h"
+#include "ParticleSystem.h"
+#include "SceneBvh.h"
+#include "TextureStreamer.h"
 
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 /***********************************************************
@@ -31,8 +45,16 @@ public:
 
 	struct TEXTURE_INFO
 	{
-		std::string tag;
+		TextureHandle handle;
 		uint32_t ID;
+		// index of the texture in the texture streamer, which is
+		// also the texture unit it is bound to
+		int streamIndex;
+		// part of the streamed texture the image takes, offset in
+		// x y and scale in z w - all of it unless it shares an atlas
+		glm::vec4 region;
+		// larger side of the image, in texels
+		int size;
 	};
 
 	struct OBJECT_MATERIAL
@@ -42,7 +64,7 @@ public:
 		glm::vec3 diffuseColor;
 		glm::vec3 specularColor;
 		float shininess;
-		std::string tag;
+		MaterialHandle handle;
 	};
 
 private:
@@ -56,18 +78,212 @@ private:
 	TEXTURE_INFO m_textureIDs[16];
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// loaded scene description
+	SceneFile m_sceneFile;
+	// registered resources - texture slot, material index and
+	// mesh type by handle
+	ResourceTable<TextureHandle, int, 32> m_textureSlots;
+	ResourceTable<MaterialHandle, int, 64> m_materialIndices;
+	ResourceTable<MeshHandle, ShapeMeshes::MESH_TYPE, 32> m_meshTypes;
+	// kind and hash of every unknown handle reported so far, so
+	// that each one is only reported once
+	std::set<std::pair<std::string, uint32_t>> m_reportedUnknownHandles;
+	// texture slot, material index and mesh of every scene object,
+	// resolved from its handles when the scene is loaded - an
+	// object using a handle that is not registered is left out
+	struct OBJECT_RESOURCES
+	{
+		bool bValid;
+		// -1 when the object is not textured
+		int textureSlot;
+		// -1 when the object keeps the material of the one before
+		int materialIndex;
+		ShapeMeshes::MESH_TYPE mesh;
+	};
+	std::vector<OBJECT_RESOURCES> m_objectResources;
+	// one bit per basic mesh that has been loaded
+	uint32_t m_loadedMeshMask;
+	// merged buffers of the static scene objects
+	StaticBatcher* m_pStaticBatcher;
+	// static objects culled and drawn by the GPU, or null
+	// when the context cannot, in which case they are batched
+	GpuDrivenScene* m_pGpuScene;
+	// plants scattered over the ground and drawn instanced,
+	// or null when the scene has no vegetation
+	VegetationSystem* m_pVegetation;
+	// texture unit of the impostor atlas
+	GLint m_impostorTextureUnit;
+	// ground of the scene, or null when the scene has no
+	// terrain, with the texture unit of its heights and the
+	// shader state it is drawn with
+	TerrainSystem* m_pTerrain;
+	GLint m_terrainTextureUnit;
+	int m_terrainTextureSlot;
+	int m_terrainMaterialIndex;
+	glm::vec4 m_terrainColor;
+	// falling leaves and other particle effects, simulated and
+	// drawn by the GPU, or null when the scene has none
+	ParticleSystem* m_pParticles;
+	// texture units taken after the scene textures by the
+	// systems that bind their own textures
+	int m_reservedTextureUnits;
+	// loads the larger mipmaps of the scene textures when
+	// the objects using them come close enough to need them
+	TextureStreamer* m_pTextureStreamer;
+	// world bounding sphere of every textured scene object,
+	// with the texels its texture is stretched over across
+	// the sphere, to size the texture on screen
+	struct TEXTURE_FOOTPRINT
+	{
+		glm::vec3 center;
+		float radius;
+		int streamIndex;
+		float texels;
+	};
+	std::vector<TEXTURE_FOOTPRINT> m_textureFootprints;
+	// streamed textures of the terrain, the vegetation and
+	// the particles, which have no bounds of their own and
+	// always ask for their top level
+	std::vector<int> m_fullResolutionTextures;
+	// static object ID of every scene object, or -1
+	// for objects that are recorded as draw packets
+	std::vector<int> m_staticObjectIDs;
+	// depth pyramid of the occluder objects, rebuilt for the
+	// camera of every frame on the main thread
+	OcclusionCuller m_occlusionCuller;
+	// object space bounds of every loaded basic mesh
+	OCCLUSION_BOUNDS m_meshBounds[ShapeMeshes::MESH_TYPE_COUNT];
+	// hierarchy over the world bounds of the scene objects,
+	// with the scene object and the shape each of its objects
+	// is tested with when picking
+	struct PICK_OBJECT
+	{
+		int sceneObject;
+		ShapeMeshes::MESH_TYPE mesh;
+		glm::mat4 inverseModel;
+	};
+	SceneBvh m_sceneBvh;
+	std::vector<PICK_OBJECT> m_pickObjects;
+	// object space triangles of every loaded basic mesh, three
+	// corners per triangle
+	std::vector<glm::vec3> m_meshTriangles[ShapeMeshes::MESH_TYPE_COUNT];
+	// world space bounds of every static batch, copied when
+	// the batches are built so the main thread can test them
+	std::vector<OCCLUSION_BOUNDS> m_staticBatchBounds;
+	// frame currently being recorded on the main thread
+	FRAME_DATA* m_pCurrentFrame;
+	// draw state collected by the Set* methods for the next
+	// recorded draw packet
+	DRAW_PACKET m_pendingPacket;
+
+	// transformation values recorded for a draw packet, which
+	// are turned into its model matrix in a parallel stage
+	struct TRANSFORM_INPUT
+	{
+		glm::vec3 scaleXYZ;
+		glm::vec3 rotationDegrees;
+		glm::vec3 positionXYZ;
+	};
+	TRANSFORM_INPUT m_pendingTransform;
+	// one entry per draw packet of the frame being recorded
+	std::vector<TRANSFORM_INPUT> m_transformInputs;
+
+	// range body handed to the job system for composing the
+	// model matrices of the recorded draw packets
+	struct COMPOSE_RANGE
+	{
+		SceneManager* pScene;
+		void operator()(int first, int last) const
+		{
+			pScene->ComposeTransformations(first, last);
+		}
+	};
+	COMPOSE_RANGE m_composeBody;
+
+	// range body handed to the job system for testing the
+	// sorted draw packets against the depth pyramid
+	struct CULL_RANGE
+	{
+		SceneManager* pScene;
+		void operator()(int first, int last) const
+		{
+			pScene->CullDrawPackets(first, last);
+		}
+	};
+	CULL_RANGE m_cullBody;
+
+	// job system the per-frame CPU work is spread over
+	JobSystem* m_pJobSystem;
+	// counter of the transformation stage of the current frame
+	JobCounter* m_pComposeDone;
+
+	// uniform locations looked up once after the shaders are
+	// loaded, so that submitting a frame needs no name lookups
+	struct SCENE_UNIFORMS
+	{
+		GLint model;
+		GLint useObjectModel;
+		GLint useTexture;
+		GLint texture;
+		GLint color;
+		GLint UVscale;
+		GLint textureRegion;
+		GLint useObjectTexture;
+		GLint materialAmbientColor;
+		GLint materialAmbientStrength;
+		GLint materialDiffuseColor;
+		GLint materialSpecularColor;
+		GLint materialShininess;
+	};
+	SCENE_UNIFORMS m_uniforms;
+
+	// shader state left by the previous draw of the frame
+	// being submitted, used to skip redundant uniform sets
+	struct SUBMIT_STATE
+	{
+		bool bFirstDraw;
+		int textureSlot;
+		int materialIndex;
+		glm::vec4 color;
+		glm::vec2 UVscale;
+	};
 
 	// load texture images and convert to OpenGL texture data
-	bool CreateGLTexture(const char* filename, std::string tag);
+	bool CreateGLTexture(const char* filename, TextureHandle handle);
+	// pack the small scene textures into shared atlases, and
+	// mark the textures that were loaded that way
+	void LoadTextureAtlases(std::vector<bool>& loadedTextures);
+	// give a streamed texture, or its region of an atlas, the
+	// next texture slot
+	bool RegisterTexture(TextureHandle handle, int streamIndex, const glm::vec4& region, int size);
 	// bind loaded OpenGL textures to slots in memory
 	void BindGLTextures();
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
-	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
-	// find a defined material by tag
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	// keep every mipmap of the texture in a slot resident
+	void KeepFullResolution(int textureSlot);
+	// find the slot of a loaded texture by handle
+	int FindTextureSlot(TextureHandle handle);
+	// find the index of a defined material by handle
+	int FindMaterialIndex(MaterialHandle handle);
+	// load the meshes used by the scene file
+	void LoadSceneMeshes();
+	// add a material to the defined materials
+	bool RegisterMaterial(const OBJECT_MATERIAL& material);
+	// load a basic mesh and make it available by handle
+	bool RegisterMesh(MeshHandle handle, ShapeMeshes::MESH_TYPE mesh);
+	// report a failed registration, returns true on success
+	bool CheckRegistration(RESOURCE_REGISTER_RESULT result, const char* kind, const char* tag);
+	// report a handle that was used without being registered
+	void ReportUnknownHandle(const char* kind, uint32_t hash, const char* tag);
+	// resolve a handle of the scene file to its registered
+	// resource, reporting the handle when there is none
+	int ResolveTexture(uint32_t hash, uint32_t tagString);
+	int ResolveMaterial(uint32_t hash, uint32_t tagString);
+	bool ResolveMesh(uint32_t hash, uint32_t tagString, ShapeMeshes::MESH_TYPE& mesh);
+	// resolve the handles of every scene object, returns false
+	// when an object had to be left out
+	bool ResolveSceneObjects();
 
 	// set the transformation values 
 	// into the transform buffer
@@ -78,6 +294,76 @@ private:
 		float ZrotationDegrees,
 		glm::vec3 positionXYZ);
 
+	// build the model matrix from recorded transformation values
+	static glm::mat4 ComposeModelMatrix(const TRANSFORM_INPUT& transform);
+	// build the model matrices for a range of draw packets
+	void ComposeTransformations(int firstPacket, int lastPacket);
+	// hand the static objects of the scene file to the GPU
+	// driven scene, or merge them into static batches
+	void BuildStaticObjects();
+	// take the next texture unit after the scene textures,
+	// or -1 when none is left
+	GLint ReserveTextureUnit();
+	// generate or load the terrain of the scene file
+	void BuildTerrain();
+	// pick the terrain chunks for the camera of the frame
+	// being built
+	void BuildTerrainNodes();
+	// scatter the vegetation of the scene file and bake the
+	// impostors of its species
+	void BuildVegetation();
+	// draw every species into the impostor atlas
+	void BakeImpostors();
+	// create the particle effects of the scene file
+	void BuildParticles();
+	// sort the plants into geometry and impostor instances
+	// for the camera of the frame being built
+	void BuildVegetationInstances();
+	// collect the occluder objects and the mesh bounds used
+	// for occlusion culling
+	void BuildOcclusionData();
+	// build the hierarchy of the scene objects for picking,
+	// and the texture footprints from the same bounds
+	void BuildSceneBvh();
+	// work out the finest mipmap every streamed texture needs
+	// for the camera of the frame being built
+	void BuildTextureLevels();
+	// exact test of a ray against one picked object
+	static bool IntersectPickObject(
+		void* data,
+		int objectID,
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float& distance);
+	// rasterize the occluders for the camera of the frame and
+	// test the static batches against them
+	void RenderOcclusionDepth();
+	// mark the sort keys in the passed in range whose packets
+	// are hidden by the occluders
+	void CullDrawPackets(int firstKey, int lastKey);
+	// drop the marked sort keys, keeping the sorted order
+	void RemoveCulledSortKeys();
+	// set the shader values of one draw that differ from the
+	// values left by the previous draw
+	void ApplyDrawState(
+		SUBMIT_STATE& state,
+		int textureSlot,
+		int materialIndex,
+		const glm::vec4& color,
+		const glm::vec2& UVscale);
+	// build and sort the submission order of the draw packets
+	void SortDrawPackets();
+	// look up the uniform locations used by SubmitFrame()
+	void CacheUniformLocations();
+
+	// job entry points for the stages of BuildFrame()
+	static void RecordStageJob(void* data, int first, int last);
+	static void ComposeStageJob(void* data, int first, int last);
+	static void SortStageJob(void* data, int first, int last);
+	static void OcclusionStageJob(void* data, int first, int last);
+	static void VegetationStageJob(void* data, int first, int last);
+	static void TerrainStageJob(void* data, int first, int last);
+
 	// set the color values into the shader
 	void SetShaderColor(
 		float redColorValue,
@@ -85,26 +371,60 @@ private:
 		float blueColorValue,
 		float alphaValue);
 
-	// set the texture data into the shader
+	// set the texture in the passed in slot into the shader
 	void SetShaderTexture(
-		std::string textureTag);
+		int textureSlot);
 
 	// set the UV scale for the texture mapping
 	void SetTextureUVScale(
 		float u, float v);
 
-	// set the object material into the shader
+	// set the material at the passed in index into the shader
 	void SetShaderMaterial(
-		std::string materialTag);
+		int materialIndex);
+
+	// record a draw of the passed in mesh with the current
+	// transformation, texture and material settings
+	void AddDrawPacket(
+		ShapeMeshes::MESH_TYPE mesh);
 
 public:
 
 	// The following methods are for the students to 
 	// customize for their own 3D scene
-	void PrepareScene();
+	bool PrepareScene();
 	void RenderScene();
+
+	// load the scene file, compiling it first when needed
+	static bool LoadSceneFile(SceneFile& sceneFile);
+	// the text scene the scene file is compiled from
+	static const char* GetSceneTextFile();
+	// set the job system used for the per-frame CPU work
+	void SetJobSystem(JobSystem* pJobSystem);
+	// record the draw packets for one frame - called on the main thread
+	void BuildFrame(FRAME_DATA& frame);
+	// issue the recorded draw packets - called on the render thread
+	void SubmitFrame(const FRAME_DATA& frame);
+	// load and drop the texture mipmaps the frame needs - called
+	// on the render thread before the frame is submitted
+	void UpdateTextureStreaming(const FRAME_DATA& frame);
+	// find the scene object a ray hits first, returns its index
+	// in the scene file, or -1 when none is hit before the passed
+	// in distance - called on the main thread
+	int PickObject(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance);
+	// particles alive a few frames ago, or -1 when the scene
+	// has no particle effects
+	int GetParticleCount() const;
+	// residency of the streamed scene textures - called on
+	// the main thread
+	TEXTURE_STREAMING_STATS GetTextureStreamingStats();
+	// free the OpenGL resources of the scene - called on the
+	// render thread before the context is released
+	void ReleaseScene();
 	//load all of the needed textures before rendering
 	void LoadSceneTextures();
 	void DefineObjectMaterials();
 	void SetupSceneLights();
+	// load the scene shaders for the lights of the scene file
+	bool LoadSceneShaders();
 };
\ No newline at end of file
@@ -0,0 +1,108 @@
+///////////////////////////////////////////////////////////////////////////////
+// sceneutilities.cpp
+// ============
+// helpers shared by the systems that build their own buffers and cull
+// their own objects - CPU copies of the basic meshes, and the planes of
+// the view frustum
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneUtilities.h"
+
+/***********************************************************
+ *  MeshSourceCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MeshSourceCache::MeshSourceCache(const ShapeMeshes* pMeshes)
+{
+	m_pMeshes = pMeshes;
+
+	for (int i = 0; i < ShapeMeshes::MESH_TYPE_COUNT; i++)
+	{
+		m_sources[i].bFetched = false;
+		m_sources[i].bLoaded = false;
+	}
+}
+
+/***********************************************************
+ *  GetMeshSource()
+ *
+ *  This method is used for getting the CPU copy of a basic
+ *  mesh.  The copy is fetched from the shape meshes the
+ *  first time the mesh is used.
+ ***********************************************************/
+const MESH_SOURCE* MeshSourceCache::GetMeshSource(ShapeMeshes::MESH_TYPE mesh)
+{
+	MESH_SOURCE& source = m_sources[mesh];
+
+	if (source.bFetched == false)
+	{
+		source.bLoaded = m_pMeshes->GetMeshGeometry(mesh, source.vertices, source.indices);
+		source.bFetched = true;
+	}
+
+	return(source.bLoaded ? &source : nullptr);
+}
+
+/***********************************************************
+ *  FindMeshSource()
+ *
+ *  This method is used for getting the CPU copy of a basic
+ *  mesh without fetching it, so that only the meshes used
+ *  so far are found.
+ ***********************************************************/
+const MESH_SOURCE* MeshSourceCache::FindMeshSource(ShapeMeshes::MESH_TYPE mesh) const
+{
+	const MESH_SOURCE& source = m_sources[mesh];
+
+	return(source.bLoaded ? &source : nullptr);
+}
+
+/***********************************************************
+ *  ReleaseGeometry()
+ *
+ *  This method is used for freeing the CPU copies of the
+ *  meshes once their GPU buffers have been filled.
+ ***********************************************************/
+void MeshSourceCache::ReleaseGeometry()
+{
+	for (int i = 0; i < ShapeMeshes::MESH_TYPE_COUNT; i++)
+	{
+		std::vector<GLfloat>().swap(m_sources[i].vertices);
+		std::vector<GLuint>().swap(m_sources[i].indices);
+	}
+}
+
+/***********************************************************
+ *  ExtractFrustumPlanes()
+ *
+ *  This function is used for getting the six planes of the
+ *  view frustum from the rows of the view projection
+ *  matrix, as left, right, bottom, top, near and far.  A
+ *  point is inside a plane when the dot product with the
+ *  point, with w set to 1, is not negative.
+ ***********************************************************/
+void ExtractFrustumPlanes(const glm::mat4& viewProjection, bool bNormalize, glm::vec4 planes[6])
+{
+	glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+	glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+	glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+	glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+	planes[0] = row3 + row0;
+	planes[1] = row3 - row0;
+	planes[2] = row3 + row1;
+	planes[3] = row3 - row1;
+	planes[4] = row3 + row2;
+	planes[5] = row3 - row2;
+
+	if (bNormalize)
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			planes[i] /= glm::length(glm::vec3(planes[i]));
+		}
+	}
+}
@@ -0,0 +1,67 @@
+///////////////////////////////////////////////////////////////////////////////
+// sceneutilities.h
+// ============
+// helpers shared by the systems that build their own buffers and cull
+// their own objects - CPU copies of the basic meshes, and the planes of
+// the view frustum
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShapeMeshes.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  MESH_SOURCE
+ *
+ *  CPU copy of the vertices and indices of a basic mesh.
+ ***********************************************************/
+struct MESH_SOURCE
+{
+	bool bFetched;
+	bool bLoaded;
+	std::vector<GLfloat> vertices;
+	std::vector<GLuint> indices;
+};
+
+/***********************************************************
+ *  MeshSourceCache
+ *
+ *  Fetches the CPU copy of every basic mesh from the shape
+ *  meshes the first time it is asked for, and keeps it, so
+ *  that a system merging many objects of the same mesh
+ *  reads the mesh back only once.
+ ***********************************************************/
+class MeshSourceCache
+{
+public:
+	// constructor
+	MeshSourceCache(const ShapeMeshes* pMeshes);
+
+	// get the CPU copy of a mesh, fetching it the first time,
+	// or null when the mesh is not loaded
+	const MESH_SOURCE* GetMeshSource(ShapeMeshes::MESH_TYPE mesh);
+	// get the CPU copy of a mesh that was fetched before, or
+	// null when it was not fetched or is not loaded
+	const MESH_SOURCE* FindMeshSource(ShapeMeshes::MESH_TYPE mesh) const;
+	// free the CPU copies once they have been uploaded, which
+	// leaves the meshes marked as loaded
+	void ReleaseGeometry();
+
+private:
+	const ShapeMeshes* m_pMeshes;
+	MESH_SOURCE m_sources[ShapeMeshes::MESH_TYPE_COUNT];
+};
+
+// planes of the view frustum from the rows of a view projection
+// matrix, pointing inwards - normalized when distances to them
+// are compared, such as sphere radii, and not when only the side
+// of a point is tested
+void ExtractFrustumPlanes(const glm::mat4& viewProjection, bool bNormalize, glm::vec4 planes[6]);
@@ -0,0 +1,824 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerasterizer.cpp
+// ============
+// tile based rasterizer of the scene file on the CPU, spread over all of the
+// cores by the job system, for rendering on machines without a GPU
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SoftwareRasterizer.h"
+#include "ShapeMeshes.h"
+#include "ImageWriter.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	// clear color of the scene window
+	const glm::vec3 g_BackgroundColor(0.0f, 0.0f, 1.0f);
+	// triangle ID of the pixels no opaque triangle covers
+	const uint32_t g_NoTriangle = 0xFFFFFFFFu;
+
+	// largest integer not above a / b, for negative a too
+	int64_t FloorDivide(int64_t a, int64_t b)
+	{
+		int64_t quotient = a / b;
+		if (((a % b) != 0) && ((a < 0) != (b < 0)))
+		{
+			quotient--;
+		}
+		return quotient;
+	}
+
+	float EvaluatePlane(const float* plane, float x, float y)
+	{
+		return plane[0] * x + plane[1] * y + plane[2];
+	}
+
+	bool HasExtension(const char* filename, const char* extension)
+	{
+		std::string name(filename);
+		std::string suffix(extension);
+		if (name.size() < suffix.size())
+		{
+			return false;
+		}
+		std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+		return (name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0);
+	}
+}
+
+/***********************************************************
+ *  SoftwareRasterizer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SoftwareRasterizer::SoftwareRasterizer(JobSystem* pJobSystem)
+{
+	m_pJobSystem = pJobSystem;
+	std::memset(&m_view, 0, sizeof(m_view));
+	m_viewProjection = glm::mat4(1.0f);
+	m_tilesPerRow = 0;
+	m_tileCount = 0;
+}
+
+/***********************************************************
+ *  ~SoftwareRasterizer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SoftwareRasterizer::~SoftwareRasterizer()
+{
+}
+
+/***********************************************************
+ *  BuildScene()
+ *
+ *  This method is used for moving the vertices of every
+ *  instance of the scene geometry into the world once, so
+ *  a frame only has to project them.  The normals are kept
+ *  as the meshes have them, because the scene shader does
+ *  not transform them either.
+ ***********************************************************/
+bool SoftwareRasterizer::BuildScene(const SceneFile& sceneFile)
+{
+	m_vertices.clear();
+	m_indices.clear();
+	m_triangleSurfaces.clear();
+	m_surfaces.clear();
+	m_lights.clear();
+
+	if (m_geometry.Build(sceneFile) == false)
+	{
+		return false;
+	}
+
+	const std::vector<GEOMETRY_MESH>& meshes = m_geometry.GetMeshes();
+	m_indices.reserve(m_geometry.GetTriangleCount() * 3);
+	m_triangleSurfaces.reserve(m_geometry.GetTriangleCount());
+	for (const GEOMETRY_INSTANCE& instance : m_geometry.GetInstances())
+	{
+		const GEOMETRY_MESH& mesh = meshes[instance.mesh];
+		uint32_t firstVertex = (uint32_t)m_vertices.size();
+		for (size_t i = 0; i + ShapeMeshes::FLOATS_PER_MESH_VERTEX <= mesh.vertices.size(); i += ShapeMeshes::FLOATS_PER_MESH_VERTEX)
+		{
+			const float* vertex = &mesh.vertices[i];
+			RASTER_VERTEX rasterVertex;
+			rasterVertex.position = glm::vec3(instance.modelMatrix * glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f));
+			rasterVertex.normal = glm::vec3(vertex[3], vertex[4], vertex[5]);
+			rasterVertex.textureCoordinate = glm::vec2(vertex[6], vertex[7]);
+			m_vertices.push_back(rasterVertex);
+		}
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		{
+			m_indices.push_back(firstVertex + mesh.indices[i]);
+			m_indices.push_back(firstVertex + mesh.indices[i + 1]);
+			m_indices.push_back(firstVertex + mesh.indices[i + 2]);
+			m_triangleSurfaces.push_back(instance.surface);
+		}
+	}
+
+	const std::vector<GEOMETRY_MATERIAL>& materials = m_geometry.GetMaterials();
+	for (const GEOMETRY_SURFACE& geometrySurface : m_geometry.GetSurfaces())
+	{
+		SHADE_SURFACE surface;
+		surface.texture = geometrySurface.texture;
+		surface.color = geometrySurface.color;
+		surface.diffuseColor = glm::vec3(0.0f);
+		surface.specularColor = glm::vec3(0.0f);
+		surface.shininess = 0.0f;
+		if (geometrySurface.material >= 0)
+		{
+			surface.diffuseColor = materials[geometrySurface.material].diffuseColor;
+			surface.specularColor = materials[geometrySurface.material].specularColor;
+			surface.shininess = materials[geometrySurface.material].shininess;
+		}
+		surface.bOpaque = geometrySurface.bOpaque;
+		m_surfaces.push_back(surface);
+	}
+
+	m_lights = m_geometry.GetLights();
+
+	std::cout << "INFO: Software rasterizer scene - " << m_vertices.size() << " vertices and "
+		<< m_triangleSurfaces.size() << " triangles" << std::endl;
+
+	return true;
+}
+
+/***********************************************************
+ *  RenderImage()
+ *
+ *  This method is used for rendering one frame of the
+ *  scene, with the projection of the view manager, and
+ *  writing it to the passed in file.  The time of every
+ *  stage is reported, for the performance checks.
+ ***********************************************************/
+bool SoftwareRasterizer::RenderImage(const RENDER_VIEW& view, const char* filename)
+{
+	if ((view.width <= 0) || (view.height <= 0))
+	{
+		std::cout << "ERROR: The software rasterizer needs a size above 0" << std::endl;
+		return false;
+	}
+	if (m_triangleSurfaces.empty())
+	{
+		std::cout << "ERROR: The software rasterizer has no scene to render" << std::endl;
+		return false;
+	}
+
+	m_view = view;
+	glm::mat4 viewMatrix = glm::lookAt(view.cameraPosition, view.cameraPosition + view.cameraFront, view.cameraUp);
+	glm::mat4 projection = glm::perspective(glm::radians(view.fieldOfView), (float)view.width / (float)view.height, view.nearPlane, view.farPlane);
+	m_viewProjection = projection * viewMatrix;
+
+	m_tilesPerRow = (view.width + TILE_SIZE - 1) / TILE_SIZE;
+	m_tileCount = m_tilesPerRow * ((view.height + TILE_SIZE - 1) / TILE_SIZE);
+	m_clipPositions.resize(m_vertices.size());
+	m_colors.resize((size_t)view.width * view.height);
+	int vertexJobs = (int)((m_vertices.size() + VERTICES_PER_JOB - 1) / VERTICES_PER_JOB);
+	int chunkCount = (int)((m_triangleSurfaces.size() + TRIANGLES_PER_CHUNK - 1) / TRIANGLES_PER_CHUNK);
+	m_chunks.resize(chunkCount);
+
+	VERTEX_RANGE vertexBody;
+	vertexBody.pRasterizer = this;
+	BIN_RANGE binBody;
+	binBody.pRasterizer = this;
+	TILE_RANGE tileBody;
+	tileBody.pRasterizer = this;
+
+	std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+	m_pJobSystem->ParallelFor(0, vertexJobs, 1, vertexBody);
+	std::chrono::steady_clock::time_point verticesDone = std::chrono::steady_clock::now();
+	m_pJobSystem->ParallelFor(0, chunkCount, 1, binBody);
+	std::chrono::steady_clock::time_point binningDone = std::chrono::steady_clock::now();
+	m_pJobSystem->ParallelFor(0, m_tileCount, 1, tileBody);
+	std::chrono::steady_clock::time_point tilesDone = std::chrono::steady_clock::now();
+
+	size_t setupCount = 0;
+	for (const BIN_CHUNK& chunk : m_chunks)
+	{
+		setupCount += chunk.triangles.size();
+	}
+
+	typedef std::chrono::duration<double, std::milli> MILLISECONDS;
+	std::cout << "INFO: Software rasterized " << view.width << "x" << view.height << " - "
+		<< setupCount << " of " << m_triangleSurfaces.size() << " triangles set up, vertices "
+		<< MILLISECONDS(verticesDone - frameStart).count() << " ms, binning "
+		<< MILLISECONDS(binningDone - verticesDone).count() << " ms, tiles "
+		<< MILLISECONDS(tilesDone - binningDone).count() << " ms, frame "
+		<< MILLISECONDS(tilesDone - frameStart).count() << " ms" << std::endl;
+
+	return WriteImage(filename);
+}
+
+/***********************************************************
+ *  TransformVertices()
+ *
+ *  This method is used for moving one range of the world
+ *  space vertices into clip space.
+ ***********************************************************/
+void SoftwareRasterizer::TransformVertices(int job)
+{
+	size_t first = (size_t)job * VERTICES_PER_JOB;
+	size_t last = std::min(first + VERTICES_PER_JOB, m_vertices.size());
+	for (size_t i = first; i < last; i++)
+	{
+		m_clipPositions[i] = m_viewProjection * glm::vec4(m_vertices[i].position, 1.0f);
+	}
+}
+
+/***********************************************************
+ *  BinTriangles()
+ *
+ *  This method is used for setting up one chunk of the
+ *  triangles.  Triangles outside of the view are dropped,
+ *  and only the triangles that cross the near plane or the
+ *  guard band are clipped, into a fan of triangles that
+ *  keep the weights of the corners of their source.
+ ***********************************************************/
+void SoftwareRasterizer::BinTriangles(int chunkIndex)
+{
+	BIN_CHUNK& chunk = m_chunks[chunkIndex];
+	chunk.triangles.clear();
+	chunk.tileBins.resize(m_tileCount);
+	for (std::vector<uint32_t>& bin : chunk.tileBins)
+	{
+		bin.clear();
+	}
+
+	// the guard band as a fraction of w on the x and y axes
+	float guardX = (float)GUARD_BAND_PIXELS / (m_view.width * 0.5f);
+	float guardY = (float)GUARD_BAND_PIXELS / (m_view.height * 0.5f);
+	const glm::vec4 clipPlanes[5] = {
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),
+		glm::vec4(1.0f, 0.0f, 0.0f, guardX),
+		glm::vec4(-1.0f, 0.0f, 0.0f, guardX),
+		glm::vec4(0.0f, 1.0f, 0.0f, guardY),
+		glm::vec4(0.0f, -1.0f, 0.0f, guardY) };
+
+	size_t first = (size_t)chunkIndex * TRIANGLES_PER_CHUNK;
+	size_t last = std::min(first + TRIANGLES_PER_CHUNK, m_triangleSurfaces.size());
+	for (size_t triangle = first; triangle < last; triangle++)
+	{
+		CLIP_VERTEX corners[3];
+		uint32_t outsideAll = 0x3F;
+		bool bNeedsClipping = false;
+		for (int k = 0; k < 3; k++)
+		{
+			const glm::vec4& position = m_clipPositions[m_indices[triangle * 3 + k]];
+			corners[k].position = position;
+			corners[k].weights = glm::vec3(0.0f);
+			corners[k].weights[k] = 1.0f;
+
+			// the planes of the view volume this corner is outside of
+			uint32_t outside = 0;
+			outside |= (position.x > position.w) ? 0x01 : 0;
+			outside |= (position.x < -position.w) ? 0x02 : 0;
+			outside |= (position.y > position.w) ? 0x04 : 0;
+			outside |= (position.y < -position.w) ? 0x08 : 0;
+			outside |= (position.z > position.w) ? 0x10 : 0;
+			outside |= (position.z < -position.w) ? 0x20 : 0;
+			outsideAll &= outside;
+
+			for (const glm::vec4& plane : clipPlanes)
+			{
+				if (glm::dot(plane, position) < 0.0f)
+				{
+					bNeedsClipping = true;
+				}
+			}
+		}
+		if (outsideAll != 0)
+		{
+			continue;
+		}
+
+		int surface = m_triangleSurfaces[triangle];
+		if (bNeedsClipping == false)
+		{
+			SetupTriangle(chunk, corners, (uint32_t)triangle, surface);
+			continue;
+		}
+
+		// each plane adds at most one corner to the polygon
+		CLIP_VERTEX polygon[9];
+		CLIP_VERTEX clipped[9];
+		int polygonCount = 3;
+		std::copy(corners, corners + 3, polygon);
+		for (const glm::vec4& plane : clipPlanes)
+		{
+			int clippedCount = 0;
+			for (int k = 0; k < polygonCount; k++)
+			{
+				const CLIP_VERTEX& current = polygon[k];
+				const CLIP_VERTEX& next = polygon[(k + 1) % polygonCount];
+				float currentDistance = glm::dot(plane, current.position);
+				float nextDistance = glm::dot(plane, next.position);
+				if (currentDistance >= 0.0f)
+				{
+					clipped[clippedCount++] = current;
+				}
+				if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+				{
+					float t = currentDistance / (currentDistance - nextDistance);
+					clipped[clippedCount].position = glm::mix(current.position, next.position, t);
+					clipped[clippedCount].weights = glm::mix(current.weights, next.weights, t);
+					clippedCount++;
+				}
+			}
+			polygonCount = clippedCount;
+			std::copy(clipped, clipped + clippedCount, polygon);
+			if (polygonCount < 3)
+			{
+				break;
+			}
+		}
+
+		for (int k = 1; k + 1 < polygonCount; k++)
+		{
+			CLIP_VERTEX fan[3] = { polygon[0], polygon[k], polygon[k + 1] };
+			SetupTriangle(chunk, fan, (uint32_t)triangle, surface);
+		}
+	}
+}
+
+/***********************************************************
+ *  SetupTriangle()
+ *
+ *  This method is used for snapping a clipped triangle to
+ *  the fixed point grid, building its edge functions and
+ *  interpolation planes, and adding it to the bin of every
+ *  tile its bounds touch.  Triangles are drawn from both
+ *  sides, so the corners are put in one winding, and
+ *  triangles that cover no pixel center are dropped.
+ ***********************************************************/
+void SoftwareRasterizer::SetupTriangle(BIN_CHUNK& chunk, const CLIP_VERTEX* corners, uint32_t sourceTriangle, int surface)
+{
+	int64_t fixedX[3];
+	int64_t fixedY[3];
+	float depth[3];
+	float inverseW[3];
+	for (int k = 0; k < 3; k++)
+	{
+		const glm::vec4& position = corners[k].position;
+		inverseW[k] = 1.0f / position.w;
+		float screenX = (position.x * inverseW[k] * 0.5f + 0.5f) * m_view.width;
+		float screenY = (0.5f - position.y * inverseW[k] * 0.5f) * m_view.height;
+		fixedX[k] = (int64_t)std::floor(screenX * SUBPIXEL_SCALE + 0.5f);
+		fixedY[k] = (int64_t)std::floor(screenY * SUBPIXEL_SCALE + 0.5f);
+		depth[k] = position.z * inverseW[k] * 0.5f + 0.5f;
+	}
+
+	int64_t area = (fixedX[2] - fixedX[1]) * (fixedY[0] - fixedY[1]) - (fixedY[2] - fixedY[1]) * (fixedX[0] - fixedX[1]);
+	if (area == 0)
+	{
+		return;
+	}
+	int order[3] = { 0, 1, 2 };
+	if (area < 0)
+	{
+		order[1] = 2;
+		order[2] = 1;
+		area = -area;
+	}
+
+	// pixels whose centers lie inside of the bounds
+	int64_t boundsMinX = std::min(fixedX[0], std::min(fixedX[1], fixedX[2]));
+	int64_t boundsMinY = std::min(fixedY[0], std::min(fixedY[1], fixedY[2]));
+	int64_t boundsMaxX = std::max(fixedX[0], std::max(fixedX[1], fixedX[2]));
+	int64_t boundsMaxY = std::max(fixedY[0], std::max(fixedY[1], fixedY[2]));
+	const int64_t halfPixel = SUBPIXEL_SCALE / 2;
+	RASTER_TRIANGLE triangle;
+	triangle.minX = (int)std::max<int64_t>(0, FloorDivide(boundsMinX - halfPixel + SUBPIXEL_SCALE - 1, SUBPIXEL_SCALE));
+	triangle.minY = (int)std::max<int64_t>(0, FloorDivide(boundsMinY - halfPixel + SUBPIXEL_SCALE - 1, SUBPIXEL_SCALE));
+	triangle.maxX = (int)std::min<int64_t>(m_view.width - 1, FloorDivide(boundsMaxX - halfPixel, SUBPIXEL_SCALE));
+	triangle.maxY = (int)std::min<int64_t>(m_view.height - 1, FloorDivide(boundsMaxY - halfPixel, SUBPIXEL_SCALE));
+	if ((triangle.minX > triangle.maxX) || (triangle.minY > triangle.maxY))
+	{
+		return;
+	}
+	triangle.originX = triangle.minX;
+	triangle.originY = triangle.minY;
+
+	// edge k lies opposite corner k, so its function divided
+	// by the area is the barycentric weight of that corner
+	double lambdaPlanes[3][3];
+	for (int k = 0; k < 3; k++)
+	{
+		int i = order[(k + 1) % 3];
+		int j = order[(k + 2) % 3];
+		int64_t edgeA = fixedY[i] - fixedY[j];
+		int64_t edgeB = fixedX[j] - fixedX[i];
+		int64_t edgeC = -(edgeA * fixedX[i] + edgeB * fixedY[i]);
+
+		int64_t originValue = edgeA * (triangle.originX * SUBPIXEL_SCALE + halfPixel) + edgeB * (triangle.originY * SUBPIXEL_SCALE + halfPixel) + edgeC;
+		lambdaPlanes[k][0] = (double)(edgeA * SUBPIXEL_SCALE) / (double)area;
+		lambdaPlanes[k][1] = (double)(edgeB * SUBPIXEL_SCALE) / (double)area;
+		lambdaPlanes[k][2] = (double)originValue / (double)area;
+
+		// pixel centers on an edge belong to the triangle only
+		// for top and left edges, so that the triangle on the
+		// other side of the edge does not draw them too
+		if (!((edgeA > 0) || ((edgeA == 0) && (edgeB > 0))))
+		{
+			edgeC -= 1;
+		}
+		triangle.edgeA[k] = (int32_t)edgeA;
+		triangle.edgeB[k] = (int32_t)edgeB;
+		triangle.edgeC[k] = edgeC;
+	}
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		double depthValue = 0.0;
+		double inverseWValue = 0.0;
+		double weightValues[2] = { 0.0, 0.0 };
+		for (int k = 0; k < 3; k++)
+		{
+			int corner = order[k];
+			depthValue += lambdaPlanes[k][axis] * depth[corner];
+			inverseWValue += lambdaPlanes[k][axis] * inverseW[corner];
+			weightValues[0] += lambdaPlanes[k][axis] * corners[corner].weights[0] * inverseW[corner];
+			weightValues[1] += lambdaPlanes[k][axis] * corners[corner].weights[1] * inverseW[corner];
+		}
+		triangle.depthPlane[axis] = (float)depthValue;
+		triangle.inverseWPlane[axis] = (float)inverseWValue;
+		triangle.weightPlanes[0][axis] = (float)weightValues[0];
+		triangle.weightPlanes[1][axis] = (float)weightValues[1];
+	}
+	triangle.minDepth = std::min(depth[0], std::min(depth[1], depth[2]));
+	triangle.sourceTriangle = sourceTriangle;
+	triangle.surface = surface;
+
+	uint32_t triangleIndex = (uint32_t)chunk.triangles.size();
+	chunk.triangles.push_back(triangle);
+	for (int tileY = triangle.minY / TILE_SIZE; tileY <= triangle.maxY / TILE_SIZE; tileY++)
+	{
+		for (int tileX = triangle.minX / TILE_SIZE; tileX <= triangle.maxX / TILE_SIZE; tileX++)
+		{
+			chunk.tileBins[tileY * m_tilesPerRow + tileX].push_back(triangleIndex);
+		}
+	}
+}
+
+/***********************************************************
+ *  RasterizeTile()
+ *
+ *  This method is used for drawing one tile.  The opaque
+ *  triangles of every chunk, in draw order, leave the
+ *  nearest triangle of each pixel, which is then shaded
+ *  once, and the translucent triangles are blended on top
+ *  in the same order.
+ ***********************************************************/
+void SoftwareRasterizer::RasterizeTile(int tile)
+{
+	int tileX = (tile % m_tilesPerRow) * TILE_SIZE;
+	int tileY = (tile / m_tilesPerRow) * TILE_SIZE;
+	int tileWidth = std::min(TILE_SIZE, m_view.width - tileX);
+	int tileHeight = std::min(TILE_SIZE, m_view.height - tileY);
+
+	float depth[TILE_SIZE * TILE_SIZE];
+	uint32_t triangleIDs[TILE_SIZE * TILE_SIZE];
+	float blockMaxDepth[BLOCKS_PER_TILE];
+	std::fill(depth, depth + TILE_SIZE * TILE_SIZE, 1.0f);
+	std::fill(triangleIDs, triangleIDs + TILE_SIZE * TILE_SIZE, g_NoTriangle);
+	std::fill(blockMaxDepth, blockMaxDepth + BLOCKS_PER_TILE, 1.0f);
+
+	// the chunk index is kept in the high bits of the ID
+	for (size_t chunkIndex = 0; chunkIndex < m_chunks.size(); chunkIndex++)
+	{
+		const BIN_CHUNK& chunk = m_chunks[chunkIndex];
+		for (uint32_t triangleIndex : chunk.tileBins[tile])
+		{
+			const RASTER_TRIANGLE& triangle = chunk.triangles[triangleIndex];
+			if (m_surfaces[triangle.surface].bOpaque)
+			{
+				uint32_t triangleID = ((uint32_t)chunkIndex << 16) | triangleIndex;
+				RasterizeTriangle(triangle, triangleID, tileX, tileY, depth, blockMaxDepth, triangleIDs, nullptr);
+			}
+		}
+	}
+
+	glm::vec3 colors[TILE_SIZE * TILE_SIZE];
+	for (int y = 0; y < tileHeight; y++)
+	{
+		for (int x = 0; x < tileWidth; x++)
+		{
+			int local = y * TILE_SIZE + x;
+			uint32_t triangleID = triangleIDs[local];
+			if (triangleID == g_NoTriangle)
+			{
+				colors[local] = g_BackgroundColor;
+				continue;
+			}
+			const RASTER_TRIANGLE& triangle = m_chunks[triangleID >> 16].triangles[triangleID & 0xFFFF];
+			colors[local] = glm::clamp(glm::vec3(ShadePixel(triangle, tileX + x, tileY + y)), 0.0f, 1.0f);
+		}
+	}
+
+	for (const BIN_CHUNK& chunk : m_chunks)
+	{
+		for (uint32_t triangleIndex : chunk.tileBins[tile])
+		{
+			const RASTER_TRIANGLE& triangle = chunk.triangles[triangleIndex];
+			if (m_surfaces[triangle.surface].bOpaque == false)
+			{
+				RasterizeTriangle(triangle, 0, tileX, tileY, depth, blockMaxDepth, nullptr, colors);
+			}
+		}
+	}
+
+	// every pixel belongs to one tile, so no other job writes it
+	for (int y = 0; y < tileHeight; y++)
+	{
+		std::copy(colors + y * TILE_SIZE, colors + y * TILE_SIZE + tileWidth,
+			m_colors.begin() + (size_t)(tileY + y) * m_view.width + tileX);
+	}
+}
+
+/***********************************************************
+ *  RasterizeTriangle()
+ *
+ *  This method is used for drawing the part of a triangle
+ *  inside of a tile, four pixels of a row at a time.  The
+ *  edges the tile lies fully inside of are left out, which
+ *  also keeps the values of the others within 32 bits, and
+ *  the 8x8 blocks the triangle is behind, or outside of,
+ *  are skipped.  The depth test is less than, as in the
+ *  window, and passing pixels write the depth.
+ ***********************************************************/
+void SoftwareRasterizer::RasterizeTriangle(
+	const RASTER_TRIANGLE& triangle,
+	uint32_t triangleID,
+	int tileX,
+	int tileY,
+	float* depth,
+	float* blockMaxDepth,
+	uint32_t* triangleIDs,
+	glm::vec3* colors) const
+{
+	int x0 = std::max(triangle.minX, tileX);
+	int y0 = std::max(triangle.minY, tileY);
+	int x1 = std::min(triangle.maxX, std::min(tileX + TILE_SIZE, m_view.width) - 1);
+	int y1 = std::min(triangle.maxY, std::min(tileY + TILE_SIZE, m_view.height) - 1);
+	if ((x0 > x1) || (y0 > y1))
+	{
+		return;
+	}
+
+	// the covered blocks, as a rectangle of pixels
+	const int blocksPerRow = TILE_SIZE / BLOCK_SIZE;
+	int blockX0 = (x0 - tileX) / BLOCK_SIZE;
+	int blockY0 = (y0 - tileY) / BLOCK_SIZE;
+	int blockX1 = (x1 - tileX) / BLOCK_SIZE;
+	int blockY1 = (y1 - tileY) / BLOCK_SIZE;
+	int rectX0 = tileX + blockX0 * BLOCK_SIZE;
+	int rectY0 = tileY + blockY0 * BLOCK_SIZE;
+	int rectX1 = tileX + blockX1 * BLOCK_SIZE + BLOCK_SIZE - 1;
+	int rectY1 = tileY + blockY1 * BLOCK_SIZE + BLOCK_SIZE - 1;
+
+	const int64_t halfPixel = SUBPIXEL_SCALE / 2;
+	int32_t edgeStart[3];
+	int32_t stepX[3];
+	int32_t stepY[3];
+	for (int k = 0; k < 3; k++)
+	{
+		int64_t a = triangle.edgeA[k];
+		int64_t b = triangle.edgeB[k];
+		int64_t corner00 = a * (rectX0 * SUBPIXEL_SCALE + halfPixel) + b * (rectY0 * SUBPIXEL_SCALE + halfPixel) + triangle.edgeC[k];
+		int64_t corner10 = corner00 + a * SUBPIXEL_SCALE * (rectX1 - rectX0);
+		int64_t corner01 = corner00 + b * SUBPIXEL_SCALE * (rectY1 - rectY0);
+		int64_t corner11 = corner10 + b * SUBPIXEL_SCALE * (rectY1 - rectY0);
+		if ((corner00 < 0) && (corner10 < 0) && (corner01 < 0) && (corner11 < 0))
+		{
+			return;
+		}
+		if ((corner00 >= 0) && (corner10 >= 0) && (corner01 >= 0) && (corner11 >= 0))
+		{
+			edgeStart[k] = 0;
+			stepX[k] = 0;
+			stepY[k] = 0;
+			continue;
+		}
+		edgeStart[k] = (int32_t)corner00;
+		stepX[k] = (int32_t)(a * SUBPIXEL_SCALE);
+		stepY[k] = (int32_t)(b * SUBPIXEL_SCALE);
+	}
+
+	__m128i laneSteps[3];
+	for (int k = 0; k < 3; k++)
+	{
+		laneSteps[k] = _mm_setr_epi32(0, stepX[k], 2 * stepX[k], 3 * stepX[k]);
+	}
+	float depthStepX = triangle.depthPlane[0];
+	__m128 depthLaneSteps = _mm_setr_ps(0.0f, depthStepX, 2.0f * depthStepX, 3.0f * depthStepX);
+
+	for (int blockY = blockY0; blockY <= blockY1; blockY++)
+	{
+		for (int blockX = blockX0; blockX <= blockX1; blockX++)
+		{
+			int block = blockY * blocksPerRow + blockX;
+			if (triangle.minDepth >= blockMaxDepth[block])
+			{
+				continue;
+			}
+
+			int pixelX = tileX + blockX * BLOCK_SIZE;
+			int pixelY = tileY + blockY * BLOCK_SIZE;
+			int32_t blockStart[3];
+			bool bOutside = false;
+			for (int k = 0; k < 3; k++)
+			{
+				blockStart[k] = edgeStart[k] + stepX[k] * (pixelX - rectX0) + stepY[k] * (pixelY - rectY0);
+				int32_t right = blockStart[k] + stepX[k] * (BLOCK_SIZE - 1);
+				int32_t bottom = blockStart[k] + stepY[k] * (BLOCK_SIZE - 1);
+				int32_t corner = right + stepY[k] * (BLOCK_SIZE - 1);
+				if ((blockStart[k] < 0) && (right < 0) && (bottom < 0) && (corner < 0))
+				{
+					bOutside = true;
+				}
+			}
+			if (bOutside)
+			{
+				continue;
+			}
+
+			bool bWritten = false;
+			for (int row = 0; row < BLOCK_SIZE; row++)
+			{
+				int y = pixelY + row;
+				if ((y < y0) || (y > y1))
+				{
+					continue;
+				}
+				for (int column = 0; column < BLOCK_SIZE; column += 4)
+				{
+					int x = pixelX + column;
+					int laneMask = 0;
+					for (int lane = 0; lane < 4; lane++)
+					{
+						if ((x + lane >= x0) && (x + lane <= x1))
+						{
+							laneMask |= 1 << lane;
+						}
+					}
+					if (laneMask == 0)
+					{
+						continue;
+					}
+
+					__m128i edges = _mm_setzero_si128();
+					for (int k = 0; k < 3; k++)
+					{
+						__m128i edge = _mm_add_epi32(_mm_set1_epi32(blockStart[k] + stepX[k] * column + stepY[k] * row), laneSteps[k]);
+						edges = _mm_or_si128(edges, edge);
+					}
+					int covered = (~_mm_movemask_ps(_mm_castsi128_ps(edges))) & laneMask;
+					if (covered == 0)
+					{
+						continue;
+					}
+
+					int local = (y - tileY) * TILE_SIZE + (x - tileX);
+					float depthStart = EvaluatePlane(triangle.depthPlane, (float)(x - triangle.originX), (float)(y - triangle.originY));
+					__m128 pixelDepth = _mm_add_ps(_mm_set1_ps(depthStart), depthLaneSteps);
+					__m128 storedDepth = _mm_loadu_ps(depth + local);
+					int passed = _mm_movemask_ps(_mm_cmplt_ps(pixelDepth, storedDepth)) & covered;
+					if (passed == 0)
+					{
+						continue;
+					}
+
+					__m128 passedMask = _mm_castsi128_ps(_mm_cmpgt_epi32(
+						_mm_and_si128(_mm_set1_epi32(passed), _mm_setr_epi32(1, 2, 4, 8)), _mm_setzero_si128()));
+					_mm_storeu_ps(depth + local, _mm_or_ps(_mm_and_ps(passedMask, pixelDepth), _mm_andnot_ps(passedMask, storedDepth)));
+					bWritten = true;
+
+					for (int lane = 0; lane < 4; lane++)
+					{
+						if (((passed >> lane) & 1) == 0)
+						{
+							continue;
+						}
+						if (nullptr != triangleIDs)
+						{
+							triangleIDs[local + lane] = triangleID;
+						}
+						else
+						{
+							glm::vec4 color = glm::clamp(ShadePixel(triangle, x + lane, y), 0.0f, 1.0f);
+							colors[local + lane] = glm::vec3(color) * color.a + colors[local + lane] * (1.0f - color.a);
+						}
+					}
+				}
+			}
+
+			// the farthest depth of the block after the writes
+			if (bWritten)
+			{
+				int local = blockY * BLOCK_SIZE * TILE_SIZE + blockX * BLOCK_SIZE;
+				__m128 farthest = _mm_loadu_ps(depth + local);
+				for (int row = 0; row < BLOCK_SIZE; row++)
+				{
+					farthest = _mm_max_ps(farthest, _mm_loadu_ps(depth + local + row * TILE_SIZE));
+					farthest = _mm_max_ps(farthest, _mm_loadu_ps(depth + local + row * TILE_SIZE + 4));
+				}
+				float values[4];
+				_mm_storeu_ps(values, farthest);
+				blockMaxDepth[block] = std::max(std::max(values[0], values[1]), std::max(values[2], values[3]));
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  ShadePixel()
+ *
+ *  This method is used for shading one pixel of a triangle
+ *  with the lighting of the scene shader.  The weights of
+ *  the corners of the source triangle are interpolated
+ *  with perspective correction, and the ambient, diffuse
+ *  and specular terms of every light are added up as the
+ *  shader adds them, the point lights leaving the texture
+ *  out of their specular term.
+ ***********************************************************/
+glm::vec4 SoftwareRasterizer::ShadePixel(const RASTER_TRIANGLE& triangle, int x, int y) const
+{
+	float planeX = (float)(x - triangle.originX);
+	float planeY = (float)(y - triangle.originY);
+	float inverseW = EvaluatePlane(triangle.inverseWPlane, planeX, planeY);
+	float weight0 = EvaluatePlane(triangle.weightPlanes[0], planeX, planeY) / inverseW;
+	float weight1 = EvaluatePlane(triangle.weightPlanes[1], planeX, planeY) / inverseW;
+	float weight2 = 1.0f - weight0 - weight1;
+
+	const RASTER_VERTEX& vertex0 = m_vertices[m_indices[triangle.sourceTriangle * 3]];
+	const RASTER_VERTEX& vertex1 = m_vertices[m_indices[triangle.sourceTriangle * 3 + 1]];
+	const RASTER_VERTEX& vertex2 = m_vertices[m_indices[triangle.sourceTriangle * 3 + 2]];
+	glm::vec3 position = vertex0.position * weight0 + vertex1.position * weight1 + vertex2.position * weight2;
+	glm::vec3 normal = vertex0.normal * weight0 + vertex1.normal * weight1 + vertex2.normal * weight2;
+	glm::vec2 textureCoordinate = vertex0.textureCoordinate * weight0 + vertex1.textureCoordinate * weight1 + vertex2.textureCoordinate * weight2;
+
+	const SHADE_SURFACE& surface = m_surfaces[triangle.surface];
+	glm::vec4 baseColor = surface.color;
+	if (surface.texture >= 0)
+	{
+		baseColor = m_geometry.SampleTexture(surface.texture, textureCoordinate);
+	}
+	glm::vec3 base = glm::vec3(baseColor);
+
+	float normalLength = glm::length(normal);
+	normal = (normalLength > 0.0f) ? (normal / normalLength) : glm::vec3(0.0f, 1.0f, 0.0f);
+	glm::vec3 viewDirection = glm::normalize(m_view.cameraPosition - position);
+
+	glm::vec3 result(0.0f);
+	for (const GEOMETRY_LIGHT& light : m_lights)
+	{
+		glm::vec3 lightDirection = light.bDirectional ? glm::normalize(-light.vector) : glm::normalize(light.vector - position);
+		float diffuse = std::max(glm::dot(normal, lightDirection), 0.0f);
+		glm::vec3 reflectDirection = glm::reflect(-lightDirection, normal);
+		float specular = std::pow(std::max(glm::dot(viewDirection, reflectDirection), 0.0f), surface.shininess);
+
+		result += light.ambient * base;
+		result += light.diffuse * diffuse * surface.diffuseColor * base;
+		result += light.specular * specular * surface.specularColor * (light.bDirectional ? base : glm::vec3(1.0f));
+	}
+	return glm::vec4(result, baseColor.a);
+}
+
+/***********************************************************
+ *  WriteImage()
+ *
+ *  This method is used for writing the rendered colors.
+ *  EXR files keep the colors as floats, PNG files store
+ *  them in 8 bits as the window does.
+ ***********************************************************/
+bool SoftwareRasterizer::WriteImage(const char* filename) const
+{
+	size_t pixelCount = m_colors.size();
+	if (HasExtension(filename, ".exr"))
+	{
+		return ImageWriter::WriteExr(filename, m_view.width, m_view.height, &m_colors[0].x);
+	}
+
+	std::vector<unsigned char> pixels(pixelCount * 3);
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		for (int channel = 0; channel < 3; channel++)
+		{
+			pixels[i * 3 + channel] = (unsigned char)(glm::clamp(m_colors[i][channel], 0.0f, 1.0f) * 255.0f + 0.5f);
+		}
+	}
+	return ImageWriter::WritePng(filename, m_view.width, m_view.height, pixels.data());
+}
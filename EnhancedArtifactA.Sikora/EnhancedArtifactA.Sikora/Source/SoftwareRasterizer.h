@@ -0,0 +1,228 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerasterizer.h
+// ============
+// tile based rasterizer of the scene file on the CPU, spread over all of the
+// cores by the job system, for rendering on machines without a GPU
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+#include "RenderBackend.h"
+#include "SceneGeometry.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  SoftwareRasterizer
+ *
+ *  Draws the scene geometry the way the scene shader draws
+ *  it - the same Phong terms, the same untransformed
+ *  normals, the texture read without the UV scale when lit
+ *  and the same blending - so its images can stand in for
+ *  the window in automated visual and performance checks.
+ *
+ *  A frame runs in three stages on the job system.  The
+ *  vertices are moved into clip space in ranges, then the
+ *  triangles are clipped, set up and sorted into bins of
+ *  the tiles they touch, in chunks that each keep their
+ *  own bins so that no locks are needed and the draw order
+ *  is kept, and then every tile is rasterized on its own.
+ *
+ *  The coverage test runs on four pixels at once with SSE2
+ *  integer edge functions in 1/16 pixel fixed point, with
+ *  a top-left fill rule so that shared edges are drawn
+ *  once.  Each tile keeps the farthest depth of its 8x8
+ *  blocks, which rejects whole blocks behind what is
+ *  already drawn.  Opaque triangles only store the nearest
+ *  triangle of every pixel, which is shaded once at the
+ *  end, and the translucent ones are shaded and blended
+ *  afterwards in the order they were drawn.
+ ***********************************************************/
+class SoftwareRasterizer : public RenderBackend
+{
+public:
+	// constructor
+	SoftwareRasterizer(JobSystem* pJobSystem);
+	// destructor
+	~SoftwareRasterizer();
+
+	const char* GetName() const override { return "software rasterizer"; }
+	// build the world space vertices and the surfaces of a
+	// loaded scene file
+	bool BuildScene(const SceneFile& sceneFile) override;
+	// render the scene and write the image
+	bool RenderImage(const RENDER_VIEW& view, const char* filename) override;
+
+private:
+	// size of the square tiles the screen is binned into
+	static constexpr int TILE_SIZE = 64;
+	// size of the square blocks that keep a farthest depth
+	static constexpr int BLOCK_SIZE = 8;
+	static constexpr int BLOCKS_PER_TILE = (TILE_SIZE / BLOCK_SIZE) * (TILE_SIZE / BLOCK_SIZE);
+	// fraction bits of the fixed point screen positions
+	static constexpr int SUBPIXEL_BITS = 4;
+	static constexpr int SUBPIXEL_SCALE = 1 << SUBPIXEL_BITS;
+	// pixels outside of the screen up to which triangles are
+	// not clipped, which keeps the edge functions in 32 bits
+	static constexpr int GUARD_BAND_PIXELS = 8192;
+	// triangles set up and binned by one job
+	static constexpr int TRIANGLES_PER_CHUNK = 4096;
+	// vertices moved into clip space by one job
+	static constexpr int VERTICES_PER_JOB = 8192;
+
+	// vertex of the scene in world space, with the normal the
+	// scene shader uses, which is the one of the mesh
+	struct RASTER_VERTEX
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 textureCoordinate;
+	};
+
+	// surface values the shading needs, with the material in
+	// effect, which is zero where no material is set as the
+	// shader uniforms are
+	struct SHADE_SURFACE
+	{
+		int texture;
+		glm::vec4 color;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float shininess;
+		bool bOpaque;
+	};
+
+	// triangle of the screen after clipping and set up.  The
+	// edge functions are A * x + B * y + C in fixed point with
+	// the fill rule bias in C, and the planes are a * x + b * y
+	// + c in pixels from the origin
+	struct RASTER_TRIANGLE
+	{
+		int minX;
+		int minY;
+		int maxX;
+		int maxY;
+		int32_t edgeA[3];
+		int32_t edgeB[3];
+		int64_t edgeC[3];
+		int originX;
+		int originY;
+		float depthPlane[3];
+		float inverseWPlane[3];
+		// barycentric weights of the first two corners of the
+		// source triangle, divided by w
+		float weightPlanes[2][3];
+		float minDepth;
+		uint32_t sourceTriangle;
+		int surface;
+	};
+
+	// triangles set up by one job and the triangles of every
+	// tile among them, in draw order
+	struct BIN_CHUNK
+	{
+		std::vector<RASTER_TRIANGLE> triangles;
+		std::vector<std::vector<uint32_t>> tileBins;
+	};
+
+	// corner of a triangle being clipped, with its weights of
+	// the corners of the source triangle
+	struct CLIP_VERTEX
+	{
+		glm::vec4 position;
+		glm::vec3 weights;
+	};
+
+	// range bodies handed to the job system for the stages
+	struct VERTEX_RANGE
+	{
+		SoftwareRasterizer* pRasterizer;
+		void operator()(int first, int last) const
+		{
+			for (int job = first; job < last; job++)
+			{
+				pRasterizer->TransformVertices(job);
+			}
+		}
+	};
+	struct BIN_RANGE
+	{
+		SoftwareRasterizer* pRasterizer;
+		void operator()(int first, int last) const
+		{
+			for (int chunk = first; chunk < last; chunk++)
+			{
+				pRasterizer->BinTriangles(chunk);
+			}
+		}
+	};
+	struct TILE_RANGE
+	{
+		SoftwareRasterizer* pRasterizer;
+		void operator()(int first, int last) const
+		{
+			for (int tile = first; tile < last; tile++)
+			{
+				pRasterizer->RasterizeTile(tile);
+			}
+		}
+	};
+
+	JobSystem* m_pJobSystem;
+
+	SceneGeometry m_geometry;
+	std::vector<RASTER_VERTEX> m_vertices;
+	std::vector<uint32_t> m_indices;
+	// surface of every triangle
+	std::vector<int> m_triangleSurfaces;
+	std::vector<SHADE_SURFACE> m_surfaces;
+	std::vector<GEOMETRY_LIGHT> m_lights;
+
+	// state of the frame in progress
+	RENDER_VIEW m_view;
+	glm::mat4 m_viewProjection;
+	int m_tilesPerRow;
+	int m_tileCount;
+	std::vector<glm::vec4> m_clipPositions;
+	std::vector<BIN_CHUNK> m_chunks;
+	std::vector<glm::vec3> m_colors;
+
+	// move a range of the vertices into clip space
+	void TransformVertices(int job);
+	// clip, set up and bin the triangles of a chunk
+	void BinTriangles(int chunk);
+	// set up one clipped triangle and add it to the bins of
+	// the tiles it touches
+	void SetupTriangle(BIN_CHUNK& chunk, const CLIP_VERTEX* corners, uint32_t sourceTriangle, int surface);
+	// draw the binned triangles of one tile
+	void RasterizeTile(int tile);
+	// draw one triangle into the depth of a tile, storing the
+	// triangle ID, or shading and blending it when a color
+	// buffer is passed in
+	void RasterizeTriangle(
+		const RASTER_TRIANGLE& triangle,
+		uint32_t triangleID,
+		int tileX,
+		int tileY,
+		float* depth,
+		float* blockMaxDepth,
+		uint32_t* triangleIDs,
+		glm::vec3* colors) const;
+	// shade one pixel of a triangle with the Phong terms of
+	// the scene shader, returns the color and alpha
+	glm::vec4 ShadePixel(const RASTER_TRIANGLE& triangle, int x, int y) const;
+
+	// write the rendered image
+	bool WriteImage(const char* filename) const;
+
+	// the rasterizer holds large buffers that must not be copied
+	SoftwareRasterizer(const SoftwareRasterizer&) = delete;
+	SoftwareRasterizer& operator=(const SoftwareRasterizer&) = delete;
+};
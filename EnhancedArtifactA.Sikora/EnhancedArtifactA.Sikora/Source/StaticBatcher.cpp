@@ -0,0 +1,326 @@
+///////////////////////////////////////////////////////////////////////////////
+// staticbatcher.cpp
+// ============
+// merge objects that never move into pre-transformed vertex and index
+// buffers, so that each group of them is drawn with a single call
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StaticBatcher.h"
+#include "GLResources.h"
+#include "GpuMemory.h"
+
+#include <cfloat>
+#include <cmath>
+
+/***********************************************************
+ *  BATCH_KEY::operator<()
+ *
+ *  Orders batch keys for the batch lookup table.
+ ***********************************************************/
+bool StaticBatcher::BATCH_KEY::operator<(const BATCH_KEY& other) const
+{
+	if (textureSlot != other.textureSlot) return (textureSlot < other.textureSlot);
+	if (materialIndex != other.materialIndex) return (materialIndex < other.materialIndex);
+	for (int i = 0; i < 4; i++)
+	{
+		if (color[i] != other.color[i]) return (color[i] < other.color[i]);
+	}
+	for (int i = 0; i < 2; i++)
+	{
+		if (UVscale[i] != other.UVscale[i]) return (UVscale[i] < other.UVscale[i]);
+	}
+	for (int i = 0; i < 3; i++)
+	{
+		if (cell[i] != other.cell[i]) return (cell[i] < other.cell[i]);
+	}
+	return false;
+}
+
+/***********************************************************
+ *  StaticBatcher()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StaticBatcher::StaticBatcher(const ShapeMeshes* pMeshes, float cellSize)
+	: m_meshSources(pMeshes)
+{
+	m_cellSize = cellSize;
+	m_liveObjectCount = 0;
+}
+
+/***********************************************************
+ *  ~StaticBatcher()
+ *
+ *  The destructor for the class.  Clear() must have been
+ *  called while the OpenGL context was still current.
+ ***********************************************************/
+StaticBatcher::~StaticBatcher()
+{
+}
+
+/***********************************************************
+ *  AddObject()
+ *
+ *  This method is used for adding an object to the batch
+ *  of its shader state and grid cell.  The batch buffers
+ *  are rebuilt by the next Update().
+ ***********************************************************/
+int StaticBatcher::AddObject(
+	ShapeMeshes::MESH_TYPE mesh,
+	const glm::mat4& modelMatrix,
+	int textureSlot,
+	int materialIndex,
+	const glm::vec4& color,
+	const glm::vec2& UVscale)
+{
+	if (nullptr == m_meshSources.GetMeshSource(mesh))
+	{
+		return(-1);
+	}
+
+	// the position of the object decides its grid cell
+	glm::vec3 position = glm::vec3(modelMatrix[3]);
+
+	BATCH_KEY key;
+	key.textureSlot = textureSlot;
+	key.materialIndex = materialIndex;
+	// the color is only used by untextured objects
+	key.color = (textureSlot >= 0) ? glm::vec4(1.0f) : color;
+	key.UVscale = UVscale;
+	key.cell = glm::ivec3(
+		(int)std::floor(position.x / m_cellSize),
+		(int)std::floor(position.y / m_cellSize),
+		(int)std::floor(position.z / m_cellSize));
+
+	int batchIndex = 0;
+	std::map<BATCH_KEY, int>::iterator existing = m_batchLookup.find(key);
+	if (existing != m_batchLookup.end())
+	{
+		batchIndex = existing->second;
+	}
+	else
+	{
+		STATIC_BATCH batch;
+		batch.textureSlot = key.textureSlot;
+		batch.materialIndex = key.materialIndex;
+		batch.color = key.color;
+		batch.UVscale = key.UVscale;
+		batch.cell = key.cell;
+		batch.boundsMin = glm::vec3(0.0f);
+		batch.boundsMax = glm::vec3(0.0f);
+		batch.vao = 0;
+		batch.vbos[0] = 0;
+		batch.vbos[1] = 0;
+		batch.indexCount = 0;
+		batch.bDirty = true;
+
+		batchIndex = (int)m_batches.size();
+		m_batches.push_back(batch);
+		m_batchLookup[key] = batchIndex;
+	}
+
+	STATIC_OBJECT object;
+	object.mesh = mesh;
+	object.modelMatrix = modelMatrix;
+	object.batchIndex = batchIndex;
+	object.bAlive = true;
+
+	int objectID = (int)m_objects.size();
+	m_objects.push_back(object);
+	m_liveObjectCount++;
+
+	m_batches[batchIndex].objects.push_back(objectID);
+	m_batches[batchIndex].bDirty = true;
+
+	return(objectID);
+}
+
+/***********************************************************
+ *  RemoveObject()
+ *
+ *  This method is used for removing an object from its
+ *  batch.  The batch buffers are rebuilt by the next
+ *  Update().
+ ***********************************************************/
+bool StaticBatcher::RemoveObject(int objectID)
+{
+	if ((objectID < 0) || (objectID >= (int)m_objects.size()) || (m_objects[objectID].bAlive == false))
+	{
+		return(false);
+	}
+
+	STATIC_OBJECT& object = m_objects[objectID];
+	STATIC_BATCH& batch = m_batches[object.batchIndex];
+
+	for (size_t i = 0; i < batch.objects.size(); i++)
+	{
+		if (batch.objects[i] == objectID)
+		{
+			batch.objects[i] = batch.objects.back();
+			batch.objects.pop_back();
+			break;
+		}
+	}
+	batch.bDirty = true;
+
+	object.bAlive = false;
+	m_liveObjectCount--;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for rebuilding the buffers of the
+ *  batches that changed since the last update.
+ ***********************************************************/
+void StaticBatcher::Update()
+{
+	for (STATIC_BATCH& batch : m_batches)
+	{
+		if (batch.bDirty == true)
+		{
+			RebuildBatch(batch);
+			batch.bDirty = false;
+		}
+	}
+}
+
+/***********************************************************
+ *  RebuildBatch()
+ *
+ *  This method is used for merging the objects of a batch
+ *  into one vertex and one index buffer.  Positions are
+ *  moved into world space.  The shaders use the vertex
+ *  normals as they are and apply the UV scale themselves,
+ *  so normals and texture coordinates are copied unchanged
+ *  to keep batched objects looking like unbatched ones.
+ ***********************************************************/
+void StaticBatcher::RebuildBatch(STATIC_BATCH& batch)
+{
+	const GLuint floatsPerVertex = ShapeMeshes::FLOATS_PER_MESH_VERTEX;
+
+	std::vector<GLfloat> vertices;
+	std::vector<GLuint> indices;
+	glm::vec3 boundsMin(FLT_MAX);
+	glm::vec3 boundsMax(-FLT_MAX);
+
+	for (int objectID : batch.objects)
+	{
+		const STATIC_OBJECT& object = m_objects[objectID];
+		const MESH_SOURCE* source = m_meshSources.GetMeshSource(object.mesh);
+		GLuint baseVertex = (GLuint)(vertices.size() / floatsPerVertex);
+
+		for (size_t i = 0; i < source->vertices.size(); i += floatsPerVertex)
+		{
+			glm::vec3 position = glm::vec3(object.modelMatrix * glm::vec4(
+				source->vertices[i], source->vertices[i + 1], source->vertices[i + 2], 1.0f));
+
+			boundsMin = glm::min(boundsMin, position);
+			boundsMax = glm::max(boundsMax, position);
+
+			vertices.push_back(position.x);
+			vertices.push_back(position.y);
+			vertices.push_back(position.z);
+			vertices.insert(vertices.end(), source->vertices.begin() + i + 3, source->vertices.begin() + i + floatsPerVertex);
+		}
+
+		for (GLuint index : source->indices)
+		{
+			indices.push_back(baseVertex + index);
+		}
+	}
+
+	// the buffers may have storage that cannot be resized, so
+	// a rebuilt batch gets new ones
+	ReleaseBatchBuffers(batch);
+
+	batch.indexCount = (GLsizei)indices.size();
+	if (batch.indexCount == 0)
+	{
+		// every object was removed
+		batch.boundsMin = glm::vec3(0.0f);
+		batch.boundsMax = glm::vec3(0.0f);
+		return;
+	}
+	batch.boundsMin = boundsMin;
+	batch.boundsMax = boundsMax;
+
+	// same memory layout as the basic shape meshes
+	GLsizeiptr vertexBytes = sizeof(GLfloat) * vertices.size();
+	GLsizeiptr indexBytes = sizeof(GLuint) * indices.size();
+	batch.vbos[0] = GLResources::CreateBuffer(vertexBytes, vertices.data(), BUFFER_STATIC, "static batch vertices");
+	batch.vbos[1] = GLResources::CreateBuffer(indexBytes, indices.data(), BUFFER_STATIC, "static batch indices");
+	batch.vao = GLResources::CreateVertexArray(
+		batch.vbos[0],
+		sizeof(GLfloat) * floatsPerVertex,
+		ShapeMeshes::MESH_ATTRIBUTES,
+		ShapeMeshes::MESH_ATTRIBUTE_COUNT,
+		batch.vbos[1],
+		"static batch");
+	GpuMemory::TrackObject(GL_BUFFER, batch.vbos[0], GPU_MEMORY_BUFFERS, "static batches", (uint64_t)vertexBytes);
+	GpuMemory::TrackObject(GL_BUFFER, batch.vbos[1], GPU_MEMORY_BUFFERS, "static batches", (uint64_t)indexBytes);
+}
+
+/***********************************************************
+ *  ReleaseBatchBuffers()
+ *
+ *  This method is used for freeing the vertex array and
+ *  the buffers of a batch, if it has any.
+ ***********************************************************/
+void StaticBatcher::ReleaseBatchBuffers(STATIC_BATCH& batch)
+{
+	if (batch.vao == 0)
+	{
+		return;
+	}
+
+	GpuMemory::ReleaseObjects(GL_BUFFER, batch.vbos, 2);
+	glDeleteBuffers(2, batch.vbos);
+	glDeleteVertexArrays(1, &batch.vao);
+	batch.vao = 0;
+	batch.vbos[0] = 0;
+	batch.vbos[1] = 0;
+}
+
+/***********************************************************
+ *  DrawBatch()
+ *
+ *  This method is used for drawing all of the objects of a
+ *  batch with one call.
+ ***********************************************************/
+void StaticBatcher::DrawBatch(int batchIndex) const
+{
+	const STATIC_BATCH& batch = m_batches[batchIndex];
+	if (batch.indexCount == 0)
+	{
+		return;
+	}
+
+	glBindVertexArray(batch.vao);
+	glDrawElements(GL_TRIANGLES, batch.indexCount, GL_UNSIGNED_INT, (void*)0);
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing every object and
+ *  freeing the buffers of all batches.
+ ***********************************************************/
+void StaticBatcher::Clear()
+{
+	for (STATIC_BATCH& batch : m_batches)
+	{
+		ReleaseBatchBuffers(batch);
+	}
+
+	m_batches.clear();
+	m_batchLookup.clear();
+	m_objects.clear();
+	m_liveObjectCount = 0;
+}
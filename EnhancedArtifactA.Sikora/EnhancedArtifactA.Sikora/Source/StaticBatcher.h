@@ -0,0 +1,136 @@
+///////////////////////////////////////////////////////////////////////////////
+// staticbatcher.h
+// ============
+// merge objects that never move into pre-transformed vertex and index
+// buffers, so that each group of them is drawn with a single call
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShapeMeshes.h"
+#include "SceneUtilities.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <map>
+#include <vector>
+
+/***********************************************************
+ *  STATIC_BATCH
+ *
+ *  One merged buffer.  Every object in a batch shares the
+ *  shader state below and lies in the same grid cell.
+ ***********************************************************/
+struct STATIC_BATCH
+{
+	// shared shader state
+	int textureSlot;		// -1 when the color is used
+	int materialIndex;		// -1 when no material is set
+	glm::vec4 color;
+	glm::vec2 UVscale;
+	// grid cell the objects belong to
+	glm::ivec3 cell;
+
+	// world space bounds of the merged geometry
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+
+	// GL buffers of the merged geometry
+	GLuint vao;
+	GLuint vbos[2];
+	GLsizei indexCount;
+
+	// objects merged into the batch
+	std::vector<int> objects;
+	// set when objects were added or removed since the last
+	// rebuild of the buffers
+	bool bDirty;
+};
+
+/***********************************************************
+ *  StaticBatcher
+ *
+ *  Objects are grouped by their shader state and by the
+ *  grid cell of their position.  Each group is merged into
+ *  one vertex and index buffer with the object transforms
+ *  baked into the vertex positions.  Adding or removing an
+ *  object only marks its group, and Update() rebuilds the
+ *  marked groups, so a change does not touch the rest of
+ *  the scene.
+ *
+ *  All methods that touch the buffers must run on the
+ *  thread that owns the OpenGL context.
+ ***********************************************************/
+class StaticBatcher
+{
+public:
+	// constructor
+	StaticBatcher(const ShapeMeshes* pMeshes, float cellSize = 16.0f);
+	// destructor
+	~StaticBatcher();
+
+	// add an object, returns its ID or -1 when the mesh is not loaded
+	int AddObject(
+		ShapeMeshes::MESH_TYPE mesh,
+		const glm::mat4& modelMatrix,
+		int textureSlot,
+		int materialIndex,
+		const glm::vec4& color,
+		const glm::vec2& UVscale);
+	// remove a previously added object
+	bool RemoveObject(int objectID);
+
+	// rebuild the buffers of every batch changed since the last update
+	void Update();
+	// free all batches and their buffers
+	void Clear();
+
+	int GetBatchCount() const { return (int)m_batches.size(); }
+	const STATIC_BATCH& GetBatch(int batchIndex) const { return m_batches[batchIndex]; }
+	int GetObjectCount() const { return m_liveObjectCount; }
+
+	// draw the merged geometry of a batch
+	void DrawBatch(int batchIndex) const;
+
+private:
+	struct STATIC_OBJECT
+	{
+		ShapeMeshes::MESH_TYPE mesh;
+		glm::mat4 modelMatrix;
+		int batchIndex;
+		bool bAlive;
+	};
+
+	// the values that decide which batch an object joins
+	struct BATCH_KEY
+	{
+		int textureSlot;
+		int materialIndex;
+		glm::vec4 color;
+		glm::vec2 UVscale;
+		glm::ivec3 cell;
+
+		bool operator<(const BATCH_KEY& other) const;
+	};
+
+	float m_cellSize;
+	std::vector<STATIC_OBJECT> m_objects;
+	std::vector<STATIC_BATCH> m_batches;
+	std::map<BATCH_KEY, int> m_batchLookup;
+	// CPU copies of the basic meshes, fetched once per mesh type
+	MeshSourceCache m_meshSources;
+	int m_liveObjectCount;
+
+	// merge the objects of a batch into its buffers
+	void RebuildBatch(STATIC_BATCH& batch);
+	// free the vertex array and buffers of a batch
+	void ReleaseBatchBuffers(STATIC_BATCH& batch);
+
+	// batches own GL buffers and must not be copied
+	StaticBatcher(const StaticBatcher&) = delete;
+	StaticBatcher& operator=(const StaticBatcher&) = delete;
+};
@@ -0,0 +1,728 @@
+///////////////////////////////////////////////////////////////////////////////
+// terrainsystem.cpp
+// ============
+// heightmap terrain split into a quadtree of chunks, all drawn with one
+// shared grid mesh that the vertex shader displaces and morphs between
+// levels of detail
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TerrainSystem.h"
+#include "GLResources.h"
+#include "GpuMemory.h"
+#include "SceneUtilities.h"
+
+#include "stb_image.h"
+
+#include <glm/gtc/noise.hpp>
+#include <glm/gtc/random.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// octaves of noise summed into the generated heights
+	const int g_NoiseOctaves = 5;
+	// the quadtree is split until its leaves are this small
+	const float g_TargetLeafSize = 16.0f;
+	// camera distance covered by the finest level, in leaves -
+	// every coarser level covers twice the distance
+	const float g_FirstRangeInLeaves = 2.0f;
+	// part of the range of a level after which its vertices
+	// start to morph into the grid of the next level
+	const float g_MorphStartRatio = 0.66f;
+	// depth of the skirts, in quads of the grid they hang from
+	const float g_SkirtDepthInQuads = 2.0f;
+
+	// debug labels of the buffers, in the order of
+	// TERRAIN_BUFFER
+	const char* const g_BufferLabels[] =
+	{
+		"terrain grid vertices", "terrain grid indices", "terrain nodes"
+	};
+
+	// the grid vertex, and the chunk, which advances once per
+	// instance
+	const VERTEX_ATTRIBUTE g_GridAttributes[] = { { 0, 3, 0 } };
+	const VERTEX_ATTRIBUTE g_NodeAttributes[] = { { 8, 4, 0 } };
+
+	// true when the box touches the sphere
+	bool IsBoxInRange(const glm::vec3& boxMin, const glm::vec3& boxMax, const glm::vec3& center, float radius)
+	{
+		glm::vec3 closest = glm::clamp(center, boxMin, boxMax);
+		glm::vec3 offset = closest - center;
+		return (glm::dot(offset, offset) <= radius * radius);
+	}
+
+	// true when the box is not entirely behind one of the planes
+	bool IsBoxInFrustum(const glm::vec4* planes, const glm::vec3& boxMin, const glm::vec3& boxMax)
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			// the corner farthest along the plane normal
+			glm::vec3 corner(
+				(planes[i].x >= 0.0f) ? boxMax.x : boxMin.x,
+				(planes[i].y >= 0.0f) ? boxMax.y : boxMin.y,
+				(planes[i].z >= 0.0f) ? boxMax.z : boxMin.z);
+			if (glm::dot(glm::vec3(planes[i]), corner) + planes[i].w < 0.0f)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+/***********************************************************
+ *  TerrainSystem()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TerrainSystem::TerrainSystem()
+{
+	m_resolution = 0;
+	m_size = 0.0f;
+	m_areaMin = glm::vec2(0.0f);
+	m_levelCount = 0;
+	m_leafSize = 0.0f;
+	for (int i = 0; i < MAX_LEVELS; i++)
+	{
+		m_levelRanges[i] = 0.0f;
+	}
+	m_pDrawShader = NULL;
+	m_useTerrainLocation = -1;
+	m_heightsLocation = -1;
+	m_vao = 0;
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		m_buffers[i] = 0;
+	}
+	m_heightTexture = 0;
+	m_gridIndexCount = 0;
+	m_nodeCount = 0;
+	m_bUploaded = false;
+}
+
+/***********************************************************
+ *  ~TerrainSystem()
+ *
+ *  The destructor for the class.  Clear() must have been
+ *  called while the OpenGL context was still current.
+ ***********************************************************/
+TerrainSystem::~TerrainSystem()
+{
+}
+
+/***********************************************************
+ *  GenerateHeights()
+ *
+ *  This method is used for filling the heights with a few
+ *  octaves of Perlin noise, each at twice the frequency and
+ *  half the amplitude of the one before.  The seed moves
+ *  the noise, so the same scene grows the same hills.
+ ***********************************************************/
+bool TerrainSystem::GenerateHeights(float size, int resolution, float heightScale, float featureSize, uint32_t seed)
+{
+	if ((m_bUploaded == true) || (size <= 0.0f) || (resolution < 2) || (featureSize <= 0.0f))
+	{
+		std::cout << "ERROR: The terrain needs a size, at least 2 samples per side and a feature size" << std::endl;
+		return(false);
+	}
+
+	m_size = size;
+	m_resolution = resolution;
+	m_areaMin = glm::vec2(-size * 0.5f);
+	m_heights.resize((size_t)resolution * resolution);
+
+	std::srand(seed);
+	glm::vec2 noiseOffset = glm::linearRand(glm::vec2(-1000.0f), glm::vec2(1000.0f));
+
+	float step = size / (float)(resolution - 1);
+	for (int z = 0; z < resolution; z++)
+	{
+		for (int x = 0; x < resolution; x++)
+		{
+			glm::vec2 point = (m_areaMin + glm::vec2((float)x, (float)z) * step) / featureSize + noiseOffset;
+
+			float value = 0.0f;
+			float amplitude = 1.0f;
+			float amplitudeSum = 0.0f;
+			float frequency = 1.0f;
+			for (int octave = 0; octave < g_NoiseOctaves; octave++)
+			{
+				value += glm::perlin(point * frequency) * amplitude;
+				amplitudeSum += amplitude;
+				amplitude *= 0.5f;
+				frequency *= 2.0f;
+			}
+
+			// from about -1 to 1 up to 0 to the full height
+			float height = (value / amplitudeSum * 0.5f + 0.5f) * heightScale;
+			m_heights[(size_t)z * resolution + x] = std::max(0.0f, height);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  LoadHeightmap()
+ *
+ *  This method is used for reading the heights from a
+ *  square greyscale image.  Images with 16 bits per channel
+ *  keep their precision.  The top row of the image is the
+ *  lowest z of the terrain, as seen from above with the
+ *  camera at the bottom, the same as a density map.
+ ***********************************************************/
+bool TerrainSystem::LoadHeightmap(const char* filename, float size, float heightScale)
+{
+	if ((m_bUploaded == true) || (size <= 0.0f))
+	{
+		std::cout << "ERROR: The terrain needs a size" << std::endl;
+		return(false);
+	}
+
+	int width = 0;
+	int height = 0;
+	int colorChannels = 0;
+
+	// the rows are wanted from the top of the image down,
+	// while the textures are loaded flipped
+	stbi_set_flip_vertically_on_load(false);
+	stbi_us* image = stbi_load_16(filename, &width, &height, &colorChannels, 1);
+	stbi_set_flip_vertically_on_load(true);
+
+	if (image == nullptr)
+	{
+		std::cout << "ERROR: Could not load heightmap:" << filename << std::endl;
+		return(false);
+	}
+	if ((width != height) || (width < 2))
+	{
+		std::cout << "ERROR: A heightmap must be square:" << filename << std::endl;
+		stbi_image_free(image);
+		return(false);
+	}
+
+	m_size = size;
+	m_resolution = width;
+	m_areaMin = glm::vec2(-size * 0.5f);
+	m_heights.resize((size_t)width * height);
+	for (size_t i = 0; i < m_heights.size(); i++)
+	{
+		m_heights[i] = image[i] / 65535.0f * heightScale;
+	}
+
+	stbi_image_free(image);
+
+	return(true);
+}
+
+/***********************************************************
+ *  FlattenArea()
+ *
+ *  This method is used for keeping an area of the terrain
+ *  at height zero, for the objects that stand on the flat
+ *  ground.  Around the area the heights are scaled back up
+ *  with a smooth step over the blend distance.
+ ***********************************************************/
+void TerrainSystem::FlattenArea(const glm::vec2& areaMin, const glm::vec2& areaMax, float blendDistance)
+{
+	if (m_heights.empty() || (m_bUploaded == true))
+	{
+		return;
+	}
+
+	float step = m_size / (float)(m_resolution - 1);
+	for (int z = 0; z < m_resolution; z++)
+	{
+		for (int x = 0; x < m_resolution; x++)
+		{
+			glm::vec2 point = m_areaMin + glm::vec2((float)x, (float)z) * step;
+			glm::vec2 outside = glm::max(glm::max(areaMin - point, point - areaMax), glm::vec2(0.0f));
+			float distanceOutside = glm::length(outside);
+
+			float weight = (blendDistance > 0.0f) ? glm::smoothstep(0.0f, blendDistance, distanceOutside) :
+				((distanceOutside > 0.0f) ? 1.0f : 0.0f);
+			m_heights[(size_t)z * m_resolution + x] *= weight;
+		}
+	}
+}
+
+/***********************************************************
+ *  GetSample()
+ *
+ *  This method is used for reading one height sample, with
+ *  the coordinates clamped to the grid.
+ ***********************************************************/
+float TerrainSystem::GetSample(int x, int z) const
+{
+	x = std::min(std::max(x, 0), m_resolution - 1);
+	z = std::min(std::max(z, 0), m_resolution - 1);
+	return(m_heights[(size_t)z * m_resolution + x]);
+}
+
+/***********************************************************
+ *  GetHeight()
+ *
+ *  This method is used for getting the height of the
+ *  surface at a point, interpolated between the four
+ *  nearest samples the same way the height texture is
+ *  filtered.  Points outside the terrain get the height of
+ *  its nearest edge.
+ ***********************************************************/
+float TerrainSystem::GetHeight(float x, float z) const
+{
+	if (m_heights.empty())
+	{
+		return(0.0f);
+	}
+
+	float step = m_size / (float)(m_resolution - 1);
+	float sampleX = glm::clamp((x - m_areaMin.x) / step, 0.0f, (float)(m_resolution - 1));
+	float sampleZ = glm::clamp((z - m_areaMin.y) / step, 0.0f, (float)(m_resolution - 1));
+	int x0 = (int)sampleX;
+	int z0 = (int)sampleZ;
+	float fractionX = sampleX - (float)x0;
+	float fractionZ = sampleZ - (float)z0;
+
+	float lowerRow = glm::mix(GetSample(x0, z0), GetSample(x0 + 1, z0), fractionX);
+	float upperRow = glm::mix(GetSample(x0, z0 + 1), GetSample(x0 + 1, z0 + 1), fractionX);
+	return(glm::mix(lowerRow, upperRow, fractionZ));
+}
+
+/***********************************************************
+ *  BuildLevelBounds()
+ *
+ *  This method is used for splitting the terrain into the
+ *  levels of the quadtree and finding the height range of
+ *  every chunk, from the samples under the leaves and then
+ *  from the four children of each coarser chunk.
+ ***********************************************************/
+void TerrainSystem::BuildLevelBounds()
+{
+	m_levelCount = 1;
+	m_leafSize = m_size;
+	while ((m_leafSize > g_TargetLeafSize) && (m_levelCount < MAX_LEVELS))
+	{
+		m_leafSize *= 0.5f;
+		m_levelCount++;
+	}
+
+	for (int level = 0; level < m_levelCount; level++)
+	{
+		m_levelRanges[level] = m_leafSize * g_FirstRangeInLeaves * (float)(1 << level);
+	}
+
+	m_levelBounds.resize(m_levelCount);
+
+	float step = m_size / (float)(m_resolution - 1);
+	LEVEL_BOUNDS& leaves = m_levelBounds[0];
+	leaves.nodesPerSide = 1 << (m_levelCount - 1);
+	leaves.minMax.resize((size_t)leaves.nodesPerSide * leaves.nodesPerSide);
+	for (int nodeZ = 0; nodeZ < leaves.nodesPerSide; nodeZ++)
+	{
+		for (int nodeX = 0; nodeX < leaves.nodesPerSide; nodeX++)
+		{
+			int firstX = (int)std::floor(nodeX * m_leafSize / step);
+			int lastX = (int)std::ceil((nodeX + 1) * m_leafSize / step);
+			int firstZ = (int)std::floor(nodeZ * m_leafSize / step);
+			int lastZ = (int)std::ceil((nodeZ + 1) * m_leafSize / step);
+
+			glm::vec2 range(1.0e30f, -1.0e30f);
+			for (int z = firstZ; z <= lastZ; z++)
+			{
+				for (int x = firstX; x <= lastX; x++)
+				{
+					float height = GetSample(x, z);
+					range.x = std::min(range.x, height);
+					range.y = std::max(range.y, height);
+				}
+			}
+			leaves.minMax[(size_t)nodeZ * leaves.nodesPerSide + nodeX] = range;
+		}
+	}
+
+	for (int level = 1; level < m_levelCount; level++)
+	{
+		const LEVEL_BOUNDS& children = m_levelBounds[level - 1];
+		LEVEL_BOUNDS& bounds = m_levelBounds[level];
+		bounds.nodesPerSide = children.nodesPerSide / 2;
+		bounds.minMax.resize((size_t)bounds.nodesPerSide * bounds.nodesPerSide);
+		for (int nodeZ = 0; nodeZ < bounds.nodesPerSide; nodeZ++)
+		{
+			for (int nodeX = 0; nodeX < bounds.nodesPerSide; nodeX++)
+			{
+				glm::vec2 range(1.0e30f, -1.0e30f);
+				for (int child = 0; child < 4; child++)
+				{
+					int childX = nodeX * 2 + (child & 1);
+					int childZ = nodeZ * 2 + (child >> 1);
+					const glm::vec2& childRange = children.minMax[(size_t)childZ * children.nodesPerSide + childX];
+					range.x = std::min(range.x, childRange.x);
+					range.y = std::max(range.y, childRange.y);
+				}
+				bounds.minMax[(size_t)nodeZ * bounds.nodesPerSide + nodeX] = range;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  GetTrianglesPerNode()
+ *
+ *  This method is used for getting the number of triangles
+ *  drawn for one chunk, with its skirts.
+ ***********************************************************/
+int TerrainSystem::GetTrianglesPerNode() const
+{
+	return(GRID_SIZE * GRID_SIZE * 2 + GRID_SIZE * 4 * 2);
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used for building the quadtree, the
+ *  height texture, the shared grid mesh with its skirts
+ *  and the node buffer, and for setting the values of the
+ *  draw program that do not change from frame to frame.
+ *  The grid vertices are the x z of the vertex across the
+ *  chunk, from 0 to 1, and 1 for the bottom of a skirt.
+ ***********************************************************/
+bool TerrainSystem::Upload(ShaderManager* pDrawShader, const glm::vec2& UVscale)
+{
+	if ((m_bUploaded == true) || m_heights.empty() || (pDrawShader == NULL))
+	{
+		return(false);
+	}
+
+	BuildLevelBounds();
+
+	// the heights are sampled in the vertex shader, filtered
+	// between the samples but without mipmaps
+	m_heightTexture = GLResources::CreateTexture2D(
+		m_resolution, m_resolution, GL_R32F, GL_RED, GL_FLOAT, m_heights.data(),
+		GL_CLAMP_TO_EDGE, GL_LINEAR, GL_LINEAR, false, TEXTURE_IMMUTABLE, "terrain heights");
+	GpuMemory::TrackObject(GL_TEXTURE, m_heightTexture, GPU_MEMORY_TEXTURES, "terrain",
+		GpuMemory::GetTextureBytes(m_resolution, m_resolution, GL_R32F, 1));
+
+	const int side = GRID_SIZE + 1;
+	std::vector<GLfloat> vertices;
+	std::vector<GLuint> indices;
+	vertices.reserve((size_t)(side * side + side * 4) * 3);
+	indices.reserve((size_t)GetTrianglesPerNode() * 3);
+
+	for (int z = 0; z < side; z++)
+	{
+		for (int x = 0; x < side; x++)
+		{
+			vertices.push_back((float)x / GRID_SIZE);
+			vertices.push_back((float)z / GRID_SIZE);
+			vertices.push_back(0.0f);
+		}
+	}
+	for (int z = 0; z < GRID_SIZE; z++)
+	{
+		for (int x = 0; x < GRID_SIZE; x++)
+		{
+			GLuint corner = (GLuint)(z * side + x);
+			indices.push_back(corner);
+			indices.push_back(corner + side);
+			indices.push_back(corner + 1);
+			indices.push_back(corner + 1);
+			indices.push_back(corner + side);
+			indices.push_back(corner + side + 1);
+		}
+	}
+
+	// each edge gets its own row of skirt vertices under the
+	// edge vertices, walked around the chunk
+	for (int edge = 0; edge < 4; edge++)
+	{
+		GLuint firstSkirtVertex = (GLuint)(vertices.size() / 3);
+		GLuint edgeVertices[GRID_SIZE + 1];
+		for (int i = 0; i < side; i++)
+		{
+			int x = 0;
+			int z = 0;
+			switch (edge)
+			{
+			case 0: x = i; z = 0; break;
+			case 1: x = GRID_SIZE; z = i; break;
+			case 2: x = GRID_SIZE - i; z = GRID_SIZE; break;
+			default: x = 0; z = GRID_SIZE - i; break;
+			}
+			edgeVertices[i] = (GLuint)(z * side + x);
+			vertices.push_back((float)x / GRID_SIZE);
+			vertices.push_back((float)z / GRID_SIZE);
+			vertices.push_back(1.0f);
+		}
+		for (int i = 0; i < GRID_SIZE; i++)
+		{
+			indices.push_back(edgeVertices[i]);
+			indices.push_back(firstSkirtVertex + i);
+			indices.push_back(edgeVertices[i + 1]);
+			indices.push_back(edgeVertices[i + 1]);
+			indices.push_back(firstSkirtVertex + i);
+			indices.push_back(firstSkirtVertex + i + 1);
+		}
+	}
+	m_gridIndexCount = (GLsizei)indices.size();
+
+	// the chunks are rewritten every frame by UploadNodes()
+	m_buffers[BUFFER_GRID_VERTICES] = GLResources::CreateBuffer(
+		sizeof(GLfloat) * vertices.size(), vertices.data(), BUFFER_STATIC, g_BufferLabels[BUFFER_GRID_VERTICES]);
+	m_buffers[BUFFER_GRID_INDICES] = GLResources::CreateBuffer(
+		sizeof(GLuint) * indices.size(), indices.data(), BUFFER_STATIC, g_BufferLabels[BUFFER_GRID_INDICES]);
+	m_buffers[BUFFER_NODES] = GLResources::CreateBuffer(
+		sizeof(TERRAIN_NODE) * MAX_DRAWN_NODES, nullptr, BUFFER_DYNAMIC, g_BufferLabels[BUFFER_NODES]);
+
+	m_vao = GLResources::CreateVertexArray(m_buffers[BUFFER_GRID_INDICES], "terrain");
+	GLResources::SetVertexBuffer(m_vao, 0, m_buffers[BUFFER_GRID_VERTICES], 0, sizeof(GLfloat) * 3, 0, g_GridAttributes, 1);
+	GLResources::SetVertexBuffer(m_vao, 1, m_buffers[BUFFER_NODES], 0, sizeof(TERRAIN_NODE), 1, g_NodeAttributes, 1);
+	GpuMemory::TrackObject(GL_BUFFER, m_buffers[BUFFER_GRID_VERTICES], GPU_MEMORY_BUFFERS, "terrain", sizeof(GLfloat) * vertices.size());
+	GpuMemory::TrackObject(GL_BUFFER, m_buffers[BUFFER_GRID_INDICES], GPU_MEMORY_BUFFERS, "terrain", sizeof(GLuint) * indices.size());
+	GpuMemory::TrackObject(GL_BUFFER, m_buffers[BUFFER_NODES], GPU_MEMORY_BUFFERS, "terrain", sizeof(TERRAIN_NODE) * MAX_DRAWN_NODES);
+
+	// morph ranges of every level, from where the vertices
+	// start to move to the end of the range of the level
+	GLfloat morphRanges[MAX_LEVELS * 2];
+	for (int level = 0; level < MAX_LEVELS; level++)
+	{
+		int rangeLevel = std::min(level, m_levelCount - 1);
+		float rangeStart = (rangeLevel > 0) ? m_levelRanges[rangeLevel - 1] : 0.0f;
+		float rangeEnd = m_levelRanges[rangeLevel];
+		morphRanges[level * 2] = rangeStart + (rangeEnd - rangeStart) * g_MorphStartRatio;
+		morphRanges[level * 2 + 1] = rangeEnd;
+	}
+
+	m_pDrawShader = pDrawShader;
+	m_useTerrainLocation = pDrawShader->getUniformLocation("bUseTerrain");
+	m_heightsLocation = pDrawShader->getUniformLocation("terrainHeights");
+
+	pDrawShader->use();
+	pDrawShader->setVec4Value("terrainArea", m_areaMin.x, m_areaMin.y, m_size, (float)m_resolution);
+	pDrawShader->setFloatValue("terrainLeafSize", m_leafSize);
+	pDrawShader->setFloatValue("terrainGridSize", (float)GRID_SIZE);
+	pDrawShader->setVec2ArrayValue(pDrawShader->getUniformLocation("terrainMorphRanges"), MAX_LEVELS, morphRanges);
+	pDrawShader->setFloatValue("terrainSkirtDepth", g_SkirtDepthInQuads);
+	pDrawShader->setVec2Value("terrainUVscale", UVscale.x, UVscale.y);
+
+	m_bUploaded = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  AddNode()
+ *
+ *  This method is used for adding a chunk to the list of
+ *  the frame when its bounds are in the view frustum and
+ *  the list is not full.
+ ***********************************************************/
+void TerrainSystem::AddNode(SELECTION& selection, const glm::vec2& corner, float size, int level, const glm::vec2& heightRange) const
+{
+	if (selection.nodeCount >= std::min(selection.pNodes->size(), (size_t)MAX_DRAWN_NODES))
+	{
+		return;
+	}
+
+	glm::vec3 boxMin(corner.x, heightRange.x, corner.y);
+	glm::vec3 boxMax(corner.x + size, heightRange.y, corner.y + size);
+	if (!IsBoxInFrustum(selection.planes, boxMin, boxMax))
+	{
+		return;
+	}
+
+	TERRAIN_NODE& node = (*selection.pNodes)[selection.nodeCount++];
+	node.corner = corner;
+	node.size = size;
+	node.level = (float)level;
+}
+
+/***********************************************************
+ *  SelectNode()
+ *
+ *  This method is used for selecting a chunk at its level
+ *  when it is out of the range of the finer level, or for
+ *  selecting its children otherwise.  A child that is out
+ *  of the range of the finer level is drawn at this level
+ *  instead, as a quarter of this chunk.
+ ***********************************************************/
+bool TerrainSystem::SelectNode(SELECTION& selection, int level, int x, int z) const
+{
+	const LEVEL_BOUNDS& bounds = m_levelBounds[level];
+	const glm::vec2& heightRange = bounds.minMax[(size_t)z * bounds.nodesPerSide + x];
+	float size = m_leafSize * (float)(1 << level);
+	glm::vec2 corner = m_areaMin + glm::vec2((float)x, (float)z) * size;
+
+	glm::vec3 boxMin(corner.x, heightRange.x, corner.y);
+	glm::vec3 boxMax(corner.x + size, heightRange.y, corner.y + size);
+
+	if (!IsBoxInRange(boxMin, boxMax, selection.viewPosition, m_levelRanges[level]))
+	{
+		return(false);
+	}
+
+	// out of view, so neither this chunk nor its children
+	// are drawn, but the area is taken care of
+	if (!IsBoxInFrustum(selection.planes, boxMin, boxMax))
+	{
+		return(true);
+	}
+
+	if ((level == 0) || !IsBoxInRange(boxMin, boxMax, selection.viewPosition, m_levelRanges[level - 1]))
+	{
+		AddNode(selection, corner, size, level, heightRange);
+		return(true);
+	}
+
+	const LEVEL_BOUNDS& childBounds = m_levelBounds[level - 1];
+	float childSize = size * 0.5f;
+	for (int child = 0; child < 4; child++)
+	{
+		int childX = x * 2 + (child & 1);
+		int childZ = z * 2 + (child >> 1);
+		if (!SelectNode(selection, level - 1, childX, childZ))
+		{
+			AddNode(
+				selection,
+				m_areaMin + glm::vec2((float)childX, (float)childZ) * childSize,
+				childSize,
+				level,
+				childBounds.minMax[(size_t)childZ * childBounds.nodesPerSide + childX]);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  SelectNodes()
+ *
+ *  This method is used for walking the quadtree from the
+ *  root and listing the chunks to draw for the passed in
+ *  camera.
+ ***********************************************************/
+void TerrainSystem::SelectNodes(
+	const glm::mat4& viewProjection,
+	const glm::vec3& viewPosition,
+	ArenaArray<TERRAIN_NODE>& nodes) const
+{
+	if (m_levelBounds.empty())
+	{
+		nodes.resize(0);
+		return;
+	}
+
+	SELECTION selection;
+	selection.viewPosition = viewPosition;
+	selection.pNodes = &nodes;
+	selection.nodeCount = 0;
+
+	// only the side of the boxes is tested, so the planes
+	// are not normalized
+	ExtractFrustumPlanes(viewProjection, false, selection.planes);
+
+	int rootLevel = m_levelCount - 1;
+	if (!SelectNode(selection, rootLevel, 0, 0))
+	{
+		// the camera is farther than the coarsest range, so
+		// the whole terrain is drawn as one chunk
+		AddNode(selection, m_areaMin, m_size, rootLevel, m_levelBounds[rootLevel].minMax[0]);
+	}
+
+	// only shrinks, so nothing is taken from the arena
+	nodes.resize(selection.nodeCount);
+}
+
+/***********************************************************
+ *  UploadNodes()
+ *
+ *  This method is used for copying the chunks selected for
+ *  the frame being drawn into the node buffer.
+ ***********************************************************/
+void TerrainSystem::UploadNodes(const ArenaArray<TERRAIN_NODE>& nodes)
+{
+	m_nodeCount = 0;
+	if ((m_bUploaded == false) || nodes.empty())
+	{
+		return;
+	}
+
+	m_nodeCount = (GLsizei)std::min(nodes.size(), (size_t)MAX_DRAWN_NODES);
+	glBindBuffer(GL_ARRAY_BUFFER, m_buffers[BUFFER_NODES]);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(TERRAIN_NODE) * m_nodeCount, nodes.begin());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GpuMemory::CountUpload(sizeof(TERRAIN_NODE) * m_nodeCount);
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method is used for drawing every uploaded chunk
+ *  with one instanced draw of the grid mesh.
+ ***********************************************************/
+void TerrainSystem::Draw(GLint textureUnit) const
+{
+	if ((m_bUploaded == false) || (m_nodeCount == 0))
+	{
+		return;
+	}
+
+	glActiveTexture(GL_TEXTURE0 + textureUnit);
+	glBindTexture(GL_TEXTURE_2D, m_heightTexture);
+	glActiveTexture(GL_TEXTURE0);
+
+	m_pDrawShader->setIntValue(m_heightsLocation, textureUnit);
+	m_pDrawShader->setIntValue(m_useTerrainLocation, GL_TRUE);
+
+	glBindVertexArray(m_vao);
+	glDrawElementsInstanced(GL_TRIANGLES, m_gridIndexCount, GL_UNSIGNED_INT, (void*)0, m_nodeCount);
+	glBindVertexArray(0);
+
+	m_pDrawShader->setIntValue(m_useTerrainLocation, GL_FALSE);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for freeing the heights, the
+ *  quadtree and every GL object of the terrain.
+ ***********************************************************/
+void TerrainSystem::Clear()
+{
+	if (m_vao != 0)
+	{
+		GpuMemory::ReleaseObjects(GL_BUFFER, m_buffers, BUFFER_COUNT);
+		glDeleteBuffers(BUFFER_COUNT, m_buffers);
+		glDeleteVertexArrays(1, &m_vao);
+		m_vao = 0;
+		for (int i = 0; i < BUFFER_COUNT; i++)
+		{
+			m_buffers[i] = 0;
+		}
+	}
+	if (m_heightTexture != 0)
+	{
+		GpuMemory::ReleaseObject(GL_TEXTURE, m_heightTexture);
+		glDeleteTextures(1, &m_heightTexture);
+		m_heightTexture = 0;
+	}
+
+	std::vector<float>().swap(m_heights);
+	m_levelBounds.clear();
+	m_resolution = 0;
+	m_size = 0.0f;
+	m_levelCount = 0;
+	m_pDrawShader = NULL;
+	m_gridIndexCount = 0;
+	m_nodeCount = 0;
+	m_bUploaded = false;
+}
@@ -0,0 +1,191 @@
+///////////////////////////////////////////////////////////////////////////////
+// terrainsystem.h
+// ============
+// heightmap terrain split into a quadtree of chunks, all drawn with one
+// shared grid mesh that the vertex shader displaces and morphs between
+// levels of detail
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameArena.h"
+#include "ShaderManager.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  TERRAIN_NODE
+ *
+ *  One quadtree chunk drawn this frame, laid out as its
+ *  per-instance vertex attribute.  The level is the level
+ *  of detail whose grid spacing and morph range the chunk
+ *  is drawn with, which is one above its own size for the
+ *  quarters of a chunk whose children are out of range.
+ ***********************************************************/
+struct TERRAIN_NODE
+{
+	// x z of the corner with the lowest coordinates
+	glm::vec2 corner;
+	float size;
+	float level;
+};
+
+/***********************************************************
+ *  TerrainSystem
+ *
+ *  The heights are a square grid of samples, generated
+ *  from fractal noise or read from a greyscale heightmap,
+ *  and kept both on the CPU, for GetHeight() and the chunk
+ *  bounds, and in a float texture that the vertex shader
+ *  samples.
+ *
+ *  The terrain is covered by a quadtree whose leaves are
+ *  the finest level of detail.  Every frame SelectNodes()
+ *  walks it from the root and picks the coarsest chunks
+ *  that are within the range of their level around the
+ *  camera, with the ranges doubling from level to level.
+ *  Every chunk is drawn with the same grid of quads by a
+ *  single instanced draw.  Near the end of its range a
+ *  level morphs its vertices onto the grid of the next
+ *  level, so that the seams between levels match and the
+ *  switch does not pop, and a skirt hanging down from the
+ *  edges of every chunk hides what cracks are left.  The
+ *  number of chunks drawn is capped, which bounds the
+ *  triangles of the terrain whatever its size.
+ *
+ *  SelectNodes() only reads the quadtree, so it can run on
+ *  the main thread.  Upload(), UploadNodes(), Draw() and
+ *  Clear() must run on the thread that owns the OpenGL
+ *  context.
+ ***********************************************************/
+class TerrainSystem
+{
+public:
+	// constructor
+	TerrainSystem();
+	// destructor
+	~TerrainSystem();
+
+	// fill the heights with fractal noise - the terrain is a
+	// square of the passed in side length, centered on the
+	// origin, with the passed in number of samples per side
+	bool GenerateHeights(float size, int resolution, float heightScale, float featureSize, uint32_t seed);
+	// fill the heights from a greyscale image, white being
+	// the passed in height
+	bool LoadHeightmap(const char* filename, float size, float heightScale);
+	// bring the heights down to zero inside the passed in x z
+	// rectangle, rising back over the blend distance around it
+	void FlattenArea(const glm::vec2& areaMin, const glm::vec2& areaMax, float blendDistance);
+
+	// height of the surface at a point, as the shader draws it
+	float GetHeight(float x, float z) const;
+
+	// build the quadtree bounds, the height texture and the
+	// grid mesh, and set the constant terrain values of the
+	// passed in shaders, which are the ones the terrain is
+	// drawn with - the texture is repeated by the UV scale
+	// per unit
+	bool Upload(ShaderManager* pDrawShader, const glm::vec2& UVscale);
+	// free the heights, the quadtree and the GL objects
+	void Clear();
+
+	// most chunks drawn in one frame
+	int GetMaxNodeCount() const { return MAX_DRAWN_NODES; }
+	int GetTrianglesPerNode() const;
+	int GetLevelCount() const { return m_levelCount; }
+	// height texture and its placement, x z of the lowest
+	// corner, side length and samples per side, for other
+	// shaders that sample the ground
+	GLuint GetHeightTexture() const { return m_heightTexture; }
+	glm::vec4 GetArea() const { return glm::vec4(m_areaMin, m_size, (float)m_resolution); }
+
+	// pick the chunks to draw for the passed in camera - the
+	// list must have room for GetMaxNodeCount() entries, as
+	// this does not grow it
+	void SelectNodes(
+		const glm::mat4& viewProjection,
+		const glm::vec3& viewPosition,
+		ArenaArray<TERRAIN_NODE>& nodes) const;
+
+	// copy the chunks picked for a frame into the node buffer
+	void UploadNodes(const ArenaArray<TERRAIN_NODE>& nodes);
+	// draw the uploaded chunks with the shaders passed to
+	// Upload(), which must be in use, sampling the heights
+	// from the passed in texture unit
+	void Draw(GLint textureUnit) const;
+
+private:
+	// height range of the chunks of one level, row by row
+	struct LEVEL_BOUNDS
+	{
+		int nodesPerSide;
+		std::vector<glm::vec2> minMax;
+	};
+
+	// state of one walk of the quadtree
+	struct SELECTION
+	{
+		glm::vec4 planes[6];
+		glm::vec3 viewPosition;
+		ArenaArray<TERRAIN_NODE>* pNodes;
+		size_t nodeCount;
+	};
+
+	enum TERRAIN_BUFFER
+	{
+		BUFFER_GRID_VERTICES = 0,
+		BUFFER_GRID_INDICES,
+		BUFFER_NODES,
+		BUFFER_COUNT
+	};
+
+	// quads along the side of the shared grid
+	static const int GRID_SIZE = 32;
+	// levels of detail the vertex shader has morph ranges for
+	static const int MAX_LEVELS = 8;
+	static const int MAX_DRAWN_NODES = 256;
+
+	// heights, row by row from the lowest z
+	std::vector<float> m_heights;
+	int m_resolution;
+	float m_size;
+	glm::vec2 m_areaMin;
+
+	// quadtree, from the leaves up
+	int m_levelCount;
+	float m_leafSize;
+	float m_levelRanges[MAX_LEVELS];
+	std::vector<LEVEL_BOUNDS> m_levelBounds;
+
+	ShaderManager* m_pDrawShader;
+	GLint m_useTerrainLocation;
+	GLint m_heightsLocation;
+	GLuint m_vao;
+	GLuint m_buffers[BUFFER_COUNT];
+	GLuint m_heightTexture;
+	GLsizei m_gridIndexCount;
+	// number of chunks uploaded for the frame being drawn
+	GLsizei m_nodeCount;
+	bool m_bUploaded;
+
+	// height of one sample, clamped to the grid
+	float GetSample(int x, int z) const;
+	// build the height range of every chunk of every level
+	void BuildLevelBounds();
+	// select one chunk or its children, returns false when
+	// the chunk is out of the range of its level
+	bool SelectNode(SELECTION& selection, int level, int x, int z) const;
+	// add a chunk, or part of one, when it is in the frustum
+	void AddNode(SELECTION& selection, const glm::vec2& corner, float size, int level, const glm::vec2& heightRange) const;
+
+	// systems own GL objects and must not be copied
+	TerrainSystem(const TerrainSystem&) = delete;
+	TerrainSystem& operator=(const TerrainSystem&) = delete;
+};
@@ -0,0 +1,297 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureatlas.cpp
+// ============
+// skyline packing of small images into a shared texture atlas, with a
+// gutter around every image that stays wide enough for its mipmaps
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureAtlas.h"
+
+#include <algorithm>
+#include <cstdint>
+
+/***********************************************************
+ *  TextureAtlas()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureAtlas::TextureAtlas(int gutter)
+{
+	m_gutter = std::max(gutter, 0);
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  Pack()
+ *
+ *  This method is used for packing the images into the
+ *  smallest atlas that holds all of them.  The sizes tried
+ *  start at the smallest power of two that holds the
+ *  largest image and the area of all of them, and the
+ *  shorter side is doubled until the images fit.  When they
+ *  do not fit the largest atlas, as many as fit are packed
+ *  into it.
+ ***********************************************************/
+int TextureAtlas::Pack(std::vector<ATLAS_RECT>& rects, int maxSize)
+{
+	m_width = 0;
+	m_height = 0;
+	m_skyline.clear();
+	if (rects.empty() || (maxSize <= 0))
+	{
+		return(0);
+	}
+
+	std::vector<int> order(rects.size());
+	uint64_t area = 0;
+	int largest = 1;
+	for (int i = 0; i < (int)rects.size(); i++)
+	{
+		int width = GetPaddedSize(rects[i].width, m_gutter);
+		int height = GetPaddedSize(rects[i].height, m_gutter);
+		order[i] = i;
+		area += (uint64_t)width * height;
+		largest = std::max(largest, std::max(width, height));
+	}
+
+	// the tallest images go first, so the skyline stays flat
+	std::sort(order.begin(), order.end(), [this, &rects](int a, int b)
+	{
+		int heightA = GetPaddedSize(rects[a].height, m_gutter);
+		int heightB = GetPaddedSize(rects[b].height, m_gutter);
+		if (heightA != heightB)
+		{
+			return(heightA > heightB);
+		}
+		return(GetPaddedSize(rects[a].width, m_gutter) > GetPaddedSize(rects[b].width, m_gutter));
+	});
+
+	int width = 1;
+	while (width < largest)
+	{
+		width *= 2;
+	}
+	width = std::min(width, maxSize);
+	int height = width;
+	while (((uint64_t)width * height < area) && ((width < maxSize) || (height < maxSize)))
+	{
+		if ((width <= height) && (width < maxSize))
+		{
+			width *= 2;
+		}
+		else
+		{
+			height *= 2;
+		}
+	}
+
+	for (;;)
+	{
+		if (PackInto(width, height, rects, order, false))
+		{
+			return (int)rects.size();
+		}
+		if ((width >= maxSize) && (height >= maxSize))
+		{
+			break;
+		}
+		if ((width <= height) && (width < maxSize))
+		{
+			width *= 2;
+		}
+		else
+		{
+			height *= 2;
+		}
+	}
+
+	PackInto(maxSize, maxSize, rects, order, true);
+	int packedCount = 0;
+	for (const ATLAS_RECT& rect : rects)
+	{
+		packedCount += rect.bPacked ? 1 : 0;
+	}
+	return(packedCount);
+}
+
+/***********************************************************
+ *  GetWidth()
+ *
+ *  This method is used for getting the width of the atlas
+ *  the last images were packed into.
+ ***********************************************************/
+int TextureAtlas::GetWidth() const
+{
+	return(m_width);
+}
+
+/***********************************************************
+ *  GetHeight()
+ *
+ *  This method is used for getting the height of the atlas
+ *  the last images were packed into.
+ ***********************************************************/
+int TextureAtlas::GetHeight() const
+{
+	return(m_height);
+}
+
+/***********************************************************
+ *  GetGutter()
+ *
+ *  This method is used for getting the number of texels
+ *  kept free around every image.
+ ***********************************************************/
+int TextureAtlas::GetGutter() const
+{
+	return(m_gutter);
+}
+
+/***********************************************************
+ *  PackInto()
+ *
+ *  This method is used for packing the images into an
+ *  atlas of the given size, starting from an empty
+ *  skyline.
+ ***********************************************************/
+bool TextureAtlas::PackInto(int width, int height, std::vector<ATLAS_RECT>& rects, const std::vector<int>& order, bool bSkipMisfits)
+{
+	m_width = width;
+	m_height = height;
+	m_skyline.clear();
+	m_skyline.push_back({ 0, 0, width });
+
+	for (ATLAS_RECT& rect : rects)
+	{
+		rect.bPacked = false;
+	}
+
+	for (int index : order)
+	{
+		ATLAS_RECT& rect = rects[index];
+		int paddedWidth = GetPaddedSize(rect.width, m_gutter);
+		int paddedHeight = GetPaddedSize(rect.height, m_gutter);
+		int x = 0;
+		int y = 0;
+		int segment = FindPosition(paddedWidth, paddedHeight, x, y);
+		if (segment < 0)
+		{
+			if (bSkipMisfits)
+			{
+				continue;
+			}
+			return(false);
+		}
+
+		AddSkyline(segment, x, y, paddedWidth, paddedHeight);
+		rect.x = x + m_gutter;
+		rect.y = y + m_gutter;
+		rect.bPacked = true;
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  FindPosition()
+ *
+ *  This method is used for finding where a padded image
+ *  lands lowest when its left edge is put on the start of
+ *  one of the skyline segments.  It rests on the highest
+ *  segment under it, and among the places at the same
+ *  height the leftmost is taken.
+ ***********************************************************/
+int TextureAtlas::FindPosition(int width, int height, int& x, int& y) const
+{
+	int bestSegment = -1;
+	int bestY = m_height;
+	for (int i = 0; i < (int)m_skyline.size(); i++)
+	{
+		int left = m_skyline[i].x;
+		if (left + width > m_width)
+		{
+			break;
+		}
+
+		int top = 0;
+		int remaining = width;
+		for (int j = i; remaining > 0; j++)
+		{
+			top = std::max(top, m_skyline[j].y);
+			remaining -= m_skyline[j].width;
+		}
+		if ((top + height <= m_height) && (top < bestY))
+		{
+			bestSegment = i;
+			bestY = top;
+			x = left;
+			y = top;
+		}
+	}
+	return(bestSegment);
+}
+
+/***********************************************************
+ *  AddSkyline()
+ *
+ *  This method is used for raising the skyline to the top
+ *  of a placed image.  The segments it covers are cut back
+ *  or removed, and neighbors of the same height are merged.
+ ***********************************************************/
+void TextureAtlas::AddSkyline(int segment, int x, int y, int width, int height)
+{
+	m_skyline.insert(m_skyline.begin() + segment, { x, y + height, width });
+
+	int right = x + width;
+	int next = segment + 1;
+	while (next < (int)m_skyline.size())
+	{
+		SKYLINE_SEGMENT& covered = m_skyline[next];
+		if (covered.x >= right)
+		{
+			break;
+		}
+		int overlap = right - covered.x;
+		if (overlap >= covered.width)
+		{
+			m_skyline.erase(m_skyline.begin() + next);
+			continue;
+		}
+		covered.x += overlap;
+		covered.width -= overlap;
+		break;
+	}
+
+	for (int i = 0; i + 1 < (int)m_skyline.size();)
+	{
+		if (m_skyline[i].y == m_skyline[i + 1].y)
+		{
+			m_skyline[i].width += m_skyline[i + 1].width;
+			m_skyline.erase(m_skyline.begin() + i + 1);
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+/***********************************************************
+ *  GetPaddedSize()
+ *
+ *  This method is used for working out the space an image
+ *  takes with the gutter on both sides, rounded up to a
+ *  multiple of the gutter.
+ ***********************************************************/
+int TextureAtlas::GetPaddedSize(int size, int gutter)
+{
+	int padded = size + 2 * gutter;
+	if (gutter > 0)
+	{
+		padded = (padded + gutter - 1) / gutter * gutter;
+	}
+	return(padded);
+}
@@ -0,0 +1,86 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureatlas.h
+// ============
+// skyline packing of small images into a shared texture atlas, with a
+// gutter around every image that stays wide enough for its mipmaps
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+
+/***********************************************************
+ *  ATLAS_RECT
+ *
+ *  Size of one image to pack, and where its corner ended
+ *  up in the atlas, inside its gutter.
+ ***********************************************************/
+struct ATLAS_RECT
+{
+	int width;
+	int height;
+	int x;
+	int y;
+	bool bPacked;
+};
+
+/***********************************************************
+ *  TextureAtlas
+ *
+ *  The packer keeps the skyline of the atlas - the height
+ *  of the packed images along its width - and places every
+ *  image where it lands lowest, then furthest left, with
+ *  the tallest images placed first.  Every image takes its
+ *  size plus the gutter on each side, rounded up to a
+ *  multiple of the gutter, so the images and the gutters
+ *  between them still line up on whole texels in the
+ *  mipmap levels down to a gutter of one texel.
+ *
+ *  Pack() tries atlas sizes in powers of two, from the
+ *  smallest that can hold the images up to the given
+ *  largest size, and the images that do not fit the
+ *  largest atlas are left out.
+ ***********************************************************/
+class TextureAtlas
+{
+public:
+	// constructor, with the gutter around every image in texels
+	TextureAtlas(int gutter);
+
+	// pack the images into the smallest atlas that holds them,
+	// returns the number of images packed
+	int Pack(std::vector<ATLAS_RECT>& rects, int maxSize);
+
+	int GetWidth() const;
+	int GetHeight() const;
+	int GetGutter() const;
+
+	// space an image of the given size takes with its gutter
+	static int GetPaddedSize(int size, int gutter);
+
+private:
+	struct SKYLINE_SEGMENT
+	{
+		int x;
+		int y;
+		int width;
+	};
+
+	// pack the images in order into an atlas of the given size,
+	// returns false at the first image that does not fit, or
+	// skips it when bSkipMisfits is set
+	bool PackInto(int width, int height, std::vector<ATLAS_RECT>& rects, const std::vector<int>& order, bool bSkipMisfits);
+	// find the lowest place for a padded image, returns the
+	// segment it starts on or -1
+	int FindPosition(int width, int height, int& x, int& y) const;
+	// raise the skyline under a placed image
+	void AddSkyline(int segment, int x, int y, int width, int height);
+
+	int m_gutter;
+	int m_width;
+	int m_height;
+	std::vector<SKYLINE_SEGMENT> m_skyline;
+};
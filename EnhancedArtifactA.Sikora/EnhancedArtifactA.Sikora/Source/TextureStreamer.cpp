@@ -0,0 +1,944 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestreamer.cpp
+// ============
+// mipmap streaming of the scene textures - the small levels stay resident,
+// and the larger ones are loaded in the background when the objects that
+// use them cover enough of the screen, and dropped again under a budget
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureStreamer.h"
+#include "GLResources.h"
+#include "GpuMemory.h"
+#include "TextureAtlas.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// levels up to this many texels across are loaded with the
+	// texture and never dropped
+	const int g_ResidentLevelSize = 64;
+	// most loads queued by one update, so a sudden need for
+	// many textures is spread over a few frames
+	const int g_MaxLoadsPerUpdate = 2;
+	// tag of the streamed textures in the GPU memory report
+	const char* g_MemoryTag = "scene textures";
+	// the rows of a BMP file are padded to 4 bytes, which is
+	// the padding this unpack alignment skips
+	const GLint g_BmpRowAlignment = 4;
+
+	// box filter of one level into the next, half its size,
+	// with the last row or column of an odd size left out
+	void FilterLevel(
+		const unsigned char* source,
+		int width,
+		int height,
+		int channels,
+		size_t rowBytes,
+		std::vector<unsigned char>& destination)
+	{
+		int levelWidth = (width > 1) ? width / 2 : 1;
+		int levelHeight = (height > 1) ? height / 2 : 1;
+		destination.resize((size_t)levelWidth * levelHeight * channels);
+
+		for (int y = 0; y < levelHeight; y++)
+		{
+			const unsigned char* row0 = source + (size_t)std::min(y * 2, height - 1) * rowBytes;
+			const unsigned char* row1 = source + (size_t)std::min(y * 2 + 1, height - 1) * rowBytes;
+			unsigned char* output = &destination[(size_t)y * levelWidth * channels];
+			for (int x = 0; x < levelWidth; x++)
+			{
+				int x0 = std::min(x * 2, width - 1) * channels;
+				int x1 = std::min(x * 2 + 1, width - 1) * channels;
+				for (int c = 0; c < channels; c++)
+				{
+					output[x * channels + c] = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+				}
+			}
+		}
+	}
+
+	// filter an image down to the requested levels, keeping the
+	// pixels of the levels from the first up to the last - the
+	// rows of the image may be padded, the levels are packed
+	void BuildLevels(
+		const unsigned char* image,
+		int width,
+		int height,
+		int channels,
+		size_t rowBytes,
+		int firstLevel,
+		int lastLevel,
+		std::vector<unsigned char>* levels)
+	{
+		std::vector<unsigned char> filtered[2];
+		const unsigned char* source = image;
+		size_t sourceRowBytes = rowBytes;
+		int levelWidth = width;
+		int levelHeight = height;
+		for (int level = 0; level < lastLevel; level++)
+		{
+			if (level > 0)
+			{
+				FilterLevel(source, levelWidth, levelHeight, channels, sourceRowBytes, filtered[level & 1]);
+				source = filtered[level & 1].data();
+				levelWidth = (levelWidth > 1) ? levelWidth / 2 : 1;
+				levelHeight = (levelHeight > 1) ? levelHeight / 2 : 1;
+				sourceRowBytes = (size_t)levelWidth * channels;
+			}
+			if (level >= firstLevel)
+			{
+				size_t levelRowBytes = (size_t)levelWidth * channels;
+				levels[level].resize(levelRowBytes * levelHeight);
+				for (int y = 0; y < levelHeight; y++)
+				{
+					memcpy(&levels[level][y * levelRowBytes], source + y * sourceRowBytes, levelRowBytes);
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  TextureStreamer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureStreamer::TextureStreamer()
+{
+	m_frameIndex = 0;
+	m_queuedBytes = 0;
+	m_levelsLoaded = 0;
+	m_levelsDropped = 0;
+	m_bShutdown = false;
+	m_stats = TEXTURE_STREAMING_STATS();
+	m_loader = std::thread(&TextureStreamer::LoaderMain, this);
+}
+
+/***********************************************************
+ *  ~TextureStreamer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureStreamer::~TextureStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bShutdown = true;
+	}
+	m_loadQueued.notify_one();
+	m_loader.join();
+
+	for (LEVEL_LOAD* load : m_queuedLoads)
+	{
+		delete load;
+	}
+	for (LEVEL_LOAD* load : m_finishedLoads)
+	{
+		delete load;
+	}
+}
+
+/***********************************************************
+ *  AddTexture()
+ *
+ *  This method is used for loading a texture from an image
+ *  file, as an atlas of the one image without a gutter.
+ ***********************************************************/
+int TextureStreamer::AddTexture(const char* filename, const char* label)
+{
+	TEXTURE_ATLAS_IMAGE image = { filename, 0, 0, 0, 0 };
+	int colorChannels = 0;
+	if (!stbi_info(filename, &image.width, &image.height, &colorChannels))
+	{
+		std::cout << "Could not load image:" << filename << std::endl;
+		return(-1);
+	}
+
+	return(AddAtlas(&image, 1, image.width, image.height, 0, label));
+}
+
+/***********************************************************
+ *  AddAtlas()
+ *
+ *  This method is used for loading a texture composed of
+ *  the images of an atlas.  The whole atlas is decoded and
+ *  filtered, but only the levels up to g_ResidentLevelSize
+ *  texels across are uploaded, and the rest is loaded again
+ *  when it is needed.  The images must all have the number
+ *  of channels of the first one.
+ ***********************************************************/
+int TextureStreamer::AddAtlas(
+	const TEXTURE_ATLAS_IMAGE* images,
+	int imageCount,
+	int width,
+	int height,
+	int gutter,
+	const char* label)
+{
+	if ((imageCount <= 0) || (width <= 0) || (height <= 0))
+	{
+		return(-1);
+	}
+
+	int imageWidth = 0;
+	int imageHeight = 0;
+	int colorChannels = 0;
+	if (!stbi_info(images[0].filename, &imageWidth, &imageHeight, &colorChannels))
+	{
+		std::cout << "Could not load image:" << images[0].filename << std::endl;
+		return(-1);
+	}
+
+	if ((colorChannels != 3) && (colorChannels != 4))
+	{
+		std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
+		return(-1);
+	}
+
+	int levels = GLResources::GetMipLevelCount(width, height);
+	if (levels > TEXTURE_STREAMER_MAX_LEVELS)
+	{
+		std::cout << "ERROR: Image " << label << " is too large to be streamed" << std::endl;
+		return(-1);
+	}
+	// below the level where the gutter is one texel wide the
+	// texels of neighboring images would be blended together
+	if (gutter > 0)
+	{
+		int gutterLevels = 1;
+		for (int texels = gutter; texels > 1; texels /= 2)
+		{
+			gutterLevels++;
+		}
+		levels = std::min(levels, gutterLevels);
+	}
+
+	STREAMED_TEXTURE texture;
+	for (int i = 0; i < imageCount; i++)
+	{
+		const TEXTURE_ATLAS_IMAGE& image = images[i];
+		if ((image.x < 0) || (image.y < 0) || (image.x + image.width > width) || (image.y + image.height > height))
+		{
+			std::cout << "ERROR: Image " << image.filename << " does not fit in " << label << std::endl;
+			return(-1);
+		}
+		texture.images.push_back({ image.filename, image.x, image.y, image.width, image.height });
+	}
+	texture.gutter = gutter;
+
+	// uncompressed BMP files are read in place instead of
+	// decoded, when every image of the texture is one
+	texture.bMappedRows = true;
+	for (int i = 0; (i < imageCount) && texture.bMappedRows; i++)
+	{
+		BmpFile bmp;
+		texture.bMappedRows = bmp.Open(images[i].filename) && (bmp.GetChannels() == colorChannels);
+	}
+	texture.bMappedTopLevel = texture.bMappedRows && (imageCount == 1) && (gutter == 0) &&
+		(images[0].width == width) && (images[0].height == height);
+
+	texture.width = width;
+	texture.height = height;
+	texture.levels = levels;
+	texture.channels = colorChannels;
+	// images with an alpha channel support transparency
+	texture.internalFormat = (colorChannels == 4) ? GL_RGBA8 : GL_RGB8;
+	texture.pixelFormat = (colorChannels == 4) ? GL_RGBA : GL_RGB;
+	if (texture.bMappedRows)
+	{
+		texture.pixelFormat = (colorChannels == 4) ? GL_BGRA : GL_BGR;
+	}
+	texture.residentLevel = 0;
+	while ((texture.residentLevel < levels - 1) &&
+		(std::max(width >> texture.residentLevel, height >> texture.residentLevel) > g_ResidentLevelSize))
+	{
+		texture.residentLevel++;
+	}
+	texture.baseLevel = texture.residentLevel;
+	texture.bLoading = false;
+	for (int level = 0; level < TEXTURE_STREAMER_MAX_LEVELS; level++)
+	{
+		texture.lastNeededFrame[level] = 0;
+	}
+
+	// indicate to always flip images vertically when loaded
+	stbi_set_flip_vertically_on_load(true);
+
+	// the top level of a mapped image is uploaded from the
+	// mapping, and only the levels below it are filtered
+	std::vector<unsigned char> pixels[TEXTURE_STREAMER_MAX_LEVELS];
+	BmpFile source;
+	if (texture.bMappedTopLevel)
+	{
+		if (!source.Open(images[0].filename) || (source.GetWidth() != width) || (source.GetHeight() != height))
+		{
+			std::cout << "Could not load image:" << images[0].filename << std::endl;
+			return(-1);
+		}
+		BuildLevels(source.GetPixels(), width, height, colorChannels, source.GetRowBytes(), std::max(texture.residentLevel, 1), levels, pixels);
+	}
+	else
+	{
+		std::vector<unsigned char> image;
+		int failedImage = ComposeImages(texture.images, width, height, colorChannels, gutter, texture.bMappedRows, image);
+		if (failedImage >= 0)
+		{
+			std::cout << "Could not load image:" << texture.images[failedImage].filename << std::endl;
+			return(-1);
+		}
+		BuildLevels(image.data(), width, height, colorChannels, (size_t)width * colorChannels, texture.residentLevel, levels, pixels);
+	}
+
+	for (const STREAMED_IMAGE& loadedImage : texture.images)
+	{
+		std::cout << "Successfully loaded image:" << loadedImage.filename << ", width:" << loadedImage.width
+			<< ", height:" << loadedImage.height << ", channels:" << colorChannels << std::endl;
+	}
+
+
+	// the levels are mutable storage, so that a level can be
+	// dropped again, and only the resident levels are defined.
+	// They are sampled with trilinear filtering from the base
+	// level down, which is the finest level with pixels
+	texture.ID = GLResources::CreateTexture2D(
+		width, height, texture.internalFormat, texture.pixelFormat, GL_UNSIGNED_BYTE, NULL,
+		GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, true, TEXTURE_MUTABLE, label);
+
+	GLint previousTexture = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+	glBindTexture(GL_TEXTURE_2D, texture.ID);
+
+	// the rows of the small levels are not 4 byte aligned
+	for (int level = texture.residentLevel; level < levels; level++)
+	{
+		if ((level == 0) && texture.bMappedTopLevel)
+		{
+			UploadLevel(texture, level, source.GetPixels(), g_BmpRowAlignment);
+		}
+		else
+		{
+			UploadLevel(texture, level, pixels[level].data(), 1);
+		}
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	// the fourth byte of a 32 bit BMP pixel is padding, so the
+	// texture is read as opaque whatever the byte holds
+	if (texture.bMappedRows && (colorChannels == 4))
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, GL_ONE);
+	}
+	SetBaseLevel(texture);
+
+	glBindTexture(GL_TEXTURE_2D, (GLuint)previousTexture);
+	GpuMemory::TrackObject(GL_TEXTURE, texture.ID, GPU_MEMORY_TEXTURES, g_MemoryTag, GetBaseBytes(texture));
+
+	m_textures.push_back(texture);
+	UpdateStats();
+
+	return (int)m_textures.size() - 1;
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for deleting every texture.  Loads
+ *  still queued are dropped, and a load the loader thread
+ *  is working on is thrown away when it finishes.
+ ***********************************************************/
+void TextureStreamer::Clear()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (LEVEL_LOAD* load : m_queuedLoads)
+		{
+			delete load;
+		}
+		m_queuedLoads.clear();
+		for (LEVEL_LOAD* load : m_finishedLoads)
+		{
+			delete load;
+		}
+		m_finishedLoads.clear();
+	}
+
+	for (STREAMED_TEXTURE& texture : m_textures)
+	{
+		GpuMemory::ReleaseObject(GL_TEXTURE, texture.ID);
+		glDeleteTextures(1, &texture.ID);
+	}
+	m_textures.clear();
+	m_queuedBytes = 0;
+	UpdateStats();
+}
+
+/***********************************************************
+ *  GetTextureCount()
+ *
+ *  This method is used for getting the number of textures.
+ ***********************************************************/
+int TextureStreamer::GetTextureCount() const
+{
+	return (int)m_textures.size();
+}
+
+/***********************************************************
+ *  GetTextureID()
+ *
+ *  This method is used for getting the OpenGL texture of a
+ *  texture, which stays the same while its levels come and
+ *  go.
+ ***********************************************************/
+GLuint TextureStreamer::GetTextureID(int index) const
+{
+	return(m_textures[index].ID);
+}
+
+/***********************************************************
+ *  GetTextureSize()
+ *
+ *  This method is used for getting the number of texels
+ *  across the top level of a texture, along its longer
+ *  side.
+ ***********************************************************/
+int TextureStreamer::GetTextureSize(int index) const
+{
+	return std::max(m_textures[index].width, m_textures[index].height);
+}
+
+/***********************************************************
+ *  GetResidentLevel()
+ *
+ *  This method is used for getting the finest level of a
+ *  texture that is never dropped.
+ ***********************************************************/
+int TextureStreamer::GetResidentLevel(int index) const
+{
+	return(m_textures[index].residentLevel);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for streaming the levels of the
+ *  frame.  The loads the loader thread has finished are
+ *  uploaded first.  Then every level down from the one a
+ *  texture needs is marked as needed for all textures, and
+ *  after that, textures whose base level is coarser than
+ *  needed are queued for a load
+ *  of the missing levels.  A load that does not fit in the
+ *  budget drops levels that are not needed this frame, and
+ *  when that is not enough, only the coarser levels that
+ *  fit are loaded.
+ ***********************************************************/
+void TextureStreamer::Update(const uint8_t* neededLevels, int count)
+{
+	m_frameIndex++;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_uploadLoads.swap(m_finishedLoads);
+	}
+	for (LEVEL_LOAD* load : m_uploadLoads)
+	{
+		m_queuedBytes -= load->queuedBytes;
+		if ((load->texture < (int)m_textures.size()) && (m_textures[load->texture].ID == load->textureID))
+		{
+			m_textures[load->texture].bLoading = false;
+			if (load->bLoaded)
+			{
+				UploadLevels(*load);
+			}
+		}
+		delete load;
+	}
+	m_uploadLoads.clear();
+
+	// every texture is marked before any level is dropped, so
+	// that making room for one texture never drops a level
+	// another texture needs this frame
+	int textureCount = std::min(count, (int)m_textures.size());
+	for (int i = 0; i < textureCount; i++)
+	{
+		STREAMED_TEXTURE& texture = m_textures[i];
+		int neededLevel = std::min((int)neededLevels[i], texture.residentLevel);
+		for (int level = neededLevel; level < texture.levels; level++)
+		{
+			texture.lastNeededFrame[level] = m_frameIndex;
+		}
+	}
+
+	int queuedCount = 0;
+	for (int i = 0; i < textureCount; i++)
+	{
+		STREAMED_TEXTURE& texture = m_textures[i];
+		int neededLevel = std::min((int)neededLevels[i], texture.residentLevel);
+		if ((neededLevel >= texture.baseLevel) || texture.bLoading || (queuedCount == g_MaxLoadsPerUpdate))
+		{
+			continue;
+		}
+
+		// the loads already queued are not tracked yet, but take
+		// their share of the budget
+		uint64_t loadBytes = 0;
+		for (int level = neededLevel; level < texture.baseLevel; level++)
+		{
+			loadBytes += GetLevelBytes(texture, level);
+		}
+		uint64_t headroom = GpuMemory::GetHeadroom();
+		headroom = (headroom > m_queuedBytes) ? headroom - m_queuedBytes : 0;
+		if (loadBytes > headroom)
+		{
+			headroom += DropLevels(loadBytes - headroom);
+		}
+		while ((neededLevel < texture.baseLevel) && (loadBytes > headroom))
+		{
+			loadBytes -= GetLevelBytes(texture, neededLevel);
+			neededLevel++;
+		}
+		if (neededLevel >= texture.baseLevel)
+		{
+			continue;
+		}
+
+		LEVEL_LOAD* load = new LEVEL_LOAD();
+		load->texture = i;
+		load->textureID = texture.ID;
+		load->images = texture.images;
+		load->gutter = texture.gutter;
+		load->bMappedRows = texture.bMappedRows;
+		load->bMappedTopLevel = texture.bMappedTopLevel;
+		load->width = texture.width;
+		load->height = texture.height;
+		load->channels = texture.channels;
+		load->firstLevel = neededLevel;
+		load->lastLevel = texture.baseLevel;
+		load->queuedBytes = loadBytes;
+		load->bLoaded = false;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_queuedLoads.push_back(load);
+		}
+		m_loadQueued.notify_one();
+
+		texture.bLoading = true;
+		m_queuedBytes += loadBytes;
+		queuedCount++;
+	}
+
+	UpdateStats();
+}
+
+/***********************************************************
+ *  DropLevels()
+ *
+ *  This method is used for freeing memory by dropping the
+ *  base levels of the textures, starting with the level
+ *  whose last need is the oldest, and among levels needed
+ *  equally long ago with the largest.  Levels needed this
+ *  frame, the resident levels and textures being loaded
+ *  are left alone.
+ ***********************************************************/
+uint64_t TextureStreamer::DropLevels(uint64_t bytes)
+{
+	uint64_t freedBytes = 0;
+	while (freedBytes < bytes)
+	{
+		int oldest = -1;
+		for (int i = 0; i < (int)m_textures.size(); i++)
+		{
+			const STREAMED_TEXTURE& texture = m_textures[i];
+			if (texture.bLoading || (texture.baseLevel >= texture.residentLevel) ||
+				(texture.lastNeededFrame[texture.baseLevel] == m_frameIndex))
+			{
+				continue;
+			}
+			if (oldest < 0)
+			{
+				oldest = i;
+				continue;
+			}
+
+			const STREAMED_TEXTURE& candidate = m_textures[oldest];
+			uint32_t lastNeeded = texture.lastNeededFrame[texture.baseLevel];
+			uint32_t candidateLastNeeded = candidate.lastNeededFrame[candidate.baseLevel];
+			if ((lastNeeded < candidateLastNeeded) ||
+				((lastNeeded == candidateLastNeeded) &&
+					(GetLevelBytes(texture, texture.baseLevel) > GetLevelBytes(candidate, candidate.baseLevel))))
+			{
+				oldest = i;
+			}
+		}
+		if (oldest < 0)
+		{
+			break;
+		}
+
+		freedBytes += GetLevelBytes(m_textures[oldest], m_textures[oldest].baseLevel);
+		DropBaseLevel(oldest);
+	}
+
+	if (freedBytes > 0)
+	{
+		UpdateStats();
+	}
+	return(freedBytes);
+}
+
+/***********************************************************
+ *  EvictLevels()
+ *
+ *  This method is called by the GPU memory accounting when
+ *  the budget is exceeded.
+ ***********************************************************/
+uint64_t TextureStreamer::EvictLevels(void* context, uint64_t bytesOverBudget)
+{
+	TextureStreamer* pStreamer = static_cast<TextureStreamer*>(context);
+	return(pStreamer->DropLevels(bytesOverBudget));
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for reading the residency of the
+ *  textures as of the last update.
+ ***********************************************************/
+TEXTURE_STREAMING_STATS TextureStreamer::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return(m_stats);
+}
+
+/***********************************************************
+ *  LoaderMain()
+ *
+ *  This method runs on the loader thread.  It decodes the
+ *  queued loads one at a time, in the order they were
+ *  queued, until the streamer is destroyed.
+ ***********************************************************/
+void TextureStreamer::LoaderMain()
+{
+	// the loader flips its images without touching the flag
+	// of the threads that load other images
+	stbi_set_flip_vertically_on_load_thread(true);
+
+	for (;;)
+	{
+		LEVEL_LOAD* load = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_loadQueued.wait(lock, [this]
+			{
+				return (m_bShutdown || !m_queuedLoads.empty());
+			});
+			if (m_bShutdown)
+			{
+				return;
+			}
+			load = m_queuedLoads.front();
+			m_queuedLoads.pop_front();
+		}
+
+		load->bLoaded = DecodeLevels(*load);
+		if (!load->bLoaded)
+		{
+			std::cout << "WARNING: Could not stream image:" << load->images.front().filename << std::endl;
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_finishedLoads.push_back(load);
+	}
+}
+
+/***********************************************************
+ *  ComposeImages()
+ *
+ *  This method is used for decoding the images of a
+ *  texture into its top level.  The gutter around each
+ *  image, up to the space the atlas packer kept for it, is
+ *  filled by repeating the image, so that sampling across
+ *  the edge of a wrapped image reads the texels it wraps
+ *  to.  An image that changed size since it was placed is
+ *  not used.
+ ***********************************************************/
+int TextureStreamer::ComposeImages(
+	const std::vector<STREAMED_IMAGE>& images,
+	int width,
+	int height,
+	int channels,
+	int gutter,
+	bool bMappedRows,
+	std::vector<unsigned char>& pixels)
+{
+	pixels.assign((size_t)width * height * channels, 0);
+
+	for (int i = 0; i < (int)images.size(); i++)
+	{
+		const STREAMED_IMAGE& image = images[i];
+		int imageWidth = 0;
+		int imageHeight = 0;
+		size_t sourceRowBytes = 0;
+		const unsigned char* data = nullptr;
+
+		// the rows of a mapped BMP file are bottom first already,
+		// like the rows stb_image flips
+		BmpFile bmp;
+		unsigned char* decoded = nullptr;
+		if (bMappedRows)
+		{
+			if (bmp.Open(image.filename.c_str()) && (bmp.GetChannels() == channels))
+			{
+				data = bmp.GetPixels();
+				imageWidth = bmp.GetWidth();
+				imageHeight = bmp.GetHeight();
+				sourceRowBytes = bmp.GetRowBytes();
+			}
+		}
+		else
+		{
+			int colorChannels = 0;
+			decoded = stbi_load(image.filename.c_str(), &imageWidth, &imageHeight, &colorChannels, channels);
+			data = decoded;
+			sourceRowBytes = (size_t)imageWidth * channels;
+		}
+		if (!data)
+		{
+			return(i);
+		}
+		if ((imageWidth != image.width) || (imageHeight != image.height))
+		{
+			stbi_image_free(decoded);
+			return(i);
+		}
+
+		int right = TextureAtlas::GetPaddedSize(imageWidth, gutter) - gutter;
+		int bottom = TextureAtlas::GetPaddedSize(imageHeight, gutter) - gutter;
+		size_t rowBytes = (size_t)imageWidth * channels;
+		for (int y = -gutter; y < bottom; y++)
+		{
+			int atlasY = image.y + y;
+			if ((atlasY < 0) || (atlasY >= height))
+			{
+				continue;
+			}
+
+			int sourceY = ((y % imageHeight) + imageHeight) % imageHeight;
+			const unsigned char* source = data + (size_t)sourceY * sourceRowBytes;
+			unsigned char* row = &pixels[(size_t)atlasY * width * channels];
+			memcpy(row + (size_t)image.x * channels, source, rowBytes);
+
+			// the gutter on the left, then on the right of the row
+			int gutterStart[2] = { -gutter, imageWidth };
+			int gutterEnd[2] = { 0, right };
+			for (int side = 0; side < 2; side++)
+			{
+				for (int x = gutterStart[side]; x < gutterEnd[side]; x++)
+				{
+					int atlasX = image.x + x;
+					if ((atlasX >= 0) && (atlasX < width))
+					{
+						int sourceX = ((x % imageWidth) + imageWidth) % imageWidth;
+						memcpy(row + (size_t)atlasX * channels, source + (size_t)sourceX * channels, channels);
+					}
+				}
+			}
+		}
+		stbi_image_free(decoded);
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  DecodeLevels()
+ *
+ *  This method is used for decoding the images of a load
+ *  and filtering them down to the levels of the load.
+ ***********************************************************/
+bool TextureStreamer::DecodeLevels(LEVEL_LOAD& load)
+{
+	if (load.bMappedTopLevel)
+	{
+		BmpFile& source = load.source;
+		if (!source.Open(load.images[0].filename.c_str()) || (source.GetChannels() != load.channels) ||
+			(source.GetWidth() != load.width) || (source.GetHeight() != load.height))
+		{
+			return(false);
+		}
+
+		BuildLevels(source.GetPixels(), load.width, load.height, load.channels, source.GetRowBytes(),
+			std::max(load.firstLevel, 1), load.lastLevel, load.pixels);
+		// the mapping is only kept for a load of the top level
+		if (load.firstLevel > 0)
+		{
+			source.Close();
+		}
+		return(true);
+	}
+
+	std::vector<unsigned char> image;
+	if (ComposeImages(load.images, load.width, load.height, load.channels, load.gutter, load.bMappedRows, image) >= 0)
+	{
+		return(false);
+	}
+
+	BuildLevels(image.data(), load.width, load.height, load.channels, (size_t)load.width * load.channels,
+		load.firstLevel, load.lastLevel, load.pixels);
+	return(true);
+}
+
+/***********************************************************
+ *  UploadLevels()
+ *
+ *  This method is used for uploading the levels of a
+ *  finished load and moving the base level of the texture
+ *  up to them.
+ ***********************************************************/
+void TextureStreamer::UploadLevels(const LEVEL_LOAD& load)
+{
+	STREAMED_TEXTURE& texture = m_textures[load.texture];
+	if (texture.baseLevel != load.lastLevel)
+	{
+		return;
+	}
+
+	GLint previousTexture = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+	glBindTexture(GL_TEXTURE_2D, texture.ID);
+
+	for (int level = load.firstLevel; level < load.lastLevel; level++)
+	{
+		if ((level == 0) && load.bMappedTopLevel)
+		{
+			UploadLevel(texture, level, load.source.GetPixels(), g_BmpRowAlignment);
+		}
+		else
+		{
+			UploadLevel(texture, level, load.pixels[level].data(), 1);
+		}
+		GpuMemory::CountUpload(GetLevelBytes(texture, level));
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	texture.baseLevel = load.firstLevel;
+	SetBaseLevel(texture);
+	glBindTexture(GL_TEXTURE_2D, (GLuint)previousTexture);
+
+	GpuMemory::ResizeObject(GL_TEXTURE, texture.ID, GPU_MEMORY_TEXTURES, g_MemoryTag, GetBaseBytes(texture));
+	m_levelsLoaded += load.lastLevel - load.firstLevel;
+}
+
+/***********************************************************
+ *  UploadLevel()
+ *
+ *  This method is used for giving one level of the bound
+ *  texture its pixels.  The packed levels filtered into
+ *  memory have an alignment of 1, and the rows of a mapped
+ *  BMP file the alignment of their padding, so the driver
+ *  reads either without a copy to repack the rows.
+ ***********************************************************/
+void TextureStreamer::UploadLevel(const STREAMED_TEXTURE& texture, int level, const unsigned char* pixels, GLint alignment)
+{
+	glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+	glTexImage2D(GL_TEXTURE_2D, level, texture.internalFormat, std::max(1, texture.width >> level), std::max(1, texture.height >> level),
+		0, texture.pixelFormat, GL_UNSIGNED_BYTE, pixels);
+}
+
+/***********************************************************
+ *  DropBaseLevel()
+ *
+ *  This method is used for freeing the base level of a
+ *  texture, by giving it no texels, and moving the base
+ *  level down to the next one.
+ ***********************************************************/
+void TextureStreamer::DropBaseLevel(int index)
+{
+	STREAMED_TEXTURE& texture = m_textures[index];
+
+	GLint previousTexture = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+	glBindTexture(GL_TEXTURE_2D, texture.ID);
+
+	glTexImage2D(GL_TEXTURE_2D, texture.baseLevel, texture.internalFormat, 0, 0, 0, texture.pixelFormat, GL_UNSIGNED_BYTE, NULL);
+	texture.baseLevel++;
+	SetBaseLevel(texture);
+	glBindTexture(GL_TEXTURE_2D, (GLuint)previousTexture);
+
+	GpuMemory::ResizeObject(GL_TEXTURE, texture.ID, GPU_MEMORY_TEXTURES, g_MemoryTag, GetBaseBytes(texture));
+	m_levelsDropped++;
+}
+
+/***********************************************************
+ *  SetBaseLevel()
+ *
+ *  This method is used for clamping the sampled levels of
+ *  the bound texture to the ones that hold pixels.
+ ***********************************************************/
+void TextureStreamer::SetBaseLevel(const STREAMED_TEXTURE& texture)
+{
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.baseLevel);
+}
+
+/***********************************************************
+ *  GetLevelBytes()
+ *
+ *  This method is used for working out the memory of one
+ *  level of a texture.
+ ***********************************************************/
+uint64_t TextureStreamer::GetLevelBytes(const STREAMED_TEXTURE& texture, int level) const
+{
+	return(GpuMemory::GetTextureBytes(std::max(1, texture.width >> level), std::max(1, texture.height >> level), texture.internalFormat, 1));
+}
+
+/***********************************************************
+ *  GetBaseBytes()
+ *
+ *  This method is used for working out the memory of the
+ *  levels of a texture that hold pixels.
+ ***********************************************************/
+uint64_t TextureStreamer::GetBaseBytes(const STREAMED_TEXTURE& texture) const
+{
+	uint64_t bytes = 0;
+	for (int level = texture.baseLevel; level < texture.levels; level++)
+	{
+		bytes += GetLevelBytes(texture, level);
+	}
+	return(bytes);
+}
+
+/***********************************************************
+ *  UpdateStats()
+ *
+ *  This method is used for publishing the residency of
+ *  the textures to GetStats().
+ ***********************************************************/
+void TextureStreamer::UpdateStats()
+{
+	uint64_t residentBytes = 0;
+	uint64_t fullBytes = 0;
+	int pendingLoads = 0;
+	for (const STREAMED_TEXTURE& texture : m_textures)
+	{
+		residentBytes += GetBaseBytes(texture);
+		fullBytes += GpuMemory::GetTextureBytes(texture.width, texture.height, texture.internalFormat, texture.levels);
+		pendingLoads += texture.bLoading ? 1 : 0;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats.textureCount = (int)m_textures.size();
+	m_stats.residentBytes = residentBytes;
+	m_stats.fullBytes = fullBytes;
+	m_stats.pendingLoads = pendingLoads;
+	m_stats.levelsLoaded = m_levelsLoaded;
+	m_stats.levelsDropped = m_levelsDropped;
+}
@@ -0,0 +1,262 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestreamer.h
+// ============
+// mipmap streaming of the scene textures - the small levels stay resident,
+// and the larger ones are loaded in the background when the objects that
+// use them cover enough of the screen, and dropped again under a budget
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "BmpFile.h"
+
+#include <GL/glew.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// most mipmap levels of a streamed texture, enough for a
+// texture of 32768 texels across
+const int TEXTURE_STREAMER_MAX_LEVELS = 16;
+
+/***********************************************************
+ *  TEXTURE_STREAMING_STATS
+ *
+ *  Residency of the streamed textures.  The levels loaded
+ *  and dropped are counted since the textures were added.
+ ***********************************************************/
+struct TEXTURE_STREAMING_STATS
+{
+	int textureCount;
+	uint64_t residentBytes;
+	// bytes the textures would take with every level loaded
+	uint64_t fullBytes;
+	int pendingLoads;
+	uint64_t levelsLoaded;
+	uint64_t levelsDropped;
+};
+
+/***********************************************************
+ *  TEXTURE_ATLAS_IMAGE
+ *
+ *  One image of a texture atlas, by where its corner is in
+ *  the atlas, in texels.
+ ***********************************************************/
+struct TEXTURE_ATLAS_IMAGE
+{
+	const char* filename;
+	int x;
+	int y;
+	int width;
+	int height;
+};
+
+/***********************************************************
+ *  TextureStreamer
+ *
+ *  Only the levels of a texture up to g_ResidentLevelSize
+ *  texels across are uploaded when it is added.  The base
+ *  level of the texture is clamped to the finest level
+ *  that holds pixels, so the sampler never reads a missing
+ *  level, and the texture object never changes, which
+ *  keeps it bound to its unit.  The levels are mutable
+ *  storage, so a dropped level gives its memory back to
+ *  the driver.
+ *
+ *  Each frame the caller passes the finest level every
+ *  texture needs.  A texture missing levels is queued for
+ *  the loader thread, which decodes the image again and
+ *  filters it down to the missing levels, and the levels
+ *  are uploaded on the context thread once they are ready.
+ *  Loads are only started when they fit in the GPU memory
+ *  budget, after dropping the levels that were needed the
+ *  longest time ago.  The same levels are dropped when the
+ *  budget is exceeded by anything else.
+ *
+ *  A texture can also be an atlas of several images of the
+ *  same number of channels.  The gutter around each image
+ *  is filled by repeating the image, and the mipmaps stop
+ *  at the level where the gutter is one texel wide, so that
+ *  no level blends neighboring images.
+ *
+ *  Images that are uncompressed BMP files are not decoded -
+ *  their rows are read in place from the mapped files and
+ *  kept in blue green red order.  The top level of a
+ *  texture of one such image is uploaded straight from the
+ *  mapping, without a single copy, and only the levels
+ *  below it are filtered into memory.
+ *
+ *  Everything but GetStats() is called on the thread that
+ *  owns the context.
+ ***********************************************************/
+class TextureStreamer
+{
+public:
+	// constructor, which starts the loader thread
+	TextureStreamer();
+	// destructor, which stops the loader thread
+	~TextureStreamer();
+
+	// load the small levels of a texture from an image file,
+	// returns the index of the texture or -1
+	int AddTexture(const char* filename, const char* label);
+	// compose the small levels of an atlas from image files,
+	// returns the index of the texture or -1
+	int AddAtlas(
+		const TEXTURE_ATLAS_IMAGE* images,
+		int imageCount,
+		int width,
+		int height,
+		int gutter,
+		const char* label);
+	// delete every texture
+	void Clear();
+
+	int GetTextureCount() const;
+	GLuint GetTextureID(int index) const;
+	// larger side of the top level, in texels
+	int GetTextureSize(int index) const;
+	// finest level that is always resident
+	int GetResidentLevel(int index) const;
+
+	// record the finest level every texture needs this frame,
+	// start loading the missing ones and upload the finished
+	// loads - one entry per texture
+	void Update(const uint8_t* neededLevels, int count);
+	// drop the levels needed the longest time ago until the
+	// bytes are freed, returns the bytes freed
+	uint64_t DropLevels(uint64_t bytes);
+	// GPU memory evict function, which drops levels
+	static uint64_t EvictLevels(void* context, uint64_t bytesOverBudget);
+
+	// residency of the textures - called from any thread
+	TEXTURE_STREAMING_STATS GetStats();
+
+private:
+	// image file placed in a texture
+	struct STREAMED_IMAGE
+	{
+		std::string filename;
+		int x;
+		int y;
+		int width;
+		int height;
+	};
+
+	struct STREAMED_TEXTURE
+	{
+		// the images the texture is composed of - one image at
+		// the corner and no gutter for a texture of its own
+		std::vector<STREAMED_IMAGE> images;
+		int gutter;
+		// every image is an uncompressed BMP file read in place,
+		// and the top level is uploaded from the mapping of the
+		// one image of the texture
+		bool bMappedRows;
+		bool bMappedTopLevel;
+		GLuint ID;
+		// size of level 0, and the number of levels down to 1x1
+		int width;
+		int height;
+		int levels;
+		int channels;
+		GLenum internalFormat;
+		GLenum pixelFormat;
+		// finest level holding pixels, and the finest level
+		// that is never dropped
+		int baseLevel;
+		int residentLevel;
+		// a load of the levels above the base is queued
+		bool bLoading;
+		// last frame each level was needed
+		uint32_t lastNeededFrame[TEXTURE_STREAMER_MAX_LEVELS];
+	};
+
+	// levels of one texture decoded on the loader thread
+	struct LEVEL_LOAD
+	{
+		int texture;
+		GLuint textureID;
+		std::vector<STREAMED_IMAGE> images;
+		int gutter;
+		bool bMappedRows;
+		bool bMappedTopLevel;
+		// mapping the top level is uploaded from, kept open
+		// until the load is uploaded
+		BmpFile source;
+		int width;
+		int height;
+		int channels;
+		// the levels from the first up to, not including, the last
+		int firstLevel;
+		int lastLevel;
+		// memory the levels take once they are uploaded
+		uint64_t queuedBytes;
+		bool bLoaded;
+		std::vector<unsigned char> pixels[TEXTURE_STREAMER_MAX_LEVELS];
+	};
+
+	// body of the loader thread
+	void LoaderMain();
+	// decode the images of a texture into its top level, returns
+	// the index of the image that failed or -1
+	static int ComposeImages(
+		const std::vector<STREAMED_IMAGE>& images,
+		int width,
+		int height,
+		int channels,
+		int gutter,
+		bool bMappedRows,
+		std::vector<unsigned char>& pixels);
+	// decode the images of a load and filter them down to its levels
+	static bool DecodeLevels(LEVEL_LOAD& load);
+	// upload the levels of a finished load
+	void UploadLevels(const LEVEL_LOAD& load);
+	// upload the pixels of one level of the bound texture, with
+	// their rows padded to the alignment
+	void UploadLevel(const STREAMED_TEXTURE& texture, int level, const unsigned char* pixels, GLint alignment);
+	// take the base level off a texture
+	void DropBaseLevel(int index);
+	// point the texture at its finest level holding pixels
+	void SetBaseLevel(const STREAMED_TEXTURE& texture);
+	// bytes of one level, and of the levels holding pixels
+	uint64_t GetLevelBytes(const STREAMED_TEXTURE& texture, int level) const;
+	uint64_t GetBaseBytes(const STREAMED_TEXTURE& texture) const;
+	// publish the residency for GetStats()
+	void UpdateStats();
+
+	std::vector<STREAMED_TEXTURE> m_textures;
+	// counts the calls of Update()
+	uint32_t m_frameIndex;
+	// memory of the loads that are not uploaded yet
+	uint64_t m_queuedBytes;
+	uint64_t m_levelsLoaded;
+	uint64_t m_levelsDropped;
+	// finished loads taken from the loader thread, kept to
+	// reuse its memory
+	std::vector<LEVEL_LOAD*> m_uploadLoads;
+
+	// loads waiting for the loader thread, and the loads it
+	// has finished, guarded by the mutex
+	std::thread m_loader;
+	std::mutex m_mutex;
+	std::condition_variable m_loadQueued;
+	std::deque<LEVEL_LOAD*> m_queuedLoads;
+	std::vector<LEVEL_LOAD*> m_finishedLoads;
+	bool m_bShutdown;
+
+	// residency for GetStats(), guarded by the mutex
+	TEXTURE_STREAMING_STATS m_stats;
+
+	// the loader thread works on this object
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+};
@@ -0,0 +1,125 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationcounter.cpp
+// ============
+// count global heap allocations in debug builds, so that frames which
+// should not touch the heap can be checked
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _DEBUG
+
+// declaration of global variables
+namespace
+{
+	std::atomic<uint64_t> g_TotalAllocations(0);
+	thread_local uint64_t tls_ThreadAllocations = 0;
+
+	/***********************************************************
+	 *  CountedAllocate()
+	 *
+	 *  Shared body of the replaced operator new variants.
+	 ***********************************************************/
+	void* CountedAllocate(size_t size)
+	{
+		g_TotalAllocations.fetch_add(1, std::memory_order_relaxed);
+		tls_ThreadAllocations++;
+
+		if (size == 0)
+		{
+			size = 1;
+		}
+		return std::malloc(size);
+	}
+}
+
+void* operator new(size_t size)
+{
+	void* pointer = CountedAllocate(size);
+	if (pointer == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return pointer;
+}
+
+void* operator new[](size_t size)
+{
+	void* pointer = CountedAllocate(size);
+	if (pointer == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return pointer;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedAllocate(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t size) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t size) noexcept
+{
+	std::free(pointer);
+}
+
+bool AllocationCounter::IsEnabled()
+{
+	return(true);
+}
+
+uint64_t AllocationCounter::GetTotalAllocations()
+{
+	return g_TotalAllocations.load(std::memory_order_relaxed);
+}
+
+uint64_t AllocationCounter::GetThreadAllocations()
+{
+	return tls_ThreadAllocations;
+}
+
+#else
+
+bool AllocationCounter::IsEnabled()
+{
+	return(false);
+}
+
+uint64_t AllocationCounter::GetTotalAllocations()
+{
+	return(0);
+}
+
+uint64_t AllocationCounter::GetThreadAllocations()
+{
+	return(0);
+}
+
+#endif
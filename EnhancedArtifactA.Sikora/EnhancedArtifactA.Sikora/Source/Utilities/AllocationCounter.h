@@ -0,0 +1,31 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationcounter.h
+// ============
+// count global heap allocations in debug builds, so that frames which
+// should not touch the heap can be checked
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+/***********************************************************
+ *  AllocationCounter
+ *
+ *  In debug builds the global operator new is replaced by a
+ *  version that counts every call, both in total and per
+ *  thread.  In release builds the counters always read zero
+ *  and nothing is replaced.
+ ***********************************************************/
+namespace AllocationCounter
+{
+	// true when the counting operator new is compiled in
+	bool IsEnabled();
+	// heap allocations made by all threads so far
+	uint64_t GetTotalAllocations();
+	// heap allocations made by the calling thread so far
+	uint64_t GetThreadAllocations();
+}
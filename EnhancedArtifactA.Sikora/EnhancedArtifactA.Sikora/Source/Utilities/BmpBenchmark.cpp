@@ -0,0 +1,200 @@
+///////////////////////////////////////////////////////////////////////////////
+// bmpbenchmark.cpp
+// ============
+// time reading BMP textures in place from a memory mapped file against
+// decoding them with stb_image, and check that both give the same pixels
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BmpBenchmark.h"
+#include "BmpFile.h"
+
+#include "stb_image.h"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	typedef std::chrono::duration<double, std::milli> MILLISECONDS;
+
+	// bytes skipped between the bytes read from a mapped row,
+	// one cache line, so that every page of the file is read
+	const int g_TouchStride = 64;
+
+	/***********************************************************
+	 *  TimeDecode()
+	 *
+	 *  Decodes a file with stb_image the way the texture
+	 *  loaders did, flipped and copied once, and returns the
+	 *  average time in milliseconds, or -1 on failure.
+	 ***********************************************************/
+	double TimeDecode(const char* filename, int channels, int repetitions, unsigned int& checksum)
+	{
+		stbi_set_flip_vertically_on_load(true);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int i = 0; i < repetitions; i++)
+		{
+			int width = 0;
+			int height = 0;
+			int colorChannels = 0;
+			unsigned char* image = stbi_load(filename, &width, &height, &colorChannels, channels);
+			if (image == NULL)
+			{
+				return(-1.0);
+			}
+			std::vector<unsigned char> pixels(image, image + (size_t)width * height * channels);
+			checksum += pixels[0];
+			stbi_image_free(image);
+		}
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+		return(MILLISECONDS(end - start).count() / repetitions);
+	}
+
+	/***********************************************************
+	 *  TimeMapping()
+	 *
+	 *  Maps a file with BmpFile and reads its rows the way an
+	 *  upload from the mapping would, and returns the average
+	 *  time in milliseconds, or -1 on failure.
+	 ***********************************************************/
+	double TimeMapping(const char* filename, int repetitions, unsigned int& checksum)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int i = 0; i < repetitions; i++)
+		{
+			BmpFile bmp;
+			if (!bmp.Open(filename))
+			{
+				return(-1.0);
+			}
+			int rowLength = bmp.GetWidth() * bmp.GetChannels();
+			for (int y = 0; y < bmp.GetHeight(); y++)
+			{
+				const unsigned char* row = bmp.GetPixels() + y * bmp.GetRowBytes();
+				for (int x = 0; x < rowLength; x += g_TouchStride)
+				{
+					checksum += row[x];
+				}
+			}
+		}
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+		return(MILLISECONDS(end - start).count() / repetitions);
+	}
+
+	/***********************************************************
+	 *  CountDifferences()
+	 *
+	 *  Compares the mapped pixels of a file with its decoded
+	 *  pixels and returns the number of pixels whose color
+	 *  differs, or -1 on failure.  The fourth byte of a 32 bit
+	 *  file is padding and is not compared.
+	 ***********************************************************/
+	long CountDifferences(const char* filename)
+	{
+		BmpFile bmp;
+		if (!bmp.Open(filename))
+		{
+			return(-1);
+		}
+
+		int channels = bmp.GetChannels();
+		int width = 0;
+		int height = 0;
+		int colorChannels = 0;
+		stbi_set_flip_vertically_on_load(true);
+		unsigned char* image = stbi_load(filename, &width, &height, &colorChannels, channels);
+		if (image == NULL)
+		{
+			return(-1);
+		}
+		if ((width != bmp.GetWidth()) || (height != bmp.GetHeight()))
+		{
+			stbi_image_free(image);
+			return(-1);
+		}
+
+		long differences = 0;
+		for (int y = 0; y < height; y++)
+		{
+			const unsigned char* row = bmp.GetPixels() + y * bmp.GetRowBytes();
+			for (int x = 0; x < width; x++)
+			{
+				// decoded pixels are red green blue, mapped pixels
+				// blue green red
+				const unsigned char* decoded = image + ((size_t)y * width + x) * channels;
+				const unsigned char* mapped = row + (size_t)x * channels;
+				if ((decoded[0] != mapped[2]) || (decoded[1] != mapped[1]) || (decoded[2] != mapped[0]))
+				{
+					differences++;
+				}
+			}
+		}
+
+		stbi_image_free(image);
+		return(differences);
+	}
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for timing both ways of reading
+ *  every passed in file and comparing their pixels.
+ ***********************************************************/
+bool BmpBenchmark::Run(const char* const* filenames, int fileCount, int repetitions)
+{
+	bool bPassed = true;
+	double decodeTotal = 0.0;
+	double mappingTotal = 0.0;
+	long differenceTotal = 0;
+	// summed from the pixels read, so that the reads cannot be
+	// optimized away
+	unsigned int checksum = 0;
+
+	for (int i = 0; i < fileCount; i++)
+	{
+		BmpFile bmp;
+		if (!bmp.Open(filenames[i]))
+		{
+			std::cout << "WARNING: " << filenames[i] << " cannot be read in place, skipped" << std::endl;
+			bPassed = false;
+			continue;
+		}
+		int width = bmp.GetWidth();
+		int height = bmp.GetHeight();
+		int channels = bmp.GetChannels();
+		bmp.Close();
+
+		double decodeTime = TimeDecode(filenames[i], channels, repetitions, checksum);
+		double mappingTime = TimeMapping(filenames[i], repetitions, checksum);
+		long differences = CountDifferences(filenames[i]);
+		if ((decodeTime < 0.0) || (mappingTime < 0.0) || (differences < 0))
+		{
+			std::cout << "ERROR: " << filenames[i] << " could not be read both ways" << std::endl;
+			bPassed = false;
+			continue;
+		}
+
+		std::cout << "INFO: " << filenames[i] << " " << width << "x" << height << " " << channels * 8
+			<< " bit - CPU read only, stb_image " << decodeTime << " ms, mapped " << mappingTime << " ms, "
+			<< differences << " pixels differ" << std::endl;
+
+		decodeTotal += decodeTime;
+		mappingTotal += mappingTime;
+		differenceTotal += differences;
+	}
+
+	std::cout << "INFO: Total over " << repetitions << " repetitions, CPU read only without the GL upload - stb_image "
+		<< decodeTotal << " ms, mapped " << mappingTotal << " ms, " << differenceTotal << " pixels differ"
+		<< " (checksum " << checksum << ")" << std::endl;
+
+	return(bPassed && (differenceTotal == 0));
+}
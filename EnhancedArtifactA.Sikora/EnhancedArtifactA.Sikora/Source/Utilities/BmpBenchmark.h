@@ -0,0 +1,36 @@
+///////////////////////////////////////////////////////////////////////////////
+// bmpbenchmark.h
+// ============
+// time reading BMP textures in place from a memory mapped file against
+// decoding them with stb_image, and check that both give the same pixels
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/***********************************************************
+ *  BmpBenchmark
+ *
+ *  Every file is read the way the texture loaders used to
+ *  read it, decoded by stb_image with its rows flipped and
+ *  copied once, and the way the texture streamer reads it
+ *  now, mapped with BmpFile and every row touched as the
+ *  driver would read it for an upload.  Each way is timed
+ *  over a number of repetitions and the average is
+ *  reported per file and in total.  The mapped pixels are
+ *  then compared with the decoded ones.
+ *
+ *  Only the CPU side of reading a file is timed.  Neither
+ *  side uploads the pixels, so the cost the driver adds
+ *  for the BGR formats of the mapped rows is not part of
+ *  the numbers, which do not show the whole load.
+ ***********************************************************/
+namespace BmpBenchmark
+{
+	// time and compare the passed in files, returns false
+	// when a file cannot be read both ways or when the
+	// pixels differ
+	bool Run(const char* const* filenames, int fileCount, int repetitions);
+}
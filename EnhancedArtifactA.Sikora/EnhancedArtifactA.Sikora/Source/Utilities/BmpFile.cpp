@@ -0,0 +1,223 @@
+///////////////////////////////////////////////////////////////////////////////
+// bmpfile.cpp
+// ============
+// read the pixels of uncompressed BMP files in place from a memory mapped
+// file, without decoding or copying them
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BmpFile.h"
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// sizes of the file header and the smallest info header
+	const size_t g_FileHeaderSize = 14;
+	const size_t g_InfoHeaderSize = 40;
+	// compression of a file whose pixels are stored as they are
+	const uint32_t g_UncompressedPixels = 0;
+
+	// the headers are little endian and not aligned
+	uint16_t ReadUint16(const unsigned char* data)
+	{
+		return (uint16_t)(data[0] | (data[1] << 8));
+	}
+
+	uint32_t ReadUint32(const unsigned char* data)
+	{
+		return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+	}
+
+	// map a whole file read only, returns null when it cannot
+	// be opened or is empty - the handles are closed right
+	// away, since the view keeps the file mapped
+	const unsigned char* MapFile(const char* filename, size_t& size)
+	{
+		size = 0;
+#ifdef _WIN32
+		HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return(nullptr);
+		}
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || (fileSize.QuadPart == 0))
+		{
+			CloseHandle(file);
+			return(nullptr);
+		}
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		CloseHandle(file);
+		if (mapping == NULL)
+		{
+			return(nullptr);
+		}
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		if (view == NULL)
+		{
+			return(nullptr);
+		}
+		size = (size_t)fileSize.QuadPart;
+		return static_cast<const unsigned char*>(view);
+#else
+		int file = open(filename, O_RDONLY);
+		if (file < 0)
+		{
+			return(nullptr);
+		}
+		struct stat status;
+		if ((fstat(file, &status) != 0) || (status.st_size == 0))
+		{
+			close(file);
+			return(nullptr);
+		}
+		void* view = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		close(file);
+		if (view == MAP_FAILED)
+		{
+			return(nullptr);
+		}
+		size = (size_t)status.st_size;
+		return static_cast<const unsigned char*>(view);
+#endif
+	}
+
+	void UnmapFile(const unsigned char* data, size_t size)
+	{
+#ifdef _WIN32
+		(void)size;
+		UnmapViewOfFile(data);
+#else
+		munmap(const_cast<unsigned char*>(data), size);
+#endif
+	}
+}
+
+/***********************************************************
+ *  BmpFile()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+BmpFile::BmpFile()
+{
+	m_pData = nullptr;
+	m_size = 0;
+	m_pPixels = nullptr;
+	m_width = 0;
+	m_height = 0;
+	m_channels = 0;
+	m_rowBytes = 0;
+}
+
+/***********************************************************
+ *  ~BmpFile()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+BmpFile::~BmpFile()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping a BMP file and checking
+ *  that its pixels can be read as they are.  The headers
+ *  must describe one plane of 24 or 32 bit pixels without
+ *  compression, with a positive height, which stores the
+ *  rows bottom first, and every row must be in the file.
+ ***********************************************************/
+bool BmpFile::Open(const char* filename)
+{
+	Close();
+
+	size_t size = 0;
+	const unsigned char* data = MapFile(filename, size);
+	if (nullptr == data)
+	{
+		return(false);
+	}
+
+	bool bValid = (size >= g_FileHeaderSize + g_InfoHeaderSize) && (data[0] == 'B') && (data[1] == 'M');
+	if (bValid)
+	{
+		const unsigned char* info = data + g_FileHeaderSize;
+		uint32_t pixelOffset = ReadUint32(data + 10);
+		uint32_t infoSize = ReadUint32(info);
+		int32_t width = (int32_t)ReadUint32(info + 4);
+		int32_t height = (int32_t)ReadUint32(info + 8);
+		uint16_t planes = ReadUint16(info + 12);
+		uint16_t bitsPerPixel = ReadUint16(info + 14);
+		uint32_t compression = ReadUint32(info + 16);
+
+		bValid = (infoSize >= g_InfoHeaderSize) && (g_FileHeaderSize + infoSize <= pixelOffset) &&
+			(width > 0) && (height > 0) && (planes == 1) &&
+			((bitsPerPixel == 24) || (bitsPerPixel == 32)) && (compression == g_UncompressedPixels);
+		if (bValid)
+		{
+			uint64_t rowBytes = ((uint64_t)width * bitsPerPixel + 31) / 32 * 4;
+			bValid = ((uint64_t)pixelOffset + rowBytes * (uint64_t)height <= (uint64_t)size);
+			if (bValid)
+			{
+				m_pPixels = data + pixelOffset;
+				m_width = (int)width;
+				m_height = (int)height;
+				m_channels = bitsPerPixel / 8;
+				m_rowBytes = (size_t)rowBytes;
+			}
+		}
+	}
+
+	if (!bValid)
+	{
+		UnmapFile(data, size);
+		return(false);
+	}
+
+	m_pData = data;
+	m_size = size;
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for unmapping the file, after which
+ *  the pixels can no longer be read.
+ ***********************************************************/
+void BmpFile::Close()
+{
+	if (nullptr != m_pData)
+	{
+		UnmapFile(m_pData, m_size);
+	}
+	m_pData = nullptr;
+	m_size = 0;
+	m_pPixels = nullptr;
+	m_width = 0;
+	m_height = 0;
+	m_channels = 0;
+	m_rowBytes = 0;
+}
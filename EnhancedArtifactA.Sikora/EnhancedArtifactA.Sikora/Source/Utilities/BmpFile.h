@@ -0,0 +1,66 @@
+///////////////////////////////////////////////////////////////////////////////
+// bmpfile.h
+// ============
+// read the pixels of uncompressed BMP files in place from a memory mapped
+// file, without decoding or copying them
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+/***********************************************************
+ *  BmpFile
+ *
+ *  The rows of an uncompressed BMP file are stored bottom
+ *  first, in blue green red order, with every row padded
+ *  to a multiple of 4 bytes - which is the layout OpenGL
+ *  reads with the BGR or BGRA formats, its default unpack
+ *  alignment and its first row at the bottom of a texture.
+ *  Open() maps the file and checks its headers, and the
+ *  rows are then used right where they are in the mapping.
+ *
+ *  Only 24 and 32 bit files without compression and with
+ *  their rows bottom first are accepted.  The fourth byte
+ *  of a 32 bit pixel is padding in these files.  Anything
+ *  else is left to a full image decoder.
+ ***********************************************************/
+class BmpFile
+{
+public:
+	// constructor
+	BmpFile();
+	// destructor, which unmaps the file
+	~BmpFile();
+
+	// map a file and check that its pixels can be used as
+	// they are, returns false and maps nothing otherwise
+	bool Open(const char* filename);
+	// unmap the file
+	void Close();
+
+	int GetWidth() const { return m_width; }
+	int GetHeight() const { return m_height; }
+	// bytes per pixel, 3 or 4
+	int GetChannels() const { return m_channels; }
+	// bytes from one row to the next, a multiple of 4
+	size_t GetRowBytes() const { return m_rowBytes; }
+	// the bottom row of the image, or null when no file is open
+	const unsigned char* GetPixels() const { return m_pPixels; }
+
+private:
+	const unsigned char* m_pData;
+	size_t m_size;
+	const unsigned char* m_pPixels;
+	int m_width;
+	int m_height;
+	int m_channels;
+	size_t m_rowBytes;
+
+	// the mapping is owned by one object
+	BmpFile(const BmpFile&) = delete;
+	BmpFile& operator=(const BmpFile&) = delete;
+};
@@ -0,0 +1,141 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.cpp
+// ============
+// linear (bump) allocator for transient data that only lives for one
+// frame, plus a growable array that takes its storage from it
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameArena.h"
+
+#include <cstdlib>
+#include <new>
+
+/***********************************************************
+ *  FrameArena()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameArena::FrameArena(size_t initialCapacity)
+{
+	m_usedBytes = 0;
+	m_highWaterMark = 0;
+
+	// the block list never holds more than a handful of
+	// entries, so reserving keeps it from reallocating
+	m_blocks.reserve(16);
+	AddBlock(initialCapacity);
+}
+
+/***********************************************************
+ *  ~FrameArena()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameArena::~FrameArena()
+{
+	FreeBlocks();
+}
+
+/***********************************************************
+ *  AddBlock()
+ *
+ *  This method is used for chaining on a new block of at
+ *  least the passed in size.  Each new block is at least
+ *  twice as big as the previous one.
+ ***********************************************************/
+void FrameArena::AddBlock(size_t minimumCapacity)
+{
+	size_t capacity = minimumCapacity;
+	if (!m_blocks.empty() && (capacity < m_blocks.back().capacity * 2))
+	{
+		capacity = m_blocks.back().capacity * 2;
+	}
+
+	BLOCK block;
+	block.memory = (unsigned char*)std::malloc(capacity);
+	if (block.memory == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	block.capacity = capacity;
+	block.offset = 0;
+
+	m_blocks.push_back(block);
+}
+
+/***********************************************************
+ *  FreeBlocks()
+ *
+ *  This method is used for freeing every block.
+ ***********************************************************/
+void FrameArena::FreeBlocks()
+{
+	for (BLOCK& block : m_blocks)
+	{
+		std::free(block.memory);
+	}
+	m_blocks.clear();
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for handing out memory from the
+ *  newest block, chaining on another block when the newest
+ *  one is full.
+ ***********************************************************/
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	BLOCK* block = &m_blocks.back();
+
+	uintptr_t start = (uintptr_t)(block->memory + block->offset);
+	uintptr_t aligned = (start + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+	size_t padding = (size_t)(aligned - start);
+
+	if (block->offset + padding + size > block->capacity)
+	{
+		AddBlock(size + alignment);
+		block = &m_blocks.back();
+
+		start = (uintptr_t)block->memory;
+		aligned = (start + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+		padding = (size_t)(aligned - start);
+	}
+
+	block->offset += padding + size;
+	m_usedBytes += padding + size;
+
+	return (void*)aligned;
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method is used for releasing every allocation at
+ *  once.  If the last frame needed extra blocks, they are
+ *  replaced by one block that fits the whole frame.
+ ***********************************************************/
+void FrameArena::Reset()
+{
+	if (m_usedBytes > m_highWaterMark)
+	{
+		m_highWaterMark = m_usedBytes;
+	}
+
+	if (m_blocks.size() > 1)
+	{
+		size_t capacity = 0;
+		for (const BLOCK& block : m_blocks)
+		{
+			capacity += block.capacity;
+		}
+		FreeBlocks();
+		AddBlock(capacity);
+	}
+
+	m_blocks.back().offset = 0;
+	m_usedBytes = 0;
+}
@@ -0,0 +1,146 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.h
+// ============
+// linear (bump) allocator for transient data that only lives for one
+// frame, plus a growable array that takes its storage from it
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/***********************************************************
+ *  FrameArena
+ *
+ *  Hands out memory by bumping an offset into one large
+ *  block, and releases everything at once with Reset().
+ *  When a frame needs more than the block holds, extra
+ *  blocks are chained on; the next Reset() replaces the
+ *  chain with a single block big enough for the whole
+ *  frame, so steady-state frames never touch the heap.
+ ***********************************************************/
+class FrameArena
+{
+public:
+	// constructor
+	FrameArena(size_t initialCapacity = 64 * 1024);
+	// destructor
+	~FrameArena();
+
+	// allocate memory that stays valid until the next Reset()
+	void* Allocate(size_t size, size_t alignment);
+	// release every allocation made since the last Reset()
+	void Reset();
+
+	// bytes handed out since the last Reset()
+	size_t GetUsedBytes() const { return m_usedBytes; }
+	// largest number of bytes any frame has used
+	size_t GetHighWaterMark() const { return m_highWaterMark; }
+
+private:
+	struct BLOCK
+	{
+		unsigned char* memory;
+		size_t capacity;
+		size_t offset;
+	};
+
+	// the first block is the main block, any others were
+	// added because a frame ran out of space
+	std::vector<BLOCK> m_blocks;
+	size_t m_usedBytes;
+	size_t m_highWaterMark;
+
+	// arenas own raw memory and must not be copied
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	// chain on a new block with at least the passed in size
+	void AddBlock(size_t minimumCapacity);
+	// free every block
+	void FreeBlocks();
+};
+
+/***********************************************************
+ *  ArenaArray
+ *
+ *  Growable array whose storage comes from a frame arena.
+ *  Growing copies the elements into a bigger allocation and
+ *  leaves the old one to be released by the next Reset(),
+ *  so it is only meant for plain data types.  Unlike a
+ *  standard container it keeps no hidden bookkeeping
+ *  allocations, which would not survive an arena reset.
+ ***********************************************************/
+template<typename T>
+class ArenaArray
+{
+public:
+	ArenaArray() : m_pArena(nullptr), m_pData(nullptr), m_size(0), m_capacity(0) {}
+
+	// drop the contents and take new storage for at least
+	// the passed in number of elements from the arena - must
+	// be called after the arena has been reset
+	void Reset(FrameArena* pArena, size_t capacity)
+	{
+		m_pArena = pArena;
+		m_pData = nullptr;
+		m_size = 0;
+		m_capacity = 0;
+		reserve(capacity);
+	}
+
+	void reserve(size_t capacity)
+	{
+		if (capacity <= m_capacity)
+		{
+			return;
+		}
+		T* pData = (T*)m_pArena->Allocate(capacity * sizeof(T), alignof(T));
+		if (m_size > 0)
+		{
+			std::memcpy(pData, m_pData, m_size * sizeof(T));
+		}
+		m_pData = pData;
+		m_capacity = capacity;
+	}
+
+	void resize(size_t size)
+	{
+		reserve(size);
+		m_size = size;
+	}
+
+	void push_back(const T& value)
+	{
+		if (m_size == m_capacity)
+		{
+			reserve((m_capacity < 16) ? 32 : (m_capacity * 2));
+		}
+		m_pData[m_size++] = value;
+	}
+
+	void clear() { m_size = 0; }
+
+	size_t size() const { return m_size; }
+	bool empty() const { return (m_size == 0); }
+
+	T& operator[](size_t index) { return m_pData[index]; }
+	const T& operator[](size_t index) const { return m_pData[index]; }
+
+	T* begin() { return m_pData; }
+	T* end() { return m_pData + m_size; }
+	const T* begin() const { return m_pData; }
+	const T* end() const { return m_pData + m_size; }
+
+private:
+	FrameArena* m_pArena;
+	T* m_pData;
+	size_t m_size;
+	size_t m_capacity;
+};
@@ -0,0 +1,351 @@
+///////////////////////////////////////////////////////////////////////////////
+// gldebug.cpp
+// ============
+// OpenGL debug output - counts the errors and the performance warnings the
+// driver reports, per render pass, and names objects and passes for tools
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GLDebug.h"
+
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+// declaration of global variables
+namespace
+{
+	// deepest nesting of debug groups that is tracked
+	const int g_MaxGroupDepth = 8;
+	// performance warnings printed once each, by message ID
+	const int g_MaxPrintedWarnings = 64;
+	// marks a group outside of any counted pass
+	const int g_NoPass = -1;
+
+	bool g_bInstalled = false;
+
+	std::atomic<uint64_t> g_errors(0);
+	std::atomic<uint64_t> g_performanceWarnings(0);
+	std::atomic<uint64_t> g_shaderRecompiles(0);
+	std::atomic<uint64_t> g_bufferStalls(0);
+	std::atomic<uint64_t> g_otherWarnings(0);
+
+	// passes are added the first time they are pushed and kept
+	// for the lifetime of the program
+	const char* g_passNames[GL_DEBUG_MAX_PASSES];
+	std::atomic<uint64_t> g_passWarnings[GL_DEBUG_MAX_PASSES];
+	std::atomic<int> g_passCount(0);
+
+	// group stack of the render thread, and the pass of its top
+	// for the callback, which may run on a driver thread
+	int g_groupPasses[g_MaxGroupDepth];
+	int g_groupDepth = 0;
+	std::atomic<int> g_currentPass(g_NoPass);
+
+	// message IDs of the performance warnings already printed
+	std::mutex g_printMutex;
+	GLuint g_printedWarnings[g_MaxPrintedWarnings];
+	int g_printedWarningCount = 0;
+
+	// case insensitive search of a word in a message
+	bool MessageContains(const GLchar* message, const char* word)
+	{
+		size_t wordLength = strlen(word);
+		for (const GLchar* start = message; *start != '\0'; start++)
+		{
+			size_t i = 0;
+			while ((i < wordLength) && (start[i] != '\0') && (tolower((unsigned char)start[i]) == word[i]))
+			{
+				i++;
+			}
+			if (i == wordLength)
+			{
+				return(true);
+			}
+		}
+		return(false);
+	}
+
+	// whether a performance warning is printed, the first time
+	// its message ID is seen
+	bool FirstTimeSeen(GLuint id)
+	{
+		std::lock_guard<std::mutex> lock(g_printMutex);
+		for (int i = 0; i < g_printedWarningCount; i++)
+		{
+			if (g_printedWarnings[i] == id)
+			{
+				return(false);
+			}
+		}
+		if (g_printedWarningCount == g_MaxPrintedWarnings)
+		{
+			return(false);
+		}
+		g_printedWarnings[g_printedWarningCount++] = id;
+		return(true);
+	}
+
+	// slot of a pass, added when it is first seen, or g_NoPass
+	// when all of the slots are taken
+	int FindPass(const char* name)
+	{
+		int passCount = g_passCount.load(std::memory_order_acquire);
+		for (int i = 0; i < passCount; i++)
+		{
+			if ((g_passNames[i] == name) || (strcmp(g_passNames[i], name) == 0))
+			{
+				return(i);
+			}
+		}
+		if (passCount == GL_DEBUG_MAX_PASSES)
+		{
+			return(g_NoPass);
+		}
+		g_passNames[passCount] = name;
+		g_passWarnings[passCount].store(0, std::memory_order_relaxed);
+		g_passCount.store(passCount + 1, std::memory_order_release);
+		return(passCount);
+	}
+
+	// name of the current pass for the printed messages
+	const char* CurrentPassName()
+	{
+		int pass = g_currentPass.load(std::memory_order_relaxed);
+		return (pass == g_NoPass) ? "no pass" : g_passNames[pass];
+	}
+
+	/***********************************************************
+	 *  DebugMessageCallback()
+	 *
+	 *  This function is called by the driver for every debug
+	 *  message.  The messages are sorted by type into the
+	 *  counters, and performance warnings also by what the
+	 *  driver says it had to do.
+	 ***********************************************************/
+	void GLAPIENTRY DebugMessageCallback(
+		GLenum source,
+		GLenum type,
+		GLuint id,
+		GLenum severity,
+		GLsizei length,
+		const GLchar* message,
+		const void* userParam)
+	{
+		// the source is told apart by the message itself, which
+		// is terminated, and no user data is installed
+		(void)source;
+		(void)length;
+		(void)userParam;
+
+		switch (type)
+		{
+		case GL_DEBUG_TYPE_ERROR:
+			g_errors.fetch_add(1, std::memory_order_relaxed);
+			std::cout << "ERROR: OpenGL (" << CurrentPassName() << ") - " << message << std::endl;
+			break;
+
+		case GL_DEBUG_TYPE_PERFORMANCE:
+		{
+			g_performanceWarnings.fetch_add(1, std::memory_order_relaxed);
+			if (MessageContains(message, "recompil"))
+			{
+				g_shaderRecompiles.fetch_add(1, std::memory_order_relaxed);
+			}
+			else if (MessageContains(message, "stall") || MessageContains(message, "synchroniz") ||
+				MessageContains(message, "copied/moved") || MessageContains(message, "wait"))
+			{
+				g_bufferStalls.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			int pass = g_currentPass.load(std::memory_order_relaxed);
+			if (pass != g_NoPass)
+			{
+				g_passWarnings[pass].fetch_add(1, std::memory_order_relaxed);
+			}
+			if (FirstTimeSeen(id))
+			{
+				std::cout << "WARNING: OpenGL performance (" << CurrentPassName() << ") - " << message << std::endl;
+			}
+			break;
+		}
+
+		case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:
+		case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:
+		case GL_DEBUG_TYPE_PORTABILITY:
+			g_otherWarnings.fetch_add(1, std::memory_order_relaxed);
+			if (severity == GL_DEBUG_SEVERITY_HIGH)
+			{
+				std::cout << "WARNING: OpenGL (" << CurrentPassName() << ") - " << message << std::endl;
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+}
+
+/***********************************************************
+ *  Install()
+ *
+ *  This method is used for turning on the debug output of
+ *  the current context.  The informational messages, which
+ *  some drivers send for every buffer, and the messages of
+ *  our own groups are filtered out by the driver.
+ ***********************************************************/
+bool GLDebug::Install(bool bDebugContext)
+{
+	if (!GLEW_VERSION_4_3 && !GLEW_KHR_debug)
+	{
+		std::cout << "INFO: OpenGL debug output is not available" << std::endl;
+		return(false);
+	}
+
+	glEnable(GL_DEBUG_OUTPUT);
+	if (bDebugContext)
+	{
+		glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+	}
+	glDebugMessageCallback(DebugMessageCallback, NULL);
+	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, NULL, GL_FALSE);
+	glDebugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_PUSH_GROUP, GL_DONT_CARE, 0, NULL, GL_FALSE);
+	glDebugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_POP_GROUP, GL_DONT_CARE, 0, NULL, GL_FALSE);
+	g_bInstalled = true;
+
+	GLint contextFlags = 0;
+	glGetIntegerv(GL_CONTEXT_FLAGS, &contextFlags);
+	std::cout << "INFO: OpenGL debug output installed"
+		<< (((contextFlags & GL_CONTEXT_FLAG_DEBUG_BIT) != 0) ? " on a debug context" : "") << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  IsInstalled()
+ *
+ *  This method is used for checking whether the debug
+ *  output was installed.
+ ***********************************************************/
+bool GLDebug::IsInstalled()
+{
+	return(g_bInstalled);
+}
+
+/***********************************************************
+ *  LabelObject()
+ *
+ *  This method is used for naming an object.  Objects whose
+ *  names came from glGen* must have been bound once before
+ *  they can be labeled.
+ ***********************************************************/
+void GLDebug::LabelObject(GLenum identifier, GLuint name, const char* label)
+{
+	if (!g_bInstalled || (name == 0))
+	{
+		return;
+	}
+	glObjectLabel(identifier, name, -1, label);
+}
+
+/***********************************************************
+ *  LabelObjects()
+ *
+ *  This method is used for naming every object of an array
+ *  of objects.
+ ***********************************************************/
+void GLDebug::LabelObjects(GLenum identifier, const GLuint* names, int count, const char* const* labels)
+{
+	for (int i = 0; i < count; i++)
+	{
+		LabelObject(identifier, names[i], labels[i]);
+	}
+}
+
+/***********************************************************
+ *  PushGroup()
+ *
+ *  This method is used for starting a named render pass,
+ *  which tools show around its commands and the warnings
+ *  are counted for.
+ ***********************************************************/
+void GLDebug::PushGroup(const char* name)
+{
+	if (!g_bInstalled)
+	{
+		return;
+	}
+
+	glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+	if (g_groupDepth < g_MaxGroupDepth)
+	{
+		g_groupPasses[g_groupDepth] = FindPass(name);
+		g_currentPass.store(g_groupPasses[g_groupDepth], std::memory_order_relaxed);
+	}
+	g_groupDepth++;
+}
+
+/***********************************************************
+ *  PopGroup()
+ *
+ *  This method is used for ending the render pass started
+ *  last.
+ ***********************************************************/
+void GLDebug::PopGroup()
+{
+	if (!g_bInstalled || (g_groupDepth == 0))
+	{
+		return;
+	}
+
+	glPopDebugGroup();
+	g_groupDepth--;
+	int depth = (g_groupDepth < g_MaxGroupDepth) ? g_groupDepth : g_MaxGroupDepth;
+	g_currentPass.store((depth > 0) ? g_groupPasses[depth - 1] : g_NoPass, std::memory_order_relaxed);
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for reading the message counters.
+ ***********************************************************/
+GL_DEBUG_STATS GLDebug::GetStats()
+{
+	GL_DEBUG_STATS stats;
+	stats.errors = g_errors.load(std::memory_order_relaxed);
+	stats.performanceWarnings = g_performanceWarnings.load(std::memory_order_relaxed);
+	stats.shaderRecompiles = g_shaderRecompiles.load(std::memory_order_relaxed);
+	stats.bufferStalls = g_bufferStalls.load(std::memory_order_relaxed);
+	stats.otherWarnings = g_otherWarnings.load(std::memory_order_relaxed);
+	stats.passCount = g_passCount.load(std::memory_order_acquire);
+	for (int i = 0; i < stats.passCount; i++)
+	{
+		stats.passNames[i] = g_passNames[i];
+		stats.passWarnings[i] = g_passWarnings[i].load(std::memory_order_relaxed);
+	}
+	return(stats);
+}
+
+/***********************************************************
+ *  ResetStats()
+ *
+ *  This method is used for starting the message counters
+ *  over.  The passes stay known.
+ ***********************************************************/
+void GLDebug::ResetStats()
+{
+	g_errors.store(0, std::memory_order_relaxed);
+	g_performanceWarnings.store(0, std::memory_order_relaxed);
+	g_shaderRecompiles.store(0, std::memory_order_relaxed);
+	g_bufferStalls.store(0, std::memory_order_relaxed);
+	g_otherWarnings.store(0, std::memory_order_relaxed);
+	int passCount = g_passCount.load(std::memory_order_acquire);
+	for (int i = 0; i < passCount; i++)
+	{
+		g_passWarnings[i].store(0, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////
+// gldebug.h
+// ============
+// OpenGL debug output - counts the errors and the performance warnings the
+// driver reports, per render pass, and names objects and passes for tools
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+
+// most render passes the warnings are counted for
+const int GL_DEBUG_MAX_PASSES = 16;
+
+/***********************************************************
+ *  GL_DEBUG_STATS
+ *
+ *  Messages reported since the last reset.  Shader
+ *  recompiles and buffer stalls are counted among the
+ *  performance warnings too, and the warnings of a pass
+ *  are the performance warnings reported inside its group.
+ ***********************************************************/
+struct GL_DEBUG_STATS
+{
+	uint64_t errors;
+	uint64_t performanceWarnings;
+	uint64_t shaderRecompiles;
+	uint64_t bufferStalls;
+	// deprecated, undefined and non-portable behavior
+	uint64_t otherWarnings;
+	int passCount;
+	const char* passNames[GL_DEBUG_MAX_PASSES];
+	uint64_t passWarnings[GL_DEBUG_MAX_PASSES];
+};
+
+/***********************************************************
+ *  GLDebug
+ *
+ *  Uses KHR_debug, or OpenGL 4.3, where the context has
+ *  it, and does nothing otherwise.  The driver reports more
+ *  in a debug context, which is only created on request
+ *  since it is slower, and there the messages are also
+ *  delivered synchronously, so that they land in the pass
+ *  that caused them.
+ *
+ *  The callback only counts and prints, without touching
+ *  the heap, so frame submission stays free of allocations
+ *  with the debug output on.  Group and pass names must be
+ *  string literals, since only their pointers are kept.
+ ***********************************************************/
+namespace GLDebug
+{
+	// install the message callback on the current context,
+	// returns false when the context has no debug output
+	bool Install(bool bDebugContext);
+	// whether the debug output was installed
+	bool IsInstalled();
+
+	// name an object for the debug messages and for tools
+	void LabelObject(GLenum identifier, GLuint name, const char* label);
+	// name every object of an array, one label each
+	void LabelObjects(GLenum identifier, const GLuint* names, int count, const char* const* labels);
+
+	// start and end a named render pass
+	void PushGroup(const char* name);
+	void PopGroup();
+
+	// messages counted since the last reset - called from
+	// any thread
+	GL_DEBUG_STATS GetStats();
+	void ResetStats();
+}
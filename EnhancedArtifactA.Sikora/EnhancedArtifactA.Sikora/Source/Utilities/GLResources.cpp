@@ -0,0 +1,292 @@
+///////////////////////////////////////////////////////////////////////////////
+// glresources.cpp
+// ============
+// creation of OpenGL buffers, vertex arrays and textures through direct
+// state access, without touching any bindings
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GLResources.h"
+#include "GLDebug.h"
+
+
+/***********************************************************
+ *  HasDirectStateAccess()
+ *
+ *  This method is used for checking whether the context
+ *  supports creating objects without binding them.
+ ***********************************************************/
+bool GLResources::HasDirectStateAccess()
+{
+	return (GLEW_VERSION_4_5 || GLEW_ARB_direct_state_access) ? true : false;
+}
+
+/***********************************************************
+ *  GetMipLevelCount()
+ *
+ *  This method is used for counting the mipmap levels of a
+ *  texture, down to 1x1.
+ ***********************************************************/
+GLsizei GLResources::GetMipLevelCount(GLsizei width, GLsizei height)
+{
+	GLsizei levels = 1;
+	GLsizei size = (width > height) ? width : height;
+	while (size > 1)
+	{
+		size /= 2;
+		levels++;
+	}
+	return(levels);
+}
+
+/***********************************************************
+ *  CreateBuffer()
+ *
+ *  This method is used for creating a buffer and filling
+ *  it.  The fallback goes through the copy write target,
+ *  which no vertex array or draw call reads from.
+ ***********************************************************/
+GLuint GLResources::CreateBuffer(GLsizeiptr size, const void* data, BUFFER_USAGE usage, const char* label)
+{
+	GLuint buffer = 0;
+
+	if (HasDirectStateAccess())
+	{
+		// read back buffers are best kept in memory the CPU
+		// reads quickly
+		GLbitfield flags = 0;
+		if (usage == BUFFER_DYNAMIC)
+		{
+			flags = GL_DYNAMIC_STORAGE_BIT;
+		}
+		else if (usage == BUFFER_READBACK)
+		{
+			flags = GL_CLIENT_STORAGE_BIT;
+		}
+
+		glCreateBuffers(1, &buffer);
+		glNamedBufferStorage(buffer, size, data, flags);
+		GLDebug::LabelObject(GL_BUFFER, buffer, label);
+		return(buffer);
+	}
+
+	GLenum hint = GL_STATIC_DRAW;
+	switch (usage)
+	{
+	case BUFFER_DYNAMIC:
+		hint = GL_STREAM_DRAW;
+		break;
+	case BUFFER_GPU_WRITTEN:
+		hint = GL_DYNAMIC_COPY;
+		break;
+	case BUFFER_READBACK:
+		hint = GL_STREAM_READ;
+		break;
+	default:
+		break;
+	}
+
+	GLint previousBuffer = 0;
+	glGetIntegerv(GL_COPY_WRITE_BUFFER_BINDING, &previousBuffer);
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, size, data, hint);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, (GLuint)previousBuffer);
+	GLDebug::LabelObject(GL_BUFFER, buffer, label);
+	return(buffer);
+}
+
+/***********************************************************
+ *  CreateVertexArray()
+ *
+ *  This method is used for creating a vertex array without
+ *  attributes, drawing with the passed in index buffer.
+ ***********************************************************/
+GLuint GLResources::CreateVertexArray(GLuint indexBuffer, const char* label)
+{
+	GLuint vertexArray = 0;
+
+	if (HasDirectStateAccess())
+	{
+		glCreateVertexArrays(1, &vertexArray);
+		if (indexBuffer != 0)
+		{
+			glVertexArrayElementBuffer(vertexArray, indexBuffer);
+		}
+		GLDebug::LabelObject(GL_VERTEX_ARRAY, vertexArray, label);
+		return(vertexArray);
+	}
+
+	GLint previousVertexArray = 0;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVertexArray);
+
+	// binding the name also creates the object behind it
+	glGenVertexArrays(1, &vertexArray);
+	glBindVertexArray(vertexArray);
+	// the index buffer binding is part of the vertex array
+	if (indexBuffer != 0)
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	}
+
+	glBindVertexArray((GLuint)previousVertexArray);
+	GLDebug::LabelObject(GL_VERTEX_ARRAY, vertexArray, label);
+	return(vertexArray);
+}
+
+/***********************************************************
+ *  SetVertexBuffer()
+ *
+ *  This method is used for reading attributes of a vertex
+ *  array from a buffer.  With direct state access they
+ *  share one binding of the vertex array.  The fallback
+ *  has no separate bindings, so each attribute is pointed
+ *  at the buffer on its own, with the divisor set for its
+ *  location.
+ ***********************************************************/
+void GLResources::SetVertexBuffer(
+	GLuint vertexArray,
+	GLuint binding,
+	GLuint buffer,
+	GLintptr offset,
+	GLsizei stride,
+	GLuint divisor,
+	const VERTEX_ATTRIBUTE* attributes,
+	int attributeCount)
+{
+	if (HasDirectStateAccess())
+	{
+		glVertexArrayVertexBuffer(vertexArray, binding, buffer, offset, stride);
+		glVertexArrayBindingDivisor(vertexArray, binding, divisor);
+		for (int i = 0; i < attributeCount; i++)
+		{
+			glEnableVertexArrayAttrib(vertexArray, attributes[i].location);
+			glVertexArrayAttribFormat(vertexArray, attributes[i].location, attributes[i].components, GL_FLOAT, GL_FALSE, attributes[i].offset);
+			glVertexArrayAttribBinding(vertexArray, attributes[i].location, binding);
+		}
+		return;
+	}
+
+	GLint previousVertexArray = 0;
+	GLint previousArrayBuffer = 0;
+	glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVertexArray);
+	glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &previousArrayBuffer);
+
+	glBindVertexArray(vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	for (int i = 0; i < attributeCount; i++)
+	{
+		glVertexAttribPointer(attributes[i].location, attributes[i].components, GL_FLOAT, GL_FALSE, stride, (void*)(size_t)(offset + attributes[i].offset));
+		glVertexAttribDivisor(attributes[i].location, divisor);
+		glEnableVertexAttribArray(attributes[i].location);
+	}
+
+	glBindVertexArray((GLuint)previousVertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, (GLuint)previousArrayBuffer);
+}
+
+/***********************************************************
+ *  CreateVertexArray()
+ *
+ *  This method is used for creating a vertex array with
+ *  all of its attributes in binding 0, read from one
+ *  interleaved vertex buffer.
+ ***********************************************************/
+GLuint GLResources::CreateVertexArray(
+	GLuint vertexBuffer,
+	GLsizei stride,
+	const VERTEX_ATTRIBUTE* attributes,
+	int attributeCount,
+	GLuint indexBuffer,
+	const char* label)
+{
+	GLuint vertexArray = CreateVertexArray(indexBuffer, label);
+	SetVertexBuffer(vertexArray, 0, vertexBuffer, 0, stride, 0, attributes, attributeCount);
+	return(vertexArray);
+}
+
+/***********************************************************
+ *  CreateTexture2D()
+ *
+ *  This method is used for creating a 2D texture from
+ *  pixels.  With direct state access the storage of every
+ *  mipmap level is allocated once and cannot be resized.
+ *  Without pixels every level is allocated and left to be
+ *  filled by the caller.  Mutable textures always take the
+ *  bind to edit path, and without pixels only get their
+ *  wrapping and filtering, so that the caller can define
+ *  just the levels it has.
+ ***********************************************************/
+GLuint GLResources::CreateTexture2D(
+	GLsizei width,
+	GLsizei height,
+	GLenum internalFormat,
+	GLenum pixelFormat,
+	GLenum pixelType,
+	const void* pixels,
+	GLint wrap,
+	GLint minFilter,
+	GLint magFilter,
+	bool bMipmaps,
+	TEXTURE_STORAGE storage,
+	const char* label)
+{
+	GLuint texture = 0;
+	GLsizei levels = bMipmaps ? GetMipLevelCount(width, height) : 1;
+	bool bAllocate = (pixels != NULL) || (storage == TEXTURE_IMMUTABLE);
+
+	if ((storage == TEXTURE_IMMUTABLE) && HasDirectStateAccess())
+	{
+		glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+		glTextureStorage2D(texture, levels, internalFormat, width, height);
+		glTextureParameteri(texture, GL_TEXTURE_WRAP_S, wrap);
+		glTextureParameteri(texture, GL_TEXTURE_WRAP_T, wrap);
+		glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, minFilter);
+		glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, magFilter);
+		if (pixels != NULL)
+		{
+			glTextureSubImage2D(texture, 0, 0, 0, width, height, pixelFormat, pixelType, pixels);
+			if (bMipmaps)
+			{
+				glGenerateTextureMipmap(texture);
+			}
+		}
+		GLDebug::LabelObject(GL_TEXTURE, texture, label);
+		return(texture);
+	}
+
+	GLint previousTexture = 0;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &previousTexture);
+
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	if (bAllocate)
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, pixelFormat, pixelType, pixels);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
+	if (bMipmaps && (pixels != NULL))
+	{
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+	else if (bMipmaps && bAllocate)
+	{
+		GLsizei levelWidth = width;
+		GLsizei levelHeight = height;
+		for (GLsizei level = 1; level < levels; level++)
+		{
+			levelWidth = (levelWidth > 1) ? levelWidth / 2 : 1;
+			levelHeight = (levelHeight > 1) ? levelHeight / 2 : 1;
+			glTexImage2D(GL_TEXTURE_2D, level, internalFormat, levelWidth, levelHeight, 0, pixelFormat, pixelType, NULL);
+		}
+	}
+
+	glBindTexture(GL_TEXTURE_2D, (GLuint)previousTexture);
+	GLDebug::LabelObject(GL_TEXTURE, texture, label);
+	return(texture);
+}
@@ -0,0 +1,125 @@
+///////////////////////////////////////////////////////////////////////////////
+// glresources.h
+// ============
+// creation of OpenGL buffers, vertex arrays and textures through direct
+// state access, without touching any bindings
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  VERTEX_ATTRIBUTE
+ *
+ *  One float attribute of an interleaved vertex buffer.
+ ***********************************************************/
+struct VERTEX_ATTRIBUTE
+{
+	GLuint location;
+	GLint components;
+	GLuint offset;
+};
+
+/***********************************************************
+ *  BUFFER_USAGE
+ *
+ *  How the contents of a buffer change after it is created,
+ *  which picks its storage flags, or its usage hint on the
+ *  bind to edit path.
+ ***********************************************************/
+enum BUFFER_USAGE
+{
+	BUFFER_STATIC = 0,		// filled once, when it is created
+	BUFFER_DYNAMIC,			// rewritten by the CPU, up to every frame
+	BUFFER_GPU_WRITTEN,		// written by shaders and buffer copies
+	BUFFER_READBACK			// copied into by the GPU and read by the CPU
+};
+
+/***********************************************************
+ *  TEXTURE_STORAGE
+ *
+ *  Whether the levels of a texture are allocated once, or
+ *  can be defined and dropped again one at a time, which is
+ *  what streamed textures need.
+ ***********************************************************/
+enum TEXTURE_STORAGE
+{
+	TEXTURE_IMMUTABLE = 0,	// every level allocated when it is created
+	TEXTURE_MUTABLE			// levels defined with glTexImage2D
+};
+
+/***********************************************************
+ *  GLResources
+ *
+ *  On OpenGL 4.5, or with ARB_direct_state_access, objects
+ *  are created and filled by name, so loading never changes
+ *  what is bound for drawing, and buffers and textures get
+ *  immutable storage, unless a texture asks for mutable
+ *  storage.  Older contexts, such as the 3.3
+ *  context on macOS, take the bind to edit path instead,
+ *  which puts back the bindings it changes.
+ ***********************************************************/
+namespace GLResources
+{
+	// whether objects are created through direct state access
+	bool HasDirectStateAccess();
+	// number of mipmap levels of a texture, down to 1x1
+	GLsizei GetMipLevelCount(GLsizei width, GLsizei height);
+
+	// every object is created with a debug label, see GLDebug
+
+	// create a buffer holding size bytes of data, which may be
+	// NULL - only BUFFER_DYNAMIC buffers can be rewritten with
+	// glBufferSubData or glNamedBufferSubData
+	GLuint CreateBuffer(GLsizeiptr size, const void* data, BUFFER_USAGE usage, const char* label);
+	// create a vertex array that draws with an index buffer,
+	// which may be 0, and reads no attributes until they are
+	// added with SetVertexBuffer()
+	GLuint CreateVertexArray(GLuint indexBuffer, const char* label);
+	// read attributes of a vertex array from a buffer, through
+	// the passed in binding, from offset bytes into the buffer
+	// on - with a divisor of 1 they advance once per instance
+	// instead of once per vertex.  Setting the binding again
+	// with another offset moves the attributes along the buffer
+	void SetVertexBuffer(
+		GLuint vertexArray,
+		GLuint binding,
+		GLuint buffer,
+		GLintptr offset,
+		GLsizei stride,
+		GLuint divisor,
+		const VERTEX_ATTRIBUTE* attributes,
+		int attributeCount);
+	// create a vertex array that reads the attributes from one
+	// interleaved vertex buffer and draws with an index buffer,
+	// which may be 0
+	GLuint CreateVertexArray(
+		GLuint vertexBuffer,
+		GLsizei stride,
+		const VERTEX_ATTRIBUTE* attributes,
+		int attributeCount,
+		GLuint indexBuffer,
+		const char* label);
+	// create a 2D texture from pixels of the passed in format
+	// and type, with the passed in wrapping and filtering, and
+	// all of its mipmaps when bMipmaps is set - without pixels
+	// the levels are left undefined, and mutable textures get
+	// no levels at all, which the caller defines itself
+	GLuint CreateTexture2D(
+		GLsizei width,
+		GLsizei height,
+		GLenum internalFormat,
+		GLenum pixelFormat,
+		GLenum pixelType,
+		const void* pixels,
+		GLint wrap,
+		GLint minFilter,
+		GLint magFilter,
+		bool bMipmaps,
+		TEXTURE_STORAGE storage,
+		const char* label);
+}
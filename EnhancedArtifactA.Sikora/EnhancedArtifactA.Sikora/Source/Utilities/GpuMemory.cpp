@@ -0,0 +1,431 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpumemory.cpp
+// ============
+// accounting of the GPU memory held by buffers, textures and render targets,
+// with the bytes uploaded per frame and a budget that evicts or warns
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuMemory.h"
+
+#include <atomic>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// names of the categories in the report
+	const char* const g_CategoryNames[GPU_MEMORY_CATEGORY_COUNT] =
+	{
+		"buffers", "textures", "render targets"
+	};
+	// marks an object whose tag did not fit in the tag table
+	const int g_NoTag = -1;
+	const double g_BytesPerMegabyte = 1024.0 * 1024.0;
+
+	// storage of one tracked object
+	struct GPU_MEMORY_OBJECT
+	{
+		GLenum identifier;
+		GLuint name;
+		GPU_MEMORY_CATEGORY category;
+		int tag;
+		uint64_t bytes;
+	};
+
+	// everything below the mutex is guarded by it
+	std::mutex g_mutex;
+	std::vector<GPU_MEMORY_OBJECT> g_objects;
+	uint64_t g_totalBytes = 0;
+	uint64_t g_peakBytes = 0;
+	uint64_t g_categoryBytes[GPU_MEMORY_CATEGORY_COUNT] = {};
+	uint64_t g_categoryPeakBytes[GPU_MEMORY_CATEGORY_COUNT] = {};
+	const char* g_tagNames[GPU_MEMORY_MAX_TAGS];
+	uint64_t g_tagBytes[GPU_MEMORY_MAX_TAGS];
+	int g_tagCount = 0;
+	uint64_t g_frameUploadBytes = 0;
+	uint64_t g_peakFrameUploadBytes = 0;
+	uint64_t g_budgetBytes = 0;
+	GPU_MEMORY_EVICT_FUNCTION g_evictFunction = nullptr;
+	void* g_evictContext = nullptr;
+
+	// uploads of the frame that is not finished yet
+	std::atomic<uint64_t> g_currentUploadBytes(0);
+	// set while the budget is exceeded and has been reported,
+	// so the warning is printed once each time
+	bool g_bOverBudgetReported = false;
+
+	// size of one texel of the formats the scene creates
+	uint64_t GetBytesPerTexel(GLenum internalFormat)
+	{
+		switch (internalFormat)
+		{
+		case GL_R8:
+			return(1);
+		case GL_RG8:
+		case GL_R16F:
+			return(2);
+		case GL_RGBA16F:
+		case GL_RG32F:
+			return(8);
+		case GL_RGBA32F:
+			return(16);
+		// RGB8 and 24 bit depth are stored padded to 32 bits
+		default:
+			return(4);
+		}
+	}
+
+	// slot of a tag, added when it is first seen, or g_NoTag
+	// when all of the slots are taken - the mutex must be held
+	int FindTag(const char* tag)
+	{
+		for (int i = 0; i < g_tagCount; i++)
+		{
+			if ((g_tagNames[i] == tag) || (strcmp(g_tagNames[i], tag) == 0))
+			{
+				return(i);
+			}
+		}
+		if (g_tagCount == GPU_MEMORY_MAX_TAGS)
+		{
+			return(g_NoTag);
+		}
+		g_tagNames[g_tagCount] = tag;
+		g_tagBytes[g_tagCount] = 0;
+		return(g_tagCount++);
+	}
+
+	// index of a tracked object, or -1 - the mutex must be held
+	int FindObject(GLenum identifier, GLuint name)
+	{
+		for (size_t i = 0; i < g_objects.size(); i++)
+		{
+			if ((g_objects[i].identifier == identifier) && (g_objects[i].name == name))
+			{
+				return (int)i;
+			}
+		}
+		return(-1);
+	}
+
+	// take the memory of an object off the totals - the mutex
+	// must be held
+	void RemoveBytes(const GPU_MEMORY_OBJECT& object)
+	{
+		g_totalBytes -= object.bytes;
+		g_categoryBytes[object.category] -= object.bytes;
+		if (object.tag != g_NoTag)
+		{
+			g_tagBytes[object.tag] -= object.bytes;
+		}
+	}
+
+	// set the size of a tracked object, and add the object
+	// when it is not tracked yet - the mutex must be held
+	void SetObjectBytes(GLenum identifier, GLuint name, GPU_MEMORY_CATEGORY category, const char* tag, uint64_t bytes)
+	{
+		int index = FindObject(identifier, name);
+		if (index < 0)
+		{
+			GPU_MEMORY_OBJECT object;
+			object.identifier = identifier;
+			object.name = name;
+			object.bytes = 0;
+			g_objects.push_back(object);
+			index = (int)g_objects.size() - 1;
+		}
+		else
+		{
+			RemoveBytes(g_objects[index]);
+		}
+
+		GPU_MEMORY_OBJECT& object = g_objects[index];
+		object.category = category;
+		object.tag = FindTag(tag);
+		object.bytes = bytes;
+
+		g_totalBytes += bytes;
+		g_categoryBytes[category] += bytes;
+		if (object.tag != g_NoTag)
+		{
+			g_tagBytes[object.tag] += bytes;
+		}
+		if (g_totalBytes > g_peakBytes)
+		{
+			g_peakBytes = g_totalBytes;
+		}
+		if (g_categoryBytes[category] > g_categoryPeakBytes[category])
+		{
+			g_categoryPeakBytes[category] = g_categoryBytes[category];
+		}
+	}
+}
+
+/***********************************************************
+ *  GetTextureBytes()
+ *
+ *  This method is used for working out the memory of a 2D
+ *  texture, with each level half the size of the one
+ *  before.
+ ***********************************************************/
+uint64_t GpuMemory::GetTextureBytes(GLsizei width, GLsizei height, GLenum internalFormat, GLsizei levels)
+{
+	uint64_t texelCount = 0;
+	uint64_t levelWidth = (uint64_t)width;
+	uint64_t levelHeight = (uint64_t)height;
+	for (GLsizei level = 0; level < levels; level++)
+	{
+		texelCount += levelWidth * levelHeight;
+		levelWidth = (levelWidth > 1) ? levelWidth / 2 : 1;
+		levelHeight = (levelHeight > 1) ? levelHeight / 2 : 1;
+	}
+	return(texelCount * GetBytesPerTexel(internalFormat));
+}
+
+/***********************************************************
+ *  TrackObject()
+ *
+ *  This method is used for recording the storage of an
+ *  object.  Storage that is specified again replaces the
+ *  size recorded before.
+ ***********************************************************/
+void GpuMemory::TrackObject(GLenum identifier, GLuint name, GPU_MEMORY_CATEGORY category, const char* tag, uint64_t bytes)
+{
+	if (name == 0)
+	{
+		return;
+	}
+
+	g_currentUploadBytes.fetch_add(bytes, std::memory_order_relaxed);
+
+	std::lock_guard<std::mutex> lock(g_mutex);
+	SetObjectBytes(identifier, name, category, tag, bytes);
+}
+
+/***********************************************************
+ *  ResizeObject()
+ *
+ *  This method is used for recording the new size of an
+ *  object whose levels were added or dropped in place.
+ *  The added levels are counted by the caller, since only
+ *  it knows what was written.
+ ***********************************************************/
+void GpuMemory::ResizeObject(GLenum identifier, GLuint name, GPU_MEMORY_CATEGORY category, const char* tag, uint64_t bytes)
+{
+	if (name == 0)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(g_mutex);
+	SetObjectBytes(identifier, name, category, tag, bytes);
+}
+
+/***********************************************************
+ *  ReleaseObject()
+ *
+ *  This method is used for forgetting an object that is
+ *  about to be deleted.  Untracked objects are ignored.
+ ***********************************************************/
+void GpuMemory::ReleaseObject(GLenum identifier, GLuint name)
+{
+	std::lock_guard<std::mutex> lock(g_mutex);
+	int index = FindObject(identifier, name);
+	if (index < 0)
+	{
+		return;
+	}
+
+	RemoveBytes(g_objects[index]);
+	g_objects[index] = g_objects.back();
+	g_objects.pop_back();
+}
+
+/***********************************************************
+ *  ReleaseObjects()
+ *
+ *  This method is used for forgetting every object of an
+ *  array of objects.
+ ***********************************************************/
+void GpuMemory::ReleaseObjects(GLenum identifier, const GLuint* names, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		ReleaseObject(identifier, names[i]);
+	}
+}
+
+/***********************************************************
+ *  CountUpload()
+ *
+ *  This method is used for counting bytes written into the
+ *  storage of an object that is already tracked.
+ ***********************************************************/
+void GpuMemory::CountUpload(uint64_t bytes)
+{
+	g_currentUploadBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+/***********************************************************
+ *  SetBudget()
+ *
+ *  This method is used for setting the memory the tracked
+ *  objects are allowed to hold.
+ ***********************************************************/
+void GpuMemory::SetBudget(uint64_t bytes)
+{
+	std::lock_guard<std::mutex> lock(g_mutex);
+	g_budgetBytes = bytes;
+}
+
+/***********************************************************
+ *  GetHeadroom()
+ *
+ *  This method is used for finding how much more memory
+ *  can be created before the budget is exceeded.
+ ***********************************************************/
+uint64_t GpuMemory::GetHeadroom()
+{
+	std::lock_guard<std::mutex> lock(g_mutex);
+	if (g_budgetBytes == 0)
+	{
+		return(UINT64_MAX);
+	}
+	return (g_totalBytes < g_budgetBytes) ? (g_budgetBytes - g_totalBytes) : 0;
+}
+
+/***********************************************************
+ *  SetEvictFunction()
+ *
+ *  This method is used for registering the function that
+ *  frees memory when the budget is exceeded.
+ ***********************************************************/
+void GpuMemory::SetEvictFunction(GPU_MEMORY_EVICT_FUNCTION function, void* context)
+{
+	std::lock_guard<std::mutex> lock(g_mutex);
+	g_evictFunction = function;
+	g_evictContext = context;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for closing the uploads of the
+ *  frame and checking the budget.  The evict function runs
+ *  at most once per frame, so freeing memory is spread
+ *  over several frames, and the warning is printed when it
+ *  cannot free any more.
+ ***********************************************************/
+void GpuMemory::EndFrame()
+{
+	uint64_t uploadBytes = g_currentUploadBytes.exchange(0, std::memory_order_relaxed);
+
+	uint64_t totalBytes = 0;
+	uint64_t budgetBytes = 0;
+	GPU_MEMORY_EVICT_FUNCTION evictFunction = nullptr;
+	void* evictContext = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(g_mutex);
+		g_frameUploadBytes = uploadBytes;
+		if (uploadBytes > g_peakFrameUploadBytes)
+		{
+			g_peakFrameUploadBytes = uploadBytes;
+		}
+		totalBytes = g_totalBytes;
+		budgetBytes = g_budgetBytes;
+		evictFunction = g_evictFunction;
+		evictContext = g_evictContext;
+	}
+
+	if ((budgetBytes == 0) || (totalBytes <= budgetBytes))
+	{
+		g_bOverBudgetReported = false;
+		return;
+	}
+
+	// the evict function tracks and releases objects itself,
+	// so it is called without holding the mutex
+	uint64_t freedBytes = 0;
+	if (nullptr != evictFunction)
+	{
+		freedBytes = evictFunction(evictContext, totalBytes - budgetBytes);
+	}
+
+	if ((freedBytes == 0) && !g_bOverBudgetReported)
+	{
+		std::cout << "WARNING: GPU memory of " << (totalBytes / g_BytesPerMegabyte)
+			<< " MB is over the budget of " << (budgetBytes / g_BytesPerMegabyte)
+			<< " MB, and nothing more can be evicted" << std::endl;
+		g_bOverBudgetReported = true;
+	}
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for reading the tracked memory.
+ ***********************************************************/
+GPU_MEMORY_STATS GpuMemory::GetStats()
+{
+	std::lock_guard<std::mutex> lock(g_mutex);
+
+	GPU_MEMORY_STATS stats;
+	stats.totalBytes = g_totalBytes;
+	stats.peakBytes = g_peakBytes;
+	stats.budgetBytes = g_budgetBytes;
+	for (int i = 0; i < GPU_MEMORY_CATEGORY_COUNT; i++)
+	{
+		stats.categoryBytes[i] = g_categoryBytes[i];
+		stats.categoryPeakBytes[i] = g_categoryPeakBytes[i];
+	}
+	stats.objectCount = (int)g_objects.size();
+	stats.frameUploadBytes = g_frameUploadBytes;
+	stats.peakFrameUploadBytes = g_peakFrameUploadBytes;
+	stats.tagCount = g_tagCount;
+	for (int i = 0; i < g_tagCount; i++)
+	{
+		stats.tagNames[i] = g_tagNames[i];
+		stats.tagBytes[i] = g_tagBytes[i];
+	}
+	return(stats);
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method is used for printing the memory of every
+ *  category and every tag, in megabytes.
+ ***********************************************************/
+void GpuMemory::PrintReport()
+{
+	GPU_MEMORY_STATS stats = GetStats();
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "INFO: GPU memory - " << (stats.totalBytes / g_BytesPerMegabyte) << " MB in "
+		<< stats.objectCount << " objects, peak " << (stats.peakBytes / g_BytesPerMegabyte) << " MB";
+	if (stats.budgetBytes > 0)
+	{
+		std::cout << ", budget " << (stats.budgetBytes / g_BytesPerMegabyte) << " MB";
+	}
+	std::cout << std::endl;
+
+	for (int i = 0; i < GPU_MEMORY_CATEGORY_COUNT; i++)
+	{
+		std::cout << "INFO:   " << std::left << std::setw(16) << g_CategoryNames[i] << std::right
+			<< std::setw(10) << (stats.categoryBytes[i] / g_BytesPerMegabyte) << " MB, peak "
+			<< (stats.categoryPeakBytes[i] / g_BytesPerMegabyte) << " MB" << std::endl;
+	}
+	for (int i = 0; i < stats.tagCount; i++)
+	{
+		std::cout << "INFO:   " << std::left << std::setw(16) << stats.tagNames[i] << std::right
+			<< std::setw(10) << (stats.tagBytes[i] / g_BytesPerMegabyte) << " MB" << std::endl;
+	}
+	std::cout << std::defaultfloat << std::setprecision(6);
+}
@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpumemory.h
+// ============
+// accounting of the GPU memory held by buffers, textures and render targets,
+// with the bytes uploaded per frame and a budget that evicts or warns
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+
+// kind of memory an object holds
+enum GPU_MEMORY_CATEGORY
+{
+	GPU_MEMORY_BUFFERS = 0,
+	GPU_MEMORY_TEXTURES,
+	GPU_MEMORY_RENDER_TARGETS,
+	GPU_MEMORY_CATEGORY_COUNT
+};
+
+// most tags the memory is grouped by
+const int GPU_MEMORY_MAX_TAGS = 24;
+
+/***********************************************************
+ *  GPU_MEMORY_STATS
+ *
+ *  Memory held by the tracked objects, in total, by
+ *  category and by tag, with the highest totals seen so
+ *  far.  The uploads are the bytes handed to the driver in
+ *  the last finished frame.
+ ***********************************************************/
+struct GPU_MEMORY_STATS
+{
+	uint64_t totalBytes;
+	uint64_t peakBytes;
+	uint64_t budgetBytes;
+	uint64_t categoryBytes[GPU_MEMORY_CATEGORY_COUNT];
+	uint64_t categoryPeakBytes[GPU_MEMORY_CATEGORY_COUNT];
+	int objectCount;
+	uint64_t frameUploadBytes;
+	uint64_t peakFrameUploadBytes;
+	int tagCount;
+	const char* tagNames[GPU_MEMORY_MAX_TAGS];
+	uint64_t tagBytes[GPU_MEMORY_MAX_TAGS];
+};
+
+// frees memory of the owner it was registered for when the
+// budget is exceeded, returns the number of bytes freed, or
+// 0 when nothing is left to free
+typedef uint64_t (*GPU_MEMORY_EVICT_FUNCTION)(void* context, uint64_t bytesOverBudget);
+
+/***********************************************************
+ *  GpuMemory
+ *
+ *  OpenGL does not report how much memory an object takes,
+ *  so the size is worked out where the storage is created
+ *  and recorded by object name.  Textures are counted with
+ *  all of their mipmaps, and formats with three channels
+ *  as four, since drivers pad them.
+ *
+ *  Objects are tracked and released on the thread that
+ *  owns the context, which also ends every frame.  The
+ *  stats can be read from any thread.  Tags must be string
+ *  literals, since only their pointers are kept.
+ ***********************************************************/
+namespace GpuMemory
+{
+	// bytes of a 2D texture with the given number of levels
+	uint64_t GetTextureBytes(GLsizei width, GLsizei height, GLenum internalFormat, GLsizei levels);
+
+	// record the storage of an object, or its new size when it
+	// is already tracked - the storage counts as uploaded
+	void TrackObject(GLenum identifier, GLuint name, GPU_MEMORY_CATEGORY category, const char* tag, uint64_t bytes);
+	// record the new size of an object whose storage changed
+	// in place, without counting it as uploaded
+	void ResizeObject(GLenum identifier, GLuint name, GPU_MEMORY_CATEGORY category, const char* tag, uint64_t bytes);
+	// forget an object before it is deleted
+	void ReleaseObject(GLenum identifier, GLuint name);
+	void ReleaseObjects(GLenum identifier, const GLuint* names, int count);
+	// count bytes written into existing storage
+	void CountUpload(uint64_t bytes);
+
+	// budget of the tracked memory, 0 for no budget
+	void SetBudget(uint64_t bytes);
+	// bytes that can still be created under the budget, or
+	// UINT64_MAX when there is no budget
+	uint64_t GetHeadroom();
+	// register what is called when the budget is exceeded,
+	// or null to only warn
+	void SetEvictFunction(GPU_MEMORY_EVICT_FUNCTION function, void* context);
+	// close the uploads of the frame and enforce the budget
+	void EndFrame();
+
+	// memory tracked right now - called from any thread
+	GPU_MEMORY_STATS GetStats();
+	// print the memory of every category and tag
+	void PrintReport();
+}
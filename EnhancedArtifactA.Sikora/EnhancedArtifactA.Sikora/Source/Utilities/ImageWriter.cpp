@@ -0,0 +1,266 @@
+///////////////////////////////////////////////////////////////////////////////
+// imagewriter.cpp
+// ============
+// write rendered images to PNG and OpenEXR files without any image library
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// largest deflate block that is stored without compression
+	const size_t g_MaxStoredBlock = 65535;
+
+	// CRC of the PNG chunks, from the table of the PNG specification
+	uint32_t UpdateCrc(uint32_t crc, const unsigned char* data, size_t size)
+	{
+		static uint32_t table[256];
+		static bool bTableReady = false;
+		if (bTableReady == false)
+		{
+			for (uint32_t n = 0; n < 256; n++)
+			{
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++)
+				{
+					c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+				}
+				table[n] = c;
+			}
+			bTableReady = true;
+		}
+
+		for (size_t i = 0; i < size; i++)
+		{
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return crc;
+	}
+
+	void AppendBigEndian(std::vector<unsigned char>& data, uint32_t value)
+	{
+		data.push_back((unsigned char)(value >> 24));
+		data.push_back((unsigned char)(value >> 16));
+		data.push_back((unsigned char)(value >> 8));
+		data.push_back((unsigned char)value);
+	}
+
+	// append a PNG chunk with its length, type and CRC
+	void AppendChunk(std::vector<unsigned char>& file, const char* type, const std::vector<unsigned char>& data)
+	{
+		AppendBigEndian(file, (uint32_t)data.size());
+		size_t typeStart = file.size();
+		file.insert(file.end(), type, type + 4);
+		file.insert(file.end(), data.begin(), data.end());
+
+		uint32_t crc = UpdateCrc(0xFFFFFFFFu, &file[typeStart], file.size() - typeStart);
+		AppendBigEndian(file, crc ^ 0xFFFFFFFFu);
+	}
+
+	// append a value in the little endian order of EXR files
+	template<typename T>
+	void AppendValue(std::vector<unsigned char>& data, const T& value)
+	{
+		const unsigned char* bytes = (const unsigned char*)&value;
+		data.insert(data.end(), bytes, bytes + sizeof(T));
+	}
+
+	// append an EXR header attribute
+	void AppendAttribute(std::vector<unsigned char>& data, const char* name, const char* type, const std::vector<unsigned char>& value)
+	{
+		data.insert(data.end(), name, name + std::strlen(name) + 1);
+		data.insert(data.end(), type, type + std::strlen(type) + 1);
+		AppendValue(data, (int32_t)value.size());
+		data.insert(data.end(), value.begin(), value.end());
+	}
+
+	bool WriteFile(const char* filename, const std::vector<unsigned char>& data)
+	{
+		FILE* file = std::fopen(filename, "wb");
+		if (file == nullptr)
+		{
+			std::cout << "ERROR: Could not write image file:" << filename << std::endl;
+			return false;
+		}
+		size_t written = std::fwrite(data.data(), 1, data.size(), file);
+		std::fclose(file);
+
+		if (written != data.size())
+		{
+			std::cout << "ERROR: Could not write image file:" << filename << std::endl;
+			std::remove(filename);
+			return false;
+		}
+		return true;
+	}
+}
+
+/***********************************************************
+ *  WritePng()
+ *
+ *  This function is used for writing 8 bit RGB pixels to a
+ *  PNG file.  Every row starts with the "none" filter, and
+ *  the zlib stream is made of stored blocks, which keeps
+ *  the writer short at the cost of a larger file.
+ ***********************************************************/
+bool ImageWriter::WritePng(const char* filename, int width, int height, const unsigned char* rgb)
+{
+	if ((width <= 0) || (height <= 0) || (rgb == nullptr))
+	{
+		return false;
+	}
+
+	size_t rowSize = (size_t)width * 3;
+	std::vector<unsigned char> rows;
+	rows.reserve((rowSize + 1) * height);
+	for (int y = 0; y < height; y++)
+	{
+		rows.push_back(0);
+		rows.insert(rows.end(), rgb + y * rowSize, rgb + (y + 1) * rowSize);
+	}
+
+	// zlib header for a 32K window without a dictionary, the
+	// stored blocks and the Adler-32 of the rows
+	std::vector<unsigned char> compressed;
+	compressed.reserve(rows.size() + rows.size() / g_MaxStoredBlock * 5 + 16);
+	compressed.push_back(0x78);
+	compressed.push_back(0x01);
+	size_t offset = 0;
+	do
+	{
+		size_t blockSize = std::min(rows.size() - offset, g_MaxStoredBlock);
+		bool bFinal = (offset + blockSize == rows.size());
+		compressed.push_back(bFinal ? 1 : 0);
+		compressed.push_back((unsigned char)blockSize);
+		compressed.push_back((unsigned char)(blockSize >> 8));
+		compressed.push_back((unsigned char)~blockSize);
+		compressed.push_back((unsigned char)(~blockSize >> 8));
+		compressed.insert(compressed.end(), rows.begin() + offset, rows.begin() + offset + blockSize);
+		offset += blockSize;
+	} while (offset < rows.size());
+
+	uint32_t adlerLow = 1;
+	uint32_t adlerHigh = 0;
+	for (unsigned char value : rows)
+	{
+		adlerLow = (adlerLow + value) % 65521;
+		adlerHigh = (adlerHigh + adlerLow) % 65521;
+	}
+	AppendBigEndian(compressed, (adlerHigh << 16) | adlerLow);
+
+	// 8 bit RGB, deflate, adaptive filtering, no interlace
+	std::vector<unsigned char> header;
+	AppendBigEndian(header, (uint32_t)width);
+	AppendBigEndian(header, (uint32_t)height);
+	header.push_back(8);
+	header.push_back(2);
+	header.push_back(0);
+	header.push_back(0);
+	header.push_back(0);
+
+	static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	std::vector<unsigned char> file(signature, signature + 8);
+	AppendChunk(file, "IHDR", header);
+	AppendChunk(file, "IDAT", compressed);
+	AppendChunk(file, "IEND", std::vector<unsigned char>());
+
+	return WriteFile(filename, file);
+}
+
+/***********************************************************
+ *  WriteExr()
+ *
+ *  This function is used for writing float RGB pixels to a
+ *  single part, scanline OpenEXR file without compression.
+ *  The channels of every scanline are stored in the
+ *  alphabetical order the format asks for, B, G and R.
+ ***********************************************************/
+bool ImageWriter::WriteExr(const char* filename, int width, int height, const float* rgb)
+{
+	if ((width <= 0) || (height <= 0) || (rgb == nullptr))
+	{
+		return false;
+	}
+
+	const int32_t floatPixels = 2;
+
+	std::vector<unsigned char> file;
+	AppendValue(file, (int32_t)20000630);
+	AppendValue(file, (int32_t)2);
+
+	std::vector<unsigned char> channels;
+	for (const char* name : { "B", "G", "R" })
+	{
+		channels.insert(channels.end(), name, name + 2);
+		AppendValue(channels, floatPixels);
+		// linear flag and reserved bytes, then the sampling
+		AppendValue(channels, (int32_t)0);
+		AppendValue(channels, (int32_t)1);
+		AppendValue(channels, (int32_t)1);
+	}
+	channels.push_back(0);
+	AppendAttribute(file, "channels", "chlist", channels);
+
+	AppendAttribute(file, "compression", "compression", std::vector<unsigned char>(1, 0));
+
+	std::vector<unsigned char> window;
+	AppendValue(window, (int32_t)0);
+	AppendValue(window, (int32_t)0);
+	AppendValue(window, (int32_t)(width - 1));
+	AppendValue(window, (int32_t)(height - 1));
+	AppendAttribute(file, "dataWindow", "box2i", window);
+	AppendAttribute(file, "displayWindow", "box2i", window);
+
+	AppendAttribute(file, "lineOrder", "lineOrder", std::vector<unsigned char>(1, 0));
+
+	std::vector<unsigned char> value;
+	AppendValue(value, 1.0f);
+	AppendAttribute(file, "pixelAspectRatio", "float", value);
+	value.clear();
+	AppendValue(value, 0.0f);
+	AppendValue(value, 0.0f);
+	AppendAttribute(file, "screenWindowCenter", "v2f", value);
+	value.clear();
+	AppendValue(value, 1.0f);
+	AppendAttribute(file, "screenWindowWidth", "float", value);
+	file.push_back(0);
+
+	// offset of every scanline block, which is the line number,
+	// the data size and the three channel rows
+	int32_t lineDataSize = width * 3 * (int32_t)sizeof(float);
+	uint64_t lineOffset = file.size() + (uint64_t)height * sizeof(uint64_t);
+	for (int y = 0; y < height; y++)
+	{
+		AppendValue(file, lineOffset);
+		lineOffset += 2 * sizeof(int32_t) + lineDataSize;
+	}
+
+	file.reserve((size_t)lineOffset);
+	for (int y = 0; y < height; y++)
+	{
+		AppendValue(file, (int32_t)y);
+		AppendValue(file, lineDataSize);
+		for (int channel = 2; channel >= 0; channel--)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				AppendValue(file, rgb[((size_t)y * width + x) * 3 + channel]);
+			}
+		}
+	}
+
+	return WriteFile(filename, file);
+}
@@ -0,0 +1,27 @@
+///////////////////////////////////////////////////////////////////////////////
+// imagewriter.h
+// ============
+// write rendered images to PNG and OpenEXR files without any image library
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/***********************************************************
+ *  ImageWriter
+ *
+ *  Both writers take the rows top first with three values
+ *  per pixel.  PNG files hold 8 bit color in uncompressed
+ *  deflate blocks, which every reader accepts, and EXR
+ *  files hold uncompressed 32 bit float scanlines, so the
+ *  full range of the radiance is kept.
+ ***********************************************************/
+namespace ImageWriter
+{
+	// write 8 bit RGB pixels to a PNG file
+	bool WritePng(const char* filename, int width, int height, const unsigned char* rgb);
+	// write float RGB pixels to an OpenEXR file
+	bool WriteExr(const char* filename, int width, int height, const float* rgb);
+}
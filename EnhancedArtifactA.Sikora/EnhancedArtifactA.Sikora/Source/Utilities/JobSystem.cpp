@@ -0,0 +1,475 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.cpp
+// ============
+// work-stealing job scheduler for spreading per-frame CPU work over all
+// of the available cores
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JobSystem.h"
+#include "AllocationCounter.h"
+
+#include <chrono>
+
+// declaration of global variables
+namespace
+{
+	// number of unsuccessful search rounds before a worker
+	// goes to sleep instead of spinning
+	const int SPIN_ROUNDS_BEFORE_SLEEP = 64;
+	// upper bound on how long a sleeping worker waits before
+	// looking for work again
+	const std::chrono::milliseconds WORKER_SLEEP_TIMEOUT(2);
+
+	// the job system and worker slot owned by the calling thread
+	thread_local const JobSystem* tls_pJobSystem = nullptr;
+	thread_local int tls_workerIndex = -1;
+}
+
+/***********************************************************
+ *  JobSystem()
+ *
+ *  The constructor for the class.  Worker slot zero belongs
+ *  to the creating thread, the other slots get a thread.
+ ***********************************************************/
+JobSystem::JobSystem(int workerThreadCount)
+{
+	m_queuedJobs = 0;
+	m_bShutdown = false;
+
+	// parking a job must not grow the list while frames run
+	m_waitingJobs.reserve(DEQUE_CAPACITY);
+
+	if (workerThreadCount <= 0)
+	{
+		int hardwareThreads = (int)std::thread::hardware_concurrency();
+		workerThreadCount = (hardwareThreads > 1) ? (hardwareThreads - 1) : 1;
+	}
+
+	for (int i = 0; i <= workerThreadCount; i++)
+	{
+		m_workers.push_back(new WORKER());
+	}
+
+	tls_pJobSystem = this;
+	tls_workerIndex = 0;
+
+	for (int i = 1; i <= workerThreadCount; i++)
+	{
+		m_threads.push_back(std::thread(&JobSystem::WorkerMain, this, i));
+	}
+}
+
+/***********************************************************
+ *  ~JobSystem()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleepLock);
+		m_bShutdown = true;
+	}
+	m_wakeUp.notify_all();
+
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+
+	for (WORKER* worker : m_workers)
+	{
+		delete worker;
+	}
+	m_workers.clear();
+
+	if (tls_pJobSystem == this)
+	{
+		tls_pJobSystem = nullptr;
+		tls_workerIndex = -1;
+	}
+}
+
+/***********************************************************
+ *  CurrentWorkerIndex()
+ *
+ *  This method is used for getting the worker slot of the
+ *  calling thread.  Threads that do not belong to the job
+ *  system share slot zero, which is safe because every
+ *  deque is protected by its own lock.
+ ***********************************************************/
+int JobSystem::CurrentWorkerIndex() const
+{
+	if (tls_pJobSystem == this)
+	{
+		return(tls_workerIndex);
+	}
+
+	return(0);
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for queueing a job.  The counter is
+ *  raised now and lowered when the job has finished.  A job
+ *  with an unfinished dependency is parked until the
+ *  dependency counter reaches zero.
+ ***********************************************************/
+void JobSystem::Run(
+	JobFunction function,
+	void* data,
+	int first,
+	int last,
+	JobCounter* counter,
+	const JobCounter* dependency)
+{
+	JOB job;
+	job.function = function;
+	job.data = data;
+	job.first = first;
+	job.last = last;
+	job.counter = counter;
+	job.dependency = dependency;
+
+	if (counter != nullptr)
+	{
+		counter->pending.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if ((dependency != nullptr) && !dependency->IsDone())
+	{
+		// the check is repeated under the lock, because the
+		// dependency may finish while the lock is acquired
+		std::lock_guard<std::mutex> lock(m_waitingLock);
+		if (!dependency->IsDone())
+		{
+			m_waitingJobs.push_back(job);
+			return;
+		}
+	}
+
+	Push(CurrentWorkerIndex(), job);
+}
+
+/***********************************************************
+ *  Push()
+ *
+ *  This method is used for adding a ready job to the back
+ *  of a worker deque and waking up a sleeping worker.
+ ***********************************************************/
+void JobSystem::Push(int workerIndex, const JOB& job)
+{
+	WORKER* worker = m_workers[workerIndex];
+	bool bQueued = false;
+
+	{
+		std::lock_guard<std::mutex> lock(worker->lock);
+		if (worker->tail - worker->head < DEQUE_CAPACITY)
+		{
+			worker->jobs[worker->tail % DEQUE_CAPACITY] = job;
+			worker->tail++;
+			bQueued = true;
+		}
+	}
+
+	if (bQueued == false)
+	{
+		// the deque is full, so run the job right away
+		Execute(workerIndex, job);
+		return;
+	}
+
+	m_queuedJobs.fetch_add(1, std::memory_order_release);
+	m_wakeUp.notify_one();
+}
+
+/***********************************************************
+ *  PopOwn()
+ *
+ *  This method is used for taking the newest job from the
+ *  back of the worker's own deque, which keeps recently
+ *  touched data hot in the cache.
+ ***********************************************************/
+bool JobSystem::PopOwn(int workerIndex, JOB& job)
+{
+	WORKER* worker = m_workers[workerIndex];
+	std::lock_guard<std::mutex> lock(worker->lock);
+
+	if (worker->tail == worker->head)
+	{
+		return(false);
+	}
+
+	worker->tail--;
+	job = worker->jobs[worker->tail % DEQUE_CAPACITY];
+	m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Steal()
+ *
+ *  This method is used for taking the oldest job from the
+ *  front of another worker's deque.  Victims are visited
+ *  starting next to the thief so that thieves spread out.
+ ***********************************************************/
+bool JobSystem::Steal(int workerIndex, JOB& job)
+{
+	int workerCount = (int)m_workers.size();
+
+	for (int offset = 1; offset < workerCount; offset++)
+	{
+		WORKER* victim = m_workers[(workerIndex + offset) % workerCount];
+
+		std::unique_lock<std::mutex> lock(victim->lock, std::try_to_lock);
+		if (!lock.owns_lock())
+		{
+			continue;
+		}
+		if (victim->tail == victim->head)
+		{
+			continue;
+		}
+
+		job = victim->jobs[victim->head % DEQUE_CAPACITY];
+		victim->head++;
+		m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+		m_workers[workerIndex]->jobsStolen.fetch_add(1, std::memory_order_relaxed);
+
+		return(true);
+	}
+
+	m_workers[workerIndex]->failedSteals.fetch_add(1, std::memory_order_relaxed);
+
+	return(false);
+}
+
+/***********************************************************
+ *  RunOneJob()
+ *
+ *  This method is used for running the next available job
+ *  for the passed in worker.
+ ***********************************************************/
+bool JobSystem::RunOneJob(int workerIndex)
+{
+	JOB job;
+
+	if (PopOwn(workerIndex, job) || Steal(workerIndex, job))
+	{
+		Execute(workerIndex, job);
+		return(true);
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  Execute()
+ *
+ *  This method is used for running a job, lowering its
+ *  counter and releasing any jobs that were waiting on it.
+ ***********************************************************/
+void JobSystem::Execute(int workerIndex, const JOB& job)
+{
+	job.function(job.data, job.first, job.last);
+	m_workers[workerIndex]->jobsExecuted.fetch_add(1, std::memory_order_relaxed);
+
+	// the count is published before the job counter drops, so
+	// a thread that waited for the job sees the allocations
+	if (workerIndex > 0)
+	{
+		m_workers[workerIndex]->allocations.store(AllocationCounter::GetThreadAllocations(), std::memory_order_relaxed);
+	}
+
+	if (job.counter != nullptr)
+	{
+		int remaining = job.counter->pending.fetch_sub(1, std::memory_order_acq_rel) - 1;
+		if (remaining == 0)
+		{
+			ReleaseWaitingJobs(workerIndex);
+		}
+	}
+}
+
+/***********************************************************
+ *  ReleaseWaitingJobs()
+ *
+ *  This method is used for moving the parked jobs whose
+ *  dependency has finished into the worker deque.
+ ***********************************************************/
+void JobSystem::ReleaseWaitingJobs(int workerIndex)
+{
+	// the released jobs are collected in a fixed batch, so
+	// that no allocation happens while the lock is held
+	const int RELEASE_BATCH = 64;
+	JOB releasedJobs[RELEASE_BATCH];
+	int releasedCount = 0;
+	bool bMore = true;
+
+	while (bMore == true)
+	{
+		bMore = false;
+		releasedCount = 0;
+		{
+			std::lock_guard<std::mutex> lock(m_waitingLock);
+			size_t index = 0;
+			while (index < m_waitingJobs.size())
+			{
+				if (m_waitingJobs[index].dependency->IsDone())
+				{
+					if (releasedCount == RELEASE_BATCH)
+					{
+						bMore = true;
+						break;
+					}
+					releasedJobs[releasedCount++] = m_waitingJobs[index];
+					m_waitingJobs[index] = m_waitingJobs.back();
+					m_waitingJobs.pop_back();
+				}
+				else
+				{
+					index++;
+				}
+			}
+		}
+
+		for (int i = 0; i < releasedCount; i++)
+		{
+			Push(workerIndex, releasedJobs[i]);
+		}
+	}
+}
+
+/***********************************************************
+ *  Wait()
+ *
+ *  This method is used for waiting until every job counted
+ *  by the counter has finished.  The calling thread keeps
+ *  running jobs in the meantime.
+ ***********************************************************/
+void JobSystem::Wait(JobCounter& counter)
+{
+	int workerIndex = CurrentWorkerIndex();
+
+	while (!counter.IsDone())
+	{
+		if (RunOneJob(workerIndex) == false)
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+/***********************************************************
+ *  WorkerMain()
+ *
+ *  This method is the main loop of every worker thread.  A
+ *  worker that finds no work spins for a short while and
+ *  then sleeps until a new job is queued.
+ ***********************************************************/
+void JobSystem::WorkerMain(int workerIndex)
+{
+	tls_pJobSystem = this;
+	tls_workerIndex = workerIndex;
+
+	WORKER* worker = m_workers[workerIndex];
+	int failedRounds = 0;
+
+	while (m_bShutdown.load(std::memory_order_acquire) == false)
+	{
+		if (RunOneJob(workerIndex) == true)
+		{
+			failedRounds = 0;
+			continue;
+		}
+
+		std::chrono::steady_clock::time_point idleStart = std::chrono::steady_clock::now();
+
+		failedRounds++;
+		if (failedRounds < SPIN_ROUNDS_BEFORE_SLEEP)
+		{
+			std::this_thread::yield();
+		}
+		else
+		{
+			std::unique_lock<std::mutex> lock(m_sleepLock);
+			m_wakeUp.wait_for(lock, WORKER_SLEEP_TIMEOUT, [this]
+				{
+					return (m_bShutdown.load() || (m_queuedJobs.load() > 0));
+				});
+			failedRounds = 0;
+		}
+
+		std::chrono::steady_clock::duration idleTime = std::chrono::steady_clock::now() - idleStart;
+		worker->idleMicroseconds.fetch_add(
+			(uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(idleTime).count(),
+			std::memory_order_relaxed);
+	}
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for adding up the statistics of all
+ *  the workers.
+ ***********************************************************/
+JOB_SYSTEM_STATS JobSystem::GetStats() const
+{
+	JOB_SYSTEM_STATS stats;
+	stats.jobsExecuted = 0;
+	stats.jobsStolen = 0;
+	stats.failedSteals = 0;
+	stats.idleSeconds = 0.0;
+	stats.workerCount = (int)m_workers.size();
+
+	for (const WORKER* worker : m_workers)
+	{
+		stats.jobsExecuted += worker->jobsExecuted.load(std::memory_order_relaxed);
+		stats.jobsStolen += worker->jobsStolen.load(std::memory_order_relaxed);
+		stats.failedSteals += worker->failedSteals.load(std::memory_order_relaxed);
+		stats.idleSeconds += worker->idleMicroseconds.load(std::memory_order_relaxed) / 1000000.0;
+	}
+
+	return(stats);
+}
+
+/***********************************************************
+ *  GetWorkerAllocations()
+ *
+ *  This method is used for summing the heap allocations of
+ *  the worker threads.  The difference between two calls
+ *  around a frame counts every allocation made by the jobs
+ *  of that frame on the workers.  It is not reset by
+ *  ResetStats().
+ ***********************************************************/
+uint64_t JobSystem::GetWorkerAllocations() const
+{
+	uint64_t allocations = 0;
+	for (size_t i = 1; i < m_workers.size(); i++)
+	{
+		allocations += m_workers[i]->allocations.load(std::memory_order_relaxed);
+	}
+
+	return(allocations);
+}
+
+/***********************************************************
+ *  ResetStats()
+ *
+ *  This method is used for clearing the statistics.
+ ***********************************************************/
+void JobSystem::ResetStats()
+{
+	for (WORKER* worker : m_workers)
+	{
+		worker->jobsExecuted.store(0, std::memory_order_relaxed);
+		worker->jobsStolen.store(0, std::memory_order_relaxed);
+		worker->failedSteals.store(0, std::memory_order_relaxed);
+		worker->idleMicroseconds.store(0, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,193 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.h
+// ============
+// work-stealing job scheduler for spreading per-frame CPU work over all
+// of the available cores
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  JobCounter
+ *
+ *  Counts the jobs that still have to finish.  A counter is
+ *  used both to wait for a group of jobs and as the
+ *  dependency of jobs that must not start before the group
+ *  is done.
+ ***********************************************************/
+struct JobCounter
+{
+	std::atomic<int> pending{ 0 };
+
+	bool IsDone() const { return (pending.load(std::memory_order_acquire) == 0); }
+};
+
+/***********************************************************
+ *  JOB_SYSTEM_STATS
+ *
+ *  Totals collected since the last ResetStats() call.
+ ***********************************************************/
+struct JOB_SYSTEM_STATS
+{
+	uint64_t jobsExecuted;
+	uint64_t jobsStolen;
+	uint64_t failedSteals;
+	// time the worker threads spent without any work
+	double idleSeconds;
+	int workerCount;
+};
+
+/***********************************************************
+ *  JobSystem
+ *
+ *  Each worker owns a fixed size deque.  A worker pops its
+ *  own newest job first and, when it runs dry, steals the
+ *  oldest job from another worker.  The thread that created
+ *  the job system takes part as an extra worker whenever it
+ *  waits on a counter, so waiting never wastes a core.
+ *
+ *  Jobs are plain function pointers with a data pointer and
+ *  an index range, so submitting work does not allocate.
+ ***********************************************************/
+class JobSystem
+{
+public:
+	// function run by a job for the index range [first, last)
+	typedef void (*JobFunction)(void* data, int first, int last);
+
+	// constructor - zero worker threads means one less than
+	// the number of hardware threads
+	JobSystem(int workerThreadCount = 0);
+	// destructor
+	~JobSystem();
+
+	// queue a job, optionally holding it back until the
+	// dependency counter has reached zero
+	void Run(
+		JobFunction function,
+		void* data,
+		int first,
+		int last,
+		JobCounter* counter,
+		const JobCounter* dependency = nullptr);
+
+	// run jobs on the calling thread until the counter is zero
+	void Wait(JobCounter& counter);
+
+	// split [first, last) into contiguous ranges of at most
+	// grainSize indices and run the body over them in parallel
+	template<typename Body>
+	void ParallelFor(int first, int last, int grainSize, Body& body, JobCounter& counter)
+	{
+		if (grainSize < 1)
+		{
+			grainSize = 1;
+		}
+		for (int rangeStart = first; rangeStart < last; rangeStart += grainSize)
+		{
+			int rangeEnd = (rangeStart + grainSize < last) ? (rangeStart + grainSize) : last;
+			Run(&InvokeRange<Body>, &body, rangeStart, rangeEnd, &counter);
+		}
+	}
+
+	// blocking form of ParallelFor for callers with nothing
+	// else to do in the meantime
+	template<typename Body>
+	void ParallelFor(int first, int last, int grainSize, Body& body)
+	{
+		JobCounter counter;
+		ParallelFor(first, last, grainSize, body, counter);
+		Wait(counter);
+	}
+
+	// number of threads that execute jobs, including the caller
+	int GetWorkerCount() const { return (int)m_workers.size(); }
+
+	JOB_SYSTEM_STATS GetStats() const;
+	void ResetStats();
+
+	// heap allocations made so far by the worker threads, as
+	// of the last job each of them finished - the creating
+	// thread is left out, since its own counter already holds
+	// the jobs it ran while waiting
+	uint64_t GetWorkerAllocations() const;
+
+private:
+	struct JOB
+	{
+		JobFunction function;
+		void* data;
+		int first;
+		int last;
+		JobCounter* counter;
+		const JobCounter* dependency;
+	};
+
+	// capacity of every worker deque - a job that does not
+	// fit is run immediately on the submitting thread
+	static const int DEQUE_CAPACITY = 4096;
+
+	struct WORKER
+	{
+		std::mutex lock;
+		JOB jobs[DEQUE_CAPACITY];
+		// jobs live in the ring buffer between head and tail
+		int head = 0;
+		int tail = 0;
+		// per-worker statistics
+		std::atomic<uint64_t> jobsExecuted{ 0 };
+		std::atomic<uint64_t> jobsStolen{ 0 };
+		std::atomic<uint64_t> failedSteals{ 0 };
+		std::atomic<uint64_t> idleMicroseconds{ 0 };
+		// allocation counter of the worker thread, published
+		// when a job finishes
+		std::atomic<uint64_t> allocations{ 0 };
+	};
+
+	std::vector<WORKER*> m_workers;
+	std::vector<std::thread> m_threads;
+
+	// jobs whose dependency counter has not reached zero yet
+	std::mutex m_waitingLock;
+	std::vector<JOB> m_waitingJobs;
+
+	// sleeping workers are woken whenever a job is queued
+	std::mutex m_sleepLock;
+	std::condition_variable m_wakeUp;
+	std::atomic<int> m_queuedJobs;
+	std::atomic<bool> m_bShutdown;
+
+	template<typename Body>
+	static void InvokeRange(void* data, int first, int last)
+	{
+		(*(Body*)data)(first, last);
+	}
+
+	// main loop of the worker threads
+	void WorkerMain(int workerIndex);
+	// index of the worker running on the calling thread
+	int CurrentWorkerIndex() const;
+
+	// queue a job whose dependency is satisfied
+	void Push(int workerIndex, const JOB& job);
+	// take the newest job of the passed in worker
+	bool PopOwn(int workerIndex, JOB& job);
+	// take the oldest job of any other worker
+	bool Steal(int workerIndex, JOB& job);
+	// find and run one job, returns false when none was found
+	bool RunOneJob(int workerIndex);
+	// run a job and release the jobs that depended on it
+	void Execute(int workerIndex, const JOB& job);
+	// queue the waiting jobs whose dependency is now satisfied
+	void ReleaseWaitingJobs(int workerIndex);
+};
@@ -0,0 +1,162 @@
+///////////////////////////////////////////////////////////////////////////////
+// resourcehandle.h
+// ============
+// strongly typed resource handles made from tags hashed at compile time,
+// and a flat table for mapping the handles to loaded resources
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+/***********************************************************
+ *  HashTag()
+ *
+ *  32-bit FNV-1a hash of a tag string.  It is constexpr, so
+ *  tags written as literals are hashed by the compiler.
+ ***********************************************************/
+constexpr uint32_t HashTag(const char* tag)
+{
+	uint32_t hash = 2166136261u;
+	while (*tag != '\0')
+	{
+		hash ^= (uint8_t)(*tag);
+		hash *= 16777619u;
+		tag++;
+	}
+	return hash;
+}
+
+// the hash must be usable in constant expressions
+static_assert(HashTag("a") == 0xE40C292Cu, "HashTag must be evaluated at compile time");
+
+/***********************************************************
+ *  RESOURCE_HANDLE
+ *
+ *  Handle for one kind of resource.  The kind is a type
+ *  parameter, so a texture handle cannot be passed where a
+ *  material handle is expected.  Handles compare by hash
+ *  only; the tag is kept for error messages.
+ ***********************************************************/
+template<typename Kind>
+struct RESOURCE_HANDLE
+{
+	uint32_t hash;
+	const char* tag;
+
+	constexpr RESOURCE_HANDLE() : hash(0), tag("") {}
+	constexpr explicit RESOURCE_HANDLE(const char* tagName) : hash(HashTag(tagName)), tag(tagName) {}
+	// handle whose hash was computed ahead of time, such as
+	// one stored in a compiled scene file
+	constexpr RESOURCE_HANDLE(uint32_t tagHash, const char* tagName) : hash(tagHash), tag(tagName) {}
+
+	constexpr bool operator==(const RESOURCE_HANDLE& other) const { return (hash == other.hash); }
+	constexpr bool operator!=(const RESOURCE_HANDLE& other) const { return (hash != other.hash); }
+};
+
+struct TEXTURE_RESOURCE;
+struct MATERIAL_RESOURCE;
+struct MESH_RESOURCE;
+
+typedef RESOURCE_HANDLE<TEXTURE_RESOURCE> TextureHandle;
+typedef RESOURCE_HANDLE<MATERIAL_RESOURCE> MaterialHandle;
+typedef RESOURCE_HANDLE<MESH_RESOURCE> MeshHandle;
+
+// result of registering a handle in a resource table
+enum RESOURCE_REGISTER_RESULT
+{
+	REGISTER_OK,
+	REGISTER_DUPLICATE,		// the same tag was already registered
+	REGISTER_COLLISION,		// a different tag has the same hash
+	REGISTER_FULL			// the table is already half full
+};
+
+/***********************************************************
+ *  ResourceTable
+ *
+ *  Fixed size open addressing table with linear probing
+ *  that maps handles to values.  The capacity must be a
+ *  power of two and should be at least twice the number of
+ *  registered resources, which keeps probe chains short;
+ *  registration fails once the table is half full.
+ *  Entries are never removed, only the whole table is
+ *  cleared.
+ ***********************************************************/
+template<typename Handle, typename Value, int Capacity>
+class ResourceTable
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "ResourceTable capacity must be a power of two");
+
+public:
+	ResourceTable() { Clear(); }
+
+	void Clear()
+	{
+		for (int i = 0; i < Capacity; i++)
+		{
+			m_bUsed[i] = false;
+		}
+		m_count = 0;
+	}
+
+	// add a handle with its value
+	RESOURCE_REGISTER_RESULT Register(const Handle& handle, const Value& value)
+	{
+		// keeping half of the entries free guarantees that a
+		// lookup always ends at an empty entry
+		if (m_count * 2 >= Capacity)
+		{
+			return REGISTER_FULL;
+		}
+
+		int index = (int)(handle.hash & (Capacity - 1));
+		while (m_bUsed[index] == true)
+		{
+			if (m_handles[index].hash == handle.hash)
+			{
+				if (std::strcmp(m_handles[index].tag, handle.tag) == 0)
+				{
+					return REGISTER_DUPLICATE;
+				}
+				return REGISTER_COLLISION;
+			}
+			index = (index + 1) & (Capacity - 1);
+		}
+
+		m_bUsed[index] = true;
+		m_handles[index] = handle;
+		m_values[index] = value;
+		m_count++;
+
+		return REGISTER_OK;
+	}
+
+	// get the value registered for a handle, or null when the
+	// handle was never registered
+	const Value* Find(const Handle& handle) const
+	{
+		int index = (int)(handle.hash & (Capacity - 1));
+		while (m_bUsed[index] == true)
+		{
+			if (m_handles[index].hash == handle.hash)
+			{
+				return &m_values[index];
+			}
+			index = (index + 1) & (Capacity - 1);
+		}
+
+		return nullptr;
+	}
+
+	int GetCount() const { return m_count; }
+
+private:
+	bool m_bUsed[Capacity];
+	Handle m_handles[Capacity];
+	Value m_values[Capacity];
+	int m_count;
+};
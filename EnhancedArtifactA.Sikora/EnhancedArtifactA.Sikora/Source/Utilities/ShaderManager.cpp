@@ -1,10 +1,11 @@
-#include <stdio.h>
 #include <string>
 #include <vector>
 #include <iostream>
 #include <fstream>
 #include <algorithm>
 #include <sstream>
+#include <iterator>
+#include <utility>
 using namespace std;
 
 #include <stdlib.h>
@@ -13,6 +14,64 @@ using namespace std;
 #include <GL/glew.h>
 
 #include "ShaderManager.h"
+#include "GLDebug.h"
+
+// declaration of global variables
+namespace
+{
+	// the info log a shader or program was left with, which is
+	// empty when the driver wrote nothing
+	std::string GetInfoLog(GLuint id, bool bProgram)
+	{
+		int InfoLogLength = 0;
+		if (bProgram)
+		{
+			glGetProgramiv(id, GL_INFO_LOG_LENGTH, &InfoLogLength);
+		}
+		else
+		{
+			glGetShaderiv(id, GL_INFO_LOG_LENGTH, &InfoLogLength);
+		}
+		if (InfoLogLength <= 1)
+		{
+			return std::string();
+		}
+
+		std::vector<char> InfoLog(InfoLogLength + 1);
+		if (bProgram)
+		{
+			glGetProgramInfoLog(id, InfoLogLength, NULL, &InfoLog[0]);
+		}
+		else
+		{
+			glGetShaderInfoLog(id, InfoLogLength, NULL, &InfoLog[0]);
+		}
+		return std::string(&InfoLog[0]);
+	}
+
+	// print the outcome of compiling or linking with the info
+	// log of the step, as an error when the step failed and as
+	// a warning when it succeeded with a log
+	void ReportStep(const char* step, const char* name, GLint result, const std::string& infoLog)
+	{
+		if (result != GL_TRUE)
+		{
+			std::cout << "ERROR: " << step << " " << name << " failed" << std::endl;
+		}
+		else if (infoLog.empty())
+		{
+			std::cout << "INFO: " << step << " " << name << " succeeded" << std::endl;
+		}
+		else
+		{
+			std::cout << "WARNING: " << step << " " << name << " succeeded with messages" << std::endl;
+		}
+		if (!infoLog.empty())
+		{
+			std::cout << infoLog << std::endl;
+		}
+	}
+}
 
 /***********************************************************
  *  LoadShaders()
@@ -35,8 +94,9 @@ GLuint ShaderManager::LoadShaders(const char * vertex_file_path,const char * fra
 		VertexShaderCode = sstr.str();
 		VertexShaderStream.close();
 	}else{
-		printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", vertex_file_path);
-		getchar();
+		std::cout << "ERROR: Impossible to open " << vertex_file_path << ". Are you in the right directory?" << std::endl;
+		glDeleteShader(VertexShaderID);
+		glDeleteShader(FragmentShaderID);
 		return 0;
 	}
 
@@ -48,72 +108,448 @@ GLuint ShaderManager::LoadShaders(const char * vertex_file_path,const char * fra
 		sstr << FragmentShaderStream.rdbuf();
 		FragmentShaderCode = sstr.str();
 		FragmentShaderStream.close();
+	}else{
+		std::cout << "ERROR: Impossible to open " << fragment_file_path << std::endl;
+		glDeleteShader(VertexShaderID);
+		glDeleteShader(FragmentShaderID);
+		return 0;
 	}
 
 	GLint Result = GL_FALSE;
-	int InfoLogLength;
 
 
 	// Compile Vertex Shader
-	printf("Compiling shader : %s...", vertex_file_path);
 	char const * VertexSourcePointer = VertexShaderCode.c_str();
 	glShaderSource(VertexShaderID, 1, &VertexSourcePointer , NULL);
 	glCompileShader(VertexShaderID);
 
 	// Check Vertex Shader
 	glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if ( InfoLogLength > 0 ){
-		std::vector<char> VertexShaderErrorMessage(InfoLogLength+1);
-		glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
-		printf("\n%s\n", &VertexShaderErrorMessage[0]);
+	ReportStep("Compiling shader", vertex_file_path, Result, GetInfoLog(VertexShaderID, false));
+	if ( Result != GL_TRUE ){
+		glDeleteShader(VertexShaderID);
+		glDeleteShader(FragmentShaderID);
+		return 0;
 	}
 
-	printf("success\n");
-
 	// Compile Fragment Shader
-	printf("Compiling shader : %s...", fragment_file_path);
 	char const * FragmentSourcePointer = FragmentShaderCode.c_str();
 	glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer , NULL);
 	glCompileShader(FragmentShaderID);
 
 	// Check Fragment Shader
 	glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if ( InfoLogLength > 0 ){
-		std::vector<char> FragmentShaderErrorMessage(InfoLogLength+1);
-		glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
-		printf("\n%s\n", &FragmentShaderErrorMessage[0]);
+	ReportStep("Compiling shader", fragment_file_path, Result, GetInfoLog(FragmentShaderID, false));
+	if ( Result != GL_TRUE ){
+		glDeleteShader(VertexShaderID);
+		glDeleteShader(FragmentShaderID);
+		return 0;
 	}
 
-	printf("success\n");
+	return LinkShaders(VertexShaderID, FragmentShaderID, vertex_file_path, fragment_file_path, false);
+}
+
+/***********************************************************
+ *  LoadComputeShader()
+ *
+ *  This method is called to load a compute shader from an
+ *  external GLSL compatible file and link it into its own
+ *  program.  It returns 0 when the shader does not compile
+ *  or link.
+ ***********************************************************/
+GLuint ShaderManager::LoadComputeShader(const char * compute_file_path){
+
+	// Read the Compute Shader code from the file
+	std::string ComputeShaderCode;
+	std::ifstream ComputeShaderStream(compute_file_path, std::ios::in);
+	if(ComputeShaderStream.is_open()){
+		std::stringstream sstr;
+		sstr << ComputeShaderStream.rdbuf();
+		ComputeShaderCode = sstr.str();
+		ComputeShaderStream.close();
+	}else{
+		std::cout << "ERROR: Impossible to open " << compute_file_path << std::endl;
+		return 0;
+	}
+
+	GLint Result = GL_FALSE;
+
+	// Compile Compute Shader
+	GLuint ComputeShaderID = glCreateShader(GL_COMPUTE_SHADER);
+	char const * ComputeSourcePointer = ComputeShaderCode.c_str();
+	glShaderSource(ComputeShaderID, 1, &ComputeSourcePointer , NULL);
+	glCompileShader(ComputeShaderID);
+
+	// Check Compute Shader
+	glGetShaderiv(ComputeShaderID, GL_COMPILE_STATUS, &Result);
+	ReportStep("Compiling shader", compute_file_path, Result, GetInfoLog(ComputeShaderID, false));
+	if ( Result != GL_TRUE ){
+		glDeleteShader(ComputeShaderID);
+		return 0;
+	}
 
 	// Link the program
-	printf("Linking shader program...");
 	GLuint ProgramID = glCreateProgram();
-	m_programID = ProgramID;
-	glAttachShader(ProgramID, VertexShaderID);
-	glAttachShader(ProgramID, FragmentShaderID);
+	glAttachShader(ProgramID, ComputeShaderID);
 	glLinkProgram(ProgramID);
 
 	// Check the program
 	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
-	glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if ( InfoLogLength > 1 ){
-		std::vector<char> ProgramErrorMessage(InfoLogLength+1);
-		glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
-		printf("\n%s\n", &ProgramErrorMessage[0]);
+	ReportStep("Linking compute program", compute_file_path, Result, GetInfoLog(ProgramID, true));
+
+	glDetachShader(ProgramID, ComputeShaderID);
+	glDeleteShader(ComputeShaderID);
+
+	if ( Result != GL_TRUE ){
+		glDeleteProgram(ProgramID);
+		return 0;
 	}
 
-	printf("success\n");
-	
-	glDetachShader(ProgramID, VertexShaderID);
-	glDetachShader(ProgramID, FragmentShaderID);
-	
-	glDeleteShader(VertexShaderID);
-	glDeleteShader(FragmentShaderID);
+	GLDebug::LabelObject(GL_PROGRAM, ProgramID, compute_file_path);
 
 	return ProgramID;
 }
 
 
+/***********************************************************
+ *  IsSpirvSupported()
+ *
+ *  This method is called to check whether the current
+ *  context can load SPIR-V shaders.
+ ***********************************************************/
+bool ShaderManager::IsSpirvSupported(){
+
+	return (GLEW_VERSION_4_6 || GLEW_ARB_gl_spirv) ? true : false;
+}
+
+/***********************************************************
+ *  IsPipelineSupported()
+ *
+ *  This method is called to check whether the current
+ *  context can bind separable programs through a program
+ *  pipeline.
+ ***********************************************************/
+bool ShaderManager::IsPipelineSupported(){
+
+	return (GLEW_VERSION_4_1 || GLEW_ARB_separate_shader_objects) ? true : false;
+}
+
+/***********************************************************
+ *  LoadSpirvShader()
+ *
+ *  This method is called to create one shader stage from a
+ *  SPIR-V binary file and specialize its main entry point
+ *  with the constants listed for the stage.  It returns 0
+ *  when the file cannot be read or the specialization
+ *  fails.
+ ***********************************************************/
+GLuint ShaderManager::LoadSpirvShader(
+	GLenum shader_type,
+	const char * spirv_file_path,
+	const std::vector<SHADER_SPECIALIZATION>& specializations){
+
+	// Read the SPIR-V module from the file
+	std::vector<char> ShaderBinary;
+	std::ifstream ShaderStream(spirv_file_path, std::ios::in | std::ios::binary);
+	if(ShaderStream.is_open()){
+		ShaderBinary.assign(std::istreambuf_iterator<char>(ShaderStream), std::istreambuf_iterator<char>());
+		ShaderStream.close();
+	}
+	if(ShaderBinary.empty() || (ShaderBinary.size() % 4) != 0){
+		std::cout << "ERROR: Impossible to read SPIR-V shader " << spirv_file_path << std::endl;
+		return 0;
+	}
+
+	// Only the constants of this stage are passed, since naming
+	// a constant the module does not have fails the stage
+	std::vector<GLuint> ConstantIDs;
+	std::vector<GLuint> ConstantValues;
+	for(size_t i = 0; i < specializations.size(); i++){
+		if(specializations[i].shaderType == shader_type){
+			ConstantIDs.push_back(specializations[i].constantID);
+			ConstantValues.push_back(specializations[i].value);
+		}
+	}
+
+	// Specialize the shader
+	GLuint ShaderID = glCreateShader(shader_type);
+	glShaderBinary(1, &ShaderID, GL_SHADER_BINARY_FORMAT_SPIR_V, ShaderBinary.data(), (GLsizei)ShaderBinary.size());
+	const GLuint * ConstantIDPointer = ConstantIDs.empty() ? NULL : ConstantIDs.data();
+	const GLuint * ConstantValuePointer = ConstantValues.empty() ? NULL : ConstantValues.data();
+	if(GLEW_VERSION_4_6){
+		glSpecializeShader(ShaderID, "main", (GLuint)ConstantIDs.size(), ConstantIDPointer, ConstantValuePointer);
+	}else{
+		glSpecializeShaderARB(ShaderID, "main", (GLuint)ConstantIDs.size(), ConstantIDPointer, ConstantValuePointer);
+	}
+
+	// Check the shader
+	GLint Result = GL_FALSE;
+	glGetShaderiv(ShaderID, GL_COMPILE_STATUS, &Result);
+	ReportStep("Specializing SPIR-V shader", spirv_file_path, Result, GetInfoLog(ShaderID, false));
+	if ( Result != GL_TRUE ){
+		glDeleteShader(ShaderID);
+		return 0;
+	}
+
+	return ShaderID;
+}
+
+/***********************************************************
+ *  CheckSpirvUniforms()
+ *
+ *  This method is called to check that every active
+ *  uniform of a linked SPIR-V program can be found by its
+ *  name, and that no two uniforms share a location.  It
+ *  prints each uniform that fails and returns false when
+ *  any does.
+ ***********************************************************/
+bool ShaderManager::CheckSpirvUniforms(GLuint program_id){
+
+	GLint UniformCount = 0;
+	GLint MaxNameLength = 0;
+	glGetProgramiv(program_id, GL_ACTIVE_UNIFORMS, &UniformCount);
+	glGetProgramiv(program_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &MaxNameLength);
+
+	bool bValid = true;
+	std::vector<char> UniformName(std::max(MaxNameLength, 1) + 1);
+	std::vector<std::pair<GLint, std::string> > UsedLocations;
+	for(GLint i = 0; i < UniformCount; i++){
+		GLint ArraySize = 0;
+		GLenum UniformType = GL_NONE;
+		GLsizei NameLength = 0;
+		UniformName[0] = '\0';
+		glGetActiveUniform(program_id, (GLuint)i, (GLsizei)UniformName.size(), &NameLength, &ArraySize, &UniformType, UniformName.data());
+		if ( NameLength == 0 ){
+			std::cout << "ERROR: SPIR-V uniform " << i << " has no name" << std::endl;
+			bValid = false;
+			continue;
+		}
+
+		// members of uniform blocks have no location of their own
+		GLint BlockIndex = -1;
+		GLuint UniformIndex = (GLuint)i;
+		glGetActiveUniformsiv(program_id, 1, &UniformIndex, GL_UNIFORM_BLOCK_INDEX, &BlockIndex);
+		if ( BlockIndex != -1 ){
+			continue;
+		}
+
+		GLint Location = glGetUniformLocation(program_id, UniformName.data());
+		if ( Location < 0 ){
+			std::cout << "ERROR: SPIR-V uniform " << UniformName.data() << " cannot be found by its name" << std::endl;
+			bValid = false;
+			continue;
+		}
+
+		// an array takes one location per element
+		for(GLint element = 0; element < ArraySize; element++){
+			for(size_t used = 0; used < UsedLocations.size(); used++){
+				if ( UsedLocations[used].first == Location + element ){
+					std::cout << "ERROR: SPIR-V uniforms " << UsedLocations[used].second << " and " << UniformName.data()
+						<< " share location " << Location + element << std::endl;
+					bValid = false;
+				}
+			}
+			UsedLocations.push_back(std::make_pair(Location + element, std::string(UniformName.data())));
+		}
+	}
+
+	return bValid;
+}
+
+/***********************************************************
+ *  LoadSpirvShaders()
+ *
+ *  This method is called to load a vertex and a fragment
+ *  shader precompiled to SPIR-V, which skips the GLSL
+ *  compiler of the driver.  It returns 0 when the context
+ *  cannot take SPIR-V, the files cannot be loaded, or the
+ *  uniforms of the linked program cannot be set by name.
+ ***********************************************************/
+GLuint ShaderManager::LoadSpirvShaders(
+	const char * vertex_spirv_path,
+	const char * fragment_spirv_path,
+	const std::vector<SHADER_SPECIALIZATION>& specializations){
+
+	if(!IsSpirvSupported()){
+		return 0;
+	}
+
+	GLuint VertexShaderID = LoadSpirvShader(GL_VERTEX_SHADER, vertex_spirv_path, specializations);
+	if(VertexShaderID == 0){
+		return 0;
+	}
+	GLuint FragmentShaderID = LoadSpirvShader(GL_FRAGMENT_SHADER, fragment_spirv_path, specializations);
+	if(FragmentShaderID == 0){
+		glDeleteShader(VertexShaderID);
+		return 0;
+	}
+
+	return LinkShaders(VertexShaderID, FragmentShaderID, vertex_spirv_path, fragment_spirv_path, true);
+}
+
+/***********************************************************
+ *  LoadShaderProgram()
+ *
+ *  This method is called to load the SPIR-V build of a
+ *  vertex and fragment shader, falling back to compiling
+ *  their GLSL text when the SPIR-V cannot be used.
+ ***********************************************************/
+GLuint ShaderManager::LoadShaderProgram(
+	const char * vertex_file_path,
+	const char * fragment_file_path,
+	const char * vertex_spirv_path,
+	const char * fragment_spirv_path,
+	const std::vector<SHADER_SPECIALIZATION>& specializations){
+
+	GLuint ProgramID = LoadSpirvShaders(vertex_spirv_path, fragment_spirv_path, specializations);
+	if(ProgramID != 0){
+		return ProgramID;
+	}
+
+	if(IsSpirvSupported()){
+		std::cout << "WARNING: Falling back to the GLSL shaders" << std::endl;
+	}
+	return LoadShaders(vertex_file_path, fragment_file_path);
+}
+
+/***********************************************************
+ *  LinkProgram()
+ *
+ *  This method is called to link compiled shaders into a
+ *  program, marked separable when it is one stage of a
+ *  pipeline.  The uniforms of a SPIR-V program are checked
+ *  after it links.  It returns 0 when the program does not
+ *  link.
+ ***********************************************************/
+GLuint ShaderManager::LinkProgram(
+	const GLuint * shader_ids,
+	int shader_count,
+	bool bSeparable,
+	const char * step,
+	const char * name,
+	bool bSpirv){
+
+	// Link the program
+	GLuint ProgramID = glCreateProgram();
+	if(bSeparable){
+		glProgramParameteri(ProgramID, GL_PROGRAM_SEPARABLE, GL_TRUE);
+	}
+	for(int i = 0; i < shader_count; i++){
+		glAttachShader(ProgramID, shader_ids[i]);
+	}
+	glLinkProgram(ProgramID);
+
+	// Check the program
+	GLint Result = GL_FALSE;
+	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+	ReportStep(step, name, Result, GetInfoLog(ProgramID, true));
+
+	for(int i = 0; i < shader_count; i++){
+		glDetachShader(ProgramID, shader_ids[i]);
+	}
+
+	// The scene sets every uniform by name, so each one must
+	// still be found by its name - names are optional in SPIR-V
+	// and some drivers drop them - and must own its locations,
+	// since the stages were compiled apart and a uniform left
+	// without an explicit location can land on another's
+	if ( bSpirv && Result == GL_TRUE && !CheckSpirvUniforms(ProgramID) ){
+		Result = GL_FALSE;
+	}
+
+	if ( Result != GL_TRUE ){
+		glDeleteProgram(ProgramID);
+		return 0;
+	}
+
+	GLDebug::LabelObject(GL_PROGRAM, ProgramID, name);
+
+	return ProgramID;
+}
+
+/***********************************************************
+ *  LinkShaders()
+ *
+ *  This method is called to link a compiled vertex and
+ *  fragment shader and make them the shaders of the class.
+ *  When the context has separate shader objects each stage
+ *  is linked into a separable program of its own and both
+ *  are bound through a program pipeline, so that a stage
+ *  can be swapped or shared without relinking the other
+ *  and uniforms can be set without the program in use.
+ *  Otherwise both are linked into one program.  The shaders
+ *  are deleted, and 0 is returned on failure.
+ ***********************************************************/
+GLuint ShaderManager::LinkShaders(
+	GLuint vertex_shader_id,
+	GLuint fragment_shader_id,
+	const char * vertex_name,
+	const char * fragment_name,
+	bool bSpirv){
+
+	const char * Step = bSpirv ? "Linking SPIR-V shader program" : "Linking shader program";
+	GLuint ShaderIDs[2] = { vertex_shader_id, fragment_shader_id };
+
+	if(!IsPipelineSupported()){
+		GLuint ProgramID = LinkProgram(ShaderIDs, 2, false, Step, vertex_name, bSpirv);
+		glDeleteShader(vertex_shader_id);
+		glDeleteShader(fragment_shader_id);
+		if ( ProgramID == 0 ){
+			return 0;
+		}
+
+		m_programID = ProgramID;
+		m_pipelineID = 0;
+		m_stagePrograms[0] = 0;
+		m_stagePrograms[1] = 0;
+		return ProgramID;
+	}
+
+	GLuint VertexProgramID = LinkProgram(&ShaderIDs[0], 1, true, Step, vertex_name, bSpirv);
+	GLuint FragmentProgramID = 0;
+	if ( VertexProgramID != 0 ){
+		FragmentProgramID = LinkProgram(&ShaderIDs[1], 1, true, Step, fragment_name, bSpirv);
+	}
+	glDeleteShader(vertex_shader_id);
+	glDeleteShader(fragment_shader_id);
+	if ( FragmentProgramID == 0 ){
+		glDeleteProgram(VertexProgramID);
+		return 0;
+	}
+
+	// Bind the stages through a pipeline
+	GLuint PipelineID = 0;
+	glGenProgramPipelines(1, &PipelineID);
+	glUseProgramStages(PipelineID, GL_VERTEX_SHADER_BIT, VertexProgramID);
+	glUseProgramStages(PipelineID, GL_FRAGMENT_SHADER_BIT, FragmentProgramID);
+
+	m_programID = 0;
+	m_pipelineID = PipelineID;
+	m_stagePrograms[0] = VertexProgramID;
+	m_stagePrograms[1] = FragmentProgramID;
+
+	return PipelineID;
+}
+
+/***********************************************************
+ *  Release()
+ *
+ *  This method is called to free the program, or the
+ *  pipeline and its separable programs.
+ ***********************************************************/
+void ShaderManager::Release(){
+
+	if ( m_pipelineID != 0 ){
+		glDeleteProgramPipelines(1, &m_pipelineID);
+		glDeleteProgram(m_stagePrograms[0]);
+		glDeleteProgram(m_stagePrograms[1]);
+	}
+	if ( m_programID != 0 ){
+		glDeleteProgram(m_programID);
+	}
+
+	m_programID = 0;
+	m_pipelineID = 0;
+	m_stagePrograms[0] = 0;
+	m_stagePrograms[1] = 0;
+}
@@ -7,97 +7,364 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <string>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
+// value of one specialization constant of a SPIR-V shader
+// stage, set when the stage is loaded
+struct SHADER_SPECIALIZATION
+{
+	GLenum shaderType;
+	GLuint constantID;
+	GLuint value;
+};
+
 class ShaderManager
 {
 public:
+	// the linked program, 0 when the stages were linked into
+	// separable programs bound through m_pipelineID
 	unsigned int m_programID;
-	
+	// program pipeline and its separable vertex and fragment
+	// programs, 0 when the context has no separate shader
+	// objects
+	GLuint m_pipelineID;
+	GLuint m_stagePrograms[2];
+
+	ShaderManager()
+	{
+		m_programID = 0;
+		m_pipelineID = 0;
+		m_stagePrograms[0] = 0;
+		m_stagePrograms[1] = 0;
+	}
+
+	// the loaders return the program, or the pipeline when the
+	// stages were linked apart, and 0 on failure
 	GLuint LoadShaders(
 		const char* vertex_file_path, 
 		const char* fragment_file_path);
 
+	// load a compute shader into its own program - the
+	// program of the class is left unchanged
+	GLuint LoadComputeShader(
+		const char* compute_file_path);
+
+	// load shaders precompiled to SPIR-V and specialize them,
+	// returns 0 when the context or the driver cannot use
+	// them, or the files are missing - the program of the
+	// class is only replaced on success
+	GLuint LoadSpirvShaders(
+		const char* vertex_spirv_path,
+		const char* fragment_spirv_path,
+		const std::vector<SHADER_SPECIALIZATION>& specializations);
+
+	// load the SPIR-V shaders when they can be used, and
+	// compile the GLSL text, which runs with the defaults of
+	// the specialization constants, otherwise
+	GLuint LoadShaderProgram(
+		const char* vertex_file_path,
+		const char* fragment_file_path,
+		const char* vertex_spirv_path,
+		const char* fragment_spirv_path,
+		const std::vector<SHADER_SPECIALIZATION>& specializations);
+
+	// free the program or the pipeline and its programs
+	void Release();
+
+	// whether the context takes SPIR-V shaders, through
+	// OpenGL 4.6 or the ARB_gl_spirv extension
+	static bool IsSpirvSupported();
+
+	// whether the context can link the stages into separable
+	// programs, through OpenGL 4.1 or the
+	// ARB_separate_shader_objects extension
+	static bool IsPipelineSupported();
+
+	// whether a program or a pipeline was loaded
+	// ------------------------------------------------------------------------
+	inline bool isLoaded() const
+	{
+		return (m_programID != 0) || (m_pipelineID != 0);
+	}
+
 	// activate the shader
 	// ------------------------------------------------------------------------
-	inline void use()
+	inline void use() const
 	{
-		glUseProgram(m_programID);
+		if (m_pipelineID != 0)
+		{
+			// a program in use takes precedence over the
+			// bound pipeline
+			glUseProgram(0);
+			glBindProgramPipeline(m_pipelineID);
+		}
+		else
+		{
+			glUseProgram(m_programID);
+		}
+	}
+
+	// leave no program or pipeline in use
+	// ------------------------------------------------------------------------
+	static inline void useNone()
+	{
+		glUseProgram(0);
+		if (IsPipelineSupported())
+		{
+			glBindProgramPipeline(0);
+		}
 	}
 
 	// utility uniform functions
 	// ------------------------------------------------------------------------
-	inline void setBoolValue(const std::string &name, bool value) const
+	inline void setBoolValue(const char* name, bool value) const
 	{
-		glUniform1i(glGetUniformLocation(m_programID, name.c_str()), (int)value);
+		setIntValue(getUniformLocation(name), (int)value);
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setIntValue(const std::string &name, int value) const
+	inline void setIntValue(const char* name, int value) const
 	{
-		glUniform1i(glGetUniformLocation(m_programID, name.c_str()), value);
+		setIntValue(getUniformLocation(name), value);
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setFloatValue(const std::string &name, float value) const
+	inline void setFloatValue(const char* name, float value) const
 	{
-		glUniform1f(glGetUniformLocation(m_programID, name.c_str()), value);
+		setFloatValue(getUniformLocation(name), value);
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setVec2Value(const std::string &name, const glm::vec2 &value) const
+	inline void setVec2Value(const char* name, const glm::vec2 &value) const
+	{
+		setVec2Value(getUniformLocation(name), value);
+	}
+
+	inline void setVec2Value(const char* name, float x, float y) const
 	{
-		glUniform2fv(glGetUniformLocation(m_programID, name.c_str()), 1, &value[0]);
+		setVec2Value(getUniformLocation(name), glm::vec2(x, y));
 	}
 
-	inline void setVec2Value(const std::string &name, float x, float y) const
+	// ------------------------------------------------------------------------
+	inline void setVec3Value(const char* name, const glm::vec3 &value) const
+	{
+		setVec3Value(getUniformLocation(name), value);
+	}
+	inline void setVec3Value(const char* name, float x, float y, float z) const
 	{
-		glUniform2f(glGetUniformLocation(m_programID, name.c_str()), x, y);
+		setVec3Value(getUniformLocation(name), glm::vec3(x, y, z));
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setVec3Value(const std::string &name, const glm::vec3 &value) const
+	inline void setVec4Value(const char* name, const glm::vec4 &value) const
+	{
+		setVec4Value(getUniformLocation(name), value);
+	}
+	inline void setVec4Value(const char* name, float x, float y, float z, float w)
 	{
-		glUniform3fv(glGetUniformLocation(m_programID, name.c_str()), 1, &value[0]);
+		setVec4Value(getUniformLocation(name), glm::vec4(x, y, z, w));
 	}
-	inline void setVec3Value(const std::string &name, float x, float y, float z) const
+
+	// ------------------------------------------------------------------------
+	inline void setMat2Value(const char* name, const glm::mat2 &mat) const
 	{
-		glUniform3f(glGetUniformLocation(m_programID, name.c_str()), x, y, z);
+		setMat2Value(getUniformLocation(name), mat);
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setVec4Value(const std::string &name, const glm::vec4 &value) const
+	inline void setMat3Value(const char* name, const glm::mat3 &mat) const
 	{
-		glUniform4fv(glGetUniformLocation(m_programID, name.c_str()), 1, &value[0]);
+		setMat3Value(getUniformLocation(name), mat);
 	}
-	inline void setVec4Value(const std::string &name, float x, float y, float z, float w)
+
+	// ------------------------------------------------------------------------
+	inline void setMat4Value(const char* name, const glm::mat4 &mat) const
 	{
-		glUniform4f(glGetUniformLocation(m_programID, name.c_str()), x, y, z, w);
+		setMat4Value(getUniformLocation(name), mat);
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setMat2Value(const std::string &name, const glm::mat2 &mat) const
+	inline void setSampler2DValue(const char* name, const int &value) const
 	{
-		glUniformMatrix2fv(glGetUniformLocation(m_programID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		setIntValue(getUniformLocation(name), value);
 	}
 
+	// look up the location of a uniform once, so that values
+	// can be set in the render loop without any name lookups -
+	// with a pipeline the location holds the location in the
+	// vertex program plus one in its low 16 bits and in the
+	// fragment program plus one in its high 16 bits, and is
+	// only meant for the setters of the class
 	// ------------------------------------------------------------------------
-	inline void setMat3Value(const std::string &name, const glm::mat3 &mat) const
+	inline GLint getUniformLocation(const char* name) const
 	{
-		glUniformMatrix3fv(glGetUniformLocation(m_programID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		if (m_pipelineID == 0)
+		{
+			return glGetUniformLocation(m_programID, name);
+		}
+
+		GLint vertexLocation = glGetUniformLocation(m_stagePrograms[0], name);
+		GLint fragmentLocation = glGetUniformLocation(m_stagePrograms[1], name);
+		if ((vertexLocation < 0) && (fragmentLocation < 0))
+		{
+			return -1;
+		}
+		return (vertexLocation + 1) | ((fragmentLocation + 1) << 16);
 	}
 
+	// the setters by location set the program in use, or with
+	// a pipeline each of its programs that has the uniform,
+	// whether or not the pipeline is bound
 	// ------------------------------------------------------------------------
-	inline void setMat4Value(const std::string &name, const glm::mat4 &mat) const
+	inline void setIntValue(GLint location, int value) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(m_programID, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+		if (m_pipelineID == 0)
+		{
+			glUniform1i(location, value);
+			return;
+		}
+		setStageValues(location, [value](GLuint program, GLint stageLocation)
+			{ glProgramUniform1i(program, stageLocation, value); });
 	}
 
 	// ------------------------------------------------------------------------
-	inline void setSampler2DValue(const std::string& name, const int &value) const
+	inline void setFloatValue(GLint location, float value) const
 	{
-		glUniform1i(glGetUniformLocation(m_programID, name.c_str()), value);
+		if (m_pipelineID == 0)
+		{
+			glUniform1f(location, value);
+			return;
+		}
+		setStageValues(location, [value](GLuint program, GLint stageLocation)
+			{ glProgramUniform1f(program, stageLocation, value); });
 	}
+
+	// ------------------------------------------------------------------------
+	inline void setVec2Value(GLint location, const glm::vec2 &value) const
+	{
+		setVec2ArrayValue(location, 1, &value[0]);
+	}
+
+	// ------------------------------------------------------------------------
+	inline void setVec2ArrayValue(GLint location, GLsizei count, const GLfloat* values) const
+	{
+		if (m_pipelineID == 0)
+		{
+			glUniform2fv(location, count, values);
+			return;
+		}
+		setStageValues(location, [count, values](GLuint program, GLint stageLocation)
+			{ glProgramUniform2fv(program, stageLocation, count, values); });
+	}
+
+	// ------------------------------------------------------------------------
+	inline void setVec3Value(GLint location, const glm::vec3 &value) const
+	{
+		if (m_pipelineID == 0)
+		{
+			glUniform3fv(location, 1, &value[0]);
+			return;
+		}
+		setStageValues(location, [&value](GLuint program, GLint stageLocation)
+			{ glProgramUniform3fv(program, stageLocation, 1, &value[0]); });
+	}
+
+	// ------------------------------------------------------------------------
+	inline void setVec4Value(GLint location, const glm::vec4 &value) const
+	{
+		if (m_pipelineID == 0)
+		{
+			glUniform4fv(location, 1, &value[0]);
+			return;
+		}
+		setStageValues(location, [&value](GLuint program, GLint stageLocation)
+			{ glProgramUniform4fv(program, stageLocation, 1, &value[0]); });
+	}
+
+	// ------------------------------------------------------------------------
+	inline void setMat2Value(GLint location, const glm::mat2 &mat) const
+	{
+		if (m_pipelineID == 0)
+		{
+			glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
+			return;
+		}
+		setStageValues(location, [&mat](GLuint program, GLint stageLocation)
+			{ glProgramUniformMatrix2fv(program, stageLocation, 1, GL_FALSE, &mat[0][0]); });
+	}
+
+	// ------------------------------------------------------------------------
+	inline void setMat3Value(GLint location, const glm::mat3 &mat) const
+	{
+		if (m_pipelineID == 0)
+		{
+			glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+			return;
+		}
+		setStageValues(location, [&mat](GLuint program, GLint stageLocation)
+			{ glProgramUniformMatrix3fv(program, stageLocation, 1, GL_FALSE, &mat[0][0]); });
+	}
+
+	// ------------------------------------------------------------------------
+	inline void setMat4Value(GLint location, const glm::mat4 &mat) const
+	{
+		if (m_pipelineID == 0)
+		{
+			glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat));
+			return;
+		}
+		setStageValues(location, [&mat](GLuint program, GLint stageLocation)
+			{ glProgramUniformMatrix4fv(program, stageLocation, 1, GL_FALSE, glm::value_ptr(mat)); });
+	}
+
+private:
+	// call setValue with every program of the pipeline that
+	// has the uniform and its location in that program
+	template <typename SET_VALUE>
+	inline void setStageValues(GLint location, SET_VALUE setValue) const
+	{
+		if (location < 0)
+		{
+			return;
+		}
+		for (int stage = 0; stage < 2; stage++)
+		{
+			GLint stageLocation = ((location >> (stage * 16)) & 0xFFFF) - 1;
+			if (stageLocation >= 0)
+			{
+				setValue(m_stagePrograms[stage], stageLocation);
+			}
+		}
+	}
+
+	// link a compiled vertex and fragment shader, into one
+	// program or into a pipeline of separable programs, and
+	// delete the shaders - returns 0 on failure
+	GLuint LinkShaders(
+		GLuint vertex_shader_id,
+		GLuint fragment_shader_id,
+		const char* vertex_name,
+		const char* fragment_name,
+		bool bSpirv);
+	// link compiled shaders into a program, separable when it
+	// is one stage of a pipeline - returns 0 on failure
+	static GLuint LinkProgram(
+		const GLuint* shader_ids,
+		int shader_count,
+		bool bSeparable,
+		const char* step,
+		const char* name,
+		bool bSpirv);
+	// create one shader stage from a SPIR-V file and specialize
+	// it, returns 0 when it cannot be loaded
+	static GLuint LoadSpirvShader(
+		GLenum shader_type,
+		const char* spirv_file_path,
+		const std::vector<SHADER_SPECIALIZATION>& specializations);
+	// check that every uniform of a linked SPIR-V program can
+	// be found by name and has locations of its own
+	static bool CheckSpirvUniforms(GLuint program_id);
 };
\ No newline at end of file
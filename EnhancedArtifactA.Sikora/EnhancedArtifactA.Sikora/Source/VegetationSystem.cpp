@@ -0,0 +1,757 @@
+///////////////////////////////////////////////////////////////////////////////
+// vegetationsystem.cpp
+// ============
+// scatter many instances of composite plants over the ground and draw
+// them instanced, with impostor billboards baked at load time for the
+// instances far from the camera
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#include "VegetationSystem.h"
+#include "GLDebug.h"
+#include "GLResources.h"
+#include "GpuMemory.h"
+
+#include "stb_image.h"
+
+#include <glm/gtc/random.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// empty texels kept around every image in the atlas, so
+	// that the coarser mipmaps do not mix in the neighbours
+	const int g_ImpostorCellMargin = 4;
+	// candidate positions tried per requested instance before
+	// a sparse density map gives up
+	const int g_ScatterAttemptsPerInstance = 16;
+
+	// debug labels of the buffers, in the order of
+	// VEGETATION_BUFFER
+	const char* const g_BufferLabels[] =
+	{
+		"vegetation vertices", "vegetation indices", "vegetation instances", "impostor quad", "impostor instances"
+	};
+
+	// the model matrix of a plant takes four attribute
+	// locations, one per column, and the fade follows it
+	const VERTEX_ATTRIBUTE g_InstanceAttributes[] =
+	{
+		{ 3, 4, 0 },
+		{ 4, 4, sizeof(glm::vec4) },
+		{ 5, 4, sizeof(glm::vec4) * 2 },
+		{ 6, 4, sizeof(glm::vec4) * 3 },
+		{ 7, 1, sizeof(glm::mat4) }
+	};
+	const int g_InstanceAttributeCount = (int)(sizeof(g_InstanceAttributes) / sizeof(g_InstanceAttributes[0]));
+
+	// the corner of the billboard, and the position, size and
+	// atlas rectangle of each impostor
+	const VERTEX_ATTRIBUTE g_QuadAttributes[] = { { 0, 2, 0 } };
+	const VERTEX_ATTRIBUTE g_ImpostorAttributes[] =
+	{
+		{ 1, 4, 0 },
+		{ 2, 4, sizeof(glm::vec4) },
+		{ 3, 4, sizeof(glm::vec4) * 2 }
+	};
+}
+
+/***********************************************************
+ *  VegetationSystem()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+VegetationSystem::VegetationSystem(const ShapeMeshes* pMeshes, const ShaderManager& impostorShader)
+	: m_meshSources(pMeshes), m_impostorShader(impostorShader)
+{
+	m_instanceCount = 0;
+	m_impostorViewLocation = m_impostorShader.getUniformLocation("view");
+	m_impostorProjectionLocation = m_impostorShader.getUniformLocation("projection");
+	m_impostorAtlasLocation = m_impostorShader.getUniformLocation("impostorAtlas");
+	m_geometryVao = 0;
+	m_impostorVao = 0;
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		m_buffers[i] = 0;
+	}
+	m_atlasTexture = 0;
+	m_bakeFramebuffer = 0;
+	m_bakeDepthBuffer = 0;
+	m_atlasWidth = 0;
+	m_atlasHeight = 0;
+	m_impostorCount = 0;
+	m_bUploaded = false;
+}
+
+/***********************************************************
+ *  ~VegetationSystem()
+ *
+ *  The destructor for the class.  Clear() must have been
+ *  called while the OpenGL context was still current.
+ ***********************************************************/
+VegetationSystem::~VegetationSystem()
+{
+}
+
+/***********************************************************
+ *  LoadDensityMap()
+ *
+ *  This method is used for reading a density map from an
+ *  image file.  The first channel of every pixel is the
+ *  chance of an instance, and the top row of the image is
+ *  the lowest z of the area, as seen from above with the
+ *  camera at the bottom.
+ ***********************************************************/
+bool VegetationSystem::LoadDensityMap(const char* filename, DENSITY_MAP& densityMap)
+{
+	int width = 0;
+	int height = 0;
+	int colorChannels = 0;
+
+	// the rows are wanted from the top of the image down,
+	// while the textures are loaded flipped
+	stbi_set_flip_vertically_on_load(false);
+	unsigned char* image = stbi_load(filename, &width, &height, &colorChannels, 1);
+	stbi_set_flip_vertically_on_load(true);
+
+	if (image == nullptr)
+	{
+		std::cout << "ERROR: Could not load density map:" << filename << std::endl;
+		return false;
+	}
+
+	densityMap.width = width;
+	densityMap.height = height;
+	densityMap.values.resize((size_t)width * height);
+	for (size_t i = 0; i < densityMap.values.size(); i++)
+	{
+		densityMap.values[i] = image[i] / 255.0f;
+	}
+
+	stbi_image_free(image);
+
+	return true;
+}
+
+/***********************************************************
+ *  AddSpecies()
+ *
+ *  This method is used for adding a species without any
+ *  parts or instances.
+ ***********************************************************/
+int VegetationSystem::AddSpecies(float fadeStart, float fadeEnd, float drawDistance)
+{
+	SPECIES species;
+	species.fadeStart = fadeStart;
+	species.fadeEnd = std::max(fadeStart, fadeEnd);
+	species.drawDistance = std::max(species.fadeEnd, drawDistance);
+	species.boundsMin = glm::vec3(1.0e30f);
+	species.boundsMax = glm::vec3(-1.0e30f);
+	species.radius = 0.0f;
+	species.atlasRect = glm::vec4(0.0f);
+
+	m_species.push_back(species);
+
+	return((int)m_species.size() - 1);
+}
+
+/***********************************************************
+ *  AddPart()
+ *
+ *  This method is used for adding a basic mesh to a
+ *  species and growing the bounds of the plant by it.
+ ***********************************************************/
+bool VegetationSystem::AddPart(
+	int species,
+	ShapeMeshes::MESH_TYPE mesh,
+	const glm::mat4& localMatrix,
+	int textureSlot,
+	int materialIndex,
+	const glm::vec4& color,
+	const glm::vec2& UVscale)
+{
+	if ((m_bUploaded == true) || (species < 0) || (species >= (int)m_species.size()))
+	{
+		return(false);
+	}
+
+	const MESH_SOURCE* source = m_meshSources.GetMeshSource(mesh);
+	if (nullptr == source)
+	{
+		return(false);
+	}
+
+	SPECIES& target = m_species[species];
+	for (size_t i = 0; i + 2 < source->vertices.size(); i += ShapeMeshes::FLOATS_PER_MESH_VERTEX)
+	{
+		glm::vec3 position = glm::vec3(localMatrix * glm::vec4(source->vertices[i], source->vertices[i + 1], source->vertices[i + 2], 1.0f));
+		target.boundsMin = glm::min(target.boundsMin, position);
+		target.boundsMax = glm::max(target.boundsMax, position);
+		target.radius = std::max(target.radius, glm::length(glm::vec2(position.x, position.z)));
+	}
+
+	VEGETATION_PART part;
+	part.mesh = mesh;
+	part.localMatrix = localMatrix;
+	part.textureSlot = textureSlot;
+	part.materialIndex = materialIndex;
+	part.color = color;
+	part.UVscale = UVscale;
+	part.firstIndex = 0;
+	part.indexCount = 0;
+	part.baseVertex = 0;
+
+	target.parts.push_back(part);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Scatter()
+ *
+ *  This method is used for placing instances of a species
+ *  at random points of an area, each turned around its
+ *  vertical axis and scaled at random.  The random numbers
+ *  are seeded, so the same scene grows the same plants.
+ *  A density map rejects candidate points with one minus
+ *  its value, so fewer than the requested number may be
+ *  placed where it is sparse.  On a terrain every instance
+ *  stands at the height of the ground under its base.
+ ***********************************************************/
+int VegetationSystem::Scatter(
+	int species,
+	int count,
+	uint32_t seed,
+	const glm::vec2& areaMin,
+	const glm::vec2& areaMax,
+	float scaleMin,
+	float scaleMax,
+	const DENSITY_MAP* pDensityMap,
+	const TerrainSystem* pTerrain)
+{
+	if ((species < 0) || (species >= (int)m_species.size()) || m_species[species].parts.empty())
+	{
+		return(0);
+	}
+
+	SPECIES& target = m_species[species];
+	glm::vec3 boundsCenter = (target.boundsMin + target.boundsMax) * 0.5f;
+	float halfHeight = (target.boundsMax.y - target.boundsMin.y) * 0.5f;
+	float boundingRadius = std::sqrt(target.radius * target.radius + halfHeight * halfHeight);
+
+	std::srand(seed);
+
+	int placed = 0;
+	int attempts = count * g_ScatterAttemptsPerInstance;
+	for (int attempt = 0; (attempt < attempts) && (placed < count); attempt++)
+	{
+		glm::vec2 point = glm::linearRand(areaMin, areaMax);
+		float yawDegrees = glm::linearRand(0.0f, 360.0f);
+		float scale = glm::linearRand(std::min(scaleMin, scaleMax), std::max(scaleMin, scaleMax));
+		float chance = glm::linearRand(0.0f, 1.0f);
+
+		if ((nullptr != pDensityMap) && (pDensityMap->width > 0) && (pDensityMap->height > 0))
+		{
+			glm::vec2 extent = glm::max(areaMax - areaMin, glm::vec2(1.0e-6f));
+			glm::vec2 uv = (point - areaMin) / extent;
+			int x = std::min(pDensityMap->width - 1, (int)(uv.x * pDensityMap->width));
+			int y = std::min(pDensityMap->height - 1, (int)(uv.y * pDensityMap->height));
+			if (chance >= pDensityMap->values[(size_t)y * pDensityMap->width + x])
+			{
+				continue;
+			}
+		}
+
+		float groundHeight = (nullptr != pTerrain) ? pTerrain->GetHeight(point.x, point.y) : 0.0f;
+
+		glm::mat4 modelMatrix =
+			glm::translate(glm::vec3(point.x, groundHeight, point.y)) *
+			glm::rotate(glm::radians(yawDegrees), glm::vec3(0.0f, 1.0f, 0.0f)) *
+			glm::scale(glm::vec3(scale));
+
+		target.models.push_back(modelMatrix);
+		target.spheres.push_back(glm::vec4(glm::vec3(modelMatrix * glm::vec4(0.0f, boundsCenter.y, 0.0f, 1.0f)), boundingRadius * scale));
+		target.scales.push_back(scale);
+		placed++;
+	}
+
+	m_instanceCount += placed;
+
+	return(placed);
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used for building the shared mesh buffers
+ *  of the parts, the instance buffers, which are sized for
+ *  every instance, and the billboard quad.
+ ***********************************************************/
+bool VegetationSystem::Upload()
+{
+	if ((m_bUploaded == true) || (m_species.empty()))
+	{
+		return(false);
+	}
+
+	// pack every mesh used by a part into the shared buffers
+	std::vector<GLfloat> vertices;
+	std::vector<GLuint> indices;
+	GLuint firstIndex[ShapeMeshes::MESH_TYPE_COUNT];
+	GLint baseVertex[ShapeMeshes::MESH_TYPE_COUNT];
+	for (int mesh = 0; mesh < ShapeMeshes::MESH_TYPE_COUNT; mesh++)
+	{
+		firstIndex[mesh] = 0;
+		baseVertex[mesh] = 0;
+		const MESH_SOURCE* source = m_meshSources.FindMeshSource((ShapeMeshes::MESH_TYPE)mesh);
+		if (nullptr == source)
+		{
+			continue;
+		}
+
+		firstIndex[mesh] = (GLuint)indices.size();
+		baseVertex[mesh] = (GLint)(vertices.size() / ShapeMeshes::FLOATS_PER_MESH_VERTEX);
+		vertices.insert(vertices.end(), source->vertices.begin(), source->vertices.end());
+		indices.insert(indices.end(), source->indices.begin(), source->indices.end());
+	}
+
+	for (SPECIES& species : m_species)
+	{
+		for (VEGETATION_PART& part : species.parts)
+		{
+			part.firstIndex = firstIndex[part.mesh];
+			part.indexCount = (GLsizei)m_meshSources.FindMeshSource(part.mesh)->indices.size();
+			part.baseVertex = baseVertex[part.mesh];
+		}
+	}
+
+	size_t instanceCapacity = (size_t)std::max(1, m_instanceCount);
+
+	// corners of a billboard one unit wide and high, with its
+	// base in the middle of the bottom edge
+	const GLfloat quad[] =
+	{
+		-0.5f, 0.0f,
+		 0.5f, 0.0f,
+		-0.5f, 1.0f,
+		 0.5f, 1.0f
+	};
+
+	// storage and contents of the buffers, in the order of
+	// VEGETATION_BUFFER - the instances are written every
+	// frame by UploadInstances()
+	const uint64_t bufferBytes[BUFFER_COUNT] =
+	{
+		sizeof(GLfloat) * vertices.size(), sizeof(GLuint) * indices.size(), sizeof(VEGETATION_INSTANCE) * instanceCapacity,
+		sizeof(quad), sizeof(VEGETATION_IMPOSTOR) * instanceCapacity
+	};
+	const void* bufferData[BUFFER_COUNT] =
+	{
+		vertices.data(), indices.data(), nullptr, quad, nullptr
+	};
+	const BUFFER_USAGE bufferUsages[BUFFER_COUNT] =
+	{
+		BUFFER_STATIC, BUFFER_STATIC, BUFFER_DYNAMIC, BUFFER_STATIC, BUFFER_DYNAMIC
+	};
+	for (int i = 0; i < BUFFER_COUNT; i++)
+	{
+		m_buffers[i] = GLResources::CreateBuffer((GLsizeiptr)bufferBytes[i], bufferData[i], bufferUsages[i], g_BufferLabels[i]);
+		GpuMemory::TrackObject(GL_BUFFER, m_buffers[i], GPU_MEMORY_BUFFERS, "vegetation", bufferBytes[i]);
+	}
+
+	// same memory layout as the basic shape meshes - the model
+	// matrix and the fade advance once per instance, and are
+	// pointed at the instances of a species before its parts
+	// are drawn
+	m_geometryVao = GLResources::CreateVertexArray(m_buffers[BUFFER_INDICES], "vegetation");
+	GLResources::SetVertexBuffer(
+		m_geometryVao, 0, m_buffers[BUFFER_VERTICES], 0, sizeof(GLfloat) * ShapeMeshes::FLOATS_PER_MESH_VERTEX, 0,
+		ShapeMeshes::MESH_ATTRIBUTES, ShapeMeshes::MESH_ATTRIBUTE_COUNT);
+	GLResources::SetVertexBuffer(
+		m_geometryVao, 1, m_buffers[BUFFER_INSTANCES], 0, sizeof(VEGETATION_INSTANCE), 1,
+		g_InstanceAttributes, g_InstanceAttributeCount);
+
+	m_impostorVao = GLResources::CreateVertexArray(0, "vegetation impostors");
+	GLResources::SetVertexBuffer(m_impostorVao, 0, m_buffers[BUFFER_QUAD], 0, sizeof(GLfloat) * 2, 0, g_QuadAttributes, 1);
+	GLResources::SetVertexBuffer(
+		m_impostorVao, 1, m_buffers[BUFFER_IMPOSTORS], 0, sizeof(VEGETATION_IMPOSTOR), 1,
+		g_ImpostorAttributes, (int)(sizeof(g_ImpostorAttributes) / sizeof(g_ImpostorAttributes[0])));
+
+	m_bUploaded = true;
+
+	// the CPU copies are not needed any more
+	m_meshSources.ReleaseGeometry();
+
+	return(true);
+}
+
+/***********************************************************
+ *  BeginImpostorBake()
+ *
+ *  This method is used for creating the impostor atlas,
+ *  with one cell per species, and making it the target of
+ *  the following draws.
+ ***********************************************************/
+bool VegetationSystem::BeginImpostorBake()
+{
+	if (m_species.empty())
+	{
+		return(false);
+	}
+
+	int columns = std::min((int)m_species.size(), IMPOSTOR_ATLAS_COLUMNS);
+	int rows = ((int)m_species.size() + IMPOSTOR_ATLAS_COLUMNS - 1) / IMPOSTOR_ATLAS_COLUMNS;
+	m_atlasWidth = columns * IMPOSTOR_CELL_SIZE;
+	m_atlasHeight = rows * IMPOSTOR_CELL_SIZE;
+
+	// every mipmap level is allocated now and filled when the
+	// bake ends
+	m_atlasTexture = GLResources::CreateTexture2D(
+		m_atlasWidth, m_atlasHeight, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, nullptr,
+		GL_CLAMP_TO_EDGE, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, true, TEXTURE_IMMUTABLE, "impostor atlas");
+
+	glGenRenderbuffers(1, &m_bakeDepthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_bakeDepthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, m_atlasWidth, m_atlasHeight);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_bakeFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_bakeFramebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_atlasTexture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_bakeDepthBuffer);
+
+	GLDebug::LabelObject(GL_RENDERBUFFER, m_bakeDepthBuffer, "impostor bake depth");
+	GLDebug::LabelObject(GL_FRAMEBUFFER, m_bakeFramebuffer, "impostor bake");
+	// the atlas gets its mipmaps when the bake ends
+	GpuMemory::TrackObject(GL_TEXTURE, m_atlasTexture, GPU_MEMORY_TEXTURES, "vegetation",
+		GpuMemory::GetTextureBytes(m_atlasWidth, m_atlasHeight, GL_RGBA8, GLResources::GetMipLevelCount(m_atlasWidth, m_atlasHeight)));
+	GpuMemory::TrackObject(GL_RENDERBUFFER, m_bakeDepthBuffer, GPU_MEMORY_RENDER_TARGETS, "vegetation",
+		GpuMemory::GetTextureBytes(m_atlasWidth, m_atlasHeight, GL_DEPTH_COMPONENT24, 1));
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "ERROR: The impostor atlas framebuffer is not complete" << std::endl;
+		GpuMemory::ReleaseObject(GL_TEXTURE, m_atlasTexture);
+		glDeleteTextures(1, &m_atlasTexture);
+		m_atlasTexture = 0;
+		EndImpostorBake();
+		return(false);
+	}
+
+	// the space around the plants stays transparent
+	glViewport(0, 0, m_atlasWidth, m_atlasHeight);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glEnable(GL_DEPTH_TEST);
+
+	return(true);
+}
+
+/***********************************************************
+ *  BeginImpostor()
+ *
+ *  This method is used for pointing the viewport at the
+ *  cell of a species and returning the camera that frames
+ *  the plant from the side.  The projection is stretched
+ *  to the square cell, and the billboard stretches it back.
+ ***********************************************************/
+void VegetationSystem::BeginImpostor(int species, glm::mat4& view, glm::mat4& projection)
+{
+	SPECIES& target = m_species[species];
+
+	int cellX = (species % IMPOSTOR_ATLAS_COLUMNS) * IMPOSTOR_CELL_SIZE + g_ImpostorCellMargin;
+	int cellY = (species / IMPOSTOR_ATLAS_COLUMNS) * IMPOSTOR_CELL_SIZE + g_ImpostorCellMargin;
+	int cellSize = IMPOSTOR_CELL_SIZE - g_ImpostorCellMargin * 2;
+	glViewport(cellX, cellY, cellSize, cellSize);
+
+	target.atlasRect = glm::vec4(
+		(float)cellX / m_atlasWidth,
+		(float)cellY / m_atlasHeight,
+		(float)(cellX + cellSize) / m_atlasWidth,
+		(float)(cellY + cellSize) / m_atlasHeight);
+
+	float centerY = (target.boundsMin.y + target.boundsMax.y) * 0.5f;
+	float halfHeight = std::max((target.boundsMax.y - target.boundsMin.y) * 0.5f, 1.0e-3f);
+	float radius = std::max(target.radius, 1.0e-3f);
+	float depth = std::max(radius, halfHeight);
+
+	// looking down the z axis, so the right of the image is
+	// +x, which is where the billboard puts it
+	view = glm::lookAt(
+		glm::vec3(0.0f, centerY, depth + 1.0f),
+		glm::vec3(0.0f, centerY, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f));
+	projection = glm::ortho(-radius, radius, -halfHeight, halfHeight, 0.5f, depth * 2.0f + 1.5f);
+}
+
+/***********************************************************
+ *  EndImpostorBake()
+ *
+ *  This method is used for restoring the window as the
+ *  draw target and building the mipmaps of the atlas.
+ ***********************************************************/
+void VegetationSystem::EndImpostorBake()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (m_bakeFramebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_bakeFramebuffer);
+		m_bakeFramebuffer = 0;
+	}
+	if (m_bakeDepthBuffer != 0)
+	{
+		GpuMemory::ReleaseObject(GL_RENDERBUFFER, m_bakeDepthBuffer);
+		glDeleteRenderbuffers(1, &m_bakeDepthBuffer);
+		m_bakeDepthBuffer = 0;
+	}
+
+	if (m_atlasTexture != 0)
+	{
+		glBindTexture(GL_TEXTURE_2D, m_atlasTexture);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+}
+
+/***********************************************************
+ *  BuildInstances()
+ *
+ *  This method is used for sorting every instance inside
+ *  the view frustum and the draw distance of its species
+ *  into the geometry list, the impostor list, or both when
+ *  it is inside the fade band.  The geometry instances are
+ *  kept together by species, with one range per species.
+ ***********************************************************/
+void VegetationSystem::BuildInstances(
+	const glm::mat4& viewProjection,
+	const glm::vec3& viewPosition,
+	ArenaArray<VEGETATION_INSTANCE>& instances,
+	ArenaArray<VEGETATION_IMPOSTOR>& impostors,
+	ArenaArray<VEGETATION_RANGE>& ranges) const
+{
+	// normalized so that sphere radii can be compared
+	glm::vec4 planes[6];
+	ExtractFrustumPlanes(viewProjection, true, planes);
+
+	size_t instanceCount = 0;
+	size_t impostorCount = 0;
+
+	for (size_t s = 0; s < m_species.size(); s++)
+	{
+		const SPECIES& species = m_species[s];
+		float fadeWidth = species.fadeEnd - species.fadeStart;
+
+		ranges[s].firstInstance = (uint32_t)instanceCount;
+
+		for (size_t i = 0; i < species.models.size(); i++)
+		{
+			const glm::vec4& sphere = species.spheres[i];
+			glm::vec3 center(sphere);
+
+			bool bInside = true;
+			for (int plane = 0; (plane < 6) && bInside; plane++)
+			{
+				bInside = (glm::dot(glm::vec3(planes[plane]), center) + planes[plane].w >= -sphere.w);
+			}
+			if (bInside == false)
+			{
+				continue;
+			}
+
+			float distanceToCamera = glm::length(center - viewPosition);
+			if (distanceToCamera > species.drawDistance)
+			{
+				continue;
+			}
+
+			// how far the instance is through the fade band
+			float fade = 1.0f;
+			if (distanceToCamera < species.fadeEnd)
+			{
+				fade = (fadeWidth > 0.0f) ? std::max(0.0f, (distanceToCamera - species.fadeStart) / fadeWidth) : 0.0f;
+			}
+
+			if (fade < 1.0f)
+			{
+				VEGETATION_INSTANCE& instance = instances[instanceCount++];
+				instance.modelMatrix = species.models[i];
+				instance.fade = fade;
+				instance.padding[0] = instance.padding[1] = instance.padding[2] = 0.0f;
+			}
+			if (fade > 0.0f)
+			{
+				const glm::mat4& model = species.models[i];
+				float scale = species.scales[i];
+
+				VEGETATION_IMPOSTOR& impostor = impostors[impostorCount++];
+				impostor.positionFade = glm::vec4(glm::vec3(model[3]), fade);
+				impostor.size = glm::vec4(
+					species.radius * 2.0f * scale,
+					(species.boundsMax.y - species.boundsMin.y) * scale,
+					species.boundsMin.y * scale,
+					0.0f);
+				impostor.atlasRect = species.atlasRect;
+			}
+		}
+
+		ranges[s].instanceCount = (uint32_t)instanceCount - ranges[s].firstInstance;
+	}
+
+	// only shrinks, so nothing is taken from the arena
+	instances.resize(instanceCount);
+	impostors.resize(impostorCount);
+}
+
+/***********************************************************
+ *  UploadInstances()
+ *
+ *  This method is used for copying the instance lists of
+ *  the frame being drawn into the instance buffers.
+ ***********************************************************/
+void VegetationSystem::UploadInstances(
+	const ArenaArray<VEGETATION_INSTANCE>& instances,
+	const ArenaArray<VEGETATION_IMPOSTOR>& impostors)
+{
+	m_impostorCount = 0;
+	if (m_bUploaded == false)
+	{
+		return;
+	}
+
+	size_t instanceCapacity = (size_t)std::max(1, m_instanceCount);
+
+	if (!instances.empty())
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, m_buffers[BUFFER_INSTANCES]);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(VEGETATION_INSTANCE) * std::min(instances.size(), instanceCapacity), instances.begin());
+		GpuMemory::CountUpload(sizeof(VEGETATION_INSTANCE) * std::min(instances.size(), instanceCapacity));
+	}
+	if (!impostors.empty())
+	{
+		m_impostorCount = (GLsizei)std::min(impostors.size(), instanceCapacity);
+		glBindBuffer(GL_ARRAY_BUFFER, m_buffers[BUFFER_IMPOSTORS]);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(VEGETATION_IMPOSTOR) * m_impostorCount, impostors.begin());
+		GpuMemory::CountUpload(sizeof(VEGETATION_IMPOSTOR) * m_impostorCount);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  BindInstances()
+ *
+ *  This method is used for pointing the per-instance
+ *  attributes at the passed in geometry instance.  The
+ *  attributes are moved instead of using a base instance,
+ *  which keeps the draws working on 3.3 contexts.
+ ***********************************************************/
+void VegetationSystem::BindInstances(uint32_t firstInstance) const
+{
+	if (m_bUploaded == false)
+	{
+		return;
+	}
+
+	GLResources::SetVertexBuffer(
+		m_geometryVao, 1, m_buffers[BUFFER_INSTANCES], (GLintptr)(sizeof(VEGETATION_INSTANCE) * firstInstance),
+		sizeof(VEGETATION_INSTANCE), 1, g_InstanceAttributes, g_InstanceAttributeCount);
+}
+
+/***********************************************************
+ *  DrawPart()
+ *
+ *  This method is used for drawing one part of a species
+ *  for the bound instances with a single instanced draw.
+ ***********************************************************/
+void VegetationSystem::DrawPart(int species, int part, GLsizei instanceCount) const
+{
+	if ((m_bUploaded == false) || (instanceCount <= 0))
+	{
+		return;
+	}
+
+	const VEGETATION_PART& drawnPart = m_species[species].parts[part];
+
+	glBindVertexArray(m_geometryVao);
+	glDrawElementsInstancedBaseVertex(
+		GL_TRIANGLES,
+		drawnPart.indexCount,
+		GL_UNSIGNED_INT,
+		(const void*)(uintptr_t)(sizeof(GLuint) * drawnPart.firstIndex),
+		instanceCount,
+		drawnPart.baseVertex);
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  DrawImpostors()
+ *
+ *  This method is used for drawing every uploaded impostor
+ *  with one instanced draw of the billboard quad, sampling
+ *  the atlas from the passed in texture unit.
+ ***********************************************************/
+void VegetationSystem::DrawImpostors(const glm::mat4& view, const glm::mat4& projection, GLint textureUnit) const
+{
+	if ((m_bUploaded == false) || (m_impostorCount == 0) || (m_atlasTexture == 0) || !m_impostorShader.isLoaded())
+	{
+		return;
+	}
+
+	m_impostorShader.use();
+	m_impostorShader.setMat4Value(m_impostorViewLocation, view);
+	m_impostorShader.setMat4Value(m_impostorProjectionLocation, projection);
+	m_impostorShader.setIntValue(m_impostorAtlasLocation, textureUnit);
+
+	glActiveTexture(GL_TEXTURE0 + textureUnit);
+	glBindTexture(GL_TEXTURE_2D, m_atlasTexture);
+
+	glBindVertexArray(m_impostorVao);
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, m_impostorCount);
+	glBindVertexArray(0);
+
+	glActiveTexture(GL_TEXTURE0);
+	ShaderManager::useNone();
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing every species and
+ *  freeing the buffers, the atlas and the impostor shaders.
+ ***********************************************************/
+void VegetationSystem::Clear()
+{
+	if (m_geometryVao != 0)
+	{
+		GpuMemory::ReleaseObjects(GL_BUFFER, m_buffers, BUFFER_COUNT);
+		glDeleteBuffers(BUFFER_COUNT, m_buffers);
+		glDeleteVertexArrays(1, &m_geometryVao);
+		glDeleteVertexArrays(1, &m_impostorVao);
+		m_geometryVao = 0;
+		m_impostorVao = 0;
+		for (int i = 0; i < BUFFER_COUNT; i++)
+		{
+			m_buffers[i] = 0;
+		}
+	}
+	if (m_atlasTexture != 0)
+	{
+		GpuMemory::ReleaseObject(GL_TEXTURE, m_atlasTexture);
+		glDeleteTextures(1, &m_atlasTexture);
+		m_atlasTexture = 0;
+	}
+	m_impostorShader.Release();
+
+	m_species.clear();
+	m_instanceCount = 0;
+	m_impostorCount = 0;
+	m_bUploaded = false;
+}
@@ -0,0 +1,269 @@
+///////////////////////////////////////////////////////////////////////////////
+// vegetationsystem.h
+// ============
+// scatter many instances of composite plants over the ground and draw
+// them instanced, with impostor billboards baked at load time for the
+// instances far from the camera
+//
+//  AUTHOR: Agnieszka Sikora
+//	Created for CS-499 Computer Science Capstone enhancements
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShapeMeshes.h"
+#include "SceneUtilities.h"
+#include "FrameArena.h"
+#include "TerrainSystem.h"
+#include "ShaderManager.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  VEGETATION_INSTANCE
+ *
+ *  One plant drawn with its full geometry this frame, laid
+ *  out as its per-instance vertex attributes.  The fade is
+ *  the part of the plant that is dithered away while it
+ *  crosses over to its impostor.
+ ***********************************************************/
+struct VEGETATION_INSTANCE
+{
+	glm::mat4 modelMatrix;
+	float fade;
+	float padding[3];
+};
+
+/***********************************************************
+ *  VEGETATION_IMPOSTOR
+ *
+ *  One plant drawn as a billboard this frame, laid out as
+ *  its per-instance vertex attributes.  The fade is the
+ *  part of the billboard that is drawn, so that it fills
+ *  in exactly where the geometry is dithered away.
+ ***********************************************************/
+struct VEGETATION_IMPOSTOR
+{
+	// base of the plant and the drawn part of the billboard
+	glm::vec4 positionFade;
+	// width, height and the height of the bottom edge above
+	// the base
+	glm::vec4 size;
+	// corners of the baked image in the atlas - u0 v0 u1 v1
+	glm::vec4 atlasRect;
+};
+
+/***********************************************************
+ *  VEGETATION_RANGE
+ *
+ *  The geometry instances of one species in the instance
+ *  list of a frame.
+ ***********************************************************/
+struct VEGETATION_RANGE
+{
+	uint32_t firstInstance;
+	uint32_t instanceCount;
+};
+
+/***********************************************************
+ *  VEGETATION_PART
+ *
+ *  One basic mesh of a species, placed in the space of the
+ *  plant, with the shader state it is drawn with.
+ ***********************************************************/
+struct VEGETATION_PART
+{
+	ShapeMeshes::MESH_TYPE mesh;
+	glm::mat4 localMatrix;
+	int textureSlot;		// -1 when the color is used
+	int materialIndex;		// -1 when no material is set
+	glm::vec4 color;
+	glm::vec2 UVscale;
+
+	// range of the part mesh in the shared buffers
+	GLuint firstIndex;
+	GLsizei indexCount;
+	GLint baseVertex;
+};
+
+/***********************************************************
+ *  VegetationSystem
+ *
+ *  A species is a composite of basic meshes, like a trunk
+ *  and a crown.  Scatter() places many instances of one
+ *  over a rectangle of ground, with a seeded random layout
+ *  that an optional density map thins out, standing on the
+ *  terrain when the scene has one.
+ *
+ *  Every frame BuildInstances() sorts the instances by
+ *  their distance to the camera.  Near instances are drawn
+ *  with their full geometry, one instanced draw per part
+ *  of a species.  Far instances are drawn as billboards
+ *  that turn around their vertical axis to face the
+ *  camera, all with a single instanced draw, showing an
+ *  image of the species baked into an atlas at load time.
+ *  Over the fade band of a species both are drawn, and a
+ *  screen door dither hands one over to the other, so the
+ *  switch does not pop.  The CPU cost of the draws depends
+ *  on the number of species and parts, not of instances.
+ *
+ *  BuildInstances() only reads the instances, so it can run
+ *  on the main thread.  All other methods after the scatter
+ *  must run on the thread that owns the OpenGL context.
+ ***********************************************************/
+class VegetationSystem
+{
+public:
+	// greyscale image that is spread over a scatter area
+	struct DENSITY_MAP
+	{
+		int width;
+		int height;
+		// chance of an instance, 0 to 1, row by row from
+		// the lowest z of the area
+		std::vector<float> values;
+	};
+
+	// constructor - takes ownership of the impostor shaders
+	VegetationSystem(const ShapeMeshes* pMeshes, const ShaderManager& impostorShader);
+	// destructor
+	~VegetationSystem();
+
+	// load a density map from an image file
+	static bool LoadDensityMap(const char* filename, DENSITY_MAP& densityMap);
+
+	// add a species, returns its index
+	int AddSpecies(float fadeStart, float fadeEnd, float drawDistance);
+	// add a part to a species, returns false when the mesh is
+	// not loaded - must be called before Upload()
+	bool AddPart(
+		int species,
+		ShapeMeshes::MESH_TYPE mesh,
+		const glm::mat4& localMatrix,
+		int textureSlot,
+		int materialIndex,
+		const glm::vec4& color,
+		const glm::vec2& UVscale);
+	// place instances of a species over the area between the
+	// passed in x z corners, on the terrain when there is one,
+	// returns the number placed
+	int Scatter(
+		int species,
+		int count,
+		uint32_t seed,
+		const glm::vec2& areaMin,
+		const glm::vec2& areaMax,
+		float scaleMin,
+		float scaleMax,
+		const DENSITY_MAP* pDensityMap,
+		const TerrainSystem* pTerrain);
+
+	// build the shared buffers from the added parts
+	bool Upload();
+
+	// bake the impostor atlas - for every species the caller
+	// draws the parts with the view and projection that
+	// BeginImpostor() returns, between it and EndImpostor()
+	bool BeginImpostorBake();
+	void BeginImpostor(int species, glm::mat4& view, glm::mat4& projection);
+	void EndImpostorBake();
+
+	// free the buffers, the atlas and the impostor shaders
+	void Clear();
+
+	int GetSpeciesCount() const { return (int)m_species.size(); }
+	int GetPartCount(int species) const { return (int)m_species[species].parts.size(); }
+	const VEGETATION_PART& GetPart(int species, int part) const { return m_species[species].parts[part]; }
+	// total number of instances of every species
+	int GetInstanceCount() const { return m_instanceCount; }
+	// instances of one species, as world space bounding spheres
+	int GetSpeciesInstanceCount(int species) const { return (int)m_species[species].spheres.size(); }
+	const glm::vec4& GetInstanceSphere(int species, int instance) const { return m_species[species].spheres[instance]; }
+
+	// sort the instances into the geometry and impostor lists
+	// for the passed in camera - the lists must have room for
+	// GetInstanceCount() entries and the ranges for one entry
+	// per species, as this does not grow them
+	void BuildInstances(
+		const glm::mat4& viewProjection,
+		const glm::vec3& viewPosition,
+		ArenaArray<VEGETATION_INSTANCE>& instances,
+		ArenaArray<VEGETATION_IMPOSTOR>& impostors,
+		ArenaArray<VEGETATION_RANGE>& ranges) const;
+
+	// copy the lists built for a frame into the instance buffers
+	void UploadInstances(
+		const ArenaArray<VEGETATION_INSTANCE>& instances,
+		const ArenaArray<VEGETATION_IMPOSTOR>& impostors);
+	// point the per-instance attributes at the first geometry
+	// instance of a species, before its parts are drawn
+	void BindInstances(uint32_t firstInstance) const;
+	// draw one part for the bound instances
+	void DrawPart(int species, int part, GLsizei instanceCount) const;
+	// draw every uploaded impostor - leaves no program in use
+	void DrawImpostors(const glm::mat4& view, const glm::mat4& projection, GLint textureUnit) const;
+
+private:
+	struct SPECIES
+	{
+		std::vector<VEGETATION_PART> parts;
+		float fadeStart;
+		float fadeEnd;
+		float drawDistance;
+		// bounds of the plant at a scale of 1 - the radius is
+		// around the vertical axis, since instances are turned
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		float radius;
+		// baked image in the atlas
+		glm::vec4 atlasRect;
+		// instances, as model matrix and bounding sphere
+		std::vector<glm::mat4> models;
+		std::vector<glm::vec4> spheres;
+		// uniform scale of every instance
+		std::vector<float> scales;
+	};
+
+	enum VEGETATION_BUFFER
+	{
+		BUFFER_VERTICES = 0,
+		BUFFER_INDICES,
+		BUFFER_INSTANCES,
+		BUFFER_QUAD,
+		BUFFER_IMPOSTORS,
+		BUFFER_COUNT
+	};
+
+	// size of the image of one species in the atlas
+	static const int IMPOSTOR_CELL_SIZE = 256;
+	static const int IMPOSTOR_ATLAS_COLUMNS = 4;
+
+	// CPU copies of the basic meshes, fetched once per mesh type
+	MeshSourceCache m_meshSources;
+	std::vector<SPECIES> m_species;
+	int m_instanceCount;
+
+	ShaderManager m_impostorShader;
+	GLint m_impostorViewLocation;
+	GLint m_impostorProjectionLocation;
+	GLint m_impostorAtlasLocation;
+	GLuint m_geometryVao;
+	GLuint m_impostorVao;
+	GLuint m_buffers[BUFFER_COUNT];
+	GLuint m_atlasTexture;
+	GLuint m_bakeFramebuffer;
+	GLuint m_bakeDepthBuffer;
+	int m_atlasWidth;
+	int m_atlasHeight;
+	// number of impostors uploaded for the frame being drawn
+	GLsizei m_impostorCount;
+	bool m_bUploaded;
+
+	// systems own GL objects and must not be copied
+	VegetationSystem(const VegetationSystem&) = delete;
+	VegetationSystem& operator=(const VegetationSystem&) = delete;
+};
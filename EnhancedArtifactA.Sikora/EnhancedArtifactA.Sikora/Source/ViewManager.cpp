@@ -28,14 +28,25 @@ namespace
 	// the 3D scene
 	Camera* g_pCamera = nullptr;
 
+	// current size of the window framebuffer in pixels, which
+	// can differ from the window size on high-DPI displays
+	int gFramebufferWidth = WINDOW_WIDTH;
+	int gFramebufferHeight = WINDOW_HEIGHT;
+
 	// these variables are used for mouse movement processing
 	float gLastX = WINDOW_WIDTH / 2.0f;
 	float gLastY = WINDOW_HEIGHT / 2.0f;
 	bool gFirstMouse = true;
 
-	// time between current frame and last frame
-	float gDeltaTime = 0.0f; 
-	float gLastFrame = 0.0f;
+	// camera position at the start of the most recent fixed
+	// simulation step, used to interpolate the rendered view
+	// between the last two simulation states
+	glm::vec3 gPreviousCameraPosition = glm::vec3(0.0f, 0.0f, 0.0f);
+
+	// the left mouse button picks the object in the middle of
+	// the view once per press
+	bool gPickButtonDown = false;
+	bool gPickRequested = false;
 
 	// the following variable is false when orthographic projection
 	// is off and true when it is on
@@ -60,6 +71,7 @@ ViewManager::ViewManager(
 	g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
 	g_pCamera->Zoom = 80;
 	g_pCamera->MovementSpeed = 20;
+	gPreviousCameraPosition = g_pCamera->Position;
 }
 
 /***********************************************************
@@ -111,6 +123,10 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 	//this callback is used to receive mouse scroll wheel events
 	glfwSetScrollCallback(window, &ViewManager::Mouse_Scroll_Wheel_Callback);
 
+	// this callback is used to receive framebuffer resize events
+	glfwSetFramebufferSizeCallback(window, &ViewManager::Framebuffer_Size_Callback);
+	glfwGetFramebufferSize(window, &gFramebufferWidth, &gFramebufferHeight);
+
 	// enable blending for supporting tranparent rendering
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -156,14 +172,40 @@ void ViewManager::Mouse_Scroll_Wheel_Callback(GLFWwindow* window, double x, doub
 
 }
 
+/***********************************************************
+ *  Framebuffer_Size_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the framebuffer of the display window changes size.
+ ***********************************************************/
+void ViewManager::Framebuffer_Size_Callback(GLFWwindow* window, int width, int height)
+{
+	gFramebufferWidth = width;
+	gFramebufferHeight = height;
+}
+
+/***********************************************************
+ *  GetFramebufferSize()
+ *
+ *  This method is used for getting the current size of the
+ *  display window framebuffer in pixels.
+ ***********************************************************/
+void ViewManager::GetFramebufferSize(int& width, int& height) const
+{
+	width = gFramebufferWidth;
+	height = gFramebufferHeight;
+}
+
 
 /***********************************************************
  *  ProcessKeyboardEvents()
  *
  *  This method is called to process any keyboard events
- *  that may be waiting in the event queue.
+ *  that may be waiting in the event queue.  The passed in
+ *  time step is the fixed simulation step, so camera
+ *  movement no longer depends on the display frame rate.
  ***********************************************************/
-void ViewManager::ProcessKeyboardEvents()
+void ViewManager::ProcessKeyboardEvents(float timeStep)
 {
 	// close the window if the escape key has been pressed
 	if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
@@ -174,30 +216,30 @@ void ViewManager::ProcessKeyboardEvents()
 	// process camera zooming in and out
 	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(FORWARD, gDeltaTime);
+		g_pCamera->ProcessKeyboard(FORWARD, timeStep);
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_S) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(BACKWARD, gDeltaTime);
+		g_pCamera->ProcessKeyboard(BACKWARD, timeStep);
 	}
 
 	// process camera panning left and right
 	if (glfwGetKey(m_pWindow, GLFW_KEY_A) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(LEFT, gDeltaTime);
+		g_pCamera->ProcessKeyboard(LEFT, timeStep);
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(RIGHT, gDeltaTime);
+		g_pCamera->ProcessKeyboard(RIGHT, timeStep);
 	}
 	//process camera panning up and down
 	if (glfwGetKey(m_pWindow, GLFW_KEY_Q) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(UP, gDeltaTime);
+		g_pCamera->ProcessKeyboard(UP, timeStep);
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_E) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(DOWN, gDeltaTime);
+		g_pCamera->ProcessKeyboard(DOWN, timeStep);
 	}
 
 	//change between different projection views
@@ -210,6 +252,9 @@ void ViewManager::ProcessKeyboardEvents()
 		g_pCamera->Position = glm::vec3(-8.0f, 3.0f, 10.0f);
 		g_pCamera->Up = glm::vec3(0.0f,5.0f, 0.0f);
 		g_pCamera->Front = glm::vec3(0.0f, 0.0f, -0.1f);
+
+		// jump straight to the new view instead of interpolating to it
+		gPreviousCameraPosition = g_pCamera->Position;
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS)
 	{
@@ -221,7 +266,56 @@ void ViewManager::ProcessKeyboardEvents()
 		g_pCamera->Front = glm::vec3(0.0f, -0.5f, -2.0f);
 		g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
 		g_pCamera->Zoom = 80;
+
+		// jump straight to the new view instead of interpolating to it
+		gPreviousCameraPosition = g_pCamera->Position;
+	}
+
+	// pick when the left mouse button goes down
+	bool bPickButtonDown = (glfwGetMouseButton(m_pWindow, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS);
+	if (bPickButtonDown && !gPickButtonDown)
+	{
+		gPickRequested = true;
+	}
+	gPickButtonDown = bPickButtonDown;
+}
+
+/***********************************************************
+ *  ConsumePickRequest()
+ *
+ *  This method is used for taking the pick the mouse asked
+ *  for since the last call, as a ray from the camera through
+ *  the middle of the view, where the cursor is held.
+ ***********************************************************/
+bool ViewManager::ConsumePickRequest(glm::vec3& origin, glm::vec3& direction)
+{
+	if (!gPickRequested)
+	{
+		return false;
 	}
+	gPickRequested = false;
+
+	origin = g_pCamera->Position;
+	direction = glm::normalize(g_pCamera->Front);
+	return true;
+}
+
+/***********************************************************
+ *  UpdateScene()
+ *
+ *  This method is called once per fixed simulation step to
+ *  advance the input and camera state.  The camera position
+ *  from before the step is kept so that rendering can
+ *  interpolate between the last two simulation states.
+ ***********************************************************/
+void ViewManager::UpdateScene(float timeStep)
+{
+	// remember the state from before this simulation step
+	gPreviousCameraPosition = g_pCamera->Position;
+
+	// process any keyboard events that may be waiting in the 
+	// event queue
+	ProcessKeyboardEvents(timeStep);
 }
 
 /***********************************************************
@@ -229,36 +323,53 @@ void ViewManager::ProcessKeyboardEvents()
  *
  *  This method is used for preparing the 3D scene by loading
  *  the shapes, textures in memory to support the 3D scene 
- *  rendering
+ *  rendering.  The interpolation factor is the fraction of a
+ *  simulation step that has elapsed since the last update,
+ *  and is used to blend the previous and current camera
+ *  positions.  Mouse look is applied directly as the events
+ *  arrive, so the camera orientation is not interpolated.
+ *  The resulting matrices are recorded into the frame.
  ***********************************************************/
-void ViewManager::PrepareSceneView()
+void ViewManager::PrepareSceneView(float interpolationAlpha, FRAME_DATA& frame)
 {
-	glm::mat4 view;
-	glm::mat4 projection;
+	glm::vec3 cameraPosition;
 
-	// per-frame timing
-	float currentFrame = glfwGetTime();
-	gDeltaTime = currentFrame - gLastFrame;
-	gLastFrame = currentFrame;
+	// blend between the last two simulation states
+	cameraPosition = glm::mix(gPreviousCameraPosition, g_pCamera->Position, interpolationAlpha);
 
-	// process any keyboard events that may be waiting in the 
-	// event queue
-	ProcessKeyboardEvents();
+	// get the current view matrix from the interpolated camera
+	frame.view = glm::lookAt(cameraPosition, cameraPosition + g_pCamera->Front, g_pCamera->Up);
+
+	// define the current projection matrix - the aspect ratio follows the
+	// real framebuffer, which is unaffected by the resolution scale
+	GLfloat aspectRatio = (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT;
+	if ((gFramebufferWidth > 0) && (gFramebufferHeight > 0))
+	{
+		aspectRatio = (GLfloat)gFramebufferWidth / (GLfloat)gFramebufferHeight;
+	}
+	frame.projection = glm::perspective(glm::radians(g_pCamera->Zoom), aspectRatio, 0.1f, 100.0f);
 
-	// get the current view matrix from the camera
-	view = g_pCamera->GetViewMatrix();
+	frame.viewPosition = cameraPosition;
+	frame.framebufferWidth = gFramebufferWidth;
+	frame.framebufferHeight = gFramebufferHeight;
+}
 
-	// define the current projection matrix
-	projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
-	
+/***********************************************************
+ *  ApplySceneView()
+ *
+ *  This method is used for setting the camera values that
+ *  were recorded into the frame into the shader.
+ ***********************************************************/
+void ViewManager::ApplySceneView(const FRAME_DATA& frame)
+{
 	// if the shader manager object is valid
 	if (NULL != m_pShaderManager)
 	{
 		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
+		m_pShaderManager->setMat4Value(g_ViewName, frame.view);
 		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
+		m_pShaderManager->setMat4Value(g_ProjectionName, frame.projection);
 		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		m_pShaderManager->setVec3Value("viewPosition", frame.viewPosition);
 	}
-}
\ No newline at end of file
+}
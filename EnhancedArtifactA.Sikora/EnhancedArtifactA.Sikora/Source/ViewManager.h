@@ -10,6 +10,7 @@
 #pragma once
 
 #include "ShaderManager.h"
+#include "FrameQueue.h"
 #include "camera.h"
 
 // GLFW library
@@ -30,6 +31,9 @@ public:
 	//mouse scroll wheel callback for mouse interaction with the 3D scene
 	static void Mouse_Scroll_Wheel_Callback(GLFWwindow* window, double x, double yScrollDistance);
 
+	// framebuffer size callback for handling window resizing
+	static void Framebuffer_Size_Callback(GLFWwindow* window, int width, int height);
+
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
@@ -37,12 +41,27 @@ private:
 	GLFWwindow* m_pWindow;
 
 	// process keyboard events for interaction with the 3D scene
-	void ProcessKeyboardEvents();
+	void ProcessKeyboardEvents(float timeStep);
 
 public:
 	// create the initial OpenGL display window
 	GLFWwindow* CreateDisplayWindow(const char* windowTitle);
 	
+	// get the current size of the display framebuffer in pixels
+	void GetFramebufferSize(int& width, int& height) const;
+
+	// advance the input and camera state by one fixed simulation step
+	void UpdateScene(float timeStep);
+
+	// take the pick the mouse asked for, as a ray from the camera
+	// through the middle of the view - false when there is none
+	bool ConsumePickRequest(glm::vec3& origin, glm::vec3& direction);
+
 	// prepare the conversion from 3D object display to 2D scene display
-	void PrepareSceneView();
+	// by recording the camera into the frame - called on the main thread
+	void PrepareSceneView(float interpolationAlpha, FRAME_DATA& frame);
+
+	// set the recorded camera values into the shader - called on the
+	// render thread
+	void ApplySceneView(const FRAME_DATA& frame);
 };
\ No newline at end of file
@@ -0,0 +1,97 @@
+#version 430 core
+// one invocation per object - test its bounding sphere against the
+// view frustum, pick its level of detail from the camera distance
+// and append a draw command to the command range of its draw group
+layout (local_size_x = 64) in;
+
+struct CullObject
+{
+	vec4 boundingSphere;	// world space center and radius
+	uint mesh;
+	uint drawGroup;
+	float drawDistance;		// 0 when the object is never faded out
+	uint padding;
+};
+
+struct CullMesh
+{
+	uint indexCount;
+	uint firstIndex;
+	int baseVertex;
+	uint lodMesh;			// coarser mesh, or NO_LOD_MESH
+	float lodDistance;		// camera distance the coarser mesh is used from
+	uint padding0;
+	uint padding1;
+	uint padding2;
+};
+
+struct DrawCommand
+{
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer CullObjects { CullObject objects[]; };
+layout (std430, binding = 1) readonly buffer CullMeshes { CullMesh meshes[]; };
+layout (std430, binding = 2) readonly buffer GroupOffsets { uint groupFirstCommand[]; };
+layout (std430, binding = 3) buffer DrawCounts { uint drawCounts[]; };
+layout (std430, binding = 4) writeonly buffer DrawCommands { DrawCommand commands[]; };
+
+const uint NO_LOD_MESH = 0xFFFFFFFFu;
+const int MAX_LOD_STEPS = 4;
+
+uniform vec4 frustumPlanes[6];
+uniform vec3 viewPosition;
+uniform uint objectCount;
+
+void main()
+{
+	uint objectIndex = gl_GlobalInvocationID.x;
+	if (objectIndex >= objectCount)
+	{
+		return;
+	}
+
+	CullObject object = objects[objectIndex];
+	vec3 center = object.boundingSphere.xyz;
+	float radius = object.boundingSphere.w;
+
+	for (int i = 0; i < 6; i++)
+	{
+		if (dot(frustumPlanes[i].xyz, center) + frustumPlanes[i].w < -radius)
+		{
+			return;
+		}
+	}
+
+	float distanceToCamera = max(length(center - viewPosition) - radius, 0.0);
+	if ((object.drawDistance > 0.0) && (distanceToCamera > object.drawDistance))
+	{
+		return;
+	}
+
+	uint mesh = object.mesh;
+	for (int step = 0; step < MAX_LOD_STEPS; step++)
+	{
+		if ((meshes[mesh].lodMesh == NO_LOD_MESH) || (distanceToCamera < meshes[mesh].lodDistance))
+		{
+			break;
+		}
+		mesh = meshes[mesh].lodMesh;
+	}
+
+	uint slot = atomicAdd(drawCounts[object.drawGroup], 1u);
+
+	DrawCommand command;
+	command.count = meshes[mesh].indexCount;
+	command.instanceCount = 1u;
+	command.firstIndex = meshes[mesh].firstIndex;
+	command.baseVertex = meshes[mesh].baseVertex;
+	// the base instance selects the model matrix of the object
+	// from the per-instance vertex attribute
+	command.baseInstance = objectIndex;
+	commands[groupFirstCommand[object.drawGroup] + slot] = command;
+}
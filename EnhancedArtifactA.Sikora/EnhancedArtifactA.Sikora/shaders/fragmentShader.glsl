@@ -1,9 +1,22 @@
 #version 330 core
+// uniforms of a SPIR-V program are matched across its stages by location
+// rather than by name, so the SPIR-V build gives every uniform a fixed
+// location, the same in both stages - the GLSL text compiled at run time
+// links them by name and leaves the locations to the driver
+#ifdef GL_SPIRV
+#extension GL_ARB_explicit_uniform_location : require
+#define UNIFORM_LOCATION(n) layout (location = n)
+#else
+#define UNIFORM_LOCATION(n)
+#endif
 out vec4 fragmentColor;
 
 in vec3 fragmentPosition;
 in vec3 fragmentVertexNormal;
 in vec2 fragmentTextureCoordinate;
+in float fragmentFade;
+flat in vec4 fragmentTextureRegion;
+flat in vec2 fragmentUVscale;
 
 struct Material {
     vec3 diffuseColor;
@@ -50,24 +63,56 @@ struct SpotLight {
 
 #define TOTAL_POINT_LIGHTS 5
 
-uniform bool bUseTexture=false;
-uniform bool bUseLighting=false;
-uniform vec4 objectColor = vec4(1.0f);
-uniform vec3 viewPosition;
-uniform DirectionalLight directionalLight;
-uniform PointLight pointLights[TOTAL_POINT_LIGHTS];
-uniform SpotLight spotLight;
-uniform Material material;
-uniform sampler2D objectTexture;
-uniform vec2 UVscale = vec2(1.0f, 1.0f);
+// the SPIR-V build is specialized for the lights the scene uses, which
+// drops the loop iterations and branches of the unused ones - the GLSL
+// text compiled at run time keeps the defaults and tests every light
+#ifdef GL_SPIRV
+layout (constant_id = 0) const int activePointLights = TOTAL_POINT_LIGHTS;
+layout (constant_id = 1) const bool bSpotLightEnabled = true;
+#else
+const int activePointLights = TOTAL_POINT_LIGHTS;
+const bool bSpotLightEnabled = true;
+#endif
+
+// locations follow on from the vertex shader, whose viewPosition this
+// shares - a struct takes one location per member and an array one per
+// element, so each light leaves room for all of its members
+UNIFORM_LOCATION(23) uniform bool bUseTexture=false;
+UNIFORM_LOCATION(24) uniform bool bUseLighting=false;
+UNIFORM_LOCATION(25) uniform vec4 objectColor = vec4(1.0f);
+UNIFORM_LOCATION(22) uniform vec3 viewPosition;
+UNIFORM_LOCATION(26) uniform DirectionalLight directionalLight;
+UNIFORM_LOCATION(31) uniform PointLight pointLights[TOTAL_POINT_LIGHTS];
+UNIFORM_LOCATION(56) uniform SpotLight spotLight;
+UNIFORM_LOCATION(67) uniform Material material;
+UNIFORM_LOCATION(70) uniform sampler2D objectTexture;
+
+// 4x4 ordered dither thresholds for fading instances out
+const float ditherThresholds[16] = float[16](
+     0.0,  8.0,  2.0, 10.0,
+    12.0,  4.0, 14.0,  6.0,
+     3.0, 11.0,  1.0,  9.0,
+    15.0,  7.0, 13.0,  5.0);
 
 // function prototypes
+vec4 SampleObjectTexture(vec2 textureCoordinate);
 vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir);
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 
 void main()
 {    
+    // plants crossing over to their impostor drop the pixels
+    // the impostor draws, so the two never blend or overlap
+    if(fragmentFade > 0.0)
+    {
+        ivec2 ditherPixel = ivec2(gl_FragCoord.xy) & 3;
+        if((ditherThresholds[ditherPixel.y * 4 + ditherPixel.x] + 0.5) / 16.0 < fragmentFade)
+        {
+            discard;
+        }
+    }
+
     if(bUseLighting == true)
     {
         vec3 phongResult = vec3(0.0f);
@@ -87,7 +132,7 @@ void main()
             phongResult += CalcDirectionalLight(directionalLight, norm, viewDir);
         }
         // phase 2: point lights
-        for(int i = 0; i < TOTAL_POINT_LIGHTS; i++)
+        for(int i = 0; i < activePointLights; i++)
         {
 	    if(pointLights[i].bActive == true)
             {
@@ -95,14 +140,14 @@ void main()
             }
         } 
         // phase 3: spot light
-        if(spotLight.bActive == true)
+        if(bSpotLightEnabled && spotLight.bActive == true)
         {
             phongResult += CalcSpotLight(spotLight, norm, fragmentPosition, viewDir);    
         }
     
         if(bUseTexture == true)
         {
-            fragmentColor = vec4(phongResult, (texture(objectTexture, fragmentTextureCoordinate)).a);
+            fragmentColor = vec4(phongResult, (SampleObjectTexture(fragmentTextureCoordinate)).a);
         }
         else
         {
@@ -113,7 +158,7 @@ void main()
     {
         if(bUseTexture == true)
         {
-            fragmentColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
+            fragmentColor = SampleObjectTexture(fragmentTextureCoordinate * fragmentUVscale);
         }
         else
         {
@@ -122,6 +167,16 @@ void main()
     }
 }
 
+// samples the object texture, repeated within its region of the texture
+// atlas - the gradients are taken before the wrap, so the mipmap level
+// does not jump to the coarsest one along the seams
+vec4 SampleObjectTexture(vec2 textureCoordinate)
+{
+    vec2 regionCoordinate = fragmentTextureRegion.xy + fract(textureCoordinate) * fragmentTextureRegion.zw;
+    return textureGrad(objectTexture, regionCoordinate,
+        dFdx(textureCoordinate) * fragmentTextureRegion.zw, dFdy(textureCoordinate) * fragmentTextureRegion.zw);
+}
+
 // calculates the color when using a directional light.
 vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir)
 {
@@ -138,9 +193,9 @@ vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir)
     // combine results
     if(bUseTexture == true)
     {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        specular = light.specular * spec * material.specularColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
+        ambient = light.ambient * vec3(SampleObjectTexture(fragmentTextureCoordinate));
+        diffuse = light.diffuse * diff * material.diffuseColor * vec3(SampleObjectTexture(fragmentTextureCoordinate));
+        specular = light.specular * spec * material.specularColor * vec3(SampleObjectTexture(fragmentTextureCoordinate));
     }
     else
     {
@@ -170,8 +225,8 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     // combine results
     if(bUseTexture == true)
     {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
+        ambient = light.ambient * vec3(SampleObjectTexture(fragmentTextureCoordinate));
+        diffuse = light.diffuse * diff * material.diffuseColor * vec3(SampleObjectTexture(fragmentTextureCoordinate));
         specular = light.specular * specularComponent * material.specularColor;
     }
     else
@@ -207,9 +262,9 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     // combine results
     if(bUseTexture == true)
     {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
-        specular = light.specular * spec * material.specularColor * vec3(texture(objectTexture, fragmentTextureCoordinate));
+        ambient = light.ambient * vec3(SampleObjectTexture(fragmentTextureCoordinate));
+        diffuse = light.diffuse * diff * material.diffuseColor * vec3(SampleObjectTexture(fragmentTextureCoordinate));
+        specular = light.specular * spec * material.specularColor * vec3(SampleObjectTexture(fragmentTextureCoordinate));
     }
     else
     {
@@ -0,0 +1,47 @@
+#version 330 core
+// uniforms of a SPIR-V program are matched across its stages by location
+// rather than by name, so the SPIR-V build gives every uniform a fixed
+// location, the same in both stages - the GLSL text compiled at run time
+// links them by name and leaves the locations to the driver
+#ifdef GL_SPIRV
+#extension GL_ARB_explicit_uniform_location : require
+#define UNIFORM_LOCATION(n) layout (location = n)
+#else
+#define UNIFORM_LOCATION(n)
+#endif
+out vec4 fragmentColor;
+
+in vec2 impostorTextureCoordinate;
+in float impostorFade;
+
+// locations follow on from the view and projection of the vertex shader
+UNIFORM_LOCATION(2) uniform sampler2D impostorAtlas;
+// the images are baked unlit, this brings them close to the lit plants
+UNIFORM_LOCATION(3) uniform float impostorBrightness = 0.7;
+
+// 4x4 ordered dither thresholds, the same as the scene shader uses
+const float ditherThresholds[16] = float[16](
+     0.0,  8.0,  2.0, 10.0,
+    12.0,  4.0, 14.0,  6.0,
+     3.0, 11.0,  1.0,  9.0,
+    15.0,  7.0, 13.0,  5.0);
+
+void main()
+{
+    vec4 texel = texture(impostorAtlas, impostorTextureCoordinate);
+    if(texel.a < 0.5)
+    {
+        discard;
+    }
+
+    // only the pixels the fading geometry has dropped are drawn
+    ivec2 ditherPixel = ivec2(gl_FragCoord.xy) & 3;
+    if((ditherThresholds[ditherPixel.y * 4 + ditherPixel.x] + 0.5) / 16.0 >= impostorFade)
+    {
+        discard;
+    }
+
+    // the coarser mipmaps mix in the transparent black around the
+    // plant, which dividing by the coverage takes out again
+    fragmentColor = vec4(texel.rgb / texel.a * impostorBrightness, 1.0);
+}
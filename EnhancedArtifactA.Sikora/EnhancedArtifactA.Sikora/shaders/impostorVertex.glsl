@@ -0,0 +1,38 @@
+#version 330 core
+// uniforms of a SPIR-V program are matched across its stages by location
+// rather than by name, so the SPIR-V build gives every uniform a fixed
+// location, the same in both stages - the GLSL text compiled at run time
+// links them by name and leaves the locations to the driver
+#ifdef GL_SPIRV
+#extension GL_ARB_explicit_uniform_location : require
+#define UNIFORM_LOCATION(n) layout (location = n)
+#else
+#define UNIFORM_LOCATION(n)
+#endif
+// billboard of a far plant - the quad turns around its vertical axis
+// to face the camera and shows the baked image of the species
+layout (location = 0) in vec2 inCorner;			// -0.5 to 0.5 across, 0 to 1 up
+layout (location = 1) in vec4 inPositionFade;	// base of the plant and drawn part
+layout (location = 2) in vec4 inSize;			// width, height and bottom edge
+layout (location = 3) in vec4 inAtlasRect;		// u0 v0 u1 v1 of the baked image
+
+out vec2 impostorTextureCoordinate;
+out float impostorFade;
+
+UNIFORM_LOCATION(0) uniform mat4 view;
+UNIFORM_LOCATION(1) uniform mat4 projection;
+
+void main()
+{
+   // the right axis of the camera, kept level so the plants stay upright
+   vec3 cameraRight = vec3(view[0][0], 0.0, view[2][0]);
+   cameraRight = (dot(cameraRight, cameraRight) > 1.0e-6) ? normalize(cameraRight) : vec3(1.0, 0.0, 0.0);
+
+   vec3 position = inPositionFade.xyz +
+      cameraRight * (inCorner.x * inSize.x) +
+      vec3(0.0, inSize.z + inCorner.y * inSize.y, 0.0);
+
+   gl_Position = projection * view * vec4(position, 1.0);
+   impostorTextureCoordinate = mix(inAtlasRect.xy, inAtlasRect.zw, vec2(inCorner.x + 0.5, inCorner.y));
+   impostorFade = inPositionFade.w;
+}
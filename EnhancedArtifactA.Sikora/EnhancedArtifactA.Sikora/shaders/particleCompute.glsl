@@ -0,0 +1,242 @@
+#version 430 core
+// every stage of a particle effect update, picked by particleStage and
+// run one after the other with a barrier in between - the first sizes
+// the dispatches of the next two, emit takes particles from the free
+// list, simulate moves the alive particles and compacts them into the
+// other alive list, and the last writes the instance count of the draw
+layout (local_size_x = 64) in;
+
+struct Particle
+{
+	vec4 positionSize;
+	vec4 velocityAge;
+	vec4 spin;				// angle, spin speed, lifetime, 1 once landed
+};
+
+struct Emitter
+{
+	vec4 centerRadius;
+	vec4 halfExtentType;	// w is 0 for the upper half of a sphere, 1 for a box
+};
+
+layout (std430, binding = 0) buffer Particles { Particle particles[]; };
+layout (std430, binding = 1) buffer DeadList { uint deadList[]; };
+// two lists of capacity entries, one read and one written per update
+layout (std430, binding = 2) buffer AliveLists { uint aliveList[]; };
+layout (std430, binding = 3) buffer State
+{
+	uint deadCount;
+	uint aliveCount[2];
+	uint emitCount;
+	uvec4 emitDispatch;
+	uvec4 simulateDispatch;
+	uvec4 drawArgs;
+};
+layout (std430, binding = 4) readonly buffer Emitters { Emitter emitters[]; };
+
+const uint STAGE_BEGIN = 0u;
+const uint STAGE_EMIT = 1u;
+const uint STAGE_SIMULATE = 2u;
+const uint GROUP_SIZE = 64u;
+
+uniform uint particleStage;
+uniform uint currentList;
+uniform uint capacity;
+uniform uint requestedEmit;
+uniform uint emitterCount;
+uniform float seconds;
+uniform float time;
+uniform uint randomSeed;
+uniform float lifetime;
+uniform vec2 sizeRange;
+uniform float gravity;
+uniform float drag;
+uniform vec2 wind;
+uniform float gust;
+
+// ground of the scene, the y = 0 plane when there is no terrain
+uniform bool bUseTerrain = false;
+uniform sampler2D terrainHeights;
+// x z of the lowest corner, side length and height samples per side
+uniform vec4 terrainArea;
+
+uint Hash(uint value)
+{
+	uint state = value * 747796405u + 2891336453u;
+	uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+// next random number from 0 to 1
+float Random(inout uint state)
+{
+	state = Hash(state);
+	return float(state) / 4294967295.0;
+}
+
+float LatticeValue(vec3 cell)
+{
+	uvec3 lattice = uvec3(ivec3(cell));
+	return float(Hash(lattice.x ^ Hash(lattice.y ^ Hash(lattice.z)))) / 4294967295.0;
+}
+
+// smooth noise from 0 to 1
+float ValueNoise(vec3 position)
+{
+	vec3 cell = floor(position);
+	vec3 blend = fract(position);
+	blend = blend * blend * (3.0 - 2.0 * blend);
+
+	float lower = mix(
+		mix(LatticeValue(cell), LatticeValue(cell + vec3(1.0, 0.0, 0.0)), blend.x),
+		mix(LatticeValue(cell + vec3(0.0, 1.0, 0.0)), LatticeValue(cell + vec3(1.0, 1.0, 0.0)), blend.x),
+		blend.y);
+	float upper = mix(
+		mix(LatticeValue(cell + vec3(0.0, 0.0, 1.0)), LatticeValue(cell + vec3(1.0, 0.0, 1.0)), blend.x),
+		mix(LatticeValue(cell + vec3(0.0, 1.0, 1.0)), LatticeValue(cell + vec3(1.0, 1.0, 1.0)), blend.x),
+		blend.y);
+	return mix(lower, upper, blend.z);
+}
+
+// gusts from a noise field that drifts with the wind, weaker upwards
+vec3 WindGust(vec3 position)
+{
+	vec3 field = position * 0.15 - vec3(wind.x, 0.0, wind.y) * time * 0.15 + vec3(0.0, time * 0.1, 0.0);
+	vec3 gustVelocity = vec3(
+		ValueNoise(field),
+		ValueNoise(field + vec3(31.4, 7.1, 2.7)),
+		ValueNoise(field + vec3(11.3, 23.9, 5.2))) * 2.0 - 1.0;
+	return gustVelocity * vec3(1.0, 0.4, 1.0) * gust;
+}
+
+float GroundHeight(vec2 worldXZ)
+{
+	if (!bUseTerrain)
+	{
+		return 0.0;
+	}
+	// the texel centers sit on the height samples, as in the scene shader
+	vec2 samplePosition = (worldXZ - terrainArea.xy) / terrainArea.z * (terrainArea.w - 1.0);
+	return textureLod(terrainHeights, (samplePosition + 0.5) / terrainArea.w, 0.0).r;
+}
+
+void Begin()
+{
+	uint emit = min(requestedEmit, deadCount);
+	emitCount = emit;
+	emitDispatch = uvec4((emit + GROUP_SIZE - 1u) / GROUP_SIZE, 1u, 1u, 0u);
+	simulateDispatch = uvec4((aliveCount[currentList] + emit + GROUP_SIZE - 1u) / GROUP_SIZE, 1u, 1u, 0u);
+	aliveCount[1u - currentList] = 0u;
+}
+
+void Emit(uint invocation)
+{
+	if (invocation >= emitCount)
+	{
+		return;
+	}
+
+	// the begin stage left at least emitCount free particles
+	uint index = deadList[atomicAdd(deadCount, 0xFFFFFFFFu) - 1u];
+
+	uint random = Hash(invocation ^ Hash(randomSeed));
+	Emitter emitter = emitters[min(uint(Random(random) * float(emitterCount)), emitterCount - 1u)];
+
+	vec3 position;
+	if (emitter.halfExtentType.w > 0.5)
+	{
+		vec3 offset = vec3(Random(random), Random(random), Random(random)) * 2.0 - 1.0;
+		position = emitter.centerRadius.xyz + offset * emitter.halfExtentType.xyz;
+	}
+	else
+	{
+		float z = Random(random);
+		float angle = Random(random) * 6.2831853;
+		float ring = sqrt(1.0 - z * z);
+		vec3 direction = vec3(ring * cos(angle), z, ring * sin(angle));
+		position = emitter.centerRadius.xyz + direction * emitter.centerRadius.w * pow(Random(random), 1.0 / 3.0);
+	}
+
+	Particle particle;
+	particle.positionSize = vec4(position, mix(sizeRange.x, sizeRange.y, Random(random)));
+	particle.velocityAge = vec4(vec3(wind.x, 0.0, wind.y) * Random(random), 0.0);
+	particle.spin = vec4(
+		Random(random) * 6.2831853,
+		(Random(random) * 2.0 - 1.0) * 4.0,
+		lifetime * mix(0.75, 1.25, Random(random)),
+		0.0);
+	particles[index] = particle;
+
+	aliveList[currentList * capacity + atomicAdd(aliveCount[currentList], 1u)] = index;
+}
+
+void Simulate(uint invocation)
+{
+	if (invocation >= aliveCount[currentList])
+	{
+		return;
+	}
+
+	uint index = aliveList[currentList * capacity + invocation];
+	Particle particle = particles[index];
+
+	float age = particle.velocityAge.w + seconds;
+	if (age >= particle.spin.z)
+	{
+		deadList[atomicAdd(deadCount, 1u)] = index;
+		return;
+	}
+
+	vec3 position = particle.positionSize.xyz;
+	vec3 velocity = particle.velocityAge.xyz;
+	if (particle.spin.w < 0.5)
+	{
+		// ease towards the wind while falling, and flutter
+		// sideways with the spin of the particle
+		vec3 windVelocity = vec3(wind.x, 0.0, wind.y) + WindGust(position);
+		velocity += (vec3(0.0, -gravity, 0.0) + (windVelocity - velocity) * drag) * seconds;
+		vec3 flutter = vec3(cos(particle.spin.x), 0.0, sin(particle.spin.x)) * abs(particle.spin.y) * 0.05;
+		position += (velocity + flutter) * seconds;
+		particle.spin.x += particle.spin.y * seconds;
+
+		// come to rest on the ground
+		float ground = GroundHeight(position.xz);
+		if (position.y <= ground)
+		{
+			position.y = ground + 0.01;
+			velocity = vec3(0.0);
+			particle.spin.w = 1.0;
+		}
+	}
+
+	particle.positionSize.xyz = position;
+	particle.velocityAge = vec4(velocity, age);
+	particles[index] = particle;
+
+	uint nextList = 1u - currentList;
+	aliveList[nextList * capacity + atomicAdd(aliveCount[nextList], 1u)] = index;
+}
+
+void main()
+{
+	if (particleStage == STAGE_BEGIN)
+	{
+		if (gl_GlobalInvocationID.x == 0u)
+		{
+			Begin();
+		}
+	}
+	else if (particleStage == STAGE_EMIT)
+	{
+		Emit(gl_GlobalInvocationID.x);
+	}
+	else if (particleStage == STAGE_SIMULATE)
+	{
+		Simulate(gl_GlobalInvocationID.x);
+	}
+	else if (gl_GlobalInvocationID.x == 0u)
+	{
+		// four corners of the quad for every particle still alive
+		drawArgs = uvec4(4u, aliveCount[1u - currentList], 0u, 0u);
+	}
+}
@@ -0,0 +1,32 @@
+#version 430 core
+out vec4 fragmentColor;
+
+in vec2 particleCorner;
+in vec2 particleTextureCoordinate;
+
+uniform bool bUseTexture = false;
+uniform sampler2D particleTexture;
+uniform vec4 particleColor;
+// particles are drawn unlit, this brings them close to the lit scene
+uniform float particleBrightness = 0.8;
+
+void main()
+{
+	// textured particles are cut into a leaf, pointed at both ends,
+	// plain ones into a round dot
+	if (bUseTexture)
+	{
+		float halfWidth = 0.55 * (1.0 - particleCorner.y * particleCorner.y);
+		if (abs(particleCorner.x) > halfWidth)
+		{
+			discard;
+		}
+	}
+	else if (dot(particleCorner, particleCorner) > 1.0)
+	{
+		discard;
+	}
+
+	vec4 color = bUseTexture ? texture(particleTexture, particleTextureCoordinate) : particleColor;
+	fragmentColor = vec4(color.rgb * particleBrightness, 1.0);
+}
@@ -0,0 +1,53 @@
+#version 430 core
+// billboard of one particle - the instance picks the particle from the
+// alive list the last update wrote, the quad faces the camera and turns
+// with the spin of the particle, or lies flat once it has landed
+layout (location = 0) in vec2 inCorner;		// -0.5 to 0.5 across and up
+
+struct Particle
+{
+	vec4 positionSize;
+	vec4 velocityAge;
+	vec4 spin;				// angle, spin speed, lifetime, 1 once landed
+};
+
+layout (std430, binding = 0) readonly buffer Particles { Particle particles[]; };
+layout (std430, binding = 2) readonly buffer AliveLists { uint aliveList[]; };
+
+out vec2 particleCorner;
+out vec2 particleTextureCoordinate;
+
+uniform mat4 view;
+uniform mat4 projection;
+// first entry of the alive list the last update wrote
+uniform uint aliveListOffset;
+
+// the last part of its life a particle shrinks away over
+const float FADE_SECONDS = 1.0;
+
+void main()
+{
+	uint index = aliveList[aliveListOffset + uint(gl_InstanceID)];
+	Particle particle = particles[index];
+
+	float angle = particle.spin.x;
+	vec2 corner = mat2(cos(angle), sin(angle), -sin(angle), cos(angle)) * inCorner;
+
+	vec3 right = vec3(view[0][0], view[1][0], view[2][0]);
+	vec3 up = vec3(view[0][1], view[1][1], view[2][1]);
+	if (particle.spin.w > 0.5)
+	{
+		right = vec3(1.0, 0.0, 0.0);
+		up = vec3(0.0, 0.0, 1.0);
+	}
+
+	float remaining = particle.spin.z - particle.velocityAge.w;
+	float size = particle.positionSize.w * clamp(remaining / FADE_SECONDS, 0.0, 1.0);
+	vec3 position = particle.positionSize.xyz + (right * corner.x + up * corner.y) * size;
+
+	gl_Position = projection * view * vec4(position, 1.0);
+	particleCorner = inCorner * 2.0;
+	// every particle shows its own small patch of the texture
+	vec2 patchOrigin = fract(vec2(float(index) * 0.6180340, float(index) * 0.3819660));
+	particleTextureCoordinate = patchOrigin * 0.8 + (inCorner + 0.5) * 0.2;
+}
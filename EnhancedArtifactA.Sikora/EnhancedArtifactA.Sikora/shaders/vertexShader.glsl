@@ -1,20 +1,117 @@
 #version 330 core
+// uniforms of a SPIR-V program are matched across its stages by location
+// rather than by name, so the SPIR-V build gives every uniform a fixed
+// location, the same in both stages - the GLSL text compiled at run time
+// links them by name and leaves the locations to the driver
+#ifdef GL_SPIRV
+#extension GL_ARB_explicit_uniform_location : require
+#define UNIFORM_LOCATION(n) layout (location = n)
+#else
+#define UNIFORM_LOCATION(n)
+#endif
 layout (location = 0) in vec3 inVertexPosition;
 layout (location = 1) in vec3 inVertexNormal;
 layout (location = 2) in vec2 inTextureCoordinate;
+// per-instance model matrix of GPU culled objects and instanced plants
+layout (location = 3) in mat4 inObjectModel;
+// per-instance part of a plant dithered away, 0 for everything else
+layout (location = 7) in float inObjectFade;
+// per-instance terrain chunk - x z of its corner, size and level of detail
+layout (location = 8) in vec4 inTerrainNode;
+// per-instance texture atlas region and texture scale of GPU culled objects
+layout (location = 9) in vec4 inObjectTextureRegion;
+layout (location = 10) in vec2 inObjectUVscale;
 
 out vec3 fragmentPosition;
 out vec3 fragmentVertexNormal;
 out vec2 fragmentTextureCoordinate;
+out float fragmentFade;
+flat out vec4 fragmentTextureRegion;
+flat out vec2 fragmentUVscale;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+UNIFORM_LOCATION(0) uniform mat4 model;
+UNIFORM_LOCATION(1) uniform mat4 view;
+UNIFORM_LOCATION(2) uniform mat4 projection;
+UNIFORM_LOCATION(3) uniform bool bUseObjectModel = false;
+// region of the texture atlas the object texture takes, offset in x y
+// and scale in z w, and the repeats of the texture across the object -
+// GPU culled objects of one atlas are drawn together and take theirs
+// from the per-instance attributes instead
+UNIFORM_LOCATION(4) uniform vec4 textureRegion = vec4(0.0, 0.0, 1.0, 1.0);
+UNIFORM_LOCATION(5) uniform vec2 UVscale = vec2(1.0, 1.0);
+UNIFORM_LOCATION(6) uniform bool bUseObjectTexture = false;
+
+// terrain chunks draw a shared grid - the vertex position is the x z of
+// the vertex across the chunk, from 0 to 1, and 1 for the bottom of a skirt
+UNIFORM_LOCATION(7) uniform bool bUseTerrain = false;
+UNIFORM_LOCATION(8) uniform sampler2D terrainHeights;
+// x z of the lowest corner, side length and height samples per side
+UNIFORM_LOCATION(9) uniform vec4 terrainArea;
+// side of the finest chunks and quads along the side of the grid
+UNIFORM_LOCATION(10) uniform float terrainLeafSize;
+UNIFORM_LOCATION(11) uniform float terrainGridSize;
+// camera distances over which each level morphs into the next
+UNIFORM_LOCATION(12) uniform vec2 terrainMorphRanges[8];
+// depth of the skirts, in quads of the grid
+UNIFORM_LOCATION(20) uniform float terrainSkirtDepth;
+// texture repeats per unit
+UNIFORM_LOCATION(21) uniform vec2 terrainUVscale;
+// shared with the fragment shader, which takes its locations from 23 on
+UNIFORM_LOCATION(22) uniform vec3 viewPosition;
+
+float TerrainHeight(vec2 worldXZ)
+{
+   // the texel centers sit on the height samples
+   vec2 samplePosition = (worldXZ - terrainArea.xy) / terrainArea.z * (terrainArea.w - 1.0);
+   return textureLod(terrainHeights, (samplePosition + 0.5) / terrainArea.w, 0.0).r;
+}
 
 void main()
 {
-   fragmentPosition = vec3(model * vec4(inVertexPosition, 1.0));
-   gl_Position = projection * view * model * vec4(inVertexPosition, 1.0f);
+   fragmentTextureRegion = bUseObjectTexture ? inObjectTextureRegion : textureRegion;
+   fragmentUVscale = bUseObjectTexture ? inObjectUVscale : UVscale;
+
+   if (bUseTerrain)
+   {
+      int level = int(inTerrainNode.w);
+      float levelSpacing = terrainLeafSize * exp2(inTerrainNode.w) / terrainGridSize;
+
+      // snap to the grid of the level - a quarter chunk drawn at the
+      // level above its size drops every other vertex
+      vec2 worldXZ = inTerrainNode.xy + inVertexPosition.xy * inTerrainNode.z;
+      vec2 cell = floor((worldXZ - terrainArea.xy) / levelSpacing + 0.25);
+      vec2 levelXZ = terrainArea.xy + cell * levelSpacing;
+
+      // the odd vertices slide onto the grid of the next level
+      // towards the end of the range, where that level takes over
+      vec3 levelPosition = vec3(levelXZ.x, TerrainHeight(levelXZ), levelXZ.y);
+      vec2 morphRange = terrainMorphRanges[level];
+      float morph = clamp((distance(viewPosition, levelPosition) - morphRange.x) / (morphRange.y - morphRange.x), 0.0, 1.0);
+      worldXZ = levelXZ - mod(cell, 2.0) * levelSpacing * morph;
+
+      float height = TerrainHeight(worldXZ) - inVertexPosition.z * terrainSkirtDepth * levelSpacing;
+
+      // normal from the slope between the neighbouring samples
+      float sampleSpacing = terrainArea.z / (terrainArea.w - 1.0);
+      float left = TerrainHeight(worldXZ - vec2(sampleSpacing, 0.0));
+      float right = TerrainHeight(worldXZ + vec2(sampleSpacing, 0.0));
+      float back = TerrainHeight(worldXZ - vec2(0.0, sampleSpacing));
+      float front = TerrainHeight(worldXZ + vec2(0.0, sampleSpacing));
+
+      fragmentPosition = vec3(worldXZ.x, height, worldXZ.y);
+      gl_Position = projection * view * vec4(fragmentPosition, 1.0);
+      fragmentVertexNormal = normalize(vec3(left - right, 2.0 * sampleSpacing, back - front));
+      fragmentTextureCoordinate = worldXZ * terrainUVscale;
+      fragmentFade = 0.0;
+      return;
+   }
+
+   // instances place the model matrix, which then holds the
+   // placement of the part, in the world
+   mat4 objectModel = bUseObjectModel ? inObjectModel * model : model;
+   fragmentPosition = vec3(objectModel * vec4(inVertexPosition, 1.0));
+   gl_Position = projection * view * objectModel * vec4(inVertexPosition, 1.0f);
    fragmentVertexNormal = inVertexNormal;
    fragmentTextureCoordinate = inTextureCoordinate;
+   fragmentFade = inObjectFade;
 }
\ No newline at end of file